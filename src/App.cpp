@@ -24,10 +24,14 @@
  */
 
 
+#include <inttypes.h>
 #include <stdlib.h>
 #include <uv.h>
 
 
+#include "amd/OclCache.h"
+#include "amd/OclDiagnostics.h"
+#include "amd/OclLib.h"
 #include "api/Api.h"
 #include "App.h"
 #include "base/kernel/Signals.h"
@@ -36,13 +40,21 @@
 #include "common/Platform.h"
 #include "core/Config.h"
 #include "core/Controller.h"
+#include "core/LogSummary.h"
+#include "core/LoopMonitor.h"
+#include "core/RuntimeState.h"
+#include "core/StartupProfile.h"
+#include "core/Trace.h"
 #include "crypto/CryptoNight.h"
 #include "Mem.h"
 #include "net/Network.h"
+#include "net/SessionReplay.h"
 #include "Summary.h"
 #include "version.h"
 #include "workers/Workers.h"
 #include "workers/Benchmark.h"
+#include "workers/SwitchTest.h"
+#include "workers/OclThread.h"
 
 
 #ifndef XMRIG_NO_HTTPD
@@ -55,6 +67,8 @@ xmrig::App::App(Process *process) :
     m_httpd(nullptr),
     m_signals(nullptr)
 {
+    StartupProfile::init();
+
     m_controller = new xmrig::Controller(process);
     if (m_controller->init() != 0) {
         return;
@@ -72,6 +86,9 @@ xmrig::App::~App()
 
     uv_tty_reset_mode();
 
+    OclDiagnostics::release();
+    CryptoNight::release();
+
     delete m_signals;
     delete m_console;
     delete m_controller;
@@ -83,6 +100,8 @@ xmrig::App::~App()
 
 // this should be global since we register onJobResult using this object method
 static Benchmark benchmark;
+static xmrig::SwitchTest switchTest;
+static xmrig::SessionReplay sessionReplay;
 
 int xmrig::App::exec()
 {
@@ -94,20 +113,28 @@ int xmrig::App::exec()
 
     background();
 
-    Mem::init(true);
+    Mem::init(true, m_controller->config()->isOneGbPages());
 
-    if (!CryptoNight::init(m_controller->config()->algorithm().algo())) {
-        LOG_ERR("\"%s\" hash self-test failed.", m_controller->config()->algorithm().name());
-        return 1;
-    }
+    CryptoNight::init(m_controller->config()->algorithm().algo());
 
     Summary::print(m_controller);
 
+    // a dry run waits for the self-tests the miner would otherwise finish in the background
     if (m_controller->config()->isDryRun()) {
+        if (!CryptoNight::selfTest(m_controller->config()->algorithm().algo())) {
+            return 1;
+        }
+
         LOG_NOTICE("OK");
         return 0;
     }
 
+    // the previous process holds the GPUs and the API port until everything else is ready
+    const bool isHandover = m_controller->config()->handover() > 0;
+    if (isHandover && !handover()) {
+        return 1;
+    }
+
 #   ifndef XMRIG_NO_API
     Api::start(m_controller);
 #   endif
@@ -127,7 +154,16 @@ int xmrig::App::exec()
         LOG_WARN("Failed to set system timer resolution.");
     }
 
-    if (!m_controller->oclInit() || !Workers::start(m_controller)) {
+    if (!isHandover && !prepare()) {
+        return 1;
+    }
+
+    // the GPUs are idle before the threads allocate their buffers
+    if (m_controller->config()->isDiagnostics()) {
+        OclDiagnostics::run(m_controller->config());
+    }
+
+    if (!Workers::start(m_controller)) {
         LOG_ERR("Failed to start threads.");
         return 1;
     }
@@ -135,9 +171,55 @@ int xmrig::App::exec()
     // save config here to have option to store automatically generated "threads"
     if (m_controller->config()->isShouldSave()) m_controller->config()->save();
 
+    // only perf algos without valid stored results are measured unless full calibration is requested
+    const bool calibrateAll                       = m_controller->config()->isCalibrateAlgo() || m_controller->config()->isAutotune() || m_controller->config()->isStress();
+    const std::vector<xmrig::PerfAlgo> benchAlgos = benchmarkAlgos(calibrateAll);
+
+    // we need controller there to access config and network objects, the API may start benchmark in runtime too
+    benchmark.set_controller(m_controller);
+    m_controller->setBenchmark(&benchmark);
+
+    // algo switches on the mock pool, calibration is skipped, it prints report and exits
+    if (m_controller->config()->isTestSwitch()) {
+        if (!switchTest.start(m_controller)) {
+            return 1;
+        }
+
+        m_controller->network()->connect();
+    }
+    // recorded jobs on the mock pool, calibration is skipped, it prints report and exits
+    else if (m_controller->config()->replaySession()) {
+        if (!sessionReplay.start(m_controller)) {
+            return 1;
+        }
+
+        m_controller->network()->connect();
+    }
+    // standalone benchmark without pool, it prints report and exits
+    else if (m_controller->config()->isBench()) {
+        if (m_controller->config()->benchAlgos().empty()) {
+            LOG_ERR("No perf algos to benchmark.");
+            return 1;
+        }
+
+        // the GPUs start hashing one by one, a benchmark round measures all of them
+        Workers::waitReady();
+
+        benchmark.set_original_algorithm(m_controller->config()->algorithm());
+        benchmark.set_bench_mode(m_controller->config()->benchAlgos());
+        Workers::setListener(&benchmark);
+        Log::i()->text(m_controller->config()->isColors()
+            ? GREEN_BOLD(" >>>>> ") WHITE_BOLD("STARTING BENCHMARK (with up to %i seconds round)")
+            : " >>>>> STARTING BENCHMARK (with up to %i seconds round)",
+            m_controller->config()->calibrateAlgoTime()
+        );
+        benchmark.start_perf_bench(benchmark.first_perf_algo());
+    }
     // run benchmark before pool mining or not?
-    if (m_controller->config()->get_algo_perf(xmrig::PA_CN) == 0.0f || m_controller->config()->isCalibrateAlgo()) {
-        benchmark.set_controller(m_controller); // we need controller there to access config and network objects
+    else if (!benchAlgos.empty()) {
+        Workers::waitReady();
+
+        benchmark.set_algos(benchAlgos);
         benchmark.set_original_algorithm(m_controller->config()->algorithm());
         Workers::setListener(&benchmark); // register benchmark as job reault listener to compute hashrates there
         // write text before first benchmark round
@@ -147,12 +229,22 @@ int xmrig::App::exec()
             m_controller->config()->calibrateAlgoTime()
         );
         // start benchmarking from first PerfAlgo in the list
-        if (m_controller->config()->get_algo_perf(xmrig::PA_CN) == 0.0f) benchmark.should_save_config();
-        benchmark.start_perf_bench(xmrig::PerfAlgo::PA_CN);
+        if (!calibrateAll || !benchmarkAlgos(false).empty()) benchmark.should_save_config();
+        if (m_controller->config()->isAutotune() || m_controller->config()->isStress()) benchmark.should_save_config(); // to store tuned "threads" of all algos
+        benchmark.start_perf_bench(benchmark.first_perf_algo());
     } else {
         m_controller->network()->connect();
     }
 
+    // records of GPU and compile threads are written on the loop from now on
+    if (m_controller->config()->isLogAsync()) {
+        Log::i()->setAsync(true);
+    }
+
+    Trace::setThreadName("main");
+    OclLib::setThreadName("main");
+    LoopMonitor::start(uv_default_loop(), LoopMonitor::MainLag);
+
     const int r = uv_run(uv_default_loop(), UV_RUN_DEFAULT);
     uv_loop_close(uv_default_loop());
 
@@ -160,6 +252,91 @@ int xmrig::App::exec()
 }
 
 
+// --handover=PID: the self-test and the OpenCL and CryptonightR programs are ready before the previous process is
+// stopped, the GPUs then only wait for its exit and the buffers, programs come from the cache
+bool xmrig::App::handover()
+{
+    const int64_t pid    = m_controller->config()->handover();
+    const uint64_t start = uv_hrtime();
+
+    if (!prepare()) {
+        return false;
+    }
+
+    CryptoNight::selfTest(m_controller->config()->algorithm().algo());
+    Workers::prepare(m_controller);
+
+    LOG_INFO("handover: ready in %.1f s, stopping process %" PRId64, static_cast<double>(uv_hrtime() - start) / 1e9, pid);
+
+    const uint64_t stop = uv_hrtime();
+    if (!stopPrevious(pid)) {
+        LOG_WARN("handover: process %" PRId64 " still running after %d s, starting anyway", pid, kHandoverTimeout);
+    }
+    else {
+        LOG_INFO("handover: process %" PRId64 " stopped in %.1f s", pid, static_cast<double>(uv_hrtime() - stop) / 1e9);
+    }
+
+    // the previous process writes its state on exit
+    RuntimeState::load(m_controller->config()->stateFile(), m_controller->config());
+
+    return true;
+}
+
+
+bool xmrig::App::prepare()
+{
+    // binaries of other rigs with the same devices and driver, so nothing is compiled at startup
+    if (m_controller->config()->cacheImport() && m_controller->config()->isOclCache()) {
+        OclCache::importBundle(m_controller->config()->cacheImport());
+    }
+
+    if (!m_controller->oclInit()) {
+        LOG_ERR("Failed to start threads.");
+        return false;
+    }
+
+    return true;
+}
+
+
+// perf algos the pools can serve, all of them or only without algo-perf or with results of other GPU or driver
+std::vector<xmrig::PerfAlgo> xmrig::App::benchmarkAlgos(bool all) const
+{
+    std::vector<xmrig::PerfAlgo> algos;
+    const Config *config = m_controller->config();
+
+    for (int a = 0; a != xmrig::PerfAlgo::PA_MAX; ++ a) {
+        const xmrig::PerfAlgo pa = static_cast<xmrig::PerfAlgo>(a);
+        if (!config->isPoolPerfAlgo(pa)) {
+            continue;
+        }
+
+        // derived threads get their intensity refined by the calibration
+        bool missing = all || config->get_algo_perf(pa) == 0.0f || config->isDerivedThreads(pa);
+
+        // the ratios of perf forks are measured right after their perf algo
+        for (int f = 0; f != xmrig::PerfFork::FORK_MAX; ++ f) {
+            const xmrig::PerfFork pf = static_cast<xmrig::PerfFork>(f);
+            if (xmrig::Algorithm::perfForkAlgo(pf) == pa && config->get_perf_fork_ratio(pf) == 0.0f) {
+                missing = true;
+            }
+        }
+
+        for (const IThread *thread : config->threads()) {
+            if (!config->isDeviceAlgoPerf(static_cast<const OclThread *>(thread)->ctx(), pa)) {
+                missing = true;
+            }
+        }
+
+        if (missing) {
+            algos.push_back(pa);
+        }
+    }
+
+    return algos;
+}
+
+
 void xmrig::App::onConsoleCommand(char command)
 {
     switch (command) {
@@ -184,6 +361,11 @@ void xmrig::App::onConsoleCommand(char command)
         }
         break;
 
+    case 't':
+    case 'T':
+        Trace::flush();
+        break;
+
     case 3:
         LOG_WARN("Ctrl+C received, exiting");
         close();
@@ -222,7 +404,11 @@ void xmrig::App::onSignal(int signum)
 void xmrig::App::close()
 {
     m_controller->network()->stop();
+    LogSummary::stop();
     Workers::stop();
 
+    Trace::flush();
+    Log::i()->setAsync(false);
+
     uv_stop(uv_default_loop());
 }
@@ -27,8 +27,13 @@
 #define XMRIG_APP_H
 
 
+#include <stdint.h>
+#include <vector>
+
+
 #include "base/kernel/interfaces/ISignalListener.h"
 #include "common/interfaces/IConsoleListener.h"
+#include "common/xmrig.h"
 
 
 class Console;
@@ -57,6 +62,13 @@ protected:
     void onSignal(int signum) override;
 
 private:
+    // seconds the previous process gets to release its GPUs, see --handover
+    constexpr static int kHandoverTimeout = 30;
+
+    bool handover();
+    bool prepare();
+    bool stopPrevious(int64_t pid);
+    std::vector<xmrig::PerfAlgo> benchmarkAlgos(bool all) const;
     void background();
     void close();
 
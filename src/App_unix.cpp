@@ -23,6 +23,7 @@
  */
 
 
+#include <inttypes.h>
 #include <stdlib.h>
 #include <signal.h>
 #include <errno.h>
@@ -35,6 +36,29 @@
 #include "core/Controller.h"
 
 
+// SIGTERM makes the previous miner stop its threads, write its state file and release the GPUs
+bool xmrig::App::stopPrevious(int64_t pid)
+{
+    if (kill(static_cast<pid_t>(pid), SIGTERM) != 0) {
+        if (errno != ESRCH) {
+            LOG_ERR("handover: kill(%" PRId64 ") failed (errno = %d)", pid, errno);
+        }
+
+        return errno == ESRCH;
+    }
+
+    for (int i = 0; i < kHandoverTimeout * 10; ++i) {
+        if (kill(static_cast<pid_t>(pid), 0) != 0 && errno == ESRCH) {
+            return true;
+        }
+
+        usleep(100 * 1000);
+    }
+
+    return false;
+}
+
+
 void xmrig::App::background()
 {
     signal(SIGPIPE, SIG_IGN);
@@ -23,15 +23,34 @@
  */
 
 
+#include <inttypes.h>
 #include <winsock2.h>
 #include <windows.h>
 
 
 #include "App.h"
+#include "common/log/Log.h"
 #include "core/Controller.h"
 #include "core/Config.h"
 
 
+// there is no SIGTERM for another console process, the previous miner is stopped by whoever started the handover
+bool xmrig::App::stopPrevious(int64_t pid)
+{
+    HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, static_cast<DWORD>(pid));
+    if (!process) {
+        return true;
+    }
+
+    LOG_WARN("handover: waiting for process %" PRId64 " to exit", pid);
+
+    const DWORD rc = WaitForSingleObject(process, kHandoverTimeout * 1000);
+    CloseHandle(process);
+
+    return rc == WAIT_OBJECT_0;
+}
+
+
 void xmrig::App::background()
 {
     if (!m_controller->config()->isBackground()) {
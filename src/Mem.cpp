@@ -24,9 +24,14 @@
  */
 
 
+#include <mutex>
+#include <vector>
+
+
 #include "common/utils/mm_malloc.h"
 #include "crypto/CryptoNight.h"
 #include "crypto/CryptoNight_constants.h"
+#include "crypto/CryptonightR_gen.h"
 #include "Mem.h"
 
 
@@ -34,6 +39,40 @@ bool Mem::m_enabled = true;
 int Mem::m_flags    = 0;
 
 
+// code pages of contexts are taken from chunks which are never unmapped, released pages are reused
+static const size_t kCodePageSize   = 0x4000;
+static const size_t kCodePagesChunk = 64;
+
+static std::mutex codePagesMutex;
+static std::vector<uint8_t *> codePages;
+
+
+static uint8_t *allocateCodePage()
+{
+    std::lock_guard<std::mutex> lock(codePagesMutex);
+
+    if (codePages.empty()) {
+        uint8_t *chunk = static_cast<uint8_t *>(Mem::allocateExecutableMemory(kCodePageSize * kCodePagesChunk));
+
+        for (size_t i = kCodePagesChunk; i > 0; --i) {
+            codePages.push_back(chunk + (i - 1) * kCodePageSize);
+        }
+    }
+
+    uint8_t *page = codePages.back();
+    codePages.pop_back();
+
+    return page;
+}
+
+
+static void releaseCodePage(uint8_t *page)
+{
+    std::lock_guard<std::mutex> lock(codePagesMutex);
+    codePages.push_back(page);
+}
+
+
 MemInfo Mem::create(cryptonight_ctx **ctx, xmrig::Algo algorithm, size_t count)
 {
     using namespace xmrig;
@@ -51,7 +90,8 @@ MemInfo Mem::create(cryptonight_ctx **ctx, xmrig::Algo algorithm, size_t count)
         cryptonight_ctx *c = static_cast<cryptonight_ctx *>(_mm_malloc(sizeof(cryptonight_ctx), 4096));
         c->memory          = info.memory + (i * cn_select_memory(algorithm));
 
-        uint8_t* p = reinterpret_cast<uint8_t*>(allocateExecutableMemory(0x4000));
+        uint8_t* p = allocateCodePage();
+        c->generated_code_page   = p;
         c->generated_code  = reinterpret_cast<cn_mainloop_fun_ms_abi>(p);
         c->generated_code_double = reinterpret_cast<cn_mainloop_fun_ms_abi>(p + 0x2000);
 
@@ -71,6 +111,11 @@ void Mem::release(cryptonight_ctx **ctx, size_t count, MemInfo &info)
     release(info);
 
     for (size_t i = 0; i < count; ++i) {
+#       ifndef XMRIG_NO_ASM
+        CryptonightR_release_code(ctx[i]);
+#       endif
+
+        releaseCodePage(ctx[i]->generated_code_page);
         _mm_free(ctx[i]);
     }
 }
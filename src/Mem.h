@@ -41,6 +41,7 @@ struct MemInfo
 {
     alignas(16) uint8_t *memory;
 
+    int node;
     size_t hugePages;
     size_t pages;
     size_t size;
@@ -53,15 +54,19 @@ public:
     enum Flags {
         HugepagesAvailable = 1,
         HugepagesEnabled   = 2,
-        Lock               = 4
+        Lock               = 4,
+        OneGbPages         = 8
     };
 
     static MemInfo create(cryptonight_ctx **ctx, xmrig::Algo algorithm, size_t count);
-    static void init(bool enabled);
+    // huge pages are allocated on the NUMA node of the calling thread, 1 GB pages are tried first if oneGbPages
+    static void init(bool enabled, bool oneGbPages = false);
     static void release(cryptonight_ctx **ctx, size_t count, MemInfo &info);
 
+    // executable memory is writable until protectExecutableMemory, unprotectExecutableMemory makes it writable again
     static void *allocateExecutableMemory(size_t size);
     static void protectExecutableMemory(void *p, size_t size);
+    static void unprotectExecutableMemory(void *p, size_t size);
     static void flushInstructionCache(void *p, size_t size);
 
     static inline bool isHugepagesAvailable() { return (m_flags & HugepagesAvailable) != 0; }
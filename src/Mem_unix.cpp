@@ -24,10 +24,18 @@
  */
 
 
+#include <inttypes.h>
 #include <stdlib.h>
 #include <sys/mman.h>
 
+#ifdef __linux__
+#   include <linux/mempolicy.h>
+#   include <sys/syscall.h>
+#   include <unistd.h>
+#endif
 
+
+#include "common/cpu/Cgroup.h"
 #include "common/log/Log.h"
 #include "common/utils/mm_malloc.h"
 #include "common/xmrig.h"
@@ -35,15 +43,67 @@
 #include "Mem.h"
 
 
-void Mem::init(bool enabled)
+// NUMA node of the CPU the thread runs on, -1 if unknown
+static int currentNode()
+{
+#   if defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu  = 0;
+    unsigned node = 0;
+
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+        return static_cast<int>(node);
+    }
+#   endif
+
+    return -1;
+}
+
+
+#if !defined(__APPLE__) && !defined(__FreeBSD__)
+// a hugetlb cgroup over its limit kills the process with SIGBUS on the first touch, so the pages are not mapped at all
+static bool hugetlbAllows(size_t size, size_t pageSize)
+{
+    const int64_t free = xmrig::Cgroup::hugetlbFree(pageSize);
+    if (free < 0 || static_cast<uint64_t>(free) >= size) {
+        return true;
+    }
+
+    LOG_WARN("%zu MB of huge pages over the hugetlb limit of the cgroup, %" PRId64 " MB left, using regular pages",
+             size / (1024 * 1024), free / (1024 * 1024));
+
+    return false;
+}
+
+
+// pages are taken from the node of the faulting thread whatever the process policy is, then faulted in by this thread
+static void populateLocal(uint8_t *memory, size_t size, size_t pageSize)
+{
+#   if defined(__linux__) && defined(SYS_mbind)
+    syscall(SYS_mbind, memory, size, MPOL_LOCAL, nullptr, 0, 0);
+#   endif
+
+    for (size_t offset = 0; offset < size; offset += pageSize) {
+        memory[offset] = 0;
+    }
+}
+#endif
+
+
+void Mem::init(bool enabled, bool oneGbPages)
 {
     m_enabled = enabled;
+
+    if (oneGbPages) {
+        m_flags |= OneGbPages;
+    }
 }
 
 
+// without huge pages the memory is first touched by the hashing thread, so it is local by the default policy
 void Mem::allocate(MemInfo &info, bool enabled)
 {
     info.hugePages = 0;
+    info.node      = currentNode();
 
     if (!enabled) {
         info.memory = static_cast<uint8_t*>(_mm_malloc(info.size, 4096));
@@ -56,7 +116,32 @@ void Mem::allocate(MemInfo &info, bool enabled)
 #   elif defined(__FreeBSD__)
     info.memory = static_cast<uint8_t*>(mmap(0, info.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_ALIGNED_SUPER | MAP_PREFAULT_READ, -1, 0));
 #   else
-    info.memory = static_cast<uint8_t*>(mmap(0, info.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, 0, 0));
+    info.memory = static_cast<uint8_t*>(MAP_FAILED);
+
+#   ifdef MAP_HUGE_1GB
+    // the whole 1 GB page is taken, the scratchpads use its beginning
+    if (m_flags & OneGbPages) {
+        constexpr const size_t kOneGb = 1024 * 1024 * 1024;
+        const size_t size             = ((info.size + kOneGb - 1) / kOneGb) * kOneGb;
+
+        if (hugetlbAllows(size, kOneGb)) {
+            info.memory = static_cast<uint8_t*>(mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_1GB, -1, 0));
+        }
+
+        if (info.memory != MAP_FAILED) {
+            info.size  = size;
+            info.pages = size / (2 * 1024 * 1024);
+            populateLocal(info.memory, info.size, kOneGb);
+        }
+    }
+#   endif
+
+    if (info.memory == MAP_FAILED && hugetlbAllows(info.size, 2 * 1024 * 1024)) {
+        info.memory = static_cast<uint8_t*>(mmap(0, info.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0));
+        if (info.memory != MAP_FAILED) {
+            populateLocal(info.memory, info.size, 2 * 1024 * 1024);
+        }
+    }
 #   endif
 
     if (info.memory == MAP_FAILED) {
@@ -93,9 +178,9 @@ void Mem::release(MemInfo &info)
 void *Mem::allocateExecutableMemory(size_t size)
 {
 #   if defined(__APPLE__)
-    return mmap(0, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANON, -1, 0);
+    return mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
 #   else
-    return mmap(0, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
 #   endif
 }
 
@@ -106,6 +191,12 @@ void Mem::protectExecutableMemory(void *p, size_t size)
 }
 
 
+void Mem::unprotectExecutableMemory(void *p, size_t size)
+{
+    mprotect(p, size, PROT_READ | PROT_WRITE);
+}
+
+
 void Mem::flushInstructionCache(void *p, size_t size)
 {
 #   ifndef __FreeBSD__
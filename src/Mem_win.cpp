@@ -143,7 +143,8 @@ static BOOL TrySetLockPagesPrivilege() {
 }
 
 
-void Mem::init(bool enabled)
+// large pages of 1 GB can't be requested with VirtualAlloc, oneGbPages has no effect
+void Mem::init(bool enabled, bool)
 {
     m_enabled = enabled;
 
@@ -156,6 +157,7 @@ void Mem::init(bool enabled)
 void Mem::allocate(MemInfo &info, bool enabled)
 {
     info.hugePages = 0;
+    info.node      = -1;
 
     if (!enabled) {
         info.memory = static_cast<uint8_t*>(_mm_malloc(info.size, 4096));
@@ -163,7 +165,19 @@ void Mem::allocate(MemInfo &info, bool enabled)
         return;
     }
 
-    info.memory = static_cast<uint8_t*>(VirtualAlloc(nullptr, info.size, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE));
+    // large pages are committed at once, so they are requested from the node of the calling thread
+    PROCESSOR_NUMBER processor;
+    USHORT node = 0;
+    GetCurrentProcessorNumberEx(&processor);
+
+    if (GetNumaProcessorNodeEx(&processor, &node)) {
+        info.node   = static_cast<int>(node);
+        info.memory = static_cast<uint8_t*>(VirtualAllocExNuma(GetCurrentProcess(), nullptr, info.size, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE, node));
+    }
+    else {
+        info.memory = static_cast<uint8_t*>(VirtualAlloc(nullptr, info.size, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE));
+    }
+
     if (info.memory) {
         info.hugePages = info.pages;
 
@@ -187,7 +201,7 @@ void Mem::release(MemInfo &info)
 
 void *Mem::allocateExecutableMemory(size_t size)
 {
-    return VirtualAlloc(0, size, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+    return VirtualAlloc(0, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
 }
 
 
@@ -198,6 +212,13 @@ void Mem::protectExecutableMemory(void *p, size_t size)
 }
 
 
+void Mem::unprotectExecutableMemory(void *p, size_t size)
+{
+    DWORD oldProtect;
+    VirtualProtect(p, size, PAGE_READWRITE, &oldProtect);
+}
+
+
 void Mem::flushInstructionCache(void *p, size_t size)
 {
     ::FlushInstructionCache(GetCurrentProcess(), p, size);
@@ -34,6 +34,7 @@
 #endif
 
 
+#include "common/cpu/Cgroup.h"
 #include "common/cpu/Cpu.h"
 #include "common/log/Log.h"
 #include "core/Config.h"
@@ -57,6 +58,36 @@ static void print_cpu(xmrig::Config *config)
 }
 
 
+// what the container leaves to the miner, threads are already sized to it
+static void print_cgroup(xmrig::Config *config)
+{
+    if (!xmrig::Cgroup::isLimited()) {
+        return;
+    }
+
+    char quota[32]   = "none";
+    char hugetlb[32] = "none";
+
+    if (xmrig::Cgroup::cpuQuota() > 0.0) {
+        snprintf(quota, sizeof(quota), "%.2f CPUs", xmrig::Cgroup::cpuQuota());
+    }
+
+    const int64_t limit = xmrig::Cgroup::hugetlbLimit(2 * 1024 * 1024);
+    if (limit >= 0) {
+        snprintf(hugetlb, sizeof(hugetlb), "%" PRId64 " MB", limit / (1024 * 1024));
+    }
+
+    Log::i()->text(config->isColors() ? GREEN_BOLD(" * ") WHITE_BOLD("%-13s") "%d threads, cpus 0x%" PRIx64 ", quota %s, hugetlb %s"
+                                      : " * %-13s%d threads, cpus 0x%" PRIx64 ", quota %s, hugetlb %s",
+                   "CGROUP",
+                   xmrig::Cpu::info()->threads(),
+                   xmrig::Cgroup::cpuMask(),
+                   quota,
+                   hugetlb
+    );
+}
+
+
 static void print_algo(xmrig::Config *config)
 {
     Log::i()->text(config->isColors() ? GREEN_BOLD(" * ") WHITE_BOLD("%-13s%s, %sdonate=%d%%")
@@ -86,6 +117,7 @@ void Summary::print(xmrig::Controller *controller)
 {
     controller->config()->printVersions();
     print_cpu(controller->config());
+    print_cgroup(controller->config());
     print_algo(controller->config());
     controller->config()->printPools();
     controller->config()->printAPI();
@@ -41,8 +41,77 @@
 #include "common/xmrig.h"
 
 
+// architecture family, selects the defaults of auto configuration and the kernel build options
+enum GpuFamily {
+    GPU_FAMILY_OTHER,
+    GPU_FAMILY_GCN,   // AMD GCN 1-5 (up to Vega/Radeon VII), 64-wide wavefronts
+    GPU_FAMILY_RDNA   // AMD Navi (gfx10xx and newer), native 32-wide wavefronts
+};
+
+
+// device properties that do not change while the process runs, queried once by the device enumeration
+struct GpuDeviceCaps
+{
+    inline GpuDeviceCaps() :
+        maxWorkGroupSize(0),
+        maxAllocSize(0),
+        localMemSize(0),
+        memBaseAlign(0),
+        wavefrontWidth(0),
+        pciBus(-1),
+        pciDevice(-1),
+        pciFunction(-1),
+        family(GPU_FAMILY_OTHER),
+        subgroupShuffle(false),
+        amdgcnBuiltins(false)
+    {}
+
+    size_t maxWorkGroupSize;
+    size_t maxAllocSize;
+    uint64_t localMemSize;
+    uint32_t memBaseAlign;    // bytes
+    uint32_t wavefrontWidth;  // wavefront/warp width, the preferred work group multiple of our kernels, 0 if the driver does not tell
+    int pciBus;
+    int pciDevice;
+    int pciFunction;
+    GpuFamily family;
+    bool subgroupShuffle;     // cl_khr_subgroups and cl_khr_subgroup_shuffle are supported
+    bool amdgcnBuiltins;      // clang based (LC) compiler of ROCm and PAL drivers, __builtin_amdgcn_* wave intrinsics are available
+    xmrig::String driverVersion;
+};
+
+
+// resources of the kernels of the loaded program as reported by the driver, the most limiting value of all kernels
+struct GpuKernelUsage
+{
+    inline GpuKernelUsage() :
+        workGroupSize(0),
+        workGroupMultiple(0),
+        localMem(0),
+        privateMem(0)
+    {}
+
+    size_t workGroupSize;      // smallest CL_KERNEL_WORK_GROUP_SIZE, 0 if no program is loaded
+    size_t workGroupMultiple;  // largest CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE
+    uint64_t localMem;         // largest CL_KERNEL_LOCAL_MEM_SIZE
+    uint64_t privateMem;       // largest CL_KERNEL_PRIVATE_MEM_SIZE, on AMD it is the scratch memory of spilled registers
+};
+
+
 struct GpuContext
 {
+    enum Profile {
+        ProfileCn0,
+        ProfileCn00,
+        ProfileCn1,
+        ProfileCn2,
+        ProfileFinal,
+        ProfileMax
+    };
+
+    // batches in flight of a persistent thread
+    constexpr static const size_t kMaxDepth = 4;
+
     inline GpuContext() :
         deviceIdx(0),
         rawIntensity(0),
@@ -52,6 +121,15 @@ struct GpuContext
         memChunk(2),
         compMode(1),
         unrollFactor(8),
+        hashesPerItem(1),
+        buildFlags(0),
+        pipeline(false),
+        persistent(false),
+        profiling(false),
+        lowCpu(false),
+        binaryCache(false),
+        kernelsMask(0),
+        kernelsVariant(xmrig::VARIANT_AUTO),
         vendor(xmrig::OCL_VENDOR_UNKNOWN),
         threadIdx(0),
         opencl_ctx(nullptr),
@@ -60,19 +138,44 @@ struct GpuContext
         amdDriverMajorVersion(0),
         CommandQueues(nullptr),
         InputBuffer(nullptr),
+        StageBuffer(nullptr),
+        inputSlot(0),
         OutputBuffer(nullptr),
+        ResultsBuffer(nullptr),
+        Results(nullptr),
+        ControlBuffer(nullptr),
+        Control(nullptr),
         ExtraBuffers{ nullptr },
+        scratchpadsSize(0),
+        buffersIntensity(0),
+        arenaBuffers(false),
         Program(nullptr),
         Kernels{ nullptr },
         ProgramCryptonightR(nullptr),
+        ProgramFinalize(nullptr),
         freeMem(0),
         globalMem(0),
         computeUnits(0),
+        PipelineEvents{ nullptr },
+        pipelineSlot(0),
+        syncTime(0),
+        lostResults(0),
+        ProfileTimes{ 0 },
+        tdrLimit(0),
+        cn1Chunks(0),
+        cn1Items(0),
+        buildTime(0),
+        cacheHit(false),
+        swapCount(0),
+        swapTime(0),
         Nonce(0)
     {
         memset(Kernels, 0, sizeof(Kernels));
+        memset(ProfileEvents, 0, sizeof(ProfileEvents));
     }
 
+    inline size_t depth() const { return pipeline ? (persistent ? kMaxDepth : 2) : 1; }
+
     /*Input vars*/
     size_t deviceIdx;
     size_t rawIntensity;
@@ -82,6 +185,15 @@ struct GpuContext
     int memChunk;
     int compMode;
     int unrollFactor;
+    int hashesPerItem;        // hashes computed by one work item of the cn1_v2_monero kernel (cn/2, cn-pico)
+    int buildFlags;           // OclCache::BuildFlags, compiler options picked by the autotune
+    bool pipeline;
+    bool persistent;
+    bool profiling;
+    bool lowCpu;
+    bool binaryCache;
+    uint32_t kernelsMask;
+    xmrig::Variant kernelsVariant;
     xmrig::OclVendor vendor;
 
     /*Output vars*/
@@ -93,16 +205,55 @@ struct GpuContext
     int amdDriverMajorVersion;
     cl_command_queue CommandQueues;
     cl_mem InputBuffer;
+    cl_mem StageBuffer;       // the kernels read InputBuffer or StageBuffer as inputSlot says, the other one takes the next job
+    size_t inputSlot;
     cl_mem OutputBuffer;
+    cl_mem ResultsBuffer;
+    cl_uint *Results;
+    cl_mem ControlBuffer;     // pinned, Control[0] is the generation of the latest job of a persistent thread
+    cl_uint *Control;
     cl_mem ExtraBuffers[6];
+    size_t scratchpadsSize;
+    size_t buffersIntensity;
+    bool arenaBuffers;
     cl_program Program;
     cl_kernel Kernels[32];
+    GpuKernelUsage kernels;
     cl_program ProgramCryptonightR;
+    cl_program ProgramFinalize;
     size_t freeMem;
     size_t globalMem;
     cl_uint computeUnits;
     xmrig::String board;
     xmrig::String name;
+    GpuDeviceCaps caps;
+
+    /*Pipelined mode, results of the batches in flight*/
+    cl_event PipelineEvents[kMaxDepth];
+    size_t pipelineSlot;
+
+    /*Low CPU mode, moving average of the host wait for results in ns*/
+    uint64_t syncTime;
+
+    /*Results found past the last slot of the output buffer, see OCL_RESULT_SLOTS*/
+    uint64_t lostResults;
+
+    /*Profiling mode, kernel events of each pipeline slot and moving average of kernel time in ns*/
+    cl_event ProfileEvents[kMaxDepth][ProfileMax];
+    uint64_t ProfileTimes[ProfileMax];
+
+    /*--tdr-limit in ns, cn1 of cn1Items work items runs in cn1Chunks launches measured by the cn1 profiling event*/
+    uint64_t tdrLimit;
+    size_t cn1Chunks;
+    size_t cn1Items;
+
+    /*Last program load, time in ms and if it came from the binary cache*/
+    int64_t buildTime;
+    bool cacheHit;
+
+    /*CryptonightR program swaps of XMRSetJob on a new height, their count and total time in ns*/
+    uint64_t swapCount;
+    uint64_t swapTime;
 
     uint32_t Nonce;
 };
@@ -0,0 +1,200 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+
+#include "amd/GpuContext.h"
+#include "amd/GpuMemory.h"
+#include "amd/OclLib.h"
+
+
+std::map<cl_program, GpuMemory::Program> GpuMemory::m_programs;
+std::map<const GpuContext *, GpuMemory::Thread> GpuMemory::m_threads;
+std::map<size_t, GpuMemory::Device> GpuMemory::m_devices;
+std::mutex GpuMemory::m_mutex;
+
+
+size_t GpuMemory::Usage::used() const
+{
+    size_t size = 0;
+    for (size_t value : bytes) {
+        size += value;
+    }
+
+    return size;
+}
+
+
+const char *GpuMemory::name(Kind kind)
+{
+    static const char *names[KindMax] = { "buffers", "programs", "cryptonight_r", "standby" };
+
+    return names[kind];
+}
+
+
+// the driver is asked for the free memory of AMD devices outside of the lock
+std::vector<GpuMemory::Usage> GpuMemory::usage()
+{
+    std::map<size_t, Usage> devices;
+    std::map<size_t, cl_device_id> ids;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (const auto &device : m_devices) {
+            Usage &usage    = devices[device.first];
+            usage.device    = device.first;
+            usage.globalMem = device.second.globalMem;
+            usage.maxAlloc  = device.second.maxAlloc;
+            usage.bytes[Buffers] += device.second.arena;
+
+            if (device.second.vendor == xmrig::OCL_VENDOR_AMD && device.second.id) {
+                ids[device.first] = device.second.id;
+            }
+        }
+
+        for (const auto &thread : m_threads) {
+            Usage &usage = devices[thread.second.device];
+
+            usage.bytes[Buffers] += thread.second.buffers;
+            usage.scratchpads    += thread.second.scratchpads;
+            usage.largest         = std::max(usage.largest, thread.second.scratchpads);
+
+            if (thread.second.standby) {
+                usage.bytes[Standby] += thread.second.program;
+            }
+            else {
+                usage.bytes[Programs] += thread.second.program;
+                usage.threads++;
+            }
+        }
+
+        for (const auto &program : m_programs) {
+            devices[program.second.device].bytes[program.second.kind] += program.second.size;
+        }
+    }
+
+    std::vector<Usage> out;
+    out.reserve(devices.size());
+
+    for (auto &device : devices) {
+        const auto it = ids.find(device.first);
+        size_t free[2] = { 0, 0 };
+
+        if (it != ids.end() && OclLib::getDeviceInfo(it->second, 0x4039 /* CL_DEVICE_GLOBAL_FREE_MEMORY_AMD */, sizeof(free), free) == CL_SUCCESS) {
+            device.second.driverFree = static_cast<int64_t>(free[0]) * 1024;
+        }
+
+        out.push_back(device.second);
+    }
+
+    return out;
+}
+
+
+// a shared program, the finalize program of a device or a program of the CryptonightR cache
+void GpuMemory::add(cl_program program, size_t device, Kind kind)
+{
+    if (program == nullptr) {
+        return;
+    }
+
+    const size_t size = programSize(program);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_programs[program] = { device, size, kind };
+}
+
+
+void GpuMemory::release(cl_program program)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_programs.erase(program);
+}
+
+
+void GpuMemory::remove(const GpuContext *ctx)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_threads.erase(ctx);
+}
+
+
+void GpuMemory::setArena(size_t device, size_t size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_devices[device].arena = size;
+}
+
+
+// buffers are counted by OclGPU which knows their layout, sub-buffers of an arena are left out by it,
+// a standby context which was never initialized doesn't know its device yet
+void GpuMemory::setThread(const GpuContext *ctx, size_t buffers, bool standby)
+{
+    const size_t program = programSize(ctx->Program);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Device &device = m_devices[ctx->deviceIdx];
+    if (ctx->globalMem) {
+        device.id        = ctx->DeviceID;
+        device.vendor    = ctx->vendor;
+        device.globalMem = ctx->globalMem;
+        device.maxAlloc  = ctx->caps.maxAllocSize;
+    }
+
+    m_threads[ctx] = { ctx->deviceIdx, buffers, ctx->ExtraBuffers[0] ? ctx->scratchpadsSize : 0, program, standby };
+}
+
+
+// programs are built for one device, the binary sizes of the other devices of the context are 0
+size_t GpuMemory::programSize(cl_program program)
+{
+    if (program == nullptr) {
+        return 0;
+    }
+
+    cl_uint count = 0;
+    if (OclLib::getProgramInfo(program, CL_PROGRAM_NUM_DEVICES, sizeof(count), &count) != CL_SUCCESS || count == 0) {
+        return 0;
+    }
+
+    std::vector<size_t> sizes(count, 0);
+    if (OclLib::getProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(size_t) * sizes.size(), sizes.data()) != CL_SUCCESS) {
+        return 0;
+    }
+
+    size_t size = 0;
+    for (size_t value : sizes) {
+        size += value;
+    }
+
+    return size;
+}
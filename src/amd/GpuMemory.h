@@ -0,0 +1,125 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_GPUMEMORY_H
+#define XMRIG_GPUMEMORY_H
+
+
+#if defined(__APPLE__)
+#   include <OpenCL/cl.h>
+#else
+#   include "3rdparty/CL/cl.h"
+#endif
+
+
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+
+#include "common/xmrig.h"
+
+
+struct GpuContext;
+
+
+// device memory the miner holds on each GPU by the GPU index of the config: buffers of the threads and the arenas,
+// programs of the threads and the shared finalize programs, the CryptonightR program cache and the programs kept
+// by idle threads of the standby perf algo. OclGPU records a thread context whenever its buffers or program change,
+// from the worker threads or the loop, read by the API. Sizes are what was requested from the driver (programs by
+// their binary size), pinned host memory of the results is not counted
+class GpuMemory
+{
+public:
+    enum Kind {
+        Buffers,
+        Programs,
+        CryptonightR,
+        Standby,
+        KindMax
+    };
+
+    struct Usage
+    {
+        inline Usage() : device(0), globalMem(0), maxAlloc(0), driverFree(-1), bytes(), threads(0), scratchpads(0), largest(0) {}
+
+        size_t used() const;
+
+        size_t device;
+        size_t globalMem;
+        size_t maxAlloc;
+        int64_t driverFree;     // CL_DEVICE_GLOBAL_FREE_MEMORY_AMD, -1 on other vendors
+        size_t bytes[KindMax];
+        size_t threads;         // running threads, idle standby threads are not counted
+        size_t scratchpads;     // part of the buffers
+        size_t largest;         // largest scratchpads buffer of a thread, limited by maxAlloc
+    };
+
+    static const char *name(Kind kind);
+    static std::vector<Usage> usage();
+    static void add(cl_program program, size_t device, Kind kind);
+    static void release(cl_program program);
+    static void remove(const GpuContext *ctx);
+    static void setArena(size_t device, size_t size);
+    static void setThread(const GpuContext *ctx, size_t buffers, bool standby);
+
+private:
+    struct Device
+    {
+        inline Device() : id(nullptr), vendor(xmrig::OCL_VENDOR_UNKNOWN), globalMem(0), maxAlloc(0), arena(0) {}
+
+        cl_device_id id;
+        xmrig::OclVendor vendor;
+        size_t globalMem;
+        size_t maxAlloc;
+        size_t arena;
+    };
+
+    struct Program
+    {
+        size_t device;
+        size_t size;
+        Kind kind;
+    };
+
+    struct Thread
+    {
+        size_t device;
+        size_t buffers;
+        size_t scratchpads;
+        size_t program;
+        bool standby;
+    };
+
+    static size_t programSize(cl_program program);
+
+    static std::map<cl_program, Program> m_programs;
+    static std::map<const GpuContext *, Thread> m_threads;
+    static std::map<size_t, Device> m_devices;
+    static std::mutex m_mutex;
+};
+
+
+#endif /* XMRIG_GPUMEMORY_H */
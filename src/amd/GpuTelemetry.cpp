@@ -0,0 +1,184 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <uv.h>
+
+
+#include "amd/GpuContext.h"
+#include "amd/GpuTelemetry.h"
+#include "common/log/Log.h"
+
+
+std::map<size_t, GpuTelemetry::Device> GpuTelemetry::m_devices;
+GpuTelemetry::Scan *GpuTelemetry::m_scan = nullptr;
+std::map<uint64_t, GpuTelemetry::Client> GpuTelemetry::m_clients;
+uint64_t GpuTelemetry::m_clientsSampled = 0;
+
+
+// unchanged profiles are not written again, a GPU without the sysfs files or privileges is logged once
+bool GpuTelemetry::setClocks(size_t deviceIdx, const GpuClocks &clocks)
+{
+    const auto it = m_devices.find(deviceIdx);
+    if (it == m_devices.end()) {
+        return false;
+    }
+
+    Device &device = it->second;
+    if (device.clocks == clocks) {
+        return true;
+    }
+
+    if (!write(device, clocks)) {
+        if (!device.failed) {
+            LOG_WARN("GPU #%zu: clock profile can't be applied, it needs root and the overdrive of amdgpu (amdgpu.ppfeaturemask)", deviceIdx);
+            device.failed = true;
+        }
+
+        return false;
+    }
+
+    device.clocks = clocks;
+
+    if (clocks.isDefault()) {
+        LOG_INFO("GPU #%zu: default clocks restored", deviceIdx);
+    }
+    else {
+        LOG_INFO("GPU #%zu: power cap %d W, core clock %d MHz, memory clock %d MHz", deviceIdx, clocks.powerCap, clocks.coreClock, clocks.memoryClock);
+    }
+
+    return true;
+}
+
+
+GpuSensors GpuTelemetry::sensors(size_t deviceIdx)
+{
+    const auto it = m_devices.find(deviceIdx);
+
+    return it != m_devices.end() ? it->second.sensors : GpuSensors();
+}
+
+
+// devices without a PCI bus ID or sensors are tried again the next time the contexts are initialized
+void GpuTelemetry::add(const GpuContext *ctx)
+{
+    if (ctx->caps.pciBus < 0 || m_devices.count(ctx->deviceIdx)) {
+        return;
+    }
+
+    Device device;
+    if (!open(ctx, device)) {
+        return;
+    }
+
+    read(device);
+    m_devices[ctx->deviceIdx] = device;
+
+    LOG_DEBUG("GPU #%zu: sensors found at %s", ctx->deviceIdx, device.path.c_str());
+}
+
+
+int GpuTelemetry::defaultPowerCap(size_t deviceIdx)
+{
+    const auto it = m_devices.find(deviceIdx);
+
+    return it != m_devices.end() ? it->second.defaultCap : 0;
+}
+
+
+// the GPUs get the driver defaults back before they are forgotten, so the next miner or algo starts from them
+void GpuTelemetry::clear()
+{
+    for (auto &device : m_devices) {
+        if (!device.second.clocks.isDefault()) {
+            write(device.second, GpuClocks());
+        }
+    }
+
+    m_devices.clear();
+}
+
+
+// the clients are listed by a file per descriptor of every process, that would block the loop on a busy
+// desktop, so they are scanned on the thread pool and an update is skipped while a scan still runs
+void GpuTelemetry::update(bool clients)
+{
+    for (auto &device : m_devices) {
+        read(device.second);
+    }
+
+    if (!clients || m_scan) {
+        return;
+    }
+
+    m_scan = new Scan();
+    uv_queue_work(uv_default_loop(), &m_scan->req, GpuTelemetry::onScan, GpuTelemetry::onScanDone);
+}
+
+
+void GpuTelemetry::onScan(uv_work_t *req)
+{
+    Scan *scan = static_cast<Scan *>(req->data);
+
+    scan->ok   = clients(scan->clients);
+    scan->time = uv_hrtime();
+}
+
+
+// the share of other clients needs two samples, a client seen for the first time only counts from the next one,
+// it stays unknown where the platform can't list the clients
+void GpuTelemetry::onScanDone(uv_work_t *req, int status)
+{
+    Scan *scan = static_cast<Scan *>(req->data);
+    m_scan     = nullptr;
+
+    if (status != 0 || !scan->ok) {
+        delete scan;
+        return;
+    }
+
+    std::map<uint64_t, Client> current = std::move(scan->clients);
+    const uint64_t now                 = scan->time;
+    delete scan;
+
+    const uint64_t elapsed = m_clientsSampled && now > m_clientsSampled ? now - m_clientsSampled : 0;
+
+    std::map<std::string, uint64_t> busy;
+    for (const auto &client : current) {
+        const auto it = m_clients.find(client.first);
+        if (it != m_clients.end() && client.second.time > it->second.time) {
+            busy[client.second.pci] += client.second.time - it->second.time;
+        }
+    }
+
+    if (elapsed) {
+        for (auto &device : m_devices) {
+            device.second.sensors.clients = std::min(1.0, static_cast<double>(busy[device.second.pci]) / elapsed);
+        }
+    }
+
+    m_clients        = std::move(current);
+    m_clientsSampled = now;
+}
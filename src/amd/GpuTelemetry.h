@@ -0,0 +1,138 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_GPUTELEMETRY_H
+#define XMRIG_GPUTELEMETRY_H
+
+
+#include <cmath>
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <uv.h>
+
+
+struct GpuContext;
+
+
+// sensor readings of one GPU, negative values are not available on the device or platform
+struct GpuSensors
+{
+    inline GpuSensors() : temperature(-1.0), power(-1.0), clients(-1.0), gfxBusy(-1.0), memoryBusy(-1.0), fan(-1), clock(-1), memoryClock(-1) {}
+
+    inline bool isValid() const                          { return temperature >= 0.0 || power >= 0.0 || gfxBusy >= 0.0 || memoryBusy >= 0.0 || fan >= 0 || clock >= 0 || memoryClock >= 0; }
+    inline double hashesPerJoule(double hashrate) const { return power > 0.0 && std::isnormal(hashrate) ? hashrate / power : 0.0; }
+
+    double temperature; // edge temperature in C
+    double power;       // average board power in W
+    double clients;     // share of the time the graphics engine ran for other processes since the last update
+    double gfxBusy;     // share of the time the graphics engine was busy, moving average of the counter of the driver
+    double memoryBusy;  // share of the time the memory controller was busy, how close the GPU is to its memory bandwidth
+    int fan;            // fan speed in RPM
+    int clock;          // shader clock in MHz
+    int memoryClock;    // memory clock in MHz
+};
+
+
+// clock profile of one GPU, 0 leaves the driver default
+struct GpuClocks
+{
+    inline GpuClocks() : powerCap(0), coreClock(0), memoryClock(0) {}
+    inline GpuClocks(int powerCap, int coreClock, int memoryClock) : powerCap(powerCap), coreClock(coreClock), memoryClock(memoryClock) {}
+
+    inline bool isDefault() const                        { return powerCap == 0 && coreClock == 0 && memoryClock == 0; }
+    inline bool operator==(const GpuClocks &other) const { return powerCap == other.powerCap && coreClock == other.coreClock && memoryClock == other.memoryClock; }
+    inline bool operator!=(const GpuClocks &other) const { return !(*this == other); }
+
+    int powerCap;    // board power limit in W
+    int coreClock;   // highest shader clock state in MHz
+    int memoryClock; // highest memory clock state in MHz
+};
+
+
+// sensors of the GPUs by the GPU index of the config, a device is found through the PCI bus ID
+// of its OpenCL device: hwmon of the amdgpu driver on Linux, other platforms don't report yet,
+// devices are added and polled by Workers on the uv loop, so there is no locking, with clients the graphics engine
+// time other processes used on the device is sampled too (DRM fdinfo of amdgpu on Linux), see --desktop-duty,
+// that scan runs on the uv thread pool and its result is applied on the loop,
+// localCpus() is the mask of CPUs on the NUMA node of the device PCIe root (sysfs on Linux), 0 if unknown,
+// setClocks() applies the clock profile of the running perf algo (amdgpu sysfs on Linux, needs root), clear() restores the defaults
+class GpuTelemetry
+{
+public:
+    static bool setClocks(size_t deviceIdx, const GpuClocks &clocks);
+    static GpuSensors sensors(size_t deviceIdx);
+    static int defaultPowerCap(size_t deviceIdx);
+    static uint64_t localCpus(const GpuContext *ctx);
+    static void add(const GpuContext *ctx);
+    static void clear();
+    static void update(bool clients = false);
+
+private:
+    struct Device
+    {
+        inline Device() : defaultCap(0), failed(false) {}
+
+        std::string path;
+        std::string pci;    // PCI address like 0000:03:00.0
+        std::string sysfs;  // sysfs directory of the PCI device
+        GpuClocks clocks;   // applied clock profile
+        GpuSensors sensors;
+        int defaultCap;     // board power limit of the driver in W, 0 if it can't be changed
+        bool failed;        // a clock profile could not be applied, logged once
+    };
+
+    // an open DRM file of another process, time is what the graphics engine ran for it in ns
+    struct Client
+    {
+        std::string pci;
+        uint64_t time;
+    };
+
+    // a scan of the clients on the thread pool, time is when it finished
+    struct Scan
+    {
+        inline Scan() : time(0), ok(false) { req.data = this; }
+
+        uv_work_t req;
+        std::map<uint64_t, Client> clients;
+        uint64_t time;
+        bool ok;
+    };
+
+    static bool clients(std::map<uint64_t, Client> &clients);
+    static bool open(const GpuContext *ctx, Device &device);
+    static bool write(Device &device, const GpuClocks &clocks);
+    static void onScan(uv_work_t *req);
+    static void onScanDone(uv_work_t *req, int status);
+    static void read(Device &device);
+
+    static Scan *m_scan;
+    static std::map<size_t, Device> m_devices;
+    static std::map<uint64_t, Client> m_clients;
+    static uint64_t m_clientsSampled;
+};
+
+
+#endif /* XMRIG_GPUTELEMETRY_H */
@@ -0,0 +1,336 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <dirent.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <uv.h>
+
+
+#include "amd/GpuContext.h"
+#include "amd/GpuTelemetry.h"
+
+
+// first directory entry starting with prefix, empty if there is none
+static std::string findEntry(const std::string &dir, const char *prefix)
+{
+    uv_fs_t req;
+    if (uv_fs_scandir(uv_default_loop(), &req, dir.c_str(), 0, nullptr) < 0) {
+        uv_fs_req_cleanup(&req);
+        return std::string();
+    }
+
+    std::string result;
+    uv_dirent_t ent;
+    while (uv_fs_scandir_next(&req, &ent) != UV_EOF) {
+        if (strncmp(ent.name, prefix, strlen(prefix)) == 0) {
+            result = ent.name;
+            break;
+        }
+    }
+
+    uv_fs_req_cleanup(&req);
+    return result;
+}
+
+
+static bool readValue(const std::string &path, const char *name, int64_t &value)
+{
+    FILE *fp = fopen((path + name).c_str(), "r");
+    if (!fp) {
+        return false;
+    }
+
+    const bool result = fscanf(fp, "%" SCNd64, &value) == 1;
+    fclose(fp);
+
+    return result;
+}
+
+
+// sysfs reports a rejected value when the file is flushed, so fclose is checked too
+static bool writeValue(const std::string &path, const char *name, const char *value)
+{
+    FILE *fp = fopen((path + name).c_str(), "w");
+    if (!fp) {
+        return false;
+    }
+
+    const bool result = fputs(value, fp) >= 0;
+
+    return fclose(fp) == 0 && result;
+}
+
+
+// the PCI domain is not reported by OpenCL, so the first domain with a matching bus:device.function is taken
+static std::string pciPath(const GpuContext *ctx)
+{
+    char address[16];
+    snprintf(address, sizeof(address), ":%02x:%02x.%x", ctx->caps.pciBus, ctx->caps.pciDevice, ctx->caps.pciFunction);
+
+    const std::string devices = "/sys/bus/pci/devices/";
+
+    uv_fs_t req;
+    if (uv_fs_scandir(uv_default_loop(), &req, devices.c_str(), 0, nullptr) < 0) {
+        uv_fs_req_cleanup(&req);
+        return std::string();
+    }
+
+    std::string pci;
+    uv_dirent_t ent;
+    while (uv_fs_scandir_next(&req, &ent) != UV_EOF) {
+        const size_t length = strlen(ent.name);
+        if (length > strlen(address) && strcmp(ent.name + length - strlen(address), address) == 0) {
+            pci = devices + ent.name;
+            break;
+        }
+    }
+
+    uv_fs_req_cleanup(&req);
+    return pci;
+}
+
+
+bool GpuTelemetry::open(const GpuContext *ctx, Device &device)
+{
+    const std::string pci = pciPath(ctx);
+    if (pci.empty()) {
+        return false;
+    }
+
+    const std::string hwmon = findEntry(pci + "/hwmon", "hwmon");
+    if (hwmon.empty()) {
+        return false;
+    }
+
+    device.path  = pci + "/hwmon/" + hwmon + "/";
+    device.pci   = pci.substr(pci.rfind('/') + 1);
+    device.sysfs = pci + "/";
+
+    int64_t cap = 0;
+    if (readValue(device.path, "power1_cap_default", cap) || readValue(device.path, "power1_cap", cap)) {
+        device.defaultCap = static_cast<int>(cap / 1000000);
+    }
+
+    return true;
+}
+
+
+// amdgpu takes the power cap in µW, the overdrive table sets the highest shader and memory clock states
+// ("s 1" and "m 1" of Vega20 and newer) and is only used at the manual performance level, "r" resets the table
+bool GpuTelemetry::write(Device &device, const GpuClocks &clocks)
+{
+    if (clocks.powerCap != device.clocks.powerCap) {
+        const int cap = clocks.powerCap > 0 ? clocks.powerCap : device.defaultCap;
+        if (cap <= 0 || !writeValue(device.path, "power1_cap", std::to_string(static_cast<int64_t>(cap) * 1000000).c_str())) {
+            return false;
+        }
+    }
+
+    if (clocks.coreClock == device.clocks.coreClock && clocks.memoryClock == device.clocks.memoryClock) {
+        return true;
+    }
+
+    if (clocks.coreClock == 0 && clocks.memoryClock == 0) {
+        return writeValue(device.sysfs, "pp_od_clk_voltage", "r") && writeValue(device.sysfs, "pp_od_clk_voltage", "c") &&
+               writeValue(device.sysfs, "power_dpm_force_performance_level", "auto");
+    }
+
+    if (!writeValue(device.sysfs, "power_dpm_force_performance_level", "manual") || !writeValue(device.sysfs, "pp_od_clk_voltage", "r")) {
+        return false;
+    }
+
+    char command[32];
+    if (clocks.coreClock > 0) {
+        snprintf(command, sizeof(command), "s 1 %d", clocks.coreClock);
+        if (!writeValue(device.sysfs, "pp_od_clk_voltage", command)) {
+            return false;
+        }
+    }
+
+    if (clocks.memoryClock > 0) {
+        snprintf(command, sizeof(command), "m 1 %d", clocks.memoryClock);
+        if (!writeValue(device.sysfs, "pp_od_clk_voltage", command)) {
+            return false;
+        }
+    }
+
+    return writeValue(device.sysfs, "pp_od_clk_voltage", "c");
+}
+
+
+// DRM fdinfo of the amdgpu driver (Linux 5.14+), only files of /dev/dri are read, processes of other users
+// can't be read without privileges, a client shared by several descriptors is counted once by its id,
+// runs on the uv thread pool, so it doesn't touch the loop or the devices
+bool GpuTelemetry::clients(std::map<uint64_t, Client> &clients)
+{
+    DIR *proc = opendir("/proc");
+    if (!proc) {
+        return false;
+    }
+
+    const long self = static_cast<long>(getpid());
+    dirent *ent;
+
+    while ((ent = readdir(proc)) != nullptr) {
+        char *end      = nullptr;
+        const long pid = strtol(ent->d_name, &end, 10);
+        if (*end != '\0' || pid <= 0 || pid == self) {
+            continue;
+        }
+
+        const std::string dir = std::string("/proc/") + ent->d_name;
+
+        DIR *fds = opendir((dir + "/fd").c_str());
+        if (!fds) {
+            continue;
+        }
+
+        dirent *fd;
+        while ((fd = readdir(fds)) != nullptr) {
+            char link[64] = { 0 };
+            if (fd->d_name[0] == '.' || readlink((dir + "/fd/" + fd->d_name).c_str(), link, sizeof(link) - 1) <= 0 || strncmp(link, "/dev/dri/", 9) != 0) {
+                continue;
+            }
+
+            FILE *fp = fopen((dir + "/fdinfo/" + fd->d_name).c_str(), "r");
+            if (!fp) {
+                continue;
+            }
+
+            char line[256];
+            char pci[32]  = { 0 };
+            uint64_t id   = 0;
+            uint64_t time = 0;
+
+            while (fgets(line, sizeof(line), fp)) {
+                if (sscanf(line, "drm-client-id: %" SCNu64, &id) == 1 || sscanf(line, "drm-pdev: %31s", pci) == 1) {
+                    continue;
+                }
+
+                sscanf(line, "drm-engine-gfx: %" SCNu64, &time);
+            }
+
+            fclose(fp);
+
+            if (id && pci[0]) {
+                clients[id] = { pci, time };
+            }
+        }
+
+        closedir(fds);
+    }
+
+    closedir(proc);
+    return true;
+}
+
+
+// local_cpulist of the device is the CPU list of the NUMA node of its PCIe root complex, like "0-15,32-47"
+uint64_t GpuTelemetry::localCpus(const GpuContext *ctx)
+{
+    if (ctx->caps.pciBus < 0) {
+        return 0;
+    }
+
+    const std::string pci = pciPath(ctx);
+    if (pci.empty()) {
+        return 0;
+    }
+
+    FILE *fp = fopen((pci + "/local_cpulist").c_str(), "r");
+    if (!fp) {
+        return 0;
+    }
+
+    char list[256] = { 0 };
+    const bool result = fgets(list, sizeof(list), fp) != nullptr;
+    fclose(fp);
+
+    if (!result) {
+        return 0;
+    }
+
+    uint64_t mask = 0;
+    const char *p = list;
+
+    while (*p >= '0' && *p <= '9') {
+        char *end        = nullptr;
+        const long first = strtol(p, &end, 10);
+        long last        = first;
+
+        if (*end == '-') {
+            last = strtol(end + 1, &end, 10);
+        }
+
+        for (long cpu = first; cpu <= last && cpu < 64; ++cpu) {
+            mask |= 1ULL << cpu;
+        }
+
+        p = *end == ',' ? end + 1 : end;
+    }
+
+    return mask;
+}
+
+
+// busy counters of amdgpu are sampled by the firmware over a short window, so they are smoothed over the 2 second updates
+static double busy(const std::string &path, const char *name, double previous)
+{
+    int64_t value = 0;
+    if (!readValue(path, name, value)) {
+        return -1.0;
+    }
+
+    const double current = std::min(static_cast<double>(value), 100.0) / 100.0;
+
+    return previous >= 0.0 ? previous + (current - previous) * 0.25 : current;
+}
+
+
+// amdgpu reports m°C, µW, RPM and Hz, power1_input replaces power1_average on newer GPUs,
+// gpu_busy_percent and mem_busy_percent (Vega and newer) are the activity of the graphics engine and memory controller
+void GpuTelemetry::read(Device &device)
+{
+    GpuSensors &sensors = device.sensors;
+    int64_t value       = 0;
+
+    sensors.temperature = readValue(device.path, "temp1_input", value) ? static_cast<double>(value) / 1000.0 : -1.0;
+    sensors.fan         = readValue(device.path, "fan1_input", value) ? static_cast<int>(value) : -1;
+    sensors.clock       = readValue(device.path, "freq1_input", value) ? static_cast<int>(value / 1000000) : -1;
+    sensors.memoryClock = readValue(device.path, "freq2_input", value) ? static_cast<int>(value / 1000000) : -1;
+    sensors.gfxBusy     = busy(device.sysfs, "gpu_busy_percent", sensors.gfxBusy);
+    sensors.memoryBusy  = busy(device.sysfs, "mem_busy_percent", sensors.memoryBusy);
+
+    if (readValue(device.path, "power1_average", value) || readValue(device.path, "power1_input", value)) {
+        sensors.power = static_cast<double>(value) / 1e6;
+    }
+    else {
+        sensors.power = -1.0;
+    }
+}
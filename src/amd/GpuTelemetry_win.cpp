@@ -0,0 +1,58 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "amd/GpuTelemetry.h"
+
+
+// sensors on Windows need ADL, which is not linked yet
+bool GpuTelemetry::open(const GpuContext *, Device &)
+{
+    return false;
+}
+
+
+// clocks and power limits need the overdrive of ADL too
+bool GpuTelemetry::write(Device &, const GpuClocks &)
+{
+    return false;
+}
+
+
+void GpuTelemetry::read(Device &)
+{
+}
+
+
+// the GPU time of other processes needs the D3DKMT statistics, input idle time tells about the desktop instead
+bool GpuTelemetry::clients(std::map<uint64_t, Client> &)
+{
+    return false;
+}
+
+
+uint64_t GpuTelemetry::localCpus(const GpuContext *)
+{
+    return 0;
+}
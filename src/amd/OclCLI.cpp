@@ -31,8 +31,10 @@
 
 
 #include "amd/cryptonight.h"
+#include "amd/OclCache.h"
 #include "amd/OclCLI.h"
 #include "amd/OclGPU.h"
+#include "amd/OclProfiles.h"
 #include "common/log/Log.h"
 #include "core/Config.h"
 #include "crypto/CryptoNight_constants.h"
@@ -64,14 +66,16 @@ bool OclCLI::setup(std::vector<xmrig::IThread *> &threads)
 }
 
 
-void OclCLI::autoConf(std::vector<xmrig::IThread *> &threads, const xmrig::Algorithm& algorithm, xmrig::Config *config)
+bool OclCLI::autoConf(std::vector<xmrig::IThread *> &threads, const xmrig::Algorithm& algorithm, xmrig::Config *config, xmrig::PerfAlgo source)
 {
     std::vector<GpuContext> devices = OclGPU::getDevices(config);
     if (devices.empty()) {
         LOG_ERR("No devices found.");
-        return;
+        return false;
     }
 
+    bool derived = false;
+
     const xmrig::Algo algo   = algorithm.algo();
     const size_t hashMemSize = xmrig::cn_select_memory(algo);
 
@@ -81,6 +85,15 @@ void OclCLI::autoConf(std::vector<xmrig::IThread *> &threads, const xmrig::Algor
             continue;
         }
 
+        if (OclProfiles::find(ctx, algorithm.perf_algo(), threads)) {
+            continue;
+        }
+
+        if (source != xmrig::PA_INVALID && derive(ctx, algorithm, source, config, threads)) {
+            derived = true;
+            continue;
+        }
+
         int hints = getHints(ctx, config);
         if (algorithm.algo() == xmrig::CRYPTONIGHT && algorithm.variant() == xmrig::VARIANT_2) hints |= CNv2;
 
@@ -89,7 +102,7 @@ void OclCLI::autoConf(std::vector<xmrig::IThread *> &threads, const xmrig::Algor
         const size_t computeUnits = static_cast<size_t>(ctx.computeUnits);
 
         size_t intensity = 0;
-        if (hints & Vega) {
+        if (hints & (Vega | RDNA)) {
             if (algo == xmrig::CRYPTONIGHT_HEAVY && computeUnits == 64 && maxIntensity > 976) {
                 intensity = 976;
             }
@@ -128,6 +141,8 @@ void OclCLI::autoConf(std::vector<xmrig::IThread *> &threads, const xmrig::Algor
            threads.push_back(createThread(ctx, intensity, hints));
         }
     }
+
+    return derived;
 }
 
 
@@ -183,6 +198,56 @@ int OclCLI::get(const std::vector<int> &vector, size_t index, int defaultValue)
 }
 
 
+// the threads of the GPU on the source perf algo keep their scratchpad footprint: the intensity scales with the
+// scratchpad size and is rounded down to the compute units and the worksize, the other settings are taken as they are
+bool OclCLI::derive(const GpuContext &ctx, const xmrig::Algorithm &algorithm, xmrig::PerfAlgo source, xmrig::Config *config, std::vector<xmrig::IThread *> &threads) const
+{
+    const size_t sourceMemory = xmrig::cn_select_memory(xmrig::Algorithm(source).algo());
+    const size_t hashMemSize  = xmrig::cn_select_memory(algorithm.algo());
+    const size_t computeUnits = std::max<size_t>(static_cast<size_t>(ctx.computeUnits), 1);
+    const size_t count        = threads.size();
+
+    for (const xmrig::IThread *thread : config->threads(source)) {
+        const xmrig::OclThread *tuned = static_cast<const xmrig::OclThread *>(thread);
+        if (tuned->platform() != nullptr || tuned->index() != ctx.deviceIdx) {
+            continue;
+        }
+
+        size_t intensity = getPossibleIntensity(ctx, tuned->intensity() * sourceMemory / hashMemSize, hashMemSize);
+        intensity = intensity / computeUnits * computeUnits;
+        intensity -= intensity % tuned->worksize();
+
+        if (intensity == 0) {
+            continue;
+        }
+
+        int buildFlags = tuned->buildFlags();
+        if (!OclCache::isRelaxedMath(algorithm.variant())) {
+            buildFlags &= ~OclCache::BUILD_RELAXED_MATH;
+        }
+
+        xmrig::OclThread *derived = new xmrig::OclThread(ctx.deviceIdx, intensity, tuned->worksize(), tuned->affinity());
+        derived->setStridedIndex(tuned->stridedIndex() == 1 && algorithm.variant() >= xmrig::VARIANT_2 ? 2 : tuned->stridedIndex());
+        derived->setMemChunk(tuned->memChunk());
+        derived->setUnrollFactor(tuned->unrollFactor());
+        derived->setCompMode(tuned->isCompMode());
+        derived->setPipeline(tuned->isPipeline());
+        derived->setPersistent(tuned->isPersistent());
+        derived->setHashesPerItem(tuned->hashesPerItem());
+        derived->setBuildFlags(buildFlags);
+
+        threads.push_back(derived);
+    }
+
+    if (threads.size() == count) {
+        return false;
+    }
+
+    LOG_INFO("GPU #%zu %s threads derived from %s", ctx.deviceIdx, xmrig::Algorithm::perfAlgoName(algorithm.perf_algo()), xmrig::Algorithm::perfAlgoName(source));
+    return true;
+}
+
+
 int OclCLI::getHints(const GpuContext &ctx, xmrig::Config *config) const
 {
     int hints = None;
@@ -204,20 +269,28 @@ int OclCLI::getHints(const GpuContext &ctx, xmrig::Config *config) const
         hints |= DoubleThreads;
     }
 
+    if (ctx.caps.family == GPU_FAMILY_RDNA) {
+        hints |= RDNA;
+    }
+
     return hints;
 }
 
 
 xmrig::OclThread *OclCLI::createThread(const GpuContext &ctx, size_t intensity, int hints) const
 {
-    const size_t worksize = worksizeByHints(hints);
+    size_t worksize = worksizeByHints(hints);
+    if (ctx.caps.maxWorkGroupSize > 0 && worksize > ctx.caps.maxWorkGroupSize) {
+        worksize = ctx.caps.maxWorkGroupSize;
+    }
+
     intensity -= intensity % worksize;
 
     int stridedIndex = 1;
     if (ctx.vendor == xmrig::OCL_VENDOR_NVIDIA) {
         stridedIndex = 0;
     }
-    else if (hints & CNv2) {
+    else if (hints & (CNv2 | RDNA)) {
         stridedIndex = 2;
     }
 
@@ -225,7 +298,7 @@ xmrig::OclThread *OclCLI::createThread(const GpuContext &ctx, size_t intensity,
     thread->setStridedIndex(stridedIndex);
     thread->setCompMode(false);
 
-    if ((hints & Vega) && (hints & CNv2)) {
+    if ((hints & (Vega | RDNA)) && (hints & CNv2)) {
         thread->setMemChunk(1);
     }
 
@@ -298,5 +371,16 @@ size_t OclCLI::worksizeByHints(int hints)
         }
     }
 
+    // a work group of 32 fills one wave32 wavefront
+    if (hints & RDNA) {
+        if (hints & Pico) {
+            return 32;
+        }
+
+        if (hints & CNv2) {
+            return 16;
+        }
+    }
+
     return 8;
 }
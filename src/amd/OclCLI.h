@@ -50,8 +50,8 @@ public:
     OclCLI();
 
     bool setup(std::vector<xmrig::IThread *> &threads);
-    // autoConf now takes Algorithm parameter as input
-    void autoConf(std::vector<xmrig::IThread *> &threads, const xmrig::Algorithm&, xmrig::Config *config);
+    // autoConf now takes Algorithm parameter as input, it returns true if threads of any GPU were derived from the source perf algo
+    bool autoConf(std::vector<xmrig::IThread *> &threads, const xmrig::Algorithm&, xmrig::Config *config, xmrig::PerfAlgo source = xmrig::PA_INVALID);
     void parseLaunch(const char *arg);
 
     inline void parseAffinity(const char *arg)     { parse(m_affinity, arg); }
@@ -67,7 +67,8 @@ private:
         DoubleThreads = 1,
         Vega          = 2,
         CNv2          = 4,
-        Pico          = 8
+        Pico          = 8,
+        RDNA          = 16
     };
 
     inline bool isEmpty() const                 { return m_devices.empty() && m_intensity.empty(); }
@@ -80,6 +81,7 @@ private:
     inline int worksize(size_t index) const     { return get(m_worksize, index, 8); }
 
     int get(const std::vector<int> &vector, size_t index, int defaultValue) const;
+    bool derive(const GpuContext &ctx, const xmrig::Algorithm &algorithm, xmrig::PerfAlgo source, xmrig::Config *config, std::vector<xmrig::IThread *> &threads) const;
     int getHints(const GpuContext &ctx, xmrig::Config *config) const;
     xmrig::OclThread *createThread(const GpuContext &ctx, size_t intensity, int hints) const;
     void parse(std::vector<int> &vector, const char *arg) const;
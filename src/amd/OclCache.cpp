@@ -23,21 +23,336 @@
  */
 
 
+#include <condition_variable>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
-#include <sstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string.h>
+#include <thread>
+#include <uv.h>
 
 
 #include "amd/OclCache.h"
 #include "amd/OclError.h"
+#include "amd/OclGPU.h"
 #include "amd/OclLib.h"
+#include "base/io/Json.h"
 #include "base32/base32.h"
 #include "common/cpu/Cpu.h"
 #include "common/crypto/keccak.h"
 #include "common/log/Log.h"
+#include "common/Platform.h"
 #include "common/utils/timestamp.h"
 #include "core/Config.h"
+#include "core/StartupProfile.h"
+#include "core/Trace.h"
 #include "crypto/CryptoNight_constants.h"
+#include "rapidjson/document.h"
+
+
+// devices are initialized in parallel and identical devices share the same cache file,
+// the first one compiles and saves it, others wait and load the binary
+static std::mutex &cacheFileMutex(const std::string &fileName)
+{
+    static std::mutex mutex;
+    static std::map<std::string, std::mutex> mutexes;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return mutexes[fileName];
+}
+
+
+// binaries of freshly compiled programs are fetched and written by one background thread, so a GPU starts hashing
+// right after its build; a device sharing the cache file waits in build() until the write is done and loads it
+struct WriteTask
+{
+    cl_program program;
+    cl_device_id device;
+    std::string fileName;
+};
+
+
+static std::mutex writeMutex;
+static std::condition_variable writeCv;
+static std::vector<WriteTask> writeTasks;
+static std::set<std::string> writePending;
+static std::thread *writeThread = nullptr;
+
+
+static void writeThreadProc()
+{
+    xmrig::Trace::setThreadName("OpenCL cache");
+    Platform::setThreadPriority(1);
+
+    for (;;) {
+        std::unique_lock<std::mutex> lock(writeMutex);
+        writeCv.wait(lock, []() { return !writeTasks.empty(); });
+
+        const WriteTask task = writeTasks.front();
+        writeTasks.erase(writeTasks.begin());
+        lock.unlock();
+
+        std::string binary;
+        if (!OclCache::getBinary(task.program, task.device, binary) || !OclCache::saveBinary(task.device, binary, task.fileName)) {
+            LOG_WARN("failed to write cache file %s", task.fileName.c_str());
+        }
+
+        OclLib::releaseProgram(task.program);
+
+        lock.lock();
+        writePending.erase(task.fileName);
+        lock.unlock();
+
+        writeCv.notify_all();
+    }
+}
+
+
+static void waitWrite(const std::string &fileName)
+{
+    std::unique_lock<std::mutex> lock(writeMutex);
+    writeCv.wait(lock, [&fileName]() { return writePending.count(fileName) == 0; });
+}
+
+
+static cl_uint numDevices(cl_program program)
+{
+    cl_uint num_devices = 0;
+    OclLib::getProgramInfo(program, CL_PROGRAM_NUM_DEVICES, sizeof(cl_uint), &num_devices);
+
+    return num_devices;
+}
+
+
+static int devId(cl_program program, cl_device_id device, cl_uint num_devices)
+{
+    std::vector<cl_device_id> devices_ids(num_devices);
+    OclLib::getProgramInfo(program, CL_PROGRAM_DEVICES, sizeof(cl_device_id)* devices_ids.size(), devices_ids.data());
+
+    int dev_id = 0;
+    for (auto & ocl_device : devices_ids) {
+        if (ocl_device == device) {
+            break;
+        }
+
+        dev_id++;
+    }
+
+    return dev_id;
+}
+
+
+struct IndexEntry
+{
+    uint64_t size = 0;
+    std::string checksum;
+    std::string device;
+    std::string driver;
+    int64_t used = 0;
+};
+
+
+static const char *kIndexFile       = "index.json";
+static const uint64_t kMaxCacheSize = 512 * 1024 * 1024;
+
+static std::mutex indexMutex;
+static std::map<std::string, IndexEntry> cacheIndex;
+static bool indexLoaded = false;
+
+
+static bool renameFile(const std::string &from, const std::string &to)
+{
+    uv_fs_t req;
+    const int rc = uv_fs_rename(uv_default_loop(), &req, from.c_str(), to.c_str(), nullptr);
+    uv_fs_req_cleanup(&req);
+
+    return rc == 0;
+}
+
+
+static std::string indexKey(const std::string &fileName)
+{
+    const std::string dir = OclCache::directory();
+
+    return fileName.compare(0, dir.size(), dir) == 0 ? fileName.substr(dir.size()) : fileName;
+}
+
+
+static std::string checksum(const char *data, size_t size)
+{
+    uint8_t hash[200] = { 0 };
+    xmrig::keccak(reinterpret_cast<const uint8_t *>(data), size, hash);
+
+    char buf[33] = { 0 };
+    for (size_t i = 0; i < 16; ++i) {
+        snprintf(buf + i * 2, 3, "%02x", hash[i]);
+    }
+
+    return buf;
+}
+
+
+static std::string deviceInfo(cl_device_id device, cl_device_info param)
+{
+    char buf[256] = { 0 };
+    if (OclLib::getDeviceInfo(device, param, sizeof(buf) - 1, buf) != CL_SUCCESS) {
+        return std::string();
+    }
+
+    return buf;
+}
+
+
+static std::string driverVersion(cl_device_id device)
+{
+    return deviceInfo(device, CL_DRIVER_VERSION);
+}
+
+
+// index.json keeps size, checksum, driver and last use time of every cached binary, the caller holds indexMutex
+static void readIndex()
+{
+    if (indexLoaded) {
+        return;
+    }
+
+    indexLoaded = true;
+
+    rapidjson::Document doc;
+    if (!xmrig::Json::get((OclCache::directory() + kIndexFile).c_str(), doc)) {
+        return;
+    }
+
+    const rapidjson::Value &binaries = doc["binaries"];
+    if (!binaries.IsArray()) {
+        return;
+    }
+
+    for (const rapidjson::Value &value : binaries.GetArray()) {
+        const char *file = xmrig::Json::getString(value, "file");
+        if (!value.IsObject() || file == nullptr) {
+            continue;
+        }
+
+        IndexEntry &entry = cacheIndex[file];
+        entry.size     = xmrig::Json::getUint64(value, "size");
+        entry.checksum = xmrig::Json::getString(value, "checksum", "");
+        entry.device   = xmrig::Json::getString(value, "device", "");
+        entry.driver   = xmrig::Json::getString(value, "driver", "");
+        entry.used     = xmrig::Json::getInt64(value, "used");
+    }
+}
+
+
+static void writeIndex()
+{
+    using namespace rapidjson;
+
+    Document doc(kObjectType);
+    auto &allocator = doc.GetAllocator();
+
+    Value binaries(kArrayType);
+    for (const auto &kv : cacheIndex) {
+        Value entry(kObjectType);
+        entry.AddMember("file",     Value(kv.first.c_str(), allocator), allocator);
+        entry.AddMember("size",     kv.second.size, allocator);
+        entry.AddMember("checksum", Value(kv.second.checksum.c_str(), allocator), allocator);
+        entry.AddMember("device",   Value(kv.second.device.c_str(), allocator), allocator);
+        entry.AddMember("driver",   Value(kv.second.driver.c_str(), allocator), allocator);
+        entry.AddMember("used",     kv.second.used, allocator);
+
+        binaries.PushBack(entry, allocator);
+    }
+
+    doc.AddMember("binaries", binaries, allocator);
+
+    OclCache::createDirectory();
+
+    const std::string fileName    = OclCache::directory() + kIndexFile;
+    const std::string tmpFileName = fileName + ".tmp";
+
+    if (xmrig::Json::save(tmpFileName.c_str(), doc)) {
+        renameFile(tmpFileName, fileName);
+    }
+}
+
+
+static const char *verifyEntry(const std::string &fileName, cl_device_id device, const char *data, size_t size)
+{
+    std::lock_guard<std::mutex> lock(indexMutex);
+
+    readIndex();
+
+    auto it = cacheIndex.find(indexKey(fileName));
+    if (it == cacheIndex.end()) {
+        return nullptr;
+    }
+
+    if (it->second.size != size) {
+        return "truncated";
+    }
+
+    if (it->second.checksum != checksum(data, size)) {
+        return "corrupted";
+    }
+
+    if (it->second.driver != driverVersion(device)) {
+        return "built by an other driver";
+    }
+
+    return nullptr;
+}
+
+
+static void updateEntry(const std::string &fileName, cl_device_id device, const char *data, size_t size)
+{
+    std::vector<std::string> evicted;
+    {
+        std::lock_guard<std::mutex> lock(indexMutex);
+
+        readIndex();
+
+        IndexEntry &entry = cacheIndex[indexKey(fileName)];
+        if (entry.size != size || entry.checksum.empty()) {
+            entry.size     = size;
+            entry.checksum = checksum(data, size);
+            entry.device   = deviceInfo(device, CL_DEVICE_NAME);
+            entry.driver   = driverVersion(device);
+        }
+
+        entry.used = xmrig::currentMSecsSinceEpoch();
+
+        // least recently used binaries are evicted once the cache grows over kMaxCacheSize
+        uint64_t total = 0;
+        for (const auto &kv : cacheIndex) {
+            total += kv.second.size;
+        }
+
+        while (total > kMaxCacheSize && cacheIndex.size() > 1) {
+            auto oldest = cacheIndex.begin();
+            for (auto it = cacheIndex.begin(); it != cacheIndex.end(); ++it) {
+                if (it->second.used < oldest->second.used) {
+                    oldest = it;
+                }
+            }
+
+            total -= oldest->second.size;
+            evicted.push_back(OclCache::directory() + oldest->first);
+            cacheIndex.erase(oldest);
+        }
+
+        writeIndex();
+    }
+
+    for (const std::string &name : evicted) {
+        LOG_DEBUG("cache file %s evicted (least recently used)", name.c_str());
+        std::remove(name.c_str());
+    }
+}
 
 
 OclCache::OclCache(int index, cl_context opencl_ctx, GpuContext *ctx, const char *source_code, xmrig::Config *config) :
@@ -66,10 +381,52 @@ cl_int OclCache::wait_build(cl_program program, cl_device_id device)
 }
 
 
-void OclCache::getOptions(xmrig::Algo algo, xmrig::Variant, const GpuContext* ctx, char* options, size_t options_size)
+// sub-groups must hold whole 16 lane groups of cn1_cn_gpu, the wavefront width is the sub-group size of AMD and NVIDIA,
+// without cl_khr_subgroup_shuffle the LC compiler of ROCm still exchanges lanes with the ds_bpermute wave intrinsic
+static int cnGpuShuffle(const GpuContext *ctx)
 {
+    if (ctx->caps.wavefrontWidth == 0 || ctx->caps.wavefrontWidth % 16 != 0) {
+        return 0;
+    }
+
+    if (ctx->caps.subgroupShuffle) {
+        return 1;
+    }
+
+    return ctx->caps.amdgcnBuiltins ? 2 : 0;
+}
+
+
+// cn/gpu is floating point math, a program of an unknown variant may run it
+bool OclCache::isRelaxedMath(xmrig::Variant variant)
+{
+    return variant != xmrig::VARIANT_AUTO && variant != xmrig::VARIANT_GPU;
+}
+
+
+// argument of cn1_v2_ext, the iterations of cn_variants with the shuffle order in the low bit
+uint32_t OclCache::cn1Params(xmrig::Variant variant)
+{
+    if (!xmrig::cn_is_known(variant)) {
+        return 0;
+    }
+
+    return xmrig::cn_variants[variant].iterations | (xmrig::cn_variants[variant].reverse ? 1U : 0U);
+}
+
+
+void OclCache::getOptions(xmrig::Algo algo, xmrig::Variant variant, const GpuContext* ctx, char* options, size_t options_size)
+{
+    const int flags    = ctx->buildFlags & BUILD_FLAGS_MASK;
+    const bool relaxed = (flags & BUILD_RELAXED_MATH) && isRelaxedMath(variant);
+
+    const char *vendor = "";
+    if (flags & BUILD_VENDOR_OPT) {
+        vendor = ctx->vendor == xmrig::OCL_VENDOR_AMD ? " -O3" : (ctx->vendor == xmrig::OCL_VENDOR_NVIDIA ? " -cl-nv-opt-level=3" : "");
+    }
+
     snprintf(options, options_size, "-DITERATIONS=%u -DMASK=%u -DWORKSIZE=%zu -DSTRIDED_INDEX=%d -DMEM_CHUNK_EXPONENT=%d -DCOMP_MODE=%d -DMEMORY=%zu "
-        "-DALGO=%d -DUNROLL_FACTOR=%d -DOPENCL_DRIVER_MAJOR=%d -DWORKSIZE_GPU=%zu -cl-fp32-correctly-rounded-divide-sqrt",
+        "-DALGO=%d -DUNROLL_FACTOR=%d -DOPENCL_DRIVER_MAJOR=%d -DWORKSIZE_GPU=%zu -DAES_TABLES=%d -DHASHES_PER_ITEM=%d -DCN_GPU_SHUFFLE=%d -DRESULT_SLOTS=%zu %s%s%s",
         xmrig::cn_select_iter(algo, xmrig::VARIANT_AUTO),
         xmrig::cn_select_mask(algo),
         ctx->workSize,
@@ -80,80 +437,139 @@ void OclCache::getOptions(xmrig::Algo algo, xmrig::Variant, const GpuContext* ct
         static_cast<int>(algo),
         ctx->unrollFactor,
         ctx->amdDriverMajorVersion,
-        worksize(ctx, xmrig::VARIANT_GPU)
+        worksize(ctx, xmrig::VARIANT_GPU),
+        ctx->caps.family == GPU_FAMILY_RDNA ? 2 : 4, // RDNA: half the local memory of the cn1 kernels for more work groups per CU
+        ctx->hashesPerItem,
+        cnGpuShuffle(ctx),
+        OCL_RESULT_SLOTS,
+        relaxed ? "-cl-fast-relaxed-math" : "-cl-fp32-correctly-rounded-divide-sqrt",
+        (flags & BUILD_MAD) && !relaxed ? " -cl-mad-enable" : "",
+        vendor
     );
 }
 
 bool OclCache::load()
 {
-    const xmrig::Algo algo  = m_config->algorithm().algo();
-    const xmrig::Variant variant = m_config->algorithm().variant();
+    return load(m_config->algorithm());
+}
+
+
+std::atomic<uint64_t> OclCache::m_builds(0);
+std::atomic<uint64_t> OclCache::m_buildTime(0);
+std::atomic<uint64_t> OclCache::m_hits(0);
+
+
+OclCache::Stats OclCache::stats()
+{
+    Stats stats;
+    stats.hits      = m_hits.load(std::memory_order_relaxed);
+    stats.builds    = m_builds.load(std::memory_order_relaxed);
+    stats.buildTime = m_buildTime.load(std::memory_order_relaxed);
+
+    return stats;
+}
+
+
+bool OclCache::load(const xmrig::Algorithm &algorithm)
+{
+    const xmrig::Algo algo  = algorithm.algo();
+    const xmrig::Variant variant = algorithm.variant();
 
     char options[512] = { 0 };
     getOptions(algo, variant, m_ctx, options, sizeof(options));
 
-    if (!prepare(options)) {
+    // Finalize is left out, it comes from the program of loadFinalize; a specialized program has only the kernels of the algorithm, see InitOpenCLGpu
+    char kernels_buf[64];
+    snprintf(kernels_buf, sizeof(kernels_buf), " -DKERNELS=%uU", (m_ctx->kernelsMask ? m_ctx->kernelsMask : 0xFFFFFFFFU) & ~(1U << 3));
+    strcat(options, kernels_buf);
+
+    if (m_ctx->kernelsMask && m_ctx->kernelsVariant != xmrig::VARIANT_AUTO) {
+        snprintf(kernels_buf, sizeof(kernels_buf), " -DVARIANT=%d -DCN1_PARAMS=%uU", static_cast<int>(m_ctx->kernelsVariant), cn1Params(m_ctx->kernelsVariant));
+        strcat(options, kernels_buf);
+    }
+
+    const int64_t timeStart = xmrig::steadyTimestamp();
+    if (!prepare(options) || !build(options, m_ctx->Program, m_ctx->cacheHit)) {
         return false;
     }
 
-    std::ifstream clBinFile(m_fileName, std::ofstream::in | std::ofstream::binary);
+    m_ctx->buildTime = xmrig::steadyTimestamp() - timeStart;
 
-    if (!m_config->isOclCache() || !clBinFile.good()) {
-        LOG_INFO(m_config->isColors() ? "GPU " WHITE_BOLD("#%zu") " " YELLOW_BOLD("compiling...") :
-                                        "GPU #%zu compiling...", m_ctx->deviceIdx);
+    xmrig::StartupProfile::add(m_ctx->cacheHit ? "cache load" : "compile", static_cast<int>(m_ctx->deviceIdx), timeStart, timeStart + m_ctx->buildTime);
 
-        int64_t timeStart = xmrig::steadyTimestamp();
+    return true;
+}
 
-        cl_int ret;
-        m_ctx->Program = OclLib::createProgramWithSource(m_oclCtx, 1, reinterpret_cast<const char**>(&m_sourceCode), nullptr, &ret);
-        if (ret != CL_SUCCESS) {
-            return false;
-        }
 
-        if (OclLib::buildProgram(m_ctx->Program, 1, &m_ctx->DeviceID, options) != CL_SUCCESS) {
-            printf("Build log:\n%s\n", OclLib::getProgramBuildLog(m_ctx->Program, m_ctx->DeviceID).data());
-            return false;
-        }
+// Finalize only depends on the result slots, one program of the device serves all algorithms and thread settings
+bool OclCache::loadFinalize(cl_program &program)
+{
+    char options[64] = { 0 };
+    snprintf(options, sizeof(options), "-DKERNELS=%uU -DRESULT_SLOTS=%zu", 1U << 3, OCL_RESULT_SLOTS);
 
-        const cl_uint num_devices = numDevices();
-        const int dev_id          = devId(num_devices);
+    const int64_t timeStart = xmrig::steadyTimestamp();
+    bool hit                = false;
 
-        if (wait_build(m_ctx->Program, m_ctx->DeviceID) != CL_SUCCESS) {
-            return false;
-        }
+    if (!prepare(options) || !build(options, program, hit)) {
+        return false;
+    }
 
-        int64_t timeFinish = xmrig::steadyTimestamp();
+    xmrig::StartupProfile::add(hit ? "finalize cache load" : "finalize compile", static_cast<int>(m_ctx->deviceIdx), timeStart, xmrig::steadyTimestamp());
+
+    return true;
+}
 
-        LOG_INFO(m_config->isColors() ? "GPU " WHITE_BOLD("#%zu") " " GREEN_BOLD("compilation completed") ", elapsed time " WHITE_BOLD("%.3fs") :
-            "GPU #%zu compilation completed, elapsed time %.3fs", m_ctx->deviceIdx, (timeFinish - timeStart) / 1000.0);
 
-        if (!save(dev_id, num_devices)) {
-            return false;
-        }
+bool OclCache::build(const char *options, cl_program &program, bool &hit)
+{
+    std::unique_lock<std::mutex> lock(cacheFileMutex(m_fileName), std::defer_lock);
+    if (m_config->isOclCache()) {
+        lock.lock();
     }
-    else {
-        std::ostringstream ss;
-        ss << clBinFile.rdbuf();
-        std::string s = ss.str();
 
-        size_t bin_size = s.size();
-        auto data_ptr = s.data();
+    if (m_config->isOclCache()) {
+        waitWrite(m_fileName);
+    }
 
-        cl_int clStatus;
-        cl_int ret;
-        m_ctx->Program = OclLib::createProgramWithBinary(m_oclCtx, 1, &m_ctx->DeviceID, &bin_size, reinterpret_cast<const unsigned char **>(&data_ptr), &clStatus, &ret);
-        if (ret != CL_SUCCESS) {
-            LOG_NOTICE("Try to delete file %s", m_fileName.c_str());
-            return false;
-        }
+    const int64_t timeStart = xmrig::steadyTimestamp();
+    hit = m_config->isOclCache() && loadBinary(m_oclCtx, m_ctx->DeviceID, m_fileName, program);
 
-        if (OclLib::buildProgram(m_ctx->Program, 1, &m_ctx->DeviceID) != CL_SUCCESS) {
-            LOG_NOTICE("Try to delete file %s", m_fileName.c_str());
-            return false;
-        }
+    if (!hit && m_config->isOclCache() && installPrebuilt(m_ctx->DeviceID, m_fileName)) {
+        hit = loadBinary(m_oclCtx, m_ctx->DeviceID, m_fileName, program);
     }
 
-    return true;
+    if (hit) {
+        m_hits.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    LOG_INFO(m_config->isColors() ? "GPU " WHITE_BOLD("#%zu") " " YELLOW_BOLD("compiling...") :
+                                    "GPU #%zu compiling...", m_ctx->deviceIdx);
+
+    cl_int ret;
+    program = OclLib::createProgramWithSource(m_oclCtx, 1, reinterpret_cast<const char**>(&m_sourceCode), nullptr, &ret);
+    if (ret != CL_SUCCESS) {
+        return false;
+    }
+
+    if (OclLib::buildProgram(program, 1, &m_ctx->DeviceID, options) != CL_SUCCESS) {
+        printf("Build log:\n%s\n", OclLib::getProgramBuildLog(program, m_ctx->DeviceID).data());
+        return false;
+    }
+
+    if (wait_build(program, m_ctx->DeviceID) != CL_SUCCESS) {
+        return false;
+    }
+
+    const int64_t timeFinish = xmrig::steadyTimestamp();
+
+    LOG_INFO(m_config->isColors() ? "GPU " WHITE_BOLD("#%zu") " " GREEN_BOLD("compilation completed") ", elapsed time " WHITE_BOLD("%.3fs") :
+        "GPU #%zu compilation completed, elapsed time %.3fs", m_ctx->deviceIdx, (timeFinish - timeStart) / 1000.0);
+
+    m_builds.fetch_add(1, std::memory_order_relaxed);
+    m_buildTime.fetch_add(static_cast<uint64_t>(timeFinish - timeStart), std::memory_order_relaxed);
+
+    return save(program);
 }
 
 bool OclCache::get_device_string(int platform, cl_device_id device, std::string& result)
@@ -202,17 +618,14 @@ void OclCache::calc_hash(const std::string& device_string, const char* source_co
 
 bool OclCache::prepare(const char *options)
 {
-    std::string device_string;
-    if (!get_device_string(m_config->platformIndex(), m_ctx->DeviceID, device_string)) {
+    // filled by the device enumeration, the driver is only asked for a context that did not come from it
+    if (m_ctx->DeviceString.empty() && !get_device_string(m_ctx->platformIdx, m_ctx->DeviceID, m_ctx->DeviceString)) {
         return false;
     }
-    calc_hash(device_string, m_sourceCode, options, m_fileName);
 
-#   ifdef _WIN32
-    m_fileName = prefix() + "\\xmrig\\.cache\\" + m_fileName + ".bin";
-#   else
-    m_fileName = prefix() + "/.cache/" + m_fileName + ".bin";
-#   endif
+    std::string hash;
+    calc_hash(m_ctx->DeviceString, m_sourceCode, options, hash);
+    m_fileName = fileName(hash);
 
 #   ifndef XMRIG_STRICT_OPENCL_CACHE
     LOG_INFO("           CACHE: %s", m_fileName.c_str());
@@ -222,97 +635,567 @@ bool OclCache::prepare(const char *options)
 }
 
 
-bool OclCache::save(int dev_id, cl_uint num_devices) const
+bool OclCache::save(cl_program program) const
 {
     if (!m_config->isOclCache()) {
         return true;
     }
 
-    createDirectory();
+    if (OclLib::retainProgram(program) != CL_SUCCESS) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(writeMutex);
+
+        writeTasks.push_back({ program, m_ctx->DeviceID, m_fileName });
+        writePending.insert(m_fileName);
+
+        if (!writeThread) {
+            writeThread = new std::thread(writeThreadProc);
+        }
+    }
+
+    writeCv.notify_all();
+
+    return true;
+}
+
+
+void OclCache::flush()
+{
+    std::unique_lock<std::mutex> lock(writeMutex);
+    writeCv.wait(lock, []() { return writePending.empty(); });
+}
+
+
+int OclCache::amdDriverMajorVersion(const GpuContext* ctx)
+{
+#   ifdef XMRIG_STRICT_OPENCL_CACHE
+    const int version = ctx->caps.driverVersion.isNull() ? 0 : strtol(ctx->caps.driverVersion.data(), nullptr, 10);
+
+    return version >= 1400 ? version / 100 : 0;
+#   else
+    return 0;
+#   endif
+}
+
+
+size_t OclCache::worksize(const GpuContext *ctx, xmrig::Variant variant)
+{
+    if (variant != xmrig::VARIANT_GPU) {
+        return ctx->workSize;
+    }
+
+    if (ctx->caps.maxWorkGroupSize > 0) {
+        const size_t maxWorkSize = ctx->caps.maxWorkGroupSize / 16;
+
+        return ctx->workSize > maxWorkSize ? maxWorkSize : ctx->workSize;
+    }
+
+    return ctx->workSize;
+}
+
+
+std::string OclCache::directory()
+{
+#   ifdef _WIN32
+    return prefix() + "\\xmrig\\.cache\\";
+#   else
+    return prefix() + "/.cache/";
+#   endif
+}
+
+
+std::string OclCache::fileName(const std::string &hash)
+{
+    return directory() + hash + ".bin";
+}
+
+
+bool OclCache::loadBinary(cl_context opencl_ctx, cl_device_id device, const std::string &fileName, cl_program &program)
+{
+    MappedFile file;
+    if (!mapFile(fileName, file)) {
+        return false;
+    }
+
+    const char *error = verifyEntry(fileName, device, file.data, file.size);
+    const bool result = error == nullptr && buildBinary(opencl_ctx, device, file.data, file.size, program);
+
+    if (result) {
+        updateEntry(fileName, device, file.data, file.size);
+    }
+
+    unmapFile(file);
+
+    if (!result) {
+        LOG_WARN("cache file %s is %s, deleted", fileName.c_str(), error ? error : "invalid");
+        removeBinary(fileName);
+    }
+
+    return result;
+}
+
+
+bool OclCache::buildBinary(cl_context opencl_ctx, cl_device_id device, const char *data, size_t size, cl_program &program)
+{
+    cl_int clStatus;
+    cl_int ret;
+    program = OclLib::createProgramWithBinary(opencl_ctx, 1, &device, &size, reinterpret_cast<const unsigned char **>(&data), &clStatus, &ret);
+    if (ret != CL_SUCCESS) {
+        program = nullptr;
+        return false;
+    }
+
+    if (OclLib::buildProgram(program, 1, &device) != CL_SUCCESS) {
+        OclLib::releaseProgram(program);
+        program = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+
+bool OclCache::getBinary(cl_program program, cl_device_id device, std::string &binary)
+{
+    const cl_uint num_devices = numDevices(program);
+    const int dev_id          = devId(program, device, num_devices);
 
     std::vector<size_t> binary_sizes(num_devices);
-    OclLib::getProgramInfo(m_ctx->Program, CL_PROGRAM_BINARY_SIZES, sizeof(size_t) * binary_sizes.size(), binary_sizes.data());
+    OclLib::getProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(size_t) * binary_sizes.size(), binary_sizes.data());
 
     std::vector<char*> all_programs(num_devices);
     std::vector<std::vector<char>> program_storage;
 
-    size_t mem_size = 0;
     for (size_t i = 0; i < all_programs.size(); ++i) {
         program_storage.emplace_back(std::vector<char>(binary_sizes[i]));
         all_programs[i] = program_storage[i].data();
-        mem_size += binary_sizes[i];
     }
 
-    if (OclLib::getProgramInfo(m_ctx->Program, CL_PROGRAM_BINARIES, num_devices * sizeof(char*), all_programs.data()) != CL_SUCCESS) {
+    if (OclLib::getProgramInfo(program, CL_PROGRAM_BINARIES, num_devices * sizeof(char*), all_programs.data()) != CL_SUCCESS) {
         return false;
     }
 
+    binary.assign(all_programs[dev_id], binary_sizes[dev_id]);
+
+    return true;
+}
+
+
+bool OclCache::saveBinary(cl_device_id device, const std::string &binary, const std::string &fileName)
+{
+    createDirectory();
+
+    // written to a temporary file first, a power loss never leaves a truncated binary under the final name
+    const std::string tmpFileName = fileName + ".tmp";
+
     std::ofstream file_stream;
-    file_stream.open(m_fileName, std::ofstream::out | std::ofstream::binary);
-    file_stream.write(all_programs[dev_id], binary_sizes[dev_id]);
+    file_stream.open(tmpFileName, std::ofstream::out | std::ofstream::binary);
+    file_stream.write(binary.data(), binary.size());
     file_stream.close();
 
+    if (file_stream.fail() || !renameFile(tmpFileName, fileName)) {
+        std::remove(tmpFileName.c_str());
+        return false;
+    }
+
+    updateEntry(fileName, device, binary.data(), binary.size());
+
     return true;
 }
 
 
-cl_uint OclCache::numDevices() const
+bool OclCache::removeBinary(const std::string &fileName)
 {
-    cl_uint num_devices = 0;
-    OclLib::getProgramInfo(m_ctx->Program, CL_PROGRAM_NUM_DEVICES, sizeof(cl_uint), &num_devices);
+    {
+        std::lock_guard<std::mutex> lock(indexMutex);
 
-    return num_devices;
+        readIndex();
+        if (cacheIndex.erase(indexKey(fileName))) {
+            writeIndex();
+        }
+    }
+
+    return std::remove(fileName.c_str()) == 0;
 }
 
 
-int OclCache::amdDriverMajorVersion(const GpuContext* ctx)
+// bundle is a flat file of cache binaries with their index metadata, so rigs with the same devices and driver can share one cache
+static const char kBundleMagic[8]   = { 'X', 'M', 'R', 'I', 'G', 'O', 'C', 'L' };
+static const uint32_t kBundleVersion = 1;
+
+
+// binary of the prebuilt bundle shipped next to the executable, found by its cache file name
+struct PrebuiltEntry
 {
-#   ifdef XMRIG_STRICT_OPENCL_CACHE
-    char buf[64] = { 0 };
-    if (OclLib::getDeviceInfo(ctx->DeviceID, CL_DRIVER_VERSION, sizeof buf, buf) != CL_SUCCESS) {
-        return 0;
+    IndexEntry entry;
+    std::streamoff offset;
+};
+
+static std::mutex prebuiltMutex;
+static std::string prebuiltFile;
+static std::map<std::string, PrebuiltEntry> prebuiltIndex;
+static bool prebuiltLoaded = false;
+
+
+static void writeString(std::ofstream &out, const std::string &str)
+{
+    const uint32_t size = static_cast<uint32_t>(str.size());
+    out.write(reinterpret_cast<const char *>(&size), sizeof(size));
+    out.write(str.data(), size);
+}
+
+
+static bool readString(std::ifstream &in, std::string &str)
+{
+    uint32_t size = 0;
+    if (!in.read(reinterpret_cast<char *>(&size), sizeof(size)) || size > 4096) {
+        return false;
     }
 
-    const int version = strtol(buf, nullptr, 10);
+    str.resize(size);
 
-    return version >= 1400 ? version / 100 : 0;
-#   else
-    return 0;
-#   endif
+    return size == 0 || in.read(&str[0], size);
 }
 
 
-size_t OclCache::worksize(const GpuContext *ctx, xmrig::Variant variant)
+static bool readBundleHeader(std::ifstream &in, uint32_t &count)
 {
-    if (variant != xmrig::VARIANT_GPU) {
-        return ctx->workSize;
+    char magic[sizeof(kBundleMagic)] = { 0 };
+    uint32_t version = 0;
+
+    return in.read(magic, sizeof(magic)) && memcmp(magic, kBundleMagic, sizeof(magic)) == 0 &&
+           in.read(reinterpret_cast<char *>(&version), sizeof(version)) && version == kBundleVersion &&
+           in.read(reinterpret_cast<char *>(&count), sizeof(count));
+}
+
+
+static void writeBundleHeader(std::ofstream &out, uint32_t count)
+{
+    out.write(kBundleMagic, sizeof(kBundleMagic));
+    out.write(reinterpret_cast<const char *>(&kBundleVersion), sizeof(kBundleVersion));
+    out.write(reinterpret_cast<const char *>(&count), sizeof(count));
+}
+
+
+// metadata of the next binary, its data follows
+static bool readBundleEntry(std::ifstream &in, std::string &name, IndexEntry &entry)
+{
+    return readString(in, name) && readString(in, entry.device) && readString(in, entry.driver) && readString(in, entry.checksum) &&
+           in.read(reinterpret_cast<char *>(&entry.size), sizeof(entry.size));
+}
+
+
+static void writeBundleEntry(std::ofstream &out, const std::string &name, const IndexEntry &entry, const char *data, uint64_t size)
+{
+    writeString(out, name);
+    writeString(out, entry.device);
+    writeString(out, entry.driver);
+    writeString(out, entry.checksum);
+
+    out.write(reinterpret_cast<const char *>(&size), sizeof(size));
+    out.write(data, static_cast<std::streamsize>(size));
+}
+
+
+// only plain file names with the data they were exported with, a bundle must never write outside of the cache directory
+static bool isValidEntry(const std::string &name, const IndexEntry &entry, const std::vector<char> &data)
+{
+    return entry.size != 0 && name.find_first_of("/\\") == std::string::npos && name.find("..") == std::string::npos &&
+           checksum(data.data(), data.size()) == entry.checksum;
+}
+
+
+// writes a binary of a bundle into the cache directory, the caller holds indexMutex
+static bool installEntry(const std::string &name, IndexEntry entry, const std::vector<char> &data)
+{
+    const std::string binaryFileName = OclCache::directory() + name;
+    const std::string tmpFileName    = binaryFileName + ".tmp";
+
+    std::ofstream out(tmpFileName, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+    out.write(data.data(), data.size());
+    out.close();
+
+    if (out.fail() || !renameFile(tmpFileName, binaryFileName)) {
+        std::remove(tmpFileName.c_str());
+        return false;
     }
 
-    size_t maxWorkSize = 0;
+    entry.used = xmrig::currentMSecsSinceEpoch();
+    cacheIndex[name] = entry;
 
-    if (OclLib::getDeviceInfo(ctx->DeviceID, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(size_t), &maxWorkSize) == CL_SUCCESS) {
-        maxWorkSize /= 16;
+    return true;
+}
 
-        return ctx->workSize > maxWorkSize ? maxWorkSize : ctx->workSize;
+
+bool OclCache::exportBundle(const char *fileName)
+{
+    std::map<std::string, IndexEntry> entries;
+    {
+        std::lock_guard<std::mutex> lock(indexMutex);
+
+        readIndex();
+        entries = cacheIndex;
     }
 
-    return ctx->workSize;
+    std::ofstream out(fileName, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+    if (!out.is_open()) {
+        LOG_ERR("Failed to open OpenCL cache bundle \"%s\" for writing", fileName);
+        return false;
+    }
+
+    writeBundleHeader(out, static_cast<uint32_t>(entries.size()));
+
+    uint32_t exported = 0;
+    for (const auto &kv : entries) {
+        MappedFile file;
+        const bool valid = mapFile(directory() + kv.first, file) && file.size == kv.second.size;
+
+        // missing binaries are still written with empty data to keep the count, import skips them
+        writeBundleEntry(out, kv.first, kv.second, file.data, valid ? file.size : 0);
+        if (valid) {
+            exported++;
+        }
+
+        unmapFile(file);
+    }
+
+    out.close();
+    if (out.fail()) {
+        LOG_ERR("Failed to write OpenCL cache bundle \"%s\"", fileName);
+        return false;
+    }
+
+    LOG_INFO("exported %u OpenCL cache binaries to \"%s\"", exported, fileName);
+
+    return true;
 }
 
 
-int OclCache::devId(cl_uint num_devices) const
+bool OclCache::importBundle(const char *fileName)
 {
-    std::vector<cl_device_id> devices_ids(num_devices);
-    OclLib::getProgramInfo(m_ctx->Program, CL_PROGRAM_DEVICES, sizeof(cl_device_id)* devices_ids.size(), devices_ids.data());
+    if (strstr(fileName, "://") != nullptr) {
+        LOG_ERR("OpenCL cache bundle \"%s\": only local files are supported, download it first", fileName);
+        return false;
+    }
 
-    int dev_id = 0;
-    for (auto & ocl_device : devices_ids) {
-        if (ocl_device == m_ctx->DeviceID) {
+    std::ifstream in(fileName, std::ifstream::in | std::ifstream::binary);
+    if (!in.is_open()) {
+        LOG_ERR("Failed to open OpenCL cache bundle \"%s\"", fileName);
+        return false;
+    }
+
+    uint32_t count = 0;
+    if (!readBundleHeader(in, count)) {
+        LOG_ERR("\"%s\" is not an OpenCL cache bundle", fileName);
+        return false;
+    }
+
+    createDirectory();
+
+    uint32_t imported = 0;
+    std::vector<char> data;
+
+    std::lock_guard<std::mutex> lock(indexMutex);
+    readIndex();
+
+    for (uint32_t i = 0; i < count; ++i) {
+        IndexEntry entry;
+        std::string name;
+        if (!readBundleEntry(in, name, entry)) {
+            LOG_ERR("OpenCL cache bundle \"%s\" is truncated", fileName);
             break;
         }
 
-        dev_id++;
+        data.resize(entry.size);
+        if (entry.size && !in.read(data.data(), entry.size)) {
+            LOG_ERR("OpenCL cache bundle \"%s\" is truncated", fileName);
+            break;
+        }
+
+        if (!isValidEntry(name, entry, data)) {
+            continue;
+        }
+
+        auto it = cacheIndex.find(name);
+        if (it != cacheIndex.end() && it->second.checksum == entry.checksum) {
+            continue;
+        }
+
+        if (installEntry(name, entry, data)) {
+            imported++;
+        }
     }
 
-    return dev_id;
+    writeIndex();
+
+    LOG_INFO("imported %u OpenCL cache binaries from \"%s\"", imported, fileName);
+
+    return true;
+}
+
+
+// release step: binaries of the local cache are added to the bundle, those of other devices and drivers already in it
+// are kept, so one bundle collects the cache of a reference rig for each common GPU and driver
+bool OclCache::mergeBundle(const char *fileName)
+{
+    std::vector<std::pair<std::string, IndexEntry> > entries;
+    std::vector<std::vector<char> > binaries;
+
+    std::map<std::string, IndexEntry> local;
+    {
+        std::lock_guard<std::mutex> lock(indexMutex);
+
+        readIndex();
+        local = cacheIndex;
+    }
+
+    std::ifstream in(fileName, std::ifstream::in | std::ifstream::binary);
+    uint32_t count = 0;
+
+    if (in.is_open() && readBundleHeader(in, count)) {
+        for (uint32_t i = 0; i < count; ++i) {
+            IndexEntry entry;
+            std::string name;
+            std::vector<char> data;
+
+            if (!readBundleEntry(in, name, entry)) {
+                break;
+            }
+
+            data.resize(entry.size);
+            if (entry.size && !in.read(data.data(), entry.size)) {
+                break;
+            }
+
+            if (isValidEntry(name, entry, data) && local.count(name) == 0) {
+                entries.push_back(std::make_pair(name, entry));
+                binaries.push_back(std::move(data));
+            }
+        }
+    }
+
+    in.close();
+
+    const size_t kept = entries.size();
+
+    for (const auto &kv : local) {
+        MappedFile file;
+        if (mapFile(directory() + kv.first, file) && file.size == kv.second.size) {
+            entries.push_back(kv);
+            binaries.push_back(std::vector<char>(file.data, file.data + file.size));
+        }
+
+        unmapFile(file);
+    }
+
+    const std::string tmpFileName = std::string(fileName) + ".tmp";
+    std::ofstream out(tmpFileName, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+    if (!out.is_open()) {
+        LOG_ERR("Failed to open OpenCL cache bundle \"%s\" for writing", tmpFileName.c_str());
+        return false;
+    }
+
+    writeBundleHeader(out, static_cast<uint32_t>(entries.size()));
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        writeBundleEntry(out, entries[i].first, entries[i].second, binaries[i].data(), binaries[i].size());
+    }
+
+    out.close();
+    if (out.fail() || !renameFile(tmpFileName, fileName)) {
+        std::remove(tmpFileName.c_str());
+        LOG_ERR("Failed to write OpenCL cache bundle \"%s\"", fileName);
+        return false;
+    }
+
+    LOG_INFO("merged %zu OpenCL cache binaries into \"%s\" holding %zu", entries.size() - kept, fileName, entries.size());
+
+    return true;
+}
+
+
+// the bundle is only indexed here, a binary is read when its program is loaded the first time
+void OclCache::setPrebuilt(const std::string &fileName)
+{
+    std::lock_guard<std::mutex> lock(prebuiltMutex);
+
+    prebuiltFile   = fileName;
+    prebuiltLoaded = false;
+    prebuiltIndex.clear();
+}
+
+
+// a cache miss installs the binary of the prebuilt bundle with the same file name (calc_hash of device string, source
+// and options) and driver, so a new rig or driver loads shipped binaries instead of compiling them
+bool OclCache::installPrebuilt(cl_device_id device, const std::string &fileName)
+{
+    std::lock_guard<std::mutex> lock(prebuiltMutex);
+
+    if (prebuiltFile.empty()) {
+        return false;
+    }
+
+    std::ifstream in(prebuiltFile, std::ifstream::in | std::ifstream::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+
+    if (!prebuiltLoaded) {
+        prebuiltLoaded = true;
+
+        uint32_t count = 0;
+        if (!readBundleHeader(in, count)) {
+            LOG_WARN("\"%s\" is not an OpenCL cache bundle", prebuiltFile.c_str());
+            return false;
+        }
+
+        for (uint32_t i = 0; i < count; ++i) {
+            PrebuiltEntry prebuilt;
+            std::string name;
+
+            if (!readBundleEntry(in, name, prebuilt.entry)) {
+                break;
+            }
+
+            prebuilt.offset = in.tellg();
+            if (!in.seekg(static_cast<std::streamoff>(prebuilt.entry.size), std::ios_base::cur)) {
+                break;
+            }
+
+            if (prebuilt.entry.size) {
+                prebuiltIndex[name] = prebuilt;
+            }
+        }
+
+        LOG_INFO("%zu prebuilt OpenCL binaries in \"%s\"", prebuiltIndex.size(), prebuiltFile.c_str());
+        in.clear();
+    }
+
+    const std::string name = indexKey(fileName);
+    auto it = prebuiltIndex.find(name);
+    if (it == prebuiltIndex.end() || it->second.entry.driver != driverVersion(device)) {
+        return false;
+    }
+
+    std::vector<char> data(it->second.entry.size);
+    if (!in.seekg(it->second.offset) || !in.read(data.data(), data.size()) || !isValidEntry(name, it->second.entry, data)) {
+        prebuiltIndex.erase(it);
+        return false;
+    }
+
+    createDirectory();
+
+    std::lock_guard<std::mutex> indexLock(indexMutex);
+    readIndex();
+
+    if (!installEntry(name, it->second.entry, data)) {
+        return false;
+    }
+
+    writeIndex();
+
+    return true;
 }
@@ -26,10 +26,14 @@
 #define XMRIG_OCLCACHE_H
 
 
+#include <atomic>
+
+
 #include "amd/GpuContext.h"
 
 
 namespace xmrig {
+    class Algorithm;
     class Config;
 }
 
@@ -37,10 +41,39 @@ namespace xmrig {
 class OclCache
 {
 public:
+    // compiler options added to the defaults, part of the cache file hash like all options
+    enum BuildFlags {
+        BUILD_MAD          = 1, // -cl-mad-enable
+        BUILD_RELAXED_MATH = 2, // -cl-fast-relaxed-math instead of correctly rounded divide and sqrt, see isRelaxedMath
+        BUILD_VENDOR_OPT   = 4, // -O3 on AMD, -cl-nv-opt-level=3 on NVIDIA
+        BUILD_FLAGS_MASK   = 7
+    };
+
+    struct MappedFile
+    {
+        const char *data = nullptr;
+        size_t size      = 0;
+        void *handle     = nullptr;
+    };
+
+    // program loads since start, buildTime is the total compile time in ms
+    struct Stats
+    {
+        uint64_t hits;
+        uint64_t builds;
+        uint64_t buildTime;
+    };
+
     OclCache(int index, cl_context opencl_ctx, GpuContext *ctx, const char *source_code, xmrig::Config *config);
 
+    static Stats stats();
+
     bool load();
+    bool load(const xmrig::Algorithm &algorithm);
+    bool loadFinalize(cl_program &program);
 
+    static bool isRelaxedMath(xmrig::Variant variant);
+    static uint32_t cn1Params(xmrig::Variant variant);
     static void getOptions(xmrig::Algo algo, xmrig::Variant variant, const GpuContext* ctx, char* options, size_t options_size);
     static bool get_device_string(int platform, cl_device_id device, std::string& result);
     static void calc_hash(const std::string& device_string, const char* source_code, const char *options, std::string& hash);
@@ -48,15 +81,33 @@ public:
     static int amdDriverMajorVersion(const GpuContext* ctx);
     static void sleep(size_t ms);
     static size_t worksize(const GpuContext *ctx, xmrig::Variant variant);
+    static std::string directory();
+    static std::string fileName(const std::string &hash);
+    static bool loadBinary(cl_context opencl_ctx, cl_device_id device, const std::string &fileName, cl_program &program);
+    static bool buildBinary(cl_context opencl_ctx, cl_device_id device, const char *data, size_t size, cl_program &program);
+    static bool getBinary(cl_program program, cl_device_id device, std::string &binary);
+    static bool saveBinary(cl_device_id device, const std::string &binary, const std::string &fileName);
+    static bool removeBinary(const std::string &fileName);
+    static bool exportBundle(const char *fileName);
+    static bool importBundle(const char *fileName);
+    static bool mergeBundle(const char *fileName);
+    static bool installPrebuilt(cl_device_id device, const std::string &fileName);
+    static void setPrebuilt(const std::string &fileName);
+    static void createDirectory();
+    static void flush();
 
 private:
+    bool build(const char *options, cl_program &program, bool &hit);
     bool prepare(const char *options);
-    bool save(int dev_id, cl_uint num_devices) const;
-    cl_uint numDevices() const;
-    int devId(cl_uint num_devices) const;
-    void createDirectory() const;
+    bool save(cl_program program) const;
 
+    static bool mapFile(const std::string &fileName, MappedFile &file);
     static std::string prefix();
+    static void unmapFile(MappedFile &file);
+
+    static std::atomic<uint64_t> m_builds;
+    static std::atomic<uint64_t> m_buildTime;
+    static std::atomic<uint64_t> m_hits;
 
     cl_context m_oclCtx;
     const char *m_sourceCode;
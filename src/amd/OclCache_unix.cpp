@@ -21,6 +21,8 @@
  *   along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -28,13 +30,51 @@
 #include "amd/OclCache.h"
 
 
-void OclCache::createDirectory() const
+void OclCache::createDirectory()
 {
     std::string path = prefix() + "/.cache";
     mkdir(path.c_str(), 0744);
 }
 
 
+bool OclCache::mapFile(const std::string &fileName, MappedFile &file)
+{
+    const int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+
+    void *data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    file.data = static_cast<const char *>(data);
+    file.size = static_cast<size_t>(st.st_size);
+
+    return true;
+}
+
+
+void OclCache::unmapFile(MappedFile &file)
+{
+    if (file.data) {
+        munmap(const_cast<char *>(file.data), file.size);
+    }
+
+    file.data = nullptr;
+    file.size = 0;
+}
+
+
 std::string OclCache::prefix()
 {
     return ".";
@@ -30,7 +30,7 @@
 #include "amd/OclCache.h"
 
 
-void OclCache::createDirectory() const
+void OclCache::createDirectory()
 {
     std::string path = prefix() + "/xmrig";
     _mkdir(path.c_str());
@@ -40,6 +40,53 @@ void OclCache::createDirectory() const
 }
 
 
+bool OclCache::mapFile(const std::string &fileName, MappedFile &file)
+{
+    HANDLE handle = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size) || size.QuadPart <= 0) {
+        CloseHandle(handle);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(handle);
+
+    if (mapping == nullptr) {
+        return false;
+    }
+
+    void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == nullptr) {
+        CloseHandle(mapping);
+        return false;
+    }
+
+    file.data   = static_cast<const char *>(data);
+    file.size   = static_cast<size_t>(size.QuadPart);
+    file.handle = mapping;
+
+    return true;
+}
+
+
+void OclCache::unmapFile(MappedFile &file)
+{
+    if (file.data) {
+        UnmapViewOfFile(file.data);
+        CloseHandle(file.handle);
+    }
+
+    file.data   = nullptr;
+    file.size   = 0;
+    file.handle = nullptr;
+}
+
+
 std::string OclCache::prefix()
 {
     char path[MAX_PATH + 1];
@@ -22,18 +22,31 @@
  *   along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <condition_variable>
 #include <cstring>
+#include <inttypes.h>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <set>
 #include <sstream>
 #include <string>
 #include <thread>
+#include <unordered_map>
+#include <uv.h>
 
 
+#include "amd/GpuMemory.h"
 #include "amd/OclCache.h"
 #include "amd/OclCryptonightR_gen.h"
 #include "amd/OclError.h"
 #include "amd/OclLib.h"
+#include "amd/OclSource.h"
+#include "common/cpu/Cpu.h"
 #include "common/log/Log.h"
+#include "common/Platform.h"
+#include "core/Trace.h"
 #include "crypto/CryptoNight_monero.h"
 
 
@@ -64,7 +77,7 @@ static std::string get_code(const V4_Instruction* code, int code_size)
 
         case ROR:
         case ROL:
-            s << 'r' << a << "=rotate(r" << a << ((inst.opcode == ROR) ? ",ROT_BITS-r" : ",r") << b << ");";
+            s << 'r' << a << ((inst.opcode == ROR) ? "=RANDOM_MATH_ROR(r" : "=RANDOM_MATH_ROL(r") << a << ",r" << b << ");";
             break;
 
         case XOR:
@@ -78,160 +91,361 @@ static std::string get_code(const V4_Instruction* code, int code_size)
     return s.str();
 }
 
-struct CacheEntry
+struct CacheKey
 {
-    CacheEntry(xmrig::Variant variant, uint64_t height, size_t deviceIdx, std::string&& hash, cl_program program) :
+    CacheKey(xmrig::Variant variant, uint64_t height, const std::string& hash) :
         variant(variant),
         height(height),
-        deviceIdx(deviceIdx),
-        hash(std::move(hash)),
-        program(program)
+        hash(hash)
     {}
 
+    bool operator==(const CacheKey& other) const { return (variant == other.variant) && (height == other.height) && (hash == other.hash); }
+
     xmrig::Variant variant;
     uint64_t height;
-    size_t deviceIdx;
     std::string hash;
-    cl_program program;
 };
 
-struct BackgroundTaskBase
+struct CacheKeyHasher
 {
-    virtual ~BackgroundTaskBase() {}
-    virtual void exec() = 0;
+    size_t operator()(const CacheKey& key) const { return std::hash<std::string>()(key.hash) ^ (std::hash<uint64_t>()(key.height) << 1) ^ static_cast<size_t>(key.variant); }
 };
 
-template<typename T>
-struct BackgroundTask : public BackgroundTaskBase
+// a program belongs to the OpenCL context it was created in, with --opencl-device-contexts each GPU has own context
+typedef std::pair<cl_context, size_t> ProgramKey;
+
+// the hash covers device string and options, so one entry serves every identical GPU:
+// the binary is built once and each device gets its own program created from it
+struct CacheEntry
 {
-    BackgroundTask(T&& func) : m_func(std::move(func)) {}
-    void exec() override { m_func(); }
+    std::shared_ptr<const std::string> binary;
+    std::map<ProgramKey, cl_program> programs;
+};
+
+struct BackgroundTask
+{
+    BackgroundTask(GpuContext* ctx, xmrig::Variant variant, uint64_t height) :
+        ctx(ctx),
+        variant(variant),
+        height(height)
+    {}
 
-    T m_func;
+    GpuContext* ctx;
+    xmrig::Variant variant;
+    uint64_t height;
 };
 
 static std::mutex CryptonightR_cache_mutex;
-static std::mutex CryptonightR_build_mutex;
-static std::vector<CacheEntry> CryptonightR_cache;
+static std::unordered_map<CacheKey, CacheEntry, CacheKeyHasher> CryptonightR_cache;
 
-static std::mutex background_tasks_mutex;
-static std::vector<BackgroundTaskBase*> background_tasks;
-static std::thread* background_thread = nullptr;
 
-static void background_thread_proc()
+static void CryptonightR_release(const CacheEntry& entry)
 {
-    std::vector<BackgroundTaskBase*> tasks;
-    for (;;) {
-        tasks.clear();
-        {
-            std::lock_guard<std::mutex> g(background_tasks_mutex);
-            background_tasks.swap(tasks);
-        }
+    for (const auto& program : entry.programs) {
+        GpuMemory::release(program.second);
+        OclLib::releaseProgram(program.second);
+    }
+}
 
-        for (BackgroundTaskBase* task : tasks) {
-            task->exec();
-            delete task;
-        }
 
-        OclCache::sleep(500);
+// returned program is retained, the caller must release it
+static cl_program CryptonightR_cache_find(const CacheKey& key, const ProgramKey& programKey, std::shared_ptr<const std::string>* binary = nullptr)
+{
+    std::lock_guard<std::mutex> g(CryptonightR_cache_mutex);
+
+    auto it = CryptonightR_cache.find(key);
+    if (it == CryptonightR_cache.end()) {
+        return nullptr;
     }
+
+    if (binary) {
+        *binary = it->second.binary;
+    }
+
+    auto program = it->second.programs.find(programKey);
+    if (program == it->second.programs.end()) {
+        return nullptr;
+    }
+
+    OclLib::retainProgram(program->second);
+    return program->second;
 }
 
-template<typename T>
-static void background_exec(T&& func)
+
+// the cache takes ownership of the program and returns it retained for the caller,
+// entries with the lowest height are released once CRYPTONIGHTR_CACHE_CAPACITY is exceeded
+static cl_program CryptonightR_cache_add(const CacheKey& key, const ProgramKey& programKey, cl_program program, const std::shared_ptr<const std::string>& binary)
 {
-    BackgroundTaskBase* task = new BackgroundTask<T>(std::move(func));
+    std::vector<CacheEntry> old_entries;
+    {
+        std::lock_guard<std::mutex> g(CryptonightR_cache_mutex);
+
+        CacheEntry& entry = CryptonightR_cache[key];
+        if (!entry.binary) {
+            entry.binary = binary;
+        }
 
-    std::lock_guard<std::mutex> g(background_tasks_mutex);
-    background_tasks.push_back(task);
-    if (!background_thread) {
-        background_thread = new std::thread(background_thread_proc);
+        cl_program& slot = entry.programs[programKey];
+        if (slot) {
+            old_entries.emplace_back();
+            old_entries.back().programs[programKey] = slot;
+        }
+
+        slot = program;
+        OclLib::retainProgram(program);
+        GpuMemory::add(program, programKey.second, GpuMemory::CryptonightR);
+
+        while (CryptonightR_cache.size() > CRYPTONIGHTR_CACHE_CAPACITY)
+        {
+            auto oldest = CryptonightR_cache.begin();
+            for (auto it = CryptonightR_cache.begin(); it != CryptonightR_cache.end(); ++it) {
+                if (it->first.height < oldest->first.height) {
+                    oldest = it;
+                }
+            }
+
+            LOG_DEBUG("CryptonightR: program for height %" PRIu64 " released (cache is full)", oldest->first.height);
+            old_entries.push_back(std::move(oldest->second));
+            CryptonightR_cache.erase(oldest);
+        }
+    }
+
+    for (const CacheEntry& entry : old_entries) {
+        CryptonightR_release(entry);
     }
+
+    return program;
 }
 
 
-static cl_program CryptonightR_build_program(const GpuContext *ctx, xmrig::Variant variant, uint64_t height, const std::string &source, const std::string &options, std::string hash)
+static void CryptonightR_cache_remove_old(xmrig::Variant variant, uint64_t height)
 {
-    std::vector<cl_program> old_programs;
-    old_programs.reserve(32);
+    std::vector<CacheEntry> old_entries;
     {
         std::lock_guard<std::mutex> g(CryptonightR_cache_mutex);
 
-        // Remove old programs from cache
-        for (size_t i = 0; i < CryptonightR_cache.size();)
+        for (auto it = CryptonightR_cache.begin(); it != CryptonightR_cache.end();)
         {
-            const CacheEntry& entry = CryptonightR_cache[i];
-            if ((entry.variant == variant) && (entry.height + PRECOMPILATION_DEPTH < height))
+            if ((it->first.variant == variant) && (it->first.height + PRECOMPILATION_DEPTH < height))
             {
-                LOG_DEBUG("CryptonightR: program for height %" PRIu64 " released (old program)", entry.height);
-                old_programs.push_back(entry.program);
-                CryptonightR_cache[i] = std::move(CryptonightR_cache.back());
-                CryptonightR_cache.pop_back();
+                LOG_DEBUG("CryptonightR: program for height %" PRIu64 " released (old program)", it->first.height);
+                old_entries.push_back(std::move(it->second));
+                it = CryptonightR_cache.erase(it);
             }
             else
             {
-                ++i;
+                ++it;
             }
         }
     }
 
-    for (cl_program p : old_programs) {
-        OclLib::releaseProgram(p);
+    for (const CacheEntry& entry : old_entries) {
+        CryptonightR_release(entry);
     }
+}
+
+// builds for different device types run in parallel, identical devices wait for each other
+static std::mutex &CryptonightR_build_mutex(const std::string &device_string)
+{
+    static std::mutex mutex;
+    static std::map<std::string, std::mutex> mutexes;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return mutexes[device_string];
+}
+
+static std::mutex background_tasks_mutex;
+static std::condition_variable background_tasks_cv;
+static std::vector<BackgroundTask> background_tasks;
+static std::set<std::string> background_busy;
+static std::set<std::string> background_device_types;
+static std::vector<std::thread*> background_threads;
+
+// lowest height first, so height+1 is always ready before deeper lookahead, skipping device types already being built
+static std::vector<BackgroundTask>::iterator background_next_task()
+{
+    auto next = background_tasks.end();
+    for (auto it = background_tasks.begin(); it != background_tasks.end(); ++it) {
+        if (background_busy.count(it->ctx->DeviceString)) {
+            continue;
+        }
+
+        if (next == background_tasks.end() || it->height < next->height) {
+            next = it;
+        }
+    }
+
+    return next;
+}
+
+static void background_thread_proc()
+{
+    xmrig::Trace::setThreadName("CryptonightR");
+
+    // below the GPU and verification threads, but not idle like the prebuild, a new height waits for it
+    Platform::setThreadPriority(1);
+
+    for (;;) {
+        std::unique_lock<std::mutex> lock(background_tasks_mutex);
+
+        auto it = background_next_task();
+        while (it == background_tasks.end()) {
+            background_tasks_cv.wait(lock);
+            it = background_next_task();
+        }
 
-    std::lock_guard<std::mutex> g1(CryptonightR_build_mutex);
+        const BackgroundTask task = *it;
+        background_tasks.erase(it);
+        background_busy.insert(task.ctx->DeviceString);
+        lock.unlock();
+
+        OclLib::releaseProgram(CryptonightR_get_program(task.ctx, task.variant, task.height, false));
+
+        lock.lock();
+        background_busy.erase(task.ctx->DeviceString);
+        lock.unlock();
+
+        background_tasks_cv.notify_all();
+    }
+}
+
+static void background_exec(GpuContext* ctx, xmrig::Variant variant, uint64_t height)
+{
+    if (ctx->DeviceString.empty() && !OclCache::get_device_string(ctx->platformIdx, ctx->DeviceID, ctx->DeviceString)) {
+        return;
+    }
 
-    cl_program program = nullptr;
     {
-        std::lock_guard<std::mutex> g(CryptonightR_cache_mutex);
+        std::lock_guard<std::mutex> g(background_tasks_mutex);
 
-        // Check if the cache already has this program (some other thread might have added it first)
-        for (const CacheEntry& entry : CryptonightR_cache)
-        {
-            if ((entry.variant == variant) && (entry.height == height) && (entry.deviceIdx == ctx->deviceIdx) && (entry.hash == hash))
-            {
-                program = entry.program;
-                break;
+        for (const BackgroundTask& task : background_tasks) {
+            if ((task.ctx == ctx) && (task.variant == variant) && (task.height == height)) {
+                return;
             }
         }
+
+        background_tasks.emplace_back(ctx, variant, height);
+
+        // one compile thread per distinct device type
+        background_device_types.insert(ctx->DeviceString);
+        const size_t max_threads = static_cast<size_t>(xmrig::Cpu::info()->threads());
+        if (background_threads.size() < std::min(background_device_types.size(), static_cast<size_t>(max_threads))) {
+            background_threads.push_back(new std::thread(background_thread_proc));
+        }
+    }
+
+    background_tasks_cv.notify_one();
+}
+
+
+// on-disk binaries are named after variant and height, so programs of old heights can be found and deleted
+static std::string CryptonightR_file_name(xmrig::Variant variant, uint64_t height, const std::string &hash)
+{
+    char prefix[64];
+    snprintf(prefix, sizeof(prefix), "cnr%d_%" PRIu64 "_", static_cast<int>(variant), height);
+
+    return OclCache::fileName(prefix + hash);
+}
+
+
+static void CryptonightR_remove_old_files(xmrig::Variant variant, uint64_t height)
+{
+    const std::string dir = OclCache::directory();
+
+    uv_fs_t req;
+    if (uv_fs_scandir(uv_default_loop(), &req, dir.c_str(), 0, nullptr) < 0) {
+        uv_fs_req_cleanup(&req);
+        return;
+    }
+
+    uv_dirent_t ent;
+    while (uv_fs_scandir_next(&req, &ent) != UV_EOF) {
+        int file_variant;
+        uint64_t file_height;
+        if (ent.type != UV_DIRENT_FILE || sscanf(ent.name, "cnr%d_%" SCNu64 "_", &file_variant, &file_height) != 2) {
+            continue;
+        }
+
+        if ((file_variant == static_cast<int>(variant)) && (file_height + PRECOMPILATION_DEPTH < height))
+        {
+            OclCache::removeBinary(dir + ent.name);
+
+            LOG_DEBUG("CryptonightR: binary for height %" PRIu64 " deleted (old program)", file_height);
+        }
     }
 
+    uv_fs_req_cleanup(&req);
+}
+
+
+static cl_program CryptonightR_build_program(const GpuContext *ctx, xmrig::Variant variant, uint64_t height, const std::string &source, const std::string &options, const std::string &hash)
+{
+    CryptonightR_cache_remove_old(variant, height);
+
+    xmrig::Trace::Span span("CryptonightR build", static_cast<int64_t>(height));
+    std::lock_guard<std::mutex> g1(CryptonightR_build_mutex(ctx->DeviceString));
+
+    // Check if the cache already has this program (some other thread might have added it first)
+    const CacheKey key(variant, height, hash);
+    const ProgramKey programKey(ctx->opencl_ctx, ctx->deviceIdx);
+    std::shared_ptr<const std::string> binary;
+    cl_program program = CryptonightR_cache_find(key, programKey, &binary);
     if (program) {
         return program;
     }
 
-    cl_int ret;
-    const char* s = source.c_str();
-    program = OclLib::createProgramWithSource(ctx->opencl_ctx, 1, &s, nullptr, &ret);
-    if (ret != CL_SUCCESS)
-    {
-        LOG_ERR("CryptonightR: clCreateProgramWithSource returned error %s", OclError::toString(ret));
-        return nullptr;
+    if (binary && OclCache::buildBinary(ctx->opencl_ctx, ctx->DeviceID, binary->data(), binary->size(), program)) {
+        LOG_DEBUG("CryptonightR: program for height %" PRIu64 " loaded from identical GPU", height);
+
+        return CryptonightR_cache_add(key, programKey, program, binary);
     }
 
-    ret = OclLib::buildProgram(program, 1, &ctx->DeviceID, options.c_str());
-    if (ret != CL_SUCCESS) {
-        LOG_ERR("CryptonightR: clBuildProgram returned error %s", OclError::toString(ret));
-        printf("Build log:\n%s\n", OclLib::getProgramBuildLog(program, ctx->DeviceID).data());
+    const std::string fileName = CryptonightR_file_name(variant, height, hash);
+    const bool loaded = ctx->binaryCache && OclCache::loadBinary(ctx->opencl_ctx, ctx->DeviceID, fileName, program);
 
-        OclLib::releaseProgram(program);
-        return nullptr;
+    if (loaded) {
+        LOG_DEBUG("CryptonightR: program for height %" PRIu64 " loaded from %s", height, fileName.c_str());
     }
+    else {
+        cl_int ret;
+        const char* s = source.c_str();
+        program = OclLib::createProgramWithSource(ctx->opencl_ctx, 1, &s, nullptr, &ret);
+        if (ret != CL_SUCCESS)
+        {
+            LOG_ERR("CryptonightR: clCreateProgramWithSource returned error %s", OclError::toString(ret));
+            return nullptr;
+        }
 
-    ret = OclCache::wait_build(program, ctx->DeviceID);
-    if (ret != CL_SUCCESS) {
-        OclLib::releaseProgram(program);
-        LOG_ERR("CryptonightR: wait_build returned error %s", OclError::toString(ret));
-        return nullptr;
+        ret = OclLib::buildProgram(program, 1, &ctx->DeviceID, options.c_str());
+        if (ret != CL_SUCCESS) {
+            LOG_ERR("CryptonightR: clBuildProgram returned error %s", OclError::toString(ret));
+            printf("Build log:\n%s\n", OclLib::getProgramBuildLog(program, ctx->DeviceID).data());
+
+            OclLib::releaseProgram(program);
+            return nullptr;
+        }
+
+        ret = OclCache::wait_build(program, ctx->DeviceID);
+        if (ret != CL_SUCCESS) {
+            OclLib::releaseProgram(program);
+            LOG_ERR("CryptonightR: wait_build returned error %s", OclError::toString(ret));
+            return nullptr;
+        }
+
+        LOG_DEBUG("CryptonightR: program for height %" PRIu64 " compiled", height);
     }
 
-    LOG_DEBUG("CryptonightR: program for height %" PRIu64 " compiled", height);
+    std::string data;
+    if (OclCache::getBinary(program, ctx->DeviceID, data)) {
+        binary = std::make_shared<const std::string>(std::move(data));
 
-    {
-        std::lock_guard<std::mutex> g(CryptonightR_cache_mutex);
-        CryptonightR_cache.emplace_back(variant, height, ctx->deviceIdx, std::move(hash), program);
+        if (!loaded && ctx->binaryCache && OclCache::saveBinary(ctx->DeviceID, *binary, fileName)) {
+            CryptonightR_remove_old_files(variant, height);
+        }
     }
-    return program;
+
+    return CryptonightR_cache_add(key, programKey, program, binary);
 }
 
 
@@ -244,16 +458,17 @@ static bool is_64bit(xmrig::Variant variant)
 cl_program CryptonightR_get_program(GpuContext* ctx, xmrig::Variant variant, uint64_t height, bool background)
 {
     if (background) {
-        background_exec([=](){ CryptonightR_get_program(ctx, variant, height, false); });
+        background_exec(ctx, variant, height);
         return nullptr;
     }
 
-    const char* source_code_template =
+    const std::string source_code_template = OclSource::get("wolf-aes.cl",
         #include "opencl/wolf-aes.cl"
+    ) + OclSource::get("cryptonight_r.cl",
         #include "opencl/cryptonight_r.cl"
-    ;
+    );
     const char include_name[] = "XMRIG_INCLUDE_RANDOM_MATH";
-    const char* offset = strstr(source_code_template, include_name);
+    const char* offset = strstr(source_code_template.c_str(), include_name);
     if (!offset)
     {
         LOG_ERR("CryptonightR_get_program: XMRIG_INCLUDE_RANDOM_MATH not found in cryptonight_r.cl", variant);
@@ -275,7 +490,7 @@ cl_program CryptonightR_get_program(GpuContext* ctx, xmrig::Variant variant, uin
         return nullptr;
     }
 
-    std::string source_code(source_code_template, offset);
+    std::string source_code(source_code_template.c_str(), offset);
     source_code.append(get_code(code, code_size));
     source_code.append(offset + sizeof(include_name) - 1);
 
@@ -298,18 +513,10 @@ cl_program CryptonightR_get_program(GpuContext* ctx, xmrig::Variant variant, uin
     }
     OclCache::calc_hash(ctx->DeviceString, source, options, hash);
 
-    {
-        std::lock_guard<std::mutex> g(CryptonightR_cache_mutex);
-
-        // Check if the cache has this program
-        for (const CacheEntry& entry : CryptonightR_cache)
-        {
-            if ((entry.variant == variant) && (entry.height == height) && (entry.deviceIdx == ctx->deviceIdx) && (entry.hash == hash))
-            {
-                LOG_DEBUG("CryptonightR: program for height %" PRIu64 " found in cache", height);
-                return entry.program;
-            }
-        }
+    cl_program program = CryptonightR_cache_find(CacheKey(variant, height, hash), ProgramKey(ctx->opencl_ctx, ctx->deviceIdx));
+    if (program) {
+        LOG_DEBUG("CryptonightR: program for height %" PRIu64 " found in cache", height);
+        return program;
     }
 
     return CryptonightR_build_program(ctx, variant, height, source, options, hash);
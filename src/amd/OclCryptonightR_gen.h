@@ -30,9 +30,11 @@
 enum
 {
     PRECOMPILATION_DEPTH = 3,
+    CRYPTONIGHTR_CACHE_CAPACITY = 64,
 };
 static_assert((PRECOMPILATION_DEPTH >= 1) && (PRECOMPILATION_DEPTH <= 10), "Invalid precompilation depth");
 
+// returned program is retained, release it with OclLib::releaseProgram when done
 cl_program CryptonightR_get_program(GpuContext* ctx, xmrig::Variant variant, uint64_t height, bool background = false);
 
 #endif /* XMRIG_OCLCRYPTONIGHTR_GEN_H */
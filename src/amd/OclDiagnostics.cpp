@@ -0,0 +1,358 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+#include <thread>
+
+
+#include "amd/GpuContext.h"
+#include "amd/OclDiagnostics.h"
+#include "amd/OclError.h"
+#include "amd/OclGPU.h"
+#include "amd/OclKernelBench.h"
+#include "amd/OclLib.h"
+#include "common/log/Log.h"
+#include "common/utils/timestamp.h"
+#include "core/Config.h"
+#include "rapidjson/document.h"
+#include "workers/OclThread.h"
+
+
+// transfers of this size measure the PCIe bandwidth rather than the call overhead
+static const size_t kTransferSize = 32 * 1024 * 1024;
+static const int kTransfers       = 8;
+static const int kLatencyReads    = 64;
+
+// a riser or a link that trained at a lower width or speed halves the bandwidth at least, memory problems cost less
+static const double kMinTransferRatio = 0.5;
+static const double kMinCopyRatio     = 0.8;
+static const double kMaxLatencyRatio  = 2.0;
+
+
+static std::atomic<bool> running(false);
+static std::mutex mutex;
+static std::thread worker;
+static std::vector<xmrig::OclDiagnostics::Result> results;
+
+
+namespace {
+
+struct Device
+{
+    GpuContext ctx;
+    xmrig::OclDiagnostics::Result result;
+};
+
+}
+
+
+static inline double seconds(const std::chrono::steady_clock::time_point &start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+// the settings of the first thread of the GPU with a single work group, so the buffers fit next to mining threads
+static void baseContext(const xmrig::Config *config, size_t index, GpuContext *ctx)
+{
+    if (!xmrig::OclKernelBench::baseContext(config, xmrig::PA_INVALID, index, ctx)) {
+        return;
+    }
+
+    ctx->rawIntensity = ctx->workSize;
+    ctx->pipeline     = false;
+    ctx->persistent   = false;
+}
+
+
+static bool transfers(GpuContext *ctx, OclProfiles::Health *health)
+{
+    cl_int ret    = CL_SUCCESS;
+    cl_mem src    = OclLib::createBuffer(ctx->opencl_ctx, CL_MEM_READ_WRITE, kTransferSize, nullptr, &ret);
+    cl_mem dst    = ret == CL_SUCCESS ? OclLib::createBuffer(ctx->opencl_ctx, CL_MEM_READ_WRITE, kTransferSize, nullptr, &ret) : nullptr;
+    bool result   = ret == CL_SUCCESS;
+
+    std::vector<uint8_t> host(kTransferSize, 0x5A);
+    cl_command_queue queue = ctx->CommandQueues;
+
+    // the first write maps the buffer on the device
+    result = result && OclLib::enqueueWriteBuffer(queue, src, CL_TRUE, 0, kTransferSize, host.data(), 0, nullptr, nullptr) == CL_SUCCESS;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; result && i < kTransfers; ++i) {
+        result = OclLib::enqueueWriteBuffer(queue, src, CL_TRUE, 0, kTransferSize, host.data(), 0, nullptr, nullptr) == CL_SUCCESS;
+    }
+    health->h2d = kTransferSize * kTransfers / seconds(start) / 1e9;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; result && i < kTransfers; ++i) {
+        result = OclLib::enqueueReadBuffer(queue, src, CL_TRUE, 0, kTransferSize, host.data(), 0, nullptr, nullptr) == CL_SUCCESS;
+    }
+    health->d2h = kTransferSize * kTransfers / seconds(start) / 1e9;
+
+    // a copy reads and writes each byte
+    result = result && OclLib::enqueueCopyBuffer(queue, src, dst, 0, 0, kTransferSize, 0, nullptr, nullptr) == CL_SUCCESS && OclLib::finish(queue) == CL_SUCCESS;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; result && i < kTransfers; ++i) {
+        result = OclLib::enqueueCopyBuffer(queue, src, dst, 0, 0, kTransferSize, 0, nullptr, nullptr) == CL_SUCCESS;
+    }
+    result = result && OclLib::finish(queue) == CL_SUCCESS;
+    health->d2d = 2.0 * kTransferSize * kTransfers / seconds(start) / 1e9;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; result && i < kLatencyReads; ++i) {
+        result = OclLib::enqueueReadBuffer(queue, src, CL_TRUE, 0, sizeof(uint32_t), host.data(), 0, nullptr, nullptr) == CL_SUCCESS;
+    }
+    health->latency = seconds(start) / kLatencyReads * 1e6;
+
+    if (src) {
+        OclLib::releaseMemObject(src);
+    }
+
+    if (dst) {
+        OclLib::releaseMemObject(dst);
+    }
+
+    return result;
+}
+
+
+static void compare(xmrig::OclDiagnostics::Result &result, const char *name, double value, double expected, double ratio, const char *unit)
+{
+    if (expected <= 0.0 || (ratio < 1.0 ? value >= expected * ratio : value <= expected * ratio)) {
+        return;
+    }
+
+    char buf[96];
+    snprintf(buf, sizeof(buf), "%s%s %.2f %s, expected %.2f", result.reason.empty() ? "" : "; ", name, value, unit, expected);
+
+    result.degraded = true;
+    result.reason  += buf;
+}
+
+
+static void measure(xmrig::Config *config, Device &device)
+{
+    xmrig::OclDiagnostics::Result &result = device.result;
+    std::vector<cl_context> contexts;
+
+    result.index = device.ctx.deviceIdx;
+    result.time  = xmrig::currentMSecsSinceEpoch();
+    result.algo  = config->algorithm().shortName();
+
+    if (InitOpenCL(std::vector<GpuContext *>(1, &device.ctx), config, &contexts) != OCL_ERR_SUCCESS) {
+        result.degraded = true;
+        result.reason   = "OpenCL init failed";
+
+        ReleaseOpenCl(&device.ctx);
+        ReleaseOpenClContexts(contexts);
+        return;
+    }
+
+    result.board = device.ctx.board;
+
+    if (!transfers(&device.ctx, &result.health)) {
+        result.degraded = true;
+        result.reason   = "transfer failed";
+    }
+
+    result.verified = xmrig::OclKernelBench::verify(&device.ctx, config->algorithm());
+    if (!result.verified) {
+        result.degraded = true;
+        result.reason  += result.reason.empty() ? "wrong hashes" : "; wrong hashes";
+    }
+
+    ReleaseOpenCl(&device.ctx);
+    ReleaseOpenClContexts(contexts);
+}
+
+
+// the expected values are looked up before, so the worker thread does not read the profiles
+static void finish(Device &device, bool colors)
+{
+    xmrig::OclDiagnostics::Result &result = device.result;
+
+    if (result.baseline) {
+        compare(result, "h2d", result.health.h2d, result.expected.h2d, kMinTransferRatio, "GB/s");
+        compare(result, "d2h", result.health.d2h, result.expected.d2h, kMinTransferRatio, "GB/s");
+
+        if (!result.mining) {
+            compare(result, "d2d",     result.health.d2d,     result.expected.d2d,     kMinCopyRatio,    "GB/s");
+            compare(result, "latency", result.health.latency, result.expected.latency, kMaxLatencyRatio, "us");
+        }
+    }
+
+    Log::i()->text(colors
+        ? GREEN_BOLD(" * ") WHITE_BOLD("GPU #%zu diagnostics: ") "h2d " CYAN_BOLD("%.2f") " d2h " CYAN_BOLD("%.2f") " d2d " CYAN_BOLD("%.1f") " GB/s, latency " CYAN_BOLD("%.0f") " us, %s %s"
+        : " * GPU #%zu diagnostics: h2d %.2f d2h %.2f d2d %.1f GB/s, latency %.0f us, %s %s",
+        result.index, result.health.h2d, result.health.d2h, result.health.d2d, result.health.latency, result.algo.data(), result.verified ? "ok" : "wrong hashes"
+    );
+
+    if (result.degraded) {
+        LOG_WARN("GPU #%zu \"%s\" is degraded: %s", result.index, result.board.data(), result.reason.c_str());
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (xmrig::OclDiagnostics::Result &previous : results) {
+        if (previous.index == result.index) {
+            previous = result;
+            return;
+        }
+    }
+
+    results.push_back(result);
+}
+
+
+bool xmrig::OclDiagnostics::isRunning()
+{
+    return running.load(std::memory_order_acquire);
+}
+
+
+// the GPUs are measured one after the other, so they do not share the bus during the transfers
+bool xmrig::OclDiagnostics::start(Config *config, const std::vector<size_t> &gpus)
+{
+    if (running.exchange(true)) {
+        return false;
+    }
+
+    release();
+
+    std::vector<Device> *devices = new std::vector<Device>(gpus.size());
+    for (size_t i = 0; i < gpus.size(); ++i) {
+        Device &device = (*devices)[i];
+        baseContext(config, gpus[i], &device.ctx);
+
+        device.result.mining = true;
+
+        // the running threads know the board and driver of the GPU
+        for (const IThread *thread : config->threads()) {
+            if (thread->index() == gpus[i]) {
+                device.result.baseline = OclProfiles::findHealth(*static_cast<const OclThread *>(thread)->ctx(), device.result.expected);
+                break;
+            }
+        }
+    }
+
+    const bool colors = config->isColors();
+
+    worker = std::thread([config, devices, colors]() {
+        for (Device &device : *devices) {
+            measure(config, device);
+            finish(device, colors);
+        }
+
+        delete devices;
+        running.store(false, std::memory_order_release);
+    });
+
+    return true;
+}
+
+
+void xmrig::OclDiagnostics::release()
+{
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+
+// before the threads start, the first healthy result of a GPU without a baseline becomes its baseline
+void xmrig::OclDiagnostics::run(Config *config)
+{
+    std::vector<size_t> gpus;
+    for (const IThread *thread : config->threads()) {
+        if (std::find(gpus.begin(), gpus.end(), thread->index()) == gpus.end()) {
+            gpus.push_back(thread->index());
+        }
+    }
+
+    for (const size_t index : gpus) {
+        Device device;
+        baseContext(config, index, &device.ctx);
+
+        measure(config, device);
+
+        device.result.baseline = OclProfiles::findHealth(device.ctx, device.result.expected);
+        finish(device, config->isColors());
+
+        if (!device.result.baseline && !device.result.degraded) {
+            OclProfiles::updateHealth(device.ctx, device.result.health);
+        }
+    }
+}
+
+
+#ifndef XMRIG_NO_API
+void xmrig::OclDiagnostics::toJSON(rapidjson::Document &doc)
+{
+    using namespace rapidjson;
+
+    doc.SetObject();
+    auto &allocator = doc.GetAllocator();
+
+    doc.AddMember("running", isRunning(), allocator);
+
+    auto health = [&allocator](const OclProfiles::Health &value) {
+        Value object(kObjectType);
+        object.AddMember("h2d",        value.h2d, allocator);
+        object.AddMember("d2h",        value.d2h, allocator);
+        object.AddMember("d2d",        value.d2d, allocator);
+        object.AddMember("latency_us", value.latency, allocator);
+
+        return object;
+    };
+
+    Value gpus(kArrayType);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (const Result &result : results) {
+        Value gpu(kObjectType);
+        gpu.AddMember("index",    static_cast<uint64_t>(result.index), allocator);
+        gpu.AddMember("board",    result.board.toJSON(doc), allocator);
+        gpu.AddMember("time",     result.time, allocator);
+        gpu.AddMember("algo",     result.algo.toJSON(doc), allocator);
+        gpu.AddMember("verified", result.verified, allocator);
+        gpu.AddMember("mining",   result.mining, allocator);
+        gpu.AddMember("degraded", result.degraded, allocator);
+        gpu.AddMember("reason",   result.reason.empty() ? Value(kNullType) : Value(result.reason.c_str(), allocator), allocator);
+        gpu.AddMember("health",   health(result.health), allocator);
+        gpu.AddMember("expected", result.baseline ? health(result.expected) : Value(kNullType), allocator);
+
+        gpus.PushBack(gpu, allocator);
+    }
+
+    doc.AddMember("gpus", gpus, allocator);
+}
+#endif
@@ -0,0 +1,87 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef XMRIG_OCLDIAGNOSTICS_H
+#define XMRIG_OCLDIAGNOSTICS_H
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+#include "amd/OclProfiles.h"
+#include "base/tools/String.h"
+#include "rapidjson/fwd.h"
+
+
+namespace xmrig {
+
+
+class Config;
+
+
+// short health check of GPUs on a context of their own: host to device and device to host bandwidth of blocking
+// 32 MiB transfers, latency of a blocking 4 byte read, on-device copy bandwidth and a run of the current algo on a
+// single work group checked against the known hashes. The results are compared with the health profile of the GPU
+// (OclProfiles::findHealth), slow transfers or wrong hashes flag the GPU as degraded. --diagnostics runs it before
+// the threads allocate their buffers and saves the first result of a GPU as its baseline, PUT /1/diagnostics runs it
+// on a thread while mining, GET /1/diagnostics returns the last results.
+class OclDiagnostics
+{
+public:
+    struct Result
+    {
+        inline Result() : index(0), time(0), baseline(false), degraded(false), mining(false), verified(false) {}
+
+        size_t index;
+        int64_t time;               // ms since the epoch
+        bool baseline;              // expected values were found
+        bool degraded;
+        bool mining;                // measured next to the mining threads, d2d and latency are not compared then
+        bool verified;              // the hashes of the current algo were correct
+        OclProfiles::Health health;
+        OclProfiles::Health expected;
+        String algo;
+        String board;
+        std::string reason;         // what is below the expected values
+    };
+
+    static bool isRunning();
+    static bool start(Config *config, const std::vector<size_t> &gpus);
+    static void release();
+    static void run(Config *config);
+
+#   ifndef XMRIG_NO_API
+    static void toJSON(rapidjson::Document &doc);
+#   endif
+};
+
+
+} /* namespace xmrig */
+
+
+#endif /* XMRIG_OCLDIAGNOSTICS_H */
@@ -26,30 +26,110 @@
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <math.h>
-#include <regex>
+#include <mutex>
 #include <stdio.h>
 #include <string.h>
+#include <thread>
 #include <vector>
 #include <inttypes.h>
 
 
+#include "amd/GpuMemory.h"
 #include "amd/OclCache.h"
 #include "amd/OclError.h"
 #include "amd/OclGPU.h"
 #include "amd/OclLib.h"
 #include "amd/OclCryptonightR_gen.h"
+#include "amd/OclSource.h"
 #include "common/log/Log.h"
+#include "common/Platform.h"
 #include "common/utils/timestamp.h"
 #include "core/Config.h"
+#include "core/StartupProfile.h"
+#include "core/Trace.h"
 #include "crypto/CryptoNight_constants.h"
 #include "cryptonight.h"
+#include "workers/OclThread.h"
 
 
 constexpr const char *kSetKernelArgErr = "Error %s when calling clSetKernelArg for kernel %d, argument %d.";
 
 
+// threads on the same GPU use own command queues, their cn1 kernels are chained with events
+// so the memory hard phase of one queue runs while the other queues do cn0, cn2 and final hashes
+struct DeviceQueueSync
+{
+    std::mutex mutex;
+    cl_event cn1 = nullptr;
+};
+
+
+static std::mutex deviceQueueSyncMutex;
+static std::map<size_t, DeviceQueueSync> deviceQueueSyncMap;
+
+
+static DeviceQueueSync &deviceQueueSync(size_t deviceIdx)
+{
+    std::lock_guard<std::mutex> lock(deviceQueueSyncMutex);
+
+    return deviceQueueSyncMap[deviceIdx];
+}
+
+
+// the blob of a published job is written to the input buffer of a thread the kernels don't read, behind the batches
+// in flight on its queue, XMRSetJob then only binds that buffer. The host copy of each buffer is read by its write
+// until the event completes, ready is set while the queue and buffers of the thread exist. The generation of a persistent
+// thread is counted with the jobs, it is written to Control and each batch carries the value at its enqueue
+struct JobStage
+{
+    std::mutex mutex;
+    bool ready  = false;
+    int staged  = -1;
+    cl_uint generation = 0;
+    cl_event events[2] = { nullptr, nullptr };
+    uint8_t inputs[2][128];
+};
+
+
+static std::mutex jobStageMutex;
+static std::map<const GpuContext *, JobStage> jobStageMap;
+
+
+static JobStage &jobStage(const GpuContext *ctx)
+{
+    std::lock_guard<std::mutex> lock(jobStageMutex);
+
+    return jobStageMap[ctx];
+}
+
+
+// one allocation per device, every thread of the device has own slot sized for the largest of its algorithms,
+// buffers are sub-buffers of the slot and only these views are created again on algorithm switch,
+// the map is filled before initDevices and read only while devices are initialized
+struct DeviceArena
+{
+    cl_mem buffer = nullptr;
+    size_t align  = 0;
+    std::vector<size_t> offsets;
+    std::vector<size_t> sizes;
+};
+
+
+// input, scratchpads, states, 4 branches and output
+constexpr const size_t kArenaBuffers = 8;
+
+// poll interval of low CPU mode in us, once the calibrated sleep ran out
+constexpr const int64_t kSyncPoll = 200;
+
+
+static std::map<size_t, DeviceArena> deviceArenaMap;
+
+
 inline static const char *err_to_str(cl_int ret)
 {
     return OclError::toString(ret);
@@ -68,6 +148,18 @@ inline static bool setKernelArgFromExtraBuffers(GpuContext *ctx, size_t kernel,
 }
 
 
+inline static bool setKernelArg(GpuContext *ctx, size_t kernel, cl_uint argument, size_t size, const void *value)
+{
+    cl_int ret;
+    if ((ret = OclLib::setKernelArg(ctx->Kernels[kernel], argument, size, value)) != CL_SUCCESS) {
+        LOG_ERR(kSetKernelArgErr, err_to_str(ret), kernel, argument);
+        return false;
+    }
+
+    return true;
+}
+
+
 inline static int cn0KernelOffset(xmrig::Variant variant)
 {
 #   ifndef XMRIG_NO_CN_GPU
@@ -104,9 +196,6 @@ inline static int cn1KernelOffset(xmrig::Variant variant)
     case xmrig::VARIANT_TRTL:
         return 11;
 
-    case xmrig::VARIANT_HALF:
-        return 12;
-
     // 13, 14 reserved for cn/gpu cn0
 
 #   ifndef XMRIG_NO_CN_GPU
@@ -114,16 +203,7 @@ inline static int cn1KernelOffset(xmrig::Variant variant)
         return 15;
 #   endif
 
-    // 16 reserved for cn/gpu cn2
-
-    case xmrig::VARIANT_RWZ:
-        return 17;
-
-    case xmrig::VARIANT_ZLS:
-        return 18;
-
-    case xmrig::VARIANT_DOUBLE:
-        return 19;
+    // 16 reserved for cn/gpu cn2, 17-19 unused
 
     case xmrig::VARIANT_WOW:
     case xmrig::VARIANT_4:
@@ -133,11 +213,33 @@ inline static int cn1KernelOffset(xmrig::Variant variant)
         break;
     }
 
+    // the other forks of variant 2 (half, rwz, zls, double) differ only by the parameters of cn_variants
+    if (xmrig::cn_is_known(variant) && xmrig::cn_base_variant(variant) == xmrig::VARIANT_2) {
+        return 12;
+    }
+
     assert(false);
 
     return 0;
 }
 
+// only the cn1_v2_monero kernel computes several hashes per work item, NVIDIA builds always use one
+inline static size_t cn1HashesPerItem(const GpuContext *ctx, xmrig::Variant variant)
+{
+    if (ctx->hashesPerItem <= 1 || ctx->vendor == xmrig::OCL_VENDOR_NVIDIA || cn1KernelOffset(variant) != 11) {
+        return 1;
+    }
+
+    return static_cast<size_t>(ctx->hashesPerItem);
+}
+
+// number of work items of the Finalize kernel, one per hash of all 4 branches, cn/gpu does not use it
+inline static size_t finalThreads(const GpuContext *ctx)
+{
+    return ((ctx->rawIntensity + ctx->workSize - 1u) / ctx->workSize) * ctx->workSize;
+}
+
+
 inline static int cn2KernelOffset(xmrig::Variant variant)
 {
 #   ifndef XMRIG_NO_CN_GPU
@@ -150,22 +252,59 @@ inline static int cn2KernelOffset(xmrig::Variant variant)
 }
 
 
-static void printGPU(int index, GpuContext *ctx, xmrig::Config *config)
+// kernel slots used by all variants which may come with jobs of the algorithm without an algo switch,
+// variant is set if there is only one of them
+static uint32_t kernelsMask(const xmrig::Algorithm &algorithm, xmrig::Variant *variant)
 {
-    const size_t memSize             = xmrig::cn_select_memory(config->algorithm().algo()) * ctx->rawIntensity;
-    constexpr const size_t byteToGiB = 1024u * 1024u * 1024u;
-    size_t maximumWorkSize           = 0;
+    uint32_t mask  = 0;
+    size_t count   = 0;
+    *variant       = xmrig::VARIANT_AUTO;
+
+    for (int v = 0; v < xmrig::VARIANT_MAX; ++v) {
+        const xmrig::Algorithm candidate(algorithm.algo(), static_cast<xmrig::Variant>(v));
+        if (!candidate.isValid() || candidate.perf_algo() != algorithm.perf_algo()) {
+            continue;
+        }
+
+#       ifdef XMRIG_NO_CN_GPU
+        if (candidate.variant() == xmrig::VARIANT_GPU) {
+            continue;
+        }
+#       endif
+
+        mask |= 1U << cn0KernelOffset(candidate.variant());
+        mask |= 1U << cn2KernelOffset(candidate.variant());
+
+        if (candidate.variant() == xmrig::VARIANT_GPU) {
+            mask |= 1U << (cn0KernelOffset(candidate.variant()) + 1);
+        }
+        else {
+            mask |= 1U << 3;
+        }
+
+        // CryptonightR kernels are built at runtime, see XMRSetJob
+        const int cn1 = cn1KernelOffset(candidate.variant());
+        if (cn1 < 20) {
+            mask |= 1U << cn1;
+        }
+
+        *variant = candidate.variant();
+        count++;
+    }
 
-    OclLib::getDeviceInfo(ctx->DeviceID, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(size_t), &maximumWorkSize);
+    if (count != 1) {
+        *variant = xmrig::VARIANT_AUTO;
+    }
 
-    ctx->name         = OclLib::getDeviceName(ctx->DeviceID);
-    ctx->board        = OclLib::getDeviceBoardName(ctx->DeviceID);
-    ctx->computeUnits = OclLib::getDeviceMaxComputeUnits(ctx->DeviceID);
+    return mask;
+}
 
-    OclLib::getDeviceInfo(ctx->DeviceID, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(size_t), &ctx->freeMem);
-    OclLib::getDeviceInfo(ctx->DeviceID, CL_DEVICE_GLOBAL_MEM_SIZE,    sizeof(size_t), &ctx->globalMem);
 
-    ctx->freeMem = std::min(ctx->freeMem, ctx->globalMem);
+static void printGPU(int index, GpuContext *ctx, xmrig::Config *config)
+{
+    const size_t memSize             = xmrig::cn_select_memory(config->algorithm().algo()) * ctx->rawIntensity;
+    constexpr const size_t byteToGiB = 1024u * 1024u * 1024u;
+    const size_t maximumWorkSize     = ctx->caps.maxWorkGroupSize;
 
     if (ctx->name == ctx->board) {
         LOG_INFO(config->isColors() ? WHITE_BOLD("#%02d") ", GPU " WHITE_BOLD("#%02zu") " " GREEN_BOLD("%s") ", i:" WHITE_BOLD("%zu") " " GRAY("(%zu/%zu)")
@@ -186,707 +325,2406 @@ static void printGPU(int index, GpuContext *ctx, xmrig::Config *config)
 }
 
 
-size_t InitOpenCLGpu(int index, cl_context opencl_ctx, GpuContext* ctx, const char* source_code, xmrig::Config *config)
+static inline cl_mem *activeInput(GpuContext *ctx)
 {
-    ctx->opencl_ctx = opencl_ctx;
+    return ctx->inputSlot ? &ctx->StageBuffer : &ctx->InputBuffer;
+}
 
-    printGPU(index, ctx, config);
 
-    cl_int ret;
-    ctx->CommandQueues = OclLib::createCommandQueue(opencl_ctx, ctx->DeviceID, &ret);
-    if (ret != CL_SUCCESS) {
-        return OCL_ERR_API;
-    }
+// all cn1 kernels except cn/gpu share the same signature, the variant argument is set per job
+static bool setCn1KernelArgs(GpuContext *ctx, size_t kernel)
+{
+    const cl_uint numThreads = static_cast<cl_uint>(ctx->rawIntensity);
+    const cl_uint generation = 0;
+
+    // Scratchpads, States, input, Threads, Control, Generation, a persistent thread sets the generation of each batch
+    return setKernelArgFromExtraBuffers(ctx, kernel, 0, 0) &&
+           setKernelArgFromExtraBuffers(ctx, kernel, 1, 1) &&
+           setKernelArg(ctx, kernel, 3, sizeof(cl_mem), activeInput(ctx)) &&
+           setKernelArg(ctx, kernel, 4, sizeof(cl_uint), &numThreads) &&
+           setKernelArg(ctx, kernel, 5, sizeof(cl_mem), &ctx->ControlBuffer) &&
+           setKernelArg(ctx, kernel, 6, sizeof(cl_uint), &generation);
+}
 
-    ctx->InputBuffer = OclLib::createBuffer(opencl_ctx, CL_MEM_READ_ONLY, 128, nullptr, &ret);
-    if (ret != CL_SUCCESS) {
-        LOG_ERR("Error %s when calling clCreateBuffer to create input buffer.", err_to_str(ret));
-        return OCL_ERR_API;
+
+static bool setCn0KernelArgs(GpuContext *ctx)
+{
+    const cl_uint numThreads = static_cast<cl_uint>(ctx->rawIntensity);
+
+    // CN0 Kernel: input, Scratchpads, States, Threads
+    if (!setKernelArg(ctx, 0, 0, sizeof(cl_mem), activeInput(ctx)) ||
+        !setKernelArgFromExtraBuffers(ctx, 0, 1, 0) ||
+        !setKernelArgFromExtraBuffers(ctx, 0, 2, 1) ||
+        !setKernelArg(ctx, 0, 3, sizeof(cl_uint), &numThreads)) {
+        return false;
     }
 
-    size_t g_thd = ctx->rawIntensity;
-    ctx->ExtraBuffers[0] = OclLib::createBuffer(opencl_ctx, CL_MEM_READ_WRITE, xmrig::cn_select_memory(config->algorithm().algo()) * g_thd, nullptr, &ret);
-    if (ret != CL_SUCCESS) {
-        LOG_ERR("Error %s when calling clCreateBuffer to create hash scratchpads buffer.", err_to_str(ret));
-        return OCL_ERR_API;
+    // Branch 0-3 and Output, the counters are reset by the kernel
+    for (size_t i = 0; i < 4; ++i) {
+        if (!setKernelArgFromExtraBuffers(ctx, 0, i + 4, i + 2)) {
+            return false;
+        }
     }
 
-    ctx->ExtraBuffers[1] = OclLib::createBuffer(opencl_ctx, CL_MEM_READ_WRITE, 200 * g_thd, nullptr, &ret);
-    if(ret != CL_SUCCESS) {
-        LOG_ERR("Error %s when calling clCreateBuffer to create hash states buffer.", err_to_str(ret));
-        return OCL_ERR_API;
+    return setKernelArg(ctx, 0, 8, sizeof(cl_mem), &ctx->OutputBuffer);
+}
+
+
+static bool setFinalizeKernelArgs(GpuContext *ctx)
+{
+    const cl_uint numThreads = static_cast<cl_uint>(ctx->rawIntensity);
+
+    // Finalize Kernel: States, Branch 0-3, Output, Threads
+    // the number of nonces in each branch is read on the device from Branch[Threads]
+    if (!setKernelArgFromExtraBuffers(ctx, 3, 0, 1)) {
+        return false;
     }
 
-    // Blake-256 branches
-    ctx->ExtraBuffers[2] = OclLib::createBuffer(opencl_ctx, CL_MEM_READ_WRITE, sizeof(cl_uint) * (g_thd + 2), nullptr, &ret);
-    if (ret != CL_SUCCESS){
-        LOG_ERR("Error %s when calling clCreateBuffer to create Branch 0 buffer.", err_to_str(ret));
-        return OCL_ERR_API;
+    for (size_t i = 0; i < 4; ++i) {
+        if (!setKernelArgFromExtraBuffers(ctx, 3, i + 1, i + 2)) {
+            return false;
+        }
     }
 
-    // Groestl-256 branches
-    ctx->ExtraBuffers[3] = OclLib::createBuffer(opencl_ctx, CL_MEM_READ_WRITE, sizeof(cl_uint) * (g_thd + 2), nullptr, &ret);
-    if(ret != CL_SUCCESS) {
-        LOG_ERR("Error %s when calling clCreateBuffer to create Branch 1 buffer.", err_to_str(ret));
-        return OCL_ERR_API;
+    return setKernelArg(ctx, 3, 5, sizeof(cl_mem), &ctx->OutputBuffer) &&
+           setKernelArg(ctx, 3, 7, sizeof(cl_uint), &numThreads);
+}
+
+
+#ifndef XMRIG_NO_CN_GPU
+static bool setCnGpuKernelArgs(GpuContext *ctx)
+{
+    const cl_uint numThreads = static_cast<cl_uint>(ctx->rawIntensity);
+
+    // cn/gpu: cn0 kernel input, Scratchpads, States, Threads, Output
+    if (!setKernelArg(ctx, 13, 0, sizeof(cl_mem), activeInput(ctx)) ||
+        !setKernelArgFromExtraBuffers(ctx, 13, 1, 0) ||
+        !setKernelArgFromExtraBuffers(ctx, 13, 2, 1) ||
+        !setKernelArg(ctx, 13, 3, sizeof(cl_uint), &numThreads) ||
+        !setKernelArg(ctx, 13, 4, sizeof(cl_mem), &ctx->OutputBuffer)) {
+        return false;
     }
 
-    // JH-256 branches
-    ctx->ExtraBuffers[4] = OclLib::createBuffer(opencl_ctx, CL_MEM_READ_WRITE, sizeof(cl_uint) * (g_thd + 2), nullptr, &ret);
-    if (ret != CL_SUCCESS) {
-        LOG_ERR("Error %s when calling clCreateBuffer to create Branch 2 buffer.", err_to_str(ret));
-        return OCL_ERR_API;
+    // we use an additional cn0 kernel to prepare the scratchpad: Scratchpads, States
+    if (!setKernelArgFromExtraBuffers(ctx, 14, 0, 0) || !setKernelArgFromExtraBuffers(ctx, 14, 1, 1)) {
+        return false;
     }
 
-    // Skein-512 branches
-    ctx->ExtraBuffers[5] = OclLib::createBuffer(opencl_ctx, CL_MEM_READ_WRITE, sizeof(cl_uint) * (g_thd + 2), nullptr, &ret);
-    if (ret != CL_SUCCESS) {
-        LOG_ERR("Error %s when calling clCreateBuffer to create Branch 3 buffer.", err_to_str(ret));
-        return OCL_ERR_API;
+    // cn1: Scratchpads, States, Threads
+    if (!setKernelArgFromExtraBuffers(ctx, 15, 0, 0) ||
+        !setKernelArgFromExtraBuffers(ctx, 15, 1, 1) ||
+        !setKernelArg(ctx, 15, 2, sizeof(cl_uint), &numThreads)) {
+        return false;
     }
 
-    // Assume we may find up to 0xFF nonces in one run - it's reasonable
-    ctx->OutputBuffer = OclLib::createBuffer(opencl_ctx, CL_MEM_READ_WRITE, sizeof(cl_uint) * 0x100, nullptr, &ret);
-    if (ret != CL_SUCCESS) {
-        LOG_ERR("Error %s when calling clCreateBuffer to create output buffer.", err_to_str(ret));
-        return OCL_ERR_API;
+    // cn2: Scratchpads, States, Output, Threads
+    if (!setKernelArgFromExtraBuffers(ctx, 16, 0, 0) ||
+        !setKernelArgFromExtraBuffers(ctx, 16, 1, 1) ||
+        !setKernelArg(ctx, 16, 2, sizeof(cl_mem), &ctx->OutputBuffer) ||
+        !setKernelArg(ctx, 16, 4, sizeof(cl_uint), &numThreads)) {
+        return false;
     }
 
-    OclCache cache(index, opencl_ctx, ctx, source_code, config);
-    if (!cache.load()) {
-        return OCL_ERR_API;
+    return true;
+}
+#endif
+
+
+// bind arguments which stays the same for the whole context lifetime,
+// kernels left out of a specialized program are skipped
+static bool setStaticKernelArgs(GpuContext *ctx)
+{
+    const cl_uint numThreads = static_cast<cl_uint>(ctx->rawIntensity);
+
+    if (ctx->Kernels[0] && !setCn0KernelArgs(ctx)) {
+        return false;
     }
 
-    const char *KernelNames[] = {
-        "cn0", "cn1", "cn2",
-        "Blake", "Groestl", "JH", "Skein",
-        "cn1_monero", "cn1_msr", "cn1_xao", "cn1_tube", "cn1_v2_monero", "cn1_v2_half",
-#       ifndef XMRIG_NO_CN_GPU
-        "cn0_cn_gpu", "cn00_cn_gpu", "cn1_cn_gpu", "cn2_cn_gpu",
-#       else
-        "", "", "", "",
-#       endif
-        "cn1_v2_rwz", "cn1_v2_zls", "cn1_v2_double",
+    // CN1 Kernels
+    const size_t cn1Kernels[] = { 1, 7, 8, 9, 10, 11, 12 };
+    for (size_t kernel : cn1Kernels) {
+        if (ctx->Kernels[kernel] && !setCn1KernelArgs(ctx, kernel)) {
+            return false;
+        }
+    }
 
-        nullptr
-    };
-    for (int i = 0; KernelNames[i]; ++i) {
-        if (!KernelNames[i][0]) {
-            continue;
+    // CN2 Kernel: Scratchpads, States, Branch 0-3, Threads, Control, Generation
+    if (ctx->Kernels[2]) {
+        for (size_t i = 0; i < 6; ++i) {
+            if (!setKernelArgFromExtraBuffers(ctx, 2, i, i)) {
+                return false;
+            }
         }
 
-        ctx->Kernels[i] = OclLib::createKernel(ctx->Program, KernelNames[i], &ret);
-        if (ret != CL_SUCCESS) {
-            return OCL_ERR_API;
+        const cl_uint generation = 0;
+        if (!setKernelArg(ctx, 2, 6, sizeof(cl_uint), &numThreads) ||
+            !setKernelArg(ctx, 2, 7, sizeof(cl_mem), &ctx->ControlBuffer) ||
+            !setKernelArg(ctx, 2, 8, sizeof(cl_uint), &generation)) {
+            return false;
         }
     }
 
-    ctx->Nonce = 0;
-    return 0;
+    if (ctx->Kernels[3] && !setFinalizeKernelArgs(ctx)) {
+        return false;
+    }
+
+#   ifndef XMRIG_NO_CN_GPU
+    if (ctx->Kernels[13] && !setCnGpuKernelArgs(ctx)) {
+        return false;
+    }
+#   endif
+
+    return true;
 }
 
 
-int OclGPU::findPlatformIdx(xmrig::Config *config)
+// the kernels which read the job blob switch to the other input buffer
+static bool bindInput(GpuContext *ctx, size_t slot)
 {
-    assert(config->vendor() > xmrig::OCL_VENDOR_MANUAL);
+    ctx->inputSlot = slot;
 
-#   if !defined(__APPLE__)
-    char name[256]  = { 0 };
-    const int index = findPlatformIdx(config->vendor(), name, sizeof name);
+    const size_t kernels[] = { 0, 1, 7, 8, 9, 10, 11, 12, 13, 20 };
+    for (size_t kernel : kernels) {
+        const cl_uint arg = (kernel == 0 || kernel == 13) ? 0 : 3;
 
-    if (index >= 0) {
-        LOG_INFO(config->isColors() ? GREEN_BOLD("found ") WHITE_BOLD("%s") " platform index: " WHITE_BOLD("%d") ", name: " WHITE_BOLD("%s")
-                                    : "found %s platform index: %d, name: %s",
-                 config->vendorName(config->vendor()), index , name);
+        if (ctx->Kernels[kernel] && !setKernelArg(ctx, kernel, arg, sizeof(cl_mem), activeInput(ctx))) {
+            return false;
+        }
     }
 
-    return index;
-#   else
-    return 0;
-#   endif
+    return true;
 }
 
 
-std::vector<GpuContext> OclGPU::getDevices(xmrig::Config *config)
+// the stage lock is held, a write still reading the host copy of the buffer is waited for
+static cl_int writeInput(GpuContext *ctx, JobStage &stage, size_t slot, const uint8_t *input)
 {
-    const size_t platformIndex            = static_cast<size_t>(config->platformIndex());
-    std::vector<cl_platform_id> platforms = OclLib::getPlatformIDs();
-    std::vector<GpuContext> ctxVec;
-
-    cl_uint num_devices = 0;
-    OclLib::getDeviceIDs(platforms[platformIndex], CL_DEVICE_TYPE_GPU, 0, nullptr, &num_devices);
-    if (num_devices == 0) {
-        return ctxVec;
+    if (stage.events[slot]) {
+        OclLib::waitForEvents(1, &stage.events[slot]);
+        OclLib::releaseEvent(stage.events[slot]);
+        stage.events[slot] = nullptr;
     }
 
-    cl_device_id *device_list = new cl_device_id[num_devices];
-    OclLib::getDeviceIDs(platforms[platformIndex], CL_DEVICE_TYPE_GPU, num_devices, device_list, nullptr);
+    memcpy(stage.inputs[slot], input, sizeof(stage.inputs[slot]));
 
-    for (cl_uint i = 0; i < num_devices; i++) {
-        GpuContext ctx;
-        ctx.deviceIdx    = i;
-        ctx.platformIdx  = platformIndex;
-        ctx.DeviceID     = device_list[i];
-        ctx.computeUnits = OclLib::getDeviceMaxComputeUnits(ctx.DeviceID);
-        ctx.vendor       = OclLib::getDeviceVendor(ctx.DeviceID);
+    return OclLib::enqueueWriteBuffer(ctx->CommandQueues, slot ? ctx->StageBuffer : ctx->InputBuffer, CL_FALSE, 0, 128, stage.inputs[slot], 0, nullptr, &stage.events[slot]);
+}
 
-        if (ctx.vendor == xmrig::OCL_VENDOR_UNKNOWN) {
-            continue;
-        }
 
-        OclLib::getDeviceInfo(ctx.DeviceID, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(size_t), &ctx.freeMem);
-        OclLib::getDeviceInfo(ctx.DeviceID, CL_DEVICE_GLOBAL_MEM_SIZE,    sizeof(size_t), &ctx.globalMem);
-        // if environment variable GPU_SINGLE_ALLOC_PERCENT is not set we can not allocate the full memory
-        ctx.freeMem = std::min(ctx.freeMem, ctx.globalMem);
+static inline size_t alignArena(size_t size, size_t align)
+{
+    return (size + align - 1) / align * align;
+}
 
-        ctx.board = OclLib::getDeviceBoardName(ctx.DeviceID);
-        ctx.name  = OclLib::getDeviceName(ctx.DeviceID);
 
-        if (ctx.board == ctx.name) {
-            LOG_INFO(config->isColors() ? GREEN_BOLD("found") " OpenCL GPU: " GREEN_BOLD("%s") ", cu: " WHITE_BOLD("%d")
-                                        : "found OpenCL GPU: %s, cu:",
-                     ctx.name.data(), ctx.computeUnits);
+// returns the size of the slot of a thread, all sub-buffers start at align
+static size_t arenaLayout(size_t intensity, size_t memory, size_t align, size_t *sizes = nullptr, size_t *offsets = nullptr)
+{
+    const size_t layout[kArenaBuffers] = {
+        128,
+        memory * intensity,
+        200 * intensity,
+        sizeof(cl_uint) * (intensity + 2),
+        sizeof(cl_uint) * (intensity + 2),
+        sizeof(cl_uint) * (intensity + 2),
+        sizeof(cl_uint) * (intensity + 2),
+        sizeof(cl_uint) * OCL_RESULT_SIZE
+    };
+
+    size_t size = 0;
+    for (size_t i = 0; i < kArenaBuffers; ++i) {
+        if (sizes) {
+            sizes[i] = layout[i];
         }
-        else {
-            LOG_INFO(config->isColors() ? GREEN_BOLD("found") " OpenCL GPU: " GREEN_BOLD("%s") " ("  CYAN_BOLD("%s") "), cu: " WHITE_BOLD("%d")
-                                        : "found OpenCL GPU: %s (%s), cu:",
-                     ctx.board.data(), ctx.name.data(), ctx.computeUnits);
+
+        if (offsets) {
+            offsets[i] = size;
         }
 
-        ctxVec.push_back(ctx);
+        size += alignArena(layout[i], align);
     }
 
-
-    delete [] device_list;
-
-    return ctxVec;
+    return size;
 }
 
 
-int OclGPU::findPlatformIdx(xmrig::OclVendor vendor, char *name, size_t nameSize)
+static void createArenas(const std::vector<GpuContext *> &contexts, xmrig::Config *config)
 {
-#   if !defined(__APPLE__)
-    std::vector<cl_platform_id> platforms = OclLib::getPlatformIDs();
-    if (platforms.empty()) {
-        return -1;
+    if (!OclLib::isSubBufferSupported()) {
+        return;
     }
 
-    for (uint32_t i = 0; i < platforms.size(); i++) {
-        OclLib::getPlatformInfo(platforms[i], CL_PLATFORM_VENDOR, nameSize, name, nullptr);
+    for (const GpuContext *ctx : contexts) {
+        if (deviceArenaMap.count(ctx->deviceIdx)) {
+            continue;
+        }
 
-        switch (vendor) {
-        case xmrig::OCL_VENDOR_AMD:
-            if (strstr(name, "Advanced Micro Devices") != nullptr) {
-                return i;
-            }
-            break;
+        DeviceArena &arena = deviceArenaMap[ctx->deviceIdx];
 
-        case xmrig::OCL_VENDOR_NVIDIA:
-            if (strstr(name, "NVIDIA") != nullptr) {
-                return i;
-            }
-            break;
+        arena.align = std::max<size_t>(ctx->caps.memBaseAlign, 256);
 
-        case xmrig::OCL_VENDOR_INTEL:
-            if (strstr(name, "Intel") != nullptr) {
-                return i;
-            }
-            break;
+        // slot i is used by the thread i of the device with any algorithm
+        for (int i = 0; i < xmrig::PerfAlgo::PA_MAX; ++i) {
+            const xmrig::PerfAlgo pa = static_cast<xmrig::PerfAlgo>(i);
+            const size_t memory      = xmrig::cn_select_memory(xmrig::Algorithm(pa).algo());
+            size_t slot              = 0;
 
-        default:
-            break;
-        }
-    }
+            for (const xmrig::IThread *thread : config->threads(pa)) {
+                const GpuContext *next = static_cast<const xmrig::OclThread *>(thread)->ctx();
+                if (next->deviceIdx != ctx->deviceIdx) {
+                    continue;
+                }
 
-    return -1;
-#   else
-    return 0;
-#   endif
-}
+                if (arena.sizes.size() <= slot) {
+                    arena.sizes.push_back(0);
+                }
 
+                arena.sizes[slot] = std::max(arena.sizes[slot], arenaLayout(next->rawIntensity, memory, arena.align));
+                slot++;
+            }
+        }
 
-void printPlatforms()
-{
-    std::vector<cl_platform_id> platforms = OclLib::getPlatformIDs();
+        size_t size = 0;
+        for (size_t slot : arena.sizes) {
+            arena.offsets.push_back(size);
+            size += slot;
+        }
 
-    char buf[128] = { 0 };
+        // without GPU_SINGLE_ALLOC_PERCENT one allocation is limited, threads of the device allocate own buffers then
+        if (size == 0 || size > ctx->caps.maxAllocSize) {
+            continue;
+        }
 
-    for (size_t i = 0; i < platforms.size(); i++) {
-        if (OclLib::getPlatformInfo(platforms[i], CL_PLATFORM_VENDOR, sizeof(buf), buf, nullptr) != CL_SUCCESS) {
+        cl_int ret;
+        arena.buffer = OclLib::createBuffer(ctx->opencl_ctx, CL_MEM_READ_WRITE, size, nullptr, &ret);
+        if (ret != CL_SUCCESS) {
+            LOG_WARN("GPU #%zu: error %s when calling clCreateBuffer to create device memory arena.", ctx->deviceIdx, err_to_str(ret));
+            arena.buffer = nullptr;
             continue;
         }
 
-        printf("#%zu: %s\n", i, buf);
+        GpuMemory::setArena(ctx->deviceIdx, size);
     }
 }
 
 
-// RequestedDeviceIdxs is a list of OpenCL device indexes
-// NumDevicesRequested is number of devices in RequestedDeviceIdxs list
-// Returns 0 on success, -1 on stupid params, -2 on OpenCL API error
-size_t InitOpenCL(const std::vector<GpuContext *> &contexts, xmrig::Config *config, cl_context *opencl_ctx)
+static void releaseArenas()
 {
-    const size_t num_gpus                       = contexts.size();
-    const size_t platform_idx                   = static_cast<size_t>(config->platformIndex());
-    const std::vector<cl_platform_id> platforms = OclLib::getPlatformIDs();
+    for (auto &arena : deviceArenaMap) {
+        OclLib::releaseMemObject(arena.second.buffer);
+        GpuMemory::setArena(arena.first, 0);
+    }
+
+    deviceArenaMap.clear();
+}
+
+
+static void releaseArenaBuffers(GpuContext *ctx)
+{
+    if (!ctx->arenaBuffers) {
+        return;
+    }
+
+    cl_mem *buffers[kArenaBuffers] = { &ctx->InputBuffer, &ctx->ExtraBuffers[0], &ctx->ExtraBuffers[1], &ctx->ExtraBuffers[2], &ctx->ExtraBuffers[3], &ctx->ExtraBuffers[4], &ctx->ExtraBuffers[5], &ctx->OutputBuffer };
+    for (cl_mem *buffer : buffers) {
+        OclLib::releaseMemObject(*buffer);
+        *buffer = nullptr;
+    }
+
+    ctx->arenaBuffers     = false;
+    ctx->scratchpadsSize  = 0;
+    ctx->buffersIntensity = 0;
+}
+
+
+// carves the buffers of the thread out of its arena slot, if the slot is too small
+// or the device has no arena the buffers are left to InitOpenCLGpu
+static void createArenaBuffers(GpuContext *ctx, size_t slot, size_t memory)
+{
+    const auto it = deviceArenaMap.find(ctx->deviceIdx);
+    if (it == deviceArenaMap.end() || it->second.buffer == nullptr || slot >= it->second.sizes.size()) {
+        return;
+    }
+
+    const DeviceArena &arena = it->second;
+    size_t sizes[kArenaBuffers];
+    size_t offsets[kArenaBuffers];
+
+    if (arenaLayout(ctx->rawIntensity, memory, arena.align, sizes, offsets) > arena.sizes[slot]) {
+        return;
+    }
+
+    cl_mem *buffers[kArenaBuffers] = { &ctx->InputBuffer, &ctx->ExtraBuffers[0], &ctx->ExtraBuffers[1], &ctx->ExtraBuffers[2], &ctx->ExtraBuffers[3], &ctx->ExtraBuffers[4], &ctx->ExtraBuffers[5], &ctx->OutputBuffer };
+    cl_int ret;
+
+    ctx->arenaBuffers = true;
+
+    for (size_t i = 0; i < kArenaBuffers; ++i) {
+        cl_mem buffer = OclLib::createSubBuffer(arena.buffer, i == 0 ? CL_MEM_READ_ONLY : CL_MEM_READ_WRITE, arena.offsets[slot] + offsets[i], sizes[i], &ret);
+        if (ret != CL_SUCCESS) {
+            releaseArenaBuffers(ctx);
+            return;
+        }
+
+        *buffers[i] = buffer;
+    }
+
+    ctx->scratchpadsSize  = sizes[1];
+    ctx->buffersIntensity = ctx->rawIntensity;
+}
+
+
+// device memory of the buffers of a thread as InitOpenCLGpu allocates them, views of an arena are counted with the arena
+// and the pinned results and control buffers are host memory
+static size_t bufferBytes(const GpuContext *ctx)
+{
+    size_t size = ctx->StageBuffer ? 128 : 0;
+    if (ctx->arenaBuffers) {
+        return size;
+    }
+
+    if (ctx->InputBuffer) {
+        size += 128;
+    }
+
+    if (ctx->ExtraBuffers[0]) {
+        size += ctx->scratchpadsSize;
+    }
+
+    if (ctx->ExtraBuffers[1]) {
+        size += 200 * ctx->buffersIntensity + 4 * sizeof(cl_uint) * (ctx->buffersIntensity + 2);
+    }
+
+    if (ctx->OutputBuffer) {
+        size += sizeof(cl_uint) * OCL_RESULT_SIZE;
+    }
+
+    return size;
+}
+
+
+// what the driver reports for the kernels of the program, logged once per program load
+static void kernelUsage(GpuContext *ctx)
+{
+    GpuKernelUsage usage;
+
+    for (cl_kernel kernel : ctx->Kernels) {
+        if (kernel == nullptr) {
+            continue;
+        }
+
+        size_t workGroupSize     = 0;
+        size_t workGroupMultiple = 0;
+        cl_ulong localMem        = 0;
+        cl_ulong privateMem      = 0;
+
+        OclLib::getKernelWorkGroupInfo(kernel, ctx->DeviceID, CL_KERNEL_WORK_GROUP_SIZE,                    sizeof(size_t),   &workGroupSize);
+        OclLib::getKernelWorkGroupInfo(kernel, ctx->DeviceID, CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE, sizeof(size_t),   &workGroupMultiple);
+        OclLib::getKernelWorkGroupInfo(kernel, ctx->DeviceID, CL_KERNEL_LOCAL_MEM_SIZE,                     sizeof(cl_ulong), &localMem);
+        OclLib::getKernelWorkGroupInfo(kernel, ctx->DeviceID, CL_KERNEL_PRIVATE_MEM_SIZE,                   sizeof(cl_ulong), &privateMem);
+
+        if (workGroupSize > 0 && (usage.workGroupSize == 0 || workGroupSize < usage.workGroupSize)) {
+            usage.workGroupSize = workGroupSize;
+        }
+
+        usage.workGroupMultiple = std::max(usage.workGroupMultiple, workGroupMultiple);
+        usage.localMem          = std::max<uint64_t>(usage.localMem, localMem);
+        usage.privateMem        = std::max<uint64_t>(usage.privateMem, privateMem);
+    }
+
+    ctx->kernels = usage;
+
+    LOG_INFO("GPU #%zu kernels: work group %zu (multiple of %zu), local %" PRIu64 " B, private %" PRIu64 " B",
+             ctx->deviceIdx, usage.workGroupSize, usage.workGroupMultiple, usage.localMem, usage.privateMem);
+
+    if (usage.workGroupSize > 0 && ctx->workSize > usage.workGroupSize) {
+        LOG_WARN("GPU #%zu: worksize %zu is more than the kernels accept, use %zu or less", ctx->deviceIdx, ctx->workSize, usage.workGroupSize);
+    }
+
+    if (ctx->vendor == xmrig::OCL_VENDOR_AMD && usage.privateMem > 0) {
+        LOG_WARN("GPU #%zu: kernels spill %" PRIu64 " bytes per work item to scratch memory, a lower unroll or worksize may be faster", ctx->deviceIdx, usage.privateMem);
+    }
+}
+
+
+static bool createKernels(GpuContext *ctx)
+{
+    const char *KernelNames[] = {
+        "cn0", "cn1", "cn2",
+        "Finalize", "", "", "", // 4-6 reserved, Blake, Groestl, JH and Skein are fused into Finalize
+        "cn1_monero", "cn1_msr", "cn1_xao", "cn1_tube", "cn1_v2_monero", "cn1_v2_ext",
+#       ifndef XMRIG_NO_CN_GPU
+        "cn0_cn_gpu", "cn00_cn_gpu", "cn1_cn_gpu", "cn2_cn_gpu",
+#       else
+        "", "", "", "",
+#       endif
+        nullptr
+    };
+
+    cl_int ret;
+    for (int i = 0; KernelNames[i]; ++i) {
+        if (!KernelNames[i][0] || (ctx->kernelsMask && !(ctx->kernelsMask & (1U << i)))) {
+            continue;
+        }
+
+        ctx->Kernels[i] = OclLib::createKernel(i == 3 ? ctx->ProgramFinalize : ctx->Program, KernelNames[i], &ret);
+        if (ret != CL_SUCCESS) {
+            return false;
+        }
+    }
+
+    kernelUsage(ctx);
+
+    return true;
+}
+
+
+static void releaseKernels(GpuContext *ctx)
+{
+    OclLib::releaseProgram(ctx->Program);
+    ctx->Program = nullptr;
+    ctx->kernels = GpuKernelUsage();
+
+    // CryptonightR programs are shared with the CryptonightR cache, only our reference is dropped
+    OclLib::releaseProgram(ctx->ProgramCryptonightR);
+    ctx->ProgramCryptonightR = nullptr;
+
+    int kernel_count = sizeof(ctx->Kernels) / sizeof(ctx->Kernels[0]);
+    for (int k = 0; k < kernel_count; ++k) {
+        OclLib::releaseKernel(ctx->Kernels[k]);
+        ctx->Kernels[k] = nullptr;
+    }
+}
+
+
+// the final hashes don't depend on the algorithm, their program is built (or loaded from the cache) once for each device of
+// an OpenCL context and only cn0, cn1 and cn2 are compiled again on algo switches, released with the contexts
+static std::mutex finalizeProgramsMutex;
+static std::map<std::pair<cl_context, cl_device_id>, cl_program> finalizePrograms;
+
+
+// returned program is retained, the caller must release it
+static cl_program finalizeProgram(int index, GpuContext *ctx, const char *source_code, xmrig::Config *config)
+{
+    const std::pair<cl_context, cl_device_id> key(ctx->opencl_ctx, ctx->DeviceID);
+
+    {
+        std::lock_guard<std::mutex> lock(finalizeProgramsMutex);
+
+        auto it = finalizePrograms.find(key);
+        if (it != finalizePrograms.end()) {
+            OclLib::retainProgram(it->second);
+            return it->second;
+        }
+    }
+
+    // threads of the same device are initialized one after another, other devices build their own program in parallel
+    cl_program program = nullptr;
+    OclCache cache(index, ctx->opencl_ctx, ctx, source_code, config);
+    if (!cache.loadFinalize(program)) {
+        OclLib::releaseProgram(program);
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(finalizeProgramsMutex);
+
+    cl_program &slot = finalizePrograms[key];
+    if (slot) {
+        OclLib::releaseProgram(program);
+    }
+    else {
+        slot = program;
+        GpuMemory::add(program, ctx->deviceIdx, GpuMemory::Programs);
+    }
+
+    OclLib::retainProgram(slot);
+    return slot;
+}
+
+
+static void releaseFinalizePrograms(const std::vector<cl_context> &opencl_contexts)
+{
+    std::lock_guard<std::mutex> lock(finalizeProgramsMutex);
+
+    for (auto it = finalizePrograms.begin(); it != finalizePrograms.end();) {
+        if (std::find(opencl_contexts.begin(), opencl_contexts.end(), it->first.first) == opencl_contexts.end()) {
+            ++it;
+            continue;
+        }
+
+        GpuMemory::release(it->second);
+        OclLib::releaseProgram(it->second);
+        it = finalizePrograms.erase(it);
+    }
+}
+
+
+static void adjustIntensity(GpuContext *ctx);
+
+
+// --tdr-limit measures the cn1 launches with the profiling events
+static inline bool isProfiling(const xmrig::Config *config)
+{
+    return config->isOclProfiling() || config->tdrLimit() > 0;
+}
+
+
+static inline bool isOutOfMemory(cl_int ret)
+{
+    return ret == CL_MEM_OBJECT_ALLOCATION_FAILURE || ret == CL_OUT_OF_RESOURCES || ret == CL_OUT_OF_HOST_MEMORY || ret == CL_INVALID_BUFFER_SIZE;
+}
+
+
+// the scratchpads don't fit, typically after a switch to cn-heavy on a 4 GB card, the intensity is lowered to what
+// the memory of the device allows and at least by a quarter, aligned to worksize times compute units when possible,
+// false when even one work group doesn't fit
+static bool reduceIntensity(GpuContext *ctx, size_t memory)
+{
+    const size_t step = ctx->workSize * std::max<size_t>(ctx->computeUnits, 1);
+    size_t intensity  = std::min(ctx->rawIntensity * 3 / 4, ctx->freeMem / memory);
+
+    intensity = intensity >= step ? intensity / step * step : intensity / ctx->workSize * ctx->workSize;
+    if (intensity < ctx->workSize) {
+        return false;
+    }
+
+    ctx->rawIntensity = intensity;
+    adjustIntensity(ctx);
+
+    return ctx->rawIntensity >= ctx->workSize;
+}
+
+
+size_t InitOpenCLGpu(int index, cl_context opencl_ctx, GpuContext* ctx, const char* source_code, xmrig::Config *config, size_t slot)
+{
+    ctx->opencl_ctx  = opencl_ctx;
+    ctx->binaryCache = config->isOclCache();
+
+    printGPU(index, ctx, config);
+
+    const int64_t buffersStart = xmrig::steadyTimestamp();
+
+    // the command queue and buffers may be kept from the previous algorithm, see SwitchOpenCL
+    cl_int ret;
+    ctx->lowCpu = config->isOclLowCpu();
+
+    if (ctx->CommandQueues == nullptr) {
+        ctx->profiling     = isProfiling(config);
+        ctx->CommandQueues = OclLib::createCommandQueue(opencl_ctx, ctx->DeviceID, &ret, ctx->profiling);
+        if (ret != CL_SUCCESS) {
+            return OCL_ERR_API;
+        }
+    }
+
+    ctx->tdrLimit  = ctx->profiling ? config->tdrLimit() * 1000000ULL : 0;
+    ctx->cn1Chunks = 0;
+    ctx->cn1Items  = 0;
+
+    // buffers kept from the previous algorithm are not mixed with the arena
+    if (ctx->InputBuffer == nullptr && ctx->OutputBuffer == nullptr && ctx->ExtraBuffers[0] == nullptr && ctx->ExtraBuffers[1] == nullptr) {
+        createArenaBuffers(ctx, slot, xmrig::cn_select_memory(config->algorithm().algo()));
+    }
+
+    if (ctx->InputBuffer == nullptr) {
+        ctx->InputBuffer = OclLib::createBuffer(opencl_ctx, CL_MEM_READ_ONLY, 128, nullptr, &ret);
+        if (ret != CL_SUCCESS) {
+            LOG_ERR("Error %s when calling clCreateBuffer to create input buffer.", err_to_str(ret));
+            return OCL_ERR_API;
+        }
+    }
+
+    if (ctx->StageBuffer == nullptr) {
+        ctx->StageBuffer = OclLib::createBuffer(opencl_ctx, CL_MEM_READ_ONLY, 128, nullptr, &ret);
+        if (ret != CL_SUCCESS) {
+            LOG_ERR("Error %s when calling clCreateBuffer to create input buffer.", err_to_str(ret));
+            return OCL_ERR_API;
+        }
+    }
+
+    if (ctx->ExtraBuffers[0] == nullptr) {
+        const size_t memory = xmrig::cn_select_memory(config->algorithm().algo());
+
+        while (true) {
+            ctx->scratchpadsSize = memory * ctx->rawIntensity;
+            ctx->ExtraBuffers[0] = OclLib::createBuffer(opencl_ctx, CL_MEM_READ_WRITE, ctx->scratchpadsSize, nullptr, &ret);
+            if (ret == CL_SUCCESS) {
+                break;
+            }
+
+            ctx->ExtraBuffers[0]   = nullptr;
+            const size_t intensity = ctx->rawIntensity;
+            if (!isOutOfMemory(ret) || !reduceIntensity(ctx, memory)) {
+                LOG_ERR("Error %s when calling clCreateBuffer to create hash scratchpads buffer.", err_to_str(ret));
+                return OCL_ERR_API;
+            }
+
+            LOG_WARN("GPU #%zu: error %s when calling clCreateBuffer to create hash scratchpads buffer, intensity lowered from %zu to %zu",
+                     ctx->deviceIdx, err_to_str(ret), intensity, ctx->rawIntensity);
+        }
+    }
+
+    size_t g_thd = ctx->rawIntensity;
+
+    // States and branches are allocated together, their size depends only on intensity
+    if (ctx->ExtraBuffers[1] == nullptr) {
+        ctx->buffersIntensity = g_thd;
+
+        ctx->ExtraBuffers[1] = OclLib::createBuffer(opencl_ctx, CL_MEM_READ_WRITE, 200 * g_thd, nullptr, &ret);
+        if(ret != CL_SUCCESS) {
+            LOG_ERR("Error %s when calling clCreateBuffer to create hash states buffer.", err_to_str(ret));
+            return OCL_ERR_API;
+        }
+
+        // Blake-256 branches
+        ctx->ExtraBuffers[2] = OclLib::createBuffer(opencl_ctx, CL_MEM_READ_WRITE, sizeof(cl_uint) * (g_thd + 2), nullptr, &ret);
+        if (ret != CL_SUCCESS){
+            LOG_ERR("Error %s when calling clCreateBuffer to create Branch 0 buffer.", err_to_str(ret));
+            return OCL_ERR_API;
+        }
+
+        // Groestl-256 branches
+        ctx->ExtraBuffers[3] = OclLib::createBuffer(opencl_ctx, CL_MEM_READ_WRITE, sizeof(cl_uint) * (g_thd + 2), nullptr, &ret);
+        if(ret != CL_SUCCESS) {
+            LOG_ERR("Error %s when calling clCreateBuffer to create Branch 1 buffer.", err_to_str(ret));
+            return OCL_ERR_API;
+        }
+
+        // JH-256 branches
+        ctx->ExtraBuffers[4] = OclLib::createBuffer(opencl_ctx, CL_MEM_READ_WRITE, sizeof(cl_uint) * (g_thd + 2), nullptr, &ret);
+        if (ret != CL_SUCCESS) {
+            LOG_ERR("Error %s when calling clCreateBuffer to create Branch 2 buffer.", err_to_str(ret));
+            return OCL_ERR_API;
+        }
+
+        // Skein-512 branches
+        ctx->ExtraBuffers[5] = OclLib::createBuffer(opencl_ctx, CL_MEM_READ_WRITE, sizeof(cl_uint) * (g_thd + 2), nullptr, &ret);
+        if (ret != CL_SUCCESS) {
+            LOG_ERR("Error %s when calling clCreateBuffer to create Branch 3 buffer.", err_to_str(ret));
+            return OCL_ERR_API;
+        }
+    }
+
+    if (ctx->OutputBuffer == nullptr) {
+        // up to OCL_RESULT_SLOTS nonces of one run, enough for diff 1000 targets at the largest intensities
+        ctx->OutputBuffer = OclLib::createBuffer(opencl_ctx, CL_MEM_READ_WRITE, sizeof(cl_uint) * OCL_RESULT_SIZE, nullptr, &ret);
+        if (ret != CL_SUCCESS) {
+            LOG_ERR("Error %s when calling clCreateBuffer to create output buffer.", err_to_str(ret));
+            return OCL_ERR_API;
+        }
+    }
+
+    if (ctx->ResultsBuffer == nullptr) {
+        // Pinned host memory for results readback, one slot of OCL_RESULT_SIZE per pipeline stage, mapped for the whole context lifetime
+        ctx->ResultsBuffer = OclLib::createBuffer(opencl_ctx, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, sizeof(cl_uint) * OCL_RESULT_SIZE * GpuContext::kMaxDepth, nullptr, &ret);
+        if (ret != CL_SUCCESS) {
+            LOG_ERR("Error %s when calling clCreateBuffer to create results buffer.", err_to_str(ret));
+            return OCL_ERR_API;
+        }
+
+        ctx->Results = static_cast<cl_uint *>(OclLib::enqueueMapBuffer(ctx->CommandQueues, ctx->ResultsBuffer, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, sizeof(cl_uint) * OCL_RESULT_SIZE * GpuContext::kMaxDepth, 0, nullptr, nullptr, &ret));
+        if (ret != CL_SUCCESS) {
+            return OCL_ERR_API;
+        }
+    }
+
+    if (ctx->ControlBuffer == nullptr) {
+        // read by the cn1 and cn2 kernels while they run, the host writes it through the mapping without a command
+        ctx->ControlBuffer = OclLib::createBuffer(opencl_ctx, CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR, sizeof(cl_uint), nullptr, &ret);
+        if (ret != CL_SUCCESS) {
+            LOG_ERR("Error %s when calling clCreateBuffer to create control buffer.", err_to_str(ret));
+            return OCL_ERR_API;
+        }
+
+        ctx->Control = static_cast<cl_uint *>(OclLib::enqueueMapBuffer(ctx->CommandQueues, ctx->ControlBuffer, CL_TRUE, CL_MAP_WRITE, 0, sizeof(cl_uint), 0, nullptr, nullptr, &ret));
+        if (ret != CL_SUCCESS) {
+            return OCL_ERR_API;
+        }
+    }
+
+    xmrig::StartupProfile::add("buffers", static_cast<int>(ctx->deviceIdx), buffersStart, xmrig::steadyTimestamp());
+
+    xmrig::Variant variant = xmrig::VARIANT_AUTO;
+    const uint32_t mask    = config->isOclSpecialize() ? kernelsMask(config->algorithm(), &variant) : 0;
+    if (mask == 0) {
+        variant = xmrig::VARIANT_AUTO;
+    }
+
+    if (ctx->ProgramFinalize == nullptr && (ctx->ProgramFinalize = finalizeProgram(index, ctx, source_code, config)) == nullptr) {
+        return OCL_ERR_API;
+    }
+
+    // a standby program of this thread is used as is, only the kernel arguments are bound to the new buffers
+    if (ctx->Program == nullptr || ctx->kernelsMask != mask || ctx->kernelsVariant != variant) {
+        releaseKernels(ctx);
+
+        ctx->kernelsMask    = mask;
+        ctx->kernelsVariant = variant;
+
+        OclCache cache(index, opencl_ctx, ctx, source_code, config);
+        if (!cache.load() || !createKernels(ctx)) {
+            return OCL_ERR_API;
+        }
+    }
+
+    if (!setStaticKernelArgs(ctx)) {
+        return OCL_ERR_API;
+    }
+
+    {
+        JobStage &stage = jobStage(ctx);
+        std::lock_guard<std::mutex> lock(stage.mutex);
+
+        stage.ready     = true;
+        ctx->Control[0] = stage.generation;
+    }
+
+    GpuMemory::setThread(ctx, bufferBytes(ctx), false);
+
+    ctx->Nonce = 0;
+    return 0;
+}
+
+
+int OclGPU::findPlatformIdx(xmrig::Config *config)
+{
+    assert(config->vendor() > xmrig::OCL_VENDOR_MANUAL);
+
+#   if !defined(__APPLE__)
+    char name[256]  = { 0 };
+    const int index = findPlatformIdx(config->vendor(), name, sizeof name);
+
+    if (index >= 0) {
+        LOG_INFO(config->isColors() ? GREEN_BOLD("found ") WHITE_BOLD("%s") " platform index: " WHITE_BOLD("%d") ", name: " WHITE_BOLD("%s")
+                                    : "found %s platform index: %d, name: %s",
+                 config->vendorName(config->vendor()), index , name);
+    }
+
+    return index;
+#   else
+    return 0;
+#   endif
+}
+
+
+static GpuDeviceCaps deviceCaps(cl_device_id id, xmrig::OclVendor vendor)
+{
+    GpuDeviceCaps caps;
+    cl_ulong localMem  = 0;
+    cl_uint alignBits  = 0;
+    char buf[128]      = { 0 };
+
+    OclLib::getDeviceInfo(id, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(size_t), &caps.maxWorkGroupSize);
+    OclLib::getDeviceInfo(id, CL_DEVICE_MAX_MEM_ALLOC_SIZE,  sizeof(size_t), &caps.maxAllocSize);
+    OclLib::getDeviceInfo(id, CL_DEVICE_LOCAL_MEM_SIZE,      sizeof(cl_ulong), &localMem);
+    OclLib::getDeviceInfo(id, CL_DEVICE_MEM_BASE_ADDR_ALIGN, sizeof(cl_uint), &alignBits);
+
+    caps.localMemSize = localMem;
+    caps.memBaseAlign = alignBits / 8;
+
+    if (OclLib::getDeviceInfo(id, CL_DRIVER_VERSION, sizeof(buf) - 1, buf) == CL_SUCCESS) {
+        caps.driverVersion = static_cast<const char *>(buf);
+    }
+
+    size_t extensionsSize = 0;
+    if (OclLib::getDeviceInfo(id, CL_DEVICE_EXTENSIONS, 0, nullptr, &extensionsSize) == CL_SUCCESS && extensionsSize > 0) {
+        std::vector<char> extensions(extensionsSize + 1, 0);
+        if (OclLib::getDeviceInfo(id, CL_DEVICE_EXTENSIONS, extensionsSize, extensions.data()) == CL_SUCCESS) {
+            caps.subgroupShuffle = strstr(extensions.data(), "cl_khr_subgroups") != nullptr && strstr(extensions.data(), "cl_khr_subgroup_shuffle") != nullptr;
+        }
+    }
+
+    if (vendor == xmrig::OCL_VENDOR_AMD) {
+        struct {
+            cl_uint type;
+            cl_char unused[17];
+            cl_char bus;
+            cl_char device;
+            cl_char function;
+        } topology = {};
+
+        cl_uint width = 0;
+        if (OclLib::getDeviceInfo(id, 0x4043 /* CL_DEVICE_WAVEFRONT_WIDTH_AMD */, sizeof(cl_uint), &width) == CL_SUCCESS) {
+            caps.wavefrontWidth = width;
+        }
+
+        // like "3204.0 (HSA1.1,LC)" on ROCm, the older HSAIL and ORCA compilers don't know the amdgcn builtins
+        caps.amdgcnBuiltins = !caps.driverVersion.isNull() && strstr(caps.driverVersion.data(), "LC)") != nullptr;
+
+        if (OclLib::getDeviceInfo(id, 0x4037 /* CL_DEVICE_TOPOLOGY_AMD */, sizeof(topology), &topology) == CL_SUCCESS && topology.type == 1 /* CL_DEVICE_TOPOLOGY_TYPE_PCIE_AMD */) {
+            caps.pciBus      = static_cast<uint8_t>(topology.bus);
+            caps.pciDevice   = static_cast<uint8_t>(topology.device);
+            caps.pciFunction = static_cast<uint8_t>(topology.function);
+        }
+    }
+    else if (vendor == xmrig::OCL_VENDOR_NVIDIA) {
+        cl_uint width = 0;
+        cl_uint bus   = 0;
+        cl_uint slot  = 0;
+
+        if (OclLib::getDeviceInfo(id, 0x4003 /* CL_DEVICE_WARP_SIZE_NV */, sizeof(cl_uint), &width) == CL_SUCCESS) {
+            caps.wavefrontWidth = width;
+        }
+
+        if (OclLib::getDeviceInfo(id, 0x4008 /* CL_DEVICE_PCI_BUS_ID_NV */, sizeof(cl_uint), &bus) == CL_SUCCESS &&
+            OclLib::getDeviceInfo(id, 0x4009 /* CL_DEVICE_PCI_SLOT_ID_NV */, sizeof(cl_uint), &slot) == CL_SUCCESS) {
+            caps.pciBus      = static_cast<int>(bus);
+            caps.pciDevice   = static_cast<int>(slot >> 3);
+            caps.pciFunction = static_cast<int>(slot & 7);
+        }
+    }
+
+    return caps;
+}
+
+
+// AMD drivers name the device by its gfx target (gfx906, gfx1010, ROCm appends ":xnack-" and alike)
+// or, on older drivers, by its GCN codename; four digit targets are RDNA
+static GpuFamily deviceFamily(const GpuContext &ctx)
+{
+    if (ctx.vendor != xmrig::OCL_VENDOR_AMD) {
+        return GPU_FAMILY_OTHER;
+    }
+
+    const char *name = ctx.name.data();
+    if ((name != nullptr && strncmp(name, "gfx", 3) == 0 && strcspn(name + 3, ":") >= 4) || ctx.caps.wavefrontWidth == 32) {
+        return GPU_FAMILY_RDNA;
+    }
+
+    return GPU_FAMILY_GCN;
+}
+
+
+// devices of one platform, enumerated once per process; `devices` has an entry for every raw OpenCL device index
+struct DeviceInventory
+{
+    std::vector<cl_device_id> ids;
+    std::vector<GpuContext> devices;
+};
+
+
+static std::mutex inventoryMutex;
+static std::map<size_t, DeviceInventory> inventories;
+
+
+static const DeviceInventory *deviceInventory(size_t platformIndex, const xmrig::Config *config)
+{
+    std::lock_guard<std::mutex> lock(inventoryMutex);
+
+    auto it = inventories.find(platformIndex);
+    if (it != inventories.end()) {
+        return &it->second;
+    }
+
+    const std::vector<cl_platform_id> platforms = OclLib::getPlatformIDs();
+    if (platforms.size() <= platformIndex) {
+        return nullptr;
+    }
+
+    xmrig::StartupProfile::Scope scope("devices");
+
+    cl_int ret;
+    cl_uint num_devices = 0;
+    if ((ret = OclLib::getDeviceIDs(platforms[platformIndex], CL_DEVICE_TYPE_GPU, 0, nullptr, &num_devices)) != CL_SUCCESS && ret != CL_DEVICE_NOT_FOUND) {
+        LOG_ERR("Error %s when calling clGetDeviceIDs for number of devices.", err_to_str(ret));
+        return nullptr;
+    }
+
+    DeviceInventory inventory;
+    inventory.ids.resize(num_devices);
+
+    if (num_devices > 0 && (ret = OclLib::getDeviceIDs(platforms[platformIndex], CL_DEVICE_TYPE_GPU, num_devices, inventory.ids.data(), nullptr)) != CL_SUCCESS) {
+        LOG_ERR("Error %s when calling clGetDeviceIDs for device ID information.", err_to_str(ret));
+        return nullptr;
+    }
+
+    for (cl_uint i = 0; i < num_devices; i++) {
+        GpuContext ctx;
+        ctx.deviceIdx    = i;
+        ctx.platformIdx  = platformIndex;
+        ctx.DeviceID     = inventory.ids[i];
+        ctx.computeUnits = OclLib::getDeviceMaxComputeUnits(ctx.DeviceID);
+        ctx.vendor       = OclLib::getDeviceVendor(ctx.DeviceID);
+        ctx.caps         = deviceCaps(ctx.DeviceID, ctx.vendor);
+
+        OclLib::getDeviceInfo(ctx.DeviceID, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(size_t), &ctx.globalMem);
+        // if environment variable GPU_SINGLE_ALLOC_PERCENT is not set we can not allocate the full memory
+        ctx.freeMem = std::min(ctx.caps.maxAllocSize, ctx.globalMem);
+
+        ctx.board = OclLib::getDeviceBoardName(ctx.DeviceID);
+        ctx.name  = OclLib::getDeviceName(ctx.DeviceID);
+        ctx.caps.family = deviceFamily(ctx);
+
+        OclCache::get_device_string(static_cast<int>(platformIndex), ctx.DeviceID, ctx.DeviceString);
+        ctx.amdDriverMajorVersion = OclCache::amdDriverMajorVersion(&ctx);
+
+        if (ctx.vendor != xmrig::OCL_VENDOR_UNKNOWN) {
+            if (ctx.board == ctx.name) {
+                LOG_INFO(config->isColors() ? GREEN_BOLD("found") " OpenCL GPU: " GREEN_BOLD("%s") ", cu: " WHITE_BOLD("%d")
+                                            : "found OpenCL GPU: %s, cu: %d",
+                         ctx.name.data(), ctx.computeUnits);
+            }
+            else {
+                LOG_INFO(config->isColors() ? GREEN_BOLD("found") " OpenCL GPU: " GREEN_BOLD("%s") " ("  CYAN_BOLD("%s") "), cu: " WHITE_BOLD("%d")
+                                            : "found OpenCL GPU: %s (%s), cu: %d",
+                         ctx.board.data(), ctx.name.data(), ctx.computeUnits);
+            }
+        }
+
+        inventory.devices.push_back(ctx);
+    }
+
+    return &inventories.emplace(platformIndex, std::move(inventory)).first->second;
+}
+
+
+// reverse of OclGPU::deviceOffset, platforms after the device are not enumerated
+static bool findDevice(size_t deviceIdx, const xmrig::Config *config, size_t *platformIndex, size_t *index)
+{
+    const size_t primary       = static_cast<size_t>(config->platformIndex());
+    const size_t num_platforms = OclLib::getNumPlatforms();
+
+    for (size_t i = 0; i <= num_platforms; ++i) {
+        const size_t platform = i == 0 ? primary : i - 1;
+        if (i > 0 && platform == primary) {
+            continue;
+        }
+
+        const DeviceInventory *inventory = deviceInventory(platform, config);
+        const size_t count               = inventory ? inventory->ids.size() : 0;
+
+        if (deviceIdx < count) {
+            *platformIndex = platform;
+            *index         = deviceIdx;
+
+            return true;
+        }
+
+        deviceIdx -= count;
+    }
+
+    return false;
+}
+
+
+std::vector<GpuContext> OclGPU::getDevices(xmrig::Config *config)
+{
+    std::vector<GpuContext> ctxVec;
+
+    const DeviceInventory *inventory = deviceInventory(static_cast<size_t>(config->platformIndex()), config);
+    if (!inventory) {
+        return ctxVec;
+    }
+
+    for (const GpuContext &ctx : inventory->devices) {
+        if (ctx.vendor != xmrig::OCL_VENDOR_UNKNOWN) {
+            ctxVec.push_back(ctx);
+        }
+    }
+
+    return ctxVec;
+}
+
+
+size_t OclGPU::getDeviceCount(const xmrig::Config *config)
+{
+    return getDeviceCount(static_cast<size_t>(config->platformIndex()), config);
+}
+
+
+size_t OclGPU::getDeviceCount(size_t platformIndex, const xmrig::Config *config)
+{
+    const DeviceInventory *inventory = deviceInventory(platformIndex, config);
+
+    return inventory ? inventory->ids.size() : 0;
+}
+
+
+// threads of other platforms than "opencl-platform" use the device indexes after the devices of that platform,
+// the other platforms follow in their order, so the device indexes of the selected platform never change
+size_t OclGPU::deviceOffset(size_t platformIndex, const xmrig::Config *config)
+{
+    const size_t primary = static_cast<size_t>(config->platformIndex());
+    if (platformIndex == primary) {
+        return 0;
+    }
+
+    size_t offset = getDeviceCount(config);
+    for (size_t i = 0; i < platformIndex; ++i) {
+        if (i == primary) {
+            continue;
+        }
+
+        offset += getDeviceCount(i, config);
+    }
+
+    return offset;
+}
+
+
+int OclGPU::findPlatformIdx(xmrig::OclVendor vendor, char *name, size_t nameSize)
+{
+#   if !defined(__APPLE__)
+    std::vector<cl_platform_id> platforms = OclLib::getPlatformIDs();
+    if (platforms.empty()) {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < platforms.size(); i++) {
+        OclLib::getPlatformInfo(platforms[i], CL_PLATFORM_VENDOR, nameSize, name, nullptr);
+
+        switch (vendor) {
+        case xmrig::OCL_VENDOR_AMD:
+            if (strstr(name, "Advanced Micro Devices") != nullptr) {
+                return i;
+            }
+            break;
+
+        case xmrig::OCL_VENDOR_NVIDIA:
+            if (strstr(name, "NVIDIA") != nullptr) {
+                return i;
+            }
+            break;
+
+        case xmrig::OCL_VENDOR_INTEL:
+            if (strstr(name, "Intel") != nullptr) {
+                return i;
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    return -1;
+#   else
+    return 0;
+#   endif
+}
+
+
+void printPlatforms()
+{
+    std::vector<cl_platform_id> platforms = OclLib::getPlatformIDs();
+
+    char buf[128] = { 0 };
+
+    for (size_t i = 0; i < platforms.size(); i++) {
+        if (OclLib::getPlatformInfo(platforms[i], CL_PLATFORM_VENDOR, sizeof(buf), buf, nullptr) != CL_SUCCESS) {
+            continue;
+        }
+
+        printf("#%zu: %s\n", i, buf);
+    }
+}
+
+
+static void replaceInclude(std::string &source_code, const char *name, const char *code)
+{
+    const size_t nameSize = strlen(name);
+    const size_t codeSize = strlen(code);
+
+    for (size_t pos = source_code.find(name); pos != std::string::npos; pos = source_code.find(name, pos + codeSize)) {
+        source_code.replace(pos, nameSize, code, codeSize);
+    }
+}
+
+
+static std::string buildKernelSource()
+{
+    const std::string cryptonightCL = OclSource::get("cryptonight.cl",
+            #include "./opencl/cryptonight.cl"
+    );
+    const std::string blake256CL = OclSource::get("blake256.cl",
+            #include "./opencl/blake256.cl"
+    );
+    const std::string groestl256CL = OclSource::get("groestl256.cl",
+            #include "./opencl/groestl256.cl"
+    );
+    const std::string jhCL = OclSource::get("jh.cl",
+            #include "./opencl/jh.cl"
+    );
+    const std::string wolfAesCL = OclSource::get("wolf-aes.cl",
+            #include "./opencl/wolf-aes.cl"
+    );
+    const std::string wolfSkeinCL = OclSource::get("wolf-skein.cl",
+            #include "./opencl/wolf-skein.cl"
+    );
+    const std::string fastIntMathV2CL = OclSource::get("fast_int_math_v2.cl",
+        #include "./opencl/fast_int_math_v2.cl"
+    );
+    const std::string fastDivHeavyCL = OclSource::get("fast_div_heavy.cl",
+        #include "./opencl/fast_div_heavy.cl"
+    );
+    const std::string cryptonight_gpu = OclSource::get("cryptonight_gpu.cl",
+        #include "./opencl/cryptonight_gpu.cl"
+    );
+
+    std::string source_code(cryptonightCL);
+    replaceInclude(source_code, "XMRIG_INCLUDE_WOLF_AES",         wolfAesCL.c_str());
+    replaceInclude(source_code, "XMRIG_INCLUDE_WOLF_SKEIN",       wolfSkeinCL.c_str());
+    replaceInclude(source_code, "XMRIG_INCLUDE_JH",               jhCL.c_str());
+    replaceInclude(source_code, "XMRIG_INCLUDE_BLAKE256",         blake256CL.c_str());
+    replaceInclude(source_code, "XMRIG_INCLUDE_GROESTL256",       groestl256CL.c_str());
+    replaceInclude(source_code, "XMRIG_INCLUDE_FAST_INT_MATH_V2", fastIntMathV2CL.c_str());
+    replaceInclude(source_code, "XMRIG_INCLUDE_FAST_DIV_HEAVY",   fastDivHeavyCL.c_str());
+    replaceInclude(source_code, "XMRIG_INCLUDE_CN_GPU",           cryptonight_gpu.c_str());
+
+    return source_code;
+}
+
+
+// the source doesn't depend on devices or algorithm, it is assembled once on first use, with --opencl-source
+// on each use so an edited file is taken by the next init of a thread, an unchanged source keeps its copy
+static std::shared_ptr<const std::string> kernelSource()
+{
+    static std::mutex mutex;
+    static std::shared_ptr<const std::string> source_code;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (source_code && !OclSource::isEnabled()) {
+        return source_code;
+    }
+
+    std::string built = buildKernelSource();
+    if (!source_code || *source_code != built) {
+        if (source_code) {
+            LOG_INFO("OpenCL kernel source changed, %zu bytes", built.size());
+        }
+
+        source_code = std::make_shared<const std::string>(std::move(built));
+    }
+
+    return source_code;
+}
+
+
+static void adjustIntensity(GpuContext *ctx)
+{
+    if (ctx->hashesPerItem > 1 && (ctx->rawIntensity % ctx->hashesPerItem) != 0) {
+        const size_t reduced_intensity = ctx->rawIntensity / ctx->hashesPerItem * ctx->hashesPerItem;
+        ctx->rawIntensity = reduced_intensity;
+
+        LOG_WARN("AMD GPU #%zu: intensity is not a multiple of 'hashes_per_item', auto reduce intensity to %zu", ctx->deviceIdx, reduced_intensity);
+    }
+
+    if (ctx->stridedIndex == 2 && (ctx->rawIntensity % ctx->workSize) != 0) {
+        const size_t reduced_intensity = (ctx->rawIntensity / ctx->workSize) * ctx->workSize;
+        ctx->rawIntensity = reduced_intensity;
+
+        LOG_WARN("AMD GPU #%zu: intensity is not a multiple of 'worksize', auto reduce intensity to %zu", ctx->deviceIdx, reduced_intensity);
+    }
+
+    if (ctx->rawIntensity % ctx->workSize == 0) {
+        ctx->compMode = 0;
+    }
+}
+
+
+// devices are initialized in parallel, threads of the same device one after another,
+// each thread reports own error and all of them are finished before return
+static size_t initDevices(const std::vector<GpuContext *> &contexts, const std::string &source_code, xmrig::Config *config)
+{
+    std::map<size_t, std::vector<size_t> > devices;
+    for (size_t i = 0; i < contexts.size(); ++i) {
+        devices[contexts[i]->deviceIdx].push_back(i);
+    }
+
+    std::vector<size_t> results(contexts.size(), OCL_ERR_SUCCESS);
+    std::vector<size_t> intensities(contexts.size());
+    for (size_t i = 0; i < contexts.size(); ++i) {
+        intensities[i] = contexts[i]->rawIntensity;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(devices.size());
+
+    for (const auto &device : devices) {
+        const std::vector<size_t> &indexes = device.second;
+
+        workers.emplace_back([&contexts, &results, &indexes, &source_code, config]() {
+            for (size_t slot = 0; slot < indexes.size(); ++slot) {
+                const size_t i = indexes[slot];
+                results[i] = InitOpenCLGpu(static_cast<int>(i), contexts[i]->opencl_ctx, contexts[i], source_code.c_str(), config, slot);
+            }
+        });
+    }
+
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    size_t ret = OCL_ERR_SUCCESS;
+    for (size_t i = 0; i < contexts.size(); ++i) {
+        // the context is the one of the thread in the config, the lowered intensity is kept for its perf algo
+        if (results[i] == OCL_ERR_SUCCESS && contexts[i]->rawIntensity < intensities[i]) {
+            LOG_WARN("Thread #%zu: intensity %zu of GPU #%zu doesn't fit in memory, %zu is used for %s from now on",
+                     i, intensities[i], contexts[i]->deviceIdx, contexts[i]->rawIntensity, xmrig::Algorithm::perfAlgoName(config->algorithm().perf_algo()));
+            config->setShouldSave();
+        }
+
+        if (results[i] != OCL_ERR_SUCCESS) {
+            LOG_ERR("Thread #%zu: initialization of GPU #%zu failed.", i, contexts[i]->deviceIdx);
+
+            if (ret == OCL_ERR_SUCCESS) {
+                ret = results[i];
+            }
+        }
+    }
+
+    return ret;
+}
+
+
+// RequestedDeviceIdxs is a list of OpenCL device indexes
+// NumDevicesRequested is number of devices in RequestedDeviceIdxs list
+// Returns 0 on success, -1 on stupid params, -2 on OpenCL API error
+// with --opencl-device-contexts each GPU gets own context, its builds and allocations don't wait for the other GPUs,
+// without threads only the OpenCL contexts and arenas are made, each thread is then initialized by InitOpenCLThread
+size_t InitOpenCL(const std::vector<GpuContext *> &contexts, xmrig::Config *config, std::vector<cl_context> *opencl_contexts, bool threads)
+{
+    const size_t num_gpus                       = contexts.size();
+    const size_t platform_idx                   = static_cast<size_t>(config->platformIndex());
+    const size_t num_platforms                  = OclLib::getNumPlatforms();
+
+    if (num_platforms == 0) {
+        return OCL_ERR_API;
+    }
+
+    if (num_platforms <= platform_idx) {
+        return OCL_ERR_BAD_PARAMS;
+    }
+
+    std::vector<size_t> platforms(num_gpus);
+    std::vector<const GpuContext *> devices(num_gpus);
+
+    std::vector<cl_device_id> TempDeviceList(num_gpus);
+
+    // Same as the platform index sanity check, except we must check all requested device indexes
+    // TODO remove duplicated checks, see xmrig::Config::filter Threads()
+    for (size_t i = 0; i < num_gpus; ++i) {
+        size_t index = 0;
+        if (!findDevice(contexts[i]->deviceIdx, config, &platforms[i], &index)) {
+            LOG_ERR("Selected OpenCL device index %lu doesn't exist.\n", contexts[i]->deviceIdx);
+            return OCL_ERR_BAD_PARAMS;
+        }
+
+        const DeviceInventory *inventory = deviceInventory(platforms[i], config);
+        TempDeviceList[i] = inventory->ids[index];
+        devices[i]        = &inventory->devices[index];
+    }
+
+    // a context can't hold devices of different platforms, the shared one is created for each platform
+    cl_int ret = CL_SUCCESS;
+    std::map<size_t, cl_context> platformContexts;
+    std::map<size_t, cl_context> deviceContexts;
+    if (config->isOclDeviceContexts()) {
+        for (size_t i = 0; i < num_gpus && ret == CL_SUCCESS; ++i) {
+            if (deviceContexts.count(contexts[i]->deviceIdx) == 0) {
+                cl_context opencl_ctx = OclLib::createContext(nullptr, 1, &TempDeviceList[i], nullptr, nullptr, &ret);
+                deviceContexts[contexts[i]->deviceIdx] = opencl_ctx;
+
+                if (ret == CL_SUCCESS) {
+                    opencl_contexts->push_back(opencl_ctx);
+                }
+            }
+        }
+    }
+    else {
+        for (size_t i = 0; i < num_gpus && ret == CL_SUCCESS; ++i) {
+            if (platformContexts.count(platforms[i])) {
+                continue;
+            }
+
+            std::vector<cl_device_id> ids;
+            for (size_t k = i; k < num_gpus; ++k) {
+                if (platforms[k] == platforms[i]) {
+                    ids.push_back(TempDeviceList[k]);
+                }
+            }
 
-    if (platforms.empty()) {
+            cl_context opencl_ctx = OclLib::createContext(nullptr, static_cast<cl_uint>(ids.size()), ids.data(), nullptr, nullptr, &ret);
+            platformContexts[platforms[i]] = opencl_ctx;
+
+            if (ret == CL_SUCCESS) {
+                opencl_contexts->push_back(opencl_ctx);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < num_gpus; ++i) {
+        const GpuContext &device = *devices[i];
+
+        contexts[i]->threadIdx             = i;
+        contexts[i]->opencl_ctx            = config->isOclDeviceContexts() ? deviceContexts[contexts[i]->deviceIdx] : platformContexts[platforms[i]];
+        contexts[i]->platformIdx           = static_cast<int>(platforms[i]);
+        contexts[i]->DeviceID              = TempDeviceList[i];
+        contexts[i]->DeviceString          = device.DeviceString;
+        contexts[i]->amdDriverMajorVersion = device.amdDriverMajorVersion;
+        contexts[i]->vendor                = device.vendor;
+        contexts[i]->caps                  = device.caps;
+        contexts[i]->name                  = device.name;
+        contexts[i]->board                 = device.board;
+        contexts[i]->computeUnits          = device.computeUnits;
+        contexts[i]->freeMem               = device.freeMem;
+        contexts[i]->globalMem             = device.globalMem;
+        contexts[i]->binaryCache           = config->isOclCache();
+    }
+
+    if (ret != CL_SUCCESS) {
+        return OCL_ERR_API;
+    }
+
+    for (size_t i = 0; i < num_gpus; ++i) {
+        adjustIntensity(contexts[i]);
+    }
+
+    createArenas(contexts, config);
+
+    if (!threads) {
+        return OCL_ERR_SUCCESS;
+    }
+
+    return initDevices(contexts, *kernelSource(), config);
+}
+
+
+// a thread left by InitOpenCL without threads, threads of the same GPU must not be initialized at the same time
+size_t InitOpenCLThread(GpuContext *ctx, int index, size_t slot, xmrig::Config *config)
+{
+    return InitOpenCLGpu(index, ctx->opencl_ctx, ctx, kernelSource()->c_str(), config, slot);
+}
+
+// the programs of other perf algo threads are built in background while the current threads are mining,
+// only the binary cache keeps them, so the next InitOpenCLGpu of these threads just loads them
+static std::vector<GpuContext> prebuildContexts(const std::vector<GpuContext *> &running, const std::vector<GpuContext *> &contexts, const xmrig::Algorithm &algorithm, xmrig::Config *config, std::vector<GpuContext *> *targets = nullptr)
+{
+    std::vector<GpuContext> prebuild;
+
+    // device info is copied here, running contexts may be released before the build is finished
+    for (GpuContext *next : contexts) {
+        for (const GpuContext *ctx : running) {
+            if (ctx->deviceIdx != next->deviceIdx || ctx->DeviceID == nullptr || next->workSize == 0) {
+                continue;
+            }
+
+            GpuContext build;
+            build.deviceIdx             = next->deviceIdx;
+            build.rawIntensity          = next->rawIntensity;
+            build.workSize              = next->workSize;
+            build.stridedIndex          = next->stridedIndex;
+            build.memChunk              = next->memChunk;
+            build.compMode              = next->compMode;
+            build.unrollFactor          = next->unrollFactor;
+            build.hashesPerItem         = next->hashesPerItem;
+            build.buildFlags            = next->buildFlags;
+            build.vendor                = ctx->vendor;
+            build.opencl_ctx            = ctx->opencl_ctx;
+            build.platformIdx           = ctx->platformIdx;
+            build.DeviceID              = ctx->DeviceID;
+            build.DeviceString          = ctx->DeviceString;
+            build.amdDriverMajorVersion = ctx->amdDriverMajorVersion;
+            build.caps                  = ctx->caps;
+            build.ProgramFinalize       = ctx->ProgramFinalize;
+
+            // the same as adjustIntensity does for compMode
+            if (build.stridedIndex == 2 || build.rawIntensity % build.workSize == 0) {
+                build.compMode = 0;
+            }
+
+            build.kernelsMask = config->isOclSpecialize() ? kernelsMask(algorithm, &build.kernelsVariant) : 0;
+            if (build.kernelsMask == 0) {
+                build.kernelsVariant = xmrig::VARIANT_AUTO;
+            }
+
+            prebuild.push_back(build);
+            if (targets) {
+                targets->push_back(next);
+            }
+
+            break;
+        }
+    }
+
+    return prebuild;
+}
+
+
+// with standby targets the program and kernels are handed to the idle thread context of the same device,
+// so the switch to the algorithm doesn't even load the binary
+static void prebuild(std::vector<GpuContext> &contexts, const xmrig::Algorithm &algorithm, xmrig::Config *config, const std::vector<GpuContext *> *standby = nullptr)
+{
+    const std::shared_ptr<const std::string> source = kernelSource();
+
+    for (size_t i = 0; i < contexts.size(); ++i) {
+        OclCache cache(static_cast<int>(i), contexts[i].opencl_ctx, &contexts[i], source->c_str(), config);
+        cache.load(algorithm);
+
+        if (contexts[i].Program && standby && createKernels(&contexts[i])) {
+            GpuContext *target = (*standby)[i];
+            releaseKernels(target);
+
+            target->Program        = contexts[i].Program;
+            target->kernelsMask    = contexts[i].kernelsMask;
+            target->kernelsVariant = contexts[i].kernelsVariant;
+            target->kernels        = contexts[i].kernels;
+
+            int kernel_count = sizeof(target->Kernels) / sizeof(target->Kernels[0]);
+            for (int k = 0; k < kernel_count; ++k) {
+                target->Kernels[k]      = contexts[i].Kernels[k];
+                contexts[i].Kernels[k] = nullptr;
+            }
+
+            contexts[i].Program = nullptr;
+
+            GpuMemory::setThread(target, 0, true);
+            continue;
+        }
+
+        releaseKernels(&contexts[i]);
+    }
+}
+
+
+std::thread PrebuildOpenCL(const std::vector<GpuContext *> &running, const std::vector<GpuContext *> &contexts, const xmrig::Algorithm &algorithm, xmrig::Config *config)
+{
+    if (!config->isOclCache()) {
+        return std::thread();
+    }
+
+    std::vector<GpuContext> contexts_copy = prebuildContexts(running, contexts, algorithm, config);
+
+    return std::thread([contexts_copy, algorithm, config]() mutable {
+        prebuild(contexts_copy, algorithm, config);
+    });
+}
+
+
+// --handover: programs of the threads and the CryptonightR programs from height on go to the binary cache, built in
+// contexts of their own without buffers, so the GPUs go on mining for the previous process meanwhile
+void PrepareOpenCL(const std::vector<GpuContext *> &contexts, const xmrig::Algorithm &algorithm, uint64_t height, xmrig::Config *config)
+{
+    if (!config->isOclCache()) {
+        return;
+    }
+
+    std::vector<GpuContext> devices;
+    std::vector<cl_context> opencl_contexts;
+    devices.reserve(contexts.size());
+
+    for (const GpuContext *ctx : contexts) {
+        const bool found = std::any_of(devices.begin(), devices.end(), [ctx](const GpuContext &device) { return device.deviceIdx == ctx->deviceIdx; });
+
+        size_t platform = 0;
+        size_t index    = 0;
+        if (found || !findDevice(ctx->deviceIdx, config, &platform, &index)) {
+            continue;
+        }
+
+        const DeviceInventory *inventory = deviceInventory(platform, config);
+
+        GpuContext device  = inventory->devices[index];
+        device.deviceIdx   = ctx->deviceIdx;
+        device.platformIdx = static_cast<int>(platform);
+        device.DeviceID    = inventory->ids[index];
+
+        cl_int ret = CL_SUCCESS;
+        device.opencl_ctx = OclLib::createContext(nullptr, 1, &device.DeviceID, nullptr, nullptr, &ret);
+        if (ret != CL_SUCCESS) {
+            continue;
+        }
+
+        opencl_contexts.push_back(device.opencl_ctx);
+        devices.push_back(device);
+    }
+
+    std::vector<GpuContext *> running;
+    for (GpuContext &device : devices) {
+        running.push_back(&device);
+    }
+
+    std::vector<GpuContext> builds = prebuildContexts(running, contexts, algorithm, config);
+    prebuild(builds, algorithm, config);
+
+    // the programs stay in the CryptonightR cache, the mining contexts create theirs from the same binaries
+    if (height > 0 && (algorithm.variant() == xmrig::VARIANT_4 || algorithm.variant() == xmrig::VARIANT_WOW)) {
+        for (GpuContext &build : builds) {
+            build.binaryCache = true;
+
+            for (uint64_t i = 0; i <= PRECOMPILATION_DEPTH; ++i) {
+                cl_program program = CryptonightR_get_program(&build, algorithm.variant(), height + i);
+                if (program) {
+                    OclLib::releaseProgram(program);
+                }
+            }
+        }
+    }
+
+    ReleaseOpenClContexts(opencl_contexts);
+}
+
+
+// the threads of the standby perf algo are built first and keep their programs and kernels,
+// their contexts must not be used by anybody else until the returned thread is joined
+std::thread PrewarmOpenCL(const std::vector<GpuContext *> &running, const std::vector<std::pair<xmrig::Algorithm, std::vector<GpuContext *> > > &algorithms, xmrig::PerfAlgo standby, xmrig::Config *config, const std::atomic<bool> &stop)
+{
+    if (!config->isOclCache() || algorithms.empty()) {
+        return std::thread();
+    }
+
+    std::vector<GpuContext *> targets;
+    std::vector<std::pair<xmrig::Algorithm, std::vector<GpuContext> > > builds;
+    for (const auto &algorithm : algorithms) {
+        if (algorithm.first.perf_algo() == standby) {
+            builds.emplace(builds.begin(), algorithm.first, prebuildContexts(running, algorithm.second, algorithm.first, config, &targets));
+        }
+        else {
+            builds.emplace_back(algorithm.first, prebuildContexts(running, algorithm.second, algorithm.first, config));
+        }
+    }
+
+    return std::thread([builds, targets, standby, config, &stop]() mutable {
+        // mining goes on meanwhile, compilation only takes idle CPU time
+        Platform::setThreadPriority(0);
+
+        for (auto &build : builds) {
+            if (stop.load(std::memory_order_relaxed)) {
+                break;
+            }
+
+            prebuild(build.second, build.first, config, build.first.perf_algo() == standby ? &targets : nullptr);
+        }
+    });
+}
+
+
+size_t XMRSetJob(GpuContext *ctx, uint8_t *input, size_t input_len, uint64_t target, xmrig::Variant variant, uint64_t height)
+{
+    xmrig::Trace::Span span("XMRSetJob", static_cast<int64_t>(ctx->deviceIdx));
+
+    cl_int ret;
+
+    if (input_len > 124) {
+        return OCL_ERR_BAD_PARAMS;
+    }
+
+    input[input_len] = 0x01;
+    memset(input + input_len + 1, 0, 128 - input_len - 1);
+
+    if (ctx->StageBuffer == nullptr) {
+        if ((ret = OclLib::enqueueWriteBuffer(ctx->CommandQueues, ctx->InputBuffer, CL_TRUE, 0, 128, input, 0, nullptr, nullptr)) != CL_SUCCESS) {
+            LOG_ERR("Error %s when calling clEnqueueWriteBuffer to fill input buffer.", err_to_str(ret));
+            return OCL_ERR_API;
+        }
+    }
+    else {
+        // usually XMRStageJob has written the blob already, otherwise it is queued here without waiting
+        JobStage &stage   = jobStage(ctx);
+        std::lock_guard<std::mutex> lock(stage.mutex);
+
+        const size_t slot = ctx->inputSlot ^ 1;
+        if ((stage.staged != static_cast<int>(slot) || memcmp(stage.inputs[slot], input, 128) != 0) &&
+            (ret = writeInput(ctx, stage, slot, input)) != CL_SUCCESS) {
+            LOG_ERR("Error %s when calling clEnqueueWriteBuffer to fill input buffer.", err_to_str(ret));
+            return OCL_ERR_API;
+        }
+
+        stage.staged = -1;
+
+        if (!bindInput(ctx, slot)) {
+            return OCL_ERR_API;
+        }
+    }
+
+    // buffers are bound once in InitOpenCLGpu, only the CryptonightR kernel, variant and target change here
+    const int cn1_kernel_offset = cn1KernelOffset(variant);
+
+    if ((variant == xmrig::VARIANT_WOW) || (variant == xmrig::VARIANT_4)) {
+        const auto swapStart = std::chrono::steady_clock::now();
+
+        // Get new kernel
+        cl_program program = CryptonightR_get_program(ctx, variant, height);
+
+        if (program == ctx->ProgramCryptonightR) {
+            OclLib::releaseProgram(program);
+        }
+        else {
+            OclLib::releaseProgram(ctx->ProgramCryptonightR);
+            ctx->ProgramCryptonightR = program;
+
+            cl_int ret;
+            cl_kernel kernel = OclLib::createKernel(program, "cn1_cryptonight_r", &ret);
+
+            if (ret != CL_SUCCESS) {
+                LOG_ERR("CryptonightR: clCreateKernel returned error %s", OclError::toString(ret));
+            }
+            else {
+                OclLib::releaseKernel(ctx->Kernels[cn1_kernel_offset]);
+                ctx->Kernels[cn1_kernel_offset] = kernel;
+
+                if (!setCn1KernelArgs(ctx, cn1_kernel_offset)) {
+                    return OCL_ERR_API;
+                }
+            }
+
+            // Precompile next program in background
+            for (size_t i = 1; i <= PRECOMPILATION_DEPTH; ++i) {
+                CryptonightR_get_program(ctx, variant, height + i, true);
+            }
+
+            // the cost of a new block, usually the program was precompiled and only the kernel is created
+            const uint64_t swapTime = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - swapStart).count());
+            ctx->swapCount++;
+            ctx->swapTime += swapTime;
+
+#           ifdef APP_DEBUG
+            LOG_INFO("Thread #%zu updated CryptonightR in %.3fs", ctx->threadIdx, swapTime / 1e9);
+#           endif
+        }
+    }
+
+    // a specialized program contains only the kernels of the current algorithm
+    if (ctx->Kernels[cn1_kernel_offset] == nullptr) {
+        LOG_ERR("Thread #%zu: no kernel for variant %d, the program is built for another algorithm.", ctx->threadIdx, static_cast<int>(variant));
+        return OCL_ERR_BAD_PARAMS;
+    }
+
+    if (variant == xmrig::VARIANT_GPU) {
+        // Target
+        return setKernelArg(ctx, cn2KernelOffset(variant), 3, sizeof(cl_ulong), &target) ? OCL_ERR_SUCCESS : OCL_ERR_API;
+    }
+
+    // variant, the parameters of the variant for cn1_v2_ext
+    const cl_uint v = cn1_kernel_offset == 12 ? OclCache::cn1Params(variant) : static_cast<cl_uint>(variant);
+    if (!setKernelArg(ctx, cn1_kernel_offset, 2, sizeof(cl_uint), &v)) {
+        return OCL_ERR_API;
+    }
+
+    // Target
+    if (!setKernelArg(ctx, 3, 6, sizeof(cl_ulong), &target)) {
+        return OCL_ERR_API;
+    }
+
+    return OCL_ERR_SUCCESS;
+}
+
+
+// called on the main loop while the thread hashes, the write is queued behind its batches, so it never touches the
+// buffer they read. A write to the same buffer still waiting for its batch is not waited for, XMRSetJob writes then
+size_t XMRStageJob(GpuContext *ctx, const uint8_t *input, size_t input_len)
+{
+    if (input_len > 124) {
+        return OCL_ERR_BAD_PARAMS;
+    }
+
+    uint8_t blob[128];
+    memcpy(blob, input, input_len);
+    blob[input_len] = 0x01;
+    memset(blob + input_len + 1, 0, 128 - input_len - 1);
+
+    JobStage &stage = jobStage(ctx);
+    std::lock_guard<std::mutex> lock(stage.mutex);
+
+    if (!stage.ready) {
+        return OCL_ERR_SUCCESS;
+    }
+
+    // batches enqueued from now on run, the ones in flight for the previous job leave cn1 and cn2
+    if (ctx->persistent) {
+        ctx->Control[0] = ++stage.generation;
+    }
+
+    const size_t slot = ctx->inputSlot ^ 1;
+    stage.staged      = -1;
+
+    cl_int status = CL_COMPLETE;
+    if (stage.events[slot] && (OclLib::getEventInfo(stage.events[slot], CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(status), &status) != CL_SUCCESS || status > CL_COMPLETE)) {
+        return OCL_ERR_SUCCESS;
+    }
+
+    if (writeInput(ctx, stage, slot, blob) != CL_SUCCESS) {
         return OCL_ERR_API;
     }
 
-    if (platforms.size() <= platform_idx) {
-        return OCL_ERR_BAD_PARAMS;
+    OclLib::flush(ctx->CommandQueues);
+    stage.staged = static_cast<int>(slot);
+
+    return OCL_ERR_SUCCESS;
+}
+
+// elapsed is the time of the last cn1 launch, the launches of a batch are about the same size. Above 3/4 of the limit
+// there are more of them, the time doesn't shrink more than linearly with the size. Below 1/4 they are halved,
+// small launches fill the GPU worse and are slower per hash than the linear estimate
+static void updateChunks(GpuContext *ctx, uint64_t elapsed)
+{
+    const size_t chunks = ctx->cn1Chunks;
+    if (chunks == 0) {
+        return;
+    }
+
+    if (elapsed * 4 > ctx->tdrLimit * 3) {
+        ctx->cn1Chunks = static_cast<size_t>((elapsed * chunks * 4 + ctx->tdrLimit * 3 - 1) / (ctx->tdrLimit * 3));
+    }
+    else if (elapsed * 4 < ctx->tdrLimit && chunks > 1) {
+        ctx->cn1Chunks = chunks / 2;
+    }
+
+    if (ctx->cn1Chunks != chunks) {
+        LOG_DEBUG("GPU #%zu cn1 in %zu launches, the last one took %.1f ms", ctx->deviceIdx, ctx->cn1Chunks, static_cast<double>(elapsed) / 1e6);
+    }
+}
+
+
+// cn1 with --tdr-limit, cn/gpu is not split, the first work item of each launch is passed as the global offset of the second dimension,
+// see getCn1Idx. Launches are whole work groups, only the first one waits for the events and the last one signals
+static cl_int enqueueCn1(GpuContext *ctx, xmrig::Variant variant, size_t offset, size_t items, size_t worksize, cl_uint waits, const cl_event *waitList, cl_event *event)
+{
+    cl_kernel kernel    = ctx->Kernels[cn1KernelOffset(variant)];
+    const size_t groups = items / worksize;
+
+    if (variant == xmrig::VARIANT_GPU || ctx->tdrLimit == 0) {
+        return OclLib::enqueueNDRangeKernel(ctx->CommandQueues, kernel, 1, &offset, &items, &worksize, waits, waitList, event);
+    }
+
+    if (ctx->cn1Items != items) {
+        // unmeasured, about one work group per compute unit in each launch to begin with
+        ctx->cn1Items  = items;
+        ctx->cn1Chunks = std::max<size_t>(groups / std::max<cl_uint>(ctx->computeUnits, 1), 1);
+    }
+
+    const size_t chunks = std::min(std::max<size_t>(ctx->cn1Chunks, 1), groups);
+    if (chunks <= 1) {
+        return OclLib::enqueueNDRangeKernel(ctx->CommandQueues, kernel, 1, &offset, &items, &worksize, waits, waitList, event);
+    }
+
+    size_t first = 0;
+    for (size_t i = 1; i <= chunks; ++i) {
+        const size_t last      = groups * i / chunks * worksize;
+        size_t offsets[2]      = { offset, first };
+        size_t gthreads[2]     = { last - first, 1 };
+        const size_t lthreads[2] = { worksize, 1 };
+
+        const cl_int ret = OclLib::enqueueNDRangeKernel(ctx->CommandQueues, kernel, 2, offsets, gthreads, lthreads,
+                                                        first == 0 ? waits : 0, first == 0 ? waitList : nullptr, i == chunks ? event : nullptr);
+        if (ret != CL_SUCCESS) {
+            return ret;
+        }
+
+        first = last;
+    }
+
+    return CL_SUCCESS;
+}
+
+
+static inline cl_event *profileEvent(GpuContext *ctx, GpuContext::Profile kernel)
+{
+    return ctx->profiling ? &ctx->ProfileEvents[ctx->pipelineSlot][kernel] : nullptr;
+}
+
+
+static void releaseProfileEvents(GpuContext *ctx, size_t slot)
+{
+    for (size_t k = 0; k < GpuContext::ProfileMax; ++k) {
+        OclLib::releaseEvent(ctx->ProfileEvents[slot][k]);
+        ctx->ProfileEvents[slot][k] = nullptr;
+    }
+}
+
+
+// kernels of the slot must be completed
+static void updateProfile(GpuContext *ctx, size_t slot)
+{
+    for (size_t k = 0; k < GpuContext::ProfileMax; ++k) {
+        cl_event event = ctx->ProfileEvents[slot][k];
+        if (event == nullptr) {
+            continue;
+        }
+
+        cl_ulong start = 0;
+        cl_ulong end   = 0;
+
+        if (OclLib::getEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(start), &start) == CL_SUCCESS &&
+            OclLib::getEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(end), &end) == CL_SUCCESS &&
+            end >= start) {
+            const uint64_t elapsed = end - start;
+            uint64_t &avg = ctx->ProfileTimes[k];
+
+            if (k == GpuContext::ProfileCn1 && ctx->tdrLimit) {
+                updateChunks(ctx, elapsed);
+            }
+
+            avg = avg == 0 ? elapsed : (avg * 7 + elapsed) / 8;
+        }
+    }
+
+    releaseProfileEvents(ctx, slot);
+}
+
+
+// blocking waits of AMD drivers spin on a CPU core, in low CPU mode the thread sleeps through most of the
+// expected wait and then polls the event, the event must be flushed to the device
+static cl_int waitEvent(GpuContext *ctx, cl_event event)
+{
+    if (!ctx->lowCpu) {
+        return OclLib::waitForEvents(1, &event);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    if (ctx->syncTime > 0) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(ctx->syncTime * 7 / 8));
     }
 
+    cl_int status = CL_QUEUED;
     cl_int ret;
-    cl_uint entries;
-    if ((ret = OclLib::getDeviceIDs(platforms[platform_idx], CL_DEVICE_TYPE_GPU, 0, nullptr, &entries)) != CL_SUCCESS) {
-        LOG_ERR("Error %s when calling clGetDeviceIDs for number of devices.", err_to_str(ret));
-        return OCL_ERR_API;
+    while ((ret = OclLib::getEventInfo(event, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(status), &status)) == CL_SUCCESS && status > CL_COMPLETE) {
+        std::this_thread::sleep_for(std::chrono::microseconds(kSyncPoll));
     }
 
-    // Same as the platform index sanity check, except we must check all requested device indexes
-    // TODO remove duplicated checks, see xmrig::Config::filter Threads()
-    for (size_t i = 0; i < num_gpus; ++i) {
-        if (entries <= contexts[i]->deviceIdx) {
-            LOG_ERR("Selected OpenCL device index %lu doesn't exist.\n", contexts[i]->deviceIdx);
-            return OCL_ERR_BAD_PARAMS;
-        }
+    if (ret != CL_SUCCESS) {
+        return ret;
     }
 
-#   ifdef __GNUC__
-    cl_device_id DeviceIDList[entries];
-#   else
-    cl_device_id* DeviceIDList = (cl_device_id*)_alloca(entries * sizeof(cl_device_id));
-#   endif
-
-    if ((ret = OclLib::getDeviceIDs(platforms[platform_idx], CL_DEVICE_TYPE_GPU, entries, DeviceIDList, nullptr)) != CL_SUCCESS) {
-        LOG_ERR("Error %s when calling clGetDeviceIDs for device ID information.", err_to_str(ret));
-        return OCL_ERR_API;
+    // a negative status is the error of the command
+    if (status < CL_COMPLETE) {
+        return status;
     }
 
-    // Indexes sanity checked above
-#   ifdef __GNUC__
-    cl_device_id TempDeviceList[num_gpus];
-#   else
-    cl_device_id* TempDeviceList = (cl_device_id*)_alloca(num_gpus * sizeof(cl_device_id));
-#   endif
+    // an early completion is seen at the end of the sleep, the average shrinks by an eighth of it until it fits again
+    const uint64_t elapsed = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    ctx->syncTime = ctx->syncTime ? (ctx->syncTime * 7 + elapsed) / 8 : elapsed;
 
-    for (size_t i = 0; i < num_gpus; ++i) {
-        TempDeviceList[i] = DeviceIDList[contexts[i]->deviceIdx];
+    return CL_SUCCESS;
+}
+
+
+// only the slots of the output buffer hold nonces, results past them are counted as lost
+static void clampResults(GpuContext *ctx, cl_uint *HashOutput)
+{
+    cl_uint &count = HashOutput[OCL_RESULT_SLOTS];
+
+    if (count > OCL_RESULT_SLOTS) {
+        ctx->lostResults += count - OCL_RESULT_SLOTS;
+        count = OCL_RESULT_SLOTS;
     }
+}
 
-    *opencl_ctx = OclLib::createContext(nullptr, num_gpus, TempDeviceList, nullptr, nullptr, &ret);
 
-    for (size_t i = 0; i < num_gpus; ++i) {
-        contexts[i]->threadIdx   = i;
-        contexts[i]->opencl_ctx  = *opencl_ctx;
-        contexts[i]->platformIdx = platform_idx;
-        contexts[i]->DeviceID    = DeviceIDList[contexts[i]->deviceIdx];
-        OclCache::get_device_string(contexts[i]->platformIdx, contexts[i]->DeviceID, contexts[i]->DeviceString);
-        contexts[i]->amdDriverMajorVersion = OclCache::amdDriverMajorVersion(contexts[0]);
+// the results of the slot are added after the ones in HashOutput, the count is the sum and clampResults counts the lost ones
+static size_t collectPipelineResults(GpuContext *ctx, cl_uint *HashOutput, size_t slot)
+{
+    if (ctx->PipelineEvents[slot] == nullptr) {
+        return OCL_ERR_SUCCESS;
     }
 
+    const cl_int ret = waitEvent(ctx, ctx->PipelineEvents[slot]);
+
+    OclLib::releaseEvent(ctx->PipelineEvents[slot]);
+    ctx->PipelineEvents[slot] = nullptr;
+
     if (ret != CL_SUCCESS) {
+        releaseProfileEvents(ctx, slot);
         return OCL_ERR_API;
     }
 
-    const char *cryptonightCL =
-            #include "./opencl/cryptonight.cl"
-    ;
-    const char *cryptonightCL2 =
-            #include "./opencl/cryptonight2.cl"
-    ;
-    const char *blake256CL =
-            #include "./opencl/blake256.cl"
-    ;
-    const char *groestl256CL =
-            #include "./opencl/groestl256.cl"
-    ;
-    const char *jhCL =
-            #include "./opencl/jh.cl"
-    ;
-    const char *wolfAesCL =
-            #include "./opencl/wolf-aes.cl"
-    ;
-    const char *wolfSkeinCL =
-            #include "./opencl/wolf-skein.cl"
-    ;
-    const char *fastIntMathV2CL =
-        #include "./opencl/fast_int_math_v2.cl"
-    ;
-    const char *fastDivHeavyCL =
-        #include "./opencl/fast_div_heavy.cl"
-    ;
-    const char *cryptonight_gpu =
-        #include "./opencl/cryptonight_gpu.cl"
-    ;
+    updateProfile(ctx, slot);
 
-    std::string source_code(cryptonightCL);
-    source_code.append(cryptonightCL2);
-    source_code = std::regex_replace(source_code, std::regex("XMRIG_INCLUDE_WOLF_AES"),         wolfAesCL);
-    source_code = std::regex_replace(source_code, std::regex("XMRIG_INCLUDE_WOLF_SKEIN"),       wolfSkeinCL);
-    source_code = std::regex_replace(source_code, std::regex("XMRIG_INCLUDE_JH"),               jhCL);
-    source_code = std::regex_replace(source_code, std::regex("XMRIG_INCLUDE_BLAKE256"),         blake256CL);
-    source_code = std::regex_replace(source_code, std::regex("XMRIG_INCLUDE_GROESTL256"),       groestl256CL);
-    source_code = std::regex_replace(source_code, std::regex("XMRIG_INCLUDE_FAST_INT_MATH_V2"), fastIntMathV2CL);
-    source_code = std::regex_replace(source_code, std::regex("XMRIG_INCLUDE_FAST_DIV_HEAVY"),   fastDivHeavyCL);
-    source_code = std::regex_replace(source_code, std::regex("XMRIG_INCLUDE_CN_GPU"),           cryptonight_gpu);
+    const cl_uint *results = ctx->Results + slot * OCL_RESULT_SIZE;
+    const size_t count     = std::min<size_t>(HashOutput[OCL_RESULT_SLOTS], OCL_RESULT_SLOTS);
+    const size_t copy      = std::min<size_t>(results[OCL_RESULT_SLOTS], OCL_RESULT_SLOTS - count);
 
-    for (size_t i = 0; i < num_gpus; ++i) {
-        if (contexts[i]->stridedIndex == 2 && (contexts[i]->rawIntensity % contexts[i]->workSize) != 0) {
-            const size_t reduced_intensity = (contexts[i]->rawIntensity / contexts[i]->workSize) * contexts[i]->workSize;
-            contexts[i]->rawIntensity = reduced_intensity;
+    memcpy(HashOutput + count, results, sizeof(cl_uint) * copy);
+    memcpy(HashOutput + OCL_RESULT_HASHES + count * 8, results + OCL_RESULT_HASHES, sizeof(cl_uint) * 8 * copy);
+    HashOutput[OCL_RESULT_SLOTS] += results[OCL_RESULT_SLOTS];
 
-            LOG_WARN("AMD GPU #%zu: intensity is not a multiple of 'worksize', auto reduce intensity to %zu", contexts[i]->deviceIdx, reduced_intensity);
-        }
+    return OCL_ERR_SUCCESS;
+}
 
-        if (contexts[i]->rawIntensity % contexts[i]->workSize == 0) {
-            contexts[i]->compMode = 0;
-        }
 
-        if ((ret = InitOpenCLGpu(i, *opencl_ctx, contexts[i], source_code.c_str(), config)) != OCL_ERR_SUCCESS) {
-            return ret;
-        }
+// the generation of the latest job goes with the cn1 and cn2 kernels of each batch of a persistent thread, see STALE_LOAD in cryptonight.cl
+static bool setGeneration(GpuContext *ctx, xmrig::Variant variant)
+{
+    cl_uint generation = 0;
+    {
+        JobStage &stage = jobStage(ctx);
+        std::lock_guard<std::mutex> lock(stage.mutex);
+
+        generation = stage.generation;
     }
 
-    return OCL_ERR_SUCCESS;
+    return setKernelArg(ctx, cn1KernelOffset(variant), 6, sizeof(cl_uint), &generation) &&
+           setKernelArg(ctx, cn2KernelOffset(variant), 8, sizeof(cl_uint), &generation);
 }
 
-size_t XMRSetJob(GpuContext *ctx, uint8_t *input, size_t input_len, uint64_t target, xmrig::Variant variant, uint64_t height)
+
+// intensity is the number of hashes of this launch, it may be less than the rawIntensity
+// the buffers and kernel arguments were set up for
+size_t XMRRunJob(GpuContext *ctx, cl_uint *HashOutput, xmrig::Variant variant, size_t intensity)
 {
+    xmrig::Trace::Span span("XMRRunJob", static_cast<int64_t>(ctx->deviceIdx));
+    const int64_t enqueueStart = xmrig::Trace::isEnabled() ? xmrig::Trace::now() : -1;
+
     cl_int ret;
 
-    if (input_len > 124) {
-        return OCL_ERR_BAD_PARAMS;
-    }
+    size_t g_intensity = intensity;
+    size_t w_size = OclCache::worksize(ctx, variant);
+    // round up to next multiple of w_size
+    size_t g_thd = ((g_intensity + w_size - 1u) / w_size) * w_size;
+    // number of global threads must be a multiple of the work group size (w_size)
+    assert(g_thd % w_size == 0);
 
-    input[input_len] = 0x01;
-    memset(input + input_len + 1, 0, 128 - input_len - 1);
-    
-    cl_uint numThreads = ctx->rawIntensity;
+    // branch and output counters are reset by the first work item of the cn0 kernel
+    size_t Nonce[2] = { ctx->Nonce, 1 }, gthreads[2] = { g_thd, 8 }, lthreads[2] = { 8, 8 };
+    const int cn0_kernel_offset = cn0KernelOffset(variant);
 
-    if ((ret = OclLib::enqueueWriteBuffer(ctx->CommandQueues, ctx->InputBuffer, CL_TRUE, 0, 128, input, 0, nullptr, nullptr)) != CL_SUCCESS) {
-        LOG_ERR("Error %s when calling clEnqueueWriteBuffer to fill input buffer.", err_to_str(ret));
-        return OCL_ERR_API;
+    // events left by a failed batch
+    if (ctx->profiling) {
+        releaseProfileEvents(ctx, ctx->pipelineSlot);
     }
 
-    // CN0 Kernel
-    const int cn0_kernel_offset = cn0KernelOffset(variant);
-
-    if ((ret = OclLib::setKernelArg(ctx->Kernels[cn0_kernel_offset], 0, sizeof(cl_mem), &ctx->InputBuffer)) != CL_SUCCESS) {
-        LOG_ERR(kSetKernelArgErr, err_to_str(ret), cn0_kernel_offset, 0);
+    if (ctx->persistent && variant != xmrig::VARIANT_GPU && !setGeneration(ctx, variant)) {
         return OCL_ERR_API;
     }
 
-    // Scratchpads, States
-    if (!setKernelArgFromExtraBuffers(ctx, cn0_kernel_offset, 1, 0) || !setKernelArgFromExtraBuffers(ctx, cn0_kernel_offset, 2, 1)) {
+    if ((ret = OclLib::enqueueNDRangeKernel(ctx->CommandQueues, ctx->Kernels[cn0_kernel_offset], 2, Nonce, gthreads, lthreads, 0, nullptr, profileEvent(ctx, GpuContext::ProfileCn0))) != CL_SUCCESS) {
+        LOG_ERR("Error %s when calling clEnqueueNDRangeKernel for kernel %d.", err_to_str(ret), 0);
         return OCL_ERR_API;
     }
 
-    // Threads
-    if ((ret = OclLib::setKernelArg(ctx->Kernels[cn0_kernel_offset], 3, sizeof(cl_uint), &numThreads)) != CL_SUCCESS) {
-        LOG_ERR(kSetKernelArgErr, err_to_str(ret), cn0_kernel_offset, 3);
-        return OCL_ERR_API;
+    size_t tmpNonce = ctx->Nonce;
+
+    // cn1 work items that compute several hashes, the kernel skips items past the end of the buffers
+    const size_t hashesPerItem = cn1HashesPerItem(ctx, variant);
+    if (hashesPerItem > 1) {
+        g_thd = ((g_intensity + hashesPerItem - 1u) / hashesPerItem + w_size - 1u) / w_size * w_size;
     }
 
+    lthreads[0] = w_size;
     if (variant == xmrig::VARIANT_GPU) {
-        // we use an additional cn0 kernel to prepare the scratchpad
-        // Scratchpads
-        if ((ret = OclLib::setKernelArg(ctx->Kernels[cn0_kernel_offset + 1], 0, sizeof(cl_mem), ctx->ExtraBuffers + 0)) != CL_SUCCESS) {
-            LOG_ERR(kSetKernelArgErr, err_to_str(ret), cn0_kernel_offset + 1, 0);
-            return (OCL_ERR_API);
-        }
+        g_thd *= 16;
+        lthreads[0] *= 16;
+
+        size_t thd = 64;
+        size_t intens = g_intensity * thd;
 
-        // States
-        if((ret = OclLib::setKernelArg(ctx->Kernels[cn0_kernel_offset + 1], 1, sizeof(cl_mem), ctx->ExtraBuffers + 1)) != CL_SUCCESS)
-        {
-            LOG_ERR(kSetKernelArgErr, err_to_str(ret), cn0_kernel_offset + 1, 1);
-            return (OCL_ERR_API);
+        if ((ret = OclLib::enqueueNDRangeKernel(ctx->CommandQueues, ctx->Kernels[cn0_kernel_offset + 1], 1, nullptr, &intens, &thd, 0, nullptr, profileEvent(ctx, GpuContext::ProfileCn00))) != CL_SUCCESS) {
+            LOG_ERR("Error %s when calling clEnqueueNDRangeKernel for kernel %d.", err_to_str(ret), cn0_kernel_offset + 1);
+            return OCL_ERR_API;
         }
     }
 
-    // CN1 Kernel
-    const int cn1_kernel_offset = cn1KernelOffset(variant);
-
-    if ((variant == xmrig::VARIANT_WOW) || (variant == xmrig::VARIANT_4)) {
-#       ifdef APP_DEBUG
-        const int64_t timeStart = xmrig::steadyTimestamp();
-#       endif
-
-        // Get new kernel
-        cl_program program = CryptonightR_get_program(ctx, variant, height);
+    if (ctx->threads > 1) {
+        xmrig::Trace::Span span("cn1 sync", static_cast<int64_t>(ctx->deviceIdx));
 
-        if (program != ctx->ProgramCryptonightR) {
-            cl_int ret;
-            cl_kernel kernel = OclLib::createKernel(program, "cn1_cryptonight_r", &ret);
+        DeviceQueueSync &sync = deviceQueueSync(ctx->deviceIdx);
+        std::lock_guard<std::mutex> lock(sync.mutex);
 
-            if (ret != CL_SUCCESS) {
-                LOG_ERR("CryptonightR: clCreateKernel returned error %s", OclError::toString(ret));
-            }
-            else {
-                OclLib::releaseKernel(ctx->Kernels[cn1_kernel_offset]);
-                ctx->Kernels[cn1_kernel_offset] = kernel;
-            }
+        cl_event event = nullptr;
+        if ((ret = enqueueCn1(ctx, variant, tmpNonce, g_thd, lthreads[0], sync.cn1 ? 1 : 0, sync.cn1 ? &sync.cn1 : nullptr, &event)) != CL_SUCCESS) {
+            LOG_ERR("Error %s when calling clEnqueueNDRangeKernel for kernel %d.", err_to_str(ret), 1);
+            return OCL_ERR_API;
+        }
 
-            ctx->ProgramCryptonightR = program;
+        // other queues may wait for this event, it must be submitted to the device
+        OclLib::flush(ctx->CommandQueues);
 
-            // Precompile next program in background
-            for (size_t i = 1; i <= PRECOMPILATION_DEPTH; ++i) {
-                CryptonightR_get_program(ctx, variant, height + i, true);
-            }
+        OclLib::releaseEvent(sync.cn1);
+        sync.cn1 = event;
 
-#           ifdef APP_DEBUG
-            const int64_t timeFinish = xmrig::steadyTimestamp();
-            LOG_INFO("Thread #%zu updated CryptonightR in %.3fs", ctx->threadIdx, (timeFinish - timeStart) / 1000.0);
-#           endif
+        if (ctx->profiling && OclLib::retainEvent(event) == CL_SUCCESS) {
+            *profileEvent(ctx, GpuContext::ProfileCn1) = event;
         }
     }
-
-    // Scratchpads, States
-    if (!setKernelArgFromExtraBuffers(ctx, cn1_kernel_offset, 0, 0) || !setKernelArgFromExtraBuffers(ctx, cn1_kernel_offset, 1, 1)) {
+    else if ((ret = enqueueCn1(ctx, variant, tmpNonce, g_thd, lthreads[0], 0, nullptr, profileEvent(ctx, GpuContext::ProfileCn1))) != CL_SUCCESS) {
+        LOG_ERR("Error %s when calling clEnqueueNDRangeKernel for kernel %d.", err_to_str(ret), 1);
         return OCL_ERR_API;
     }
 
-    if (variant == xmrig::VARIANT_GPU) {
-        // Threads
-        if ((ret = OclLib::setKernelArg(ctx->Kernels[cn1_kernel_offset], 2, sizeof(cl_uint), &numThreads)) != CL_SUCCESS) {
-            LOG_ERR(kSetKernelArgErr, err_to_str(ret), cn1_kernel_offset, 2);
-            return (OCL_ERR_API);
-        }
+    const int cn2_kernel_offset = cn2KernelOffset(variant);
+
+    lthreads[0] = 8;
+    if ((ret = OclLib::enqueueNDRangeKernel(ctx->CommandQueues, ctx->Kernels[cn2_kernel_offset], 2, Nonce, gthreads, lthreads, 0, nullptr, profileEvent(ctx, GpuContext::ProfileCn2))) != CL_SUCCESS) {
+        LOG_ERR("Error %s when calling clEnqueueNDRangeKernel for kernel %d.", err_to_str(ret), 2);
+        return OCL_ERR_API;
     }
-    else {
-        // variant
-        const cl_uint v = static_cast<cl_uint>(variant);
-        if ((ret = OclLib::setKernelArg(ctx->Kernels[cn1_kernel_offset], 2, sizeof(cl_uint), &v)) != CL_SUCCESS) {
-            LOG_ERR(kSetKernelArgErr, err_to_str(ret), cn1_kernel_offset, 2);
-            return OCL_ERR_API;
-        }
 
-        // input
-        if ((ret = OclLib::setKernelArg(ctx->Kernels[cn1_kernel_offset], 3, sizeof(cl_mem), &ctx->InputBuffer)) != CL_SUCCESS) {
-            LOG_ERR(kSetKernelArgErr, err_to_str(ret), cn1_kernel_offset, 3);
+    if (variant != xmrig::VARIANT_GPU) {
+        size_t tmpNonce = ctx->Nonce;
+        size_t tmpThreads = finalThreads(ctx);
+
+        if ((ret = OclLib::enqueueNDRangeKernel(ctx->CommandQueues, ctx->Kernels[3], 1, &tmpNonce, &tmpThreads, &w_size, 0, nullptr, profileEvent(ctx, GpuContext::ProfileFinal))) != CL_SUCCESS) {
+            LOG_ERR("Error %s when calling clEnqueueNDRangeKernel for kernel %d.", err_to_str(ret), 3);
             return OCL_ERR_API;
         }
+    }
 
-        // Threads
-        if ((ret = OclLib::setKernelArg(ctx->Kernels[cn1_kernel_offset], 4, sizeof(cl_uint), &numThreads)) != CL_SUCCESS) {
-            LOG_ERR(kSetKernelArgErr, err_to_str(ret), cn1_kernel_offset, 4);
-            return(OCL_ERR_API);
-        }
+    if (enqueueStart >= 0) {
+        xmrig::Trace::add("enqueue", enqueueStart, xmrig::Trace::now() - enqueueStart, static_cast<int64_t>(ctx->deviceIdx));
     }
 
-    // CN2 Kernel
-    const int cn2_kernel_offset = cn2KernelOffset(variant);
+    xmrig::Trace::Span results("results", static_cast<int64_t>(ctx->deviceIdx));
 
-    // Scratchpads, States
-    if (!setKernelArgFromExtraBuffers(ctx, cn2_kernel_offset, 0, 0) || !setKernelArgFromExtraBuffers(ctx, cn2_kernel_offset, 1, 1)) {
-        return OCL_ERR_API;
-    }
+    if (ctx->pipeline) {
+        // batch N+1 goes to the device while results of batch N are collected, a persistent thread collects batch N+2-depth
+        const size_t slot = ctx->pipelineSlot;
 
-    if (variant == xmrig::VARIANT_GPU) {
-        // Output
-        if ((ret = OclLib::setKernelArg(ctx->Kernels[cn2_kernel_offset], 2, sizeof(cl_mem), &ctx->OutputBuffer)) != CL_SUCCESS) {
-            LOG_ERR(kSetKernelArgErr, err_to_str(ret), cn2_kernel_offset, 2);
+        // the output buffer is reused by the next batch, so the whole slot is copied here
+        if (OclLib::enqueueReadBuffer(ctx->CommandQueues, ctx->OutputBuffer, CL_FALSE, 0, sizeof(cl_uint) * OCL_RESULT_SIZE, ctx->Results + slot * OCL_RESULT_SIZE, 0, nullptr, &ctx->PipelineEvents[slot]) != CL_SUCCESS) {
             return OCL_ERR_API;
         }
 
-        // Target
-        if ((ret = OclLib::setKernelArg(ctx->Kernels[cn2_kernel_offset], 3, sizeof(cl_ulong), &target)) != CL_SUCCESS) {
-            LOG_ERR(kSetKernelArgErr, err_to_str(ret), cn2_kernel_offset, 3);
-            return OCL_ERR_API;
-        }
+        OclLib::flush(ctx->CommandQueues);
+
+        ctx->pipelineSlot = (slot + 1) % ctx->depth();
+        ctx->Nonce += (uint32_t) g_intensity;
 
-        // Threads
-        if ((ret = OclLib::setKernelArg(ctx->Kernels[cn2_kernel_offset], 4, sizeof(cl_uint), &numThreads)) != CL_SUCCESS) {
-            LOG_ERR(kSetKernelArgErr, err_to_str(ret), cn2_kernel_offset, 4);
+        HashOutput[OCL_RESULT_SLOTS] = 0;
+        if (collectPipelineResults(ctx, HashOutput, ctx->pipelineSlot) != OCL_ERR_SUCCESS) {
             return OCL_ERR_API;
         }
     }
     else {
-        // Branch 0-3
-        for (size_t i = 0; i < 4; ++i) {
-            if (!setKernelArgFromExtraBuffers(ctx, cn2_kernel_offset, i + 2, i + 2)) {
+        // read the count first, usually there are no results at all
+        cl_uint *results = ctx->Results;
+        if (ctx->lowCpu) {
+            cl_event event = nullptr;
+            if (OclLib::enqueueReadBuffer(ctx->CommandQueues, ctx->OutputBuffer, CL_FALSE, sizeof(cl_uint) * OCL_RESULT_SLOTS, sizeof(cl_uint), results + OCL_RESULT_SLOTS, 0, nullptr, &event) != CL_SUCCESS) {
                 return OCL_ERR_API;
             }
+
+            OclLib::flush(ctx->CommandQueues);
+
+            const cl_int ret = waitEvent(ctx, event);
+            OclLib::releaseEvent(event);
+
+            if (ret != CL_SUCCESS) {
+                return OCL_ERR_API;
+            }
+        }
+        else if (OclLib::enqueueReadBuffer(ctx->CommandQueues, ctx->OutputBuffer, CL_TRUE, sizeof(cl_uint) * OCL_RESULT_SLOTS, sizeof(cl_uint), results + OCL_RESULT_SLOTS, 0, nullptr, nullptr) != CL_SUCCESS) {
+            return OCL_ERR_API;
         }
 
-        // Threads
-        if ((ret = OclLib::setKernelArg(ctx->Kernels[cn2_kernel_offset], 6, sizeof(cl_uint), &numThreads)) != CL_SUCCESS) {
-            LOG_ERR(kSetKernelArgErr, err_to_str(ret), 2, 6);
+        const size_t count = std::min<size_t>(results[OCL_RESULT_SLOTS], OCL_RESULT_SLOTS);
+        if (count > 0 && OclLib::enqueueReadBuffer(ctx->CommandQueues, ctx->OutputBuffer, CL_TRUE, 0, sizeof(cl_uint) * count, results, 0, nullptr, nullptr) != CL_SUCCESS) {
             return OCL_ERR_API;
         }
 
-        for (int i = 0; i < 4; ++i) {
-            // Nonce buffer, Output
-            if (!setKernelArgFromExtraBuffers(ctx, i + 3, 0, 1) || !setKernelArgFromExtraBuffers(ctx, i + 3, 1, i + 2)) {
-                return OCL_ERR_API;
-            }
+        cl_uint *hashes = results + OCL_RESULT_HASHES;
+        if (count > 0 && OclLib::enqueueReadBuffer(ctx->CommandQueues, ctx->OutputBuffer, CL_TRUE, sizeof(cl_uint) * OCL_RESULT_HASHES, sizeof(cl_uint) * 8 * count, hashes, 0, nullptr, nullptr) != CL_SUCCESS) {
+            return OCL_ERR_API;
+        }
 
-            // Output
-            if ((ret = OclLib::setKernelArg(ctx->Kernels[i + 3], 2, sizeof(cl_mem), &ctx->OutputBuffer)) != CL_SUCCESS) {
-                LOG_ERR(kSetKernelArgErr, err_to_str(ret), i + 3, 2);
-                return OCL_ERR_API;
-            }
+        memcpy(HashOutput, results, sizeof(cl_uint) * count);
+        memcpy(HashOutput + OCL_RESULT_HASHES, hashes, sizeof(cl_uint) * 8 * count);
+        HashOutput[OCL_RESULT_SLOTS] = results[OCL_RESULT_SLOTS];
 
-            // Target
-            if ((ret = OclLib::setKernelArg(ctx->Kernels[i + 3], 3, sizeof(cl_ulong), &target)) != CL_SUCCESS) {
-                LOG_ERR(kSetKernelArgErr, err_to_str(ret), i + 3, 3);
-                return OCL_ERR_API;
-            }
+        if (ctx->profiling) {
+            updateProfile(ctx, 0);
         }
+
+        ctx->Nonce += (uint32_t) g_intensity;
     }
 
+    clampResults(ctx, HashOutput);
+
     return OCL_ERR_SUCCESS;
 }
 
-size_t XMRRunJob(GpuContext *ctx, cl_uint *HashOutput, xmrig::Variant variant)
+
+// the batches in flight are collected oldest first, a failed one doesn't stop the others from being released
+size_t XMRDrainJob(GpuContext *ctx, cl_uint *HashOutput)
 {
-    cl_int ret;
-    cl_uint zero = 0;
-    size_t BranchNonces[4];
-    memset(BranchNonces,0,sizeof(size_t)*4);
+    const size_t depth = ctx->depth();
+    size_t ret         = OCL_ERR_SUCCESS;
 
-    size_t g_intensity = ctx->rawIntensity;
-    size_t w_size = OclCache::worksize(ctx, variant);
-    // round up to next multiple of w_size
-    size_t g_thd = ((g_intensity + w_size - 1u) / w_size) * w_size;
-    // number of global threads must be a multiple of the work group size (w_size)
-    assert(g_thd % w_size == 0);
+    HashOutput[OCL_RESULT_SLOTS] = 0;
 
-    for(int i = 2; i < 6; ++i) {
-        if ((ret = OclLib::enqueueWriteBuffer(ctx->CommandQueues, ctx->ExtraBuffers[i], CL_FALSE, sizeof(cl_uint) * g_intensity, sizeof(cl_uint), &zero, 0, nullptr, nullptr)) != CL_SUCCESS) {
-            LOG_ERR("Error %s when calling clEnqueueWriteBuffer to zero branch buffer counter %d.", err_to_str(ret), i - 2);
-            return OCL_ERR_API;
+    for (size_t i = 1; i < depth; ++i) {
+        if (collectPipelineResults(ctx, HashOutput, (ctx->pipelineSlot + i) % depth) != OCL_ERR_SUCCESS) {
+            ret = OCL_ERR_API;
         }
     }
 
-    if ((ret = OclLib::enqueueWriteBuffer(ctx->CommandQueues, ctx->OutputBuffer, CL_FALSE, sizeof(cl_uint) * 0xFF, sizeof(cl_uint), &zero, 0, nullptr, nullptr)) != CL_SUCCESS) {
-        LOG_ERR("Error %s when calling clEnqueueWriteBuffer to fetch results.", err_to_str(ret));
-        return OCL_ERR_API;
-    }
+    clampResults(ctx, HashOutput);
 
-    OclLib::finish(ctx->CommandQueues);
+    return ret;
+}
 
-    size_t Nonce[2] = { ctx->Nonce, 1 }, gthreads[2] = { g_thd, 8 }, lthreads[2] = { 8, 8 };
-    const int cn0_kernel_offset = cn0KernelOffset(variant);
 
-    if ((ret = OclLib::enqueueNDRangeKernel(ctx->CommandQueues, ctx->Kernels[cn0_kernel_offset], 2, Nonce, gthreads, lthreads, 0, nullptr, nullptr)) != CL_SUCCESS) {
-        LOG_ERR("Error %s when calling clEnqueueNDRangeKernel for kernel %d.", err_to_str(ret), 0);
-        return OCL_ERR_API;
-    }
+static void releaseEvents(GpuContext *ctx)
+{
+    {
+        DeviceQueueSync &sync = deviceQueueSync(ctx->deviceIdx);
+        std::lock_guard<std::mutex> lock(sync.mutex);
 
-    size_t tmpNonce = ctx->Nonce;
-    const int cn1_kernel_offset = cn1KernelOffset(variant);
+        OclLib::releaseEvent(sync.cn1);
+        sync.cn1 = nullptr;
+    }
 
-    lthreads[0] = w_size;
-    if (variant == xmrig::VARIANT_GPU) {
-        g_thd *= 16;
-        lthreads[0] *= 16;
+    {
+        JobStage &stage = jobStage(ctx);
+        std::lock_guard<std::mutex> lock(stage.mutex);
 
-        size_t thd = 64;
-        size_t intens = g_intensity * thd;
+        stage.ready  = false;
+        stage.staged = -1;
 
-        if ((ret = OclLib::enqueueNDRangeKernel(ctx->CommandQueues, ctx->Kernels[cn0_kernel_offset + 1], 1, nullptr, &intens, &thd, 0, nullptr, nullptr)) != CL_SUCCESS) {
-            LOG_ERR("Error %s when calling clEnqueueNDRangeKernel for kernel %d.", err_to_str(ret), cn0_kernel_offset + 1);
-            return OCL_ERR_API;
+        for (cl_event &event : stage.events) {
+            if (event) {
+                OclLib::waitForEvents(1, &event);
+                OclLib::releaseEvent(event);
+                event = nullptr;
+            }
         }
     }
 
-    if ((ret = OclLib::enqueueNDRangeKernel(ctx->CommandQueues, ctx->Kernels[cn1_kernel_offset], 1, &tmpNonce, &g_thd, lthreads, 0, nullptr, nullptr)) != CL_SUCCESS) {
-        LOG_ERR("Error %s when calling clEnqueueNDRangeKernel for kernel %d.", err_to_str(ret), 1);
-        return OCL_ERR_API;
+    for (size_t i = 0; i < GpuContext::kMaxDepth; ++i) {
+        OclLib::releaseEvent(ctx->PipelineEvents[i]);
+        ctx->PipelineEvents[i] = nullptr;
+
+        releaseProfileEvents(ctx, i);
     }
 
-    const int cn2_kernel_offset = cn2KernelOffset(variant);
+    ctx->pipelineSlot = 0;
+}
 
-    lthreads[0] = 8;
-    if ((ret = OclLib::enqueueNDRangeKernel(ctx->CommandQueues, ctx->Kernels[cn2_kernel_offset], 2, Nonce, gthreads, lthreads, 0, nullptr, nullptr)) != CL_SUCCESS) {
-        LOG_ERR("Error %s when calling clEnqueueNDRangeKernel for kernel %d.", err_to_str(ret), 2);
-        return OCL_ERR_API;
+
+// hands the command queue and buffers of a thread of the previous algorithm to the thread of the new one,
+// buffers too small for the new algorithm or intensity are released, InitOpenCLGpu allocates them again,
+// with standby the program and kernels stay with the previous thread for a switch back
+static void moveOpenClGpu(GpuContext *from, GpuContext *to, size_t memory, bool standby)
+{
+    OclLib::finish(from->CommandQueues);
+
+    releaseEvents(from);
+
+    if (!standby || from == to) {
+        releaseKernels(from);
     }
 
-    if (variant != xmrig::VARIANT_GPU) {
-        if (OclLib::enqueueReadBuffer(ctx->CommandQueues, ctx->ExtraBuffers[2], CL_FALSE, sizeof(cl_uint) * g_intensity, sizeof(cl_uint), BranchNonces, 0, nullptr, nullptr) != CL_SUCCESS) {
-            return OCL_ERR_API;
+    if (from != to) {
+        OclLib::releaseProgram(to->ProgramFinalize);
+
+        to->threadIdx             = from->threadIdx;
+        to->opencl_ctx            = from->opencl_ctx;
+        to->platformIdx           = from->platformIdx;
+        to->DeviceID              = from->DeviceID;
+        to->DeviceString          = from->DeviceString;
+        to->amdDriverMajorVersion = from->amdDriverMajorVersion;
+        to->vendor                = from->vendor;
+        to->caps                  = from->caps;
+        to->name                  = from->name;
+        to->board                 = from->board;
+        to->computeUnits          = from->computeUnits;
+        to->freeMem               = from->freeMem;
+        to->globalMem             = from->globalMem;
+        to->profiling             = from->profiling;
+        to->CommandQueues         = from->CommandQueues;
+        to->ProgramFinalize       = from->ProgramFinalize;
+        to->InputBuffer           = from->InputBuffer;
+        to->StageBuffer           = from->StageBuffer;
+        to->inputSlot             = from->inputSlot;
+        to->OutputBuffer          = from->OutputBuffer;
+        to->ResultsBuffer         = from->ResultsBuffer;
+        to->Results               = from->Results;
+        to->ControlBuffer         = from->ControlBuffer;
+        to->Control               = from->Control;
+        to->scratchpadsSize       = from->scratchpadsSize;
+        to->buffersIntensity      = from->buffersIntensity;
+        to->arenaBuffers          = from->arenaBuffers;
+
+        from->CommandQueues   = nullptr;
+        from->ProgramFinalize = nullptr;
+        from->InputBuffer     = nullptr;
+        from->StageBuffer     = nullptr;
+        from->OutputBuffer    = nullptr;
+        from->ResultsBuffer   = nullptr;
+        from->Results         = nullptr;
+        from->ControlBuffer   = nullptr;
+        from->Control         = nullptr;
+        from->arenaBuffers    = false;
+
+        int buffer_count = sizeof(to->ExtraBuffers) / sizeof(to->ExtraBuffers[0]);
+        for (int b = 0; b < buffer_count; ++b) {
+            to->ExtraBuffers[b]   = from->ExtraBuffers[b];
+            from->ExtraBuffers[b] = nullptr;
         }
+    }
 
-        if (OclLib::enqueueReadBuffer(ctx->CommandQueues, ctx->ExtraBuffers[3], CL_FALSE, sizeof(cl_uint) * g_intensity, sizeof(cl_uint), BranchNonces + 1, 0, nullptr, nullptr) != CL_SUCCESS) {
-            return OCL_ERR_API;
-        }
+    // sub-buffers are only views, they are carved again for the new algorithm and intensity
+    releaseArenaBuffers(to);
 
-        if (OclLib::enqueueReadBuffer(ctx->CommandQueues, ctx->ExtraBuffers[4], CL_FALSE, sizeof(cl_uint) * g_intensity, sizeof(cl_uint), BranchNonces + 2, 0, nullptr, nullptr) != CL_SUCCESS) {
-            return OCL_ERR_API;
+    if (to->scratchpadsSize < memory * to->rawIntensity) {
+        OclLib::releaseMemObject(to->ExtraBuffers[0]);
+        to->ExtraBuffers[0] = nullptr;
+    }
+
+    if (to->buffersIntensity < to->rawIntensity) {
+        for (int b = 1; b < 6; ++b) {
+            OclLib::releaseMemObject(to->ExtraBuffers[b]);
+            to->ExtraBuffers[b] = nullptr;
         }
+    }
 
-        if (OclLib::enqueueReadBuffer(ctx->CommandQueues, ctx->ExtraBuffers[5], CL_FALSE, sizeof(cl_uint) * g_intensity, sizeof(cl_uint), BranchNonces + 3, 0, nullptr, nullptr) != CL_SUCCESS) {
-            return OCL_ERR_API;
+    if (from != to) {
+        if (standby) {
+            GpuMemory::setThread(from, 0, true);
+        }
+        else {
+            GpuMemory::remove(from);
         }
+    }
+}
 
-        OclLib::finish(ctx->CommandQueues);
 
-        for (int i = 0; i < 4; ++i) {
-            if (BranchNonces[i]) {
-                // Threads
-                if ((OclLib::setKernelArg(ctx->Kernels[i + 3], 4, sizeof(cl_uint), BranchNonces + i)) != CL_SUCCESS) {
-                    LOG_ERR(kSetKernelArgErr, err_to_str(ret), i + 3, 4);
-                    return OCL_ERR_API;
-                }
+size_t SwitchOpenCL(const std::vector<GpuContext *> &previous, const std::vector<GpuContext *> &contexts, xmrig::Config *config, bool standby)
+{
+    if (previous.empty() || previous.size() != contexts.size()) {
+        return OCL_ERR_BAD_PARAMS;
+    }
 
-                // round up to next multiple of w_size
-                BranchNonces[i] = ((BranchNonces[i] + w_size - 1u) / w_size) * w_size;
-                // number of global threads must be a multiple of the work group size (w_size)
-                assert(BranchNonces[i] % w_size == 0);
-                size_t tmpNonce = ctx->Nonce;
-                if ((ret = OclLib::enqueueNDRangeKernel(ctx->CommandQueues, ctx->Kernels[i + 3], 1, &tmpNonce, BranchNonces + i, &w_size, 0, nullptr, nullptr)) != CL_SUCCESS) {
-                    LOG_ERR("Error %s when calling clEnqueueNDRangeKernel for kernel %d.", err_to_str(ret), i + 3);
-                    return OCL_ERR_API;
-                }
-            }
+    // the OpenCL context is created for this exact list of devices
+    for (size_t i = 0; i < contexts.size(); ++i) {
+        if (previous[i]->CommandQueues == nullptr || previous[i]->deviceIdx != contexts[i]->deviceIdx || previous[i]->profiling != isProfiling(config)) {
+            return OCL_ERR_BAD_PARAMS;
         }
     }
 
-    if (OclLib::enqueueReadBuffer(ctx->CommandQueues, ctx->OutputBuffer, CL_TRUE, 0, sizeof(cl_uint) * 0x100, HashOutput, 0, nullptr, nullptr) != CL_SUCCESS) {
-        return OCL_ERR_API;
+    const size_t memory = xmrig::cn_select_memory(config->algorithm().algo());
+
+    for (size_t i = 0; i < contexts.size(); ++i) {
+        adjustIntensity(contexts[i]);
+        moveOpenClGpu(previous[i], contexts[i], memory, standby);
     }
 
-    OclLib::finish(ctx->CommandQueues);
-    auto & numHashValues = HashOutput[0xFF];
-    // avoid out of memory read, we have only storage for 0xFF results
-    if (numHashValues > 0xFF) {
-        numHashValues = 0xFF;
+    return initDevices(contexts, *kernelSource(), config);
+}
+
+
+// the queue, buffers and kernels of one thread are created again after its GPU failed, the threads of the other
+// GPUs keep running on the shared or their own OpenCL contexts, slot is the index of the thread among the threads of its GPU
+size_t RestartOpenCL(GpuContext *ctx, int index, size_t slot, xmrig::Config *config)
+{
+    ReleaseOpenCl(ctx);
+    adjustIntensity(ctx);
+
+    return InitOpenCLGpu(index, ctx->opencl_ctx, ctx, kernelSource()->c_str(), config, slot);
+}
+
+
+// the device memory of idle threads goes back to the driver, command queues, mapped results, programs and kernels are kept,
+// all threads of the devices must be parked together as the arenas are shared by them, see --park-after
+void ParkOpenCL(const std::vector<GpuContext *> &contexts)
+{
+    for (GpuContext *ctx : contexts) {
+        OclLib::finish(ctx->CommandQueues);
+        releaseEvents(ctx);
+        releaseArenaBuffers(ctx);
+
+        OclLib::releaseMemObject(ctx->InputBuffer);
+        OclLib::releaseMemObject(ctx->StageBuffer);
+        OclLib::releaseMemObject(ctx->OutputBuffer);
+
+        ctx->InputBuffer  = nullptr;
+        ctx->StageBuffer  = nullptr;
+        ctx->OutputBuffer = nullptr;
+        ctx->inputSlot    = 0;
+
+        int buffer_count = sizeof(ctx->ExtraBuffers) / sizeof(ctx->ExtraBuffers[0]);
+        for (int b = 0; b < buffer_count; ++b) {
+            OclLib::releaseMemObject(ctx->ExtraBuffers[b]);
+            ctx->ExtraBuffers[b] = nullptr;
+        }
+
+        ctx->scratchpadsSize  = 0;
+        ctx->buffersIntensity = 0;
+
+        GpuMemory::setThread(ctx, 0, false);
     }
 
-    ctx->Nonce += (uint32_t) g_intensity;
+    releaseArenas();
+}
 
-    return OCL_ERR_SUCCESS;
+
+// buffers are allocated again for the current algorithm, InitOpenCLGpu only binds the kernel arguments to them
+size_t UnparkOpenCL(const std::vector<GpuContext *> &contexts, xmrig::Config *config)
+{
+    createArenas(contexts, config);
+
+    return initDevices(contexts, *kernelSource(), config);
+}
+
+
+// drops the standby program and kernels of an idle thread context
+void ReleaseOpenClKernels(GpuContext *ctx)
+{
+    releaseKernels(ctx);
+    GpuMemory::remove(ctx);
 }
 
 
 void ReleaseOpenCl(GpuContext* ctx)
 {
+    if (ctx->CommandQueues) {
+        OclLib::finish(ctx->CommandQueues);
+    }
+
+    releaseEvents(ctx);
+
+    if (ctx->Results) {
+        OclLib::enqueueUnmapMemObject(ctx->CommandQueues, ctx->ResultsBuffer, ctx->Results, 0, nullptr, nullptr);
+        OclLib::finish(ctx->CommandQueues);
+        ctx->Results = nullptr;
+    }
+
+    if (ctx->Control) {
+        OclLib::enqueueUnmapMemObject(ctx->CommandQueues, ctx->ControlBuffer, ctx->Control, 0, nullptr, nullptr);
+        OclLib::finish(ctx->CommandQueues);
+        ctx->Control = nullptr;
+    }
+
+    releaseArenaBuffers(ctx);
+
     OclLib::releaseMemObject(ctx->InputBuffer);
+    OclLib::releaseMemObject(ctx->StageBuffer);
     OclLib::releaseMemObject(ctx->OutputBuffer);
+    OclLib::releaseMemObject(ctx->ResultsBuffer);
+    OclLib::releaseMemObject(ctx->ControlBuffer);
+
+    ctx->InputBuffer   = nullptr;
+    ctx->StageBuffer   = nullptr;
+    ctx->inputSlot     = 0;
+    ctx->OutputBuffer  = nullptr;
+    ctx->ResultsBuffer = nullptr;
+    ctx->ControlBuffer = nullptr;
 
     int buffer_count = sizeof(ctx->ExtraBuffers) / sizeof(ctx->ExtraBuffers[0]);
     for (int b = 0; b < buffer_count; ++b) {
         OclLib::releaseMemObject(ctx->ExtraBuffers[b]);
+        ctx->ExtraBuffers[b] = nullptr;
     }
 
-    OclLib::releaseProgram(ctx->Program);
+    releaseKernels(ctx);
 
-    int kernel_count = sizeof(ctx->Kernels) / sizeof(ctx->Kernels[0]);
-    for (int k = 0; k < kernel_count; ++k) {
-        if (ctx->Kernels[k]) {
-            OclLib::releaseKernel(ctx->Kernels[k]);
-        }
-    }
+    OclLib::releaseProgram(ctx->ProgramFinalize);
+    ctx->ProgramFinalize = nullptr;
 
     OclLib::releaseCommandQueue(ctx->CommandQueues);
+    ctx->CommandQueues = nullptr;
+
+    GpuMemory::remove(ctx);
 }
 
 
-void ReleaseOpenClContext(cl_context opencl_ctx)
+// sub-buffers of all threads are released before
+void ReleaseOpenClContexts(std::vector<cl_context> &opencl_contexts)
 {
-    OclLib::releaseContext(opencl_ctx);
+    releaseArenas();
+    releaseFinalizePrograms(opencl_contexts);
+
+    for (cl_context opencl_ctx : opencl_contexts) {
+        OclLib::releaseContext(opencl_ctx);
+    }
+
+    opencl_contexts.clear();
 }
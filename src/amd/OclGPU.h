@@ -28,10 +28,14 @@
 #define XMRIG_OCLGPU_H
 
 
+#include <atomic>
+#include <thread>
+#include <utility>
 #include <vector>
 
 
 #include "amd/GpuContext.h"
+#include "common/crypto/Algorithm.h"
 #include "common/xmrig.h"
 
 
@@ -44,18 +48,38 @@ class OclGPU
 {
 public:
     static int findPlatformIdx(xmrig::Config *config);
-    static std::vector<GpuContext> getDevices(xmrig::Config *config);
-
-private:
     static int findPlatformIdx(xmrig::OclVendor vendor, char *name, size_t nameSize);
+    static size_t deviceOffset(size_t platformIndex, const xmrig::Config *config);
+    static size_t getDeviceCount(const xmrig::Config *config);
+    static size_t getDeviceCount(size_t platformIndex, const xmrig::Config *config);
+    static std::vector<GpuContext> getDevices(xmrig::Config *config);
 };
 
 
 void printPlatforms();
 
-size_t InitOpenCL(const std::vector<GpuContext *> &contexts, xmrig::Config *config, cl_context *opencl_ctx);
+// XMRRunJob output: up to OCL_RESULT_SLOTS nonces with their count at index OCL_RESULT_SLOTS, followed by the 32 byte
+// final hash of each nonce; the kernels count results past the last slot too, the host clamps the count and keeps the rest
+// in GpuContext::lostResults
+constexpr const size_t OCL_RESULT_SLOTS  = 0x3FF;
+constexpr const size_t OCL_RESULT_HASHES = OCL_RESULT_SLOTS + 1;
+constexpr const size_t OCL_RESULT_SIZE   = OCL_RESULT_HASHES + OCL_RESULT_SLOTS * 8;
+
+
+size_t InitOpenCL(const std::vector<GpuContext *> &contexts, xmrig::Config *config, std::vector<cl_context> *opencl_contexts, bool threads = true);
+size_t InitOpenCLThread(GpuContext *ctx, int index, size_t slot, xmrig::Config *config);
+std::thread PrebuildOpenCL(const std::vector<GpuContext *> &running, const std::vector<GpuContext *> &contexts, const xmrig::Algorithm &algorithm, xmrig::Config *config);
+void PrepareOpenCL(const std::vector<GpuContext *> &contexts, const xmrig::Algorithm &algorithm, uint64_t height, xmrig::Config *config);
+std::thread PrewarmOpenCL(const std::vector<GpuContext *> &running, const std::vector<std::pair<xmrig::Algorithm, std::vector<GpuContext *> > > &algorithms, xmrig::PerfAlgo standby, xmrig::Config *config, const std::atomic<bool> &stop);
+size_t SwitchOpenCL(const std::vector<GpuContext *> &previous, const std::vector<GpuContext *> &contexts, xmrig::Config *config, bool standby);
+size_t RestartOpenCL(GpuContext *ctx, int index, size_t slot, xmrig::Config *config);
+size_t UnparkOpenCL(const std::vector<GpuContext *> &contexts, xmrig::Config *config);
 size_t XMRSetJob(GpuContext *ctx, uint8_t *input, size_t input_len, uint64_t target, xmrig::Variant variant, uint64_t height);
-size_t XMRRunJob(GpuContext *ctx, cl_uint *HashOutput, xmrig::Variant variant);
+size_t XMRStageJob(GpuContext *ctx, const uint8_t *input, size_t input_len);
+size_t XMRRunJob(GpuContext *ctx, cl_uint *HashOutput, xmrig::Variant variant, size_t intensity);
+size_t XMRDrainJob(GpuContext *ctx, cl_uint *HashOutput);
+void ParkOpenCL(const std::vector<GpuContext *> &contexts);
 void ReleaseOpenCl(GpuContext* ctx);
-void ReleaseOpenClContext(cl_context opencl_ctx);
+void ReleaseOpenClKernels(GpuContext *ctx);
+void ReleaseOpenClContexts(std::vector<cl_context> &opencl_contexts);
 #endif /* XMRIG_OCLGPU_H */
@@ -0,0 +1,220 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <chrono>
+#include <set>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+
+#include "amd/OclError.h"
+#include "amd/OclGPU.h"
+#include "amd/OclHostBench.h"
+#include "amd/OclKernelBench.h"
+#include "common/log/Log.h"
+#include "common/Platform.h"
+#include "core/Config.h"
+#include "core/Controller.h"
+#include "crypto/CryptoNight_test.h"
+#include "interfaces/IThread.h"
+#include "rapidjson/document.h"
+#include "rapidjson/prettywriter.h"
+#include "rapidjson/stringbuffer.h"
+
+
+namespace {
+
+// ns per batch or per switch
+struct HostTimes
+{
+    uint64_t batch;
+    uint64_t cpu;
+    uint64_t kernels;
+    uint64_t jobSwitch;
+    uint64_t switchCpu;
+};
+
+}
+
+
+static const size_t kTestBlobSize = 76;
+
+// batches run before the measurement, the first ones include program and buffer warm-up
+static const size_t kWarmup = 4;
+
+// measurement time of the batches in ms
+static const int64_t kBatchTime = 3000;
+
+// jobs switched between two test blobs
+static const size_t kSwitches = 32;
+
+// the host time includes reading results back, at difficulty 65536 a batch has a few of them
+static const uint64_t kTarget = 0xFFFFFFFFFFFFFFFFULL / 65536;
+
+
+static inline uint64_t elapsed(const std::chrono::steady_clock::time_point &start)
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+
+static bool setJob(GpuContext *ctx, xmrig::Variant variant, size_t blob)
+{
+    alignas(16) uint8_t input[128] = { 0 };
+    memcpy(input, test_input + blob * kTestBlobSize, kTestBlobSize);
+
+    ctx->Nonce = 0;
+
+    return XMRSetJob(ctx, input, kTestBlobSize, kTarget, variant, 0) == OCL_ERR_SUCCESS;
+}
+
+
+// like OclWorker, a pipelined batch still in flight is drained before the next job is set
+static bool measure(GpuContext *ctx, xmrig::Variant variant, HostTimes *times)
+{
+    cl_uint results[OCL_RESULT_SIZE];
+
+    if (!setJob(ctx, variant, 0)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < kWarmup; ++i) {
+        if (XMRRunJob(ctx, results, variant, ctx->rawIntensity) != OCL_ERR_SUCCESS) {
+            return false;
+        }
+    }
+
+    memset(ctx->ProfileTimes, 0, sizeof(ctx->ProfileTimes));
+
+    auto start        = std::chrono::steady_clock::now();
+    uint64_t cpuStart = Platform::threadCpuTime();
+    uint64_t batches  = 0;
+
+    do {
+        if (XMRRunJob(ctx, results, variant, ctx->rawIntensity) != OCL_ERR_SUCCESS) {
+            return false;
+        }
+
+        batches++;
+    } while (elapsed(start) < static_cast<uint64_t>(kBatchTime) * 1000000);
+
+    times->batch = elapsed(start) / batches;
+    times->cpu   = (Platform::threadCpuTime() - cpuStart) / batches;
+
+    times->kernels = 0;
+    for (size_t k = 0; k < GpuContext::ProfileMax; ++k) {
+        times->kernels += ctx->ProfileTimes[k];
+    }
+
+    start    = std::chrono::steady_clock::now();
+    cpuStart = Platform::threadCpuTime();
+
+    for (size_t i = 0; i < kSwitches; ++i) {
+        if (ctx->pipeline && XMRDrainJob(ctx, results) != OCL_ERR_SUCCESS) {
+            return false;
+        }
+
+        if (!setJob(ctx, variant, (i + 1) % 2) || XMRRunJob(ctx, results, variant, ctx->rawIntensity) != OCL_ERR_SUCCESS) {
+            return false;
+        }
+    }
+
+    times->jobSwitch = elapsed(start) / kSwitches;
+    times->switchCpu = (Platform::threadCpuTime() - cpuStart) / kSwitches;
+
+    return !ctx->pipeline || XMRDrainJob(ctx, results) == OCL_ERR_SUCCESS;
+}
+
+
+int xmrig::OclHostBench::exec(Controller *controller)
+{
+    using namespace rapidjson;
+
+    Config *config = controller->config();
+    config->setOclProfiling(true);
+
+    // Algorithm(PerfAlgo) has the variant of the perf algo resolved
+    const Algorithm algorithm(config->algorithm().perf_algo());
+    config->set_algorithm(algorithm);
+
+    std::set<size_t> devices;
+    for (const IThread *thread : config->threads()) {
+        devices.insert(thread->index());
+    }
+
+    Document doc(kObjectType);
+    auto &allocator = doc.GetAllocator();
+
+    Value rows(kArrayType);
+    size_t failed = 0;
+
+    for (const size_t index : devices) {
+        GpuContext ctx;
+        std::vector<cl_context> contexts;
+        OclKernelBench::baseContext(config, PA_INVALID, index, &ctx);
+
+        HostTimes times = HostTimes();
+        const bool result = InitOpenCL(std::vector<GpuContext *>(1, &ctx), config, &contexts) == OCL_ERR_SUCCESS &&
+                            measure(&ctx, algorithm.variant(), &times);
+
+        ReleaseOpenCl(&ctx);
+        ReleaseOpenClContexts(contexts);
+
+        if (!result) {
+            LOG_ERR("GPU #%zu %s: FAILED", index, algorithm.shortName());
+            failed++;
+            continue;
+        }
+
+        LOG_INFO("GPU #%zu %s batch %.1f us (cpu %.1f us, kernels %.1f us), job switch %.1f us (cpu %.1f us)",
+                 index, algorithm.shortName(), times.batch / 1e3, times.cpu / 1e3, times.kernels / 1e3, times.jobSwitch / 1e3, times.switchCpu / 1e3);
+
+        Value row(kObjectType);
+        row.AddMember("gpu",            static_cast<uint64_t>(index), allocator);
+        row.AddMember("algo",           StringRef(algorithm.shortName()), allocator);
+        row.AddMember("intensity",      static_cast<uint64_t>(ctx.rawIntensity), allocator);
+        row.AddMember("pipeline",       ctx.pipeline, allocator);
+        row.AddMember("batch_us",       times.batch / 1e3, allocator);
+        row.AddMember("cpu_us",         times.cpu / 1e3, allocator);
+        row.AddMember("kernels_us",     times.kernels / 1e3, allocator);
+        row.AddMember("switch_us",      times.jobSwitch / 1e3, allocator);
+        row.AddMember("switch_cpu_us",  times.switchCpu / 1e3, allocator);
+
+        rows.PushBack(row, allocator);
+    }
+
+    doc.AddMember("host", rows, allocator);
+
+    StringBuffer buffer(nullptr, 4096);
+    PrettyWriter<StringBuffer> writer(buffer);
+    doc.Accept(writer);
+
+    printf("%s\n", buffer.GetString());
+    fflush(stdout);
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,535 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <algorithm>
+#include <inttypes.h>
+#include <set>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+
+#include "amd/OclError.h"
+#include "amd/OclGPU.h"
+#include "amd/OclKernelBench.h"
+#include "common/log/Log.h"
+#include "common/utils/timestamp.h"
+#include "core/Config.h"
+#include "core/Controller.h"
+#include "crypto/CryptoNight_test.h"
+#include "rapidjson/document.h"
+#include "rapidjson/prettywriter.h"
+#include "rapidjson/stringbuffer.h"
+#include "workers/OclThread.h"
+
+
+namespace {
+
+struct KernelTest
+{
+    xmrig::Algo algo;
+    xmrig::Variant variant;
+    const uint8_t *reference;
+    bool heights;
+};
+
+
+struct SweepPoint
+{
+    size_t index;
+    size_t intensity;
+    size_t worksize;
+    double hashrate;
+    uint64_t batchTime;
+    uint64_t kernelTime[GpuContext::ProfileMax];
+};
+
+
+// milliseconds, see --park-after
+struct ResumeTimes
+{
+    int64_t coldStart;
+    int64_t park;
+    int64_t unpark;
+    int64_t firstBatch;
+};
+
+}
+
+
+// the vectors of the CPU self-test, every GPU must give the same hashes
+static const KernelTest kTests[] = {
+#   ifndef XMRIG_NO_CN_GPU
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_GPU,    test_output_gpu,        false },
+#   endif
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_WOW,    test_output_wow,        true  },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_4,      test_output_r,          true  },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_DOUBLE, test_output_double,     false },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_0,      test_output_v0,         false },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_1,      test_output_v1,         false },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_2,      test_output_v2,         false },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_XTL,    test_output_xtl,        false },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_MSR,    test_output_msr,        false },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_XAO,    test_output_xao,        false },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_RTO,    test_output_rto,        false },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_HALF,   test_output_half,       false },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_RWZ,    test_output_rwz,        false },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_ZLS,    test_output_zls,        false },
+#   ifndef XMRIG_NO_AEON
+    { xmrig::CRYPTONIGHT_LITE,  xmrig::VARIANT_0,      test_output_v0_lite,    false },
+    { xmrig::CRYPTONIGHT_LITE,  xmrig::VARIANT_1,      test_output_v1_lite,    false },
+#   endif
+#   ifndef XMRIG_NO_SUMO
+    { xmrig::CRYPTONIGHT_HEAVY, xmrig::VARIANT_0,      test_output_v0_heavy,   false },
+    { xmrig::CRYPTONIGHT_HEAVY, xmrig::VARIANT_XHV,    test_output_xhv_heavy,  false },
+    { xmrig::CRYPTONIGHT_HEAVY, xmrig::VARIANT_TUBE,   test_output_tube_heavy, false },
+#   endif
+#   ifndef XMRIG_NO_CN_PICO
+    { xmrig::CRYPTONIGHT_PICO,  xmrig::VARIANT_TRTL,   test_output_pico_trtl,  false },
+#   endif
+};
+
+
+// test_input holds 5 blobs of 76 bytes, the reference has the hash of each
+static const size_t kTestBlobs = 5;
+static const size_t kTestBlobSize = 76;
+
+// batches run before the measurement of a sweep point, the first ones include program and buffer warm-up
+static const size_t kWarmup = 4;
+
+// measurement time of one sweep point in ms
+static const int64_t kSweepTime = 3000;
+
+// difficulty 65536, batches have a few results to read back like when mining
+static const uint64_t kTarget = 0xFFFFFFFFFFFFFFFFULL / 65536;
+
+static const char *const kKernels[GpuContext::ProfileMax] = { "cn0", "cn00", "cn1", "cn2", "final" };
+
+
+static bool init(xmrig::Config *config, const xmrig::Algorithm &algorithm, GpuContext *ctx, std::vector<cl_context> *contexts)
+{
+    config->set_algorithm(algorithm);
+
+    return InitOpenCL(std::vector<GpuContext *>(1, ctx), config, contexts) == OCL_ERR_SUCCESS;
+}
+
+
+static void release(GpuContext *ctx, std::vector<cl_context> &contexts)
+{
+    ReleaseOpenCl(ctx);
+    ReleaseOpenClContexts(contexts);
+}
+
+
+// the kernels put the nonce of the work item at offset 39, so the first item of a batch started at the nonce
+// of the vector computes its hash, the target is the top of the expected hash, few other hashes pass it
+static bool check(GpuContext *ctx, xmrig::Variant variant, const uint8_t *input, size_t size, uint64_t height, const uint8_t *reference)
+{
+    alignas(16) uint8_t blob[128] = { 0 };
+    memcpy(blob, input, size);
+
+    uint32_t nonce = 0;
+    memcpy(&nonce, input + 39, sizeof(nonce));
+
+    uint64_t target = 0;
+    memcpy(&target, reference + 24, sizeof(target));
+
+    if (XMRSetJob(ctx, blob, size, target, variant, height) != OCL_ERR_SUCCESS) {
+        return false;
+    }
+
+    cl_uint results[OCL_RESULT_SIZE];
+    ctx->Nonce = nonce;
+
+    if (XMRRunJob(ctx, results, variant, std::min(ctx->rawIntensity, ctx->workSize)) != OCL_ERR_SUCCESS) {
+        return false;
+    }
+
+    for (size_t i = 0; i < results[OCL_RESULT_SLOTS]; ++i) {
+        if (results[i] == nonce) {
+            return memcmp(results + OCL_RESULT_HASHES + i * 8, reference, 32) == 0;
+        }
+    }
+
+    return false;
+}
+
+
+static bool check(GpuContext *ctx, const KernelTest &test)
+{
+    if (test.heights) {
+        for (size_t i = 0; i < sizeof(cn_r_test_input) / sizeof(cn_r_test_input[0]); ++i) {
+            if (!check(ctx, test.variant, cn_r_test_input[i].data, cn_r_test_input[i].size, cn_r_test_input[i].height, test.reference + i * 32)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    for (size_t i = 0; i < kTestBlobs; ++i) {
+        if (!check(ctx, test.variant, test_input + i * kTestBlobSize, kTestBlobSize, 0, test.reference + i * 32)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+// kernel times are averages of the driver profiling events of the measured batches
+static bool measure(GpuContext *ctx, xmrig::Variant variant, SweepPoint *point)
+{
+    alignas(16) uint8_t blob[128] = { 0 };
+    memcpy(blob, test_input, kTestBlobSize);
+
+    if (XMRSetJob(ctx, blob, kTestBlobSize, kTarget, variant, 0) != OCL_ERR_SUCCESS) {
+        return false;
+    }
+
+    cl_uint results[OCL_RESULT_SIZE];
+    ctx->Nonce = 0;
+
+    for (size_t i = 0; i < kWarmup; ++i) {
+        if (XMRRunJob(ctx, results, variant, ctx->rawIntensity) != OCL_ERR_SUCCESS) {
+            return false;
+        }
+    }
+
+    memset(ctx->ProfileTimes, 0, sizeof(ctx->ProfileTimes));
+
+    const int64_t start = xmrig::steadyTimestamp();
+    int64_t elapsed     = 0;
+    size_t batches      = 0;
+
+    do {
+        if (XMRRunJob(ctx, results, variant, ctx->rawIntensity) != OCL_ERR_SUCCESS) {
+            return false;
+        }
+
+        batches++;
+        elapsed = xmrig::steadyTimestamp() - start;
+    } while (elapsed < kSweepTime);
+
+    if (ctx->pipeline && XMRDrainJob(ctx, results) != OCL_ERR_SUCCESS) {
+        return false;
+    }
+
+    point->intensity = ctx->rawIntensity;
+    point->worksize  = ctx->workSize;
+    point->hashrate  = static_cast<double>(batches * ctx->rawIntensity) * 1000.0 / static_cast<double>(elapsed);
+    point->batchTime = static_cast<uint64_t>(elapsed) * 1000000 / batches;
+    memcpy(point->kernelTime, ctx->ProfileTimes, sizeof(point->kernelTime));
+
+    return true;
+}
+
+
+// a cold start creates the context and queue, allocates the buffers and loads the program, a parked GPU only allocates
+// the buffers again, its first batch pays for the memory the driver maps on first use
+static bool resume(xmrig::Config *config, const xmrig::Algorithm &algorithm, size_t index, ResumeTimes *times)
+{
+    GpuContext ctx;
+    std::vector<cl_context> contexts;
+    xmrig::OclKernelBench::baseContext(config, algorithm.perf_algo(), index, &ctx);
+    ctx.pipeline = false;
+
+    alignas(16) uint8_t blob[128] = { 0 };
+    memcpy(blob, test_input, kTestBlobSize);
+
+    cl_uint results[OCL_RESULT_SIZE];
+    const std::vector<GpuContext *> list(1, &ctx);
+
+    int64_t start = xmrig::steadyTimestamp();
+    bool result   = init(config, algorithm, &ctx, &contexts);
+    times->coldStart = xmrig::steadyTimestamp() - start;
+
+    result = result && XMRSetJob(&ctx, blob, kTestBlobSize, kTarget, algorithm.variant(), 0) == OCL_ERR_SUCCESS &&
+             XMRRunJob(&ctx, results, algorithm.variant(), ctx.rawIntensity) == OCL_ERR_SUCCESS;
+
+    if (result) {
+        start = xmrig::steadyTimestamp();
+        ParkOpenCL(list);
+        times->park = xmrig::steadyTimestamp() - start;
+
+        start  = xmrig::steadyTimestamp();
+        result = UnparkOpenCL(list, config) == OCL_ERR_SUCCESS;
+        times->unpark = xmrig::steadyTimestamp() - start;
+
+        start  = xmrig::steadyTimestamp();
+        result = result && XMRSetJob(&ctx, blob, kTestBlobSize, kTarget, algorithm.variant(), 0) == OCL_ERR_SUCCESS &&
+                 XMRRunJob(&ctx, results, algorithm.variant(), ctx.rawIntensity) == OCL_ERR_SUCCESS;
+        times->firstBatch = xmrig::steadyTimestamp() - start;
+    }
+
+    release(&ctx, contexts);
+
+    return result;
+}
+
+
+// worksizes of half and double the configured one, intensities of 3/4 and 5/4 of it, rounded to the worksize
+static std::vector<std::pair<size_t, size_t> > sweepPoints(const GpuContext &base)
+{
+    std::vector<std::pair<size_t, size_t> > points;
+    const size_t worksizes[]   = { base.workSize / 2, base.workSize, base.workSize * 2 };
+    const size_t intensities[] = { base.rawIntensity * 3 / 4, base.rawIntensity, base.rawIntensity * 5 / 4 };
+
+    for (const size_t worksize : worksizes) {
+        if (worksize < 8 || worksize > 256) {
+            continue;
+        }
+
+        for (const size_t intensity : intensities) {
+            if (intensity >= worksize) {
+                points.push_back(std::make_pair(intensity / worksize * worksize, worksize));
+            }
+        }
+    }
+
+    return points;
+}
+
+
+// the first config thread of the GPU in the perf algo gives the settings, PA_INVALID is the algo of the config
+bool xmrig::OclKernelBench::baseContext(const Config *config, PerfAlgo pa, size_t index, GpuContext *ctx)
+{
+    for (const IThread *thread : config->threads(pa)) {
+        if (thread->index() == index) {
+            baseContext(static_cast<const OclThread *>(thread)->ctx(), ctx);
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+// the kernels of a context whose threads are stopped or paused, true if the algorithm has no test vectors
+bool xmrig::OclKernelBench::verify(GpuContext *ctx, const Algorithm &algorithm)
+{
+    for (const KernelTest &test : kTests) {
+        if (test.algo != algorithm.algo() || test.variant != algorithm.variant()) {
+            continue;
+        }
+
+        // results of a pipelined batch come with the next one, nothing is in flight before the first job
+        const bool pipeline  = ctx->pipeline;
+        const uint32_t nonce = ctx->Nonce;
+        ctx->pipeline        = false;
+
+        const bool result = check(ctx, test);
+
+        ctx->pipeline = pipeline;
+        ctx->Nonce    = nonce;
+
+        return result;
+    }
+
+    return true;
+}
+
+
+// a context of its own with the settings of a config thread: a single thread, InitOpenCL makes its queue,
+// buffers and programs, the bench tools, diagnostics, --verify-gpu and the dual threads start from it
+void xmrig::OclKernelBench::baseContext(const GpuContext *src, GpuContext *ctx)
+{
+    ctx->deviceIdx     = src->deviceIdx;
+    ctx->rawIntensity  = src->rawIntensity;
+    ctx->workSize      = src->workSize;
+    ctx->stridedIndex  = src->stridedIndex;
+    ctx->memChunk      = src->memChunk;
+    ctx->compMode      = src->compMode;
+    ctx->unrollFactor  = src->unrollFactor;
+    ctx->hashesPerItem = src->hashesPerItem;
+    ctx->buildFlags    = src->buildFlags;
+    ctx->pipeline      = src->pipeline;
+    ctx->persistent    = src->persistent;
+    ctx->lowCpu        = src->lowCpu;
+    ctx->threads       = 1;
+}
+
+
+int xmrig::OclKernelBench::exec(Controller *controller)
+{
+    using namespace rapidjson;
+
+    Config *config           = controller->config();
+    const Algorithm original = config->algorithm();
+
+    config->setOclProfiling(true);
+
+    std::set<size_t> devices;
+    for (int a = 0; a != PerfAlgo::PA_MAX; ++a) {
+        for (const IThread *thread : config->threads(static_cast<PerfAlgo>(a))) {
+            devices.insert(thread->index());
+        }
+    }
+
+    Document doc(kObjectType);
+    auto &allocator = doc.GetAllocator();
+
+    Value tests(kArrayType);
+    size_t failed = 0;
+
+    for (const KernelTest &test : kTests) {
+        const Algorithm algorithm(test.algo, test.variant);
+
+        for (const size_t index : devices) {
+            GpuContext ctx;
+            std::vector<cl_context> contexts;
+            if (!baseContext(config, algorithm.perf_algo(), index, &ctx)) {
+                continue;
+            }
+
+            // results of a pipelined batch come with the next one
+            ctx.pipeline = false;
+
+            const bool result = init(config, algorithm, &ctx, &contexts) && check(&ctx, test);
+            release(&ctx, contexts);
+
+            if (result) {
+                LOG_INFO("GPU #%zu %s: OK", index, algorithm.shortName());
+            }
+            else {
+                LOG_ERR("GPU #%zu %s: FAILED", index, algorithm.shortName());
+                failed++;
+            }
+
+            Value row(kObjectType);
+            row.AddMember("gpu",    static_cast<uint64_t>(index), allocator);
+            row.AddMember("algo",   StringRef(algorithm.shortName()), allocator);
+            row.AddMember("result", result, allocator);
+
+            tests.PushBack(row, allocator);
+        }
+    }
+
+    // the sweep runs the perf algo of the config algo, Algorithm(PerfAlgo) has its variant resolved
+    const Algorithm algorithm(original.perf_algo());
+    Value sweep(kArrayType);
+
+    for (const size_t index : devices) {
+        GpuContext base;
+        if (!baseContext(config, algorithm.perf_algo(), index, &base)) {
+            continue;
+        }
+
+        SweepPoint best = SweepPoint();
+
+        for (const std::pair<size_t, size_t> &value : sweepPoints(base)) {
+            GpuContext ctx;
+            std::vector<cl_context> contexts;
+            baseContext(config, algorithm.perf_algo(), index, &ctx);
+            ctx.rawIntensity = value.first;
+            ctx.workSize     = value.second;
+
+            SweepPoint point = SweepPoint();
+            point.index      = index;
+
+            const bool result = init(config, algorithm, &ctx, &contexts) && measure(&ctx, algorithm.variant(), &point);
+            release(&ctx, contexts);
+
+            if (!result) {
+                LOG_WARN("GPU #%zu %s intensity %zu worksize %zu: failed", index, algorithm.shortName(), value.first, value.second);
+                continue;
+            }
+
+            LOG_INFO("GPU #%zu %s intensity %zu worksize %zu: %.1f H/s, batch %.2f ms",
+                     index, algorithm.shortName(), point.intensity, point.worksize, point.hashrate, point.batchTime / 1e6);
+
+            if (point.hashrate > best.hashrate) {
+                best = point;
+            }
+
+            Value kernels(kObjectType);
+            for (size_t k = 0; k < GpuContext::ProfileMax; ++k) {
+                if (point.kernelTime[k]) {
+                    kernels.AddMember(StringRef(kKernels[k]), point.kernelTime[k] / 1e6, allocator);
+                }
+            }
+
+            Value row(kObjectType);
+            row.AddMember("gpu",        static_cast<uint64_t>(index), allocator);
+            row.AddMember("algo",       StringRef(algorithm.shortName()), allocator);
+            row.AddMember("intensity",  static_cast<uint64_t>(point.intensity), allocator);
+            row.AddMember("worksize",   static_cast<uint64_t>(point.worksize), allocator);
+            row.AddMember("hashrate",   point.hashrate, allocator);
+            row.AddMember("batch_ms",   point.batchTime / 1e6, allocator);
+            row.AddMember("kernels_ms", kernels, allocator);
+
+            sweep.PushBack(row, allocator);
+        }
+
+        if (best.hashrate > 0.0) {
+            LOG_NOTICE("GPU #%zu %s best: intensity %zu worksize %zu, %.1f H/s", index, algorithm.shortName(), best.intensity, best.worksize, best.hashrate);
+        }
+    }
+
+    Value resumes(kArrayType);
+
+    for (const size_t index : devices) {
+        GpuContext base;
+        if (!baseContext(config, algorithm.perf_algo(), index, &base)) {
+            continue;
+        }
+
+        ResumeTimes times = ResumeTimes();
+        if (!resume(config, algorithm, index, &times)) {
+            LOG_WARN("GPU #%zu %s resume: failed", index, algorithm.shortName());
+            continue;
+        }
+
+        LOG_INFO("GPU #%zu %s cold start %" PRId64 " ms, park %" PRId64 " ms, unpark %" PRId64 " ms, first batch %" PRId64 " ms",
+                 index, algorithm.shortName(), times.coldStart, times.park, times.unpark, times.firstBatch);
+
+        Value row(kObjectType);
+        row.AddMember("gpu",            static_cast<uint64_t>(index), allocator);
+        row.AddMember("algo",           StringRef(algorithm.shortName()), allocator);
+        row.AddMember("cold_start_ms",  times.coldStart, allocator);
+        row.AddMember("park_ms",        times.park, allocator);
+        row.AddMember("unpark_ms",      times.unpark, allocator);
+        row.AddMember("first_batch_ms", times.firstBatch, allocator);
+
+        resumes.PushBack(row, allocator);
+    }
+
+    config->set_algorithm(original);
+
+    doc.AddMember("tests", tests, allocator);
+    doc.AddMember("sweep", sweep, allocator);
+    doc.AddMember("resume", resumes, allocator);
+
+    StringBuffer buffer(nullptr, 4096);
+    PrettyWriter<StringBuffer> writer(buffer);
+    doc.Accept(writer);
+
+    printf("%s\n", buffer.GetString());
+    fflush(stdout);
+
+    return failed ? 1 : 0;
+}
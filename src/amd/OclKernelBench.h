@@ -0,0 +1,63 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef XMRIG_OCLKERNELBENCH_H
+#define XMRIG_OCLKERNELBENCH_H
+
+
+#include <stddef.h>
+
+
+#include "common/xmrig.h"
+
+
+struct GpuContext;
+
+
+namespace xmrig {
+
+
+class Algorithm;
+class Config;
+class Controller;
+
+
+// ocl-kernel-bench, the kernels of every variant are checked against the known hashes of CryptoNight_test.h on
+// each GPU of the config threads, then intensity and worksize of the current algo are swept around the configured
+// values, the report with throughput and kernel times is printed as JSON, the exit code is 1 if a check failed
+class OclKernelBench
+{
+public:
+    static bool baseContext(const Config *config, PerfAlgo pa, size_t index, GpuContext *ctx);
+    static bool verify(GpuContext *ctx, const Algorithm &algorithm);
+    static int exec(Controller *controller);
+    static void baseContext(const GpuContext *src, GpuContext *ctx);
+};
+
+
+} /* namespace xmrig */
+
+
+#endif /* XMRIG_OCLKERNELBENCH_H */
@@ -23,12 +23,18 @@
  */
 
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
 #include <uv.h>
 
 
 #include "amd/OclError.h"
 #include "amd/OclLib.h"
 #include "common/log/Log.h"
+#include "core/Trace.h"
 
 
 static uv_lib_t oclLib;
@@ -43,12 +49,20 @@ static const char *kCreateContext                    = "clCreateContext";
 static const char *kCreateKernel                     = "clCreateKernel";
 static const char *kCreateProgramWithBinary          = "clCreateProgramWithBinary";
 static const char *kCreateProgramWithSource          = "clCreateProgramWithSource";
+static const char *kCreateSubBuffer                  = "clCreateSubBuffer";
+static const char *kEnqueueCopyBuffer                = "clEnqueueCopyBuffer";
+static const char *kEnqueueMapBuffer                 = "clEnqueueMapBuffer";
 static const char *kEnqueueNDRangeKernel             = "clEnqueueNDRangeKernel";
 static const char *kEnqueueReadBuffer                = "clEnqueueReadBuffer";
+static const char *kEnqueueUnmapMemObject           = "clEnqueueUnmapMemObject";
 static const char *kEnqueueWriteBuffer               = "clEnqueueWriteBuffer";
 static const char *kFinish                           = "clFinish";
+static const char *kFlush                            = "clFlush";
 static const char *kGetDeviceIDs                     = "clGetDeviceIDs";
 static const char *kGetDeviceInfo                    = "clGetDeviceInfo";
+static const char *kGetEventInfo                     = "clGetEventInfo";
+static const char *kGetEventProfilingInfo            = "clGetEventProfilingInfo";
+static const char *kGetKernelWorkGroupInfo           = "clGetKernelWorkGroupInfo";
 static const char *kGetPlatformIDs                   = "clGetPlatformIDs";
 static const char *kGetPlatformInfo                  = "clGetPlatformInfo";
 static const char *kGetProgramBuildInfo              = "clGetProgramBuildInfo";
@@ -59,6 +73,10 @@ static const char *kReleaseProgram                   = "clReleaseProgram";
 static const char *kReleaseKernel                    = "clReleaseKernel";
 static const char *kReleaseCommandQueue              = "clReleaseCommandQueue";
 static const char *kReleaseContext                   = "clReleaseContext";
+static const char *kReleaseEvent                     = "clReleaseEvent";
+static const char *kRetainEvent                      = "clRetainEvent";
+static const char *kRetainProgram                    = "clRetainProgram";
+static const char *kWaitForEvents                    = "clWaitForEvents";
 
 #if defined(CL_VERSION_2_0)
 typedef cl_command_queue (CL_API_CALL *createCommandQueueWithProperties_t)(cl_context, cl_device_id, const cl_queue_properties *, cl_int *);
@@ -67,12 +85,19 @@ typedef cl_command_queue (CL_API_CALL *createCommandQueueWithProperties_t)(cl_co
 typedef cl_command_queue (CL_API_CALL *createCommandQueue_t)(cl_context, cl_device_id, cl_command_queue_properties, cl_int *);
 typedef cl_context (CL_API_CALL *createContext_t)(const cl_context_properties *, cl_uint, const cl_device_id *, void (CL_CALLBACK *pfn_notify)(const char *, const void *, size_t, void *), void *, cl_int *);
 typedef cl_int (CL_API_CALL *buildProgram_t)(cl_program, cl_uint, const cl_device_id *, const char *, void (CL_CALLBACK *pfn_notify)(cl_program, void *), void *);
+typedef cl_int (CL_API_CALL *enqueueCopyBuffer_t)(cl_command_queue, cl_mem, cl_mem, size_t, size_t, size_t, cl_uint, const cl_event *, cl_event *);
+typedef void *(CL_API_CALL *enqueueMapBuffer_t)(cl_command_queue, cl_mem, cl_bool, cl_map_flags, size_t, size_t, cl_uint, const cl_event *, cl_event *, cl_int *);
 typedef cl_int (CL_API_CALL *enqueueNDRangeKernel_t)(cl_command_queue, cl_kernel, cl_uint, const size_t *, const size_t *, const size_t *, cl_uint, const cl_event *, cl_event *);
 typedef cl_int (CL_API_CALL *enqueueReadBuffer_t)(cl_command_queue, cl_mem, cl_bool, size_t, size_t, void *, cl_uint, const cl_event *, cl_event *);
+typedef cl_int (CL_API_CALL *enqueueUnmapMemObject_t)(cl_command_queue, cl_mem, void *, cl_uint, const cl_event *, cl_event *);
 typedef cl_int (CL_API_CALL *enqueueWriteBuffer_t)(cl_command_queue, cl_mem, cl_bool, size_t, size_t, const void *, cl_uint, const cl_event *, cl_event *);
 typedef cl_int (CL_API_CALL *finish_t)(cl_command_queue);
+typedef cl_int (CL_API_CALL *flush_t)(cl_command_queue);
 typedef cl_int (CL_API_CALL *getDeviceIDs_t)(cl_platform_id, cl_device_type, cl_uint, cl_device_id *, cl_uint *);
 typedef cl_int (CL_API_CALL *getDeviceInfo_t)(cl_device_id, cl_device_info, size_t, void *, size_t *);
+typedef cl_int (CL_API_CALL *getEventInfo_t)(cl_event, cl_event_info, size_t, void *, size_t *);
+typedef cl_int (CL_API_CALL *getEventProfilingInfo_t)(cl_event, cl_profiling_info, size_t, void *, size_t *);
+typedef cl_int (CL_API_CALL *getKernelWorkGroupInfo_t)(cl_kernel, cl_device_id, cl_kernel_work_group_info, size_t, void *, size_t *);
 typedef cl_int (CL_API_CALL *getPlatformIDs_t)(cl_uint, cl_platform_id *, cl_uint *);
 typedef cl_int (CL_API_CALL *getPlatformInfo_t)(cl_platform_id, cl_platform_info, size_t, void *, size_t *);
 typedef cl_int (CL_API_CALL *getProgramBuildInfo_t)(cl_program, cl_device_id, cl_program_build_info, size_t, void *, size_t *);
@@ -80,6 +105,7 @@ typedef cl_int (CL_API_CALL *getProgramInfo_t)(cl_program, cl_program_info, size
 typedef cl_int (CL_API_CALL *setKernelArg_t)(cl_kernel, cl_uint, size_t, const void *);
 typedef cl_kernel (CL_API_CALL *createKernel_t)(cl_program, const char *, cl_int *);
 typedef cl_mem (CL_API_CALL *createBuffer_t)(cl_context, cl_mem_flags, size_t, void *, cl_int *);
+typedef cl_mem (CL_API_CALL *createSubBuffer_t)(cl_mem, cl_mem_flags, cl_buffer_create_type, const void *, cl_int *);
 typedef cl_program (CL_API_CALL *createProgramWithBinary_t)(cl_context, cl_uint, const cl_device_id *, const size_t *, const unsigned char **, cl_int *, cl_int *);
 typedef cl_program (CL_API_CALL *createProgramWithSource_t)(cl_context, cl_uint, const char **, const size_t *, cl_int *);
 typedef cl_int (CL_API_CALL *releaseMemObject_t)(cl_mem);
@@ -87,6 +113,10 @@ typedef cl_int (CL_API_CALL *releaseProgram_t)(cl_program);
 typedef cl_int (CL_API_CALL *releaseKernel_t)(cl_kernel);
 typedef cl_int (CL_API_CALL *releaseCommandQueue_t)(cl_command_queue);
 typedef cl_int (CL_API_CALL *releaseContext_t)(cl_context);
+typedef cl_int (CL_API_CALL *releaseEvent_t)(cl_event);
+typedef cl_int (CL_API_CALL *retainEvent_t)(cl_event);
+typedef cl_int (CL_API_CALL *retainProgram_t)(cl_program);
+typedef cl_int (CL_API_CALL *waitForEvents_t)(cl_uint, const cl_event *);
 
 
 #if defined(CL_VERSION_2_0)
@@ -96,12 +126,19 @@ static createCommandQueueWithProperties_t pCreateCommandQueueWithProperties = nu
 static createCommandQueue_t pCreateCommandQueue                             = nullptr;
 static createContext_t pCreateContext                                       = nullptr;
 static buildProgram_t  pBuildProgram                                        = nullptr;
+static enqueueCopyBuffer_t pEnqueueCopyBuffer                               = nullptr;
+static enqueueMapBuffer_t pEnqueueMapBuffer                                 = nullptr;
 static enqueueNDRangeKernel_t pEnqueueNDRangeKernel                         = nullptr;
 static enqueueReadBuffer_t pEnqueueReadBuffer                               = nullptr;
+static enqueueUnmapMemObject_t pEnqueueUnmapMemObject                       = nullptr;
 static enqueueWriteBuffer_t pEnqueueWriteBuffer                             = nullptr;
 static finish_t pFinish                                                     = nullptr;
+static flush_t pFlush                                                       = nullptr;
 static getDeviceIDs_t pGetDeviceIDs                                         = nullptr;
 static getDeviceInfo_t pGetDeviceInfo                                       = nullptr;
+static getEventInfo_t pGetEventInfo                                         = nullptr;
+static getEventProfilingInfo_t pGetEventProfilingInfo                       = nullptr;
+static getKernelWorkGroupInfo_t pGetKernelWorkGroupInfo                     = nullptr;
 static getPlatformIDs_t pGetPlatformIDs                                     = nullptr;
 static getPlatformInfo_t pGetPlatformInfo                                   = nullptr;
 static getProgramBuildInfo_t pGetProgramBuildInfo                           = nullptr;
@@ -109,6 +146,7 @@ static getProgramInfo_t pGetProgramInfo                                     = nu
 static setKernelArg_t pSetKernelArg                                         = nullptr;
 static createKernel_t pCreateKernel                                         = nullptr;
 static createBuffer_t pCreateBuffer                                         = nullptr;
+static createSubBuffer_t pCreateSubBuffer                                   = nullptr;
 static createProgramWithBinary_t pCreateProgramWithBinary                   = nullptr;
 static createProgramWithSource_t pCreateProgramWithSource                   = nullptr;
 static releaseMemObject_t pReleaseMemObject                                 = nullptr;
@@ -116,6 +154,170 @@ static releaseProgram_t pReleaseProgram                                     = nu
 static releaseKernel_t pReleaseKernel                                       = nullptr;
 static releaseCommandQueue_t pReleaseCommandQueue                           = nullptr;
 static releaseContext_t pReleaseContext                                     = nullptr;
+static releaseEvent_t pReleaseEvent                                         = nullptr;
+static retainEvent_t pRetainEvent                                           = nullptr;
+static retainProgram_t pRetainProgram                                       = nullptr;
+static waitForEvents_t pWaitForEvents                                       = nullptr;
+
+
+namespace {
+
+
+// traced entry points, blocking transfers are counted apart from the queued ones
+enum OclCall {
+    CALL_BUILD_PROGRAM,
+    CALL_CREATE_BUFFER,
+    CALL_CREATE_COMMAND_QUEUE,
+    CALL_CREATE_CONTEXT,
+    CALL_CREATE_PROGRAM_WITH_BINARY,
+    CALL_CREATE_PROGRAM_WITH_SOURCE,
+    CALL_ENQUEUE_COPY_BUFFER,
+    CALL_ENQUEUE_MAP_BUFFER,
+    CALL_ENQUEUE_MAP_BUFFER_BLOCKING,
+    CALL_ENQUEUE_ND_RANGE_KERNEL,
+    CALL_ENQUEUE_READ_BUFFER,
+    CALL_ENQUEUE_READ_BUFFER_BLOCKING,
+    CALL_ENQUEUE_UNMAP_MEM_OBJECT,
+    CALL_ENQUEUE_WRITE_BUFFER,
+    CALL_ENQUEUE_WRITE_BUFFER_BLOCKING,
+    CALL_FINISH,
+    CALL_FLUSH,
+    CALL_GET_EVENT_INFO,
+    CALL_WAIT_FOR_EVENTS,
+    CALL_MAX
+};
+
+
+static const char *kCallNames[CALL_MAX] = {
+    "clBuildProgram",
+    "clCreateBuffer",
+    "clCreateCommandQueue",
+    "clCreateContext",
+    "clCreateProgramWithBinary",
+    "clCreateProgramWithSource",
+    "clEnqueueCopyBuffer",
+    "clEnqueueMapBuffer",
+    "clEnqueueMapBuffer (blocking)",
+    "clEnqueueNDRangeKernel",
+    "clEnqueueReadBuffer",
+    "clEnqueueReadBuffer (blocking)",
+    "clEnqueueUnmapMemObject",
+    "clEnqueueWriteBuffer",
+    "clEnqueueWriteBuffer (blocking)",
+    "clFinish",
+    "clFlush",
+    "clGetEventInfo",
+    "clWaitForEvents"
+};
+
+
+// written only by the owner thread, the API reads it from the main loop
+struct OclThreadTrace
+{
+    inline OclThreadTrace(size_t id) : owned(true)
+    {
+        snprintf(name, sizeof(name), "thread #%zu", id);
+
+        for (size_t i = 0; i < CALL_MAX; ++i) {
+            calls[i] = 0;
+            slow[i]  = 0;
+            time[i]  = 0;
+            max[i]   = 0;
+        }
+    }
+
+    std::atomic<bool> owned;
+    std::atomic<uint64_t> calls[CALL_MAX];
+    std::atomic<uint64_t> slow[CALL_MAX];
+    std::atomic<uint64_t> time[CALL_MAX];
+    std::atomic<uint64_t> max[CALL_MAX];
+    char name[32];
+};
+
+
+// the counters of an exited thread are continued by the next new thread, like the trace buffers
+struct OclTraceOwner
+{
+    inline ~OclTraceOwner() { if (trace) { trace->owned.store(false, std::memory_order_release); } }
+
+    OclThreadTrace *trace = nullptr;
+};
+
+
+static std::atomic<uint32_t> traceSlowMs(0);
+static std::mutex traceMutex;
+static std::vector<OclThreadTrace *> traces;
+static thread_local OclTraceOwner traceOwner;
+
+
+static inline uint64_t steadyTime()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+
+static OclThreadTrace *localTrace()
+{
+    if (traceOwner.trace) {
+        return traceOwner.trace;
+    }
+
+    std::lock_guard<std::mutex> lock(traceMutex);
+
+    for (OclThreadTrace *trace : traces) {
+        if (!trace->owned.load(std::memory_order_acquire)) {
+            trace->owned.store(true, std::memory_order_relaxed);
+            traceOwner.trace = trace;
+
+            return trace;
+        }
+    }
+
+    traceOwner.trace = new OclThreadTrace(traces.size());
+    traces.push_back(traceOwner.trace);
+
+    return traceOwner.trace;
+}
+
+
+static void record(OclCall call, uint64_t start, uint64_t elapsed)
+{
+    OclThreadTrace *trace = localTrace();
+
+    trace->calls[call].store(trace->calls[call].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    trace->time[call].store(trace->time[call].load(std::memory_order_relaxed) + elapsed, std::memory_order_relaxed);
+
+    if (elapsed > trace->max[call].load(std::memory_order_relaxed)) {
+        trace->max[call].store(elapsed, std::memory_order_relaxed);
+    }
+
+    if (elapsed >= traceSlowMs.load(std::memory_order_relaxed) * 1000000ull) {
+        trace->slow[call].store(trace->slow[call].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        LOG_WARN("%s took %.1f ms on %s", kCallNames[call], static_cast<double>(elapsed) / 1e6, trace->name);
+    }
+
+    if (xmrig::Trace::isEnabled()) {
+        xmrig::Trace::add(kCallNames[call], static_cast<int64_t>(start / 1000), static_cast<int64_t>(elapsed / 1000));
+    }
+}
+
+
+// host side time of one call, free when --opencl-trace is off
+class OclCallTimer
+{
+public:
+    inline OclCallTimer(OclCall call) : m_call(call), m_start(traceSlowMs.load(std::memory_order_relaxed) ? steadyTime() : 0) {}
+    inline ~OclCallTimer() { if (m_start) { record(m_call, m_start, steadyTime() - m_start); } }
+
+private:
+    const OclCall m_call;
+    const uint64_t m_start;
+};
+
+
+} /* namespace */
+
 
 #define DLSYM(x) if (uv_dlsym(&oclLib, k##x, reinterpret_cast<void**>(&p##x)) == -1) { return false; }
 
@@ -131,18 +333,105 @@ bool OclLib::init(const char *fileName)
 }
 
 
+bool OclLib::isTrace()
+{
+    return traceSlowMs.load(std::memory_order_relaxed) > 0;
+}
+
+
+std::vector<OclCallStats> OclLib::callStats()
+{
+    std::vector<OclCallStats> stats;
+
+    std::lock_guard<std::mutex> lock(traceMutex);
+
+    for (size_t i = 0; i < CALL_MAX; ++i) {
+        OclCallStats call = { kCallNames[i], 0, 0, 0, 0 };
+
+        for (const OclThreadTrace *trace : traces) {
+            call.calls += trace->calls[i].load(std::memory_order_relaxed);
+            call.slow  += trace->slow[i].load(std::memory_order_relaxed);
+            call.time  += trace->time[i].load(std::memory_order_relaxed);
+            call.max    = std::max(call.max, trace->max[i].load(std::memory_order_relaxed));
+        }
+
+        if (call.calls) {
+            stats.push_back(call);
+        }
+    }
+
+    return stats;
+}
+
+
+// the names point into the thread counters, they live until exit
+std::vector<OclCallStats> OclLib::threadStats()
+{
+    std::vector<OclCallStats> stats;
+
+    std::lock_guard<std::mutex> lock(traceMutex);
+
+    for (const OclThreadTrace *trace : traces) {
+        OclCallStats thread = { trace->name, 0, 0, 0, 0 };
+
+        for (size_t i = 0; i < CALL_MAX; ++i) {
+            thread.calls += trace->calls[i].load(std::memory_order_relaxed);
+            thread.slow  += trace->slow[i].load(std::memory_order_relaxed);
+            thread.time  += trace->time[i].load(std::memory_order_relaxed);
+            thread.max    = std::max(thread.max, trace->max[i].load(std::memory_order_relaxed));
+        }
+
+        stats.push_back(thread);
+    }
+
+    return stats;
+}
+
+
+uint32_t OclLib::traceThreshold()
+{
+    return traceSlowMs.load(std::memory_order_relaxed);
+}
+
+
+void OclLib::setTrace(uint32_t slowMs)
+{
+    traceSlowMs.store(slowMs, std::memory_order_relaxed);
+}
+
+
+void OclLib::setThreadName(const char *name)
+{
+    if (!isTrace()) {
+        return;
+    }
+
+    OclThreadTrace *trace = localTrace();
+
+    std::lock_guard<std::mutex> lock(traceMutex);
+    snprintf(trace->name, sizeof(trace->name), "%s", name);
+}
+
+
 bool OclLib::load()
 {
     DLSYM(CreateCommandQueue);
     DLSYM(CreateContext);
     DLSYM(BuildProgram);
+    DLSYM(EnqueueCopyBuffer);
+    DLSYM(EnqueueMapBuffer);
     DLSYM(EnqueueNDRangeKernel);
     DLSYM(EnqueueReadBuffer);
+    DLSYM(EnqueueUnmapMemObject);
     DLSYM(EnqueueWriteBuffer);
     DLSYM(Finish);
+    DLSYM(Flush);
     DLSYM(GetDeviceIDs);
     DLSYM(GetDeviceInfo);
     DLSYM(GetPlatformInfo);
+    DLSYM(GetEventInfo);
+    DLSYM(GetEventProfilingInfo);
+    DLSYM(GetKernelWorkGroupInfo);
     DLSYM(GetPlatformIDs);
     DLSYM(GetProgramBuildInfo);
     DLSYM(GetProgramInfo);
@@ -156,27 +445,40 @@ bool OclLib::load()
     DLSYM(ReleaseKernel);
     DLSYM(ReleaseCommandQueue);
     DLSYM(ReleaseContext);
+    DLSYM(ReleaseEvent);
+    DLSYM(RetainEvent);
+    DLSYM(RetainProgram);
+    DLSYM(WaitForEvents);
 
 #   if defined(CL_VERSION_2_0)
     uv_dlsym(&oclLib, kCreateCommandQueueWithProperties, reinterpret_cast<void**>(&pCreateCommandQueueWithProperties));
 #   endif
 
+    // OpenCL 1.1, without it every buffer is allocated separately
+    uv_dlsym(&oclLib, kCreateSubBuffer, reinterpret_cast<void**>(&pCreateSubBuffer));
+
     return true;
 }
 
 
-cl_command_queue OclLib::createCommandQueue(cl_context context, cl_device_id device, cl_int *errcode_ret)
+cl_command_queue OclLib::createCommandQueue(cl_context context, cl_device_id device, cl_int *errcode_ret, bool profiling)
 {
+    OclCallTimer timer(CALL_CREATE_COMMAND_QUEUE);
+
     cl_command_queue result;
 
 #   if defined(CL_VERSION_2_0)
     if (pCreateCommandQueueWithProperties) {
-        const cl_queue_properties commandQueueProperties[] = { 0, 0, 0 };
+        const cl_queue_properties commandQueueProperties[] = {
+            profiling ? static_cast<cl_queue_properties>(CL_QUEUE_PROPERTIES) : 0,
+            profiling ? static_cast<cl_queue_properties>(CL_QUEUE_PROFILING_ENABLE) : 0,
+            0
+        };
         result = pCreateCommandQueueWithProperties(context, device, commandQueueProperties, errcode_ret);
     }
     else {
 #   endif
-        const cl_command_queue_properties commandQueueProperties = { 0 };
+        const cl_command_queue_properties commandQueueProperties = profiling ? CL_QUEUE_PROFILING_ENABLE : 0;
         result = pCreateCommandQueue(context, device, commandQueueProperties, errcode_ret);
 #   if defined(CL_VERSION_2_0)
     }
@@ -194,6 +496,8 @@ cl_context OclLib::createContext(const cl_context_properties *properties, cl_uin
 {
     assert(pCreateContext != nullptr);
 
+    OclCallTimer timer(CALL_CREATE_CONTEXT);
+
     auto result = pCreateContext(properties, num_devices, devices, pfn_notify, user_data, errcode_ret);
     if (*errcode_ret != CL_SUCCESS) {
         LOG_ERR(kErrorTemplate, OclError::toString(*errcode_ret), kCreateContext);
@@ -207,6 +511,8 @@ cl_int OclLib::buildProgram(cl_program program, cl_uint num_devices, const cl_de
 {
     assert(pBuildProgram != nullptr);
 
+    OclCallTimer timer(CALL_BUILD_PROGRAM);
+
     const cl_int ret = pBuildProgram(program, num_devices, device_list, options, pfn_notify, user_data);
     if (ret != CL_SUCCESS) {
         LOG_ERR(kErrorTemplate, OclError::toString(ret), kBuildProgram);
@@ -216,10 +522,37 @@ cl_int OclLib::buildProgram(cl_program program, cl_uint num_devices, const cl_de
 }
 
 
+cl_int OclLib::enqueueCopyBuffer(cl_command_queue command_queue, cl_mem src_buffer, cl_mem dst_buffer, size_t src_offset, size_t dst_offset, size_t size, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event)
+{
+    assert(pEnqueueCopyBuffer != nullptr);
+
+    OclCallTimer timer(CALL_ENQUEUE_COPY_BUFFER);
+
+    return pEnqueueCopyBuffer(command_queue, src_buffer, dst_buffer, src_offset, dst_offset, size, num_events_in_wait_list, event_wait_list, event);
+}
+
+
+void *OclLib::enqueueMapBuffer(cl_command_queue command_queue, cl_mem buffer, cl_bool blocking_map, cl_map_flags map_flags, size_t offset, size_t size, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event, cl_int *errcode_ret)
+{
+    assert(pEnqueueMapBuffer != nullptr);
+
+    OclCallTimer timer(blocking_map ? CALL_ENQUEUE_MAP_BUFFER_BLOCKING : CALL_ENQUEUE_MAP_BUFFER);
+
+    auto result = pEnqueueMapBuffer(command_queue, buffer, blocking_map, map_flags, offset, size, num_events_in_wait_list, event_wait_list, event, errcode_ret);
+    if (*errcode_ret != CL_SUCCESS) {
+        LOG_ERR(kErrorTemplate, OclError::toString(*errcode_ret), kEnqueueMapBuffer);
+    }
+
+    return result;
+}
+
+
 cl_int OclLib::enqueueNDRangeKernel(cl_command_queue command_queue, cl_kernel kernel, cl_uint work_dim, const size_t *global_work_offset, const size_t *global_work_size, const size_t *local_work_size, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event)
 {
     assert(pEnqueueNDRangeKernel != nullptr);
 
+    OclCallTimer timer(CALL_ENQUEUE_ND_RANGE_KERNEL);
+
     return pEnqueueNDRangeKernel(command_queue, kernel, work_dim, global_work_offset, global_work_size, local_work_size, num_events_in_wait_list, event_wait_list, event);
 }
 
@@ -228,6 +561,8 @@ cl_int OclLib::enqueueReadBuffer(cl_command_queue command_queue, cl_mem buffer,
 {
     assert(pEnqueueReadBuffer != nullptr);
 
+    OclCallTimer timer(blocking_read ? CALL_ENQUEUE_READ_BUFFER_BLOCKING : CALL_ENQUEUE_READ_BUFFER);
+
     const cl_int ret = pEnqueueReadBuffer(command_queue, buffer, blocking_read, offset, size, ptr, num_events_in_wait_list, event_wait_list, event);
     if (ret != CL_SUCCESS) {
         LOG_ERR(kErrorTemplate, OclError::toString(ret), kEnqueueReadBuffer);
@@ -237,10 +572,27 @@ cl_int OclLib::enqueueReadBuffer(cl_command_queue command_queue, cl_mem buffer,
 }
 
 
+cl_int OclLib::enqueueUnmapMemObject(cl_command_queue command_queue, cl_mem memobj, void *mapped_ptr, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event)
+{
+    assert(pEnqueueUnmapMemObject != nullptr);
+
+    OclCallTimer timer(CALL_ENQUEUE_UNMAP_MEM_OBJECT);
+
+    const cl_int ret = pEnqueueUnmapMemObject(command_queue, memobj, mapped_ptr, num_events_in_wait_list, event_wait_list, event);
+    if (ret != CL_SUCCESS) {
+        LOG_ERR(kErrorTemplate, OclError::toString(ret), kEnqueueUnmapMemObject);
+    }
+
+    return ret;
+}
+
+
 cl_int OclLib::enqueueWriteBuffer(cl_command_queue command_queue, cl_mem buffer, cl_bool blocking_write, size_t offset, size_t size, const void *ptr, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event)
 {
     assert(pEnqueueWriteBuffer != nullptr);
 
+    OclCallTimer timer(blocking_write ? CALL_ENQUEUE_WRITE_BUFFER_BLOCKING : CALL_ENQUEUE_WRITE_BUFFER);
+
     return pEnqueueWriteBuffer(command_queue, buffer, blocking_write, offset, size, ptr, num_events_in_wait_list, event_wait_list, event);
 }
 
@@ -249,10 +601,27 @@ cl_int OclLib::finish(cl_command_queue command_queue)
 {
     assert(pFinish != nullptr);
 
+    OclCallTimer timer(CALL_FINISH);
+
     return pFinish(command_queue);
 }
 
 
+cl_int OclLib::flush(cl_command_queue command_queue)
+{
+    assert(pFlush != nullptr);
+
+    OclCallTimer timer(CALL_FLUSH);
+
+    const cl_int ret = pFlush(command_queue);
+    if (ret != CL_SUCCESS) {
+        LOG_ERR(kErrorTemplate, OclError::toString(ret), kFlush);
+    }
+
+    return ret;
+}
+
+
 cl_int OclLib::getDeviceIDs(cl_platform_id platform, cl_device_type device_type, cl_uint num_entries, cl_device_id *devices, cl_uint *num_devices)
 {
     assert(pGetDeviceIDs != nullptr);
@@ -266,7 +635,8 @@ cl_int OclLib::getDeviceInfo(cl_device_id device, cl_device_info param_name, siz
     assert(pGetDeviceInfo != nullptr);
 
     const cl_int ret = pGetDeviceInfo(device, param_name, param_value_size, param_value, param_value_size_ret);
-    if (ret != CL_SUCCESS && param_name != 0x4038) {
+    // vendor extension queries (0x4000 and up) are optional, the caller falls back if the driver does not support them
+    if (ret != CL_SUCCESS && param_name < 0x4000) {
         LOG_ERR("Error %s when calling %s, param 0x%04x", OclError::toString(ret), kGetDeviceInfo, param_name);
     }
 
@@ -274,6 +644,47 @@ cl_int OclLib::getDeviceInfo(cl_device_id device, cl_device_info param_name, siz
 }
 
 
+cl_int OclLib::getEventInfo(cl_event event, cl_event_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret)
+{
+    assert(pGetEventInfo != nullptr);
+
+    OclCallTimer timer(CALL_GET_EVENT_INFO);
+
+    const cl_int ret = pGetEventInfo(event, param_name, param_value_size, param_value, param_value_size_ret);
+    if (ret != CL_SUCCESS) {
+        LOG_ERR(kErrorTemplate, OclError::toString(ret), kGetEventInfo);
+    }
+
+    return ret;
+}
+
+
+cl_int OclLib::getEventProfilingInfo(cl_event event, cl_profiling_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret)
+{
+    assert(pGetEventProfilingInfo != nullptr);
+
+    const cl_int ret = pGetEventProfilingInfo(event, param_name, param_value_size, param_value, param_value_size_ret);
+    if (ret != CL_SUCCESS) {
+        LOG_ERR(kErrorTemplate, OclError::toString(ret), kGetEventProfilingInfo);
+    }
+
+    return ret;
+}
+
+
+cl_int OclLib::getKernelWorkGroupInfo(cl_kernel kernel, cl_device_id device, cl_kernel_work_group_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret)
+{
+    assert(pGetKernelWorkGroupInfo != nullptr);
+
+    const cl_int ret = pGetKernelWorkGroupInfo(kernel, device, param_name, param_value_size, param_value, param_value_size_ret);
+    if (ret != CL_SUCCESS) {
+        LOG_ERR(kErrorTemplate, OclError::toString(ret), kGetKernelWorkGroupInfo);
+    }
+
+    return ret;
+}
+
+
 cl_int OclLib::getPlatformIDs(cl_uint num_entries, cl_platform_id *platforms, cl_uint *num_platforms)
 {
     assert(pGetPlatformIDs != nullptr);
@@ -320,6 +731,10 @@ cl_int OclLib::releaseCommandQueue(cl_command_queue command_queue)
 {
     assert(pReleaseCommandQueue != nullptr);
 
+    if (command_queue == nullptr) {
+        return CL_SUCCESS;
+    }
+
     const cl_int ret = pReleaseCommandQueue(command_queue);
     if (ret != CL_SUCCESS) {
         LOG_ERR(kErrorTemplate, OclError::toString(ret), kReleaseCommandQueue);
@@ -342,6 +757,49 @@ cl_int OclLib::releaseContext(cl_context context)
 }
 
 
+cl_int OclLib::releaseEvent(cl_event event)
+{
+    assert(pReleaseEvent != nullptr);
+
+    if (event == nullptr) {
+        return CL_SUCCESS;
+    }
+
+    const cl_int ret = pReleaseEvent(event);
+    if (ret != CL_SUCCESS) {
+        LOG_ERR(kErrorTemplate, OclError::toString(ret), kReleaseEvent);
+    }
+
+    return ret;
+}
+
+
+cl_int OclLib::retainEvent(cl_event event)
+{
+    assert(pRetainEvent != nullptr);
+
+    const cl_int ret = pRetainEvent(event);
+    if (ret != CL_SUCCESS) {
+        LOG_ERR(kErrorTemplate, OclError::toString(ret), kRetainEvent);
+    }
+
+    return ret;
+}
+
+
+cl_int OclLib::retainProgram(cl_program program)
+{
+    assert(pRetainProgram != nullptr);
+
+    const cl_int ret = pRetainProgram(program);
+    if (ret != CL_SUCCESS) {
+        LOG_ERR(kErrorTemplate, OclError::toString(ret), kRetainProgram);
+    }
+
+    return ret;
+}
+
+
 cl_int OclLib::releaseKernel(cl_kernel kernel)
 {
     assert(pReleaseKernel != nullptr);
@@ -363,6 +821,10 @@ cl_int OclLib::releaseMemObject(cl_mem mem_obj)
 {
     assert(pReleaseMemObject != nullptr);
 
+    if (mem_obj == nullptr) {
+        return CL_SUCCESS;
+    }
+
     const cl_int ret = pReleaseMemObject(mem_obj);
     if (ret != CL_SUCCESS) {
         LOG_ERR(kErrorTemplate, OclError::toString(ret), kReleaseMemObject);
@@ -376,6 +838,10 @@ cl_int OclLib::releaseProgram(cl_program program)
 {
     assert(pReleaseProgram != nullptr);
 
+    if (program == nullptr) {
+        return CL_SUCCESS;
+    }
+
     const cl_int ret = pReleaseProgram(program);
     if (ret != CL_SUCCESS) {
         LOG_ERR(kErrorTemplate, OclError::toString(ret), kReleaseProgram);
@@ -393,6 +859,21 @@ cl_int OclLib::setKernelArg(cl_kernel kernel, cl_uint arg_index, size_t arg_size
 }
 
 
+cl_int OclLib::waitForEvents(cl_uint num_events, const cl_event *event_list)
+{
+    assert(pWaitForEvents != nullptr);
+
+    OclCallTimer timer(CALL_WAIT_FOR_EVENTS);
+
+    const cl_int ret = pWaitForEvents(num_events, event_list);
+    if (ret != CL_SUCCESS) {
+        LOG_ERR(kErrorTemplate, OclError::toString(ret), kWaitForEvents);
+    }
+
+    return ret;
+}
+
+
 cl_kernel OclLib::createKernel(cl_program program, const char *kernel_name, cl_int *errcode_ret)
 {
     assert(pCreateKernel != nullptr);
@@ -410,14 +891,42 @@ cl_mem OclLib::createBuffer(cl_context context, cl_mem_flags flags, size_t size,
 {
     assert(pCreateBuffer != nullptr);
 
+    OclCallTimer timer(CALL_CREATE_BUFFER);
+
     return pCreateBuffer(context, flags, size, host_ptr, errcode_ret);
 }
 
 
+cl_mem OclLib::createSubBuffer(cl_mem buffer, cl_mem_flags flags, size_t origin, size_t size, cl_int *errcode_ret)
+{
+    if (pCreateSubBuffer == nullptr) {
+        *errcode_ret = CL_INVALID_OPERATION;
+        return nullptr;
+    }
+
+    const cl_buffer_region region = { origin, size };
+
+    auto result = pCreateSubBuffer(buffer, flags, CL_BUFFER_CREATE_TYPE_REGION, &region, errcode_ret);
+    if (*errcode_ret != CL_SUCCESS) {
+        LOG_ERR(kErrorTemplate, OclError::toString(*errcode_ret), kCreateSubBuffer);
+    }
+
+    return result;
+}
+
+
+bool OclLib::isSubBufferSupported()
+{
+    return pCreateSubBuffer != nullptr;
+}
+
+
 cl_program OclLib::createProgramWithBinary(cl_context context, cl_uint num_devices, const cl_device_id *device_list, const size_t *lengths, const unsigned char **binaries, cl_int *binary_status, cl_int *errcode_ret)
 {
     assert(pCreateProgramWithBinary != nullptr);
 
+    OclCallTimer timer(CALL_CREATE_PROGRAM_WITH_BINARY);
+
     auto result = pCreateProgramWithBinary(context, num_devices, device_list, lengths, binaries, binary_status, errcode_ret);
     if (*errcode_ret != CL_SUCCESS) {
         LOG_ERR(kErrorTemplate, OclError::toString(*errcode_ret), kCreateProgramWithBinary);
@@ -431,6 +940,8 @@ cl_program OclLib::createProgramWithSource(cl_context context, cl_uint count, co
 {
     assert(pCreateProgramWithSource != nullptr);
 
+    OclCallTimer timer(CALL_CREATE_PROGRAM_WITH_SOURCE);
+
     auto result = pCreateProgramWithSource(context, count, strings, lengths, errcode_ret);
     if (*errcode_ret != CL_SUCCESS) {
         LOG_ERR(kErrorTemplate, OclError::toString(*errcode_ret), kCreateProgramWithSource);
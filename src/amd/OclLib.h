@@ -26,6 +26,7 @@
 #define XMRIG_OCLLIB_H
 
 
+#include <stdint.h>
 #include <vector>
 
 
@@ -40,37 +41,67 @@
 #include "common/xmrig.h"
 
 
+// host side time of an OpenCL entry point or of all traced calls of a thread, see OclLib::setTrace()
+struct OclCallStats
+{
+    const char *name;
+    uint64_t calls;
+    uint64_t slow;
+    uint64_t time;  // ns
+    uint64_t max;   // ns
+};
+
+
 class OclLib
 {
 public:
     static bool init(const char *fileName);
+    static bool isTrace();
+    static std::vector<OclCallStats> callStats();
+    static std::vector<OclCallStats> threadStats();
+    static uint32_t traceThreshold();
+    static void setTrace(uint32_t slowMs);
+    static void setThreadName(const char *name);
 
-    static cl_command_queue createCommandQueue(cl_context context, cl_device_id device, cl_int *errcode_ret);
+    static cl_command_queue createCommandQueue(cl_context context, cl_device_id device, cl_int *errcode_ret, bool profiling = false);
     static cl_context createContext(const cl_context_properties *properties, cl_uint num_devices, const cl_device_id *devices, void (CL_CALLBACK *pfn_notify)(const char *, const void *, size_t, void *), void *user_data, cl_int *errcode_ret);
     static cl_int buildProgram(cl_program program, cl_uint num_devices, const cl_device_id *device_list, const char *options = nullptr, void (CL_CALLBACK *pfn_notify)(cl_program program, void *user_data) = nullptr, void *user_data = nullptr);
+    static cl_int enqueueCopyBuffer(cl_command_queue command_queue, cl_mem src_buffer, cl_mem dst_buffer, size_t src_offset, size_t dst_offset, size_t size, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event);
+    static void *enqueueMapBuffer(cl_command_queue command_queue, cl_mem buffer, cl_bool blocking_map, cl_map_flags map_flags, size_t offset, size_t size, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event, cl_int *errcode_ret);
     static cl_int enqueueNDRangeKernel(cl_command_queue command_queue, cl_kernel kernel, cl_uint work_dim, const size_t *global_work_offset, const size_t *global_work_size, const size_t *local_work_size, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event);
     static cl_int enqueueReadBuffer(cl_command_queue command_queue, cl_mem buffer, cl_bool blocking_read, size_t offset, size_t size, void *ptr, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event);
+    static cl_int enqueueUnmapMemObject(cl_command_queue command_queue, cl_mem memobj, void *mapped_ptr, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event);
     static cl_int enqueueWriteBuffer(cl_command_queue command_queue, cl_mem buffer, cl_bool blocking_write, size_t offset, size_t size, const void *ptr, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event);
     static cl_int finish(cl_command_queue command_queue);
+    static cl_int flush(cl_command_queue command_queue);
     static cl_int getDeviceIDs(cl_platform_id platform, cl_device_type device_type, cl_uint num_entries, cl_device_id *devices, cl_uint *num_devices);
     static cl_int getDeviceInfo(cl_device_id device, cl_device_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret = nullptr);
+    static cl_int getEventInfo(cl_event event, cl_event_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret = nullptr);
+    static cl_int getEventProfilingInfo(cl_event event, cl_profiling_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret = nullptr);
+    static cl_int getKernelWorkGroupInfo(cl_kernel kernel, cl_device_id device, cl_kernel_work_group_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret = nullptr);
     static cl_int getPlatformIDs(cl_uint num_entries, cl_platform_id *platforms, cl_uint *num_platforms);
     static cl_int getPlatformInfo(cl_platform_id platform, cl_platform_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret);
     static cl_int getProgramBuildInfo(cl_program program, cl_device_id device, cl_program_build_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret);
     static cl_int getProgramInfo(cl_program program, cl_program_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret = nullptr);
     static cl_int releaseCommandQueue(cl_command_queue command_queue);
     static cl_int releaseContext(cl_context context);
+    static cl_int releaseEvent(cl_event event);
     static cl_int releaseKernel(cl_kernel kernel);
     static cl_int releaseMemObject(cl_mem mem_obj);
     static cl_int releaseProgram(cl_program program);
+    static cl_int retainEvent(cl_event event);
+    static cl_int retainProgram(cl_program program);
     static cl_int setKernelArg(cl_kernel kernel, cl_uint arg_index, size_t arg_size, const void *arg_value);
+    static cl_int waitForEvents(cl_uint num_events, const cl_event *event_list);
     static cl_kernel createKernel(cl_program program, const char *kernel_name, cl_int *errcode_ret);
     static cl_mem createBuffer(cl_context context, cl_mem_flags flags, size_t size, void *host_ptr, cl_int *errcode_ret);
+    static cl_mem createSubBuffer(cl_mem buffer, cl_mem_flags flags, size_t origin, size_t size, cl_int *errcode_ret);
     static cl_program createProgramWithBinary(cl_context context, cl_uint num_devices, const cl_device_id *device_list, const size_t *lengths, const unsigned char **binaries, cl_int *binary_status, cl_int *errcode_ret);
     static cl_program createProgramWithSource(cl_context context, cl_uint count, const char **strings, const size_t *lengths, cl_int *errcode_ret);
     static cl_uint getDeviceMaxComputeUnits(cl_device_id id);
     static std::vector<cl_platform_id> getPlatformIDs();
     static uint32_t getNumPlatforms();
+    static bool isSubBufferSupported();
     static xmrig::OclVendor getDeviceVendor(cl_device_id id);
     static xmrig::String getDeviceBoardName(cl_device_id id);
     static xmrig::String getDeviceName(cl_device_id id);
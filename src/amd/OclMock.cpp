@@ -0,0 +1,867 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// ocl-mock, an OpenCL runtime without a GPU for --opencl-loader: the devices are plain host memory, programs build
+// instantly, kernels compute nothing and take the time set by the environment, commands of a queue run one after the
+// other on a simulated timeline, so the host side of the miner is measured without GPUs:
+//   XMRIG_OCL_MOCK_DEVICES      number of GPUs (default: 1)
+//   XMRIG_OCL_MOCK_MEMORY_MB    global memory of a GPU (default: 8192)
+//   XMRIG_OCL_MOCK_LAUNCH_US    time of a kernel launch (default: 20)
+//   XMRIG_OCL_MOCK_ITEM_NS      time of a work item of a kernel (default: 1000)
+//   XMRIG_OCL_MOCK_TRANSFER_US  latency of a read, write, copy or map (default: 10)
+//   XMRIG_OCL_MOCK_PCIE_GBS     bandwidth of the transfers in GB/s (default: 12)
+
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+#if defined(__APPLE__)
+#   include <OpenCL/cl.h>
+#else
+#   include "3rdparty/CL/cl.h"
+#endif
+
+
+#if defined(_WIN32)
+#   define MOCK_EXPORT extern "C" __declspec(dllexport)
+#else
+#   define MOCK_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+
+static const char *kPlatformVendor = "Advanced Micro Devices, Inc.";
+static const char *kPlatformName   = "AMD Accelerated Parallel Processing";
+static const char *kVersion        = "OpenCL 2.0 AMD-APP (2906.7)";
+static const char *kDriverVersion  = "2906.7 (PAL,HSAIL)";
+static const char *kDeviceName     = "gfx906";
+static const char *kBoardName      = "ocl-mock";
+static const char *kExtensions     = "cl_khr_global_int32_base_atomics cl_khr_byte_addressable_store cl_amd_media_ops cl_amd_media_ops2";
+static const char kBinary[]        = "ocl-mock";
+
+
+static inline int64_t now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+static inline void sleepUntil(int64_t time)
+{
+    std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(time)));
+}
+
+
+static int64_t env(const char *name, int64_t defaultValue)
+{
+    const char *value = getenv(name);
+
+    return value && *value ? strtoll(value, nullptr, 10) : defaultValue;
+}
+
+
+struct _cl_platform_id {};
+
+
+struct _cl_device_id
+{
+    cl_uint index;
+};
+
+
+// every object the miner releases is counted, the miner never retains anything but programs and events
+struct MockObject
+{
+    inline MockObject() : refs(1) {}
+    virtual ~MockObject() {}
+
+    inline cl_int retain()  { ++refs; return CL_SUCCESS; }
+    inline cl_int release() { if (--refs == 0) { delete this; } return CL_SUCCESS; }
+
+    std::atomic<int> refs;
+};
+
+
+struct _cl_context : MockObject
+{
+    std::vector<cl_device_id> devices;
+};
+
+
+struct _cl_command_queue : MockObject
+{
+    inline _cl_command_queue() : busy(0), profiling(false) {}
+
+    std::mutex mutex;
+    int64_t busy;   // the last queued command ends at this time
+    bool profiling;
+};
+
+
+struct _cl_mem : MockObject
+{
+    inline _cl_mem() : data(nullptr), size(0), parent(nullptr) {}
+    inline ~_cl_mem() override
+    {
+        if (parent) {
+            parent->release();
+        }
+        else {
+            free(data);
+        }
+    }
+
+    uint8_t *data;
+    size_t size;
+    _cl_mem *parent;
+};
+
+
+struct _cl_program : MockObject
+{
+    inline _cl_program() : built(false) {}
+
+    std::vector<cl_device_id> devices;
+    bool built;
+};
+
+
+struct _cl_kernel : MockObject {};
+
+
+struct _cl_event : MockObject
+{
+    inline _cl_event(int64_t queued, int64_t start, int64_t end) : queued(queued), start(start), end(end) {}
+
+    int64_t queued;
+    int64_t start;
+    int64_t end;
+};
+
+
+namespace {
+
+struct Settings
+{
+    inline Settings() :
+        devices(static_cast<cl_uint>(std::max<int64_t>(env("XMRIG_OCL_MOCK_DEVICES", 1), 0))),
+        memory(static_cast<cl_ulong>(env("XMRIG_OCL_MOCK_MEMORY_MB", 8192)) * 1024 * 1024),
+        launch(env("XMRIG_OCL_MOCK_LAUNCH_US", 20) * 1000),
+        item(env("XMRIG_OCL_MOCK_ITEM_NS", 1000)),
+        transfer(env("XMRIG_OCL_MOCK_TRANSFER_US", 10) * 1000),
+        bandwidth(std::max<int64_t>(env("XMRIG_OCL_MOCK_PCIE_GBS", 12), 1))
+    {
+        for (cl_uint i = 0; i < devices; ++i) {
+            ids.push_back(_cl_device_id { i });
+        }
+    }
+
+    cl_uint devices;
+    cl_ulong memory;
+    int64_t launch;
+    int64_t item;
+    int64_t transfer;
+    int64_t bandwidth;
+    std::vector<_cl_device_id> ids;
+};
+
+}
+
+
+static _cl_platform_id platform;
+
+
+static const Settings &settings()
+{
+    static const Settings value;
+
+    return value;
+}
+
+
+template<typename T>
+static cl_int info(const T &value, size_t size, void *data, size_t *sizeRet)
+{
+    if (sizeRet) {
+        *sizeRet = sizeof(T);
+    }
+
+    if (data) {
+        if (size < sizeof(T)) {
+            return CL_INVALID_VALUE;
+        }
+
+        memcpy(data, &value, sizeof(T));
+    }
+
+    return CL_SUCCESS;
+}
+
+
+static cl_int info(const char *value, size_t size, void *data, size_t *sizeRet)
+{
+    const size_t length = strlen(value) + 1;
+
+    if (sizeRet) {
+        *sizeRet = length;
+    }
+
+    if (data) {
+        if (size < length) {
+            return CL_INVALID_VALUE;
+        }
+
+        memcpy(data, value, length);
+    }
+
+    return CL_SUCCESS;
+}
+
+
+// the command starts when the previous one of the queue ends, a blocking call returns when it ends
+static cl_int enqueue(cl_command_queue queue, int64_t duration, bool blocking, cl_event *event)
+{
+    if (!queue) {
+        return CL_INVALID_COMMAND_QUEUE;
+    }
+
+    const int64_t queued = now();
+    int64_t start        = 0;
+    int64_t end          = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        start       = std::max(queued, queue->busy);
+        end         = start + duration;
+        queue->busy = end;
+    }
+
+    if (event) {
+        *event = new _cl_event(queued, start, end);
+    }
+
+    if (blocking) {
+        sleepUntil(end);
+    }
+
+    return CL_SUCCESS;
+}
+
+
+static inline int64_t transferTime(size_t size)
+{
+    return settings().transfer + static_cast<int64_t>(size) / settings().bandwidth;
+}
+
+
+MOCK_EXPORT cl_int CL_API_CALL clGetPlatformIDs(cl_uint num_entries, cl_platform_id *platforms, cl_uint *num_platforms)
+{
+    if (num_platforms) {
+        *num_platforms = 1;
+    }
+
+    if (platforms && num_entries > 0) {
+        platforms[0] = &platform;
+    }
+
+    return CL_SUCCESS;
+}
+
+
+MOCK_EXPORT cl_int CL_API_CALL clGetPlatformInfo(cl_platform_id, cl_platform_info param_name, size_t size, void *data, size_t *sizeRet)
+{
+    switch (param_name) {
+    case CL_PLATFORM_VENDOR:
+        return info(kPlatformVendor, size, data, sizeRet);
+
+    case CL_PLATFORM_NAME:
+        return info(kPlatformName, size, data, sizeRet);
+
+    case CL_PLATFORM_VERSION:
+        return info(kVersion, size, data, sizeRet);
+
+    case CL_PLATFORM_PROFILE:
+        return info("FULL_PROFILE", size, data, sizeRet);
+
+    case CL_PLATFORM_EXTENSIONS:
+        return info("", size, data, sizeRet);
+
+    default:
+        break;
+    }
+
+    return CL_INVALID_VALUE;
+}
+
+
+MOCK_EXPORT cl_int CL_API_CALL clGetDeviceIDs(cl_platform_id, cl_device_type type, cl_uint num_entries, cl_device_id *devices, cl_uint *num_devices)
+{
+    const cl_uint count = (type & CL_DEVICE_TYPE_GPU) ? settings().devices : 0;
+    if (num_devices) {
+        *num_devices = count;
+    }
+
+    if (count == 0) {
+        return CL_DEVICE_NOT_FOUND;
+    }
+
+    for (cl_uint i = 0; devices && i < std::min(count, num_entries); ++i) {
+        devices[i] = const_cast<cl_device_id>(&settings().ids[i]);
+    }
+
+    return CL_SUCCESS;
+}
+
+
+MOCK_EXPORT cl_int CL_API_CALL clGetDeviceInfo(cl_device_id device, cl_device_info param_name, size_t size, void *data, size_t *sizeRet)
+{
+    if (!device) {
+        return CL_INVALID_DEVICE;
+    }
+
+    switch (param_name) {
+    case CL_DEVICE_TYPE:
+        return info<cl_device_type>(CL_DEVICE_TYPE_GPU, size, data, sizeRet);
+
+    case CL_DEVICE_VENDOR:
+        return info(kPlatformVendor, size, data, sizeRet);
+
+    case CL_DEVICE_NAME:
+        return info(kDeviceName, size, data, sizeRet);
+
+    case 0x4038: /* CL_DEVICE_BOARD_NAME_AMD */
+        return info(kBoardName, size, data, sizeRet);
+
+    case CL_DEVICE_VERSION:
+        return info(kVersion, size, data, sizeRet);
+
+    case CL_DRIVER_VERSION:
+        return info(kDriverVersion, size, data, sizeRet);
+
+    case CL_DEVICE_EXTENSIONS:
+        return info(kExtensions, size, data, sizeRet);
+
+    case CL_DEVICE_MAX_COMPUTE_UNITS:
+        return info<cl_uint>(60, size, data, sizeRet);
+
+    case CL_DEVICE_GLOBAL_MEM_SIZE:
+        return info<cl_ulong>(settings().memory, size, data, sizeRet);
+
+    case CL_DEVICE_MAX_MEM_ALLOC_SIZE:
+        return info<cl_ulong>(settings().memory / 4 * 3, size, data, sizeRet);
+
+    case CL_DEVICE_MAX_WORK_GROUP_SIZE:
+        return info<size_t>(256, size, data, sizeRet);
+
+    case CL_DEVICE_LOCAL_MEM_SIZE:
+        return info<cl_ulong>(65536, size, data, sizeRet);
+
+    case CL_DEVICE_MEM_BASE_ADDR_ALIGN:
+        return info<cl_uint>(2048, size, data, sizeRet);
+
+    case 0x4043: /* CL_DEVICE_WAVEFRONT_WIDTH_AMD */
+        return info<cl_uint>(64, size, data, sizeRet);
+
+    case 0x4037: /* CL_DEVICE_TOPOLOGY_AMD, PCIe bus of the device index + 1 */
+        {
+            struct {
+                cl_uint type;
+                cl_char unused[17];
+                cl_char bus;
+                cl_char device;
+                cl_char function;
+            } topology = {};
+
+            topology.type = 1;
+            topology.bus  = static_cast<cl_char>(device->index + 1);
+
+            return info(topology, size, data, sizeRet);
+        }
+
+    default:
+        break;
+    }
+
+    return CL_INVALID_VALUE;
+}
+
+
+MOCK_EXPORT cl_context CL_API_CALL clCreateContext(const cl_context_properties *, cl_uint num_devices, const cl_device_id *devices,
+                                                   void (CL_CALLBACK *)(const char *, const void *, size_t, void *), void *, cl_int *errcode_ret)
+{
+    _cl_context *context = new _cl_context();
+    context->devices.assign(devices, devices + num_devices);
+
+    if (errcode_ret) {
+        *errcode_ret = CL_SUCCESS;
+    }
+
+    return context;
+}
+
+
+MOCK_EXPORT cl_int CL_API_CALL clReleaseContext(cl_context context)
+{
+    return context ? context->release() : CL_INVALID_CONTEXT;
+}
+
+
+MOCK_EXPORT cl_command_queue CL_API_CALL clCreateCommandQueue(cl_context, cl_device_id, cl_command_queue_properties properties, cl_int *errcode_ret)
+{
+    _cl_command_queue *queue = new _cl_command_queue();
+    queue->profiling = (properties & CL_QUEUE_PROFILING_ENABLE) != 0;
+
+    if (errcode_ret) {
+        *errcode_ret = CL_SUCCESS;
+    }
+
+    return queue;
+}
+
+
+MOCK_EXPORT cl_command_queue CL_API_CALL clCreateCommandQueueWithProperties(cl_context context, cl_device_id device, const cl_queue_properties *properties, cl_int *errcode_ret)
+{
+    cl_command_queue_properties flags = 0;
+    for (size_t i = 0; properties && properties[i]; i += 2) {
+        if (properties[i] == CL_QUEUE_PROPERTIES) {
+            flags = properties[i + 1];
+        }
+    }
+
+    return clCreateCommandQueue(context, device, flags, errcode_ret);
+}
+
+
+MOCK_EXPORT cl_int CL_API_CALL clReleaseCommandQueue(cl_command_queue queue)
+{
+    if (!queue) {
+        return CL_INVALID_COMMAND_QUEUE;
+    }
+
+    sleepUntil(queue->busy);
+
+    return queue->release();
+}
+
+
+// large buffers are zeroed pages of the host that nothing touches, the scratchpads cost no memory
+MOCK_EXPORT cl_mem CL_API_CALL clCreateBuffer(cl_context, cl_mem_flags flags, size_t size, void *host_ptr, cl_int *errcode_ret)
+{
+    _cl_mem *mem = new _cl_mem();
+    mem->size    = size;
+    mem->data    = static_cast<uint8_t *>(calloc(1, std::max<size_t>(size, 1)));
+
+    if (!mem->data) {
+        delete mem;
+
+        if (errcode_ret) {
+            *errcode_ret = CL_MEM_OBJECT_ALLOCATION_FAILURE;
+        }
+
+        return nullptr;
+    }
+
+    if (host_ptr && (flags & CL_MEM_COPY_HOST_PTR)) {
+        memcpy(mem->data, host_ptr, size);
+    }
+
+    if (errcode_ret) {
+        *errcode_ret = CL_SUCCESS;
+    }
+
+    return mem;
+}
+
+
+MOCK_EXPORT cl_mem CL_API_CALL clCreateSubBuffer(cl_mem buffer, cl_mem_flags, cl_buffer_create_type, const void *buffer_create_info, cl_int *errcode_ret)
+{
+    const cl_buffer_region *region = static_cast<const cl_buffer_region *>(buffer_create_info);
+    if (!buffer || !region || region->origin + region->size > buffer->size) {
+        if (errcode_ret) {
+            *errcode_ret = CL_INVALID_VALUE;
+        }
+
+        return nullptr;
+    }
+
+    buffer->retain();
+
+    _cl_mem *mem = new _cl_mem();
+    mem->data    = buffer->data + region->origin;
+    mem->size    = region->size;
+    mem->parent  = buffer;
+
+    if (errcode_ret) {
+        *errcode_ret = CL_SUCCESS;
+    }
+
+    return mem;
+}
+
+
+MOCK_EXPORT cl_int CL_API_CALL clReleaseMemObject(cl_mem mem)
+{
+    return mem ? mem->release() : CL_INVALID_MEM_OBJECT;
+}
+
+
+static cl_program createProgram(cl_context context, cl_int *errcode_ret)
+{
+    _cl_program *program = new _cl_program();
+    program->devices     = context->devices;
+
+    if (errcode_ret) {
+        *errcode_ret = CL_SUCCESS;
+    }
+
+    return program;
+}
+
+
+MOCK_EXPORT cl_program CL_API_CALL clCreateProgramWithSource(cl_context context, cl_uint, const char **, const size_t *, cl_int *errcode_ret)
+{
+    return createProgram(context, errcode_ret);
+}
+
+
+MOCK_EXPORT cl_program CL_API_CALL clCreateProgramWithBinary(cl_context context, cl_uint num_devices, const cl_device_id *, const size_t *, const unsigned char **,
+                                                             cl_int *binary_status, cl_int *errcode_ret)
+{
+    for (cl_uint i = 0; binary_status && i < num_devices; ++i) {
+        binary_status[i] = CL_SUCCESS;
+    }
+
+    return createProgram(context, errcode_ret);
+}
+
+
+MOCK_EXPORT cl_int CL_API_CALL clBuildProgram(cl_program program, cl_uint, const cl_device_id *, const char *, void (CL_CALLBACK *pfn_notify)(cl_program, void *), void *user_data)
+{
+    if (!program) {
+        return CL_INVALID_PROGRAM;
+    }
+
+    program->built = true;
+
+    if (pfn_notify) {
+        pfn_notify(program, user_data);
+    }
+
+    return CL_SUCCESS;
+}
+
+
+MOCK_EXPORT cl_int CL_API_CALL clGetProgramBuildInfo(cl_program program, cl_device_id, cl_program_build_info param_name, size_t size, void *data, size_t *sizeRet)
+{
+    switch (param_name) {
+    case CL_PROGRAM_BUILD_STATUS:
+        return info<cl_build_status>(program->built ? CL_BUILD_SUCCESS : CL_BUILD_NONE, size, data, sizeRet);
+
+    case CL_PROGRAM_BUILD_LOG:
+    case CL_PROGRAM_BUILD_OPTIONS:
+        return info("", size, data, sizeRet);
+
+    default:
+        break;
+    }
+
+    return CL_INVALID_VALUE;
+}
+
+
+MOCK_EXPORT cl_int CL_API_CALL clGetProgramInfo(cl_program program, cl_program_info param_name, size_t size, void *data, size_t *sizeRet)
+{
+    const size_t count = program->devices.size();
+
+    switch (param_name) {
+    case CL_PROGRAM_NUM_DEVICES:
+        return info<cl_uint>(static_cast<cl_uint>(count), size, data, sizeRet);
+
+    case CL_PROGRAM_DEVICES:
+    case CL_PROGRAM_BINARY_SIZES:
+    case CL_PROGRAM_BINARIES:
+        break;
+
+    default:
+        return CL_INVALID_VALUE;
+    }
+
+    // arrays with an entry per device, all of them pointer or size_t sized
+    if (sizeRet) {
+        *sizeRet = count * sizeof(void *);
+    }
+
+    if (!data) {
+        return CL_SUCCESS;
+    }
+
+    if (size < count * sizeof(void *)) {
+        return CL_INVALID_VALUE;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if (param_name == CL_PROGRAM_DEVICES) {
+            static_cast<cl_device_id *>(data)[i] = program->devices[i];
+        }
+        else if (param_name == CL_PROGRAM_BINARY_SIZES) {
+            static_cast<size_t *>(data)[i] = sizeof(kBinary);
+        }
+        else if (static_cast<unsigned char **>(data)[i]) {
+            memcpy(static_cast<unsigned char **>(data)[i], kBinary, sizeof(kBinary));
+        }
+    }
+
+    return CL_SUCCESS;
+}
+
+
+MOCK_EXPORT cl_int CL_API_CALL clRetainProgram(cl_program program)
+{
+    return program ? program->retain() : CL_INVALID_PROGRAM;
+}
+
+
+MOCK_EXPORT cl_int CL_API_CALL clReleaseProgram(cl_program program)
+{
+    return program ? program->release() : CL_INVALID_PROGRAM;
+}
+
+
+MOCK_EXPORT cl_kernel CL_API_CALL clCreateKernel(cl_program program, const char *, cl_int *errcode_ret)
+{
+    if (!program || !program->built) {
+        if (errcode_ret) {
+            *errcode_ret = CL_INVALID_PROGRAM_EXECUTABLE;
+        }
+
+        return nullptr;
+    }
+
+    if (errcode_ret) {
+        *errcode_ret = CL_SUCCESS;
+    }
+
+    return new _cl_kernel();
+}
+
+
+MOCK_EXPORT cl_int CL_API_CALL clReleaseKernel(cl_kernel kernel)
+{
+    return kernel ? kernel->release() : CL_INVALID_KERNEL;
+}
+
+
+MOCK_EXPORT cl_int CL_API_CALL clSetKernelArg(cl_kernel kernel, cl_uint, size_t, const void *)
+{
+    return kernel ? CL_SUCCESS : CL_INVALID_KERNEL;
+}
+
+
+MOCK_EXPORT cl_int CL_API_CALL clGetKernelWorkGroupInfo(cl_kernel, cl_device_id, cl_kernel_work_group_info param_name, size_t size, void *data, size_t *sizeRet)
+{
+    switch (param_name) {
+    case CL_KERNEL_WORK_GROUP_SIZE:
+        return info<size_t>(256, size, data, sizeRet);
+
+    case CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE:
+        return info<size_t>(64, size, data, sizeRet);
+
+    case CL_KERNEL_LOCAL_MEM_SIZE:
+    case CL_KERNEL_PRIVATE_MEM_SIZE:
+        return info<cl_ulong>(0, size, data, sizeRet);
+
+    default:
+        break;
+    }
+
+    return CL_INVALID_VALUE;
+}
+
+
+MOCK_EXPORT cl_int CL_API_CALL clEnqueueNDRangeKernel(cl_command_queue queue, cl_kernel kernel, cl_uint work_dim, const size_t *, const size_t *global_work_size,
+                                                      const size_t *, cl_uint, const cl_event *, cl_event *event)
+{
+    if (!kernel) {
+        return CL_INVALID_KERNEL;
+    }
+
+    size_t items = 1;
+    for (cl_uint i = 0; global_work_size && i < work_dim; ++i) {
+        items *= global_work_size[i];
+    }
+
+    return enqueue(queue, settings().launch + settings().item * static_cast<int64_t>(items), false, event);
+}
+
+
+MOCK_EXPORT cl_int CL_API_CALL clEnqueueReadBuffer(cl_command_queue queue, cl_mem buffer, cl_bool blocking_read, size_t offset, size_t size, void *ptr,
+                                                   cl_uint, const cl_event *, cl_event *event)
+{
+    if (!buffer || offset + size > buffer->size) {
+        return CL_INVALID_VALUE;
+    }
+
+    memcpy(ptr, buffer->data + offset, size);
+
+    return enqueue(queue, transferTime(size), blocking_read == CL_TRUE, event);
+}
+
+
+MOCK_EXPORT cl_int CL_API_CALL clEnqueueWriteBuffer(cl_command_queue queue, cl_mem buffer, cl_bool blocking_write, size_t offset, size_t size, const void *ptr,
+                                                    cl_uint, const cl_event *, cl_event *event)
+{
+    if (!buffer || offset + size > buffer->size) {
+        return CL_INVALID_VALUE;
+    }
+
+    memcpy(buffer->data + offset, ptr, size);
+
+    return enqueue(queue, transferTime(size), blocking_write == CL_TRUE, event);
+}
+
+
+MOCK_EXPORT cl_int CL_API_CALL clEnqueueCopyBuffer(cl_command_queue queue, cl_mem src, cl_mem dst, size_t src_offset, size_t dst_offset, size_t size,
+                                                   cl_uint, const cl_event *, cl_event *event)
+{
+    if (!src || !dst || src_offset + size > src->size || dst_offset + size > dst->size) {
+        return CL_INVALID_VALUE;
+    }
+
+    memmove(dst->data + dst_offset, src->data + src_offset, size);
+
+    return enqueue(queue, settings().transfer, false, event);
+}
+
+
+MOCK_EXPORT void *CL_API_CALL clEnqueueMapBuffer(cl_command_queue queue, cl_mem buffer, cl_bool blocking_map, cl_map_flags, size_t offset, size_t size,
+                                                 cl_uint, const cl_event *, cl_event *event, cl_int *errcode_ret)
+{
+    const cl_int ret = buffer && offset + size <= buffer->size ? enqueue(queue, transferTime(size), blocking_map == CL_TRUE, event) : CL_INVALID_VALUE;
+    if (errcode_ret) {
+        *errcode_ret = ret;
+    }
+
+    return ret == CL_SUCCESS ? buffer->data + offset : nullptr;
+}
+
+
+MOCK_EXPORT cl_int CL_API_CALL clEnqueueUnmapMemObject(cl_command_queue queue, cl_mem memobj, void *, cl_uint, const cl_event *, cl_event *event)
+{
+    return memobj ? enqueue(queue, settings().transfer, false, event) : CL_INVALID_MEM_OBJECT;
+}
+
+
+MOCK_EXPORT cl_int CL_API_CALL clFlush(cl_command_queue queue)
+{
+    return queue ? CL_SUCCESS : CL_INVALID_COMMAND_QUEUE;
+}
+
+
+MOCK_EXPORT cl_int CL_API_CALL clFinish(cl_command_queue queue)
+{
+    if (!queue) {
+        return CL_INVALID_COMMAND_QUEUE;
+    }
+
+    int64_t busy = 0;
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        busy = queue->busy;
+    }
+
+    sleepUntil(busy);
+
+    return CL_SUCCESS;
+}
+
+
+MOCK_EXPORT cl_int CL_API_CALL clWaitForEvents(cl_uint num_events, const cl_event *event_list)
+{
+    for (cl_uint i = 0; i < num_events; ++i) {
+        sleepUntil(event_list[i]->end);
+    }
+
+    return CL_SUCCESS;
+}
+
+
+MOCK_EXPORT cl_int CL_API_CALL clGetEventInfo(cl_event event, cl_event_info param_name, size_t size, void *data, size_t *sizeRet)
+{
+    if (!event) {
+        return CL_INVALID_EVENT;
+    }
+
+    if (param_name == CL_EVENT_COMMAND_EXECUTION_STATUS) {
+        const int64_t time = now();
+
+        return info<cl_int>(time >= event->end ? CL_COMPLETE : (time >= event->start ? CL_RUNNING : CL_QUEUED), size, data, sizeRet);
+    }
+
+    return CL_INVALID_VALUE;
+}
+
+
+MOCK_EXPORT cl_int CL_API_CALL clGetEventProfilingInfo(cl_event event, cl_profiling_info param_name, size_t size, void *data, size_t *sizeRet)
+{
+    if (!event) {
+        return CL_INVALID_EVENT;
+    }
+
+    switch (param_name) {
+    case CL_PROFILING_COMMAND_QUEUED:
+    case CL_PROFILING_COMMAND_SUBMIT:
+        return info<cl_ulong>(static_cast<cl_ulong>(event->queued), size, data, sizeRet);
+
+    case CL_PROFILING_COMMAND_START:
+        return info<cl_ulong>(static_cast<cl_ulong>(event->start), size, data, sizeRet);
+
+    case CL_PROFILING_COMMAND_END:
+        return info<cl_ulong>(static_cast<cl_ulong>(event->end), size, data, sizeRet);
+
+    default:
+        break;
+    }
+
+    return CL_INVALID_VALUE;
+}
+
+
+MOCK_EXPORT cl_int CL_API_CALL clRetainEvent(cl_event event)
+{
+    return event ? event->retain() : CL_INVALID_EVENT;
+}
+
+
+MOCK_EXPORT cl_int CL_API_CALL clReleaseEvent(cl_event event)
+{
+    return event ? event->release() : CL_INVALID_EVENT;
+}
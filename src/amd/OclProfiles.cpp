@@ -0,0 +1,332 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <string.h>
+#include <string>
+
+
+#include "amd/GpuContext.h"
+#include "amd/OclProfiles.h"
+#include "base/io/Json.h"
+#include "base/kernel/Process.h"
+#include "common/crypto/Algorithm.h"
+#include "common/log/Log.h"
+#include "rapidjson/document.h"
+#include "workers/OclThread.h"
+
+
+static const char *kHealth   = "health";
+static const char *kProfiles = "profiles";
+static const char *kThreads  = "threads";
+
+static rapidjson::Document fleet;
+static rapidjson::Document local;
+static rapidjson::Document shipped;
+static std::string localFile;
+
+
+static bool load(const std::string &fileName, rapidjson::Document &doc)
+{
+    if (!xmrig::Json::get(fileName.c_str(), doc)) {
+        doc.SetObject();
+        return false;
+    }
+
+    if (xmrig::Json::getInt(doc, "version") != OclProfiles::kVersion || !doc[kProfiles].IsArray()) {
+        LOG_WARN("profiles \"%s\" ignored, version %d expected", fileName.c_str(), OclProfiles::kVersion);
+
+        doc.SetObject();
+        return false;
+    }
+
+    return true;
+}
+
+
+static inline uint64_t memorySize(const GpuContext &ctx)
+{
+    return ctx.globalMem / (1024u * 1024u);
+}
+
+
+// 0 for other GPUs, otherwise higher for profiles of the same driver or device string than of the board name only,
+// the memory size in MiB may differ by 1/16 because drivers reserve different amounts
+static int matchDevice(const rapidjson::Value &profile, const GpuContext &ctx)
+{
+    const char *board  = xmrig::Json::getString(profile, "board");
+    const char *device = xmrig::Json::getString(profile, "device");
+    if ((!board && !device) || (board && ctx.board != board) || (device && ctx.DeviceString != device)) {
+        return 0;
+    }
+
+    const uint64_t memory = xmrig::Json::getUint64(profile, "memory");
+    const uint64_t size   = memorySize(ctx);
+    if (memory && (memory > size + size / 16 || memory + size / 16 < size)) {
+        return 0;
+    }
+
+    const int driver = xmrig::Json::getInt(profile, "driver");
+    if (driver && driver != ctx.amdDriverMajorVersion) {
+        return 0;
+    }
+
+    return 1 + (device ? 1 : 0) + (driver ? 2 : 0);
+}
+
+
+static int match(const rapidjson::Value &profile, const GpuContext &ctx, const char *algo)
+{
+    if (!profile.IsObject() || !profile[kThreads].IsArray() || profile[kThreads].Empty() || strcmp(xmrig::Json::getString(profile, "algo", ""), algo) != 0) {
+        return 0;
+    }
+
+    return matchDevice(profile, ctx);
+}
+
+
+// health profiles have no algo and threads, only the "health" object
+static int matchHealth(const rapidjson::Value &profile, const GpuContext &ctx, const char *)
+{
+    if (!profile.IsObject() || !profile[kHealth].IsObject()) {
+        return 0;
+    }
+
+    return matchDevice(profile, ctx);
+}
+
+
+static const rapidjson::Value *best(const rapidjson::Document &doc, const GpuContext &ctx, const char *algo, int (*matcher)(const rapidjson::Value &, const GpuContext &, const char *) = match)
+{
+    if (!doc.IsObject() || !doc[kProfiles].IsArray()) {
+        return nullptr;
+    }
+
+    const rapidjson::Value *result = nullptr;
+    int score = 0;
+
+    for (const rapidjson::Value &profile : doc[kProfiles].GetArray()) {
+        const int value = matcher(profile, ctx, algo);
+        if (value > score) {
+            result = &profile;
+            score  = value;
+        }
+    }
+
+    return result;
+}
+
+
+bool OclProfiles::find(const GpuContext &ctx, xmrig::PerfAlgo pa, std::vector<xmrig::IThread *> &threads)
+{
+    const char *algo   = xmrig::Algorithm::perfAlgoName(pa);
+    const char *source = "fleet";
+
+    const rapidjson::Value *profile = best(fleet, ctx, algo);
+    if (!profile) {
+        profile = best(local, ctx, algo);
+        source  = "local";
+    }
+
+    if (!profile) {
+        profile = best(shipped, ctx, algo);
+        source  = "shipped";
+    }
+
+    if (!profile) {
+        return false;
+    }
+
+    for (const rapidjson::Value &value : (*profile)[kThreads].GetArray()) {
+        if (!value.IsObject() || xmrig::Json::getUint(value, "intensity") == 0) {
+            return false;
+        }
+    }
+
+    for (const rapidjson::Value &value : (*profile)[kThreads].GetArray()) {
+        xmrig::OclThread *thread = new xmrig::OclThread(value);
+        thread->setIndex(ctx.deviceIdx);
+
+        threads.push_back(thread);
+    }
+
+    LOG_INFO("%s GPU #%zu uses %s profile of \"%s\"", algo, ctx.deviceIdx, source, ctx.board.data());
+
+    return true;
+}
+
+
+// the fleet and shipped profiles give the expected values of a GPU model, the local ones the first measurement of this GPU
+bool OclProfiles::findHealth(const GpuContext &ctx, Health &health)
+{
+    const rapidjson::Value *profile = best(fleet, ctx, nullptr, matchHealth);
+    if (!profile) {
+        profile = best(shipped, ctx, nullptr, matchHealth);
+    }
+
+    if (!profile) {
+        profile = best(local, ctx, nullptr, matchHealth);
+    }
+
+    if (!profile) {
+        return false;
+    }
+
+    const rapidjson::Value &value = (*profile)[kHealth];
+    health.h2d     = xmrig::Json::getDouble(value, "h2d");
+    health.d2h     = xmrig::Json::getDouble(value, "d2h");
+    health.d2d     = xmrig::Json::getDouble(value, "d2d");
+    health.latency = xmrig::Json::getDouble(value, "latency_us");
+
+    return true;
+}
+
+
+// the same format as the files, a copy is kept because the fleet response is released after it is applied
+bool OclProfiles::setFleet(const rapidjson::Value &value)
+{
+    if (!value.IsObject() || xmrig::Json::getInt(value, "version") != kVersion || !value[kProfiles].IsArray()) {
+        LOG_WARN("fleet profiles ignored, version %d expected", kVersion);
+        return false;
+    }
+
+    fleet.CopyFrom(value, fleet.GetAllocator());
+
+    return true;
+}
+
+
+void OclProfiles::init(const xmrig::Process *process)
+{
+    load(process->location(xmrig::Process::ExeLocation, "profiles.json").data(), shipped);
+
+    localFile = process->location(xmrig::Process::ExeLocation, "profiles.local.json").data();
+    load(localFile, local);
+}
+
+
+// a profile of the same GPU, driver and algo is replaced, the file is written at once because autotune results are rare and costly
+void OclProfiles::update(const GpuContext &ctx, xmrig::PerfAlgo pa, const std::vector<const xmrig::OclThread *> &threads)
+{
+    using namespace rapidjson;
+
+    if (localFile.empty() || threads.empty()) {
+        return;
+    }
+
+    auto &allocator  = local.GetAllocator();
+    const char *algo = xmrig::Algorithm::perfAlgoName(pa);
+
+    if (!local.IsObject() || !local[kProfiles].IsArray()) {
+        local.SetObject();
+        local.AddMember("version", kVersion, allocator);
+        local.AddMember(StringRef(kProfiles), Value(kArrayType), allocator);
+    }
+
+    Value list(kArrayType);
+    for (const xmrig::OclThread *thread : threads) {
+        Value value = static_cast<const xmrig::IThread *>(thread)->toConfig(local);
+        value.RemoveMember("index");
+        value.RemoveMember("affine_to_cpu");
+        value.RemoveMember("platform");
+
+        list.PushBack(value, allocator);
+    }
+
+    Value profile(kObjectType);
+    profile.AddMember("board",   Value(ctx.board.data(), allocator), allocator);
+    profile.AddMember("device",  Value(ctx.DeviceString.c_str(), allocator), allocator);
+    profile.AddMember("memory",  memorySize(ctx), allocator);
+    profile.AddMember("driver",  ctx.amdDriverMajorVersion, allocator);
+    profile.AddMember("algo",    StringRef(algo), allocator);
+    profile.AddMember(StringRef(kThreads), list, allocator);
+
+    Value &profiles = local[kProfiles];
+    bool replaced   = false;
+
+    for (Value &value : profiles.GetArray()) {
+        if (value.IsObject() &&
+            strcmp(xmrig::Json::getString(value, "algo", ""), algo) == 0 &&
+            ctx.DeviceString == xmrig::Json::getString(value, "device", "") &&
+            xmrig::Json::getInt(value, "driver") == ctx.amdDriverMajorVersion)
+        {
+            value    = profile;
+            replaced = true;
+            break;
+        }
+    }
+
+    if (!replaced) {
+        profiles.PushBack(profile, allocator);
+    }
+
+    if (!xmrig::Json::save(localFile.c_str(), local)) {
+        LOG_ERR("unable to write profiles \"%s\"", localFile.c_str());
+        return;
+    }
+
+    LOG_NOTICE("%s profile of GPU #%zu saved to \"%s\"", algo, ctx.deviceIdx, localFile.c_str());
+}
+
+
+// the baseline of a GPU is written once, a later degraded measurement must not replace it
+void OclProfiles::updateHealth(const GpuContext &ctx, const Health &health)
+{
+    using namespace rapidjson;
+
+    if (localFile.empty() || best(local, ctx, nullptr, matchHealth)) {
+        return;
+    }
+
+    auto &allocator = local.GetAllocator();
+
+    if (!local.IsObject() || !local[kProfiles].IsArray()) {
+        local.SetObject();
+        local.AddMember("version", kVersion, allocator);
+        local.AddMember(StringRef(kProfiles), Value(kArrayType), allocator);
+    }
+
+    Value value(kObjectType);
+    value.AddMember("h2d",        health.h2d, allocator);
+    value.AddMember("d2h",        health.d2h, allocator);
+    value.AddMember("d2d",        health.d2d, allocator);
+    value.AddMember("latency_us", health.latency, allocator);
+
+    Value profile(kObjectType);
+    profile.AddMember("board",  Value(ctx.board.data(), allocator), allocator);
+    profile.AddMember("device", Value(ctx.DeviceString.c_str(), allocator), allocator);
+    profile.AddMember("memory", memorySize(ctx), allocator);
+    profile.AddMember("driver", ctx.amdDriverMajorVersion, allocator);
+    profile.AddMember(StringRef(kHealth), value, allocator);
+
+    local[kProfiles].PushBack(profile, allocator);
+
+    if (!xmrig::Json::save(localFile.c_str(), local)) {
+        LOG_ERR("unable to write profiles \"%s\"", localFile.c_str());
+        return;
+    }
+
+    LOG_NOTICE("health baseline of GPU #%zu saved to \"%s\"", ctx.deviceIdx, localFile.c_str());
+}
@@ -0,0 +1,73 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef XMRIG_OCLPROFILES_H
+#define XMRIG_OCLPROFILES_H
+
+
+#include <vector>
+
+
+#include "common/xmrig.h"
+#include "rapidjson/fwd.h"
+
+
+struct GpuContext;
+
+
+namespace xmrig {
+    class IThread;
+    class OclThread;
+    class Process;
+}
+
+
+// known-good threads of a GPU model for each perf algo, autoConf takes them before its heuristics,
+// profiles.json next to the miner is shipped with it, profiles.local.json overrides it and gets the autotune results,
+// profiles pulled from the fleet service override both until exit
+class OclProfiles
+{
+public:
+    // expected transfer rates of a GPU in GB/s and the latency of a small read in us, see OclDiagnostics
+    struct Health
+    {
+        double h2d;
+        double d2h;
+        double d2d;
+        double latency;
+    };
+
+    static bool find(const GpuContext &ctx, xmrig::PerfAlgo pa, std::vector<xmrig::IThread *> &threads);
+    static bool findHealth(const GpuContext &ctx, Health &health);
+    static bool setFleet(const rapidjson::Value &value);
+    static void init(const xmrig::Process *process);
+    static void update(const GpuContext &ctx, xmrig::PerfAlgo pa, const std::vector<const xmrig::OclThread *> &threads);
+    static void updateHealth(const GpuContext &ctx, const Health &health);
+
+    constexpr static const int kVersion = 1;
+};
+
+
+#endif /* XMRIG_OCLPROFILES_H */
@@ -0,0 +1,115 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string.h>
+
+
+#include "amd/OclSource.h"
+#include "common/log/Log.h"
+
+
+static std::mutex mutex;
+static std::string directory;
+
+
+// the files have the format of src/amd/opencl: the parts of the raw string literals are joined, a file without them is taken as is
+static std::string unwrap(const std::string &file)
+{
+    static const char kOpen[]  = "R\"===(";
+    static const char kClose[] = ")===\"";
+
+    if (file.find(kOpen) == std::string::npos) {
+        return file;
+    }
+
+    std::string source;
+    for (size_t pos = file.find(kOpen); pos != std::string::npos; pos = file.find(kOpen, pos)) {
+        pos += sizeof(kOpen) - 1;
+
+        const size_t end = file.find(kClose, pos);
+        source.append(file, pos, end == std::string::npos ? std::string::npos : end - pos);
+
+        if (end == std::string::npos) {
+            break;
+        }
+
+        pos = end + sizeof(kClose) - 1;
+    }
+
+    return source;
+}
+
+
+bool OclSource::isEnabled()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return !directory.empty();
+}
+
+
+// read on each call, a missing file keeps the embedded source
+std::string OclSource::get(const char *name, const char *embedded)
+{
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (directory.empty()) {
+            return embedded;
+        }
+
+        path = directory + "/" + name;
+    }
+
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        return embedded;
+    }
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+
+    return unwrap(buffer.str());
+}
+
+
+void OclSource::setDirectory(const char *directory)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const std::string value = directory ? directory : "";
+    if (value == ::directory) {
+        return;
+    }
+
+    ::directory = value;
+
+    if (!value.empty()) {
+        LOG_WARN("OpenCL kernel sources in \"%s\" replace the embedded ones", value.c_str());
+    }
+}
@@ -19,8 +19,19 @@ R"===(
 #   pragma OPENCL EXTENSION cl_clang_storage_class_specifiers : enable
 #endif
 
+// a program specialized for one algorithm is built with -DKERNELS set to a mask of the kernel slots it uses,
+// other kernels are left out, see kernelsMask() in OclGPU.cpp; with a single variant -DVARIANT is set as well.
+// Finalize (slot 3) is the same for all algorithms, it is built once per device as a program of its own
+// and left out of the algorithm programs, see finalizeProgram() in OclGPU.cpp
+#ifndef KERNELS
+#   define KERNELS 0xFFFFFFFFU
+#endif
+
+#define HAS_KERNEL(slot) ((KERNELS >> (slot)) & 1U)
+
 //#include "opencl/wolf-aes.cl"
 XMRIG_INCLUDE_WOLF_AES
+#if HAS_KERNEL(3)
 //#include "opencl/wolf-skein.cl"
 XMRIG_INCLUDE_WOLF_SKEIN
 //#include "opencl/jh.cl"
@@ -29,6 +40,7 @@ XMRIG_INCLUDE_JH
 XMRIG_INCLUDE_BLAKE256
 //#include "opencl/groestl256.cl"
 XMRIG_INCLUDE_GROESTL256
+#endif
 //#include "fast_int_math_v2.cl"
 XMRIG_INCLUDE_FAST_INT_MATH_V2
 //#include "fast_div_heavy.cl"
@@ -58,6 +70,15 @@ XMRIG_INCLUDE_FAST_DIV_HEAVY
 #   define STRIDED_INDEX 0
 #endif
 
+#ifndef HASHES_PER_ITEM
+#   define HASHES_PER_ITEM 1
+#endif
+
+#if defined(__NV_CL_C_VERSION) && HASHES_PER_ITEM != 1
+#   undef HASHES_PER_ITEM
+#   define HASHES_PER_ITEM 1
+#endif
+
 
 static const __constant ulong keccakf_rndc[24] =
 {
@@ -334,22 +355,46 @@ void AESExpandKey256(uint *keybuf)
 #   endif
 #elif (STRIDED_INDEX == 2)
 #   define IDX(x)   (((x) % MEM_CHUNK) + ((x) / MEM_CHUNK) * WORKSIZE * MEM_CHUNK)
+#elif (STRIDED_INDEX == 3)
+#   define IDX(x)   (((x) % MEM_CHUNK) + ((x) / MEM_CHUNK) * Threads * MEM_CHUNK)
 #endif
 
 inline ulong getIdx()
 {
-#   if (STRIDED_INDEX == 0 || STRIDED_INDEX == 1 || STRIDED_INDEX == 2)
+#   if (STRIDED_INDEX == 0 || STRIDED_INDEX == 1 || STRIDED_INDEX == 2 || STRIDED_INDEX == 3)
     return get_global_id(0) - get_global_offset(0);
 #   endif
 }
 
+// with --tdr-limit cn1 runs in chunks, the host passes the first work item of a chunk as the global offset of the
+// second dimension, it is 0 for a 1D launch, the groups of a chunk are counted from gIdx
+inline ulong getCn1Idx()
+{
+    return getIdx() + get_global_offset(1);
+}
+
+// a persistent thread keeps several batches in flight, the host sets Control[0] to the generation of the latest job and
+// passes the generation of the batch, batches of a replaced job leave cn1 and cn2 early. The value is read once per
+// group so the whole group returns together, cn2 leaves the branches empty and Finalize finds nothing
+#define STALE_LOAD() \
+    __local uint stale; \
+    if (get_local_id(0) == 0 && get_local_id(1) == 0) { \
+        stale = Control[0] != Generation; \
+    }
+
+#define STALE_EXIT() \
+    if (stale) { \
+        return; \
+    }
+
 //#include "opencl/cryptonight_gpu.cl"
 XMRIG_INCLUDE_CN_GPU
 
 #define mix_and_propagate(xin) (xin)[(get_local_id(1)) % 8][get_local_id(0)] ^ (xin)[(get_local_id(1) + 1) % 8][get_local_id(0)]
 
+#if HAS_KERNEL(0)
 __attribute__((reqd_work_group_size(8, 8, 1)))
-__kernel void cn0(__global ulong *input, __global uint4 *Scratchpad, __global ulong *states, uint Threads)
+__kernel void cn0(__global ulong *input, __global uint4 *Scratchpad, __global ulong *states, uint Threads, __global uint *Branch0, __global uint *Branch1, __global uint *Branch2, __global uint *Branch3, __global uint *output)
 {
     uint ExpandedKey1[40];
     __local uint AES0[256], AES1[256], AES2[256], AES3[256];
@@ -357,6 +402,15 @@ __kernel void cn0(__global ulong *input, __global uint4 *Scratchpad, __global ul
 
     const uint gIdx = getIdx();
 
+    // reset the batch counters, cn2 and the final hash kernels run only after this kernel is complete
+    if (gIdx == 0 && get_global_id(1) == get_global_offset(1)) {
+        Branch0[Threads] = 0;
+        Branch1[Threads] = 0;
+        Branch2[Threads] = 0;
+        Branch3[Threads] = 0;
+        output[RESULT_SLOTS] = 0;
+    }
+
     for (int i = get_local_id(1) * 8 + get_local_id(0); i < 256; i += 8 * 8) {
         const uint tmp = AES0_C[i];
         AES0[i] = tmp;
@@ -386,6 +440,8 @@ __kernel void cn0(__global ulong *input, __global uint4 *Scratchpad, __global ul
 #       endif
 #       elif (STRIDED_INDEX == 2)
         Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * (gIdx % WORKSIZE);
+#       elif (STRIDED_INDEX == 3)
+        Scratchpad += MEM_CHUNK * gIdx;
 #       endif
 
         if (get_local_id(1) == 0)
@@ -428,18 +484,21 @@ __kernel void cn0(__global ulong *input, __global uint4 *Scratchpad, __global ul
         }
     }
 
-    barrier(CLK_GLOBAL_MEM_FENCE);
+    // the other lanes of the hash take the keccak state from local memory, not back from global memory
+    barrier(CLK_LOCAL_MEM_FENCE | CLK_GLOBAL_MEM_FENCE);
 
 #   if (COMP_MODE == 1)
     // do not use early return here
     if (gIdx < Threads)
 #   endif
     {
-        text = vload4(get_local_id(1) + 4, (__global uint *)(states));
+        const __local ulong* State = State_buf + get_local_id(0) * 25;
+
+        text = vload4(get_local_id(1) + 4, (const __local uint *)(State));
 
         #pragma unroll
         for (int i = 0; i < 4; ++i) {
-            ((ulong *)ExpandedKey1)[i] = states[i];
+            ((ulong *)ExpandedKey1)[i] = State[i];
         }
 
         AESExpandKey256(ExpandedKey1);
@@ -497,6 +556,7 @@ __kernel void cn0(__global ulong *input, __global uint4 *Scratchpad, __global ul
     }
     mem_fence(CLK_GLOBAL_MEM_FENCE);
 }
+#endif
 
 )==="
 R"===(
@@ -518,16 +578,21 @@ R"===(
         tweak1_2 = as_uint2(input[4]); \
         tweak1_2.s0 >>= 24; \
         tweak1_2.s0 |= tweak1_2.s1 << 8; \
-        tweak1_2.s1 = (uint) get_global_id(0); \
+        tweak1_2.s1 = (uint) (get_global_id(0) + get_global_offset(1)); \
         tweak1_2 ^= as_uint2(states[24])
 
+#if HAS_KERNEL(7)
 __attribute__((reqd_work_group_size(WORKSIZE, 1, 1)))
-__kernel void cn1_monero(__global uint4 *Scratchpad, __global ulong *states, uint variant, __global ulong *input, uint Threads)
+__kernel void cn1_monero(__global uint4 *Scratchpad, __global ulong *states, uint variant, __global ulong *input, uint Threads, __global const volatile uint *Control, uint Generation)
 {
+#   ifdef VARIANT
+    variant = VARIANT;
+#   endif
+
     ulong a[2], b[2];
     __local uint AES0[256], AES1[256];
 
-    const ulong gIdx = getIdx();
+    const ulong gIdx = getCn1Idx();
 
     for (int i = get_local_id(0); i < 256; i += WORKSIZE) {
         const uint tmp = AES0_C[i];
@@ -535,7 +600,9 @@ __kernel void cn1_monero(__global uint4 *Scratchpad, __global ulong *states, uin
         AES1[i] = rotate(tmp, 8U);
     }
 
+    STALE_LOAD();
     barrier(CLK_LOCAL_MEM_FENCE);
+    STALE_EXIT();
 
     uint2 tweak1_2;
     uint4 b_x;
@@ -554,7 +621,9 @@ __kernel void cn1_monero(__global uint4 *Scratchpad, __global ulong *states, uin
             Scratchpad += gIdx;
 #       endif
 #       elif (STRIDED_INDEX == 2)
-        Scratchpad += get_group_id(0) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
+        Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
+#       elif (STRIDED_INDEX == 3)
+        Scratchpad += MEM_CHUNK * gIdx;
 #       endif
 
         a[0] = states[0] ^ states[4];
@@ -606,31 +675,170 @@ __kernel void cn1_monero(__global uint4 *Scratchpad, __global ulong *states, uin
     }
     mem_fence(CLK_GLOBAL_MEM_FENCE);
 }
+#endif
 
 
 )==="
 R"===(
 
+#if HAS_KERNEL(11)
 __attribute__((reqd_work_group_size(WORKSIZE, 1, 1)))
-__kernel void cn1_v2_monero(__global uint4 *Scratchpad, __global ulong *states, uint variant, __global ulong *input, uint Threads)
+__kernel void cn1_v2_monero(__global uint4 *Scratchpad, __global ulong *states, uint variant, __global ulong *input, uint Threads, __global const volatile uint *Control, uint Generation)
 {
 #   if (ALGO == CRYPTONIGHT || ALGO == CRYPTONIGHT_PICO)
     ulong a[2], b[4];
+#   if (AES_TABLES == 2)
+    __local uint AES0[256], AES1[256];
+#   else
     __local uint AES0[256], AES1[256], AES2[256], AES3[256];
+#   endif
     
-    const ulong gIdx = getIdx();
+    const ulong gIdx = getCn1Idx();
 
     for(int i = get_local_id(0); i < 256; i += WORKSIZE)
     {
         const uint tmp = AES0_C[i];
         AES0[i] = tmp;
         AES1[i] = rotate(tmp, 8U);
+#       if (AES_TABLES == 4)
         AES2[i] = rotate(tmp, 16U);
         AES3[i] = rotate(tmp, 24U);
+#       endif
     }
 
+    STALE_LOAD();
     barrier(CLK_LOCAL_MEM_FENCE);
+    STALE_EXIT();
+
+#   if (HASHES_PER_ITEM > 1)
+#       if (STRIDED_INDEX == 0)
+#           define SCRATCHPAD_CHUNK(N) (*(__global uint4*)((__global uchar*)(Scratchpad) + (idx ^ (N << 4))))
+#       elif (STRIDED_INDEX == 1)
+#           define SCRATCHPAD_CHUNK(N) (*(__global uint4*)((__global uchar*)(Scratchpad) + mul24(as_uint(idx ^ (N << 4)), Threads)))
+#       elif (STRIDED_INDEX == 2)
+#           define SCRATCHPAD_CHUNK(N) (*(__global uint4*)((__global uchar*)(Scratchpad) + (((idx ^ (N << 4)) % (MEM_CHUNK << 4)) + ((idx ^ (N << 4)) / (MEM_CHUNK << 4)) * WORKSIZE * (MEM_CHUNK << 4))))
+#       elif (STRIDED_INDEX == 3)
+#           define SCRATCHPAD_CHUNK(N) (*(__global uint4*)((__global uchar*)(Scratchpad) + (((idx ^ (N << 4)) % (MEM_CHUNK << 4)) + (ulong)((idx ^ (N << 4)) / (MEM_CHUNK << 4)) * (Threads * (MEM_CHUNK << 4)))))
+#       endif
+
+    // the work item runs the main loops of HASHES_PER_ITEM consecutive hashes side by side, every step
+    // is done for all of them before the next one, so their independent memory accesses overlap;
+    // the host launches Threads / HASHES_PER_ITEM work items and keeps Threads a multiple of it
+    if (gIdx * HASHES_PER_ITEM < Threads)
+    {
+    __global uint4 *pads[HASHES_PER_ITEM];
+    ulong2 a[HASHES_PER_ITEM], bx0[HASHES_PER_ITEM], bx1[HASHES_PER_ITEM];
+    uint2 division_result[HASHES_PER_ITEM];
+    uint sqrt_result[HASHES_PER_ITEM];
+
+    #pragma unroll
+    for (int h = 0; h < HASHES_PER_ITEM; ++h) {
+        const ulong hIdx            = gIdx * HASHES_PER_ITEM + h;
+        const __global ulong *state = states + 25 * hIdx;
+
+#       if (STRIDED_INDEX == 0)
+        pads[h] = Scratchpad + hIdx * (MEMORY >> 4);
+#       elif (STRIDED_INDEX == 1)
+        pads[h] = Scratchpad + hIdx;
+#       elif (STRIDED_INDEX == 2)
+        pads[h] = Scratchpad + (hIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * (hIdx % WORKSIZE);
+#       elif (STRIDED_INDEX == 3)
+        pads[h] = Scratchpad + MEM_CHUNK * hIdx;
+#       endif
+
+        a[h]   = (ulong2)(state[0] ^ state[4], state[1] ^ state[5]);
+        bx0[h] = (ulong2)(state[2] ^ state[6], state[3] ^ state[7]);
+        bx1[h] = (ulong2)(state[8] ^ state[10], state[9] ^ state[11]);
+
+        division_result[h] = as_uint2(state[12]);
+        sqrt_result[h]     = as_uint2(state[13]).s0;
+    }
+
+    #pragma unroll UNROLL_FACTOR
+    for (int i = 0; i < ITERATIONS; ++i)
+    {
+        uint idx0[HASHES_PER_ITEM], idx1[HASHES_PER_ITEM];
+        uint4 c[HASHES_PER_ITEM], tmp[HASHES_PER_ITEM];
+        ulong2 chunk1[HASHES_PER_ITEM], chunk2[HASHES_PER_ITEM], chunk3[HASHES_PER_ITEM];
+
+        #pragma unroll
+        for (int h = 0; h < HASHES_PER_ITEM; ++h) {
+            __global uint4 *Scratchpad = pads[h];
+            const uint idx = a[h].s0 & MASK;
+
+            idx0[h]   = idx;
+            c[h]      = SCRATCHPAD_CHUNK(0);
+            chunk1[h] = as_ulong2(SCRATCHPAD_CHUNK(1));
+            chunk2[h] = as_ulong2(SCRATCHPAD_CHUNK(2));
+            chunk3[h] = as_ulong2(SCRATCHPAD_CHUNK(3));
+        }
+
+        #pragma unroll
+        for (int h = 0; h < HASHES_PER_ITEM; ++h) {
+            __global uint4 *Scratchpad = pads[h];
+            const uint idx = idx0[h];
+
+#           if (AES_TABLES == 2)
+            c[h] = AES_Round_Two_Tables(AES0, AES1, c[h], as_uint4(a[h]));
+#           else
+            c[h] = AES_Round(AES0, AES1, AES2, AES3, c[h], as_uint4(a[h]));
+#           endif
+
+            SCRATCHPAD_CHUNK(1) = as_uint4(chunk3[h] + bx1[h]);
+            SCRATCHPAD_CHUNK(2) = as_uint4(chunk1[h] + bx0[h]);
+            SCRATCHPAD_CHUNK(3) = as_uint4(chunk2[h] + a[h]);
+            SCRATCHPAD_CHUNK(0) = as_uint4(bx0[h]) ^ c[h];
+
+            idx1[h] = as_ulong2(c[h]).s0 & MASK;
+        }
+
+        #pragma unroll
+        for (int h = 0; h < HASHES_PER_ITEM; ++h) {
+            __global uint4 *Scratchpad = pads[h];
+            const uint idx = idx1[h];
+
+            tmp[h]    = SCRATCHPAD_CHUNK(0);
+            chunk1[h] = as_ulong2(SCRATCHPAD_CHUNK(1));
+            chunk2[h] = as_ulong2(SCRATCHPAD_CHUNK(2));
+            chunk3[h] = as_ulong2(SCRATCHPAD_CHUNK(3));
+        }
 
+        #pragma unroll
+        for (int h = 0; h < HASHES_PER_ITEM; ++h) {
+            __global uint4 *Scratchpad = pads[h];
+            const uint idx = idx1[h];
+
+            tmp[h].s0 ^= division_result[h].s0;
+            tmp[h].s1 ^= division_result[h].s1 ^ sqrt_result[h];
+
+            division_result[h] = fast_div_v2(as_ulong2(c[h]).s1, (c[h].s0 + (sqrt_result[h] << 1)) | 0x80000001UL);
+            sqrt_result[h]     = fast_sqrt_v2(as_ulong2(c[h]).s0 + as_ulong(division_result[h]));
+
+            ulong2 t;
+            t.s0 = mul_hi(as_ulong2(c[h]).s0, as_ulong2(tmp[h]).s0);
+            t.s1 = as_ulong2(c[h]).s0 * as_ulong2(tmp[h]).s0;
+
+            chunk1[h] ^= t;
+            t ^= chunk2[h];
+
+            SCRATCHPAD_CHUNK(1) = as_uint4(chunk3[h] + bx1[h]);
+            SCRATCHPAD_CHUNK(2) = as_uint4(chunk1[h] + bx0[h]);
+            SCRATCHPAD_CHUNK(3) = as_uint4(chunk2[h] + a[h]);
+
+            a[h].s1 += t.s1;
+            a[h].s0 += t.s0;
+
+            SCRATCHPAD_CHUNK(0) = as_uint4(a[h]);
+
+            a[h] ^= as_ulong2(tmp[h]);
+            bx1[h] = bx0[h];
+            bx0[h] = as_ulong2(c[h]);
+        }
+    }
+    }
+
+#   undef SCRATCHPAD_CHUNK
+#   else
 #   if (COMP_MODE == 1)
     // do not use early return here
     if (gIdx < Threads)
@@ -646,7 +854,9 @@ __kernel void cn1_v2_monero(__global uint4 *Scratchpad, __global ulong *states,
 #           elif (STRIDED_INDEX == 1)
                 Scratchpad += gIdx;
 #           elif (STRIDED_INDEX == 2)
-                Scratchpad += get_group_id(0) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
+                Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
+#           elif (STRIDED_INDEX == 3)
+                Scratchpad += MEM_CHUNK * gIdx;
 #           endif
 #       endif
 
@@ -675,6 +885,8 @@ __kernel void cn1_v2_monero(__global uint4 *Scratchpad, __global ulong *states,
 #           define SCRATCHPAD_CHUNK(N) (*(__global uint4*)((__global uchar*)(Scratchpad) + mul24(as_uint(idx ^ (N << 4)), Threads)))
 #       elif (STRIDED_INDEX == 2)
 #           define SCRATCHPAD_CHUNK(N) (*(__global uint4*)((__global uchar*)(Scratchpad) + (((idx ^ (N << 4)) % (MEM_CHUNK << 4)) + ((idx ^ (N << 4)) / (MEM_CHUNK << 4)) * WORKSIZE * (MEM_CHUNK << 4))))
+#       elif (STRIDED_INDEX == 3)
+#           define SCRATCHPAD_CHUNK(N) (*(__global uint4*)((__global uchar*)(Scratchpad) + (((idx ^ (N << 4)) % (MEM_CHUNK << 4)) + (ulong)((idx ^ (N << 4)) / (MEM_CHUNK << 4)) * (Threads * (MEM_CHUNK << 4)))))
 #       endif
 #   endif
 
@@ -699,7 +911,11 @@ __kernel void cn1_v2_monero(__global uint4 *Scratchpad, __global ulong *states,
 #       endif
 
         uint4 c = SCRATCHPAD_CHUNK(0);
+#       if (AES_TABLES == 2)
+        c = AES_Round_Two_Tables(AES0, AES1, c, ((uint4 *)a)[0]);
+#       else
         c = AES_Round(AES0, AES1, AES2, AES3, c, ((uint4 *)a)[0]);
+#       endif
 
         {
             const ulong2 chunk1 = as_ulong2(SCRATCHPAD_CHUNK(1));
@@ -764,32 +980,53 @@ __kernel void cn1_v2_monero(__global uint4 *Scratchpad, __global ulong *states,
     
 #   undef SCRATCHPAD_CHUNK
     }
+#   endif
     mem_fence(CLK_GLOBAL_MEM_FENCE);
 #   endif
 }
+#endif
 
 )==="
 R"===(
 
+#if HAS_KERNEL(12)
 __attribute__((reqd_work_group_size(WORKSIZE, 1, 1)))
-__kernel void cn1_v2_half(__global uint4 *Scratchpad, __global ulong *states, uint variant, __global ulong *input, uint Threads)
+__kernel void cn1_v2_ext(__global uint4 *Scratchpad, __global ulong *states, uint params, __global ulong *input, uint Threads, __global const volatile uint *Control, uint Generation)
 {
+#   ifdef CN1_PARAMS
+    params = CN1_PARAMS;
+#   endif
+
 #   if (ALGO == CRYPTONIGHT)
+    // the forks of variant 2 (half, rwz, zls, double), params has the iterations with the shuffle order in the low bit,
+    // see cn_variants in CryptoNight_constants.h
+    const uint iterations = (params & ~1U) ? (params & ~1U) : ITERATIONS;
+    const uint first      = (params & 1U) ? 3 : 1;
+    const uint last       = first ^ 2;
+
     ulong a[2], b[4];
+#   if (AES_TABLES == 2)
+    __local uint AES0[256], AES1[256];
+#   else
     __local uint AES0[256], AES1[256], AES2[256], AES3[256];
+#   endif
 
-    const ulong gIdx = getIdx();
+    const ulong gIdx = getCn1Idx();
 
     for(int i = get_local_id(0); i < 256; i += WORKSIZE)
     {
         const uint tmp = AES0_C[i];
         AES0[i] = tmp;
         AES1[i] = rotate(tmp, 8U);
+#       if (AES_TABLES == 4)
         AES2[i] = rotate(tmp, 16U);
         AES3[i] = rotate(tmp, 24U);
+#       endif
     }
 
+    STALE_LOAD();
     barrier(CLK_LOCAL_MEM_FENCE);
+    STALE_EXIT();
 
 #   if (COMP_MODE == 1)
     // do not use early return here
@@ -799,14 +1036,16 @@ __kernel void cn1_v2_half(__global uint4 *Scratchpad, __global ulong *states, ui
         states += 25 * gIdx;
 
 #       if defined(__NV_CL_C_VERSION)
-            Scratchpad += gIdx * (0x40000 >> 2);
+            Scratchpad += gIdx * (iterations >> 2);
 #       else
 #           if (STRIDED_INDEX == 0)
                 Scratchpad += gIdx * (MEMORY >> 4);
 #           elif (STRIDED_INDEX == 1)
                 Scratchpad += gIdx;
 #           elif (STRIDED_INDEX == 2)
-                Scratchpad += get_group_id(0) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
+                Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
+#           elif (STRIDED_INDEX == 3)
+                Scratchpad += MEM_CHUNK * gIdx;
 #           endif
 #       endif
 
@@ -835,6 +1074,8 @@ __kernel void cn1_v2_half(__global uint4 *Scratchpad, __global ulong *states, ui
 #           define SCRATCHPAD_CHUNK(N) (*(__global uint4*)((__global uchar*)(Scratchpad) + mul24(as_uint(idx ^ (N << 4)), Threads)))
 #       elif (STRIDED_INDEX == 2)
 #           define SCRATCHPAD_CHUNK(N) (*(__global uint4*)((__global uchar*)(Scratchpad) + (((idx ^ (N << 4)) % (MEM_CHUNK << 4)) + ((idx ^ (N << 4)) / (MEM_CHUNK << 4)) * WORKSIZE * (MEM_CHUNK << 4))))
+#       elif (STRIDED_INDEX == 3)
+#           define SCRATCHPAD_CHUNK(N) (*(__global uint4*)((__global uchar*)(Scratchpad) + (((idx ^ (N << 4)) % (MEM_CHUNK << 4)) + (ulong)((idx ^ (N << 4)) / (MEM_CHUNK << 4)) * (Threads * (MEM_CHUNK << 4)))))
 #       endif
 #   endif
 
@@ -847,7 +1088,7 @@ __kernel void cn1_v2_half(__global uint4 *Scratchpad, __global ulong *states, ui
     uint sqrt_result = as_uint2(states[13]).s0;
 
     #pragma unroll UNROLL_FACTOR
-    for(int i = 0; i < 0x40000; ++i)
+    for(uint i = 0; i < iterations; ++i)
     {
 #       ifdef __NV_CL_C_VERSION
             uint idx  = a[0] & 0x1FFFC0;
@@ -859,12 +1100,16 @@ __kernel void cn1_v2_half(__global uint4 *Scratchpad, __global ulong *states, ui
 #       endif
 
         uint4 c = SCRATCHPAD_CHUNK(0);
+#       if (AES_TABLES == 2)
+        c = AES_Round_Two_Tables(AES0, AES1, c, ((uint4 *)a)[0]);
+#       else
         c = AES_Round(AES0, AES1, AES2, AES3, c, ((uint4 *)a)[0]);
+#       endif
 
         {
-            const ulong2 chunk1 = as_ulong2(SCRATCHPAD_CHUNK(1));
+            const ulong2 chunk1 = as_ulong2(SCRATCHPAD_CHUNK(first));
             const ulong2 chunk2 = as_ulong2(SCRATCHPAD_CHUNK(2));
-            const ulong2 chunk3 = as_ulong2(SCRATCHPAD_CHUNK(3));
+            const ulong2 chunk3 = as_ulong2(SCRATCHPAD_CHUNK(last));
 
             SCRATCHPAD_CHUNK(1) = as_uint4(chunk3 + bx1);
             SCRATCHPAD_CHUNK(2) = as_uint4(chunk1 + bx0);
@@ -903,8 +1148,8 @@ __kernel void cn1_v2_half(__global uint4 *Scratchpad, __global ulong *states, ui
             t ^= chunk2;
             const ulong2 chunk3 = as_ulong2(SCRATCHPAD_CHUNK(3));
 
-            SCRATCHPAD_CHUNK(1) = as_uint4(chunk3 + bx1);
-            SCRATCHPAD_CHUNK(2) = as_uint4(chunk1 + bx0);
+            SCRATCHPAD_CHUNK(1) = as_uint4(((params & 1U) ? chunk1 : chunk3) + bx1);
+            SCRATCHPAD_CHUNK(2) = as_uint4(((params & 1U) ? chunk3 : chunk1) + bx0);
             SCRATCHPAD_CHUNK(3) = as_uint4(chunk2 + ((ulong2 *)a)[0]);
         }
 
@@ -927,18 +1172,20 @@ __kernel void cn1_v2_half(__global uint4 *Scratchpad, __global ulong *states, ui
     mem_fence(CLK_GLOBAL_MEM_FENCE);
 #   endif
 }
+#endif
 
 )==="
 R"===(
 
+#if HAS_KERNEL(8)
 __attribute__((reqd_work_group_size(WORKSIZE, 1, 1)))
-__kernel void cn1_msr(__global uint4 *Scratchpad, __global ulong *states, uint variant, __global ulong *input, uint Threads)
+__kernel void cn1_msr(__global uint4 *Scratchpad, __global ulong *states, uint variant, __global ulong *input, uint Threads, __global const volatile uint *Control, uint Generation)
 {
 #   if (ALGO == CRYPTONIGHT)
     ulong a[2], b[2];
     __local uint AES0[256], AES1[256];
 
-    const ulong gIdx = getIdx();
+    const ulong gIdx = getCn1Idx();
 
     for (int i = get_local_id(0); i < 256; i += WORKSIZE) {
         const uint tmp = AES0_C[i];
@@ -946,7 +1193,9 @@ __kernel void cn1_msr(__global uint4 *Scratchpad, __global ulong *states, uint v
         AES1[i] = rotate(tmp, 8U);
     }
 
+    STALE_LOAD();
     barrier(CLK_LOCAL_MEM_FENCE);
+    STALE_EXIT();
 
     uint2 tweak1_2;
     uint4 b_x;
@@ -960,12 +1209,14 @@ __kernel void cn1_msr(__global uint4 *Scratchpad, __global ulong *states, uint v
         Scratchpad += gIdx * (MEMORY >> 4);
 #       elif (STRIDED_INDEX == 1)
 #       if (ALGO == CRYPTONIGHT_HEAVY)
-            Scratchpad += get_group_id(0) * (MEMORY >> 4) * WORKSIZE + get_local_id(0);
+            Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + get_local_id(0);
 #       else
             Scratchpad += gIdx;
 #       endif
 #       elif (STRIDED_INDEX == 2)
-        Scratchpad += get_group_id(0) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
+        Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
+#       elif (STRIDED_INDEX == 3)
+        Scratchpad += MEM_CHUNK * gIdx;
 #       endif
 
         a[0] = states[0] ^ states[4];
@@ -1015,18 +1266,20 @@ __kernel void cn1_msr(__global uint4 *Scratchpad, __global ulong *states, uint v
     mem_fence(CLK_GLOBAL_MEM_FENCE);
 #   endif
 }
+#endif
 
 )==="
 R"===(
 
+#if HAS_KERNEL(10)
 __attribute__((reqd_work_group_size(WORKSIZE, 1, 1)))
-__kernel void cn1_tube(__global uint4 *Scratchpad, __global ulong *states, uint variant, __global ulong *input, uint Threads)
+__kernel void cn1_tube(__global uint4 *Scratchpad, __global ulong *states, uint variant, __global ulong *input, uint Threads, __global const volatile uint *Control, uint Generation)
 {
 #   if (ALGO == CRYPTONIGHT_HEAVY)
     ulong a[2], b[2];
     __local uint AES0[256], AES1[256];
 
-    const ulong gIdx = getIdx();
+    const ulong gIdx = getCn1Idx();
 
     for (int i = get_local_id(0); i < 256; i += WORKSIZE) {
         const uint tmp = AES0_C[i];
@@ -1034,7 +1287,9 @@ __kernel void cn1_tube(__global uint4 *Scratchpad, __global ulong *states, uint
         AES1[i] = rotate(tmp, 8U);
     }
 
+    STALE_LOAD();
     barrier(CLK_LOCAL_MEM_FENCE);
+    STALE_EXIT();
 
     uint2 tweak1_2;
     uint4 b_x;
@@ -1048,12 +1303,14 @@ __kernel void cn1_tube(__global uint4 *Scratchpad, __global ulong *states, uint
         Scratchpad += gIdx * (MEMORY >> 4);
 #       elif (STRIDED_INDEX == 1)
 #       if (ALGO == CRYPTONIGHT_HEAVY)
-            Scratchpad += get_group_id(0) * (MEMORY >> 4) * WORKSIZE + get_local_id(0);
+            Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + get_local_id(0);
 #       else
             Scratchpad += gIdx;
 #       endif
 #       elif (STRIDED_INDEX == 2)
-        Scratchpad += get_group_id(0) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
+        Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
+#       elif (STRIDED_INDEX == 3)
+        Scratchpad += MEM_CHUNK * gIdx;
 #       endif
 
         a[0] = states[0] ^ states[4];
@@ -1115,17 +1372,23 @@ __kernel void cn1_tube(__global uint4 *Scratchpad, __global ulong *states, uint
     mem_fence(CLK_GLOBAL_MEM_FENCE);
 #   endif
 }
+#endif
 
 )==="
 R"===(
 
+#if HAS_KERNEL(1)
 __attribute__((reqd_work_group_size(WORKSIZE, 1, 1)))
-__kernel void cn1(__global uint4 *Scratchpad, __global ulong *states, uint variant, __global ulong *input, uint Threads)
+__kernel void cn1(__global uint4 *Scratchpad, __global ulong *states, uint variant, __global ulong *input, uint Threads, __global const volatile uint *Control, uint Generation)
 {
+#   ifdef VARIANT
+    variant = VARIANT;
+#   endif
+
     ulong a[2], b[2];
     __local uint AES0[256], AES1[256];
 
-    const ulong gIdx = getIdx();
+    const ulong gIdx = getCn1Idx();
 
     for (int i = get_local_id(0); i < 256; i += WORKSIZE) {
         const uint tmp = AES0_C[i];
@@ -1133,7 +1396,9 @@ __kernel void cn1(__global uint4 *Scratchpad, __global ulong *states, uint varia
         AES1[i] = rotate(tmp, 8U);
     }
 
+    STALE_LOAD();
     barrier(CLK_LOCAL_MEM_FENCE);
+    STALE_EXIT();
 
     uint4 b_x;
 #   if (COMP_MODE == 1)
@@ -1146,12 +1411,14 @@ __kernel void cn1(__global uint4 *Scratchpad, __global ulong *states, uint varia
         Scratchpad += gIdx * (MEMORY >> 4);
 #       elif (STRIDED_INDEX == 1)
 #       if (ALGO == CRYPTONIGHT_HEAVY)
-            Scratchpad += get_group_id(0) * (MEMORY >> 4) * WORKSIZE + get_local_id(0);
+            Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + get_local_id(0);
 #       else
             Scratchpad += gIdx;
 #       endif
 #       elif(STRIDED_INDEX == 2)
-        Scratchpad += get_group_id(0) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
+        Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
+#       elif (STRIDED_INDEX == 3)
+        Scratchpad += MEM_CHUNK * gIdx;
 #       endif
 
         a[0] = states[0] ^ states[4];
@@ -1210,18 +1477,20 @@ __kernel void cn1(__global uint4 *Scratchpad, __global ulong *states, uint varia
     }
     mem_fence(CLK_GLOBAL_MEM_FENCE);
 }
+#endif
 
 )==="
 R"===(
 
+#if HAS_KERNEL(9)
 __attribute__((reqd_work_group_size(WORKSIZE, 1, 1)))
-__kernel void cn1_xao(__global uint4 *Scratchpad, __global ulong *states, uint variant, __global ulong *input, uint Threads)
+__kernel void cn1_xao(__global uint4 *Scratchpad, __global ulong *states, uint variant, __global ulong *input, uint Threads, __global const volatile uint *Control, uint Generation)
 {
 #   if (ALGO == CRYPTONIGHT)
     ulong a[2], b[2];
     __local uint AES0[256], AES1[256];
 
-    const ulong gIdx = getIdx();
+    const ulong gIdx = getCn1Idx();
 
     for (int i = get_local_id(0); i < 256; i += WORKSIZE) {
         const uint tmp = AES0_C[i];
@@ -1229,7 +1498,9 @@ __kernel void cn1_xao(__global uint4 *Scratchpad, __global ulong *states, uint v
         AES1[i] = rotate(tmp, 8U);
     }
 
+    STALE_LOAD();
     barrier(CLK_LOCAL_MEM_FENCE);
+    STALE_EXIT();
 
     uint4 b_x;
 #   if (COMP_MODE == 1)
@@ -1242,12 +1513,14 @@ __kernel void cn1_xao(__global uint4 *Scratchpad, __global ulong *states, uint v
         Scratchpad += gIdx * (MEMORY >> 4);
 #       elif (STRIDED_INDEX == 1)
 #       if (ALGO == CRYPTONIGHT_HEAVY)
-            Scratchpad += get_group_id(0) * (MEMORY >> 4) * WORKSIZE + get_local_id(0);
+            Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + get_local_id(0);
 #       else
             Scratchpad += gIdx;
 #       endif
 #       elif(STRIDED_INDEX == 2)
-        Scratchpad += get_group_id(0) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
+        Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
+#       elif (STRIDED_INDEX == 3)
+        Scratchpad += MEM_CHUNK * gIdx;
 #       endif
 
         a[0] = states[0] ^ states[4];
@@ -1293,12 +1566,14 @@ __kernel void cn1_xao(__global uint4 *Scratchpad, __global ulong *states, uint v
     mem_fence(CLK_GLOBAL_MEM_FENCE);
 #   endif
 }
+#endif
 
 )==="
 R"===(
 
+#if HAS_KERNEL(2)
 __attribute__((reqd_work_group_size(8, 8, 1)))
-__kernel void cn2(__global uint4 *Scratchpad, __global ulong *states, __global uint *Branch0, __global uint *Branch1, __global uint *Branch2, __global uint *Branch3, uint Threads)
+__kernel void cn2(__global uint4 *Scratchpad, __global ulong *states, __global uint *Branch0, __global uint *Branch1, __global uint *Branch2, __global uint *Branch3, uint Threads, __global const volatile uint *Control, uint Generation)
 {
     __local uint AES0[256], AES1[256], AES2[256], AES3[256];
     uint ExpandedKey2[40];
@@ -1314,7 +1589,9 @@ __kernel void cn2(__global uint4 *Scratchpad, __global ulong *states, __global u
         AES3[i] = rotate(tmp, 24U);
     }
 
+    STALE_LOAD();
     barrier(CLK_LOCAL_MEM_FENCE);
+    STALE_EXIT();
 
 #   if (COMP_MODE == 1)
     // do not use early return here
@@ -1332,6 +1609,8 @@ __kernel void cn2(__global uint4 *Scratchpad, __global ulong *states, __global u
 #       endif
 #       elif (STRIDED_INDEX == 2)
         Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * (gIdx % WORKSIZE);
+#       elif (STRIDED_INDEX == 3)
+        Scratchpad += MEM_CHUNK * gIdx;
 #       endif
 
         #if defined(__Tahiti__) || defined(__Pitcairn__)
@@ -1367,10 +1646,22 @@ __kernel void cn2(__global uint4 *Scratchpad, __global ulong *states, __global u
 #   endif
     {
 #       if (ALGO == CRYPTONIGHT_HEAVY)
+        // the scratchpad loads of the next iteration are issued before the AES rounds of this one,
+        // implode does not write the scratchpad and the memory latency hides behind the rounds
+        uint4 next0 = Scratchpad[IDX((int)get_local_id(1))];
+        uint4 next1 = Scratchpad[IDX((int)get_local_id(1) + 8)];
+
         #pragma unroll 2
         for(int i = 0, i1 = get_local_id(1); i < (MEMORY >> 7); ++i, i1 = (i1 + 16) % (MEMORY >> 4))
         {
-            text ^= Scratchpad[IDX(i1)];
+            const uint4 chunk0 = next0;
+            const uint4 chunk1 = next1;
+            const int n1       = (i1 + 16) % (MEMORY >> 4);
+
+            next0 = Scratchpad[IDX(n1)];
+            next1 = Scratchpad[IDX(n1 + 8)];
+
+            text ^= chunk0;
             barrier(CLK_LOCAL_MEM_FENCE);
             text ^= *xin2_load;
 
@@ -1380,7 +1671,7 @@ __kernel void cn2(__global uint4 *Scratchpad, __global ulong *states, __global u
 
             *xin1_store = text;
 
-            text ^= Scratchpad[IDX(i1 + 8)];
+            text ^= chunk1;
             barrier(CLK_LOCAL_MEM_FENCE);
             text ^= *xin1_load;
 
@@ -1396,9 +1687,13 @@ __kernel void cn2(__global uint4 *Scratchpad, __global ulong *states, __global u
 
 #       else
         const uint local_id1 = get_local_id(1);
+        uint4 next           = Scratchpad[IDX(local_id1)];
+
+        // as above, the load of the next block is in flight during the AES rounds, the last one wraps around to block 0
         #pragma unroll 2
         for (uint i = 0; i < (MEMORY >> 7); ++i) {
-            text ^= Scratchpad[IDX((i << 3) + local_id1)];
+            text ^= next;
+            next  = Scratchpad[IDX((((i + 1) << 3) & ((MEMORY >> 4) - 1)) + local_id1)];
 
             #pragma unroll 10
             for(uint j = 0; j < 10; ++j)
@@ -1462,22 +1757,22 @@ __kernel void cn2(__global uint4 *Scratchpad, __global ulong *states, __global u
     }
     mem_fence(CLK_GLOBAL_MEM_FENCE);
 }
+#endif
 
 )==="
 R"===(
 
+#if HAS_KERNEL(3)
 #define VSWAP8(x)   (((x) >> 56) | (((x) >> 40) & 0x000000000000FF00UL) | (((x) >> 24) & 0x0000000000FF0000UL) \
           | (((x) >>  8) & 0x00000000FF000000UL) | (((x) <<  8) & 0x000000FF00000000UL) \
           | (((x) << 24) & 0x0000FF0000000000UL) | (((x) << 40) & 0x00FF000000000000UL) | (((x) << 56) & 0xFF00000000000000UL))
 
 #define VSWAP4(x)   ((((x) >> 24) & 0xFFU) | (((x) >> 8) & 0xFF00U) | (((x) << 8) & 0xFF0000U) | (((x) << 24) & 0xFF000000U))
 
-__kernel void Skein(__global ulong *states, __global uint *BranchBuf, __global uint *output, ulong Target, uint Threads)
+inline void skein_final(__global ulong *states, __global uint *BranchBuf, __global uint *output, ulong Target, uint Threads, uint idx, uint offset)
 {
-    const uint idx = get_global_id(0) - get_global_offset(0);
-
     // do not use early return here
-    if(idx < Threads)
+    if (idx < BranchBuf[Threads])
     {
         states += 25 * BranchBuf[idx];
 
@@ -1520,9 +1815,10 @@ __kernel void Skein(__global ulong *states, __global uint *BranchBuf, __global u
         // Note that comparison is equivalent to subtraction - we can't just compare 8 32-bit values
         // and expect an accurate result for target > 32-bit without implementing carries
         if (p.s3 <= Target) {
-            ulong outIdx = atomic_inc(output + 0xFF);
-            if (outIdx < 0xFF) {
-                output[outIdx] = BranchBuf[idx] + (uint) get_global_offset(0);
+            ulong outIdx = atomic_inc(output + RESULT_SLOTS);
+            if (outIdx < RESULT_SLOTS) {
+                output[outIdx] = BranchBuf[idx] + offset;
+                vstore4((ulong4)(p.s0, p.s1, p.s2, p.s3), outIdx, (__global ulong *)(output + RESULT_SLOTS + 1));
             }
         }
     }
@@ -1552,12 +1848,10 @@ __kernel void Skein(__global ulong *states, __global uint *BranchBuf, __global u
     h7h ^= input[6]; \
     h7l ^= input[7]
 
-__kernel void JH(__global ulong *states, __global uint *BranchBuf, __global uint *output, ulong Target, uint Threads)
+inline void jh_final(__global ulong *states, __global uint *BranchBuf, __global uint *output, ulong Target, uint Threads, uint idx, uint offset)
 {
-    const uint idx = get_global_id(0) - get_global_offset(0);
-
     // do not use early return here
-    if(idx < Threads)
+    if (idx < BranchBuf[Threads])
     {
         states += 25 * BranchBuf[idx];
 
@@ -1589,9 +1883,10 @@ __kernel void JH(__global ulong *states, __global uint *BranchBuf, __global uint
         // Note that comparison is equivalent to subtraction - we can't just compare 8 32-bit values
         // and expect an accurate result for target > 32-bit without implementing carries
         if (h7l <= Target) {
-            ulong outIdx = atomic_inc(output + 0xFF);
-            if (outIdx < 0xFF) {
-                output[outIdx] = BranchBuf[idx] + (uint) get_global_offset(0);
+            ulong outIdx = atomic_inc(output + RESULT_SLOTS);
+            if (outIdx < RESULT_SLOTS) {
+                output[outIdx] = BranchBuf[idx] + offset;
+                vstore4((ulong4)(h6h, h6l, h7h, h7l), outIdx, (__global ulong *)(output + RESULT_SLOTS + 1));
             }
         }
     }
@@ -1599,12 +1894,10 @@ __kernel void JH(__global ulong *states, __global uint *BranchBuf, __global uint
 
 #define SWAP4(x)    as_uint(as_uchar4(x).s3210)
 
-__kernel void Blake(__global ulong *states, __global uint *BranchBuf, __global uint *output, ulong Target, uint Threads)
+inline void blake_final(__global ulong *states, __global uint *BranchBuf, __global uint *output, ulong Target, uint Threads, uint idx, uint offset)
 {
-    const uint idx = get_global_id(0) - get_global_offset(0);
-
     // do not use early return here
-    if (idx < Threads)
+    if (idx < BranchBuf[Threads])
     {
         states += 25 * BranchBuf[idx];
 
@@ -1689,9 +1982,10 @@ __kernel void Blake(__global ulong *states, __global uint *BranchBuf, __global u
         // and expect an accurate result for target > 32-bit without implementing carries
         uint2 t = (uint2)(h[6],h[7]);
         if (as_ulong(t) <= Target) {
-            ulong outIdx = atomic_inc(output + 0xFF);
-            if (outIdx < 0xFF) {
-                output[outIdx] = BranchBuf[idx] + (uint) get_global_offset(0);
+            ulong outIdx = atomic_inc(output + RESULT_SLOTS);
+            if (outIdx < RESULT_SLOTS) {
+                output[outIdx] = BranchBuf[idx] + offset;
+                vstore8(((uint8 *)h)[0], outIdx, output + RESULT_SLOTS + 1);
             }
         }
     }
@@ -1700,12 +1994,10 @@ __kernel void Blake(__global ulong *states, __global uint *BranchBuf, __global u
 #undef SWAP4
 
 
-__kernel void Groestl(__global ulong *states, __global uint *BranchBuf, __global uint *output, ulong Target, uint Threads)
+inline void groestl_final(__global ulong *states, __global uint *BranchBuf, __global uint *output, ulong Target, uint Threads, uint idx, uint offset)
 {
-    const uint idx = get_global_id(0) - get_global_offset(0);
-
     // do not use early return here
-    if (idx < Threads)
+    if (idx < BranchBuf[Threads])
     {
         states += 25 * BranchBuf[idx];
 
@@ -1757,12 +2049,46 @@ __kernel void Groestl(__global ulong *states, __global uint *BranchBuf, __global
         // Note that comparison is equivalent to subtraction - we can't just compare 8 32-bit values
         // and expect an accurate result for target > 32-bit without implementing carries
         if (State[7] <= Target) {
-            ulong outIdx = atomic_inc(output + 0xFF);
-            if (outIdx < 0xFF) {
-                output[outIdx] = BranchBuf[idx] + (uint) get_global_offset(0);
+            ulong outIdx = atomic_inc(output + RESULT_SLOTS);
+            if (outIdx < RESULT_SLOTS) {
+                output[outIdx] = BranchBuf[idx] + offset;
+                vstore4((ulong4)(State[4], State[5], State[6], State[7]), outIdx, (__global ulong *)(output + RESULT_SLOTS + 1));
             }
         }
     }
 }
 
+// final hashes of all 4 branches in one launch, the global size is Threads rounded up to the work group size:
+// the entries of the 4 branch lists are numbered one after another, so every work item (except the tail of
+// the last work group) has a hash to finish and only the 3 work groups at the list boundaries diverge
+__kernel void Finalize(__global ulong *states, __global uint *Branch0, __global uint *Branch1, __global uint *Branch2, __global uint *Branch3, __global uint *output, ulong Target, uint Threads)
+{
+    const uint offset = (uint) get_global_offset(0);
+    const uint count0 = Branch0[Threads];
+    const uint count1 = Branch1[Threads];
+    const uint count2 = Branch2[Threads];
+    uint idx          = get_global_id(0) - get_global_offset(0);
+
+    if (idx < count0) {
+        blake_final(states, Branch0, output, Target, Threads, idx, offset);
+        return;
+    }
+
+    idx -= count0;
+    if (idx < count1) {
+        groestl_final(states, Branch1, output, Target, Threads, idx, offset);
+        return;
+    }
+
+    idx -= count1;
+    if (idx < count2) {
+        jh_final(states, Branch2, output, Target, Threads, idx, offset);
+        return;
+    }
+
+    // skein_final checks idx against Branch3[Threads] itself
+    skein_final(states, Branch3, output, Target, Threads, idx - count2, offset);
+}
+#endif
+
 )==="
@@ -1,5 +1,26 @@
 R"===(
 
+/* CN_GPU_SHUFFLE is set by the host when the device has cl_khr_subgroup_shuffle (1) or the amdgcn wave intrinsics of
+ * the ROCm compiler (2) and sub-groups of a multiple of 16 lanes, the reductions of cn1_cn_gpu then exchange values
+ * in registers instead of local memory */
+#ifndef CN_GPU_SHUFFLE
+#   define CN_GPU_SHUFFLE 0
+#endif
+
+#if (CN_GPU_SHUFFLE == 1)
+#   pragma OPENCL EXTENSION cl_khr_subgroups : enable
+#   pragma OPENCL EXTENSION cl_khr_subgroup_shuffle : enable
+
+inline uint shuffle_lane()                      { return get_sub_group_local_id(); }
+inline int shuffle_int(int v, uint lane)        { return sub_group_shuffle(v, lane); }
+inline float shuffle_float(float v, uint lane)  { return sub_group_shuffle(v, lane); }
+#elif (CN_GPU_SHUFFLE == 2)
+// work items of a work group fill the wavefront lanes in order, ds_bpermute addresses the source lane in bytes
+inline uint shuffle_lane()                      { return __builtin_amdgcn_mbcnt_hi(~0U, __builtin_amdgcn_mbcnt_lo(~0U, 0U)); }
+inline int shuffle_int(int v, uint lane)        { return __builtin_amdgcn_ds_bpermute((int)(lane << 2), v); }
+inline float shuffle_float(float v, uint lane)  { return as_float(__builtin_amdgcn_ds_bpermute((int)(lane << 2), as_int(v))); }
+#endif
+
 
 inline float4 _mm_add_ps(float4 a, float4 b)
 {
@@ -117,7 +138,7 @@ inline void round_compute(float4 n0, float4 n1, float4 n2, float4 n3, float4 rnd
     *r =_mm_add_ps(*r, _mm_div_ps(n,d));
 }
 
-inline int4 single_comupte(float4 n0, float4 n1, float4 n2, float4 n3, float cnt, float4 rnd_c, __local float4* sum)
+inline int4 single_comupte(float4 n0, float4 n1, float4 n2, float4 n3, float cnt, float4 rnd_c, float4* sum)
 {
     float4 c= (float4)(cnt);
     // 35 maths calls follow (140 FLOPS)
@@ -135,7 +156,7 @@ inline int4 single_comupte(float4 n0, float4 n1, float4 n2, float4 n3, float cnt
     return convert_int4_rte(r);
 }
 
-inline void single_comupte_wrap(const uint rot, int4 v0, int4 v1, int4 v2, int4 v3, float cnt, float4 rnd_c, __local float4* sum, __local int4* out)
+inline void single_comupte_wrap(const uint rot, int4 v0, int4 v1, int4 v2, int4 v3, float cnt, float4 rnd_c, float4* sum, int4* out)
 {
     float4 n0 = convert_float4_rte(v0);
     float4 n1 = convert_float4_rte(v1);
@@ -199,6 +220,7 @@ struct SharedMemChunk
     float4 va[16];
 };
 
+#if HAS_KERNEL(15)
 __attribute__((reqd_work_group_size(WORKSIZE_GPU * 16, 1, 1)))
 __kernel void cn1_cn_gpu(__global int *lpad_in, __global int *spad, uint numThreads)
 {
@@ -237,17 +259,53 @@ __kernel void cn1_cn_gpu(__global int *lpad_in, __global int *spad, uint numThre
         ((__local int*)(smem->out))[tid] = tmp;
         mem_fence(CLK_LOCAL_MEM_FENCE);
 
-        {
-            single_comupte_wrap(
-                tidm,
-                *(smem->out + look[tid][0]),
-                *(smem->out + look[tid][1]),
-                *(smem->out + look[tid][2]),
-                *(smem->out + look[tid][3]),
-                ccnt[tid], vs, smem->va + tid,
-                smem->out + tid
-            );
-        }
+        float4 va;
+        int4 out;
+        single_comupte_wrap(
+            tidm,
+            *(smem->out + look[tid][0]),
+            *(smem->out + look[tid][1]),
+            *(smem->out + look[tid][2]),
+            *(smem->out + look[tid][3]),
+            ccnt[tid], vs, &va, &out
+        );
+
+#       if (CN_GPU_SHUFFLE != 0)
+        // the same sums in the same order as below: (a + b) + (c + d), float addition is commutative,
+        // lanes tid ^ 1 and tid ^ 2 are the other lanes of the quad, tid ^ 4 and tid ^ 8 of the column
+        const uint lane = shuffle_lane();
+        const uint l1   = lane ^ 1;
+        const uint l2   = lane ^ 2;
+
+        int4 ox   = out ^ (int4)(shuffle_int(out.x, l1), shuffle_int(out.y, l1), shuffle_int(out.z, l1), shuffle_int(out.w, l1));
+        float4 vx = va + (float4)(shuffle_float(va.x, l1), shuffle_float(va.y, l1), shuffle_float(va.z, l1), shuffle_float(va.w, l1));
+        ox ^= (int4)(shuffle_int(ox.x, l2), shuffle_int(ox.y, l2), shuffle_int(ox.z, l2), shuffle_int(ox.w, l2));
+        vx += (float4)(shuffle_float(vx.x, l2), shuffle_float(vx.y, l2), shuffle_float(vx.z, l2), shuffle_float(vx.w, l2));
+
+        const int outXor = tidm == 0 ? ox.x : (tidm == 1 ? ox.y : (tidm == 2 ? ox.z : ox.w));
+        float va_tmp1    = tidm == 0 ? vx.x : (tidm == 1 ? vx.y : (tidm == 2 ? vx.z : vx.w));
+
+        ((__global int*)scratchpad_ptr(s, tidd, lpad))[tidm] = outXor ^ tmp;
+
+        int out2 = outXor ^ shuffle_int(outXor, lane ^ 4);
+        va_tmp1  = va_tmp1 + shuffle_float(va_tmp1, lane ^ 4);
+        out2    ^= shuffle_int(out2, lane ^ 8);
+        va_tmp1  = va_tmp1 + shuffle_float(va_tmp1, lane ^ 8);
+        va_tmp1  = fabs(va_tmp1);
+
+        float xx   = va_tmp1 * 16777216.0f;
+        int xx_int = (int)xx;
+        out2       = out2 ^ xx_int;
+        va_tmp1    = va_tmp1 / 64.0f;
+
+        // lanes 0-3 of the 16 hold the results the next iteration uses
+        const uint lane0 = lane & ~15U;
+
+        vs = (float4)(shuffle_float(va_tmp1, lane0), shuffle_float(va_tmp1, lane0 + 1), shuffle_float(va_tmp1, lane0 + 2), shuffle_float(va_tmp1, lane0 + 3));
+        s  = shuffle_int(out2, lane0) ^ shuffle_int(out2, lane0 + 1) ^ shuffle_int(out2, lane0 + 2) ^ shuffle_int(out2, lane0 + 3);
+#       else
+        smem->va[tid]  = va;
+        smem->out[tid] = out;
         mem_fence(CLK_LOCAL_MEM_FENCE);
 
         int outXor = ((__local int*)smem->out)[block];
@@ -278,8 +336,10 @@ __kernel void cn1_cn_gpu(__global int *lpad_in, __global int *spad, uint numThre
 
         vs = smem->va[0];
         s = smem->out[0].x ^ smem->out[0].y ^ smem->out[0].z ^ smem->out[0].w;
+#       endif
     }
 }
+#endif
 
 )==="
 R"===(
@@ -305,10 +365,16 @@ inline void generate_512(uint idx, __local ulong* in, __global ulong* out)
     }
 }
 
+#if HAS_KERNEL(13)
 __attribute__((reqd_work_group_size(8, 8, 1)))
-__kernel void cn0_cn_gpu(__global ulong *input, __global int *Scratchpad, __global ulong *states, uint Threads)
+__kernel void cn0_cn_gpu(__global ulong *input, __global int *Scratchpad, __global ulong *states, uint Threads, __global uint *output)
 {
     const uint gIdx = getIdx();
+
+    // reset the results counter, cn2_cn_gpu runs only after this kernel is complete
+    if (gIdx == 0 && get_global_id(1) == get_global_offset(1)) {
+        output[RESULT_SLOTS] = 0;
+    }
     __local ulong State_buf[8 * 25];
     __local ulong* State = State_buf + get_local_id(0) * 25;
 
@@ -361,7 +427,9 @@ __kernel void cn0_cn_gpu(__global ulong *input, __global int *Scratchpad, __glob
         }
     }
 }
+#endif
 
+#if HAS_KERNEL(14)
 __attribute__((reqd_work_group_size(64, 1, 1)))
 __kernel void cn00_cn_gpu(__global int *Scratchpad, __global ulong *states)
 {
@@ -383,7 +451,9 @@ __kernel void cn00_cn_gpu(__global int *Scratchpad, __global ulong *states)
         generate_512(i, State, (__global ulong*)((__global uchar*)Scratchpad + i*512));
     }
 }
+#endif
 
+#if HAS_KERNEL(16)
 __attribute__((reqd_work_group_size(8, 8, 1)))
 __kernel void cn2_cn_gpu(__global uint4 *Scratchpad, __global ulong *states, __global uint *output, ulong Target, uint Threads)
 {
@@ -514,13 +584,16 @@ __kernel void cn2_cn_gpu(__global uint4 *Scratchpad, __global ulong *states, __g
 
             if(State[3] <= Target)
             {
-                ulong outIdx = atomic_inc(output + 0xFF);
-                if(outIdx < 0xFF)
+                ulong outIdx = atomic_inc(output + RESULT_SLOTS);
+                if(outIdx < RESULT_SLOTS) {
                     output[outIdx] = get_global_id(0);
+                    vstore4((ulong4)(State[0], State[1], State[2], State[3]), outIdx, (__global ulong *)(output + RESULT_SLOTS + 1));
+                }
             }
         }
     }
     mem_fence(CLK_GLOBAL_MEM_FENCE);
 }
+#endif
 
 )==="
@@ -4,24 +4,54 @@ R"===(
 
 #define MEM_CHUNK (1 << MEM_CHUNK_EXPONENT)
 
+// rotations of the generated random math, rotate() is a left rotation so a right rotation
+// costs an extra subtraction on the critical path, GCN and RDNA do it with a single bitalign
+#if defined(cl_amd_media_ops) && !defined(RANDOM_MATH_64_BIT)
+#   pragma OPENCL EXTENSION cl_amd_media_ops : enable
+#   define RANDOM_MATH_ROR(x, n) amd_bitalign((x), (x), (n))
+#else
+#   define RANDOM_MATH_ROR(x, n) rotate((x), ROT_BITS - (n))
+#endif
+#define RANDOM_MATH_ROL(x, n) rotate((x), (n))
+
+// see cryptonight.cl, batches of a replaced job of a persistent thread leave early
+#define STALE_LOAD() \
+    __local uint stale; \
+    if (get_local_id(0) == 0 && get_local_id(1) == 0) { \
+        stale = Control[0] != Generation; \
+    }
+
+#define STALE_EXIT() \
+    if (stale) { \
+        return; \
+    }
+
 __attribute__((reqd_work_group_size(WORKSIZE, 1, 1)))
-__kernel void cn1_cryptonight_r(__global uint4 *Scratchpad, __global ulong *states, uint variant, __global ulong *input, uint Threads)
+__kernel void cn1_cryptonight_r(__global uint4 *Scratchpad, __global ulong *states, uint variant, __global ulong *input, uint Threads, __global const volatile uint *Control, uint Generation)
 {
     ulong a[2], b[4];
+#   if (AES_TABLES == 2)
+    __local uint AES0[256], AES1[256];
+#   else
     __local uint AES0[256], AES1[256], AES2[256], AES3[256];
+#   endif
     
-    const ulong gIdx = get_global_id(0) - get_global_offset(0);
+    const ulong gIdx = get_global_id(0) - get_global_offset(0) + get_global_offset(1);
 
     for(int i = get_local_id(0); i < 256; i += WORKSIZE)
     {
         const uint tmp = AES0_C[i];
         AES0[i] = tmp;
         AES1[i] = rotate(tmp, 8U);
+#       if (AES_TABLES == 4)
         AES2[i] = rotate(tmp, 16U);
         AES3[i] = rotate(tmp, 24U);
+#       endif
     }
 
+    STALE_LOAD();
     barrier(CLK_LOCAL_MEM_FENCE);
+    STALE_EXIT();
 
 #   if (COMP_MODE == 1)
     // do not use early return here
@@ -38,7 +68,9 @@ __kernel void cn1_cryptonight_r(__global uint4 *Scratchpad, __global ulong *stat
 #           elif (STRIDED_INDEX == 1)
                 Scratchpad += gIdx;
 #           elif (STRIDED_INDEX == 2)
-                Scratchpad += get_group_id(0) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
+                Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
+#           elif (STRIDED_INDEX == 3)
+                Scratchpad += MEM_CHUNK * gIdx;
 #           endif
 #       endif
 
@@ -67,6 +99,8 @@ __kernel void cn1_cryptonight_r(__global uint4 *Scratchpad, __global ulong *stat
 #           define SCRATCHPAD_CHUNK(N) (*(__global uint4*)((__global uchar*)(Scratchpad) + mul24(as_uint(idx ^ (N << 4)), Threads)))
 #       elif (STRIDED_INDEX == 2)
 #           define SCRATCHPAD_CHUNK(N) (*(__global uint4*)((__global uchar*)(Scratchpad) + (((idx ^ (N << 4)) % (MEM_CHUNK << 4)) + ((idx ^ (N << 4)) / (MEM_CHUNK << 4)) * WORKSIZE * (MEM_CHUNK << 4))))
+#       elif (STRIDED_INDEX == 3)
+#           define SCRATCHPAD_CHUNK(N) (*(__global uint4*)((__global uchar*)(Scratchpad) + (((idx ^ (N << 4)) % (MEM_CHUNK << 4)) + (ulong)((idx ^ (N << 4)) / (MEM_CHUNK << 4)) * (Threads * (MEM_CHUNK << 4)))))
 #       endif
 #   endif
 
@@ -100,7 +134,11 @@ __kernel void cn1_cryptonight_r(__global uint4 *Scratchpad, __global ulong *stat
 #       endif
 
         uint4 c = SCRATCHPAD_CHUNK(0);
+#       if (AES_TABLES == 2)
+        c = AES_Round_Two_Tables(AES0, AES1, c, ((uint4 *)a)[0]);
+#       else
         c = AES_Round(AES0, AES1, AES2, AES3, c, ((uint4 *)a)[0]);
+#       endif
 
         {
             const ulong2 chunk1 = as_ulong2(SCRATCHPAD_CHUNK(1));
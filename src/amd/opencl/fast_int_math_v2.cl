@@ -33,6 +33,8 @@ inline uint fast_sqrt_v2(const ulong n1)
 {
     float x = as_float((as_uint2(n1).s1 >> 9) + ((64U + 127U) << 23));
 
+    // x must be the correctly rounded root, the fixup below only corrects the result by 1:
+    // x * native_rsqrt(x) saves a transcendental but already fails for inputs like 0 and 1
     float x1 = native_rsqrt(x);
     x = native_sqrt(x);
 
@@ -115,6 +115,11 @@ static const __constant uint AES0_C[256] =
 
 #define BYTE(x, y) (xmrig_amd_bfe((x), (y) << 3U, 8U))
 
+// number of AES tables the cn1 kernels keep in local memory, with 2 the other two are rotations of them
+#ifndef AES_TABLES
+#   define AES_TABLES 4
+#endif
+
 inline uint4 AES_Round_bittube2(const __local uint *AES0, const __local uint *AES1, uint4 x, uint4 k)
 {
     x = ~x;
@@ -22,8 +22,13 @@
  *   along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <inttypes.h>
 #include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
 #include <string.h>
+#include <string>
 #include <uv.h>
 
 #if _WIN32
@@ -33,24 +38,45 @@
 #endif
 
 
+#include "amd/GpuContext.h"
+#include "amd/GpuMemory.h"
+#include "amd/GpuTelemetry.h"
+#include "amd/OclCache.h"
+#include "amd/OclDiagnostics.h"
+#include "amd/OclLib.h"
 #include "api/ApiRouter.h"
 #include "common/api/HttpReply.h"
 #include "common/api/HttpRequest.h"
 #include "common/cpu/Cpu.h"
 #include "common/crypto/keccak.h"
+#include "common/net/ClientStats.h"
 #include "common/net/Job.h"
 #include "common/Platform.h"
 #include "core/Config.h"
 #include "core/Controller.h"
+#include "core/History.h"
+#include "core/LogSummary.h"
+#include "core/LoopMonitor.h"
+#include "core/StartupProfile.h"
+#include "crypto/CryptoNight_constants.h"
 #include "interfaces/IThread.h"
 #include "rapidjson/document.h"
 #include "rapidjson/prettywriter.h"
 #include "rapidjson/stringbuffer.h"
 #include "version.h"
+#include "workers/Benchmark.h"
+#include "workers/Canary.h"
+#include "workers/EffectiveRate.h"
 #include "workers/Hashrate.h"
+#include "workers/OclThread.h"
+#include "workers/OclWorker.h"
 #include "workers/Workers.h"
 
 
+// µs, from a fast callback to a stall which delays shares noticeably
+static const uint32_t kLoopBounds[] = { 50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 1000000 };
+
+
 static inline double normalize(double d)
 {
     if (!isnormal(d)) {
@@ -61,6 +87,152 @@ static inline double normalize(double d)
 }
 
 
+static rapidjson::Value rates(const Hashrate::Rates &rates, rapidjson::Document &doc)
+{
+    rapidjson::Value value(rapidjson::kArrayType);
+    for (double rate : rates.values) {
+        value.PushBack(normalize(rate), doc.GetAllocator());
+    }
+
+    return value;
+}
+
+
+// {"temperature": C, "power": W, "fan": RPM, "clock": MHz, "memory_clock": MHz, "hashes_per_joule": H/J},
+// sensors the GPU doesn't report are null, the thermal control of Workers adds its duty cycle
+static rapidjson::Value sensors(const GpuSensors &sensors, double hashrate, rapidjson::Document &doc)
+{
+    auto &allocator = doc.GetAllocator();
+    const double efficiency = sensors.hashesPerJoule(hashrate);
+
+    rapidjson::Value value(rapidjson::kObjectType);
+    value.AddMember("temperature",      sensors.temperature >= 0.0 ? rapidjson::Value(sensors.temperature) : rapidjson::Value(rapidjson::kNullType), allocator);
+    value.AddMember("power",            sensors.power >= 0.0 ? rapidjson::Value(sensors.power) : rapidjson::Value(rapidjson::kNullType), allocator);
+    value.AddMember("fan",              sensors.fan >= 0 ? rapidjson::Value(sensors.fan) : rapidjson::Value(rapidjson::kNullType), allocator);
+    value.AddMember("clock",            sensors.clock >= 0 ? rapidjson::Value(sensors.clock) : rapidjson::Value(rapidjson::kNullType), allocator);
+    value.AddMember("memory_clock",     sensors.memoryClock >= 0 ? rapidjson::Value(sensors.memoryClock) : rapidjson::Value(rapidjson::kNullType), allocator);
+    value.AddMember("gfx_busy",         sensors.gfxBusy >= 0.0 ? rapidjson::Value(sensors.gfxBusy) : rapidjson::Value(rapidjson::kNullType), allocator);
+    value.AddMember("memory_busy",      sensors.memoryBusy >= 0.0 ? rapidjson::Value(sensors.memoryBusy) : rapidjson::Value(rapidjson::kNullType), allocator);
+    value.AddMember("hashes_per_joule", efficiency > 0.0 ? rapidjson::Value(normalize(efficiency)) : rapidjson::Value(rapidjson::kNullType), allocator);
+
+    return value;
+}
+
+
+// {"hashrate": H/s, "lower": H/s, "upper": H/s, "reported": H/s, "low": bool, ...} of the last hour of mining,
+// hashrates are null before the first pool share, see EffectiveRate
+static rapidjson::Value effective(const xmrig::EffectiveRate::Estimate &estimate, rapidjson::Document &doc)
+{
+    auto &allocator  = doc.GetAllocator();
+    const bool valid = estimate.window > 0;
+
+    rapidjson::Value value(rapidjson::kObjectType);
+    value.AddMember("hashrate",      valid ? rapidjson::Value(normalize(estimate.effective)) : rapidjson::Value(rapidjson::kNullType), allocator);
+    value.AddMember("lower",         valid ? rapidjson::Value(normalize(estimate.lower)) : rapidjson::Value(rapidjson::kNullType), allocator);
+    value.AddMember("upper",         valid ? rapidjson::Value(normalize(estimate.upper)) : rapidjson::Value(rapidjson::kNullType), allocator);
+    value.AddMember("reported",      valid ? rapidjson::Value(normalize(estimate.reported)) : rapidjson::Value(rapidjson::kNullType), allocator);
+    value.AddMember("shares",        estimate.shares, allocator);
+    value.AddMember("rejected",      estimate.rejected, allocator);
+    value.AddMember("accepted_diff", estimate.accepted, allocator);
+    value.AddMember("rejected_diff", estimate.rejectedDiff, allocator);
+    value.AddMember("window",        estimate.window / 1000, allocator);
+    value.AddMember("low",           estimate.low, allocator);
+
+    return value;
+}
+
+
+// [{"index": GPU index, "hashrate": [10s, 60s, 15m], "sensors": {...}}, ...], sensors only for the current algo
+// and GPUs with telemetry, the efficiency uses the 60s hashrate
+static rapidjson::Value devices(const Hashrate::AlgoHistory &history, rapidjson::Document &doc, bool current = false)
+{
+    auto &allocator = doc.GetAllocator();
+
+    rapidjson::Value list(rapidjson::kArrayType);
+    for (const auto &device : history.devices) {
+        rapidjson::Value value(rapidjson::kObjectType);
+        value.AddMember("index",    static_cast<uint64_t>(device.first), allocator);
+        value.AddMember("hashrate", rates(device.second, doc), allocator);
+
+        const GpuSensors gpu = current ? GpuTelemetry::sensors(device.first) : GpuSensors();
+        if (gpu.isValid()) {
+            rapidjson::Value readings = sensors(gpu, device.second.values[1], doc);
+            Workers::deviceThermal(device.first, readings, doc);
+
+            value.AddMember("sensors", readings, allocator);
+        }
+
+        if (current) {
+            Workers::deviceErrors(device.first, value, doc);
+            Workers::deviceStability(device.first, value, doc);
+            value.AddMember("effective", effective(xmrig::EffectiveRate::estimate(device.first), doc), allocator);
+        }
+
+        list.PushBack(value, allocator);
+    }
+
+    return list;
+}
+
+
+// [{"name": entry point or thread, "calls": N, "slow": N, "total_ms": ms, "avg_ms": ms, "max_ms": ms}, ...]
+static rapidjson::Value callStats(const std::vector<OclCallStats> &stats, rapidjson::Document &doc)
+{
+    auto &allocator = doc.GetAllocator();
+
+    rapidjson::Value list(rapidjson::kArrayType);
+    for (const OclCallStats &call : stats) {
+        rapidjson::Value value(rapidjson::kObjectType);
+        value.AddMember("name",     rapidjson::Value(call.name, allocator), allocator);
+        value.AddMember("calls",    call.calls, allocator);
+        value.AddMember("slow",     call.slow, allocator);
+        value.AddMember("total_ms", static_cast<double>(call.time) / 1e6, allocator);
+        value.AddMember("avg_ms",   call.calls ? static_cast<double>(call.time) / call.calls / 1e6 : 0.0, allocator);
+        value.AddMember("max_ms",   static_cast<double>(call.max) / 1e6, allocator);
+
+        list.PushBack(value, allocator);
+    }
+
+    return list;
+}
+
+
+static void append(std::string &out, const char *format, ...)
+{
+    char buf[512];
+
+    va_list args;
+    va_start(args, format);
+    const int size = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+
+    if (size > 0) {
+        out.append(buf, std::min(static_cast<size_t>(size), sizeof(buf) - 1));
+    }
+}
+
+
+// label values escape backslash, double quote and line feed
+static std::string label(const char *value)
+{
+    std::string out;
+    for (const char *c = value; *c; ++c) {
+        if (*c == '\\' || *c == '"') {
+            out += '\\';
+            out += *c;
+        }
+        else if (*c == '\n') {
+            out += "\\n";
+        }
+        else {
+            out += *c;
+        }
+    }
+
+    return out;
+}
+
+
 ApiRouter::ApiRouter(xmrig::Controller *controller) :
     m_controller(controller)
 {
@@ -78,6 +250,7 @@ ApiRouter::~ApiRouter()
 
 void ApiRouter::ApiRouter::get(const xmrig::HttpRequest &req, xmrig::HttpReply &reply) const
 {
+    xmrig::LoopMonitor::Scope scope(xmrig::LoopMonitor::ApiReply);
     rapidjson::Document doc;
 
     if (req.match("/1/config")) {
@@ -92,20 +265,82 @@ void ApiRouter::ApiRouter::get(const xmrig::HttpRequest &req, xmrig::HttpReply &
     }
 
     if (req.match("/1/threads")) {
-        getThreads(doc);
+        return cached(req, reply, m_threads, &ApiRouter::getThreads);
+    }
+
+    if (req.match("/1/metrics")) {
+        return getMetrics(reply);
+    }
+
+    if (req.match("/1/benchmark")) {
+        if (!m_controller->benchmark()) {
+            reply.status = 404;
+            return;
+        }
+
+        m_controller->benchmark()->get_status(doc);
 
         return finalize(reply, doc);
     }
 
-    doc.SetObject();
+    if (req.match("/1/canary")) {
+        xmrig::Canary::toJSON(doc);
 
-    getIdentify(doc);
-    getMiner(doc);
-    getHashrate(doc);
-    getResults(doc);
-    getConnection(doc);
+        return finalize(reply, doc);
+    }
+
+    if (req.match("/1/diagnostics")) {
+        xmrig::OclDiagnostics::toJSON(doc);
+
+        return finalize(reply, doc);
+    }
+
+    if (req.match("/1/startup")) {
+        getStartup(doc);
+
+        return finalize(reply, doc);
+    }
+
+    if (req.match("/1/connections")) {
+        getConnections(doc);
+
+        return finalize(reply, doc);
+    }
+
+    if (req.match("/1/history")) {
+        return getHistory(reply);
+    }
+
+    if (req.match("/1/log")) {
+        getLog(doc);
+
+        return finalize(reply, doc);
+    }
+
+    if (req.match("/1/loop")) {
+        getLoop(doc);
+
+        return finalize(reply, doc);
+    }
+
+    if (req.match("/1/memory")) {
+        getMemory(doc);
+
+        return finalize(reply, doc);
+    }
+
+    if (req.match("/1/opencl")) {
+        if (!OclLib::isTrace()) {
+            reply.status = 404;
+            return;
+        }
+
+        getOpenCL(doc);
 
-    return finalize(reply, doc);
+        return finalize(reply, doc);
+    }
+
+    cached(req, reply, m_summary, &ApiRouter::getSummary);
 }
 
 
@@ -116,6 +351,18 @@ void ApiRouter::exec(const xmrig::HttpRequest &req, xmrig::HttpReply &reply)
         return;
     }
 
+    if (req.method() == xmrig::HttpRequest::Put && req.match("/1/benchmark")) {
+        return startBenchmark(req, reply);
+    }
+
+    if (req.method() == xmrig::HttpRequest::Put && req.match("/1/diagnostics")) {
+        return startDiagnostics(req, reply);
+    }
+
+    if (req.method() == xmrig::HttpRequest::Patch && strncmp(req.url(), "/1/threads/", 11) == 0) {
+        return patchThread(req, reply);
+    }
+
     reply.status = 404;
 }
 
@@ -123,6 +370,9 @@ void ApiRouter::exec(const xmrig::HttpRequest &req, xmrig::HttpReply &reply)
 void ApiRouter::tick(const xmrig::NetworkState &network)
 {
     m_network = network;
+
+    m_summary.valid = false;
+    m_threads.valid = false;
 }
 
 
@@ -132,6 +382,44 @@ void ApiRouter::onConfigChanged(xmrig::Config *config, xmrig::Config *previousCo
 }
 
 
+// any number of requests between two ticks share one build, a matching If-None-Match gets 304 without a body
+void ApiRouter::cached(const xmrig::HttpRequest &req, xmrig::HttpReply &reply, Snapshot &snapshot, void (ApiRouter::*build)(rapidjson::Document &doc) const) const
+{
+    if (!snapshot.valid) {
+        rapidjson::Document doc;
+        (this->*build)(doc);
+
+        rapidjson::StringBuffer buffer(nullptr, 4096);
+        rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+        writer.SetMaxDecimalPlaces(10);
+        doc.Accept(writer);
+
+        snapshot.body.assign(buffer.GetString(), buffer.GetSize());
+        snapshot.valid = true;
+
+        // FNV-1a of the payload, an unchanged payload keeps its tag across ticks
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (const char c : snapshot.body) {
+            hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3ULL;
+        }
+
+        snprintf(snapshot.etag, sizeof(snapshot.etag), "\"%016" PRIx64 "\"", hash);
+    }
+
+    reply.etag = snapshot.etag;
+
+    const char *match = req.header("If-None-Match");
+    if (match && strcmp(match, snapshot.etag) == 0) {
+        reply.status = 304;
+        return;
+    }
+
+    reply.status = 200;
+    reply.buf    = strdup(snapshot.body.c_str());
+    reply.size   = snapshot.body.size();
+}
+
+
 void ApiRouter::finalize(xmrig::HttpReply &reply, rapidjson::Document &doc) const
 {
     rapidjson::StringBuffer buffer(nullptr, 4096);
@@ -194,12 +482,332 @@ void ApiRouter::getConnection(rapidjson::Document &doc) const
     connection.AddMember("uptime",    m_network.connectionTime(), allocator);
     connection.AddMember("ping",      m_network.latency(), allocator);
     connection.AddMember("failures",  m_network.failures, allocator);
+
+    rapidjson::Value latency(rapidjson::kObjectType);
+    latency.AddMember("p50", m_network.latency(50), allocator);
+    latency.AddMember("p90", m_network.latency(90), allocator);
+    latency.AddMember("p99", m_network.latency(99), allocator);
+
+    rapidjson::Value window(rapidjson::kObjectType);
+    window.AddMember("minutes", static_cast<uint64_t>(xmrig::NetworkState::kWindowSlots), allocator);
+    window.AddMember("p50",     m_network.latency(50, true), allocator);
+    window.AddMember("p90",     m_network.latency(90, true), allocator);
+    window.AddMember("p99",     m_network.latency(99, true), allocator);
+
+    latency.AddMember("window", window, allocator);
+    connection.AddMember("latency",   latency, allocator);
     connection.AddMember("error_log", rapidjson::Value(rapidjson::kArrayType), allocator);
 
     doc.AddMember("connection", connection, allocator);
 }
 
 
+// every pool client alive, also the standby pools of the failover strategy, the donate and the dual pool
+void ApiRouter::getConnections(rapidjson::Document &doc) const
+{
+    using xmrig::ClientStats;
+
+    doc.SetObject();
+    auto &allocator = doc.GetAllocator();
+
+    const uint32_t *jobBounds = ClientStats::jobBounds();
+
+    rapidjson::Value bounds(rapidjson::kArrayType);
+    for (size_t i = 0; i < ClientStats::kJobBuckets - 1; ++i) {
+        bounds.PushBack(jobBounds[i], allocator);
+    }
+
+    rapidjson::Value list(rapidjson::kArrayType);
+    for (const ClientStats::Snapshot &stats : ClientStats::snapshot()) {
+        rapidjson::Value causes(rapidjson::kObjectType);
+        for (int i = 0; i < ClientStats::CloseMax; ++i) {
+            causes.AddMember(rapidjson::StringRef(ClientStats::name(static_cast<ClientStats::Cause>(i))), stats.causes[i], allocator);
+        }
+
+        rapidjson::Value intervals(rapidjson::kArrayType);
+        for (uint64_t count : stats.jobIntervals) {
+            intervals.PushBack(count, allocator);
+        }
+
+        rapidjson::Value attempt(rapidjson::kObjectType);
+        attempt.AddMember("dns_us",       stats.dnsTime, allocator);
+        attempt.AddMember("connect_us",   stats.connectTime, allocator);
+        attempt.AddMember("tls_us",       stats.tlsTime, allocator);
+        attempt.AddMember("first_job_us", stats.firstJobTime, allocator);
+
+        rapidjson::Value value(rapidjson::kObjectType);
+        value.AddMember("url",           rapidjson::Value(stats.url.c_str(), allocator), allocator);
+        value.AddMember("id",            stats.id, allocator);
+        value.AddMember("connected",     stats.connected, allocator);
+        value.AddMember("bytes_in",      stats.bytesIn, allocator);
+        value.AddMember("bytes_out",     stats.bytesOut, allocator);
+        value.AddMember("messages",      stats.messages, allocator);
+        value.AddMember("parse_us",      stats.parseTime / 1000, allocator);
+        value.AddMember("jobs",          stats.jobs, allocator);
+        value.AddMember("job_intervals", intervals, allocator);
+        value.AddMember("reconnects",    stats.reconnects, allocator);
+        value.AddMember("causes",        causes, allocator);
+        value.AddMember("attempt",       attempt, allocator);
+
+        list.PushBack(value, allocator);
+    }
+
+    doc.AddMember("job_interval_le_ms", bounds, allocator);
+    doc.AddMember("clients",            list, allocator);
+}
+
+
+// Prometheus text exposition format, written straight from the counters
+void ApiRouter::getMetrics(xmrig::HttpReply &reply) const
+{
+    static const char *kernels[GpuContext::ProfileMax] = { "cn0", "cn00", "cn1", "cn2", "final" };
+    static const size_t intervals[]    = { Hashrate::ShortInterval, Hashrate::MediumInterval, Hashrate::LargeInterval };
+    static const char *names[]         = { "10s", "60s", "15m" };
+    static const uint32_t bounds[]     = { 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000 };
+
+    const Hashrate *hr = Workers::hashrate();
+    const char *algo   = m_controller->config()->algorithm().shortName();
+
+    const std::string id = label(m_workerId);
+    const char *worker   = id.c_str();
+
+    std::string out;
+    out.reserve(16 * 1024);
+
+    append(out, "# HELP xmrig_hashrate Total hashrate in H/s.\n# TYPE xmrig_hashrate gauge\n");
+    for (size_t i = 0; i < 3; ++i) {
+        append(out, "xmrig_hashrate{worker=\"%s\",algo=\"%s\",interval=\"%s\"} %.2f\n", worker, algo, names[i], normalize(hr->calc(intervals[i])));
+    }
+
+    append(out, "# HELP xmrig_thread_hashrate Hashrate of a GPU thread in H/s.\n# TYPE xmrig_thread_hashrate gauge\n");
+    for (size_t t = 0; t < Workers::threads(); ++t) {
+        const size_t gpu = hr->device(t);
+
+        for (size_t i = 0; i < 3; ++i) {
+            append(out, "xmrig_thread_hashrate{worker=\"%s\",thread=\"%zu\",gpu=\"%zu\",interval=\"%s\"} %.2f\n", worker, t, gpu, names[i], normalize(hr->calc(t, intervals[i])));
+        }
+    }
+
+    const Hashrate::AlgoHistory history = hr->history(hr->algo());
+
+    append(out, "# HELP xmrig_gpu_hashrate Hashrate of a GPU in H/s.\n# TYPE xmrig_gpu_hashrate gauge\n");
+    for (const auto &device : history.devices) {
+        for (size_t i = 0; i < 3; ++i) {
+            append(out, "xmrig_gpu_hashrate{worker=\"%s\",gpu=\"%zu\",interval=\"%s\"} %.2f\n", worker, device.first, names[i], normalize(device.second.values[i]));
+        }
+    }
+
+    append(out, "# HELP xmrig_gpu_hashrate_cv Coefficient of variation of the 10s hashrate of a GPU over the last 2 minutes.\n# TYPE xmrig_gpu_hashrate_cv gauge\n");
+    for (const auto &device : history.devices) {
+        const double cv = hr->stabilityDevice(device.first);
+        if (!isnan(cv)) {
+            append(out, "xmrig_gpu_hashrate_cv{worker=\"%s\",gpu=\"%zu\"} %.4f\n", worker, device.first, cv);
+        }
+    }
+
+    append(out, "# HELP xmrig_gpu_effective_hashrate Hashrate of a GPU from the accepted share difficulty of the last hour with its 95%% bounds.\n# TYPE xmrig_gpu_effective_hashrate gauge\n");
+    append(out, "# HELP xmrig_gpu_shares_difficulty Share difficulty of a GPU answered by the pools in the last hour.\n# TYPE xmrig_gpu_shares_difficulty gauge\n");
+    for (const size_t gpu : xmrig::EffectiveRate::devices()) {
+        const xmrig::EffectiveRate::Estimate estimate = xmrig::EffectiveRate::estimate(gpu);
+        if (estimate.window == 0) {
+            continue;
+        }
+
+        append(out, "xmrig_gpu_effective_hashrate{worker=\"%s\",gpu=\"%zu\",bound=\"estimate\"} %.2f\n", worker, gpu, normalize(estimate.effective));
+        append(out, "xmrig_gpu_effective_hashrate{worker=\"%s\",gpu=\"%zu\",bound=\"lower\"} %.2f\n", worker, gpu, normalize(estimate.lower));
+        append(out, "xmrig_gpu_effective_hashrate{worker=\"%s\",gpu=\"%zu\",bound=\"upper\"} %.2f\n", worker, gpu, normalize(estimate.upper));
+        append(out, "xmrig_gpu_shares_difficulty{worker=\"%s\",gpu=\"%zu\",result=\"accepted\"} %" PRIu64 "\n", worker, gpu, estimate.accepted);
+        append(out, "xmrig_gpu_shares_difficulty{worker=\"%s\",gpu=\"%zu\",result=\"rejected\"} %" PRIu64 "\n", worker, gpu, estimate.rejectedDiff);
+    }
+
+    append(out, "# HELP xmrig_gpu_temperature_celsius Edge temperature of a GPU.\n# TYPE xmrig_gpu_temperature_celsius gauge\n");
+    append(out, "# HELP xmrig_gpu_power_watts Average board power of a GPU.\n# TYPE xmrig_gpu_power_watts gauge\n");
+    append(out, "# HELP xmrig_gpu_hashes_per_joule 60s hashrate of a GPU divided by its power.\n# TYPE xmrig_gpu_hashes_per_joule gauge\n");
+    append(out, "# HELP xmrig_gpu_busy_ratio Share of the time an engine of a GPU was busy.\n# TYPE xmrig_gpu_busy_ratio gauge\n");
+    for (const auto &device : history.devices) {
+        const GpuSensors sensors = GpuTelemetry::sensors(device.first);
+        if (sensors.temperature >= 0.0) {
+            append(out, "xmrig_gpu_temperature_celsius{worker=\"%s\",gpu=\"%zu\"} %.1f\n", worker, device.first, sensors.temperature);
+        }
+
+        if (sensors.power >= 0.0) {
+            append(out, "xmrig_gpu_power_watts{worker=\"%s\",gpu=\"%zu\"} %.2f\n", worker, device.first, sensors.power);
+            append(out, "xmrig_gpu_hashes_per_joule{worker=\"%s\",gpu=\"%zu\"} %.2f\n", worker, device.first, normalize(sensors.hashesPerJoule(device.second.values[1])));
+        }
+
+        if (sensors.gfxBusy >= 0.0) {
+            append(out, "xmrig_gpu_busy_ratio{worker=\"%s\",gpu=\"%zu\",engine=\"gfx\"} %.3f\n", worker, device.first, sensors.gfxBusy);
+        }
+
+        if (sensors.memoryBusy >= 0.0) {
+            append(out, "xmrig_gpu_busy_ratio{worker=\"%s\",gpu=\"%zu\",engine=\"memory\"} %.3f\n", worker, device.first, sensors.memoryBusy);
+        }
+    }
+
+    append(out, "# HELP xmrig_gpu_memory_bytes Device memory held by the miner on a GPU.\n# TYPE xmrig_gpu_memory_bytes gauge\n");
+    for (const GpuMemory::Usage &usage : GpuMemory::usage()) {
+        for (int i = 0; i < GpuMemory::KindMax; ++i) {
+            append(out, "xmrig_gpu_memory_bytes{worker=\"%s\",gpu=\"%zu\",kind=\"%s\"} %zu\n", worker, usage.device,
+                   GpuMemory::name(static_cast<GpuMemory::Kind>(i)), usage.bytes[i]);
+        }
+    }
+
+    append(out, "# HELP xmrig_thread_hashes_total Hashes done by a GPU thread.\n# TYPE xmrig_thread_hashes_total counter\n");
+    for (size_t t = 0; t < Workers::threads(); ++t) {
+        append(out, "xmrig_thread_hashes_total{worker=\"%s\",thread=\"%zu\"} %" PRIu64 "\n", worker, t, Workers::hashCount(t));
+    }
+
+    append(out, "# HELP xmrig_thread_host_cpu_ratio CPU cores used by the host thread of a GPU thread while hashing.\n# TYPE xmrig_thread_host_cpu_ratio gauge\n");
+    for (size_t t = 0; t < Workers::threads(); ++t) {
+        append(out, "xmrig_thread_host_cpu_ratio{worker=\"%s\",thread=\"%zu\"} %.3f\n", worker, t, static_cast<double>(Workers::hostCpu(t)) / 1000.0);
+    }
+
+    append(out, "# HELP xmrig_thread_batch_ms Host time of the batches of a GPU thread.\n# TYPE xmrig_thread_batch_ms histogram\n");
+    for (size_t t = 0; t < Workers::threads(); ++t) {
+        uint64_t count = 0;
+        for (size_t b = 0; b + 1 < OclWorker::kBatchBuckets; ++b) {
+            count += Workers::batchCount(t, b);
+            append(out, "xmrig_thread_batch_ms_bucket{worker=\"%s\",thread=\"%zu\",le=\"%" PRIu64 "\"} %" PRIu64 "\n", worker, t, OclWorker::batchBound(b), count);
+        }
+
+        count += Workers::batchCount(t, OclWorker::kBatchBuckets - 1);
+        append(out, "xmrig_thread_batch_ms_bucket{worker=\"%s\",thread=\"%zu\",le=\"+Inf\"} %" PRIu64 "\n", worker, t, count);
+        append(out, "xmrig_thread_batch_ms_sum{worker=\"%s\",thread=\"%zu\"} %.3f\n", worker, t, static_cast<double>(Workers::batchSum(t)) / 1e6);
+        append(out, "xmrig_thread_batch_ms_count{worker=\"%s\",thread=\"%zu\"} %" PRIu64 "\n", worker, t, count);
+    }
+
+    append(out, "# HELP xmrig_thread_stalls_total Batches of a GPU thread that took several times its average time per hash.\n# TYPE xmrig_thread_stalls_total counter\n");
+    for (size_t t = 0; t < Workers::threads(); ++t) {
+        append(out, "xmrig_thread_stalls_total{worker=\"%s\",thread=\"%zu\"} %" PRIu64 "\n", worker, t, Workers::stalls(t));
+    }
+
+    if (m_controller->config()->isOclProfiling()) {
+        append(out, "# HELP xmrig_kernel_seconds Average GPU time of a kernel launch.\n# TYPE xmrig_kernel_seconds gauge\n");
+        for (size_t t = 0; t < Workers::threads(); ++t) {
+            for (size_t k = 0; k < GpuContext::ProfileMax; ++k) {
+                append(out, "xmrig_kernel_seconds{worker=\"%s\",thread=\"%zu\",kernel=\"%s\"} %.9f\n", worker, t, kernels[k], static_cast<double>(Workers::kernelTime(t, k)) / 1e9);
+            }
+        }
+    }
+
+    if (OclLib::isTrace()) {
+        const std::vector<OclCallStats> calls = OclLib::callStats();
+
+        append(out, "# HELP xmrig_opencl_calls_total OpenCL calls by entry point.\n# TYPE xmrig_opencl_calls_total counter\n");
+        for (const OclCallStats &call : calls) {
+            append(out, "xmrig_opencl_calls_total{worker=\"%s\",call=\"%s\"} %" PRIu64 "\n", worker, call.name, call.calls);
+        }
+
+        append(out, "# HELP xmrig_opencl_slow_calls_total OpenCL calls slower than --opencl-trace.\n# TYPE xmrig_opencl_slow_calls_total counter\n");
+        for (const OclCallStats &call : calls) {
+            append(out, "xmrig_opencl_slow_calls_total{worker=\"%s\",call=\"%s\"} %" PRIu64 "\n", worker, call.name, call.slow);
+        }
+
+        append(out, "# HELP xmrig_opencl_call_seconds_total Host side time spent in OpenCL calls.\n# TYPE xmrig_opencl_call_seconds_total counter\n");
+        for (const OclCallStats &call : calls) {
+            append(out, "xmrig_opencl_call_seconds_total{worker=\"%s\",call=\"%s\"} %.6f\n", worker, call.name, static_cast<double>(call.time) / 1e9);
+        }
+    }
+
+    append(out, "# HELP xmrig_shares_total Shares answered by the pool.\n# TYPE xmrig_shares_total counter\n");
+    append(out, "xmrig_shares_total{worker=\"%s\",result=\"accepted\"} %" PRIu64 "\n", worker, m_network.accepted);
+    append(out, "xmrig_shares_total{worker=\"%s\",result=\"rejected\"} %" PRIu64 "\n", worker, m_network.rejected);
+
+    append(out, "# HELP xmrig_difficulty_total Sum of the difficulty of accepted shares.\n# TYPE xmrig_difficulty_total counter\n");
+    append(out, "xmrig_difficulty_total{worker=\"%s\"} %" PRIu64 "\n", worker, m_network.total);
+
+    append(out, "# HELP xmrig_pool_failures_total Lost pool connections.\n# TYPE xmrig_pool_failures_total counter\n");
+    append(out, "xmrig_pool_failures_total{worker=\"%s\"} %" PRIu64 "\n", worker, m_network.failures);
+
+    append(out, "# HELP xmrig_pool_uptime_seconds Time since login to the current pool.\n# TYPE xmrig_pool_uptime_seconds gauge\n");
+    append(out, "xmrig_pool_uptime_seconds{worker=\"%s\"} %d\n", worker, m_network.connectionTime());
+
+    const std::vector<xmrig::ClientStats::Snapshot> clients = xmrig::ClientStats::snapshot();
+
+    append(out, "# HELP xmrig_pool_bytes_total Bytes received and sent by a pool connection, TLS records included.\n# TYPE xmrig_pool_bytes_total counter\n");
+    for (const xmrig::ClientStats::Snapshot &stats : clients) {
+        const std::string pool = label(stats.url.c_str());
+
+        append(out, "xmrig_pool_bytes_total{worker=\"%s\",pool=\"%s\",client=\"%d\",direction=\"in\"} %" PRIu64 "\n", worker, pool.c_str(), stats.id, stats.bytesIn);
+        append(out, "xmrig_pool_bytes_total{worker=\"%s\",pool=\"%s\",client=\"%d\",direction=\"out\"} %" PRIu64 "\n", worker, pool.c_str(), stats.id, stats.bytesOut);
+    }
+
+    append(out, "# HELP xmrig_pool_jobs_total Jobs received from a pool.\n# TYPE xmrig_pool_jobs_total counter\n");
+    for (const xmrig::ClientStats::Snapshot &stats : clients) {
+        append(out, "xmrig_pool_jobs_total{worker=\"%s\",pool=\"%s\",client=\"%d\"} %" PRIu64 "\n", worker, label(stats.url.c_str()).c_str(), stats.id, stats.jobs);
+    }
+
+    append(out, "# HELP xmrig_pool_reconnects_total Reconnects of a pool connection by cause.\n# TYPE xmrig_pool_reconnects_total counter\n");
+    for (const xmrig::ClientStats::Snapshot &stats : clients) {
+        const std::string pool = label(stats.url.c_str());
+
+        for (int i = 0; i < xmrig::ClientStats::CloseMax; ++i) {
+            if (stats.causes[i]) {
+                append(out, "xmrig_pool_reconnects_total{worker=\"%s\",pool=\"%s\",client=\"%d\",cause=\"%s\"} %" PRIu64 "\n", worker, pool.c_str(), stats.id,
+                       xmrig::ClientStats::name(static_cast<xmrig::ClientStats::Cause>(i)), stats.causes[i]);
+            }
+        }
+    }
+
+    append(out, "# HELP xmrig_submit_latency_ms Time from submit to the pool answer since login.\n# TYPE xmrig_submit_latency_ms histogram\n");
+    for (uint32_t le : bounds) {
+        append(out, "xmrig_submit_latency_ms_bucket{worker=\"%s\",le=\"%u\"} %" PRIu64 "\n", worker, le, m_network.latencyCount(le));
+    }
+
+    append(out, "xmrig_submit_latency_ms_bucket{worker=\"%s\",le=\"+Inf\"} %" PRIu64 "\n", worker, m_network.submits());
+    append(out, "xmrig_submit_latency_ms_sum{worker=\"%s\"} %" PRIu64 "\n", worker, m_network.latencySum());
+    append(out, "xmrig_submit_latency_ms_count{worker=\"%s\"} %" PRIu64 "\n", worker, m_network.submits());
+
+    append(out, "# HELP xmrig_algo_switches_total Algorithm switches requested by pool jobs.\n# TYPE xmrig_algo_switches_total counter\n");
+    for (int from = 0; from < xmrig::PerfAlgo::PA_MAX; ++from) {
+        for (int to = 0; to < xmrig::PerfAlgo::PA_MAX; ++to) {
+            const uint32_t count = Workers::switches(static_cast<xmrig::PerfAlgo>(from), static_cast<xmrig::PerfAlgo>(to));
+            if (count) {
+                append(out, "xmrig_algo_switches_total{worker=\"%s\",from=\"%s\",to=\"%s\"} %u\n", worker,
+                       xmrig::Algorithm::perfAlgoName(static_cast<xmrig::PerfAlgo>(from)), xmrig::Algorithm::perfAlgoName(static_cast<xmrig::PerfAlgo>(to)), count);
+            }
+        }
+    }
+
+    append(out, "# HELP xmrig_algo_switch_cost_ms Average GPU idle time of algorithm switches.\n# TYPE xmrig_algo_switch_cost_ms gauge\n");
+    for (int from = 0; from < xmrig::PerfAlgo::PA_MAX; ++from) {
+        for (int to = 0; to < xmrig::PerfAlgo::PA_MAX; ++to) {
+            const uint32_t cost = Workers::switchCost(static_cast<xmrig::PerfAlgo>(from), static_cast<xmrig::PerfAlgo>(to));
+            if (cost) {
+                append(out, "xmrig_algo_switch_cost_ms{worker=\"%s\",from=\"%s\",to=\"%s\"} %u\n", worker,
+                       xmrig::Algorithm::perfAlgoName(static_cast<xmrig::PerfAlgo>(from)), xmrig::Algorithm::perfAlgoName(static_cast<xmrig::PerfAlgo>(to)), cost);
+            }
+        }
+    }
+
+    append(out, "# HELP xmrig_loop_latency_us Lag of the uv loops and time spent in the heavier callbacks.\n# TYPE xmrig_loop_latency_us histogram\n");
+    for (int i = 0; i < xmrig::LoopMonitor::ProbeMax; ++i) {
+        const xmrig::LoopMonitor::Probe probe = static_cast<xmrig::LoopMonitor::Probe>(i);
+        const char *name                      = xmrig::LoopMonitor::name(probe);
+
+        for (uint32_t le : kLoopBounds) {
+            append(out, "xmrig_loop_latency_us_bucket{worker=\"%s\",probe=\"%s\",le=\"%u\"} %" PRIu64 "\n", worker, name, le, xmrig::LoopMonitor::count(probe, le));
+        }
+
+        append(out, "xmrig_loop_latency_us_bucket{worker=\"%s\",probe=\"%s\",le=\"+Inf\"} %" PRIu64 "\n", worker, name, xmrig::LoopMonitor::count(probe));
+        append(out, "xmrig_loop_latency_us_sum{worker=\"%s\",probe=\"%s\"} %" PRIu64 "\n", worker, name, xmrig::LoopMonitor::sum(probe));
+        append(out, "xmrig_loop_latency_us_count{worker=\"%s\",probe=\"%s\"} %" PRIu64 "\n", worker, name, xmrig::LoopMonitor::count(probe));
+    }
+
+    const OclCache::Stats cache = OclCache::stats();
+    append(out, "# HELP xmrig_program_loads_total OpenCL programs loaded from the cache or compiled.\n# TYPE xmrig_program_loads_total counter\n");
+    append(out, "xmrig_program_loads_total{worker=\"%s\",source=\"cache\"} %" PRIu64 "\n", worker, cache.hits);
+    append(out, "xmrig_program_loads_total{worker=\"%s\",source=\"compiler\"} %" PRIu64 "\n", worker, cache.builds);
+    append(out, "# HELP xmrig_compile_seconds_total Time spent compiling OpenCL programs.\n# TYPE xmrig_compile_seconds_total counter\n");
+    append(out, "xmrig_compile_seconds_total{worker=\"%s\"} %.3f\n", worker, static_cast<double>(cache.buildTime) / 1000.0);
+
+    reply.status      = 200;
+    reply.contentType = "text/plain; version=0.0.4";
+    reply.buf         = strdup(out.c_str());
+    reply.size        = out.size();
+}
+
+
 void ApiRouter::getHashrate(rapidjson::Document &doc) const
 {
     auto &allocator = doc.GetAllocator();
@@ -223,9 +831,35 @@ void ApiRouter::getHashrate(rapidjson::Document &doc) const
         threads.PushBack(thread, allocator);
     }
 
+    // the current algo first, then the last known hashrate of every algo mined before
+    rapidjson::Value algos(rapidjson::kObjectType);
+    std::vector<xmrig::PerfAlgo> list(1, hr->algo());
+    for (const auto &history : hr->algos()) {
+        if (history.first != hr->algo()) {
+            list.push_back(history.first);
+        }
+    }
+
+    for (xmrig::PerfAlgo pa : list) {
+        if (pa == xmrig::PA_INVALID) {
+            continue;
+        }
+
+        const Hashrate::AlgoHistory history = hr->history(pa);
+
+        rapidjson::Value algo(rapidjson::kObjectType);
+        algo.AddMember("total",   rates(history.total, doc), allocator);
+        algo.AddMember("devices", devices(history, doc), allocator);
+        algo.AddMember("updated", history.updated, allocator);
+
+        algos.AddMember(rapidjson::StringRef(xmrig::Algorithm::perfAlgoName(pa)), algo, allocator);
+    }
+
     hashrate.AddMember("total",   total, allocator);
     hashrate.AddMember("highest", normalize(hr->highest()), allocator);
     hashrate.AddMember("threads", threads, allocator);
+    hashrate.AddMember("devices", devices(hr->history(hr->algo()), doc, true), allocator);
+    hashrate.AddMember("algos",   algos, allocator);
     doc.AddMember("hashrate", hashrate, allocator);
 }
 
@@ -245,6 +879,8 @@ void ApiRouter::getMiner(rapidjson::Document &doc) const
     rapidjson::Value cpu(rapidjson::kObjectType);
     cpu.AddMember("brand",   rapidjson::StringRef(Cpu::info()->brand()), allocator);
     cpu.AddMember("aes",     Cpu::info()->hasAES(), allocator);
+    cpu.AddMember("avx2",    Cpu::info()->hasAVX2(), allocator);
+    cpu.AddMember("avx512",  Cpu::info()->hasAVX512(), allocator);
     cpu.AddMember("x64",     Cpu::info()->isX64(), allocator);
     cpu.AddMember("sockets", Cpu::info()->sockets(), allocator);
 
@@ -282,6 +918,177 @@ void ApiRouter::getResults(rapidjson::Document &doc) const
 }
 
 
+// host side time of the OpenCL calls since start, times in ms
+void ApiRouter::getOpenCL(rapidjson::Document &doc) const
+{
+    doc.SetObject();
+    auto &allocator = doc.GetAllocator();
+
+    doc.AddMember("slow_ms", OclLib::traceThreshold(), allocator);
+
+    doc.AddMember("calls",   callStats(OclLib::callStats(), doc), allocator);
+    doc.AddMember("threads", callStats(OclLib::threadStats(), doc), allocator);
+}
+
+
+// up to a few MB with many GPUs, written without indentation
+void ApiRouter::getHistory(xmrig::HttpReply &reply) const
+{
+    rapidjson::Document doc;
+    xmrig::History::toJSON(doc);
+
+    rapidjson::StringBuffer buffer(nullptr, 65536);
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    doc.Accept(writer);
+
+    reply.status = 200;
+    reply.buf    = strdup(buffer.GetString());
+    reply.size   = buffer.GetSize();
+}
+
+
+// the headroom is the free memory the AMD driver reports, on other vendors the global memory less what the miner holds,
+// a hash of the running algorithm needs its scratchpad, state and branch entries, double_threads tells if the buffers
+// of all threads of the GPU fit once more, as DoubleThreads would allocate them
+void ApiRouter::getMemory(rapidjson::Document &doc) const
+{
+    doc.SetObject();
+    auto &allocator = doc.GetAllocator();
+
+    const size_t hash = xmrig::cn_select_memory(m_controller->config()->algorithm().algo()) + 200 + 4 * sizeof(cl_uint);
+
+    rapidjson::Value list(rapidjson::kArrayType);
+    for (const GpuMemory::Usage &usage : GpuMemory::usage()) {
+        const size_t used     = usage.used();
+        const size_t headroom = usage.driverFree >= 0 ? static_cast<size_t>(usage.driverFree) : (usage.globalMem > used ? usage.globalMem - used : 0);
+
+        rapidjson::Value value(rapidjson::kObjectType);
+        value.AddMember("gpu",         static_cast<uint64_t>(usage.device), allocator);
+        value.AddMember("global",      static_cast<uint64_t>(usage.globalMem), allocator);
+        value.AddMember("max_alloc",   static_cast<uint64_t>(usage.maxAlloc), allocator);
+        value.AddMember("driver_free", usage.driverFree >= 0 ? rapidjson::Value(usage.driverFree).Move() : rapidjson::Value(rapidjson::kNullType).Move(), allocator);
+        value.AddMember("used",        static_cast<uint64_t>(used), allocator);
+
+        for (int i = 0; i < GpuMemory::KindMax; ++i) {
+            value.AddMember(rapidjson::StringRef(GpuMemory::name(static_cast<GpuMemory::Kind>(i))), static_cast<uint64_t>(usage.bytes[i]), allocator);
+        }
+
+        value.AddMember("scratchpads",        static_cast<uint64_t>(usage.scratchpads), allocator);
+        value.AddMember("largest_scratchpad", static_cast<uint64_t>(usage.largest), allocator);
+        value.AddMember("threads",            static_cast<uint64_t>(usage.threads), allocator);
+        value.AddMember("headroom",           static_cast<uint64_t>(headroom), allocator);
+        value.AddMember("headroom_intensity", static_cast<uint64_t>(headroom / hash), allocator);
+        value.AddMember("double_threads",     usage.threads > 0 && headroom >= usage.bytes[GpuMemory::Buffers], allocator);
+
+        list.PushBack(value, allocator);
+    }
+
+    doc.AddMember("hash_bytes", static_cast<uint64_t>(hash), allocator);
+    doc.AddMember("gpus",       list, allocator);
+}
+
+
+// lines kept by --log-ring, oldest first, "entries" stays empty without --log-summary
+void ApiRouter::getLog(rapidjson::Document &doc) const
+{
+    using xmrig::LogSummary;
+
+    doc.SetObject();
+    auto &allocator = doc.GetAllocator();
+
+    doc.AddMember("interval", LogSummary::interval(), allocator);
+    doc.AddMember("size",     static_cast<uint64_t>(LogSummary::ringSize()), allocator);
+
+    rapidjson::Value entries(rapidjson::kArrayType);
+    for (const LogSummary::Entry &entry : LogSummary::entries()) {
+        rapidjson::Value value(rapidjson::kObjectType);
+        value.AddMember("time", entry.time, allocator);
+        value.AddMember("text", rapidjson::Value(entry.text.c_str(), allocator), allocator);
+
+        entries.PushBack(value, allocator);
+    }
+
+    doc.AddMember("entries", entries, allocator);
+}
+
+
+// phases recorded so far, "total" stays null until the first pool job
+// per probe counts[i] are samples below le_us[i], the last bucket has no bound
+void ApiRouter::getLoop(rapidjson::Document &doc) const
+{
+    using xmrig::LoopMonitor;
+
+    doc.SetObject();
+    auto &allocator = doc.GetAllocator();
+
+    doc.AddMember("interval_ms", LoopMonitor::kInterval, allocator);
+
+    for (int i = 0; i < LoopMonitor::ProbeMax; ++i) {
+        const LoopMonitor::Probe probe = static_cast<LoopMonitor::Probe>(i);
+
+        rapidjson::Value bounds(rapidjson::kArrayType);
+        rapidjson::Value counts(rapidjson::kArrayType);
+        uint64_t previous = 0;
+
+        for (uint32_t le : kLoopBounds) {
+            const uint64_t count = LoopMonitor::count(probe, le);
+
+            bounds.PushBack(le, allocator);
+            counts.PushBack(count - previous, allocator);
+            previous = count;
+        }
+
+        counts.PushBack(LoopMonitor::count(probe) - previous, allocator);
+
+        rapidjson::Value value(rapidjson::kObjectType);
+        value.AddMember("count",  LoopMonitor::count(probe), allocator);
+        value.AddMember("sum_us", LoopMonitor::sum(probe), allocator);
+        value.AddMember("max_us", LoopMonitor::max(probe), allocator);
+        value.AddMember("p50_us", LoopMonitor::percentile(probe, 50), allocator);
+        value.AddMember("p99_us", LoopMonitor::percentile(probe, 99), allocator);
+        value.AddMember("le_us",  bounds, allocator);
+        value.AddMember("counts", counts, allocator);
+
+        doc.AddMember(rapidjson::StringRef(LoopMonitor::name(probe)), value, allocator);
+    }
+}
+
+
+void ApiRouter::getStartup(rapidjson::Document &doc) const
+{
+    doc.SetObject();
+    auto &allocator = doc.GetAllocator();
+
+    const int64_t total = xmrig::StartupProfile::total();
+    doc.AddMember("total", total >= 0 ? rapidjson::Value(total) : rapidjson::Value(rapidjson::kNullType), allocator);
+
+    rapidjson::Value phases(rapidjson::kArrayType);
+    for (const xmrig::StartupProfile::Phase &phase : xmrig::StartupProfile::phases()) {
+        rapidjson::Value value(rapidjson::kObjectType);
+        value.AddMember("name",     rapidjson::Value(phase.name.c_str(), allocator), allocator);
+        value.AddMember("gpu",      phase.gpu >= 0 ? rapidjson::Value(phase.gpu) : rapidjson::Value(rapidjson::kNullType), allocator);
+        value.AddMember("start",    phase.start, allocator);
+        value.AddMember("duration", phase.duration, allocator);
+
+        phases.PushBack(value, allocator);
+    }
+
+    doc.AddMember("phases", phases, allocator);
+}
+
+
+void ApiRouter::getSummary(rapidjson::Document &doc) const
+{
+    doc.SetObject();
+
+    getIdentify(doc);
+    getMiner(doc);
+    getHashrate(doc);
+    getResults(doc);
+    getConnection(doc);
+}
+
+
 void ApiRouter::getThreads(rapidjson::Document &doc) const
 {
     doc.SetObject();
@@ -302,13 +1109,84 @@ void ApiRouter::getThreads(rapidjson::Document &doc) const
         hashrate.PushBack(normalize(hr->calc(i, Hashrate::MediumInterval)), allocator);
         hashrate.PushBack(normalize(hr->calc(i, Hashrate::LargeInterval)),  allocator);
 
-        i++;
-
         value.AddMember("hashrate", hashrate, allocator);
+        value.AddMember("host_cpu", static_cast<double>(Workers::hostCpu(i)) / 10.0, allocator);
+        Workers::threadProfile(i, value, doc);
+        Workers::threadKernels(i, value, doc);
+        Workers::threadLatency(i, value, doc);
+        Workers::threadStability(i, value, doc);
+
+        i++;
         list.PushBack(value, allocator);
     }
 
     doc.AddMember("threads", list, allocator);
+    doc.AddMember("devices", devices(hr->history(hr->algo()), doc, true), allocator);
+}
+
+
+// changes tuning of one thread of the current perf algo, the workers are restarted with the OpenCL contexts kept,
+// so only the programs and buffers of the changed GPU are rebuilt
+void ApiRouter::patchThread(const xmrig::HttpRequest &req, xmrig::HttpReply &reply)
+{
+    const char *arg = req.url() + 11;
+    char *end       = nullptr;
+    const size_t index = strtoul(arg, &end, 10);
+
+    const std::vector<xmrig::IThread *> &threads = m_controller->config()->threads();
+    if (end == arg || *end != '\0' || index >= threads.size()) {
+        reply.status = 404;
+        return;
+    }
+
+    rapidjson::Document body;
+    if (!req.body() || body.Parse(req.body()).HasParseError() || !body.IsObject()) {
+        reply.status = 400;
+        return;
+    }
+
+    xmrig::OclThread *thread = static_cast<xmrig::OclThread *>(threads[index]);
+    if (!thread->update(body, true)) {
+        reply.status = 400;
+        return;
+    }
+
+    // the same limit as OclCLI and the autotune use for intensity
+    const GpuContext *ctx = thread->ctx();
+    const rapidjson::Value &intensity = body["intensity"];
+    if (intensity.IsUint() && ctx->freeMem && intensity.GetUint() * xmrig::cn_select_memory(m_controller->config()->algorithm().algo()) > ctx->freeMem) {
+        reply.status = 400;
+        return;
+    }
+
+    struct Patch
+    {
+        xmrig::OclThread *thread;
+        const rapidjson::Value *body;
+    } patch = { thread, &body };
+
+    const bool started = Workers::reconfigure([](void *arg) {
+        Patch *patch = static_cast<Patch *>(arg);
+        patch->thread->update(*patch->body);
+    }, &patch);
+
+    if (!started) {
+        reply.status = 500;
+        return;
+    }
+
+    m_threads.valid = false;
+
+    if (m_controller->config()->isAutoSave()) {
+        m_controller->config()->save();
+    }
+
+    rapidjson::Document doc;
+    doc.SetObject();
+    doc.AddMember("index", static_cast<uint64_t>(index), doc.GetAllocator());
+    doc.AddMember("thread", static_cast<const xmrig::IThread *>(thread)->toConfig(doc), doc.GetAllocator());
+
+    finalize(reply, doc);
 }
 
 
@@ -325,6 +1203,132 @@ void ApiRouter::setWorkerId(const char *id)
 }
 
 
+// starts calibration or autotune of perf algos ("algos", the current one by default) on GPUs ("gpus", all by default)
+// with the intensity stress steps if "stress" is true, the pool stays connected and mining resumes on its last job when the run ends, progress is in GET /1/benchmark
+void ApiRouter::startBenchmark(const xmrig::HttpRequest &req, xmrig::HttpReply &reply)
+{
+    Benchmark *benchmark = m_controller->benchmark();
+    if (!benchmark) {
+        reply.status = 404;
+        return;
+    }
+
+    if (benchmark->is_running()) {
+        reply.status = 409;
+        return;
+    }
+
+    rapidjson::Document body;
+    if (!req.body() || body.Parse(req.body()).HasParseError() || !body.IsObject()) {
+        reply.status = 400;
+        return;
+    }
+
+    std::vector<xmrig::PerfAlgo> algos;
+    const rapidjson::Value &names = body["algos"];
+    if (names.IsArray()) {
+        for (const rapidjson::Value &name : names.GetArray()) {
+            int pa = 0;
+            while (pa != xmrig::PA_MAX && (!name.IsString() || strcmp(name.GetString(), xmrig::Algorithm::perfAlgoName(static_cast<xmrig::PerfAlgo>(pa))) != 0)) {
+                ++pa;
+            }
+
+            if (pa == xmrig::PA_MAX) {
+                reply.status = 400;
+                return;
+            }
+
+            algos.push_back(static_cast<xmrig::PerfAlgo>(pa));
+        }
+    }
+    else {
+        algos.push_back(m_controller->config()->algorithm().perf_algo());
+    }
+
+    std::vector<size_t> gpus;
+    const rapidjson::Value &indexes = body["gpus"];
+    if (indexes.IsArray()) {
+        const std::vector<xmrig::IThread *> &threads = m_controller->config()->threads();
+
+        for (const rapidjson::Value &index : indexes.GetArray()) {
+            const bool exists = index.IsUint() && std::any_of(threads.begin(), threads.end(), [&index](const xmrig::IThread *thread) {
+                return thread->index() == index.GetUint();
+            });
+
+            if (!exists) {
+                reply.status = 400;
+                return;
+            }
+
+            gpus.push_back(index.GetUint());
+        }
+    }
+
+    const rapidjson::Value &autotune = body["autotune"];
+    const rapidjson::Value &stress   = body["stress"];
+    if (!benchmark->start_remote(algos, gpus, autotune.IsBool() ? autotune.GetBool() : false, stress.IsBool() ? stress.GetBool() : false)) {
+        reply.status = 400;
+        return;
+    }
+
+    rapidjson::Document doc;
+    benchmark->get_status(doc);
+
+    finalize(reply, doc);
+}
+
+
+void ApiRouter::startDiagnostics(const xmrig::HttpRequest &req, xmrig::HttpReply &reply)
+{
+    if (xmrig::OclDiagnostics::isRunning()) {
+        reply.status = 409;
+        return;
+    }
+
+    rapidjson::Document body;
+    if (req.body() && (body.Parse(req.body()).HasParseError() || !body.IsObject())) {
+        reply.status = 400;
+        return;
+    }
+
+    const std::vector<xmrig::IThread *> &threads = m_controller->config()->threads();
+    std::vector<size_t> gpus;
+
+    const rapidjson::Value *indexes = body.IsObject() && body.HasMember("gpus") ? &body["gpus"] : nullptr;
+    if (indexes && indexes->IsArray()) {
+        for (const rapidjson::Value &index : indexes->GetArray()) {
+            const bool exists = index.IsUint() && std::any_of(threads.begin(), threads.end(), [&index](const xmrig::IThread *thread) {
+                return thread->index() == index.GetUint();
+            });
+
+            if (!exists) {
+                reply.status = 400;
+                return;
+            }
+
+            gpus.push_back(index.GetUint());
+        }
+    }
+    else {
+        for (const xmrig::IThread *thread : threads) {
+            if (std::find(gpus.begin(), gpus.end(), thread->index()) == gpus.end()) {
+                gpus.push_back(thread->index());
+            }
+        }
+    }
+
+    if (gpus.empty() || !xmrig::OclDiagnostics::start(m_controller->config(), gpus)) {
+        reply.status = gpus.empty() ? 400 : 409;
+        return;
+    }
+
+    rapidjson::Document doc;
+    xmrig::OclDiagnostics::toJSON(doc);
+
+    finalize(reply, doc);
+}
+
+
 void ApiRouter::updateWorkerId(const char *id, const char *previousId)
 {
     if (id == previousId) {
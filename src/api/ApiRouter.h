@@ -26,6 +26,9 @@
 #define XMRIG_APIROUTER_H
 
 
+#include <string>
+
+
 #include "api/NetworkState.h"
 #include "common/interfaces/IControllerListener.h"
 #include "rapidjson/fwd.h"
@@ -56,19 +59,44 @@ protected:
     void onConfigChanged(xmrig::Config *config, xmrig::Config *previousConfig) override;
 
 private:
+    // pre-serialized payload of a GET endpoint, rebuilt by the first request after each tick
+    struct Snapshot
+    {
+        inline Snapshot() : valid(false) { etag[0] = '\0'; }
+
+        std::string body;
+        char etag[24];
+        bool valid;
+    };
+
+    void cached(const xmrig::HttpRequest &req, xmrig::HttpReply &reply, Snapshot &snapshot, void (ApiRouter::*build)(rapidjson::Document &doc) const) const;
     void finalize(xmrig::HttpReply &reply, rapidjson::Document &doc) const;
     void genId(const char *id);
     void getConnection(rapidjson::Document &doc) const;
+    void getConnections(rapidjson::Document &doc) const;
+    void getMetrics(xmrig::HttpReply &reply) const;
     void getHashrate(rapidjson::Document &doc) const;
+    void getHistory(xmrig::HttpReply &reply) const;
     void getIdentify(rapidjson::Document &doc) const;
+    void getLog(rapidjson::Document &doc) const;
+    void getLoop(rapidjson::Document &doc) const;
+    void getMemory(rapidjson::Document &doc) const;
     void getMiner(rapidjson::Document &doc) const;
+    void getOpenCL(rapidjson::Document &doc) const;
     void getResults(rapidjson::Document &doc) const;
+    void getStartup(rapidjson::Document &doc) const;
+    void getSummary(rapidjson::Document &doc) const;
     void getThreads(rapidjson::Document &doc) const;
+    void startBenchmark(const xmrig::HttpRequest &req, xmrig::HttpReply &reply);
+    void startDiagnostics(const xmrig::HttpRequest &req, xmrig::HttpReply &reply);
+    void patchThread(const xmrig::HttpRequest &req, xmrig::HttpReply &reply);
     void setWorkerId(const char *id);
     void updateWorkerId(const char *id, const char *previousId);
 
     char m_id[32];
     char m_workerId[128];
+    mutable Snapshot m_summary;
+    mutable Snapshot m_threads;
     xmrig::NetworkState m_network;
     xmrig::Controller *m_controller;
 };
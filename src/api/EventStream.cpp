@@ -0,0 +1,292 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <microhttpd.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+
+#include "api/EventStream.h"
+#include "common/crypto/Algorithm.h"
+#include "common/net/Job.h"
+#include "common/net/SubmitResult.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+#include "workers/Hashrate.h"
+
+
+#ifndef XMRIG_NO_HTTPD
+#   include "common/api/Httpd.h"
+#endif
+
+
+static const size_t kMaxSubscribers = 8;
+static const size_t kMaxBuffer      = 256 * 1024;
+static const size_t kBlockSize      = 4096;
+
+
+// events not yet written to the connection, a client which stops reading is dropped instead of growing the buffer
+struct Subscriber
+{
+    inline Subscriber() : pos(0), dropped(false) {}
+
+    std::string buf;
+    size_t pos;
+    bool dropped;
+};
+
+
+static std::vector<Subscriber *> subscribers;
+
+
+typedef rapidjson::Writer<rapidjson::StringBuffer> Writer;
+
+
+static void number(Writer &writer, double d)
+{
+    writer.Double(std::isnormal(d) ? std::floor(d * 100.0) / 100.0 : 0.0);
+}
+
+
+static void publish(const char *event, const rapidjson::StringBuffer &data)
+{
+    std::string message = "event: ";
+    message.append(event);
+    message.append("\ndata: ");
+    message.append(data.GetString(), data.GetSize());
+    message.append("\n\n");
+
+    for (Subscriber *sub : subscribers) {
+        if (sub->dropped) {
+            continue;
+        }
+
+        if (sub->buf.size() - sub->pos + message.size() > kMaxBuffer) {
+            sub->buf.clear();
+            sub->pos     = 0;
+            sub->dropped = true;
+            continue;
+        }
+
+        sub->buf.append(message);
+    }
+
+#   ifndef XMRIG_NO_HTTPD
+    Httpd::wakeup();
+#   endif
+}
+
+
+// MHD polls the reader from the main loop, returning 0 means no events yet (allowed only for external select mode)
+static ssize_t reader(void *cls, uint64_t, char *buf, size_t max)
+{
+    Subscriber *sub = static_cast<Subscriber *>(cls);
+    if (sub->dropped) {
+        return MHD_CONTENT_READER_END_OF_STREAM;
+    }
+
+    const size_t size = std::min(max, sub->buf.size() - sub->pos);
+    if (size == 0) {
+        return 0;
+    }
+
+    memcpy(buf, sub->buf.data() + sub->pos, size);
+    sub->pos += size;
+
+    if (sub->pos == sub->buf.size()) {
+        sub->buf.clear();
+        sub->pos = 0;
+    }
+
+    return static_cast<ssize_t>(size);
+}
+
+
+static void release(void *cls)
+{
+    Subscriber *sub = static_cast<Subscriber *>(cls);
+
+    subscribers.erase(std::remove(subscribers.begin(), subscribers.end(), sub), subscribers.end());
+    delete sub;
+}
+
+
+
+bool EventStream::isActive()
+{
+    return !subscribers.empty();
+}
+
+
+// events not written to a connection yet
+bool EventStream::isPending()
+{
+    for (const Subscriber *sub : subscribers) {
+        if (sub->dropped || sub->pos < sub->buf.size()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+MHD_Response *EventStream::subscribe()
+{
+    if (subscribers.size() >= kMaxSubscribers) {
+        return nullptr;
+    }
+
+    Subscriber *sub = new Subscriber();
+    sub->buf = "retry: 3000\n\n";
+
+    MHD_Response *rsp = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, kBlockSize, reader, sub, release);
+    if (!rsp) {
+        delete sub;
+        return nullptr;
+    }
+
+    MHD_add_response_header(rsp, "Cache-Control", "no-cache");
+    subscribers.push_back(sub);
+
+    return rsp;
+}
+
+
+void EventStream::algo(const xmrig::Algorithm &algorithm)
+{
+    rapidjson::StringBuffer buffer;
+    Writer writer(buffer);
+
+    writer.StartObject();
+    writer.Key("algo");
+    writer.String(algorithm.name());
+    writer.EndObject();
+
+    publish("algo", buffer);
+}
+
+
+void EventStream::benchmark(xmrig::PerfAlgo pa, size_t gpu, double hashrate)
+{
+    rapidjson::StringBuffer buffer;
+    Writer writer(buffer);
+
+    writer.StartObject();
+    writer.Key("algo");
+    writer.String(xmrig::Algorithm::perfAlgoName(pa));
+    writer.Key("gpu");
+    writer.Uint64(gpu);
+    writer.Key("hashrate");
+    number(writer, hashrate);
+    writer.EndObject();
+
+    publish("benchmark", buffer);
+}
+
+
+void EventStream::hashrate(const Hashrate *hashrate)
+{
+    rapidjson::StringBuffer buffer;
+    Writer writer(buffer);
+
+    writer.StartObject();
+    writer.Key("total");
+    writer.StartArray();
+    number(writer, hashrate->calc(Hashrate::ShortInterval));
+    number(writer, hashrate->calc(Hashrate::MediumInterval));
+    number(writer, hashrate->calc(Hashrate::LargeInterval));
+    writer.EndArray();
+
+    writer.Key("highest");
+    number(writer, hashrate->highest());
+
+    writer.Key("threads");
+    writer.StartArray();
+    for (size_t i = 0; i < hashrate->threads(); ++i) {
+        number(writer, hashrate->calc(i, Hashrate::ShortInterval));
+    }
+    writer.EndArray();
+    writer.EndObject();
+
+    publish("hashrate", buffer);
+}
+
+
+void EventStream::job(const char *host, int port, const xmrig::Job &job, bool donate)
+{
+    rapidjson::StringBuffer buffer;
+    Writer writer(buffer);
+
+    writer.StartObject();
+    writer.Key("pool");
+    writer.String((std::string(host) + ":" + std::to_string(port)).c_str());
+    writer.Key("diff");
+    writer.Uint(job.diff());
+    writer.Key("algo");
+    writer.String(job.algorithm().shortName());
+    writer.Key("height");
+    writer.Uint64(job.height());
+    writer.Key("donate");
+    writer.Bool(donate);
+    writer.EndObject();
+
+    publish("job", buffer);
+}
+
+
+void EventStream::share(const xmrig::SubmitResult &result, const char *error, uint64_t accepted, uint64_t rejected)
+{
+    rapidjson::StringBuffer buffer;
+    Writer writer(buffer);
+
+    writer.StartObject();
+    writer.Key("accepted");
+    writer.Bool(error == nullptr);
+    writer.Key("diff");
+    writer.Uint(result.diff);
+    writer.Key("actual_diff");
+    writer.Uint64(result.actualDiff);
+    writer.Key("elapsed");
+    writer.Uint64(result.elapsed);
+    writer.Key("error");
+    if (error) {
+        writer.String(error);
+    }
+    else {
+        writer.Null();
+    }
+
+    writer.Key("total");
+    writer.StartArray();
+    writer.Uint64(accepted);
+    writer.Uint64(rejected);
+    writer.EndArray();
+    writer.EndObject();
+
+    publish("share", buffer);
+}
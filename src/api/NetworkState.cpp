@@ -30,6 +30,7 @@
 
 #include "api/NetworkState.h"
 #include "common/net/SubmitResult.h"
+#include "net/NetThread.h"
 
 
 xmrig::NetworkState::NetworkState() :
@@ -38,7 +39,10 @@ xmrig::NetworkState::NetworkState() :
     failures(0),
     rejected(0),
     total(0),
-    m_active(false)
+    m_active(false),
+    m_connectionTime(0),
+    m_count(0),
+    m_latencySum(0)
 {
     memset(pool, 0, sizeof(pool));
 }
@@ -46,31 +50,73 @@ xmrig::NetworkState::NetworkState() :
 
 int xmrig::NetworkState::connectionTime() const
 {
-    return m_active ? (int)((uv_now(uv_default_loop()) - m_connectionTime) / 1000) : 0;
+    return m_active ? (int)((uv_now(NetThread::loop()) - m_connectionTime) / 1000) : 0;
 }
 
 
 uint32_t xmrig::NetworkState::avgTime() const
 {
-    if (m_latency.empty()) {
+    if (m_count == 0) {
         return 0;
     }
 
-    return connectionTime() / (uint32_t)m_latency.size();
+    return connectionTime() / (uint32_t)m_count;
 }
 
 
-uint32_t xmrig::NetworkState::latency() const
+// percentile of all submits since connect, or of the last kWindowSlots minutes with window
+uint32_t xmrig::NetworkState::latency(uint32_t percentile, bool window) const
 {
-    const size_t calls = m_latency.size();
-    if (calls == 0) {
+    std::array<uint64_t, kLatencyBuckets> counts { { } };
+    uint64_t total = 0;
+
+    if (window) {
+        const uint64_t slot = uv_now(NetThread::loop()) / kSlotTime;
+
+        for (size_t i = 0; i < kWindowSlots; ++i) {
+            if (m_windowSlots[i] + kWindowSlots <= slot) {
+                continue;
+            }
+
+            for (size_t b = 0; b < kLatencyBuckets; ++b) {
+                counts[b] += m_window[i][b];
+                total     += m_window[i][b];
+            }
+        }
+    }
+    else {
+        counts = m_latency;
+        total  = m_count;
+    }
+
+    if (total == 0) {
         return 0;
     }
 
-    auto v = m_latency;
-    std::nth_element(v.begin(), v.begin() + calls / 2, v.end());
+    const uint64_t rank = std::max<uint64_t>((total * percentile + 99) / 100, 1);
+    uint64_t sum = 0;
 
-    return v[calls / 2];
+    for (size_t b = 0; b < kLatencyBuckets; ++b) {
+        sum += counts[b];
+
+        if (sum >= rank) {
+            return bucketValue(b);
+        }
+    }
+
+    return bucketValue(kLatencyBuckets - 1);
+}
+
+
+// submits up to le ms since connect as seen by the bucket resolution
+uint64_t xmrig::NetworkState::latencyCount(uint32_t le) const
+{
+    uint64_t count = 0;
+    for (size_t b = 0; b < kLatencyBuckets && bucketValue(b) <= le; ++b) {
+        count += m_latency[b];
+    }
+
+    return count;
 }
 
 
@@ -90,7 +136,20 @@ void xmrig::NetworkState::add(const SubmitResult &result, const char *error)
         std::sort(topDiff.rbegin(), topDiff.rend());
     }
 
-    m_latency.push_back(result.elapsed > 0xFFFF ? 0xFFFF : (uint16_t) result.elapsed);
+    const size_t b = bucket(result.elapsed);
+    m_latency[b]++;
+    m_count++;
+    m_latencySum += result.elapsed;
+
+    const uint64_t slot = uv_now(NetThread::loop()) / kSlotTime;
+    const size_t index  = static_cast<size_t>(slot % kWindowSlots);
+
+    if (m_windowSlots[index] != slot) {
+        m_windowSlots[index] = slot;
+        m_window[index].fill(0);
+    }
+
+    m_window[index][b]++;
 }
 
 
@@ -99,7 +158,7 @@ void xmrig::NetworkState::setPool(const char *host, int port, const char *ip)
     snprintf(pool, sizeof(pool) - 1, "%s:%d", host, port);
 
     m_active = true;
-    m_connectionTime = uv_now(uv_default_loop());
+    m_connectionTime = uv_now(NetThread::loop());
 }
 
 
@@ -109,5 +168,42 @@ void xmrig::NetworkState::stop()
     diff     = 0;
 
     failures++;
-    m_latency.clear();
+    m_count      = 0;
+    m_latencySum = 0;
+    m_latency.fill(0);
+
+    for (auto &slot : m_window) {
+        slot.fill(0);
+    }
+}
+
+
+size_t xmrig::NetworkState::bucket(uint64_t latency)
+{
+    const uint32_t value = latency > 0xFFFF ? 0xFFFF : static_cast<uint32_t>(latency);
+    if (value < 16) {
+        return value;
+    }
+
+    uint32_t exponent = 4;
+    while ((value >> (exponent + 1)) != 0) {
+        exponent++;
+    }
+
+    return 16 + (exponent - 4) * 8 + ((value >> (exponent - 3)) & 7);
+}
+
+
+// middle of the bucket, the error is below 1/16 of the value
+uint32_t xmrig::NetworkState::bucketValue(size_t bucket)
+{
+    if (bucket < 16) {
+        return static_cast<uint32_t>(bucket);
+    }
+
+    const uint32_t exponent = static_cast<uint32_t>((bucket - 16) / 8 + 4);
+    const uint32_t sub      = static_cast<uint32_t>((bucket - 16) % 8);
+    const uint32_t width    = 1U << (exponent - 3);
+
+    return ((8 + sub) << (exponent - 3)) + width / 2;
 }
@@ -27,7 +27,8 @@
 
 
 #include <array>
-#include <vector>
+#include <stddef.h>
+#include <stdint.h>
 
 
 namespace xmrig {
@@ -39,11 +40,22 @@ class SubmitResult;
 class NetworkState
 {
 public:
+    // submit latency in ms is counted in log-linear buckets, 8 per power of two above 16 ms, up to 65535 ms
+    constexpr static size_t kLatencyBuckets = 112;
+    constexpr static size_t kWindowSlots    = 15;
+    constexpr static uint64_t kSlotTime     = 60 * 1000;
+
     NetworkState();
 
+    inline uint32_t latency() const { return latency(50); }
+
     int connectionTime() const;
     uint32_t avgTime() const;
-    uint32_t latency() const;
+    uint32_t latency(uint32_t percentile, bool window = false) const;
+    uint64_t latencyCount(uint32_t le) const;
+
+    inline uint64_t latencySum() const { return m_latencySum; }
+    inline uint64_t submits() const    { return m_count; }
     void add(const SubmitResult &result, const char *error);
     void setPool(const char *host, int port, const char *ip);
     void stop();
@@ -57,9 +69,16 @@ public:
     uint64_t total;
 
 private:
+    static size_t bucket(uint64_t latency);
+    static uint32_t bucketValue(size_t bucket);
+
     bool m_active;
-    std::vector<uint16_t> m_latency;
+    std::array<std::array<uint32_t, kLatencyBuckets>, kWindowSlots> m_window { { } };
+    std::array<uint64_t, kLatencyBuckets> m_latency { { } };
+    std::array<uint64_t, kWindowSlots> m_windowSlots { { } };
     uint64_t m_connectionTime;
+    uint64_t m_count;
+    uint64_t m_latencySum;
 };
 
 
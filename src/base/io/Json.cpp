@@ -38,6 +38,17 @@ bool xmrig::Json::getBool(const rapidjson::Value &obj, const char *key, bool def
 }
 
 
+double xmrig::Json::getDouble(const rapidjson::Value &obj, const char *key, double defaultValue)
+{
+    auto i = obj.FindMember(key);
+    if (i != obj.MemberEnd() && i->value.IsNumber()) {
+        return i->value.GetDouble();
+    }
+
+    return defaultValue;
+}
+
+
 const char *xmrig::Json::getString(const rapidjson::Value &obj, const char *key,  const char *defaultValue)
 {
     auto i = obj.FindMember(key);
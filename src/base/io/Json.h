@@ -36,6 +36,7 @@ class Json
 {
 public:
     static bool getBool(const rapidjson::Value &obj, const char *key, bool defaultValue = false);
+    static double getDouble(const rapidjson::Value &obj, const char *key, double defaultValue = 0.0);
     static const char *getString(const rapidjson::Value &obj, const char *key, const char *defaultValue = nullptr);
     static int getInt(const rapidjson::Value &obj, const char *key, int defaultValue = 0);
     static int64_t getInt64(const rapidjson::Value &obj, const char *key, int64_t defaultValue = 0);
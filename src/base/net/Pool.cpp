@@ -24,6 +24,7 @@
  */
 
 
+#include <algorithm>
 #include <assert.h>
 #include <string.h>
 #include <stdlib.h>
@@ -48,14 +49,19 @@
 
 namespace xmrig {
 
+static const char *kAlgos       = "algos";
 static const char *kEnabled     = "enabled";
 static const char *kFingerprint = "tls-fingerprint";
 static const char *kKeepalive   = "keepalive";
+static const char *kKtls        = "tls-ktls";
 static const char *kNicehash    = "nicehash";
 static const char *kPass        = "pass";
+static const char *kPriority    = "priority";
 static const char *kRigId       = "rig-id";
+static const char *kSharesPerMin = "shares-per-minute";
 static const char *kTls         = "tls";
 static const char *kUrl         = "url";
+static const char *kWeight      = "weight";
 static const char *kUser        = "user";
 static const char *kVariant     = "variant";
 
@@ -98,7 +104,11 @@ xmrig::Pool::Pool() :
     m_enabled(true),
     m_nicehash(false),
     m_tls(false),
+    m_ktls(false),
     m_keepAlive(0),
+    m_priority(0),
+    m_sharesPerMinute(0),
+    m_weight(1),
     m_port(kDefaultPort)
 {
 }
@@ -120,7 +130,11 @@ xmrig::Pool::Pool(const char *url) :
     m_enabled(true),
     m_nicehash(false),
     m_tls(false),
+    m_ktls(false),
     m_keepAlive(0),
+    m_priority(0),
+    m_sharesPerMinute(0),
+    m_weight(1),
     m_port(kDefaultPort)
 {
     parse(url);
@@ -132,7 +146,11 @@ xmrig::Pool::Pool(const rapidjson::Value &object) :
     m_enabled(true),
     m_nicehash(false),
     m_tls(false),
+    m_ktls(false),
     m_keepAlive(0),
+    m_priority(0),
+    m_sharesPerMinute(0),
+    m_weight(1),
     m_port(kDefaultPort)
 {
     if (!parse(Json::getString(object, kUrl))) {
@@ -160,9 +178,36 @@ xmrig::Pool::Pool(const rapidjson::Value &object) :
         algorithm().parseVariant(variant.GetInt());
     }
 
+    // optional list of algorithms the pool can serve instead of all supported ones
+    const rapidjson::Value &algos = object[kAlgos];
+    if (algos.IsArray()) {
+        Algorithms algorithms;
+        for (const rapidjson::Value &value : algos.GetArray()) {
+            if (!value.IsString()) {
+                continue;
+            }
+
+            const Algorithm algorithm(value.GetString());
+            if (algorithm.isValid()) {
+                algorithms.push_back(algorithm);
+            }
+        }
+
+        if (!algorithms.empty()) {
+            m_algorithms = algorithms;
+        }
+    }
+
+    // pools with the same priority are one group for the latency strategy, lower value is preferred
+    m_priority    = Json::getInt(object, kPriority);
+    m_weight      = std::max(Json::getInt(object, kWeight, 1), 1);
     m_enabled     = Json::getBool(object, kEnabled, true);
     m_tls         = Json::getBool(object, kTls);
     m_fingerprint = Json::getString(object, kFingerprint);
+    m_ktls        = Json::getBool(object, kKtls);
+
+    // fixed difficulty requested at login instead of vardiff, see Client::fixedDiff
+    m_sharesPerMinute = std::max(Json::getInt(object, kSharesPerMin), 0);
 }
 
 
@@ -171,7 +216,11 @@ xmrig::Pool::Pool(const char *host, uint16_t port, const char *user, const char
     m_enabled(true),
     m_nicehash(nicehash),
     m_tls(tls),
+    m_ktls(false),
     m_keepAlive(keepAlive),
+    m_priority(0),
+    m_sharesPerMinute(0),
+    m_weight(1),
     m_host(host),
     m_password(password),
     m_user(user),
@@ -226,7 +275,11 @@ bool xmrig::Pool::isEqual(const Pool &other) const
     return (m_nicehash       == other.m_nicehash
             && m_enabled     == other.m_enabled
             && m_tls         == other.m_tls
+            && m_ktls        == other.m_ktls
             && m_keepAlive   == other.m_keepAlive
+            && m_priority    == other.m_priority
+            && m_weight      == other.m_weight
+            && m_sharesPerMinute == other.m_sharesPerMinute
             && m_port        == other.m_port
             && m_algorithm   == other.m_algorithm
             && m_fingerprint == other.m_fingerprint
@@ -343,9 +396,22 @@ rapidjson::Value xmrig::Pool::toJSON(rapidjson::Document &doc) const
         break;
     }
 
+    if (m_algorithms != all_algorithms()) {
+        Value algos(kArrayType);
+        for (const Algorithm &algorithm : m_algorithms) {
+            algos.PushBack(StringRef(algorithm.shortName()), allocator);
+        }
+
+        obj.AddMember(StringRef(kAlgos), algos, allocator);
+    }
+
+    obj.AddMember(StringRef(kPriority),    m_priority, allocator);
+    obj.AddMember(StringRef(kWeight),      m_weight, allocator);
     obj.AddMember(StringRef(kEnabled),     m_enabled, allocator);
     obj.AddMember(StringRef(kTls),         isTLS(), allocator);
     obj.AddMember(StringRef(kFingerprint), m_fingerprint.toJSON(), allocator);
+    obj.AddMember(StringRef(kKtls),        m_ktls, allocator);
+    obj.AddMember(StringRef(kSharesPerMin), m_sharesPerMinute, allocator);
 
     return obj;
 }
@@ -370,6 +436,12 @@ void xmrig::Pool::setAlgo(const xmrig::Algorithm &algorithm)
 }
 
 
+xmrig::Algorithms xmrig::Pool::supportedAlgorithms()
+{
+    return all_algorithms();
+}
+
+
 #ifdef APP_DEBUG
 void xmrig::Pool::print() const
 {
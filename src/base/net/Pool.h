@@ -59,6 +59,7 @@ public:
        );
 
     inline bool isNicehash() const                      { return m_nicehash; }
+    inline bool isKTLS() const                          { return m_ktls; }
     inline bool isTLS() const                           { return m_tls; }
     inline bool isValid() const                         { return !m_host.isNull() && m_port > 0; }
     inline const char *fingerprint() const              { return m_fingerprint.data(); }
@@ -70,7 +71,11 @@ public:
     inline const Algorithm &algorithm() const           { return m_algorithm; }
     inline const Algorithms &algorithms() const         { return m_algorithms; }
     inline int keepAlive() const                        { return m_keepAlive; }
+    inline int priority() const                         { return m_priority; }
+    inline int sharesPerMinute() const                  { return m_sharesPerMinute; }
+    inline int weight() const                           { return m_weight; }
     inline uint16_t port() const                        { return m_port; }
+    inline void setAlgorithms(const Algorithms &algorithms) { m_algorithms = algorithms; }
     inline void setFingerprint(const char *fingerprint) { m_fingerprint = fingerprint; }
     inline void setKeepAlive(int keepAlive)             { m_keepAlive = keepAlive >= 0 ? keepAlive : 0; }
     inline void setKeepAlive(bool enable)               { setKeepAlive(enable ? kKeepAliveTimeout : 0); }
@@ -93,6 +98,8 @@ public:
     void adjust(const Algorithm &algorithm);
     void setAlgo(const Algorithm &algorithm);
 
+    static Algorithms supportedAlgorithms();
+
 #   ifdef APP_DEBUG
     void print() const;
 #   endif
@@ -106,7 +113,11 @@ private:
     bool m_enabled;
     bool m_nicehash;
     bool m_tls;
+    bool m_ktls;
     int m_keepAlive;
+    int m_priority;
+    int m_sharesPerMinute;
+    int m_weight;
     String m_fingerprint;
     String m_host;
     String m_password;
@@ -23,16 +23,24 @@
  */
 
 
+#include <string.h>
+
+
 #include "base/net/Pools.h"
 #include "common/log/Log.h"
 #include "common/net/strategies/FailoverStrategy.h"
+#include "common/net/strategies/LatencyStrategy.h"
+#include "common/net/strategies/ProfitStrategy.h"
 #include "common/net/strategies/SinglePoolStrategy.h"
+#include "common/net/strategies/WeightedStrategy.h"
 #include "rapidjson/document.h"
 
 
 xmrig::Pools::Pools() :
     m_retries(5),
-    m_retryPause(5)
+    m_retryPause(5),
+    m_standby(0),
+    m_strategy(STRATEGY_FAILOVER)
 {
 #   ifdef XMRIG_PROXY_PROJECT
     m_retries    = 2;
@@ -53,7 +61,7 @@ xmrig::Pool &xmrig::Pools::current()
 
 bool xmrig::Pools::isEqual(const Pools &other) const
 {
-    if (m_data.size() != other.m_data.size() || m_retries != other.m_retries || m_retryPause != other.m_retryPause) {
+    if (m_data.size() != other.m_data.size() || m_retries != other.m_retries || m_retryPause != other.m_retryPause || m_standby != other.m_standby || m_strategy != other.m_strategy) {
         return false;
     }
 
@@ -90,7 +98,41 @@ xmrig::IStrategy *xmrig::Pools::createStrategy(IStrategyListener *listener) cons
         }
     }
 
+    if (m_strategy == STRATEGY_LATENCY) {
+        LatencyStrategy *strategy = new LatencyStrategy(retryPause(), retries(), listener);
+        for (const Pool &pool : m_data) {
+            if (pool.isEnabled()) {
+                strategy->add(pool);
+            }
+        }
+
+        return strategy;
+    }
+
+    if (m_strategy == STRATEGY_WEIGHTED) {
+        WeightedStrategy *strategy = new WeightedStrategy(retryPause(), retries(), listener);
+        for (const Pool &pool : m_data) {
+            if (pool.isEnabled()) {
+                strategy->add(pool);
+            }
+        }
+
+        return strategy;
+    }
+
+    if (m_strategy == STRATEGY_PROFIT) {
+        ProfitStrategy *strategy = new ProfitStrategy(retryPause(), retries(), listener);
+        for (const Pool &pool : m_data) {
+            if (pool.isEnabled()) {
+                strategy->add(pool);
+            }
+        }
+
+        return strategy;
+    }
+
     FailoverStrategy *strategy = new FailoverStrategy(retryPause(), retries(), listener);
+    strategy->setStandby(standby());
     for (const Pool &pool : m_data) {
         if (pool.isEnabled()) {
             strategy->add(pool);
@@ -101,6 +143,26 @@ xmrig::IStrategy *xmrig::Pools::createStrategy(IStrategyListener *listener) cons
 }
 
 
+const char *xmrig::Pools::strategyName() const
+{
+    switch (m_strategy) {
+    case STRATEGY_LATENCY:
+        return "latency";
+
+    case STRATEGY_WEIGHTED:
+        return "weighted";
+
+    case STRATEGY_PROFIT:
+        return "profit";
+
+    default:
+        break;
+    }
+
+    return "failover";
+}
+
+
 rapidjson::Value xmrig::Pools::toJSON(rapidjson::Document &doc) const
 {
     using namespace rapidjson;
@@ -205,3 +267,32 @@ void xmrig::Pools::setRetryPause(int retryPause)
         m_retryPause = retryPause;
     }
 }
+
+
+void xmrig::Pools::setStandby(int standby)
+{
+    if (standby >= 0 && standby <= 16) {
+        m_standby = standby;
+    }
+}
+
+
+void xmrig::Pools::setStrategy(const char *strategy)
+{
+    if (strategy == nullptr) {
+        return;
+    }
+
+    if (strcmp(strategy, "latency") == 0) {
+        m_strategy = STRATEGY_LATENCY;
+    }
+    else if (strcmp(strategy, "weighted") == 0) {
+        m_strategy = STRATEGY_WEIGHTED;
+    }
+    else if (strcmp(strategy, "profit") == 0) {
+        m_strategy = STRATEGY_PROFIT;
+    }
+    else if (strcmp(strategy, "failover") == 0) {
+        m_strategy = STRATEGY_FAILOVER;
+    }
+}
@@ -42,12 +42,21 @@ class IStrategyListener;
 class Pools
 {
 public:
+    enum Strategy {
+        STRATEGY_FAILOVER,
+        STRATEGY_LATENCY,
+        STRATEGY_WEIGHTED,
+        STRATEGY_PROFIT
+    };
+
     Pools();
 
     inline bool setUserpass(const char *userpass)       { return current().setUserpass(userpass); }
     inline const std::vector<Pool> &data() const        { return m_data; }
     inline int retries() const                          { return m_retries; }
     inline int retryPause() const                       { return m_retryPause; }
+    inline int standby() const                          { return m_standby; }
+    inline Strategy strategy() const                    { return m_strategy; }
     inline void setFingerprint(const char *fingerprint) { current().setFingerprint(fingerprint); }
     inline void setKeepAlive(bool enable)               { current().setKeepAlive(enable); }
     inline void setKeepAlive(int keepAlive)             { current().setKeepAlive(keepAlive); }
@@ -64,6 +73,7 @@ public:
 
     bool isEqual(const Pools &other) const;
     bool setUrl(const char *url);
+    const char *strategyName() const;
     IStrategy *createStrategy(IStrategyListener *listener) const;
     rapidjson::Value toJSON(rapidjson::Document &doc) const;
     size_t active() const;
@@ -72,12 +82,16 @@ public:
     void print() const;
     void setRetries(int retries);
     void setRetryPause(int retryPause);
+    void setStandby(int standby);
+    void setStrategy(const char *strategy);
 
 private:
     Pool &current();
 
     int m_retries;
     int m_retryPause;
+    int m_standby;
+    Strategy m_strategy;
     std::vector<Pool> m_data;
 };
 
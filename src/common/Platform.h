@@ -36,11 +36,13 @@ class Platform
 {
 public:
     static bool setThreadAffinity(uint64_t cpu_id);
+    static int64_t inputIdleTime();
     static uint32_t setTimerResolution(uint32_t resolution);
     static void init(const char *userAgent);
     static void restoreTimerResolution();
     static void setProcessPriority(int priority);
     static void setThreadPriority(int priority);
+    static uint64_t threadCpuTime();
 
     static inline const char *userAgent() { return m_userAgent; }
 
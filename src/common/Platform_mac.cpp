@@ -22,8 +22,10 @@
  */
 
 
+#include <mach/mach.h>
 #include <mach/thread_act.h>
 #include <mach/thread_policy.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/resource.h>
@@ -122,3 +124,24 @@ void Platform::setThreadPriority(int priority)
     setpriority(PRIO_PROCESS, 0, prio);
 }
 
+
+// CPU time of the calling thread in ns
+uint64_t Platform::threadCpuTime()
+{
+    thread_basic_info_data_t info;
+    mach_msg_type_number_t count = THREAD_BASIC_INFO_COUNT;
+
+    if (thread_info(pthread_mach_thread_np(pthread_self()), THREAD_BASIC_INFO, reinterpret_cast<thread_info_t>(&info), &count) != KERN_SUCCESS) {
+        return 0;
+    }
+
+    return (static_cast<uint64_t>(info.user_time.seconds) + static_cast<uint64_t>(info.system_time.seconds)) * 1000000000ULL +
+           (static_cast<uint64_t>(info.user_time.microseconds) + static_cast<uint64_t>(info.system_time.microseconds)) * 1000ULL;
+}
+
+
+// there is no session wide input time without linking a display server, other GPU clients tell about the desktop instead
+int64_t Platform::inputIdleTime()
+{
+    return -1;
+}
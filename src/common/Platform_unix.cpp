@@ -35,6 +35,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/resource.h>
+#include <time.h>
 #include <unistd.h>
 #include <uv.h>
 
@@ -160,3 +161,22 @@ void Platform::setThreadPriority(int priority)
     }
 #   endif
 }
+
+
+// CPU time of the calling thread in ns
+uint64_t Platform::threadCpuTime()
+{
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+        return 0;
+    }
+
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+
+// there is no session wide input time without linking a display server, other GPU clients tell about the desktop instead
+int64_t Platform::inputIdleTime()
+{
+    return -1;
+}
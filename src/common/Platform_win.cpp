@@ -202,3 +202,31 @@ void Platform::setThreadPriority(int priority)
     SetThreadPriority(GetCurrentThread(), prio);
 }
 
+
+// CPU time of the calling thread in ns
+uint64_t Platform::threadCpuTime()
+{
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+        return 0;
+    }
+
+    const uint64_t kernelTime = (static_cast<uint64_t>(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime;
+    const uint64_t userTime   = (static_cast<uint64_t>(user.dwHighDateTime) << 32) | user.dwLowDateTime;
+
+    return (kernelTime + userTime) * 100;
+}
+
+
+// ms since the last keyboard or mouse input of the session, -1 if it is not known
+int64_t Platform::inputIdleTime()
+{
+    LASTINPUTINFO info;
+    info.cbSize = sizeof(info);
+
+    if (!GetLastInputInfo(&info)) {
+        return -1;
+    }
+
+    return static_cast<int64_t>(static_cast<DWORD>(GetTickCount() - info.dwTime));
+}
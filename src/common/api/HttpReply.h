@@ -37,11 +37,15 @@ class HttpReply
 public:
     HttpReply() :
         buf(nullptr),
+        contentType(nullptr),
+        etag(nullptr),
         status(200),
         size(0)
     {}
 
     char *buf;
+    const char *contentType;
+    const char *etag;
     int status;
     size_t size;
 };
@@ -55,6 +55,9 @@ xmrig::HttpRequest::HttpRequest(MHD_Connection *connection, const char *url, con
     else if (strcmp(method, MHD_HTTP_METHOD_PUT) == 0) {
         m_method = Put;
     }
+    else if (strcmp(method, "PATCH") == 0) {
+        m_method = Patch;
+    }
 }
 
 
@@ -128,25 +131,39 @@ const char *xmrig::HttpRequest::body() const
 }
 
 
+const char *xmrig::HttpRequest::header(const char *name) const
+{
+    return MHD_lookup_connection_value(m_connection, MHD_HEADER_KIND, name);
+}
+
+
 int xmrig::HttpRequest::end(const HttpReply &reply)
 {
+    MHD_Response *rsp = nullptr;
     if (reply.buf) {
-        return end(reply.status, MHD_create_response_from_buffer(reply.size ? reply.size : strlen(reply.buf), (void*) reply.buf, MHD_RESPMEM_MUST_FREE));
+        rsp = MHD_create_response_from_buffer(reply.size ? reply.size : strlen(reply.buf), (void*) reply.buf, MHD_RESPMEM_MUST_FREE);
+    }
+    else if (reply.etag) {
+        rsp = MHD_create_response_from_buffer(0, nullptr, MHD_RESPMEM_PERSISTENT);
+    }
+
+    if (rsp && reply.etag) {
+        MHD_add_response_header(rsp, "ETag", reply.etag);
     }
 
-    return end(reply.status, nullptr);
+    return end(reply.status, rsp, reply.contentType);
 }
 
 
-int xmrig::HttpRequest::end(int status, MHD_Response *rsp)
+int xmrig::HttpRequest::end(int status, MHD_Response *rsp, const char *contentType)
 {
     if (!rsp) {
         rsp = MHD_create_response_from_buffer(0, nullptr, MHD_RESPMEM_PERSISTENT);
     }
 
-    MHD_add_response_header(rsp, "Content-Type", "application/json");
+    MHD_add_response_header(rsp, "Content-Type", contentType ? contentType : "application/json");
     MHD_add_response_header(rsp, "Access-Control-Allow-Origin", "*");
-    MHD_add_response_header(rsp, "Access-Control-Allow-Methods", "GET, PUT");
+    MHD_add_response_header(rsp, "Access-Control-Allow-Methods", "GET, PUT, PATCH");
     MHD_add_response_header(rsp, "Access-Control-Allow-Headers", "Authorization, Content-Type");
 
     const int ret = MHD_queue_response(m_connection, status, rsp);
@@ -47,7 +47,8 @@ public:
         Unsupported,
         Options,
         Get,
-        Put
+        Put,
+        Patch
     };
 
     HttpRequest(MHD_Connection *connection, const char *url, const char *method, const char *uploadData, size_t *uploadSize, void **cls);
@@ -56,12 +57,14 @@ public:
     inline bool isFulfilled() const  { return m_fulfilled; }
     inline bool isRestricted() const { return m_restricted; }
     inline Method method() const     { return m_method; }
+    inline const char *url() const   { return m_url; }
 
     bool match(const char *path) const;
     bool process(const char *accessToken, bool restricted, xmrig::HttpReply &reply);
     const char *body() const;
+    const char *header(const char *name) const;
     int end(const HttpReply &reply);
-    int end(int status, MHD_Response *rsp);
+    int end(int status, MHD_Response *rsp, const char *contentType = nullptr);
 
 private:
     int auth(const char *accessToken);
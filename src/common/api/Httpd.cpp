@@ -27,15 +27,20 @@
 
 
 #include "api/Api.h"
+#include "api/EventStream.h"
 #include "common/api/Httpd.h"
 #include "common/api/HttpReply.h"
 #include "common/api/HttpRequest.h"
 #include "common/log/Log.h"
 
 
+Httpd *Httpd::m_self = nullptr;
+
+
 Httpd::Httpd(int port, const char *accessToken, bool IPv6, bool restricted) :
     m_idle(true),
     m_IPv6(IPv6),
+    m_polling(false),
     m_restricted(restricted),
     m_accessToken(accessToken ? strdup(accessToken) : nullptr),
     m_port(port),
@@ -43,12 +48,22 @@ Httpd::Httpd(int port, const char *accessToken, bool IPv6, bool restricted) :
 {
     uv_timer_init(uv_default_loop(), &m_timer);
     m_timer.data = this;
+
+    uv_async_init(uv_default_loop(), &m_async, Httpd::onAsync);
+    m_async.data = this;
 }
 
 
 Httpd::~Httpd()
 {
+    m_self = nullptr;
+
     uv_timer_stop(&m_timer);
+    uv_close(reinterpret_cast<uv_handle_t*>(&m_async), nullptr);
+
+    if (m_polling) {
+        uv_poll_stop(&m_poll);
+    }
 
     if (m_daemon) {
         MHD_stop_daemon(m_daemon);
@@ -81,6 +96,25 @@ bool Httpd::start()
         return false;
     }
 
+    m_self = this;
+
+    // the epoll fd of MHD becomes readable on new connections and traffic of all connections
+#   if MHD_VERSION >= 0x00093500
+    if (flags & MHD_USE_EPOLL_LINUX_ONLY) {
+        const MHD_DaemonInfo *info = MHD_get_daemon_info(m_daemon, MHD_DAEMON_INFO_EPOLL_FD_LINUX_ONLY);
+
+        if (info && uv_poll_init(uv_default_loop(), &m_poll, info->epoll_fd) == 0) {
+            m_poll.data = this;
+            m_polling   = uv_poll_start(&m_poll, UV_READABLE, Httpd::onPoll) == 0;
+        }
+    }
+#   endif
+
+    if (m_polling) {
+        schedule();
+        return true;
+    }
+
 #   if MHD_VERSION >= 0x00093900
     uv_timer_start(&m_timer, Httpd::onTimer, kIdleInterval, kIdleInterval);
 #   else
@@ -91,6 +125,15 @@ bool Httpd::start()
 }
 
 
+// new events of /1/events are written on the next loop iteration instead of the next poll
+void Httpd::wakeup()
+{
+    if (m_self && m_self->m_polling) {
+        uv_async_send(&m_self->m_async);
+    }
+}
+
+
 int Httpd::process(xmrig::HttpRequest &req)
 {
     xmrig::HttpReply reply;
@@ -102,6 +145,12 @@ int Httpd::process(xmrig::HttpRequest &req)
         return MHD_YES;
     }
 
+    if (req.method() == xmrig::HttpRequest::Get && req.match("/1/events")) {
+        MHD_Response *rsp = EventStream::subscribe();
+
+        return rsp ? req.end(MHD_HTTP_OK, rsp, "text/event-stream") : req.end(MHD_HTTP_SERVICE_UNAVAILABLE, nullptr);
+    }
+
     Api::exec(req, reply);
 
     return req.end(reply);
@@ -112,6 +161,11 @@ void Httpd::run()
 {
     MHD_run(m_daemon);
 
+    if (m_polling) {
+        schedule();
+        return;
+    }
+
 #   if MHD_VERSION >= 0x00093900
     const MHD_DaemonInfo *info = MHD_get_daemon_info(m_daemon, MHD_DAEMON_INFO_CURRENT_CONNECTIONS);
     if (m_idle && info->num_connections) {
@@ -126,6 +180,24 @@ void Httpd::run()
 }
 
 
+// MHD_get_timeout covers connection timeouts and connections with work left, a stream waiting for events also asks for
+// an immediate run, it is woken by wakeup() instead and only checked at the idle interval
+void Httpd::schedule()
+{
+    MHD_UNSIGNED_LONG_LONG timeout = 0;
+    if (MHD_get_timeout(m_daemon, &timeout) != MHD_YES) {
+        uv_timer_stop(&m_timer);
+        return;
+    }
+
+    if (timeout == 0 && EventStream::isActive() && !EventStream::isPending()) {
+        timeout = kIdleInterval;
+    }
+
+    uv_timer_start(&m_timer, Httpd::onTimer, timeout, 0);
+}
+
+
 int Httpd::handler(void *cls, struct MHD_Connection *connection, const char *url, const char *method, const char *version, const char *uploadData, size_t *uploadSize, void **con_cls)
 {
     xmrig::HttpRequest req(connection, url, method, uploadData, uploadSize, con_cls);
@@ -142,6 +214,22 @@ int Httpd::handler(void *cls, struct MHD_Connection *connection, const char *url
 }
 
 
+void Httpd::onAsync(uv_async_t *handle)
+{
+    static_cast<Httpd*>(handle->data)->run();
+}
+
+
+void Httpd::onPoll(uv_poll_t *handle, int status, int)
+{
+    if (status < 0) {
+        return;
+    }
+
+    static_cast<Httpd*>(handle->data)->run();
+}
+
+
 void Httpd::onTimer(uv_timer_t *handle)
 {
     static_cast<Httpd*>(handle->data)->run();
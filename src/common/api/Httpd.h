@@ -48,22 +48,32 @@ public:
     ~Httpd();
     bool start();
 
+    static void wakeup();
+
 private:
     constexpr static const int kIdleInterval   = 200;
     constexpr static const int kActiveInterval = 25;
 
     int process(xmrig::HttpRequest &req);
     void run();
+    void schedule();
 
     static int handler(void *cls, MHD_Connection *connection, const char *url, const char *method, const char *version, const char *uploadData, size_t *uploadSize, void **con_cls);
+    static void onAsync(uv_async_t *handle);
+    static void onPoll(uv_poll_t *handle, int status, int events);
     static void onTimer(uv_timer_t *handle);
 
+    static Httpd *m_self;
+
     bool m_idle;
     bool m_IPv6;
+    bool m_polling;  // MHD is woken by its epoll fd and timeouts, otherwise it runs from the timer
     bool m_restricted;
     const char *m_accessToken;
     const int m_port;
     MHD_Daemon *m_daemon;
+    uv_async_t m_async;
+    uv_poll_t m_poll;
     uv_timer_t m_timer;
 };
 
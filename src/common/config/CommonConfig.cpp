@@ -73,6 +73,7 @@ xmrig::CommonConfig::CommonConfig() :
     m_autoSave(true),
     m_background(false),
     m_dryRun(false),
+    m_logAsync(false),
     m_calibrateAlgo(false),
     m_calibrateAlgoTime(60),
     m_syslog(false),
@@ -223,6 +224,10 @@ bool xmrig::CommonConfig::parseBoolean(int key, bool enable)
         m_syslog = enable;
         break;
 
+    case LogAsyncKey: /* --log-async */
+        m_logAsync = enable;
+        break;
+
     case KeepAliveKey: /* --keepalive */
         m_pools.setKeepAlive(enable);
         break;
@@ -326,14 +331,20 @@ bool xmrig::CommonConfig::parseString(int key, const char *arg)
         m_userAgent = arg;
         break;
 
+    case PoolStrategyKey: /* --pool-strategy */
+        m_pools.setStrategy(arg);
+        break;
+
     case RetriesKey:     /* --retries */
     case RetryPauseKey:  /* --retry-pause */
+    case PoolStandbyKey: /* --pool-standby */
     case ApiPort:        /* --api-port */
     case PrintTimeKey:   /* --print-time */
         return parseUint64(key, strtol(arg, nullptr, 10));
 
     case BackgroundKey: /* --background */
     case SyslogKey:     /* --syslog */
+    case LogAsyncKey:   /* --log-async */
     case KeepAliveKey:  /* --keepalive */
     case NicehashKey:   /* --nicehash */
     case TlsKey:        /* --tls */
@@ -399,6 +410,10 @@ bool xmrig::CommonConfig::parseInt(int key, int arg)
         m_pools.setRetryPause(arg);
         break;
 
+    case PoolStandbyKey: /* --pool-standby */
+        m_pools.setStandby(arg);
+        break;
+
     case KeepAliveKey: /* --keepalive */
         m_pools.setKeepAlive(arg);
         break;
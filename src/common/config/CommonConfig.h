@@ -46,6 +46,7 @@ public:
     inline bool isAutoSave() const                 { return m_autoSave; }
     inline bool isBackground() const               { return m_background; }
     inline bool isDryRun() const                   { return m_dryRun; }
+    inline bool isLogAsync() const                 { return m_logAsync; }
     inline bool isCalibrateAlgo() const            { return m_calibrateAlgo; }
     inline int  calibrateAlgoTime() const          { return m_calibrateAlgoTime; }
     inline bool isSyslog() const                   { return m_syslog; }
@@ -93,6 +94,7 @@ protected:
     bool m_autoSave;
     bool m_background;
     bool m_dryRun;
+    bool m_logAsync;
     bool m_calibrateAlgo;
     int  m_calibrateAlgoTime;
     bool m_syslog;
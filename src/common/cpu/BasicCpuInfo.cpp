@@ -44,8 +44,13 @@
 #   define bit_AVX2 (1 << 5)
 #endif
 
+#ifndef bit_AVX512F
+#   define bit_AVX512F (1 << 16)
+#endif
+
 
 #include "common/cpu/BasicCpuInfo.h"
+#include "common/cpu/Cgroup.h"
 
 
 #define VENDOR_ID                  (0)
@@ -111,6 +116,15 @@ static inline bool has_avx2()
 }
 
 
+static inline bool has_avx512f()
+{
+    int32_t cpu_info[4] = { 0 };
+    cpuid(EXTENDED_FEATURES, cpu_info);
+
+    return (cpu_info[EBX_Reg] & bit_AVX512F) != 0;
+}
+
+
 static inline bool has_ossave()
 {
     int32_t cpu_info[4] = { 0 };
@@ -120,12 +134,32 @@ static inline bool has_ossave()
 }
 
 
+// the OS must save the opmask and both halves of the upper ZMM registers (XCR0 bits 5-7) in addition to SSE/AVX state
+static inline bool has_os_avx512()
+{
+    if (!has_ossave()) {
+        return false;
+    }
+
+#   ifdef _MSC_VER
+    const uint64_t xcr0 = _xgetbv(0);
+#   else
+    uint32_t eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    const uint64_t xcr0 = (static_cast<uint64_t>(edx) << 32) | eax;
+#   endif
+
+    return (xcr0 & 0xE6) == 0xE6;
+}
+
+
 xmrig::BasicCpuInfo::BasicCpuInfo() :
     m_assembly(ASM_NONE),
     m_aes(has_aes_ni()),
     m_avx2(has_avx2() && has_ossave()),
+    m_avx512(has_avx512f() && has_os_avx512()),
     m_brand(),
-    m_threads(std::thread::hardware_concurrency())
+    m_threads(Cgroup::threads(static_cast<int32_t>(std::thread::hardware_concurrency())))
 {
     cpu_brand_string(m_brand);
 
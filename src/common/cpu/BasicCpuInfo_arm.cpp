@@ -32,13 +32,15 @@
 
 
 #include "common/cpu/BasicCpuInfo.h"
+#include "common/cpu/Cgroup.h"
 
 
 xmrig::BasicCpuInfo::BasicCpuInfo() :
     m_aes(false),
     m_avx2(false),
+    m_avx512(false),
     m_brand(),
-    m_threads(std::thread::hardware_concurrency())
+    m_threads(Cgroup::threads(static_cast<int32_t>(std::thread::hardware_concurrency())))
 {
 #   ifdef XMRIG_ARMv8
     memcpy(m_brand, "ARMv8", 5);
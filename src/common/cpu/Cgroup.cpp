@@ -0,0 +1,244 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#   include <sched.h>
+#   include <unistd.h>
+#endif
+
+
+#include "common/cpu/Cgroup.h"
+
+
+static double quotaCpus      = 0.0;
+static int32_t affinityCount = 0;
+static uint64_t affinityMask = 0;
+
+
+#ifdef __linux__
+static bool unified = false;
+static std::string hugetlb;
+
+
+static bool readFile(const std::string &path, char *buf, size_t size)
+{
+    FILE *fp = fopen(path.c_str(), "r");
+    if (!fp) {
+        return false;
+    }
+
+    const bool result = fgets(buf, static_cast<int>(size), fp) != nullptr;
+    fclose(fp);
+
+    return result;
+}
+
+
+// directory of a controller of the cgroup of the process, the mount root when a cgroup namespace hides the path,
+// lines of /proc/self/cgroup are "0::/path" with v2 and "id:cpu,cpuacct:/path" with v1
+static std::string directory(const char *controller)
+{
+    FILE *fp = fopen("/proc/self/cgroup", "r");
+    if (!fp) {
+        return std::string();
+    }
+
+    std::string result;
+    char line[512];
+
+    while (fgets(line, sizeof(line), fp)) {
+        char *controllers = strchr(line, ':');
+        char *path        = controllers ? strchr(controllers + 1, ':') : nullptr;
+        if (!path) {
+            continue;
+        }
+
+        *path++ = '\0';
+        path[strcspn(path, "\n")] = '\0';
+
+        std::string root;
+        if (unified) {
+            root = "/sys/fs/cgroup";
+        }
+        else {
+            const std::string list = std::string(",") + (controllers + 1) + ",";
+            if (list.find(std::string(",") + controller + ",") == std::string::npos) {
+                continue;
+            }
+
+            root = std::string("/sys/fs/cgroup/") + (controllers + 1);
+        }
+
+        result = root + path;
+        if (access(result.c_str(), F_OK) != 0) {
+            result = root;
+        }
+
+        break;
+    }
+
+    fclose(fp);
+
+    return access(result.c_str(), F_OK) == 0 ? result : std::string();
+}
+
+
+// v1 reports no limit as the largest page aligned value
+static int64_t readLimit(const std::string &path)
+{
+    char buf[64] = { 0 };
+    if (!readFile(path, buf, sizeof(buf)) || strncmp(buf, "max", 3) == 0) {
+        return -1;
+    }
+
+    const long long value = strtoll(buf, nullptr, 10);
+
+    return value >= 0 && value < (1LL << 62) ? value : -1;
+}
+
+
+static std::string hugetlbFile(size_t pageSize, const char *v2, const char *v1)
+{
+    return hugetlb + (pageSize >= 1024 * 1024 * 1024 ? "/hugetlb.1GB." : "/hugetlb.2MB.") + (unified ? v2 : v1);
+}
+#endif
+
+
+bool xmrig::Cgroup::isLimited()
+{
+    const int32_t hardware = static_cast<int32_t>(std::thread::hardware_concurrency());
+
+    return quotaCpus > 0.0 || (affinityCount > 0 && affinityCount < hardware) || hugetlbLimit(2 * 1024 * 1024) >= 0;
+}
+
+
+// CPUs of the CPU quota, 0 without quota
+double xmrig::Cgroup::cpuQuota()
+{
+    return quotaCpus;
+}
+
+
+// threads the process can keep busy, the quota rounded up and the CPUs of the cpuset
+int32_t xmrig::Cgroup::threads(int32_t threads)
+{
+    if (affinityCount > 0) {
+        threads = threads > 0 ? std::min(threads, affinityCount) : affinityCount;
+    }
+
+    if (quotaCpus > 0.0) {
+        threads = std::min(std::max(threads, 1), std::max(1, static_cast<int32_t>(ceil(quotaCpus))));
+    }
+
+    return std::max(threads, 1);
+}
+
+
+// bytes of huge pages the process can still take before the hugetlb controller refuses them, -1 without limit,
+// an exceeded limit is a SIGBUS on the first touch rather than a failed mmap
+int64_t xmrig::Cgroup::hugetlbFree(size_t pageSize)
+{
+#   ifdef __linux__
+    const int64_t limit = hugetlbLimit(pageSize);
+    if (limit < 0) {
+        return -1;
+    }
+
+    const int64_t usage = readLimit(hugetlbFile(pageSize, "current", "usage_in_bytes"));
+
+    return std::max<int64_t>(limit - std::max<int64_t>(usage, 0), 0);
+#   else
+    return -1;
+#   endif
+}
+
+
+int64_t xmrig::Cgroup::hugetlbLimit(size_t pageSize)
+{
+#   ifdef __linux__
+    return hugetlb.empty() ? -1 : readLimit(hugetlbFile(pageSize, "max", "limit_in_bytes"));
+#   else
+    return -1;
+#   endif
+}
+
+
+// CPUs below 64 the process may run on, 0 if unknown
+uint64_t xmrig::Cgroup::cpuMask()
+{
+    return affinityMask;
+}
+
+
+void xmrig::Cgroup::init()
+{
+#   ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        affinityCount = CPU_COUNT(&set);
+
+        for (int i = 0; i < 64; ++i) {
+            if (CPU_ISSET(i, &set)) {
+                affinityMask |= 1ULL << i;
+            }
+        }
+    }
+
+    unified = access("/sys/fs/cgroup/cgroup.controllers", F_OK) == 0;
+
+    const std::string cpu = directory("cpu");
+    if (!cpu.empty()) {
+        char buf[64] = { 0 };
+        long long quota  = -1;
+        long long period = 0;
+
+        if (unified && readFile(cpu + "/cpu.max", buf, sizeof(buf))) {
+            if (sscanf(buf, "%lld %lld", &quota, &period) != 2) {
+                quota = -1;
+            }
+        }
+        else if (!unified) {
+            quota  = readLimit(cpu + "/cpu.cfs_quota_us");
+            period = readLimit(cpu + "/cpu.cfs_period_us");
+        }
+
+        if (quota > 0 && period > 0) {
+            quotaCpus = static_cast<double>(quota) / period;
+        }
+    }
+
+    hugetlb = directory("hugetlb");
+#   endif
+}
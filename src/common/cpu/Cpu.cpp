@@ -26,6 +26,7 @@
 
 
 #include "common/cpu/BasicCpuInfo.h"
+#include "common/cpu/Cgroup.h"
 #include "common/cpu/Cpu.h"
 
 
@@ -44,6 +45,9 @@ void xmrig::Cpu::init()
 {
     assert(cpuInfo == nullptr);
 
+    // the thread count of the CPU info is limited to the container
+    Cgroup::init();
+
     cpuInfo = new BasicCpuInfo();
 }
 
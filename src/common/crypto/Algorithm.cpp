@@ -26,6 +26,7 @@
 
 
 #include <assert.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -146,6 +147,96 @@ static const char *variants[] = {
 static_assert(xmrig::VARIANT_MAX == ARRAY_SIZE(variants), "variants size mismatch");
 
 
+// case-insensitive FNV-1a of an ASCII name
+static inline uint32_t nameHash(const char *name)
+{
+    uint32_t hash = 2166136261u;
+    for (; *name; ++name) {
+        const uint8_t c = static_cast<uint8_t>(*name);
+        hash = (hash ^ (c >= 'A' && c <= 'Z' ? c | 0x20 : c)) * 16777619u;
+    }
+
+    return hash;
+}
+
+
+// open addressing index of the names of a table, built once so the names of pool jobs are resolved
+// by a hash and usually a single strcasecmp instead of a walk over the whole table
+template<size_t SLOTS>
+class NameIndex
+{
+public:
+    inline NameIndex() : m_names(), m_values() {}
+
+    // the first entry of a name wins, as with the walk over the table
+    inline void add(const char *name, int value)
+    {
+        size_t slot = nameHash(name) & (SLOTS - 1);
+        while (m_names[slot] && strcasecmp(m_names[slot], name) != 0) {
+            slot = (slot + 1) & (SLOTS - 1);
+        }
+
+        if (!m_names[slot]) {
+            m_names[slot]  = name;
+            m_values[slot] = value;
+        }
+    }
+
+    inline int find(const char *name) const
+    {
+        for (size_t slot = nameHash(name) & (SLOTS - 1); m_names[slot]; slot = (slot + 1) & (SLOTS - 1)) {
+            if (strcasecmp(m_names[slot], name) == 0) {
+                return m_values[slot];
+            }
+        }
+
+        return -1;
+    }
+
+private:
+    static_assert((SLOTS & (SLOTS - 1)) == 0, "slots must be a power of 2");
+
+    const char *m_names[SLOTS];
+    int m_values[SLOTS];
+};
+
+
+// indexes of algorithms by name and short name
+static const NameIndex<256> &algorithmIndex()
+{
+    static_assert(ARRAY_SIZE(algorithms) * 2 <= 128, "algorithm index is too dense");
+
+    static const NameIndex<256> index = [] {
+        NameIndex<256> result;
+        for (size_t i = 0; i < ARRAY_SIZE(algorithms); i++) {
+            result.add(algorithms[i].name, static_cast<int>(i));
+            result.add(algorithms[i].shortName, static_cast<int>(i));
+        }
+
+        return result;
+    }();
+
+    return index;
+}
+
+
+// variants by name, xtlv9 is an alias of half
+static const NameIndex<64> &variantIndex()
+{
+    static const NameIndex<64> index = [] {
+        NameIndex<64> result;
+        for (size_t i = 0; i < ARRAY_SIZE(variants); i++) {
+            result.add(variants[i], static_cast<int>(i));
+        }
+
+        result.add("xtlv9", xmrig::VARIANT_HALF);
+        return result;
+    }();
+
+    return index;
+}
+
+
 bool xmrig::Algorithm::isValid() const
 {
     if (m_algo == INVALID_ALGO) {
@@ -188,12 +279,10 @@ void xmrig::Algorithm::parseAlgorithm(const char *algo)
         return parseAlgorithm(algo + 1);
     }
 
-    for (size_t i = 0; i < ARRAY_SIZE(algorithms); i++) {
-        if ((strcasecmp(algo, algorithms[i].name) == 0) || (strcasecmp(algo, algorithms[i].shortName) == 0)) {
-            m_algo    = algorithms[i].algo;
-            m_variant = algorithms[i].variant;
-            break;
-        }
+    const int i = algorithmIndex().find(algo);
+    if (i >= 0) {
+        m_algo    = algorithms[i].algo;
+        m_variant = algorithms[i].variant;
     }
 
     if (m_algo == INVALID_ALGO) {
@@ -216,15 +305,9 @@ void xmrig::Algorithm::parseVariant(const char *variant)
         return parseVariant(variant + 1);
     }
 
-    for (size_t i = 0; i < ARRAY_SIZE(variants); i++) {
-        if (strcasecmp(variant, variants[i]) == 0) {
-            m_variant = static_cast<Variant>(i);
-            return;
-        }
-    }
-
-    if (strcasecmp(variant, "xtlv9") == 0) {
-        m_variant = VARIANT_HALF;
+    const int i = variantIndex().find(variant);
+    if (i >= 0) {
+        m_variant = static_cast<Variant>(i);
     }
 }
 
@@ -369,6 +452,50 @@ xmrig::Algorithm::Algorithm(const xmrig::PerfAlgo pa) {
     }
 }
 
+// constructs Algorithm from PerfFork
+xmrig::Algorithm::Algorithm(const xmrig::PerfFork pf) : m_flags(0) {
+    switch (pf) {
+       case FORK_CN_MSR:
+           m_algo    = xmrig::CRYPTONIGHT;
+           m_variant = xmrig::VARIANT_MSR;
+           break;
+       case FORK_CN_XAO:
+           m_algo    = xmrig::CRYPTONIGHT;
+           m_variant = xmrig::VARIANT_XAO;
+           break;
+       case FORK_CN_HEAVY_TUBE:
+           m_algo    = xmrig::CRYPTONIGHT_HEAVY;
+           m_variant = xmrig::VARIANT_TUBE;
+           break;
+       default:
+           m_algo    = xmrig::INVALID_ALGO;
+           m_variant = xmrig::VARIANT_AUTO;
+    }
+}
+
+// returns string name of the PerfFork
+const char *xmrig::Algorithm::perfForkName(const xmrig::PerfFork pf) {
+    static const char* perf_fork_names[xmrig::PerfFork::FORK_MAX] = {
+        "cn/msr",
+        "cn/xao",
+        "cn-heavy/tube",
+    };
+    return perf_fork_names[pf];
+}
+
+// returns PerfAlgo whose threads and programs the PerfFork uses
+xmrig::PerfAlgo xmrig::Algorithm::perfForkAlgo(const xmrig::PerfFork pf) {
+    return Algorithm(pf).perf_algo();
+}
+
+// returns PerfFork of current Algorithm, variants with the cn1 kernel of their perf algo (cn/xtl, cn/rto, cn-heavy/xhv) have none
+xmrig::PerfFork xmrig::Algorithm::perf_fork() const {
+    for (int f = 0; f != xmrig::PerfFork::FORK_MAX; ++ f) {
+        if (isEqual(Algorithm(static_cast<xmrig::PerfFork>(f)))) return static_cast<xmrig::PerfFork>(f);
+    }
+    return FORK_INVALID;
+}
+
 // returns PerfAlgo that corresponds to current Algorithm
 xmrig::PerfAlgo xmrig::Algorithm::perf_algo() const {
     switch (m_algo) {
@@ -60,6 +60,8 @@ public:
 
     // constructs Algorithm from PerfAlgo
     Algorithm(const xmrig::PerfAlgo);
+    // constructs Algorithm from PerfFork
+    Algorithm(const xmrig::PerfFork);
 
     inline Algorithm(const char *algo) :
         m_flags(0)
@@ -78,6 +80,9 @@ public:
 
     xmrig::PerfAlgo perf_algo() const; // returns PerfAlgo that corresponds to current Algorithm
     static const char *perfAlgoName(xmrig::PerfAlgo); // returns string name of the PerfAlgo
+    xmrig::PerfFork perf_fork() const; // returns PerfFork of current Algorithm (FORK_INVALID if it runs the perf algo kernels)
+    static const char *perfForkName(xmrig::PerfFork); // returns string name of the PerfFork
+    static xmrig::PerfAlgo perfForkAlgo(xmrig::PerfFork); // returns PerfAlgo whose threads and programs the PerfFork uses
 
     inline bool operator!=(const Algorithm &other) const  { return !isEqual(other); }
     inline bool operator==(const Algorithm &other) const  { return isEqual(other); }
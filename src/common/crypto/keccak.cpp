@@ -27,6 +27,7 @@
 #include <memory.h>
 
 
+#include "common/cpu/Cpu.h"
 #include "common/crypto/keccak.h"
 
 
@@ -37,6 +38,7 @@
 #define ROTL64(x, y) (((x) << (y)) | ((x) >> (64 - (y))))
 #endif
 
+extern const uint64_t keccakf_rndc[24];
 const uint64_t keccakf_rndc[24] = 
 {
     0x0000000000000001, 0x0000000000008082, 0x800000000000808a,
@@ -198,3 +200,79 @@ void xmrig::keccak(const uint8_t *in, int inlen, uint8_t *md, int mdlen)
 
     memcpy(md, st, mdlen);
 }
+
+
+void xmrig::keccakf(uint64_t *const *st, size_t ways, int rounds)
+{
+    size_t i = 0;
+
+#   ifndef XMRIG_ARM
+    if (ways >= 3 && xmrig::Cpu::info()->hasAVX2()) {
+        for (; i + 4 <= ways; i += 4) {
+            keccakf4_avx2(st + i, rounds);
+        }
+
+        // an idle lane is still faster than three scalar states
+        if (ways - i == 3) {
+            uint64_t spare[25] = {};
+            uint64_t *lanes[4] = { st[i], st[i + 1], st[i + 2], spare };
+
+            keccakf4_avx2(lanes, rounds);
+            i += 3;
+        }
+    }
+#   endif
+
+    for (; i < ways; ++i) {
+        keccakf(st[i], rounds);
+    }
+}
+
+
+void xmrig::keccak(const uint8_t *in, size_t inlen, uint8_t *const *md, size_t ways)
+{
+    uint64_t *st[8];
+    uint8_t temp[HASH_DATA_AREA];
+    const size_t rsizw = HASH_DATA_AREA / 8;
+
+    // larger batches are hashed in parts
+    if (ways > 8) {
+        keccak(in, inlen, md, 8);
+        keccak(in + inlen * 8, inlen, md + 8, ways - 8);
+        return;
+    }
+
+    for (size_t w = 0; w < ways; ++w) {
+        st[w] = reinterpret_cast<uint64_t *>(md[w]);
+        memset(st[w], 0, sizeof(state_t));
+    }
+
+    size_t offset = 0;
+    for ( ; inlen - offset >= HASH_DATA_AREA; offset += HASH_DATA_AREA) {
+        for (size_t w = 0; w < ways; ++w) {
+            memcpy(temp, in + inlen * w + offset, HASH_DATA_AREA);
+
+            for (size_t i = 0; i < rsizw; i++) {
+                st[w][i] ^= reinterpret_cast<const uint64_t *>(temp)[i];
+            }
+        }
+
+        keccakf(st, ways, KECCAK_ROUNDS);
+    }
+
+    // last block and padding
+    const size_t last = inlen - offset;
+
+    for (size_t w = 0; w < ways; ++w) {
+        memcpy(temp, in + inlen * w + offset, last);
+        temp[last] = 1;
+        memset(temp + last + 1, 0, HASH_DATA_AREA - last - 1);
+        temp[HASH_DATA_AREA - 1] |= 0x80;
+
+        for (size_t i = 0; i < rsizw; i++) {
+            st[w][i] ^= reinterpret_cast<const uint64_t *>(temp)[i];
+        }
+    }
+
+    keccakf(st, ways, KECCAK_ROUNDS);
+}
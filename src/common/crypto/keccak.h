@@ -50,6 +50,17 @@ inline void keccak(const char *in, size_t inlen, uint8_t *md)
 // update the state
 void keccakf(uint64_t st[25], int norounds);
 
+// update ways states at once, 4 of them at a time on CPUs with AVX2, single and double hashes stay scalar
+void keccakf(uint64_t *const *st, size_t ways, int norounds);
+
+// keccak of ways inputs of inlen bytes each following one another, the 200 byte states go to md,
+// they must be 8 bytes aligned
+void keccak(const uint8_t *in, size_t inlen, uint8_t *const *md, size_t ways);
+
+#ifndef XMRIG_ARM
+void keccakf4_avx2(uint64_t *const *st, int norounds);
+#endif
+
 } /* namespace xmrig */
 
 #endif /* XMRIG_KECCAK_H */
@@ -0,0 +1,126 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik               <jgarzik@pobox.com>
+ * Copyright 2011      Markku-Juhani O. Saarinen <mjos@iki.fi>
+ * Copyright 2012-2014 pooler                    <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones               <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466                  <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee                 <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak                  <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2016-2019 XMRig                     <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifdef __GNUC__
+#   include <x86intrin.h>
+#else
+#   include <intrin.h>
+#endif
+
+
+#include "common/crypto/keccak.h"
+
+
+extern const uint64_t keccakf_rndc[24];
+
+
+#define ROTL64X4(x, y) _mm256_or_si256(_mm256_slli_epi64((x), (y)), _mm256_srli_epi64((x), 64 - (y)))
+#define ANDNOT(a, b)   _mm256_andnot_si256((a), (b))
+#define XOR(a, b)      _mm256_xor_si256((a), (b))
+
+
+// 4 states in the lanes of the AVX2 registers, same steps as the scalar keccakf
+void xmrig::keccakf4_avx2(uint64_t *const *st, int rounds)
+{
+    __m256i s[25];
+    __m256i t, bc[5];
+
+    for (int i = 0; i < 25; ++i) {
+        s[i] = _mm256_set_epi64x(static_cast<int64_t>(st[3][i]), static_cast<int64_t>(st[2][i]), static_cast<int64_t>(st[1][i]), static_cast<int64_t>(st[0][i]));
+    }
+
+    for (int round = 0; round < rounds; ++round) {
+
+        // Theta
+        for (int i = 0; i < 5; ++i) {
+            bc[i] = XOR(XOR(XOR(s[i], s[i + 5]), XOR(s[i + 10], s[i + 15])), s[i + 20]);
+        }
+
+        for (int i = 0; i < 5; ++i) {
+            t = XOR(bc[(i + 4) % 5], ROTL64X4(bc[(i + 1) % 5], 1));
+            s[i     ] = XOR(s[i     ], t);
+            s[i +  5] = XOR(s[i +  5], t);
+            s[i + 10] = XOR(s[i + 10], t);
+            s[i + 15] = XOR(s[i + 15], t);
+            s[i + 20] = XOR(s[i + 20], t);
+        }
+
+        // Rho Pi
+        t = s[1];
+        s[ 1] = ROTL64X4(s[ 6], 44);
+        s[ 6] = ROTL64X4(s[ 9], 20);
+        s[ 9] = ROTL64X4(s[22], 61);
+        s[22] = ROTL64X4(s[14], 39);
+        s[14] = ROTL64X4(s[20], 18);
+        s[20] = ROTL64X4(s[ 2], 62);
+        s[ 2] = ROTL64X4(s[12], 43);
+        s[12] = ROTL64X4(s[13], 25);
+        s[13] = ROTL64X4(s[19],  8);
+        s[19] = ROTL64X4(s[23], 56);
+        s[23] = ROTL64X4(s[15], 41);
+        s[15] = ROTL64X4(s[ 4], 27);
+        s[ 4] = ROTL64X4(s[24], 14);
+        s[24] = ROTL64X4(s[21],  2);
+        s[21] = ROTL64X4(s[ 8], 55);
+        s[ 8] = ROTL64X4(s[16], 45);
+        s[16] = ROTL64X4(s[ 5], 36);
+        s[ 5] = ROTL64X4(s[ 3], 28);
+        s[ 3] = ROTL64X4(s[18], 21);
+        s[18] = ROTL64X4(s[17], 15);
+        s[17] = ROTL64X4(s[11], 10);
+        s[11] = ROTL64X4(s[ 7],  6);
+        s[ 7] = ROTL64X4(s[10],  3);
+        s[10] = ROTL64X4(t, 1);
+
+        //  Chi
+        for (int j = 0; j < 25; j += 5) {
+            bc[0] = s[j    ];
+            bc[1] = s[j + 1];
+            bc[2] = s[j + 2];
+            bc[3] = s[j + 3];
+            bc[4] = s[j + 4];
+
+            s[j    ] = XOR(bc[0], ANDNOT(bc[1], bc[2]));
+            s[j + 1] = XOR(bc[1], ANDNOT(bc[2], bc[3]));
+            s[j + 2] = XOR(bc[2], ANDNOT(bc[3], bc[4]));
+            s[j + 3] = XOR(bc[3], ANDNOT(bc[4], bc[0]));
+            s[j + 4] = XOR(bc[4], ANDNOT(bc[0], bc[1]));
+        }
+
+        //  Iota
+        s[0] = XOR(s[0], _mm256_set1_epi64x(static_cast<int64_t>(keccakf_rndc[round])));
+    }
+
+    alignas(32) uint64_t lanes[4];
+
+    for (int i = 0; i < 25; ++i) {
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), s[i]);
+
+        st[0][i] = lanes[0];
+        st[1][i] = lanes[1];
+        st[2][i] = lanes[2];
+        st[3][i] = lanes[3];
+    }
+}
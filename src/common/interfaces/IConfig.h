@@ -77,6 +77,7 @@ public:
         PrintTimeKey      = 1007,
         CalibrateAlgoKey     = 10001,
         CalibrateAlgoTimeKey = 10002,
+        RecalibrateAlgoKey   = 10003,
 
         // xmrig cpu
         AVKey             = 'v',
@@ -101,6 +102,70 @@ public:
         OclMemChunkKey    = 1408,
         OclUnrollKey      = 1409,
         OclCompModeKey    = 1410,
+        OclProfilingKey   = 1411,
+        OclSpecializeKey  = 1412,
+        OclAutotuneKey    = 1413,
+        OclAutotuneTimeKey = 1414,
+        OclReportDevicesKey = 1415,
+        OclBenchKey       = 1416,
+        OclBenchFormatKey = 1417,
+        OclCacheExportKey = 1418,
+        OclCacheImportKey = 1419,
+        VerifyThreadsKey  = 1420,
+        VerifyAffinityKey = 1421,
+        VerifySampleKey   = 1422,
+        VerifyThresholdKey = 1423,
+        BatchSplitKey     = 1424,
+        StaleTargetKey    = 1425,
+        PoolStandbyKey    = 1426,
+        PoolStrategyKey   = 1427,
+        StratumPortKey    = 1428,
+        LogAsyncKey       = 1429,
+        TraceFileKey      = 1430,
+        CpuThreadsKey     = 1431,
+        CpuAffinityKey    = 1432,
+        OneGbPagesKey     = 1433,
+        TempTargetKey     = 1434,
+        PowerTargetKey    = 1435,
+        ErrorActionKey    = 1436,
+        OclDeviceContextsKey = 1437,
+        OclLowCpuKey      = 1438,
+        TestSwitchKey     = 1439,
+        RecordSessionKey  = 1440,
+        ReplaySessionKey  = 1441,
+        ReplaySpeedKey    = 1442,
+        OclTraceKey       = 1443,
+        FleetUrlKey       = 1444,
+        FleetIntervalKey  = 1445,
+        MinSubmitDiffKey  = 1446,
+        AutoAffinityKey   = 1447,
+        GpuPriorityKey    = 1448,
+        VerifyPriorityKey = 1449,
+        ParkAfterKey      = 1450,
+        IdleWorkKey       = 1451,
+        AlgoMinDwellKey   = 1452,
+        ProfitUrlKey      = 1453,
+        ProfitIntervalKey = 1454,
+        OclCacheMergeKey  = 1455,
+        StatsShmKey       = 1456,
+        StateFileKey      = 1457,
+        CanaryWindowKey   = 1458,
+        VerifyGpuKey      = 1459,
+        DiagnosticsKey    = 1460,
+        DeriveThreadsKey  = 1461,
+        NetThreadKey      = 1462,
+        TdrLimitKey       = 1463,
+        HandoverKey       = 1464,
+        PushUrlKey        = 1465,
+        PushIntervalKey   = 1466,
+        DesktopDutyKey    = 1467,
+        DesktopIdleKey    = 1468,
+        OclSourceKey      = 1469,
+        StressKey         = 1470,
+        StressTimeKey     = 1471,
+        AutotunePowerKey  = 1472,
+        LogSummaryKey     = 1473,
+        LogRingKey        = 1474,
 
         // xmrig-proxy
         AccessLogFileKey   = 'A',
@@ -33,6 +33,8 @@
 #include "common/interfaces/ILogBackend.h"
 #include "common/log/BasicLog.h"
 #include "common/log/Log.h"
+#include "core/LoopMonitor.h"
+#include "workers/ResultRing.h"
 
 
 Log *Log::m_self = nullptr;
@@ -52,43 +54,79 @@ static const char *color[5] = {
 };
 
 
-void Log::message(ILogBackend::Level level, const char* fmt, ...)
+static void dispatch(ILogBackend *backend, int level, const char *fmt, ...)
 {
-    uv_mutex_lock(&m_mutex);
+    va_list args;
+    va_start(args, fmt);
+
+    if (level < 0) {
+        backend->text(fmt, args);
+    }
+    else {
+        backend->message(static_cast<ILogBackend::Level>(level), fmt, args);
+    }
+
+    va_end(args);
+}
 
+
+void Log::message(ILogBackend::Level level, const char* fmt, ...)
+{
     va_list args;
-    va_list copy;
     va_start(args, fmt);
 
-    for (ILogBackend *backend : m_backends) {
-        va_copy(copy, args);
-        backend->message(level, fmt, copy);
-        va_end(copy);
+    if (!push(level, fmt, args)) {
+        write(level, fmt, args);
     }
 
     va_end(args);
+}
+
+
+// in async mode the backends are used only by the uv loop thread, other threads queue formatted records
+void Log::setAsync(bool enable)
+{
+    if (enable == m_async.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    if (enable) {
+        m_loopThread = uv_thread_self();
+
+        // static storage keeps the alignment of the ring, it is created on first use only
+        static ResultRing<Record, kRingSize> ring;
+        m_ring = &ring;
+
+        m_timer = new uv_timer_t;
+        uv_timer_init(uv_default_loop(), m_timer);
+        uv_unref(reinterpret_cast<uv_handle_t *>(m_timer));
+        uv_timer_start(m_timer, Log::onTimer, 50, 50);
 
+        m_async.store(true, std::memory_order_release);
+        return;
+    }
+
+    m_async.store(false, std::memory_order_release);
+
+    uv_close(reinterpret_cast<uv_handle_t *>(m_timer), [](uv_handle_t *handle) { delete reinterpret_cast<uv_timer_t *>(handle); });
+    m_timer = nullptr;
+
+    uv_mutex_lock(&m_mutex);
+    drain();
     uv_mutex_unlock(&m_mutex);
 }
 
 
 void Log::text(const char* fmt, ...)
 {
-    uv_mutex_lock(&m_mutex);
-
     va_list args;
-    va_list copy;
     va_start(args, fmt);
 
-    for (ILogBackend *backend : m_backends) {
-        va_copy(copy, args);
-        backend->text(fmt, copy);
-        va_end(copy);
+    if (!push(-1, fmt, args)) {
+        write(-1, fmt, args);
     }
 
     va_end(args);
-
-    uv_mutex_unlock(&m_mutex);
 }
 
 
@@ -112,6 +150,88 @@ const char *Log::endl(bool isColors)
 }
 
 
+// returns false if the caller must write the message itself, a record is dropped if the ring is full
+bool Log::push(int level, const char *fmt, va_list args)
+{
+    if (!m_async.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    uv_thread_t self = uv_thread_self();
+    if (uv_thread_equal(&self, &m_loopThread)) {
+        return false;
+    }
+
+    Record record;
+    record.level = level;
+    vsnprintf(record.text, sizeof(record.text), fmt, args);
+
+    if (!m_ring->push(std::move(record))) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return true;
+}
+
+
+// must be called with m_mutex locked
+void Log::drain()
+{
+    if (!m_ring) {
+        return;
+    }
+
+    Record record;
+    while (m_ring->pop(record)) {
+        for (ILogBackend *backend : m_backends) {
+            dispatch(backend, record.level, "%s", record.text);
+        }
+    }
+
+    const size_t dropped = m_dropped.exchange(0, std::memory_order_relaxed);
+    if (dropped) {
+        for (ILogBackend *backend : m_backends) {
+            dispatch(backend, ILogBackend::WARNING, "%zu log messages dropped, log output is too slow", dropped);
+        }
+    }
+}
+
+
+// queued records are written first to keep the order of messages
+void Log::write(int level, const char *fmt, va_list args)
+{
+    xmrig::LoopMonitor::Scope scope(xmrig::LoopMonitor::LogWrite);
+
+    uv_mutex_lock(&m_mutex);
+
+    drain();
+
+    va_list copy;
+    for (ILogBackend *backend : m_backends) {
+        va_copy(copy, args);
+
+        if (level < 0) {
+            backend->text(fmt, copy);
+        }
+        else {
+            backend->message(static_cast<ILogBackend::Level>(level), fmt, copy);
+        }
+
+        va_end(copy);
+    }
+
+    uv_mutex_unlock(&m_mutex);
+}
+
+
+void Log::onTimer(uv_timer_t *)
+{
+    uv_mutex_lock(&m_self->m_mutex);
+    m_self->drain();
+    uv_mutex_unlock(&m_self->m_mutex);
+}
+
+
 void Log::defaultInit()
 {
     m_self = new Log();
@@ -122,6 +242,8 @@ void Log::defaultInit()
 
 Log::~Log()
 {
+    drain();
+
     for (auto backend : m_backends) {
         delete backend;
     }
@@ -27,6 +27,7 @@
 
 
 #include <assert.h>
+#include <atomic>
 #include <uv.h>
 #include <vector>
 
@@ -34,6 +35,9 @@
 #include "common/interfaces/ILogBackend.h"
 
 
+template<typename T, size_t Size> class ResultRing;
+
+
 class Log
 {
 public:
@@ -43,6 +47,7 @@ public:
     static inline void release()                 { delete m_self; }
 
     void message(ILogBackend::Level level, const char* fmt, ...);
+    void setAsync(bool enable);
     void text(const char* fmt, ...);
 
     static const char *colorByLevel(ILogBackend::Level level, bool isColors = true);
@@ -52,7 +57,21 @@ public:
     static bool colors;
 
 private:
-    inline Log() {
+    // preformatted message of another thread, level -1 is text()
+    struct Record
+    {
+        int level;
+        char text[ILogBackend::kBufferSize];
+    };
+
+    constexpr static const size_t kRingSize = 256;
+
+    inline Log() :
+        m_async(false),
+        m_dropped(0),
+        m_ring(nullptr),
+        m_timer(nullptr)
+    {
         assert(m_self == nullptr);
 
         uv_mutex_init(&m_mutex);
@@ -62,9 +81,20 @@ private:
 
     ~Log();
 
+    bool push(int level, const char *fmt, va_list args);
+    void drain();
+    void write(int level, const char *fmt, va_list args);
+
+    static void onTimer(uv_timer_t *handle);
+
     static Log *m_self;
+    std::atomic<bool> m_async;
+    std::atomic<size_t> m_dropped;
     std::vector<ILogBackend*> m_backends;
+    ResultRing<Record, kRingSize> *m_ring;
+    uv_timer_t *m_timer;
     uv_mutex_t m_mutex;
+    uv_thread_t m_loopThread;
 };
 
 
@@ -0,0 +1,156 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ * Copyright 2018 MoneroOcean      <https://github.com/MoneroOcean>, <support@moneroocean.stream>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_BINARYFRAME_H
+#define XMRIG_BINARYFRAME_H
+
+
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+
+namespace xmrig {
+
+
+// framed binary stratum, both sides switch to it right after the JSON login reply if the miner asked for
+// "binary" in the login params and the pool listed "binary" in its extensions, TLS connections stay JSON.
+// A frame is the message type, the payload size (2 bytes) and the payload, integers are little endian and
+// strings are a length byte followed by the characters:
+//   Job       (pool)  job id, algo short name (may be empty), target (8 bytes), height (8 bytes), blob
+//   Submit    (miner) request id (4 bytes), job id, nonce (4 bytes), result (32 bytes), algo short name (may be empty)
+//   Reply     (pool)  request id (4 bytes), error message, empty if the share was accepted
+//   KeepAlive (miner) request id (4 bytes), answered by a Reply
+class BinaryFrame
+{
+public:
+    enum Type : uint8_t {
+        Job       = 1,
+        Submit    = 2,
+        Reply     = 3,
+        KeepAlive = 4
+    };
+
+    constexpr static const int kVersion       = 1;
+    constexpr static const size_t kHeaderSize = 3;
+    constexpr static const size_t kMaxPayload = 1024;
+
+    // writes a frame into the buffer, finish() returns the frame size or 0 if it didn't fit
+    class Writer
+    {
+    public:
+        inline Writer(char *buf, size_t size, Type type) : m_buf(reinterpret_cast<uint8_t*>(buf)), m_pos(kHeaderSize), m_size(size), m_type(type) {}
+
+        inline void u8(uint8_t value)                    { bytes(&value, 1); }
+        inline void u32(uint32_t value)                  { for (int i = 0; i < 4; ++i) { u8(static_cast<uint8_t>(value >> (i * 8))); } }
+        inline void u64(uint64_t value)                  { for (int i = 0; i < 8; ++i) { u8(static_cast<uint8_t>(value >> (i * 8))); } }
+        inline void string(const char *str)              { const size_t len = str ? std::min<size_t>(strlen(str), 255) : 0; u8(static_cast<uint8_t>(len)); bytes(str ? str : "", len); }
+
+        inline void bytes(const void *data, size_t size)
+        {
+            if (m_pos + size <= m_size && m_pos + size - kHeaderSize <= kMaxPayload) {
+                memcpy(m_buf + m_pos, data, size);
+            }
+
+            m_pos += size;
+        }
+
+        inline size_t finish()
+        {
+            if (m_pos > m_size || m_pos - kHeaderSize > kMaxPayload) {
+                return 0;
+            }
+
+            const size_t payload = m_pos - kHeaderSize;
+            m_buf[0] = m_type;
+            m_buf[1] = static_cast<uint8_t>(payload);
+            m_buf[2] = static_cast<uint8_t>(payload >> 8);
+
+            return m_pos;
+        }
+
+    private:
+        uint8_t *m_buf;
+        size_t m_pos;
+        size_t m_size;
+        Type m_type;
+    };
+
+    // reads the payload of a frame, every read fails once the payload is exhausted
+    class Reader
+    {
+    public:
+        inline Reader(const char *frame, size_t size) : m_data(reinterpret_cast<const uint8_t*>(frame) + kHeaderSize), m_pos(0), m_size(size - kHeaderSize) {}
+
+        inline bool u32(uint32_t &value)                 { uint8_t b[4]; if (!bytes(b, 4)) { return false; } value = 0; for (int i = 3; i >= 0; --i) { value = (value << 8) | b[i]; } return true; }
+        inline bool u64(uint64_t &value)                 { uint8_t b[8]; if (!bytes(b, 8)) { return false; } value = 0; for (int i = 7; i >= 0; --i) { value = (value << 8) | b[i]; } return true; }
+        inline const uint8_t *rest(size_t &size)         { size = m_size - m_pos; m_pos = m_size; return m_data + m_size - size; }
+
+        inline bool bytes(void *out, size_t size)
+        {
+            if (m_pos + size > m_size) {
+                return false;
+            }
+
+            memcpy(out, m_data + m_pos, size);
+            m_pos += size;
+            return true;
+        }
+
+        // copies a string into out, which has room for 256 characters with the terminator
+        inline bool string(char *out)
+        {
+            uint8_t len = 0;
+            if (!bytes(&len, 1) || !bytes(out, len)) {
+                return false;
+            }
+
+            out[len] = '\0';
+            return true;
+        }
+
+    private:
+        const uint8_t *m_data;
+        size_t m_pos;
+        size_t m_size;
+    };
+
+    static inline Type type(const char *frame)        { return static_cast<Type>(static_cast<uint8_t>(frame[0])); }
+    // whole frame size from the header, 0 if the header is not complete yet
+    static inline size_t size(const char *data, size_t available)
+    {
+        if (available < kHeaderSize) {
+            return 0;
+        }
+
+        return kHeaderSize + (static_cast<uint8_t>(data[1]) | (static_cast<size_t>(static_cast<uint8_t>(data[2])) << 8));
+    }
+};
+
+
+} /* namespace xmrig */
+
+
+#endif /* XMRIG_BINARYFRAME_H */
@@ -23,6 +23,7 @@
  *   along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <assert.h>
 #include <inttypes.h>
 #include <iterator>
@@ -40,10 +41,13 @@
 
 #include "common/interfaces/IClientListener.h"
 #include "common/log/Log.h"
+#include "common/net/BinaryFrame.h"
 #include "common/net/Client.h"
 #include "net/JobResult.h"
-#include "core/Config.h" // for pconfig to access pconfig->get_algo_perf
-#include "workers/Workers.h" // to do Workers::switch_algo
+#include "net/NetThread.h"
+#include "net/PerfSnapshot.h" // algo-perf and algo switch costs of the main loop
+#include "core/LoopMonitor.h"
+#include "core/Trace.h"
 #include "rapidjson/document.h"
 #include "rapidjson/error/en.h"
 #include "rapidjson/stringbuffer.h"
@@ -55,6 +59,42 @@
 #endif
 
 
+// one uv_write of all messages queued while the previous write was in progress
+struct xmrig::Client::WriteReq
+{
+    void *client;
+    uv_write_t req;
+    std::vector<std::string> messages;
+};
+
+
+// values and the parser stack of incoming messages are allocated in the arenas of the client, see Client::parse
+typedef rapidjson::GenericDocument<rapidjson::UTF8<>, rapidjson::MemoryPoolAllocator<>, rapidjson::MemoryPoolAllocator<> > ParseDocument;
+
+
+// strings from pools are copied to the submit template as is, anything what needs JSON escaping goes through rapidjson
+static bool isPlainString(const char *str)
+{
+    for (; *str; ++str) {
+        if (*str == '"' || *str == '\\' || static_cast<unsigned char>(*str) < 0x20) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+// the share span ends at the pool response, it starts elapsed ms before it
+static void traceShare(const xmrig::SubmitResult &result)
+{
+    if (xmrig::Trace::isEnabled()) {
+        const int64_t duration = static_cast<int64_t>(result.elapsed) * 1000;
+        xmrig::Trace::add("share", xmrig::Trace::now() - duration, duration, result.seq);
+    }
+}
+
+
 namespace xmrig {
 
 int64_t Client::m_sequence = 1;
@@ -78,19 +118,34 @@ xmrig::Client::Client(int id, const char *agent, IClientListener *listener) :
     m_ipv6(false),
     m_nicehash(false),
     m_quiet(false),
+    m_writing(false),
+    m_stats(id),
+    m_closeCause(ClientStats::CloseSocket),
     m_agent(agent),
     m_listener(listener),
     m_extensions(0),
     m_id(id),
     m_retries(5),
     m_retryPause(5000),
+    m_slowSubmits(0),
     m_failures(0),
+    m_pingId(0),
+    m_slowSeq(-1),
+    m_tlsSession(nullptr),
+    m_addrIndex(0),
+    m_pendingSize(0),
     m_recvBufPos(0),
+    m_rttCount(0),
     m_state(UnconnectedState),
     m_tls(nullptr),
+    m_addrsExpire(0),
+    m_attemptExpire(0),
     m_expire(0),
     m_jobs(0),
     m_keepAlive(0),
+    m_latency(0),
+    m_requestTime(0),
+    m_responseTimeout(kResponseTimeout),
     m_key(0),
     m_stream(nullptr),
     m_socket(nullptr)
@@ -114,6 +169,12 @@ xmrig::Client::Client(int id, const char *agent, IClientListener *listener) :
 xmrig::Client::~Client()
 {
     delete m_socket;
+
+#   ifndef XMRIG_NO_TLS
+    if (m_tlsSession) {
+        SSL_SESSION_free(m_tlsSession);
+    }
+#   endif
 }
 
 
@@ -162,16 +223,50 @@ void xmrig::Client::setPool(const Pool &pool)
         return;
     }
 
+    if (m_pool.host() == nullptr || pool.host() == nullptr || strcmp(m_pool.host(), pool.host()) != 0) {
+        m_addrs.clear();
+
+        m_rttCount        = 0;
+        m_responseTimeout = kResponseTimeout;
+
+#       ifndef XMRIG_NO_TLS
+        if (m_tlsSession) {
+            SSL_SESSION_free(m_tlsSession);
+            m_tlsSession = nullptr;
+        }
+#       endif
+    }
+
     m_pool = pool;
+    m_stats.setUrl(m_pool.url());
 }
 
 
 void xmrig::Client::tick(uint64_t now)
 {
+    if (m_state == ConnectingState && !m_attempts.empty()) {
+        if (now > m_expire) {
+            LOG_DEBUG_ERR("[%s] connect timeout", m_pool.url());
+            close(ClientStats::CloseTimeout);
+        }
+        else if (now >= m_attemptExpire) {
+            connectNext();
+        }
+
+        return;
+    }
+
     if (m_state == ConnectedState) {
         if (m_expire && now > m_expire) {
             LOG_DEBUG_ERR("[%s] timeout", m_pool.url());
-            close();
+            close(ClientStats::CloseTimeout);
+        }
+        else if (checkSubmits()) {
+            if (!isQuiet()) {
+                LOG_WARN("[%s] %d submits without reply in %u ms, reconnect", m_pool.url(), m_slowSubmits, static_cast<unsigned int>(m_responseTimeout));
+            }
+
+            close(ClientStats::CloseSlowSubmits);
         }
         else if (m_keepAlive && now > m_keepAlive) {
             ping();
@@ -228,20 +323,69 @@ int64_t xmrig::Client::submit(const JobResult &result)
 
     using namespace rapidjson;
 
+    Trace::Span span("submit", m_sequence);
+
 #   ifdef XMRIG_PROXY_PROJECT
     const char *nonce = result.nonce;
     const char *data  = result.result;
 #   else
-    char *nonce = m_sendBuf;
-    char *data  = m_sendBuf + 16;
+    char nonce[9];
+    char data[65];
+    char extraNonce[Job::kMaxExtraNonceSize * 2 + 1];
 
     Job::toHex(reinterpret_cast<const unsigned char*>(&result.nonce), 4, nonce);
     nonce[8] = '\0';
 
     Job::toHex(result.result, 32, data);
     data[64] = '\0';
+
+    Job::toHex(result.extraNonce, static_cast<unsigned int>(result.extraNonceSize), extraNonce);
+    extraNonce[result.extraNonceSize * 2] = '\0';
 #   endif
 
+#   ifdef XMRIG_PROXY_PROJECT
+    m_results[m_sequence] = SubmitResult(m_sequence, result.diff, result.actualDiff(), result.id);
+#   else
+    m_results[m_sequence] = SubmitResult(m_sequence, result.diff, result.actualDiff());
+    m_results[m_sequence].threadId = result.threadId;
+#   endif
+
+    const bool algo = (m_extensions & AlgoExt) != 0;
+
+#   ifndef XMRIG_PROXY_PROJECT
+    // frames have no field for the extranonce, shares of rolled jobs go as JSON
+    const bool rolled = result.extraNonceSize > 0;
+
+    if ((m_extensions & BinaryExt) && !rolled) {
+        BinaryFrame::Writer frame(m_sendBuf, sizeof(m_sendBuf), BinaryFrame::Submit);
+        frame.u32(static_cast<uint32_t>(m_sequence));
+        frame.string(result.jobId.data());
+        frame.u32(result.nonce);
+        frame.bytes(result.result, 32);
+        frame.string(algo ? result.algorithm.shortName() : nullptr);
+
+        return sendFrame(frame.finish());
+    }
+#   else
+    const bool rolled = false;
+#   endif
+
+    // shares are written straight to the send buffer, without a document and an intermediate string buffer
+    if (!rolled && isPlainString(m_rpcId.data()) && isPlainString(result.jobId.data()) && isPlainString(nonce) && isPlainString(data)) {
+        const int size = snprintf(m_sendBuf, sizeof(m_sendBuf),
+                                  "{\"id\":%" PRId64 ",\"jsonrpc\":\"2.0\",\"method\":\"submit\",\"params\":{\"id\":\"%s\",\"job_id\":\"%s\",\"nonce\":\"%s\",\"result\":\"%s\"%s%s%s}}\n",
+                                  m_sequence, m_rpcId.data(), result.jobId.data(), nonce, data,
+                                  algo ? ",\"algo\":\"" : "", algo ? result.algorithm.shortName() : "", algo ? "\"" : "");
+
+        if (size < 0 || static_cast<size_t>(size) > (sizeof(m_sendBuf) - 2)) {
+            LOG_ERR("[%s] send failed: \"send buffer overflow: %d > %zu\"", m_pool.url(), size, (sizeof(m_sendBuf) - 2));
+            close(ClientStats::CloseProtocol);
+            return -1;
+        }
+
+        return send(static_cast<size_t>(size));
+    }
+
     Document doc(kObjectType);
     auto &allocator = doc.GetAllocator();
 
@@ -255,23 +399,44 @@ int64_t xmrig::Client::submit(const JobResult &result)
     params.AddMember("nonce",  StringRef(nonce), allocator);
     params.AddMember("result", StringRef(data), allocator);
 
-    if (m_extensions & AlgoExt) {
+    if (algo) {
         params.AddMember("algo", StringRef(result.algorithm.shortName()), allocator);
     }
 
-    doc.AddMember("params", params, allocator);
-
-#   ifdef XMRIG_PROXY_PROJECT
-    m_results[m_sequence] = SubmitResult(m_sequence, result.diff, result.actualDiff(), result.id);
-#   else
-    m_results[m_sequence] = SubmitResult(m_sequence, result.diff, result.actualDiff());
+#   ifndef XMRIG_PROXY_PROJECT
+    if (rolled) {
+        params.AddMember("extranonce", StringRef(extraNonce), allocator);
+    }
 #   endif
 
+    doc.AddMember("params", params, allocator);
+
     return send(doc);
 }
 
 
-bool xmrig::Client::close()
+// pending submits are in the order they were sent, each one past the response timeout counts once, a reply in time starts
+// the count again, see addRtt. Jobs and other replies of a half-dead pool don't help here, unlike for m_expire
+bool xmrig::Client::checkSubmits()
+{
+    for (const auto &kv : m_results) {
+        if (kv.first <= m_slowSeq) {
+            continue;
+        }
+
+        if (kv.second.age() <= m_responseTimeout) {
+            break;
+        }
+
+        m_slowSeq = kv.first;
+        m_slowSubmits++;
+    }
+
+    return m_slowSubmits >= kSlowSubmits;
+}
+
+
+bool xmrig::Client::close(ClientStats::Cause cause)
 {
     if (m_state == ClosingState) {
         return m_socket != nullptr;
@@ -281,7 +446,10 @@ bool xmrig::Client::close()
         return false;
     }
 
+    m_closeCause = cause;
+
     setState(ClosingState);
+    closeAttempts();
 
     if (uv_is_closing(reinterpret_cast<uv_handle_t*>(m_socket)) == 0) {
         uv_close(reinterpret_cast<uv_handle_t*>(m_socket), Client::onClose);
@@ -370,20 +538,35 @@ bool xmrig::Client::parseJob(const rapidjson::Value &params, int *code)
         }
     }
 
+    // {"offset": 43, "size": 4}: bytes of the blob the miner may fill, only with the extension in the login reply
+    if ((m_extensions & ExtraNonceExt) && params.HasMember("extranonce")) {
+        const rapidjson::Value &region = params["extranonce"];
+
+        if (!region.IsObject() || !region["offset"].IsUint() || !region["size"].IsUint() || !job.setExtraNonce(region["offset"].GetUint(), region["size"].GetUint())) {
+            *code = 7;
+            return false;
+        }
+    }
+
+    return parseJob(job, code);
+}
+
+
+// the job of a JSON notification or of a binary frame, see parseFrame
+bool xmrig::Client::parseJob(Job &job, int *code)
+{
     if (!verifyAlgorithm(job.algorithm())) {
         *code = 6;
 
-        close();
+        close(ClientStats::CloseProtocol);
         return false;
     }
 
-    // retarget workers for possible new Algo profile (same algo profile is not reapplied)
-    Workers::switch_algo(job.algorithm());
-
     m_job.setClientId(m_rpcId);
 
     if (m_job != job) {
         m_jobs++;
+        m_stats.addJob();
         m_job = std::move(job);
         return true;
     }
@@ -396,7 +579,7 @@ bool xmrig::Client::parseJob(const rapidjson::Value &params, int *code)
         LOG_WARN("[%s] duplicate job received, reconnect", m_pool.url());
     }
 
-    close();
+    close(ClientStats::CloseProtocol);
     return false;
 }
 
@@ -433,17 +616,7 @@ bool xmrig::Client::send(BIO *bio)
 
     LOG_DEBUG("[%s] TLS send     (%d bytes)", m_pool.url(), static_cast<int>(buf.len));
 
-    bool result = false;
-    if (state() == ConnectedState && uv_is_writable(m_stream)) {
-        result = uv_try_write(m_stream, &buf, 1) > 0;
-
-        if (!result) {
-            close();
-        }
-    }
-    else {
-        LOG_DEBUG_ERR("[%s] send failed, invalid state: %d", m_pool.url(), m_state);
-    }
+    const bool result = write(buf.base, buf.len);
 
     (void) BIO_reset(bio);
 
@@ -492,7 +665,15 @@ int xmrig::Client::resolve(const char *host)
         m_failures = 0;
     }
 
-    const int r = uv_getaddrinfo(uv_default_loop(), &m_resolver, Client::onResolved, host, nullptr, &m_hints);
+    m_stats.startAttempt();
+
+    // getaddrinfo doesn't report record TTLs, a short fixed lifetime keeps reconnect storms off the resolvers
+    if (!m_addrs.empty() && uv_now(NetThread::loop()) < m_addrsExpire) {
+        connectAddrs();
+        return 0;
+    }
+
+    const int r = uv_getaddrinfo(NetThread::loop(), &m_resolver, Client::onResolved, host, nullptr, &m_hints);
     if (r) {
         if (!isQuiet()) {
             LOG_ERR("[%s:%u] getaddrinfo error: \"%s\"", host, m_pool.port(), uv_strerror(r));
@@ -515,7 +696,7 @@ int64_t xmrig::Client::send(const rapidjson::Document &doc)
     const size_t size = buffer.GetSize();
     if (size > (sizeof(m_sendBuf) - 2)) {
         LOG_ERR("[%s] send failed: \"send buffer overflow: %zu > %zu\"", m_pool.url(), size, (sizeof(m_sendBuf) - 2));
-        close();
+        close(ClientStats::CloseProtocol);
         return -1;
     }
 
@@ -539,63 +720,214 @@ int64_t xmrig::Client::send(size_t size)
     }
     else
 #   endif
-    {
-        if (state() != ConnectedState || !uv_is_writable(m_stream)) {
-            LOG_DEBUG_ERR("[%s] send failed, invalid state: %d", m_pool.url(), m_state);
-            return -1;
-        }
+    if (!write(m_sendBuf, size)) {
+        return -1;
+    }
+
+    m_expire = uv_now(NetThread::loop()) + kResponseTimeout;
+    return m_sequence++;
+}
+
+
+int64_t xmrig::Client::sendFrame(size_t size)
+{
+    if (size == 0) {
+        LOG_ERR("[%s] send failed: \"frame overflow\"", m_pool.url());
+        close(ClientStats::CloseProtocol);
+        return -1;
+    }
+
+    LOG_DEBUG("[%s] send frame %u (%zu bytes)", m_pool.url(), static_cast<unsigned int>(BinaryFrame::type(m_sendBuf)), size);
+
+    if (!write(m_sendBuf, size)) {
+        return -1;
+    }
+
+    m_expire = uv_now(NetThread::loop()) + kResponseTimeout;
+    return m_sequence++;
+}
 
-        uv_buf_t buf = uv_buf_init(m_sendBuf, (unsigned int) size);
 
-        if (uv_try_write(m_stream, &buf, 1) < 0) {
+// writes immediately if nothing is queued, otherwise the data waits for the write in progress,
+// the connection is closed only on a socket error or if the pool doesn't read anything for too long
+bool xmrig::Client::write(const char *data, size_t size)
+{
+    if (state() != ConnectedState || !uv_is_writable(m_stream)) {
+        LOG_DEBUG_ERR("[%s] send failed, invalid state: %d", m_pool.url(), m_state);
+        return false;
+    }
+
+    m_stats.addOut(size);
+
+    if (!m_writing && m_pending.empty()) {
+        uv_buf_t buf = uv_buf_init(const_cast<char *>(data), static_cast<unsigned int>(size));
+
+        const int rc = uv_try_write(m_stream, &buf, 1);
+        if (rc == static_cast<int>(size)) {
+            return true;
+        }
+
+        if (rc < 0 && rc != UV_EAGAIN) {
             close();
-            return -1;
+            return false;
+        }
+
+        if (rc > 0) {
+            data += rc;
+            size -= static_cast<size_t>(rc);
         }
     }
 
-    m_expire = uv_now(uv_default_loop()) + kResponseTimeout;
-    return m_sequence++;
+    if (m_pendingSize + size > kMaxPendingWrite) {
+        LOG_ERR("[%s] send failed: \"write queue overflow: %zu bytes\"", m_pool.url(), m_pendingSize + size);
+        close();
+        return false;
+    }
+
+    m_pending.emplace_back(data, size);
+    m_pendingSize += size;
+
+    if (!m_writing) {
+        flush();
+    }
+
+    return true;
 }
 
 
-void xmrig::Client::connect(const std::vector<addrinfo*> &ipv4, const std::vector<addrinfo*> &ipv6)
+void xmrig::Client::flush()
 {
-    addrinfo *addr = nullptr;
-    m_ipv6         = ipv4.empty() && !ipv6.empty();
+    WriteReq *req = new WriteReq();
+    req->client   = m_storage.ptr(m_key);
+    req->req.data = req;
+    req->messages.swap(m_pending);
+
+    m_pendingSize = 0;
 
-    if (m_ipv6) {
-        addr = ipv6[ipv6.size() == 1 ? 0 : rand() % ipv6.size()];
-        uv_ip6_name(reinterpret_cast<sockaddr_in6*>(addr->ai_addr), m_ip, 45);
+    std::vector<uv_buf_t> bufs;
+    bufs.reserve(req->messages.size());
+
+    for (std::string &message : req->messages) {
+        bufs.push_back(uv_buf_init(&message[0], static_cast<unsigned int>(message.size())));
     }
-    else {
-        addr = ipv4[ipv4.size() == 1 ? 0 : rand() % ipv4.size()];
-        uv_ip4_name(reinterpret_cast<sockaddr_in*>(addr->ai_addr), m_ip, 16);
+
+    if (uv_write(&req->req, m_stream, bufs.data(), static_cast<unsigned int>(bufs.size()), Client::onWrite) < 0) {
+        delete req;
+        close();
+        return;
+    }
+
+    m_writing = true;
+}
+
+
+// RFC 8305 connection racing: a new attempt starts every kConnectionAttemptDelay ms or as soon as the previous one fails,
+// the first established connection wins and the others are closed
+bool xmrig::Client::connectNext()
+{
+    while (m_addrIndex < m_addrs.size()) {
+        sockaddr_storage addr = m_addrs[m_addrIndex++];
+        reinterpret_cast<sockaddr_in*>(&addr)->sin_port = htons(m_pool.port());
+
+        uv_connect_t *req = new uv_connect_t;
+        req->data = m_storage.ptr(m_key);
+
+        uv_tcp_t *socket = new uv_tcp_t;
+        socket->data = m_storage.ptr(m_key);
+
+        uv_tcp_init(NetThread::loop(), socket);
+        uv_tcp_nodelay(socket, 1);
+
+#       ifndef WIN32
+        uv_tcp_keepalive(socket, 1, 60);
+#       endif
+
+        if (uv_tcp_connect(req, socket, reinterpret_cast<const sockaddr*>(&addr), Client::onConnect) < 0) {
+            delete req;
+            uv_close(reinterpret_cast<uv_handle_t*>(socket), Client::onAttemptClose);
+            continue;
+        }
+
+        m_attempts.push_back(socket);
+        if (m_socket == nullptr) {
+            m_socket = socket;
+        }
+
+        m_attemptExpire = uv_now(NetThread::loop()) + kConnectionAttemptDelay;
+        return true;
+    }
+
+    return false;
+}
+
+
+// the timeout follows the submit round trips of the pool once there are enough of them, between
+// kMinResponseTimeout and kResponseTimeout; late replies raise it as well
+void xmrig::Client::addRtt(uint64_t elapsed)
+{
+    if (elapsed <= m_responseTimeout) {
+        m_slowSubmits = 0;
+    }
+
+    m_rtts[m_rttCount++ % kRttSamples] = elapsed;
+
+    if (m_rttCount < kMinRttSamples) {
+        return;
+    }
+
+    size_t count = m_rttCount;
+    if (count > kRttSamples) {
+        count = kRttSamples;
     }
 
-    connect(addr->ai_addr);
+    const size_t p99 = (count * 99 + 99) / 100 - 1;
+
+    uint64_t sorted[kRttSamples];
+    memcpy(sorted, m_rtts, sizeof(uint64_t) * count);
+    std::nth_element(sorted, sorted + p99, sorted + count);
+
+    const uint64_t timeout = sorted[p99] * kTimeoutFactor;
+    m_responseTimeout      = timeout < kMinResponseTimeout ? kMinResponseTimeout : (timeout > kResponseTimeout ? kResponseTimeout : timeout);
+}
+
+
+void xmrig::Client::closeAttempts()
+{
+    for (uv_tcp_t *socket : m_attempts) {
+        if (socket != m_socket) {
+            uv_close(reinterpret_cast<uv_handle_t*>(socket), Client::onAttemptClose);
+        }
+    }
+
+    m_attempts.clear();
 }
 
 
-void xmrig::Client::connect(sockaddr *addr)
+void xmrig::Client::connectAddrs()
 {
     setState(ConnectingState);
 
-    reinterpret_cast<sockaddr_in*>(addr)->sin_port = htons(m_pool.port());
+    m_addrIndex = 0;
+    m_expire    = uv_now(NetThread::loop()) + kResponseTimeout;
 
-    uv_connect_t *req = new uv_connect_t;
-    req->data = m_storage.ptr(m_key);
+    m_stats.resolved();
 
-    m_socket = new uv_tcp_t;
-    m_socket->data = m_storage.ptr(m_key);
+    if (!connectNext()) {
+        m_closeCause = ClientStats::CloseConnect;
+        onClose();
+    }
+}
 
-    uv_tcp_init(uv_default_loop(), m_socket);
-    uv_tcp_nodelay(m_socket, 1);
 
-#   ifndef WIN32
-    uv_tcp_keepalive(m_socket, 1, 60);
-#   endif
+void xmrig::Client::dropAttempt(uv_tcp_t *socket)
+{
+    m_attempts.erase(std::remove(m_attempts.begin(), m_attempts.end(), socket), m_attempts.end());
+
+    if (m_socket == socket) {
+        m_socket = m_attempts.empty() ? nullptr : m_attempts.front();
+    }
 
-    uv_tcp_connect(req, m_socket, reinterpret_cast<const sockaddr*>(addr), Client::onConnect);
+    uv_close(reinterpret_cast<uv_handle_t*>(socket), Client::onAttemptClose);
 }
 
 
@@ -603,7 +935,7 @@ void xmrig::Client::handshake()
 {
 #   ifndef XMRIG_NO_TLS
     if (isTLS()) {
-        m_expire = uv_now(uv_default_loop()) + kResponseTimeout;
+        m_expire = uv_now(NetThread::loop()) + kResponseTimeout;
 
         m_tls->handshake();
     }
@@ -615,10 +947,34 @@ void xmrig::Client::handshake()
 }
 
 
+// the difficulty of "shares-per-minute" shares at the hashrate of the rig, so the verification and submits of shares
+// don't come in bursts after each algo switch; the measured hashrate is used if the pool algorithm is mined, otherwise
+// its algo-perf, 0 if not set or the user already asks for a difficulty with the "+diff" suffix of the login
+uint64_t xmrig::Client::fixedDiff() const
+{
+    if (m_pool.sharesPerMinute() <= 0 || strchr(m_pool.user(), '+') != nullptr) {
+        return 0;
+    }
+
+    const xmrig::PerfSnapshot::Data &perf = xmrig::PerfSnapshot::get();
+    double hashrate                       = perf.algorithmPerf(m_pool.algorithm());
+
+    if (perf.hashrateAlgo == m_pool.algorithm().perf_algo() && perf.hashrate > 0.0) {
+        hashrate = perf.hashrate;
+    }
+
+    return static_cast<uint64_t>(hashrate * 60.0 / m_pool.sharesPerMinute());
+}
+
+
 void xmrig::Client::login()
 {
     using namespace rapidjson;
     m_results.clear();
+    m_slowSubmits = 0;
+
+    m_requestTime = uv_now(NetThread::loop());
+    m_stats.loggedIn(isTLS());
 
     Document doc(kObjectType);
     auto &allocator = doc.GetAllocator();
@@ -628,7 +984,23 @@ void xmrig::Client::login()
     doc.AddMember("method",  "login", allocator);
 
     Value params(kObjectType);
-    params.AddMember("login", StringRef(m_pool.user()),     allocator);
+
+    const uint64_t diff = fixedDiff();
+    if (diff) {
+        char suffix[32];
+        snprintf(suffix, sizeof(suffix), "+%" PRIu64, diff);
+
+        const std::string user = std::string(m_pool.user()) + suffix;
+        params.AddMember("login", Value(user.c_str(), allocator), allocator);
+
+        if (!isQuiet()) {
+            LOG_INFO("[%s] fixed difficulty %" PRIu64 " for %d shares per minute", m_pool.url(), diff, m_pool.sharesPerMinute());
+        }
+    }
+    else {
+        params.AddMember("login", StringRef(m_pool.user()), allocator);
+    }
+
     params.AddMember("pass",  StringRef(m_pool.password()), allocator);
     params.AddMember("agent", StringRef(m_agent),           allocator);
 
@@ -636,6 +1008,14 @@ void xmrig::Client::login()
         params.AddMember("rigid", StringRef(m_pool.rigId()), allocator);
     }
 
+    // pools which know the framed binary protocol list "binary" in the extensions of the reply, others ignore it
+    if (!m_pool.isTLS()) {
+        params.AddMember("binary", BinaryFrame::kVersion, allocator);
+    }
+
+    // the largest extranonce region the miner fills, pools which reserve one list "extranonce" in the extensions
+    params.AddMember("extranonce", static_cast<uint64_t>(Job::kMaxExtraNonceSize), allocator);
+
 #   ifdef XMRIG_PROXY_PROJECT
     if (m_pool.algorithm().variant() != xmrig::VARIANT_AUTO)
 #   endif
@@ -648,15 +1028,67 @@ void xmrig::Client::login()
 
         params.AddMember("algo", algo, allocator);
 
-        // addding algo-perf based on pconfig->get_algo_perf
+        // addding algo-perf based on the copy of pconfig->get_algo_perf
+        const xmrig::PerfSnapshot::Data &perf = xmrig::PerfSnapshot::get();
+
         Value algo_perf(kObjectType);
         for (int a = 0; a != xmrig::PerfAlgo::PA_MAX; ++ a) {
             const xmrig::PerfAlgo pa = static_cast<xmrig::PerfAlgo>(a);
             Value key(xmrig::Algorithm::perfAlgoName(pa), allocator);
-            algo_perf.AddMember(key, Value(xmrig::pconfig->get_algo_perf(pa)), allocator);
+            algo_perf.AddMember(key, Value(perf.algoPerf[pa]), allocator);
+        }
+        // variants with their own kernel get their own key once the calibration has measured them
+        for (int f = 0; f != xmrig::PerfFork::FORK_MAX; ++ f) {
+            const xmrig::PerfFork pf = static_cast<xmrig::PerfFork>(f);
+            if (perf.forkRatio[pf] > 0.0f) {
+                Value key(xmrig::Algorithm::perfForkName(pf), allocator);
+                algo_perf.AddMember(key, Value(perf.algorithmPerf(xmrig::Algorithm(pf))), allocator);
+            }
         }
 
         params.AddMember("algo-perf", algo_perf, allocator);
+
+        // measured GPU idle time of algo switches in ms by from and to perf algo, with the time an algo
+        // should be kept after a switch, so the pool doesn't flap between algos of almost the same value
+        Value switch_cost(kObjectType);
+        for (int from = 0; from != xmrig::PerfAlgo::PA_MAX; ++ from) {
+            Value costs(kObjectType);
+            for (int to = 0; to != xmrig::PerfAlgo::PA_MAX; ++ to) {
+                const uint32_t cost = perf.switchCost[from][to];
+                if (cost) {
+                    costs.AddMember(StringRef(xmrig::Algorithm::perfAlgoName(static_cast<xmrig::PerfAlgo>(to))), cost, allocator);
+                }
+            }
+
+            if (costs.MemberCount()) {
+                switch_cost.AddMember(StringRef(xmrig::Algorithm::perfAlgoName(static_cast<xmrig::PerfAlgo>(from))), costs, allocator);
+            }
+        }
+
+        params.AddMember("algo-switch-ms", switch_cost, allocator);
+        params.AddMember("algo-min-dwell", perf.minDwell, allocator);
+
+        // breakdown of algo-perf for each GPU so the pool can see heterogeneous rigs
+        if (perf.reportDevices && !perf.devices.empty()) {
+            Value devices(kArrayType);
+            for (const xmrig::PerfSnapshot::Device &device : perf.devices) {
+                Value device_perf(kObjectType);
+                for (int a = 0; a != xmrig::PerfAlgo::PA_MAX; ++ a) {
+                    const xmrig::PerfAlgo pa = static_cast<xmrig::PerfAlgo>(a);
+                    Value key(xmrig::Algorithm::perfAlgoName(pa), allocator);
+                    device_perf.AddMember(key, Value(device.perf[pa]), allocator);
+                }
+
+                Value device_obj(kObjectType);
+                device_obj.AddMember("index", static_cast<uint64_t>(device.index), allocator);
+                device_obj.AddMember("board", device.board.toJSON(doc), allocator);
+                device_obj.AddMember("algo-perf", device_perf, allocator);
+                devices.PushBack(device_obj, allocator);
+            }
+
+            params.AddMember("devices", static_cast<uint64_t>(devices.Size()), allocator);
+            params.AddMember("algo-perf-devices", devices, allocator);
+        }
     }
 
     doc.AddMember("params", params, allocator);
@@ -669,6 +1101,11 @@ void xmrig::Client::onClose()
 {
     delete m_socket;
 
+    m_pending.clear();
+    m_pendingSize = 0;
+    m_writing     = false;
+    m_extensions  = 0;
+
     m_stream = nullptr;
     m_socket = nullptr;
     setState(UnconnectedState);
@@ -700,7 +1137,11 @@ void xmrig::Client::parse(char *line, size_t len)
         return;
     }
 
-    rapidjson::Document doc;
+    // strings are parsed in situ, the arenas are reused by every message and only a message larger than them allocates
+    rapidjson::MemoryPoolAllocator<> allocator(m_parseArena, sizeof(m_parseArena));
+    rapidjson::MemoryPoolAllocator<> stackAllocator(m_parseStack, sizeof(m_parseStack));
+
+    ParseDocument doc(&allocator, sizeof(m_parseStack) / 2, &stackAllocator);
     if (doc.ParseInsitu(line).HasParseError()) {
         if (!isQuiet()) {
             LOG_ERR("[%s] JSON decode failed: \"%s\"", m_pool.url(), rapidjson::GetParseError_En(doc.GetParseError()));
@@ -723,6 +1164,86 @@ void xmrig::Client::parse(char *line, size_t len)
 }
 
 
+void xmrig::Client::parseFrame(const char *frame, size_t size)
+{
+    startTimeout();
+
+    LOG_DEBUG("[%s] received frame %u (%zu bytes)", m_pool.url(), static_cast<unsigned int>(BinaryFrame::type(frame)), size);
+
+    BinaryFrame::Reader reader(frame, size);
+
+    if (BinaryFrame::type(frame) == BinaryFrame::Reply) {
+        uint32_t id = 0;
+        char error[256];
+
+        if (reader.u32(id) && reader.string(error)) {
+            parseResult(id, error[0] ? error : nullptr);
+        }
+
+        return;
+    }
+
+    if (BinaryFrame::type(frame) == BinaryFrame::Job) {
+        char id[256];
+        char algo[256];
+        uint64_t target = 0;
+        uint64_t height = 0;
+        size_t blobSize = 0;
+
+        int code = 2;
+        if (reader.string(id) && reader.string(algo) && reader.u64(target) && reader.u64(height)) {
+            const uint8_t *blob = reader.rest(blobSize);
+
+            // the same checks as for a JSON job, the job takes the hex form of blob and target
+            char blobHex[Job::kMaxBlobSize * 2 + 1];
+            char targetHex[17];
+            Job job(m_id, m_nicehash, m_pool.algorithm(), m_rpcId);
+
+            if (blobSize < Job::kMaxBlobSize) {
+                Job::toHex(blob, static_cast<unsigned int>(blobSize), blobHex);
+                blobHex[blobSize * 2] = '\0';
+
+                Job::toHex(reinterpret_cast<const unsigned char*>(&target), 8, targetHex);
+                targetHex[16] = '\0';
+            }
+
+            if (blobSize >= Job::kMaxBlobSize || !job.setId(id)) {
+                code = 3;
+            }
+            else if (!job.setBlob(blobHex)) {
+                code = 4;
+            }
+            else if (!job.setTarget(targetHex)) {
+                code = 5;
+            }
+            else {
+                if (algo[0]) {
+                    job.setAlgorithm(algo);
+                }
+
+                if (height) {
+                    job.setHeight(height);
+                }
+
+                if (parseJob(job, &code)) {
+                    m_listener->onJobReceived(this, m_job);
+                }
+
+                return;
+            }
+        }
+
+        if (!isQuiet()) {
+            LOG_ERR("[%s] invalid job frame, code: %d", m_pool.url(), code);
+        }
+
+        return;
+    }
+
+    LOG_WARN("[%s] unsupported frame type: %u", m_pool.url(), static_cast<unsigned int>(BinaryFrame::type(frame)));
+}
+
+
 void xmrig::Client::parseExtensions(const rapidjson::Value &value)
 {
     m_extensions = 0;
@@ -746,6 +1267,17 @@ void xmrig::Client::parseExtensions(const rapidjson::Value &value)
             m_nicehash = true;
             continue;
         }
+
+        // frames are read straight from the socket, a TLS connection stays with JSON
+        if (strcmp(ext.GetString(), "binary") == 0 && !isTLS()) {
+            m_extensions |= BinaryExt;
+            continue;
+        }
+
+        if (strcmp(ext.GetString(), "extranonce") == 0) {
+            m_extensions |= ExtraNonceExt;
+            continue;
+        }
     }
 }
 
@@ -778,12 +1310,20 @@ void xmrig::Client::parseNotification(const char *method, const rapidjson::Value
 
 void xmrig::Client::parseResponse(int64_t id, const rapidjson::Value &result, const rapidjson::Value &error)
 {
+    // keepalive replies measure round trip time of idle connections
+    if (id == m_pingId) {
+        m_latency = uv_now(NetThread::loop()) - m_requestTime;
+        m_pingId  = 0;
+    }
+
     if (error.IsObject()) {
         const char *message = error["message"].GetString();
 
         auto it = m_results.find(id);
         if (it != m_results.end()) {
             it->second.done();
+            addRtt(it->second.elapsed);
+            traceShare(it->second);
             m_listener->onResultAccepted(this, it->second, message);
             m_results.erase(it);
         }
@@ -792,7 +1332,7 @@ void xmrig::Client::parseResponse(int64_t id, const rapidjson::Value &result, co
         }
 
         if (isCriticalError(message)) {
-            close();
+            close(ClientStats::CloseRejected);
         }
 
         return;
@@ -809,11 +1349,12 @@ void xmrig::Client::parseResponse(int64_t id, const rapidjson::Value &result, co
                 LOG_ERR("[%s] login error code: %d", m_pool.url(), code);
             }
 
-            close();
+            close(ClientStats::CloseLogin);
             return;
         }
 
         m_failures = 0;
+        m_latency  = uv_now(NetThread::loop()) - m_requestTime;
         m_listener->onLoginSuccess(this);
         m_listener->onJobReceived(this, m_job);
         return;
@@ -822,31 +1363,91 @@ void xmrig::Client::parseResponse(int64_t id, const rapidjson::Value &result, co
     auto it = m_results.find(id);
     if (it != m_results.end()) {
         it->second.done();
+        addRtt(it->second.elapsed);
+        traceShare(it->second);
         m_listener->onResultAccepted(this, it->second, nullptr);
         m_results.erase(it);
     }
 }
 
 
+// share results and keepalive replies of binary frames
+void xmrig::Client::parseResult(int64_t id, const char *error)
+{
+    if (id == m_pingId) {
+        m_latency = uv_now(NetThread::loop()) - m_requestTime;
+        m_pingId  = 0;
+    }
+
+    auto it = m_results.find(id);
+    if (it != m_results.end()) {
+        it->second.done();
+        addRtt(it->second.elapsed);
+        traceShare(it->second);
+        m_listener->onResultAccepted(this, it->second, error);
+        m_results.erase(it);
+    }
+    else if (error && !isQuiet()) {
+        LOG_ERR("[%s] error: \"%s\"", m_pool.url(), error);
+    }
+
+    if (isCriticalError(error)) {
+        close(ClientStats::CloseRejected);
+    }
+}
+
+
 void xmrig::Client::ping()
 {
+    m_pingId      = m_sequence;
+    m_requestTime = uv_now(NetThread::loop());
+
+    if (m_extensions & BinaryExt) {
+        BinaryFrame::Writer frame(m_sendBuf, sizeof(m_sendBuf), BinaryFrame::KeepAlive);
+        frame.u32(static_cast<uint32_t>(m_sequence));
+
+        sendFrame(frame.finish());
+        return;
+    }
+
     send(snprintf(m_sendBuf, sizeof(m_sendBuf), "{\"id\":%" PRId64 ",\"jsonrpc\":\"2.0\",\"method\":\"keepalived\",\"params\":{\"id\":\"%s\"}}\n", m_sequence, m_rpcId.data()));
 }
 
 
+// the login reply switches to binary frames, the data after it in the same read is already framed
 void xmrig::Client::read()
 {
     char* end;
     char* start = m_recvBuf.base;
     size_t remaining = m_recvBufPos;
 
-    while ((end = static_cast<char*>(memchr(start, '\n', remaining))) != nullptr) {
-        end++;
-        size_t len = end - start;
-        parse(start, len);
+    while (remaining > 0) {
+        size_t len = 0;
+
+        if (m_extensions & BinaryExt) {
+            len = BinaryFrame::size(start, remaining);
+            if (len == 0 || len > remaining) {
+                break;
+            }
+
+            const uint64_t ts = uv_hrtime();
+            parseFrame(start, len);
+            m_stats.addMessage(uv_hrtime() - ts);
+        }
+        else {
+            if ((end = static_cast<char*>(memchr(start, '\n', remaining))) == nullptr) {
+                break;
+            }
+
+            len = static_cast<size_t>(end + 1 - start);
+
+            const uint64_t ts = uv_hrtime();
+            parse(start, len);
+            m_stats.addMessage(uv_hrtime() - ts);
+        }
 
         remaining -= len;
-        start = end;
+        start += len;
     }
 
     if (remaining == 0) {
@@ -877,12 +1478,15 @@ void xmrig::Client::reconnect()
         return m_listener->onClose(this, -1);
     }
 
+    m_stats.addReconnect(m_closeCause);
+    m_closeCause = ClientStats::CloseSocket;
+
     setState(ConnectingState);
 
     m_failures++;
     m_listener->onClose(this, (int) m_failures);
 
-    m_expire = uv_now(uv_default_loop()) + m_retryPause;
+    m_expire = uv_now(NetThread::loop()) + m_retryPause;
 }
 
 
@@ -895,6 +1499,7 @@ void xmrig::Client::setState(SocketState state)
     }
 
     m_state = state;
+    m_stats.setConnected(state == ConnectedState);
 }
 
 
@@ -903,7 +1508,7 @@ void xmrig::Client::startTimeout()
     m_expire = 0;
 
     if (m_pool.keepAlive()) {
-        m_keepAlive = uv_now(uv_default_loop()) + (m_pool.keepAlive() * 1000);
+        m_keepAlive = uv_now(NetThread::loop()) + (m_pool.keepAlive() * 1000);
     }
 }
 
@@ -920,6 +1525,12 @@ void xmrig::Client::onAllocBuffer(uv_handle_t *handle, size_t suggested_size, uv
 }
 
 
+void xmrig::Client::onAttemptClose(uv_handle_t *handle)
+{
+    delete reinterpret_cast<uv_tcp_t*>(handle);
+}
+
+
 void xmrig::Client::onClose(uv_handle_t *handle)
 {
     auto client = getClient(handle->data);
@@ -939,16 +1550,53 @@ void xmrig::Client::onConnect(uv_connect_t *req, int status)
         return;
     }
 
+    uv_tcp_t *socket = reinterpret_cast<uv_tcp_t*>(req->handle);
+
+    // attempts closed after another address won report UV_ECANCELED here
+    if (std::find(client->m_attempts.begin(), client->m_attempts.end(), socket) == client->m_attempts.end()) {
+        delete req;
+        return;
+    }
+
     if (status < 0) {
         if (!client->isQuiet()) {
             LOG_ERR("[%s] connect error: \"%s\"", client->m_pool.url(), uv_strerror(status));
         }
 
         delete req;
-        client->close();
+
+        if (client->m_attempts.size() == 1 && client->m_addrIndex >= client->m_addrs.size()) {
+            client->close(ClientStats::CloseConnect);
+            return;
+        }
+
+        client->dropAttempt(socket);
+
+        if (client->m_attempts.empty() && !client->connectNext()) {
+            client->m_closeCause = ClientStats::CloseConnect;
+            client->onClose();
+        }
+
         return;
     }
 
+    client->m_socket = socket;
+    client->closeAttempts();
+    client->m_stats.connected();
+
+    sockaddr_storage addr;
+    int size = sizeof(addr);
+    if (uv_tcp_getpeername(socket, reinterpret_cast<sockaddr*>(&addr), &size) == 0) {
+        client->m_ipv6 = addr.ss_family == AF_INET6;
+
+        if (client->m_ipv6) {
+            uv_ip6_name(reinterpret_cast<sockaddr_in6*>(&addr), client->m_ip, 45);
+        }
+        else {
+            uv_ip4_name(reinterpret_cast<sockaddr_in*>(&addr), client->m_ip, 16);
+        }
+    }
+
     client->m_stream = static_cast<uv_stream_t*>(req->handle);
     client->m_stream->data = req->data;
     client->setState(ConnectedState);
@@ -962,6 +1610,8 @@ void xmrig::Client::onConnect(uv_connect_t *req, int status)
 
 void xmrig::Client::onRead(uv_stream_t *stream, ssize_t nread, const uv_buf_t *buf)
 {
+    LoopMonitor::Scope scope(LoopMonitor::ClientRead);
+
     auto client = getClient(stream->data);
     if (!client) {
         return;
@@ -977,28 +1627,56 @@ void xmrig::Client::onRead(uv_stream_t *stream, ssize_t nread, const uv_buf_t *b
     }
 
     if ((size_t) nread > (sizeof(m_buf) - 8 - client->m_recvBufPos)) {
-        client->close();
+        client->close(ClientStats::CloseProtocol);
         return;
     }
 
+    client->m_stats.addIn(static_cast<size_t>(nread));
+
     assert(client->m_listener != nullptr);
     if (!client->m_listener) {
         return client->reconnect();
     }
 
-    client->m_recvBufPos += nread;
-
 #   ifndef XMRIG_NO_TLS
+    // the records read behind the incomplete message are copied into the read BIO before they are decrypted over it
     if (client->isTLS()) {
         LOG_DEBUG("[%s] TLS received (%d bytes)", client->m_pool.url(), static_cast<int>(nread));
 
-        client->m_tls->read(client->m_recvBuf.base, client->m_recvBufPos);
-        client->m_recvBufPos = 0;
+        client->m_tls->read(buf->base, static_cast<size_t>(nread));
+        return;
     }
-    else
 #   endif
-    {
-        client->read();
+
+    client->m_recvBufPos += nread;
+    client->read();
+}
+
+
+void xmrig::Client::onWrite(uv_write_t *req, int status)
+{
+    WriteReq *write = static_cast<WriteReq *>(req->data);
+    auto client     = getClient(write->client);
+    delete write;
+
+    if (!client) {
+        return;
+    }
+
+    client->m_writing = false;
+
+    if (status < 0) {
+        if (status != UV_ECANCELED) {
+            LOG_DEBUG_ERR("[%s] write error: \"%s\"", client->m_pool.url(), uv_strerror(status));
+            client->close();
+        }
+
+        return;
+    }
+
+    // everything queued meanwhile goes in one write
+    if (!client->m_pending.empty()) {
+        client->flush();
     }
 }
 
@@ -1020,6 +1698,7 @@ void xmrig::Client::onResolved(uv_getaddrinfo_t *req, int status, struct addrinf
             LOG_ERR("[%s] DNS error: \"%s\"", client->m_pool.url(), uv_strerror(status));
         }
 
+        client->m_closeCause = ClientStats::CloseDns;
         return client->reconnect();
     }
 
@@ -1045,9 +1724,34 @@ void xmrig::Client::onResolved(uv_getaddrinfo_t *req, int status, struct addrinf
         }
 
         uv_freeaddrinfo(res);
+
+        client->m_closeCause = ClientStats::CloseDns;
         return client->reconnect();
     }
 
-    client->connect(ipv4, ipv6);
+    // families alternate starting with the resolver's first choice, a random start within a family spreads the load
+    const size_t v4 = ipv4.empty() ? 0 : static_cast<size_t>(rand()) % ipv4.size();
+    const size_t v6 = ipv6.empty() ? 0 : static_cast<size_t>(rand()) % ipv6.size();
+    const bool first6 = res->ai_family == AF_INET6 || ipv4.empty();
+
+    client->m_addrs.clear();
+    for (size_t i = 0; i < std::max(ipv4.size(), ipv6.size()); ++i) {
+        for (int family = 0; family < 2; ++family) {
+            const std::vector<addrinfo*> &list = (family == 0) == first6 ? ipv6 : ipv4;
+            const size_t start                 = (family == 0) == first6 ? v6 : v4;
+
+            if (i < list.size()) {
+                sockaddr_storage addr;
+                memset(&addr, 0, sizeof(addr));
+                memcpy(&addr, list[(start + i) % list.size()]->ai_addr, list[(start + i) % list.size()]->ai_addrlen);
+
+                client->m_addrs.push_back(addr);
+            }
+        }
+    }
+
     uv_freeaddrinfo(res);
+
+    client->m_addrsExpire = uv_now(NetThread::loop()) + kDnsCacheTime;
+    client->connectAddrs();
 }
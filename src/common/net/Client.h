@@ -28,12 +28,14 @@
 
 
 #include <map>
+#include <string>
 #include <uv.h>
 #include <vector>
 
 
 #include "base/net/Pool.h"
 #include "common/crypto/Algorithm.h"
+#include "common/net/ClientStats.h"
 #include "common/net/Id.h"
 #include "common/net/Job.h"
 #include "common/net/Storage.h"
@@ -42,6 +44,7 @@
 
 
 typedef struct bio_st BIO;
+typedef struct ssl_session_st SSL_SESSION;
 
 
 namespace xmrig {
@@ -63,6 +66,7 @@ public:
     };
 
     constexpr static int kResponseTimeout = 20 * 1000;
+    constexpr static size_t kMaxPendingWrite = 1024 * 1024;
 
 #   ifndef XMRIG_NO_TLS
     constexpr static int kInputBufferSize = 1024 * 16;
@@ -87,7 +91,9 @@ public:
     inline const char *host() const                   { return m_pool.host(); }
     inline const char *ip() const                     { return m_ip; }
     inline const Job &job() const                     { return m_job; }
+    inline const Pool &pool() const                   { return m_pool; }
     inline int id() const                             { return m_id; }
+    inline uint64_t latency() const                   { return m_latency; }
     inline SocketState state() const                  { return m_state; }
     inline uint16_t port() const                      { return m_pool.port(); }
     inline void setAlgo(const Algorithm &algo)        { m_pool.setAlgo(algo); }
@@ -97,32 +103,57 @@ public:
 
 private:
     class Tls;
+    struct WriteReq;
 
 
     enum Extensions {
-        NicehashExt  = 1,
-        AlgoExt      = 2
+        NicehashExt   = 1,
+        AlgoExt       = 2,
+        BinaryExt     = 4,
+        ExtraNonceExt = 8
     };
 
-    bool close();
+    constexpr static uint64_t kConnectionAttemptDelay = 250;
+    constexpr static uint64_t kDnsCacheTime           = 60 * 1000;
+
+    // submit replies of a pool, the response timeout is the p99 of the last kRttSamples times kTimeoutFactor,
+    // kSlowSubmits submits in a row without reply in that time close the connection
+    constexpr static size_t kRttSamples               = 64;
+    constexpr static size_t kMinRttSamples            = 8;
+    constexpr static uint64_t kMinResponseTimeout     = 2000;
+    constexpr static uint64_t kTimeoutFactor          = 4;
+    constexpr static int kSlowSubmits                 = 3;
+
+    bool checkSubmits();
+    bool close(ClientStats::Cause cause = ClientStats::CloseSocket);
+    bool connectNext();
     bool isCriticalError(const char *message);
     bool isTLS() const;
     bool parseJob(const rapidjson::Value &params, int *code);
+    bool parseJob(Job &job, int *code);
     bool parseLogin(const rapidjson::Value &result, int *code);
     bool send(BIO *bio);
     bool verifyAlgorithm(const Algorithm &algorithm) const;
+    bool write(const char *data, size_t size);
     int resolve(const char *host);
+    uint64_t fixedDiff() const;
     int64_t send(const rapidjson::Document &doc);
     int64_t send(size_t size);
-    void connect(const std::vector<addrinfo*> &ipv4, const std::vector<addrinfo*> &ipv6);
-    void connect(sockaddr *addr);
+    int64_t sendFrame(size_t size);
+    void addRtt(uint64_t elapsed);
+    void closeAttempts();
+    void connectAddrs();
+    void dropAttempt(uv_tcp_t *socket);
+    void flush();
     void handshake();
     void login();
     void onClose();
     void parse(char *line, size_t len);
+    void parseFrame(const char *frame, size_t size);
     void parseExtensions(const rapidjson::Value &value);
     void parseNotification(const char *method, const rapidjson::Value &params, const rapidjson::Value &error);
     void parseResponse(int64_t id, const rapidjson::Value &result, const rapidjson::Value &error);
+    void parseResult(int64_t id, const char *error);
     void ping();
     void read();
     void reconnect();
@@ -132,10 +163,12 @@ private:
     inline bool isQuiet() const { return m_quiet || m_failures >= m_retries; }
 
     static void onAllocBuffer(uv_handle_t *handle, size_t suggested_size, uv_buf_t *buf);
+    static void onAttemptClose(uv_handle_t *handle);
     static void onClose(uv_handle_t *handle);
     static void onConnect(uv_connect_t *req, int status);
     static void onRead(uv_stream_t *stream, ssize_t nread, const uv_buf_t *buf);
     static void onResolved(uv_getaddrinfo_t *req, int status, struct addrinfo *res);
+    static void onWrite(uv_write_t *req, int status);
 
     static inline Client *getClient(void *data) { return m_storage.get(data); }
 
@@ -143,25 +176,46 @@ private:
     bool m_ipv6;
     bool m_nicehash;
     bool m_quiet;
+    bool m_writing;
     char m_buf[kInputBufferSize];
     char m_ip[46];
     char m_sendBuf[2048];
+    alignas(8) char m_parseArena[4096];
+    alignas(8) char m_parseStack[1024];
+    ClientStats m_stats;
+    ClientStats::Cause m_closeCause;
     const char *m_agent;
     IClientListener *m_listener;
     int m_extensions;
     int m_id;
     int m_retries;
     int m_retryPause;
+    int m_slowSubmits;
     int64_t m_failures;
+    int64_t m_pingId;
+    int64_t m_slowSeq;
     Job m_job;
     Pool m_pool;
+    SSL_SESSION *m_tlsSession;
+    size_t m_addrIndex;
+    size_t m_pendingSize;
     size_t m_recvBufPos;
+    size_t m_rttCount;
     SocketState m_state;
     std::map<int64_t, SubmitResult> m_results;
+    std::vector<sockaddr_storage> m_addrs;
+    std::vector<std::string> m_pending;
+    std::vector<uv_tcp_t*> m_attempts;
     Tls *m_tls;
+    uint64_t m_addrsExpire;
+    uint64_t m_attemptExpire;
     uint64_t m_expire;
     uint64_t m_jobs;
     uint64_t m_keepAlive;
+    uint64_t m_latency;
+    uint64_t m_requestTime;
+    uint64_t m_responseTimeout;
+    uint64_t m_rtts[kRttSamples];
     uintptr_t m_key;
     uv_buf_t m_recvBuf;
     uv_getaddrinfo_t m_resolver;
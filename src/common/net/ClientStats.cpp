@@ -0,0 +1,219 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <mutex>
+#include <uv.h>
+
+
+#include "common/net/ClientStats.h"
+
+
+namespace xmrig {
+
+
+static const char *kCauses[ClientStats::CloseMax] = { "timeout", "slow_submits", "dns", "connect", "tls", "login", "protocol", "rejected", "socket" };
+static const uint32_t kJobBounds[ClientStats::kJobBuckets - 1] = { 500, 1000, 5000, 15000, 30000, 60000, 120000 };
+
+static std::mutex registryMutex;
+static std::vector<ClientStats *> registry;
+
+
+} /* namespace xmrig */
+
+
+xmrig::ClientStats::ClientStats(int id) :
+    m_id(id),
+    m_connected(false),
+    m_bytesIn(0),
+    m_bytesOut(0),
+    m_connectTime(0),
+    m_dnsTime(0),
+    m_firstJobTime(0),
+    m_jobs(0),
+    m_messages(0),
+    m_parseTime(0),
+    m_reconnects(0),
+    m_tlsTime(0),
+    m_attemptStart(0),
+    m_lastJob(0),
+    m_phaseStart(0),
+    m_waitingJob(false)
+{
+    for (auto &cause : m_causes) {
+        cause.store(0, std::memory_order_relaxed);
+    }
+
+    for (auto &count : m_jobIntervals) {
+        count.store(0, std::memory_order_relaxed);
+    }
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    registry.push_back(this);
+}
+
+
+xmrig::ClientStats::~ClientStats()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    registry.erase(std::remove(registry.begin(), registry.end(), this), registry.end());
+}
+
+
+const char *xmrig::ClientStats::name(Cause cause)
+{
+    return kCauses[cause];
+}
+
+
+const uint32_t *xmrig::ClientStats::jobBounds()
+{
+    return kJobBounds;
+}
+
+
+std::vector<xmrig::ClientStats::Snapshot> xmrig::ClientStats::snapshot()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    std::vector<Snapshot> out(registry.size());
+    for (size_t i = 0; i < registry.size(); ++i) {
+        const ClientStats *stats = registry[i];
+        Snapshot &snapshot       = out[i];
+
+        snapshot.url          = stats->m_url;
+        snapshot.id           = stats->m_id;
+        snapshot.connected    = stats->m_connected.load(std::memory_order_relaxed);
+        snapshot.bytesIn      = stats->m_bytesIn.load(std::memory_order_relaxed);
+        snapshot.bytesOut     = stats->m_bytesOut.load(std::memory_order_relaxed);
+        snapshot.messages     = stats->m_messages.load(std::memory_order_relaxed);
+        snapshot.parseTime    = stats->m_parseTime.load(std::memory_order_relaxed);
+        snapshot.jobs         = stats->m_jobs.load(std::memory_order_relaxed);
+        snapshot.reconnects   = stats->m_reconnects.load(std::memory_order_relaxed);
+        snapshot.dnsTime      = stats->m_dnsTime.load(std::memory_order_relaxed);
+        snapshot.connectTime  = stats->m_connectTime.load(std::memory_order_relaxed);
+        snapshot.tlsTime      = stats->m_tlsTime.load(std::memory_order_relaxed);
+        snapshot.firstJobTime = stats->m_firstJobTime.load(std::memory_order_relaxed);
+
+        for (size_t j = 0; j < CloseMax; ++j) {
+            snapshot.causes[j] = stats->m_causes[j].load(std::memory_order_relaxed);
+        }
+
+        for (size_t j = 0; j < kJobBuckets; ++j) {
+            snapshot.jobIntervals[j] = stats->m_jobIntervals[j].load(std::memory_order_relaxed);
+        }
+    }
+
+    return out;
+}
+
+
+// the first job after a login ends the attempt, it comes with the login reply
+void xmrig::ClientStats::addJob()
+{
+    const uint64_t now = uv_hrtime();
+
+    m_jobs.fetch_add(1, std::memory_order_relaxed);
+
+    if (m_waitingJob) {
+        m_firstJobTime.store((now - m_attemptStart) / 1000, std::memory_order_relaxed);
+        m_waitingJob = false;
+    }
+
+    if (m_lastJob) {
+        const uint64_t interval = (now - m_lastJob) / 1000000;
+
+        size_t bucket = 0;
+        while (bucket < kJobBuckets - 1 && interval >= kJobBounds[bucket]) {
+            bucket++;
+        }
+
+        m_jobIntervals[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    m_lastJob = now;
+}
+
+
+void xmrig::ClientStats::addMessage(uint64_t elapsed)
+{
+    m_messages.fetch_add(1, std::memory_order_relaxed);
+    m_parseTime.fetch_add(elapsed, std::memory_order_relaxed);
+}
+
+
+void xmrig::ClientStats::addReconnect(Cause cause)
+{
+    m_reconnects.fetch_add(1, std::memory_order_relaxed);
+    m_causes[cause].fetch_add(1, std::memory_order_relaxed);
+}
+
+
+void xmrig::ClientStats::connected()
+{
+    const uint64_t now = uv_hrtime();
+
+    m_connectTime.store((now - m_phaseStart) / 1000, std::memory_order_relaxed);
+    m_phaseStart = now;
+}
+
+
+// the login is sent right after the TCP connection or after the TLS handshake
+void xmrig::ClientStats::loggedIn(bool tls)
+{
+    m_tlsTime.store(tls ? (uv_hrtime() - m_phaseStart) / 1000 : 0, std::memory_order_relaxed);
+}
+
+
+// cached addresses take no time here
+void xmrig::ClientStats::resolved()
+{
+    const uint64_t now = uv_hrtime();
+
+    m_dnsTime.store((now - m_phaseStart) / 1000, std::memory_order_relaxed);
+    m_phaseStart = now;
+}
+
+
+void xmrig::ClientStats::setConnected(bool connected)
+{
+    m_connected.store(connected, std::memory_order_relaxed);
+}
+
+
+void xmrig::ClientStats::setUrl(const char *url)
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    m_url = url ? url : "";
+}
+
+
+// job intervals across a reconnect would count the time without connection
+void xmrig::ClientStats::startAttempt()
+{
+    m_attemptStart = m_phaseStart = uv_hrtime();
+    m_lastJob      = 0;
+    m_waitingJob   = true;
+}
@@ -0,0 +1,127 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef XMRIG_CLIENTSTATS_H
+#define XMRIG_CLIENTSTATS_H
+
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+namespace xmrig {
+
+
+// connection counters of one pool client, written on the loop of the client and read by the API on the main loop.
+// Every client registers its counters while it exists, so the clients of all strategies, the dev donate and the
+// dual pool are listed, including standby pools. Times of a connection attempt are in µs and kept until the next one
+class ClientStats
+{
+public:
+    enum Cause {
+        CloseTimeout,
+        CloseSlowSubmits,
+        CloseDns,
+        CloseConnect,
+        CloseTls,
+        CloseLogin,
+        CloseProtocol,
+        CloseRejected,
+        CloseSocket,
+        CloseMax
+    };
+
+    // time between two jobs in ms, the last bucket has no bound
+    constexpr static size_t kJobBuckets = 8;
+
+    struct Snapshot
+    {
+        std::string url;
+        int id;
+        bool connected;
+        uint64_t bytesIn;
+        uint64_t bytesOut;
+        uint64_t messages;
+        uint64_t parseTime; // ns
+        uint64_t jobs;
+        uint64_t reconnects;
+        uint64_t causes[CloseMax];
+        uint64_t jobIntervals[kJobBuckets];
+        uint64_t dnsTime;
+        uint64_t connectTime;
+        uint64_t tlsTime;
+        uint64_t firstJobTime;
+    };
+
+    ClientStats(int id);
+    ~ClientStats();
+
+    static const char *name(Cause cause);
+    static const uint32_t *jobBounds();
+    static std::vector<Snapshot> snapshot();
+
+    inline void addIn(size_t bytes)  { m_bytesIn.fetch_add(bytes, std::memory_order_relaxed); }
+    inline void addOut(size_t bytes) { m_bytesOut.fetch_add(bytes, std::memory_order_relaxed); }
+
+    void addJob();
+    void addMessage(uint64_t elapsed);
+    void addReconnect(Cause cause);
+    void connected();
+    void loggedIn(bool tls);
+    void resolved();
+    void setConnected(bool connected);
+    void setUrl(const char *url);
+    void startAttempt();
+
+private:
+    const int m_id;
+    std::atomic<bool> m_connected;
+    std::atomic<uint64_t> m_bytesIn;
+    std::atomic<uint64_t> m_bytesOut;
+    std::atomic<uint64_t> m_causes[CloseMax];
+    std::atomic<uint64_t> m_connectTime;
+    std::atomic<uint64_t> m_dnsTime;
+    std::atomic<uint64_t> m_firstJobTime;
+    std::atomic<uint64_t> m_jobIntervals[kJobBuckets];
+    std::atomic<uint64_t> m_jobs;
+    std::atomic<uint64_t> m_messages;
+    std::atomic<uint64_t> m_parseTime;
+    std::atomic<uint64_t> m_reconnects;
+    std::atomic<uint64_t> m_tlsTime;
+    std::string m_url;
+    uint64_t m_attemptStart;
+    uint64_t m_lastJob;
+    uint64_t m_phaseStart;
+    bool m_waitingJob;
+};
+
+
+} /* namespace xmrig */
+
+
+#endif /* XMRIG_CLIENTSTATS_H */
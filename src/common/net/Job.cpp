@@ -29,6 +29,11 @@
 #include <string.h>
 
 
+#if defined(__SSE2__)
+#   include <emmintrin.h>
+#endif
+
+
 #include "common/net/Job.h"
 
 
@@ -64,8 +69,11 @@ xmrig::Job::Job() :
     m_nicehash(false),
     m_poolId(-2),
     m_threadId(-1),
+    m_extraNonceOffset(0),
+    m_extraNonceSize(0),
     m_size(0),
     m_diff(0),
+    m_extraNonce(0),
     m_target(0),
     m_blob(),
     m_height(0)
@@ -78,8 +86,11 @@ xmrig::Job::Job(int poolId, bool nicehash, const Algorithm &algorithm, const Id
     m_nicehash(nicehash),
     m_poolId(poolId),
     m_threadId(-1),
+    m_extraNonceOffset(0),
+    m_extraNonceSize(0),
     m_size(0),
     m_diff(0),
+    m_extraNonce(0),
     m_target(0),
     m_blob(),
     m_height(0),
@@ -161,6 +172,22 @@ void xmrig::Job::setRawBlob(const uint8_t *blob, const size_t size)
 }
 
 
+// the pool leaves a region of the blob to the miner, so threads can hash another copy of the job once its nonces are
+// taken, see NonceSpace. The region is cleared, the rolled value is written over it in little endian
+bool xmrig::Job::setExtraNonce(size_t offset, size_t size)
+{
+    if (size == 0 || size > kMaxExtraNonceSize || offset + size > m_size || (offset < 43 && offset + size > 39)) {
+        return false;
+    }
+
+    m_extraNonceOffset = offset;
+    m_extraNonceSize   = size;
+
+    rollExtraNonce(0);
+    return true;
+}
+
+
 bool xmrig::Job::setTarget(const char *target)
 {
     if (!target) {
@@ -219,10 +246,76 @@ void xmrig::Job::setHeight(uint64_t height)
 }
 
 
+void xmrig::Job::rollExtraNonce(uint64_t extraNonce)
+{
+    m_extraNonce = extraNonce;
+
+    for (size_t i = 0; i < m_extraNonceSize; ++i) {
+        m_blob[m_extraNonceOffset + i] = static_cast<uint8_t>(extraNonce >> (i * 8));
+    }
+}
+
+
+#if defined(__SSE2__)
+// 32 hex digits to 16 bytes, false if any of them is not a hex digit
+static inline bool fromHex32(const char *in, unsigned char *out)
+{
+    const __m128i v[2] = { _mm_loadu_si128(reinterpret_cast<const __m128i *>(in)), _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 16)) };
+    __m128i nibbles[2];
+
+    for (int i = 0; i < 2; ++i) {
+        // signed compares reject bytes above 0x7F, lower case of letters covers both cases
+        const __m128i lower = _mm_or_si128(v[i], _mm_set1_epi8(0x20));
+        const __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v[i], _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(v[i], _mm_set1_epi8('9' + 1)));
+        const __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+
+        if (_mm_movemask_epi8(_mm_or_si128(digit, alpha)) != 0xFFFF) {
+            return false;
+        }
+
+        const __m128i value = _mm_or_si128(_mm_and_si128(digit, _mm_sub_epi8(v[i], _mm_set1_epi8('0'))),
+                                           _mm_and_si128(alpha, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 0xA))));
+
+        // each 16-bit lane holds the high nibble in its low byte and the low nibble in its high byte
+        nibbles[i] = _mm_or_si128(_mm_and_si128(_mm_slli_epi16(value, 4), _mm_set1_epi16(0xF0)), _mm_srli_epi16(value, 8));
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_packus_epi16(nibbles[0], nibbles[1]));
+    return true;
+}
+
+
+// 16 bytes to 32 lower case hex digits
+static inline void toHex32(const unsigned char *in, char *out)
+{
+    const __m128i v     = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+    const __m128i mask  = _mm_set1_epi8(0x0F);
+    const __m128i high  = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+    const __m128i low   = _mm_and_si128(v, mask);
+    __m128i digits[2]   = { _mm_unpacklo_epi8(high, low), _mm_unpackhi_epi8(high, low) };
+
+    for (int i = 0; i < 2; ++i) {
+        const __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(digits[i], _mm_set1_epi8(9)), _mm_set1_epi8('a' - '0' - 0xA));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 16), _mm_add_epi8(_mm_add_epi8(digits[i], _mm_set1_epi8('0')), letters));
+    }
+}
+#endif
+
+
 bool xmrig::Job::fromHex(const char* in, unsigned int len, unsigned char* out)
 {
+    unsigned int i = 0;
+
+#   if defined(__SSE2__)
+    for (; i + 32 <= len; i += 32) {
+        if (!fromHex32(in + i, out + i / 2)) {
+            return false;
+        }
+    }
+#   endif
+
     bool error = false;
-    for (unsigned int i = 0; i < len; i += 2) {
+    for (; i < len; i += 2) {
         out[i / 2] = (hf_hex2bin(in[i], error) << 4) | hf_hex2bin(in[i + 1], error);
 
         if (error) {
@@ -235,7 +328,15 @@ bool xmrig::Job::fromHex(const char* in, unsigned int len, unsigned char* out)
 
 void xmrig::Job::toHex(const unsigned char* in, unsigned int len, char* out)
 {
-    for (unsigned int i = 0; i < len; i++) {
+    unsigned int i = 0;
+
+#   if defined(__SSE2__)
+    for (; i + 16 <= len; i += 16) {
+        toHex32(in + i, out + i * 2);
+    }
+#   endif
+
+    for (; i < len; i++) {
         out[i * 2] = hf_bin2hex((in[i] & 0xF0) >> 4);
         out[i * 2 + 1] = hf_bin2hex(in[i] & 0x0F);
     }
@@ -46,36 +46,46 @@ public:
     // SECOR increase requirements for blob size: https://github.com/xmrig/xmrig/issues/913
     static constexpr const size_t kMaxBlobSize = 128;
 
+    // the reserved extranonce region of a blob, see setExtraNonce
+    static constexpr const size_t kMaxExtraNonceSize = 8;
+
     Job();
     Job(int poolId, bool nicehash, const Algorithm &algorithm, const Id &clientId);
     ~Job();
 
     bool isEqual(const Job &other) const;
     bool setBlob(const char *blob);
+    bool setExtraNonce(size_t offset, size_t size);
     void setRawBlob(const uint8_t *blob, const size_t size); // for algo benchmarking
     bool setTarget(const char *target);
     // for algo benchmarking to set PoW variant
     void setAlgorithm(const xmrig::Algorithm& algorithm) { m_algorithm = algorithm; }
     void setAlgorithm(const char *algo);
     void setHeight(uint64_t height);
+    void rollExtraNonce(uint64_t extraNonce);
 
+    inline bool hasExtraNonce() const                 { return m_extraNonceSize > 0; }
     inline bool isNicehash() const                    { return m_nicehash; }
     inline bool isValid() const                       { return m_size > 0 && m_diff > 0; }
     inline bool setId(const char *id)                 { return m_id.setId(id); }
     inline const uint32_t *nonce() const              { return reinterpret_cast<const uint32_t*>(m_blob + 39); }
     inline const uint8_t *blob() const                { return m_blob; }
+    inline const uint8_t *extraNonceBytes() const     { return m_blob + m_extraNonceOffset; }
     inline const Algorithm &algorithm() const         { return m_algorithm; }
     inline const Id &clientId() const                 { return m_clientId; }
     inline const Id &id() const                       { return m_id; }
     inline int poolId() const                         { return m_poolId; }
     inline int threadId() const                       { return m_threadId; }
+    inline size_t extraNonceSize() const              { return m_extraNonceSize; }
     inline size_t size() const                        { return m_size; }
     inline uint32_t *nonce()                          { return reinterpret_cast<uint32_t*>(m_blob + 39); }
     inline uint32_t diff() const                      { return static_cast<uint32_t>(m_diff); }
     inline uint64_t target() const                    { return m_target; }
+    inline uint64_t extraNonce() const                { return m_extraNonce; }
     inline uint64_t height() const                    { return m_height; }
-    inline void reset()                               { m_size = 0; m_diff = 0; }
+    inline void reset()                               { m_size = 0; m_diff = 0; m_extraNonceSize = 0; }
     inline void setClientId(const Id &id)             { m_clientId = id; }
+    inline void setNicehash(bool nicehash)            { m_nicehash = nicehash; }
     inline void setPoolId(int poolId)                 { m_poolId = poolId; }
     inline void setThreadId(int threadId)             { m_threadId = threadId; }
     inline void setVariant(const char *variant)       { m_algorithm.parseVariant(variant); }
@@ -105,8 +115,11 @@ private:
     bool m_nicehash;
     int m_poolId;
     int m_threadId;
+    size_t m_extraNonceOffset;
+    size_t m_extraNonceSize;
     size_t m_size;
     uint64_t m_diff;
+    uint64_t m_extraNonce;
     uint64_t m_target;
     uint8_t m_blob[kMaxBlobSize];
     uint64_t m_height;
@@ -30,6 +30,7 @@
 
 
 xmrig::SubmitResult::SubmitResult(int64_t seq, uint32_t diff, uint64_t actualDiff, int64_t reqId) :
+    threadId(-1),
     reqId(reqId),
     seq(seq),
     diff(diff),
@@ -40,7 +41,14 @@ xmrig::SubmitResult::SubmitResult(int64_t seq, uint32_t diff, uint64_t actualDif
 }
 
 
+// time since the submit in ms
+uint64_t xmrig::SubmitResult::age() const
+{
+    return (uv_hrtime() - start) / 1000000;
+}
+
+
 void xmrig::SubmitResult::done()
 {
-    elapsed = (uv_hrtime() - start) / 1000000;
+    elapsed = age();
 }
@@ -35,11 +35,13 @@ namespace xmrig {
 class SubmitResult
 {
 public:
-    inline SubmitResult() : reqId(0), seq(0), diff(0), actualDiff(0), elapsed(0), start(0) {}
+    inline SubmitResult() : threadId(-1), reqId(0), seq(0), diff(0), actualDiff(0), elapsed(0), start(0) {}
     SubmitResult(int64_t seq, uint32_t diff, uint64_t actualDiff, int64_t reqId = 0);
 
+    uint64_t age() const;
     void done();
 
+    int threadId; // see JobResult::threadId
     int64_t reqId;
     int64_t seq;
     uint32_t diff;
@@ -38,8 +38,9 @@
 
 
 xmrig::Client::Tls::Tls(Client *client) :
+    m_ktls(false),
     m_ready(false),
-    m_buf(),
+    m_socketWrite(false),
     m_fingerprint(),
     m_client(client),
     m_ssl(nullptr)
@@ -54,6 +55,16 @@ xmrig::Client::Tls::Tls(Client *client) :
     m_writeBio = BIO_new(BIO_s_mem());
     m_readBio  = BIO_new(BIO_s_mem());
     SSL_CTX_set_options(m_ctx, SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3);
+
+    // sessions outlive this object in the client, a reconnect resumes with an abbreviated handshake
+    SSL_CTX_set_session_cache_mode(m_ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(m_ctx, Tls::onNewSession);
+
+#   ifdef XMRIG_FEATURE_KTLS
+    if (client->m_pool.isKTLS()) {
+        SSL_CTX_set_options(m_ctx, SSL_OP_ENABLE_KTLS);
+    }
+#   endif
 }
 
 
@@ -66,6 +77,10 @@ xmrig::Client::Tls::~Tls()
     if (m_ssl) {
         SSL_free(m_ssl);
     }
+
+    if (m_socketWrite) {
+        BIO_free(m_writeBio);
+    }
 }
 
 
@@ -78,7 +93,34 @@ bool xmrig::Client::Tls::handshake()
         return false;
     }
 
+    SSL_set_app_data(m_ssl, this);
     SSL_set_connect_state(m_ssl);
+
+    if (m_client->m_tlsSession) {
+        SSL_set_session(m_ssl, m_client->m_tlsSession);
+    }
+
+#   ifdef XMRIG_FEATURE_KTLS
+    // OpenSSL hands the session keys to the kernel only with a socket BIO, so with "tls-ktls" the handshake is written
+    // to the socket directly, nothing goes through libuv before the login; reads keep the memory BIO, records like
+    // session tickets and key updates are handled by OpenSSL and libuv keeps reading the socket
+    int fd = -1;
+    if (m_client->m_pool.isKTLS() && uv_fileno(reinterpret_cast<uv_handle_t *>(m_client->m_stream), &fd) == 0) {
+        BIO *socketBio = BIO_new_socket(fd, BIO_NOCLOSE);
+
+        if (socketBio) {
+            m_socketWrite = true;
+
+            SSL_set0_rbio(m_ssl, m_readBio);
+            SSL_set0_wbio(m_ssl, socketBio);
+
+            const int rc = SSL_do_handshake(m_ssl);
+
+            return rc == 1 || SSL_get_error(m_ssl, rc) == SSL_ERROR_WANT_READ;
+        }
+    }
+#   endif
+
     SSL_set_bio(m_ssl, m_readBio, m_writeBio);
     SSL_do_handshake(m_ssl);
 
@@ -88,6 +130,10 @@ bool xmrig::Client::Tls::handshake()
 
 bool xmrig::Client::Tls::send(const char *data, size_t size)
 {
+    if (m_ktls) {
+        return m_client->write(data, size);
+    }
+
     SSL_write(m_ssl, data, size);
 
     return send();
@@ -119,12 +165,29 @@ void xmrig::Client::Tls::read(const char *data, size_t size)
             X509 *cert = SSL_get_peer_certificate(m_ssl);
             if (!verify(cert)) {
                 X509_free(cert);
-                m_client->close();
+                setSession(nullptr);
+                m_client->close(ClientStats::CloseTls);
 
                 return;
             }
 
             X509_free(cert);
+            LOG_DEBUG("[%s] TLS session %s", m_client->m_pool.url(), SSL_session_reused(m_ssl) ? "resumed" : "created");
+
+#           ifdef XMRIG_FEATURE_KTLS
+            // without kernel support for the cipher the memory BIO takes over and OpenSSL encrypts as usual
+            if (m_socketWrite) {
+                m_ktls = BIO_get_ktls_send(SSL_get_wbio(m_ssl)) != 0;
+
+                if (!m_ktls) {
+                    SSL_set0_wbio(m_ssl, m_writeBio);
+                    m_socketWrite = false;
+                }
+
+                LOG_DEBUG("[%s] kernel TLS %s", m_client->m_pool.url(), m_ktls ? "enabled" : "not available");
+            }
+#           endif
+
             m_ready = true;
             m_client->login();
       }
@@ -132,9 +195,21 @@ void xmrig::Client::Tls::read(const char *data, size_t size)
       return;
     }
 
+    // records are decrypted right behind the incomplete message of the client buffer and split like plain TCP data
     int bytes_read = 0;
-    while ((bytes_read = SSL_read(m_ssl, m_buf, sizeof(m_buf))) > 0) {
-        m_client->parse(m_buf, bytes_read);
+    for (;;) {
+        const size_t room = m_client->m_recvBuf.len - 8 - m_client->m_recvBufPos;
+        if (room == 0) {
+            m_client->close(ClientStats::CloseProtocol);
+            return;
+        }
+
+        if ((bytes_read = SSL_read(m_ssl, m_client->m_recvBuf.base + m_client->m_recvBufPos, static_cast<int>(room))) <= 0) {
+            break;
+        }
+
+        m_client->m_recvBufPos += static_cast<size_t>(bytes_read);
+        m_client->read();
     }
 }
 
@@ -188,3 +263,26 @@ bool xmrig::Client::Tls::verifyFingerprint(X509 *cert)
 
     return fingerprint == nullptr || strncasecmp(m_fingerprint, fingerprint, 64) == 0;
 }
+
+
+void xmrig::Client::Tls::setSession(SSL_SESSION *session)
+{
+    if (m_client->m_tlsSession) {
+        SSL_SESSION_free(m_client->m_tlsSession);
+    }
+
+    m_client->m_tlsSession = session;
+}
+
+
+int xmrig::Client::Tls::onNewSession(SSL *ssl, SSL_SESSION *session)
+{
+    Tls *tls = static_cast<Tls *>(SSL_get_app_data(ssl));
+    if (!tls) {
+        return 0;
+    }
+
+    tls->setSession(session);
+
+    return 1;
+}
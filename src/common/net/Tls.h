@@ -32,6 +32,11 @@
 #include "common/net/Client.h"
 
 
+#if defined(__linux__) && defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+#   define XMRIG_FEATURE_KTLS
+#endif
+
+
 namespace xmrig {
 
 
@@ -47,15 +52,21 @@ public:
     const char *version() const;
     void read(const char *data, size_t size);
 
+    inline bool isKTLS() const { return m_ktls; }
+
 private:
     bool send();
     bool verify(X509 *cert);
     bool verifyFingerprint(X509 *cert);
+    void setSession(SSL_SESSION *session);
+
+    static int onNewSession(SSL *ssl, SSL_SESSION *session);
 
     BIO *m_readBio;
     BIO *m_writeBio;
+    bool m_ktls;         // the kernel encrypts sends, plain data goes through the libuv write path
     bool m_ready;
-    char m_buf[1024 * 2];
+    bool m_socketWrite;  // handshake writes go straight to the socket, m_writeBio is not attached
     char m_fingerprint[32 * 2 + 8];
     Client *m_client;
     SSL *m_ssl;
@@ -35,6 +35,7 @@ xmrig::FailoverStrategy::FailoverStrategy(const std::vector<Pool> &pools, int re
     m_retryPause(retryPause),
     m_active(-1),
     m_index(0),
+    m_standby(0),
     m_listener(listener)
 {
     for (const Pool &pool : pools) {
@@ -49,6 +50,7 @@ xmrig::FailoverStrategy::FailoverStrategy(int retryPause, int retries, IStrategy
     m_retryPause(retryPause),
     m_active(-1),
     m_index(0),
+    m_standby(0),
     m_listener(listener)
 {
 }
@@ -137,6 +139,20 @@ void xmrig::FailoverStrategy::onClose(Client *client, int failures)
 
     if (m_active == client->id()) {
         m_active = -1;
+
+        // a logged in standby connection already holds a job, workers don't wait for a new login
+        for (Client *standby : m_pools) {
+            if (standby != client && standby->isReady() && standby->job().isValid()) {
+                m_index = m_active = standby->id();
+
+                m_listener->onActive(this, standby);
+                m_listener->onJob(this, standby, standby->job());
+
+                connectStandby();
+                return;
+            }
+        }
+
         m_listener->onPause(this);
     }
 
@@ -167,7 +183,7 @@ void xmrig::FailoverStrategy::onLoginSuccess(Client *client)
     }
 
     for (size_t i = 1; i < m_pools.size(); ++i) {
-        if (active != static_cast<int>(i)) {
+        if (active != static_cast<int>(i) && !isStandby(static_cast<int>(i), active)) {
             m_pools[i]->disconnect();
         }
     }
@@ -176,6 +192,23 @@ void xmrig::FailoverStrategy::onLoginSuccess(Client *client)
         m_index = m_active = active;
         m_listener->onActive(this, client);
     }
+
+    connectStandby();
+}
+
+
+// the next pools after the active one are kept logged in, their jobs are used only after failover
+void xmrig::FailoverStrategy::connectStandby()
+{
+    if (m_active < 0) {
+        return;
+    }
+
+    for (size_t i = static_cast<size_t>(m_active) + 1; i < m_pools.size() && isStandby(static_cast<int>(i), m_active); ++i) {
+        if (m_pools[i]->state() == Client::UnconnectedState) {
+            m_pools[i]->connect();
+        }
+    }
 }
 
 
@@ -50,6 +50,8 @@ public:
 
     void add(const Pool &pool);
 
+    inline void setStandby(int standby) { m_standby = standby; }
+
 public:
     inline bool isActive() const override  { return m_active >= 0; }
 
@@ -67,13 +69,17 @@ protected:
     void onResultAccepted(Client *client, const SubmitResult &result, const char *error) override;
 
 private:
-    inline Client *active() const { return m_pools[static_cast<size_t>(m_active)]; }
+    inline Client *active() const                      { return m_pools[static_cast<size_t>(m_active)]; }
+    inline bool isStandby(int id, int active) const    { return m_standby > 0 && active >= 0 && id > active && id <= active + m_standby; }
+
+    void connectStandby();
 
     const bool m_quiet;
     const int m_retries;
     const int m_retryPause;
     int m_active;
     int m_index;
+    int m_standby;
     IStrategyListener *m_listener;
     std::vector<Client*> m_pools;
 };
@@ -0,0 +1,289 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "common/interfaces/IStrategyListener.h"
+#include "common/net/Client.h"
+#include "common/net/strategies/LatencyStrategy.h"
+#include "common/Platform.h"
+
+
+xmrig::LatencyStrategy::LatencyStrategy(int retryPause, int retries, IStrategyListener *listener, bool quiet) :
+    m_quiet(quiet),
+    m_retries(retries),
+    m_retryPause(retryPause),
+    m_active(-1),
+    m_priority(0),
+    m_listener(listener),
+    m_selected(0)
+{
+}
+
+
+xmrig::LatencyStrategy::~LatencyStrategy()
+{
+    for (Client *client : m_pools) {
+        client->deleteLater();
+    }
+}
+
+
+void xmrig::LatencyStrategy::add(const Pool &pool)
+{
+    Client *client = new Client(static_cast<int>(m_pools.size()), Platform::userAgent(), this);
+    client->setPool(pool);
+    client->setRetries(m_retries);
+    client->setRetryPause(m_retryPause * 1000);
+    client->setQuiet(m_quiet);
+
+    m_pools.push_back(client);
+    m_stats.push_back(Stats());
+}
+
+
+int64_t xmrig::LatencyStrategy::submit(const JobResult &result)
+{
+    if (m_active == -1) {
+        return -1;
+    }
+
+    return active()->submit(result);
+}
+
+
+void xmrig::LatencyStrategy::connect()
+{
+    if (m_pools.empty()) {
+        return;
+    }
+
+    m_priority = priority(0);
+    for (size_t i = 1; i < m_pools.size(); ++i) {
+        if (priority(i) < m_priority) {
+            m_priority = priority(i);
+        }
+    }
+
+    connectGroup(m_priority);
+}
+
+
+void xmrig::LatencyStrategy::resume()
+{
+    if (!isActive()) {
+        return;
+    }
+
+    m_listener->onJob(this, active(), active()->job());
+}
+
+
+void xmrig::LatencyStrategy::setAlgo(const xmrig::Algorithm &algo)
+{
+    for (Client *client : m_pools) {
+        client->setAlgo(algo);
+    }
+}
+
+
+void xmrig::LatencyStrategy::stop()
+{
+    for (size_t i = 0; i < m_pools.size(); ++i) {
+        m_pools[i]->disconnect();
+    }
+
+    m_active = -1;
+
+    m_listener->onPause(this);
+}
+
+
+void xmrig::LatencyStrategy::tick(uint64_t now)
+{
+    for (size_t i = 0; i < m_pools.size(); ++i) {
+        m_pools[i]->tick(now);
+
+        // a new keepalived reply refreshes the estimate of idle connections
+        if (m_pools[i]->latency() != m_stats[i].latency) {
+            m_stats[i].latency = m_pools[i]->latency();
+            sample(i, m_stats[i].latency);
+        }
+    }
+
+    if (now - m_selected < kSelectInterval) {
+        return;
+    }
+
+    m_selected = now;
+
+    const int previous = m_active;
+    select();
+
+    if (isActive() && m_active != previous) {
+        m_listener->onJob(this, active(), active()->job());
+    }
+}
+
+
+void xmrig::LatencyStrategy::onClose(Client *client, int failures)
+{
+    if (failures == -1) {
+        return;
+    }
+
+    if (m_active == client->id()) {
+        m_active = -1;
+        select();
+
+        if (!isActive()) {
+            m_listener->onPause(this);
+            return;
+        }
+
+        m_listener->onJob(this, active(), active()->job());
+    }
+
+    if (isActive() || failures < m_retries) {
+        return;
+    }
+
+    // the whole group is down, bring up the next one while the failed pools keep retrying
+    int next = m_priority;
+    for (size_t i = 0; i < m_pools.size(); ++i) {
+        if (priority(i) > m_priority && (next == m_priority || priority(i) < next)) {
+            next = priority(i);
+        }
+    }
+
+    if (next != m_priority) {
+        m_priority = next;
+        connectGroup(next);
+    }
+}
+
+
+void xmrig::LatencyStrategy::onJobReceived(Client *client, const Job &job)
+{
+    if (m_active == client->id()) {
+        m_listener->onJob(this, client, job);
+    }
+}
+
+
+void xmrig::LatencyStrategy::onLoginSuccess(Client *client)
+{
+    const size_t index = static_cast<size_t>(client->id());
+
+    m_stats[index].latency = client->latency();
+    sample(index, m_stats[index].latency);
+
+    // the login job follows this call and reaches the workers through onJobReceived()
+    select();
+}
+
+
+void xmrig::LatencyStrategy::onResultAccepted(Client *client, const SubmitResult &result, const char *error)
+{
+    sample(static_cast<size_t>(client->id()), result.elapsed);
+
+    m_listener->onResultAccepted(this, client, result, error);
+}
+
+
+bool xmrig::LatencyStrategy::isHealthy(const Client *client) const
+{
+    return client->isReady() && client->job().isValid();
+}
+
+
+bool xmrig::LatencyStrategy::isBetter(size_t candidate, size_t current) const
+{
+    if (priority(candidate) != priority(current)) {
+        return priority(candidate) < priority(current);
+    }
+
+    return m_stats[candidate].rtt < m_stats[current].rtt;
+}
+
+
+int xmrig::LatencyStrategy::priority(size_t index) const
+{
+    return m_pools[index]->pool().priority();
+}
+
+
+void xmrig::LatencyStrategy::connectGroup(int priority)
+{
+    for (size_t i = 0; i < m_pools.size(); ++i) {
+        if (this->priority(i) == priority && m_pools[i]->state() == Client::UnconnectedState) {
+            m_pools[i]->connect();
+        }
+    }
+}
+
+
+void xmrig::LatencyStrategy::sample(size_t index, uint64_t rtt)
+{
+    Stats &stats = m_stats[index];
+    rtt = rtt > 0 ? rtt : 1;
+
+    stats.rtt = stats.rtt == 0 ? rtt : (stats.rtt * 3 + rtt) / 4;
+}
+
+
+void xmrig::LatencyStrategy::select()
+{
+    int best = -1;
+    for (size_t i = 0; i < m_pools.size(); ++i) {
+        if (isHealthy(m_pools[i]) && (best < 0 || isBetter(i, static_cast<size_t>(best)))) {
+            best = static_cast<int>(i);
+        }
+    }
+
+    if (best < 0 || best == m_active) {
+        return;
+    }
+
+    const size_t candidate = static_cast<size_t>(best);
+
+    // within one group switch only for a clear win, every switch costs the workers a job change
+    if (isActive() && isHealthy(active())) {
+        const size_t current = static_cast<size_t>(m_active);
+
+        if (priority(candidate) == priority(current) && m_stats[candidate].rtt * 100 >= m_stats[current].rtt * kSwitchPercent) {
+            return;
+        }
+    }
+
+    m_active   = best;
+    m_priority = priority(candidate);
+
+    for (size_t i = 0; i < m_pools.size(); ++i) {
+        if (priority(i) > m_priority) {
+            m_pools[i]->disconnect();
+        }
+    }
+
+    m_listener->onActive(this, m_pools[candidate]);
+}
@@ -0,0 +1,250 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <inttypes.h>
+#include <uv.h>
+
+
+#include "common/interfaces/IStrategyListener.h"
+#include "common/log/Log.h"
+#include "common/net/Client.h"
+#include "common/net/strategies/ProfitStrategy.h"
+#include "common/Platform.h"
+#include "core/ProfitFeed.h"
+#include "net/NetThread.h"
+#include "net/PerfSnapshot.h"
+
+
+constexpr uint64_t xmrig::ProfitStrategy::kMinDwell;
+
+
+xmrig::ProfitStrategy::ProfitStrategy(int retryPause, int retries, IStrategyListener *listener) :
+    m_retries(retries),
+    m_retryPause(retryPause),
+    m_active(-1),
+    m_listener(listener),
+    m_selected(0),
+    m_switched(0)
+{
+}
+
+
+xmrig::ProfitStrategy::~ProfitStrategy()
+{
+    for (Client *client : m_pools) {
+        client->deleteLater();
+    }
+}
+
+
+void xmrig::ProfitStrategy::add(const Pool &pool)
+{
+    Client *client = new Client(static_cast<int>(m_pools.size()), Platform::userAgent(), this);
+    client->setPool(pool);
+    client->setRetries(m_retries);
+    client->setRetryPause(m_retryPause * 1000);
+
+    m_pools.push_back(client);
+}
+
+
+int64_t xmrig::ProfitStrategy::submit(const JobResult &result)
+{
+    if (m_active == -1) {
+        return -1;
+    }
+
+    return active()->submit(result);
+}
+
+
+void xmrig::ProfitStrategy::connect()
+{
+    for (Client *client : m_pools) {
+        client->connect();
+    }
+}
+
+
+void xmrig::ProfitStrategy::resume()
+{
+    if (!isActive()) {
+        return;
+    }
+
+    m_listener->onJob(this, active(), active()->job());
+}
+
+
+void xmrig::ProfitStrategy::setAlgo(const xmrig::Algorithm &algo)
+{
+    for (Client *client : m_pools) {
+        client->setAlgo(algo);
+    }
+}
+
+
+void xmrig::ProfitStrategy::stop()
+{
+    for (Client *client : m_pools) {
+        client->disconnect();
+    }
+
+    m_active = -1;
+
+    m_listener->onPause(this);
+}
+
+
+void xmrig::ProfitStrategy::tick(uint64_t now)
+{
+    for (Client *client : m_pools) {
+        client->tick(now);
+    }
+
+    if (now - m_selected < kSelectInterval) {
+        return;
+    }
+
+    m_selected = now;
+
+    const int previous = m_active;
+    select(now);
+
+    if (isActive() && m_active != previous) {
+        m_listener->onJob(this, active(), active()->job());
+    }
+}
+
+
+void xmrig::ProfitStrategy::onClose(Client *client, int failures)
+{
+    if (failures == -1 || m_active != client->id()) {
+        return;
+    }
+
+    m_active = -1;
+    select(uv_now(NetThread::loop()));
+
+    if (!isActive()) {
+        m_listener->onPause(this);
+        return;
+    }
+
+    m_listener->onJob(this, active(), active()->job());
+}
+
+
+// an inactive pool may change its algo with a new job, the choice follows at the next select
+void xmrig::ProfitStrategy::onJobReceived(Client *client, const Job &job)
+{
+    if (m_active == client->id()) {
+        m_listener->onJob(this, client, job);
+    }
+}
+
+
+// the login job follows this call and reaches the workers through onJobReceived()
+void xmrig::ProfitStrategy::onLoginSuccess(Client *)
+{
+    select(uv_now(NetThread::loop()));
+}
+
+
+void xmrig::ProfitStrategy::onResultAccepted(Client *client, const SubmitResult &result, const char *error)
+{
+    m_listener->onResultAccepted(this, client, result, error);
+}
+
+
+bool xmrig::ProfitStrategy::isHealthy(const Client *client) const
+{
+    return client->isReady() && client->job().isValid();
+}
+
+
+// expected value per second of mining the current job of the pool, 0 without algo-perf or feed value for its algo
+double xmrig::ProfitStrategy::value(size_t index) const
+{
+    const xmrig::PerfAlgo pa = m_pools[index]->job().algorithm().perf_algo();
+    if (pa == xmrig::PerfAlgo::PA_INVALID) {
+        return 0.0;
+    }
+
+    return xmrig::PerfSnapshot::get().algoPerf[pa] * ProfitFeed::value(pa);
+}
+
+
+// without any values (no feed yet, or it expired) the first healthy pool is mined like with failover, otherwise
+// the best pool replaces the active one after the dwell time if it earns more even after the switch cost
+void xmrig::ProfitStrategy::select(uint64_t now)
+{
+    int best          = -1;
+    double bestValue  = 0.0;
+
+    for (size_t i = 0; i < m_pools.size(); ++i) {
+        if (!isHealthy(m_pools[i])) {
+            continue;
+        }
+
+        const double v = value(i);
+        if (best < 0 || v > bestValue) {
+            best      = static_cast<int>(i);
+            bestValue = v;
+        }
+    }
+
+    if (best < 0 || best == m_active) {
+        return;
+    }
+
+    if (isActive() && isHealthy(active())) {
+        const double current = value(static_cast<size_t>(m_active));
+        const xmrig::PerfSnapshot::Data &perf = xmrig::PerfSnapshot::get();
+        const uint64_t dwell                  = std::max<uint64_t>(kMinDwell, perf.minDwell * 1000ULL);
+
+        if (now - m_switched < dwell) {
+            return;
+        }
+
+        const xmrig::PerfAlgo from = active()->job().algorithm().perf_algo();
+        const xmrig::PerfAlgo to   = m_pools[static_cast<size_t>(best)]->job().algorithm().perf_algo();
+        const uint64_t cost        = from == to || from == xmrig::PerfAlgo::PA_INVALID ? 0 : perf.switchCost[from][to];
+
+        // over one dwell time the candidate loses the switch cost and must still win by the margin
+        if (bestValue * static_cast<double>(dwell - std::min(cost, dwell)) <= current * static_cast<double>(dwell) * kSwitchMargin) {
+            return;
+        }
+
+        LOG_INFO("profit switch to %s:%d (%s), %.3g against %.3g per second, algo switch %" PRIu64 " ms",
+                 m_pools[static_cast<size_t>(best)]->host(), m_pools[static_cast<size_t>(best)]->port(),
+                 xmrig::Algorithm::perfAlgoName(to), bestValue, current, cost);
+    }
+
+    m_active   = best;
+    m_switched = now;
+
+    m_listener->onActive(this, m_pools[static_cast<size_t>(best)]);
+}
@@ -0,0 +1,238 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <uv.h>
+
+
+#include "common/interfaces/IStrategyListener.h"
+#include "common/net/Client.h"
+#include "common/net/strategies/WeightedStrategy.h"
+#include "common/Platform.h"
+#include "net/JobResult.h"
+#include "net/NetThread.h"
+
+
+xmrig::WeightedStrategy::WeightedStrategy(int retryPause, int retries, IStrategyListener *listener, bool quiet) :
+    m_quiet(quiet),
+    m_retries(retries),
+    m_retryPause(retryPause),
+    m_active(-1),
+    m_listener(listener),
+    m_sliceEnd(0),
+    m_sliceStart(0)
+{
+}
+
+
+xmrig::WeightedStrategy::~WeightedStrategy()
+{
+    for (Client *client : m_pools) {
+        client->deleteLater();
+    }
+}
+
+
+void xmrig::WeightedStrategy::add(const Pool &pool)
+{
+    Client *client = new Client(static_cast<int>(m_pools.size()), Platform::userAgent(), this);
+    client->setPool(pool);
+    client->setRetries(m_retries);
+    client->setRetryPause(m_retryPause * 1000);
+    client->setQuiet(m_quiet);
+
+    m_pools.push_back(client);
+    m_mined.push_back(0);
+}
+
+
+// shares found before a slice ended still belong to the pool of their job
+int64_t xmrig::WeightedStrategy::submit(const JobResult &result)
+{
+    if (result.poolId < 0 || static_cast<size_t>(result.poolId) >= m_pools.size()) {
+        return -1;
+    }
+
+    return m_pools[static_cast<size_t>(result.poolId)]->submit(result);
+}
+
+
+void xmrig::WeightedStrategy::connect()
+{
+    for (Client *client : m_pools) {
+        client->connect();
+    }
+}
+
+
+void xmrig::WeightedStrategy::resume()
+{
+    if (!isActive()) {
+        return;
+    }
+
+    m_listener->onJob(this, active(), active()->job());
+}
+
+
+void xmrig::WeightedStrategy::setAlgo(const xmrig::Algorithm &algo)
+{
+    for (Client *client : m_pools) {
+        client->setAlgo(algo);
+    }
+}
+
+
+void xmrig::WeightedStrategy::stop()
+{
+    for (size_t i = 0; i < m_pools.size(); ++i) {
+        m_pools[i]->disconnect();
+    }
+
+    m_active = -1;
+
+    m_listener->onPause(this);
+}
+
+
+void xmrig::WeightedStrategy::tick(uint64_t now)
+{
+    for (Client *client : m_pools) {
+        client->tick(now);
+    }
+
+    if (isActive() && now >= m_sliceEnd) {
+        select(now);
+    }
+}
+
+
+void xmrig::WeightedStrategy::onClose(Client *client, int failures)
+{
+    if (failures == -1 || m_active != client->id()) {
+        return;
+    }
+
+    select(uv_now(NetThread::loop()));
+
+    if (!isActive()) {
+        m_listener->onPause(this);
+    }
+}
+
+
+void xmrig::WeightedStrategy::onJobReceived(Client *client, const Job &job)
+{
+    if (m_active == client->id()) {
+        m_listener->onJob(this, client, job);
+    }
+}
+
+
+void xmrig::WeightedStrategy::onLoginSuccess(Client *client)
+{
+    if (isActive()) {
+        return;
+    }
+
+    // the login job follows this call and reaches the workers through onJobReceived()
+    m_active     = client->id();
+    m_sliceStart = uv_now(NetThread::loop());
+    m_sliceEnd   = m_sliceStart + kSliceTime;
+
+    m_listener->onActive(this, client);
+}
+
+
+void xmrig::WeightedStrategy::onResultAccepted(Client *client, const SubmitResult &result, const char *error)
+{
+    m_listener->onResultAccepted(this, client, result, error);
+}
+
+
+bool xmrig::WeightedStrategy::isHealthy(const Client *client) const
+{
+    return client->isReady() && client->job().isValid();
+}
+
+
+// time of a slice is credited to the active pool, pools which are offline are credited their share too,
+// so they don't take the GPUs for a long catch up burst after reconnect
+void xmrig::WeightedStrategy::account(uint64_t now)
+{
+    if (isActive() && now > m_sliceStart) {
+        const uint64_t elapsed = now - m_sliceStart;
+        const uint64_t weight  = static_cast<uint64_t>(active()->pool().weight());
+
+        for (size_t i = 0; i < m_pools.size(); ++i) {
+            if (i == static_cast<size_t>(m_active)) {
+                m_mined[i] += elapsed;
+            }
+            else if (!isHealthy(m_pools[i])) {
+                m_mined[i] += elapsed * static_cast<uint64_t>(m_pools[i]->pool().weight()) / weight;
+            }
+        }
+    }
+
+    m_sliceStart = now;
+}
+
+
+// the next slice goes to the healthy pool which is furthest behind its share of mining time,
+// workers keep a paused job with its nonce per pool, so returning to a job continues where it stopped
+void xmrig::WeightedStrategy::select(uint64_t now)
+{
+    account(now);
+
+    int best = -1;
+    for (size_t i = 0; i < m_pools.size(); ++i) {
+        if (!isHealthy(m_pools[i])) {
+            continue;
+        }
+
+        if (best < 0) {
+            best = static_cast<int>(i);
+            continue;
+        }
+
+        const size_t current = static_cast<size_t>(best);
+        if (m_mined[i] * static_cast<uint64_t>(m_pools[current]->pool().weight()) < m_mined[current] * static_cast<uint64_t>(m_pools[i]->pool().weight())) {
+            best = static_cast<int>(i);
+        }
+    }
+
+    m_sliceEnd = now + kSliceTime;
+
+    if (best == m_active) {
+        return;
+    }
+
+    m_active = best;
+    if (!isActive()) {
+        return;
+    }
+
+    m_listener->onActive(this, active());
+    m_listener->onJob(this, active(), active()->job());
+}
@@ -57,6 +57,16 @@ enum PerfAlgo {
     PA_MAX
 };
 
+// variants that share the threads of their perf algo but run their own cn1 kernel,
+// their algo-perf is the perf algo one scaled by a measured ratio
+enum PerfFork {
+    FORK_INVALID = -1,
+    FORK_CN_MSR,        /* cn/msr (Masari), PA_CN */
+    FORK_CN_XAO,        /* cn/xao (Alloy), PA_CN */
+    FORK_CN_HEAVY_TUBE, /* cn-heavy/tube (BitTube), PA_CN_HEAVY */
+    FORK_MAX
+};
+
 //--av=1 For CPUs with hardware AES.
 //--av=2 Lower power mode (double hash) of 1.
 //--av=3 Software AES implementation.
@@ -22,21 +22,28 @@
  *   along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <uv.h>
 #include <inttypes.h>
 
 
+#include "amd/OclCache.h"
 #include "amd/OclGPU.h"
 #include "amd/OclLib.h"
 #include "common/config/ConfigLoader.h"
 #include "common/log/Log.h"
 #include "core/Config.h"
 #include "core/ConfigCreator.h"
+#include "core/StartupProfile.h"
 #include "crypto/CryptoNight_constants.h"
 #include "rapidjson/document.h"
 #include "rapidjson/filewritestream.h"
 #include "rapidjson/prettywriter.h"
+#include "net/StratumServer.h"
 #include "workers/OclThread.h"
 
 
@@ -60,10 +67,60 @@ static const char *vendors[] = {
 
 
 xmrig::Config::Config() : xmrig::CommonConfig(),
+    m_autoAffinity(false),
     m_autoConf(false),
+    m_autotune(false),
+    m_autotunePower(false),
+    m_bench(false),
+    m_benchCsv(false),
     m_cache(true),
+    m_deriveThreads(false),
+    m_deviceContexts(false),
+    m_diagnostics(false),
+    m_lowCpu(false),
+    m_netThread(false),
+    m_oneGbPages(false),
+    m_profiling(false),
+    m_recalibrate(false),
+    m_reportDevices(false),
+    m_stress(false),
+    m_testSwitch(false),
+    m_replaySpeed(1.0),
+    m_specialize(false),
     m_shouldSave(false),
+    m_autotuneTime(10),
     m_platformIndex(0),
+    m_stressTime(30),
+    m_logSummary(0),
+    m_logRing(0),
+    m_verifyThreads(2),
+    m_verifyGpu(-1),
+    m_gpuPriority(3),
+    m_verifyPriority(2),
+    m_verifyAffinity(0),
+    m_verifySample(1),
+    m_verifyThreshold(5),
+    m_cpuThreads(0),
+    m_cpuAffinity(0),
+    m_handover(0),
+    m_batchSplit(1),
+    m_tdrLimit(0),
+    m_canaryWindow(1800),
+    m_fleetInterval(300),
+    m_profitInterval(60),
+    m_pushInterval(10),
+    m_oclTrace(0),
+    m_staleTarget(0),
+    m_minSubmitDiff(0),
+    m_stratumPort(0),
+    m_tempTarget(0),
+    m_powerTarget(0),
+    m_desktopDuty(0),
+    m_desktopIdle(60),
+    m_parkAfter(0),
+    m_algoMinDwell(0),
+    m_errorAction(ERROR_ACTION_NONE),
+    m_idleWork(IDLE_WORK_NONE),
 #   if defined(__APPLE__)
     m_loader("/System/Library/Frameworks/OpenCL.framework/OpenCL"),
 #   elif defined(_WIN32)
@@ -76,7 +133,12 @@ xmrig::Config::Config() : xmrig::CommonConfig(),
     // not defined algo performance is considered to be 0
     for (int a = 0; a != xmrig::PerfAlgo::PA_MAX; ++ a) {
         const xmrig::PerfAlgo pa = static_cast<xmrig::PerfAlgo>(a);
-        m_algo_perf[pa] = 0.0f;
+        m_algo_perf[pa]      = 0.0f;
+        m_derivedThreads[pa] = false;
+    }
+
+    for (int f = 0; f != xmrig::PerfFork::FORK_MAX; ++ f) {
+        m_perf_fork_ratio[f] = 0.0f;
     }
 }
 
@@ -101,11 +163,56 @@ bool xmrig::Config::isCNv2() const
 }
 
 
+// some enabled pool can serve an algorithm of the perf algo and it is compiled in
+bool xmrig::Config::isPoolPerfAlgo(const xmrig::PerfAlgo pa) const
+{
+    switch (pa) {
+#   ifdef XMRIG_NO_CN_GPU
+    case PA_CN_GPU:
+        return false;
+#   endif
+
+#   ifdef XMRIG_NO_AEON
+    case PA_CN_LITE:
+        return false;
+#   endif
+
+#   ifdef XMRIG_NO_SUMO
+    case PA_CN_HEAVY:
+        return false;
+#   endif
+
+#   ifdef XMRIG_NO_CN_PICO
+    case PA_CN_PICO:
+        return false;
+#   endif
+
+    default:
+        break;
+    }
+
+    for (const Pool &pool : m_pools.data()) {
+        if (!pool.isEnabled()) {
+            continue;
+        }
+
+        for (const Algorithm &algorithm : pool.algorithms()) {
+            if (algorithm.perf_algo() == pa) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+
 bool xmrig::Config::oclInit()
 {
     LOG_WARN("compiling code and initializing GPUs. This will take a while...");
 
     if (m_vendor != OCL_VENDOR_MANUAL) {
+        StartupProfile::Scope scope("platform");
         m_platformIndex = OclGPU::findPlatformIdx(this);
         if (m_platformIndex == -1) {
             LOG_ERR("%s%s OpenCL platform NOT found.", isColors() ? "\x1B[1;31m" : "", vendorName(m_vendor));
@@ -118,12 +225,21 @@ bool xmrig::Config::oclInit()
         return false;
     }
 
+    // only threads of the config file are a source of derived threads
+    bool configured[xmrig::PerfAlgo::PA_MAX];
+    for (int a = 0; a != xmrig::PerfAlgo::PA_MAX; ++ a) {
+        configured[a] = !m_threads[a].empty();
+    }
+
     for (int a = 0; a != xmrig::PerfAlgo::PA_MAX; ++ a) {
         const xmrig::PerfAlgo pa = static_cast<xmrig::PerfAlgo>(a);
         if (m_threads[pa].empty() && !m_oclCLI.setup(m_threads[pa])) {
             m_autoConf   = true;
             m_shouldSave = true;
-            m_oclCLI.autoConf(m_threads[pa], xmrig::Algorithm(pa), this);
+
+            StartupProfile::Scope scope(std::string("autoconf ") + xmrig::Algorithm::perfAlgoName(pa));
+            const xmrig::PerfAlgo source = m_deriveThreads ? deriveSource(pa, configured) : xmrig::PA_INVALID;
+            m_derivedThreads[pa] = m_oclCLI.autoConf(m_threads[pa], xmrig::Algorithm(pa), this, source);
         }
         m_threads[pa] = filterThreads(pa);
         if (m_threads[pa].empty()) return false;
@@ -133,6 +249,55 @@ bool xmrig::Config::oclInit()
 }
 
 
+// the configured perf algo with the nearest scratchpad size, cn/gpu runs other kernels and is never derived
+xmrig::PerfAlgo xmrig::Config::deriveSource(const xmrig::PerfAlgo pa, const bool *configured)
+{
+    if (pa == xmrig::PA_CN_GPU) {
+        return xmrig::PA_INVALID;
+    }
+
+    const double memory = static_cast<double>(xmrig::cn_select_memory(xmrig::Algorithm(pa).algo()));
+    xmrig::PerfAlgo source = xmrig::PA_INVALID;
+    double nearest = 0.0;
+
+    for (int a = 0; a != xmrig::PerfAlgo::PA_MAX; ++ a) {
+        if (!configured[a] || a == xmrig::PA_CN_GPU) {
+            continue;
+        }
+
+        const double distance = fabs(log2(xmrig::cn_select_memory(xmrig::Algorithm(static_cast<xmrig::PerfAlgo>(a)).algo()) / memory));
+        if (source == xmrig::PA_INVALID || distance < nearest) {
+            source  = static_cast<xmrig::PerfAlgo>(a);
+            nearest = distance;
+        }
+    }
+
+    return source;
+}
+
+
+// a reloaded config is not passed to oclInit, it takes the platform of the running config unless the vendor changed
+void xmrig::Config::oclReload(const Config *previous)
+{
+    if (m_vendor == previous->m_vendor) {
+        m_platformIndex = previous->m_platformIndex;
+    }
+    else if (m_vendor != OCL_VENDOR_MANUAL) {
+        const int index = OclGPU::findPlatformIdx(this);
+        if (index == -1) {
+            LOG_ERR("%s%s OpenCL platform NOT found.", isColors() ? "\x1B[1;31m" : "", vendorName(m_vendor));
+        }
+
+        m_platformIndex = index == -1 ? previous->m_platformIndex : index;
+    }
+
+    for (int a = 0; a != xmrig::PerfAlgo::PA_MAX; ++ a) {
+        const xmrig::PerfAlgo pa = static_cast<xmrig::PerfAlgo>(a);
+        m_threads[pa] = filterThreads(pa);
+    }
+}
+
+
 bool xmrig::Config::reload(const char *json)
 {
     return xmrig::ConfigLoader::reload(this, json);
@@ -163,13 +328,23 @@ void xmrig::Config::getJSON(rapidjson::Document &doc) const
     doc.AddMember("cache",           isOclCache(), allocator);
     doc.AddMember("colors",          isColors(), allocator);
     doc.AddMember("donate-level",    donateLevel(), allocator);
+    doc.AddMember("log-async",       isLogAsync(), allocator);
     doc.AddMember("log-file",        logFile() ? Value(StringRef(logFile())).Move() : Value(kNullType).Move(), allocator);
     doc.AddMember("opencl-platform", vendor() == OCL_VENDOR_MANUAL ? Value(platformIndex()).Move() : Value(StringRef(vendorName(vendor()))).Move(), allocator);
     doc.AddMember("opencl-loader",   StringRef(loader()), allocator);
+    doc.AddMember("opencl-cache-import", cacheImport() ? Value(StringRef(cacheImport())).Move() : Value(kNullType).Move(), allocator);
+    doc.AddMember("opencl-source", oclSource() ? Value(StringRef(oclSource())).Move() : Value(kNullType).Move(), allocator);
+    doc.AddMember("opencl-profiling", isOclProfiling(), allocator);
+    doc.AddMember("opencl-specialize", isOclSpecialize(), allocator);
+    doc.AddMember("opencl-device-contexts", isOclDeviceContexts(), allocator);
+    doc.AddMember("opencl-low-cpu", isOclLowCpu(), allocator);
     doc.AddMember("pools",           m_pools.toJSON(doc), allocator);
     doc.AddMember("print-time",      printTime(), allocator);
     doc.AddMember("retries",         m_pools.retries(), allocator);
     doc.AddMember("retry-pause",     m_pools.retryPause(), allocator);
+    doc.AddMember("pool-standby",    m_pools.standby(), allocator);
+    doc.AddMember("pool-strategy",   StringRef(m_pools.strategyName()), allocator);
+    doc.AddMember("dual-pool",       m_dualPool.isValid() ? m_dualPool.toJSON(doc) : Value(kNullType), allocator);
 
     // save extended "threads" based on m_threads
     Value threads(kObjectType);
@@ -191,10 +366,84 @@ void xmrig::Config::getJSON(rapidjson::Document &doc) const
         Value key(xmrig::Algorithm::perfAlgoName(pa), allocator);
         algo_perf.AddMember(key, Value(m_algo_perf[pa]), allocator);
     }
+    // measured perf forks are saved as hashrates too, their ratio is restored from them
+    for (int f = 0; f != xmrig::PerfFork::FORK_MAX; ++ f) {
+        const xmrig::PerfFork pf = static_cast<xmrig::PerfFork>(f);
+        if (m_perf_fork_ratio[pf] > 0.0f) {
+            Value key(xmrig::Algorithm::perfForkName(pf), allocator);
+            algo_perf.AddMember(key, Value(get_algorithm_perf(xmrig::Algorithm(pf))), allocator);
+        }
+    }
     doc.AddMember("algo-perf", algo_perf, allocator);
 
+    // save "algo-perf-devices" based on m_device_algo_perf
+    Value device_algo_perf(kArrayType);
+    for (const auto &device : m_device_algo_perf) {
+        Value device_obj(kObjectType);
+        Value algo_perf2(kObjectType);
+        for (int a = 0; a != xmrig::PerfAlgo::PA_MAX; ++ a) {
+            const xmrig::PerfAlgo pa = static_cast<xmrig::PerfAlgo>(a);
+            Value key(xmrig::Algorithm::perfAlgoName(pa), allocator);
+            algo_perf2.AddMember(key, Value(device.second.perf[pa]), allocator);
+        }
+        device_obj.AddMember("index", static_cast<uint64_t>(device.first), allocator);
+        device_obj.AddMember("board", device.second.board.toJSON(doc), allocator);
+        device_obj.AddMember("device", Value(device.second.device.c_str(), allocator), allocator);
+        device_obj.AddMember("driver", device.second.driver, allocator);
+        device_obj.AddMember("algo-perf", algo_perf2, allocator);
+        device_algo_perf.PushBack(device_obj, allocator);
+    }
+    doc.AddMember("algo-perf-devices", device_algo_perf, allocator);
+
     doc.AddMember("calibrate-algo", isCalibrateAlgo(), allocator);
     doc.AddMember("calibrate-algo-time", calibrateAlgoTime(), allocator);
+    doc.AddMember("recalibrate-algo", isRecalibrateAlgo(), allocator);
+    doc.AddMember("autotune", isAutotune(), allocator);
+    doc.AddMember("autotune-time", autotuneTime(), allocator);
+    doc.AddMember("autotune-power", isAutotunePower(), allocator);
+    doc.AddMember("stress", isStress(), allocator);
+    doc.AddMember("stress-time", stressTime(), allocator);
+    doc.AddMember("log-summary", logSummary(), allocator);
+    doc.AddMember("log-ring", logRing(), allocator);
+    doc.AddMember("report-devices", isReportDevices(), allocator);
+    doc.AddMember("verify-threads", verifyThreads(), allocator);
+    doc.AddMember("verify-affinity", verifyAffinity(), allocator);
+    doc.AddMember("auto-affinity", isAutoAffinity(), allocator);
+    doc.AddMember("gpu-priority", gpuPriority(), allocator);
+    doc.AddMember("verify-priority", verifyPriority(), allocator);
+    doc.AddMember("verify-sample", verifySample(), allocator);
+    doc.AddMember("verify-error-threshold", verifyErrorThreshold(), allocator);
+    doc.AddMember("verify-gpu", verifyGpu() >= 0 ? Value(verifyGpu()).Move() : Value(kNullType).Move(), allocator);
+    doc.AddMember("batch-split", batchSplit(), allocator);
+    doc.AddMember("tdr-limit", tdrLimit(), allocator);
+    doc.AddMember("opencl-trace", oclTrace(), allocator);
+    doc.AddMember("stale-target", staleTarget(), allocator);
+    doc.AddMember("min-submit-diff", minSubmitDiff(), allocator);
+    doc.AddMember("temp-target", tempTarget(), allocator);
+    doc.AddMember("power-target", powerTarget(), allocator);
+    doc.AddMember("desktop-duty", desktopDuty(), allocator);
+    doc.AddMember("desktop-idle", desktopIdle(), allocator);
+    doc.AddMember("park-after", parkAfter(), allocator);
+    doc.AddMember("algo-min-dwell", algoMinDwell(), allocator);
+    doc.AddMember("error-action", StringRef(errorActionName()), allocator);
+    doc.AddMember("idle-work", StringRef(idleWorkName()), allocator);
+    doc.AddMember("stratum-port", stratumPort(), allocator);
+    doc.AddMember("cpu-threads", cpuThreads(), allocator);
+    doc.AddMember("cpu-affinity", cpuAffinity(), allocator);
+    doc.AddMember("1gb-pages", isOneGbPages(), allocator);
+    doc.AddMember("trace-file", traceFile() ? Value(StringRef(traceFile())).Move() : Value(kNullType).Move(), allocator);
+    doc.AddMember("fleet-url", fleetUrl() ? Value(StringRef(fleetUrl())).Move() : Value(kNullType).Move(), allocator);
+    doc.AddMember("fleet-interval", fleetInterval(), allocator);
+    doc.AddMember("profit-url", profitUrl() ? Value(StringRef(profitUrl())).Move() : Value(kNullType).Move(), allocator);
+    doc.AddMember("profit-interval", profitInterval(), allocator);
+    doc.AddMember("push-url", pushUrl() ? Value(StringRef(pushUrl())).Move() : Value(kNullType).Move(), allocator);
+    doc.AddMember("push-interval", pushInterval(), allocator);
+    doc.AddMember("stats-shm", statsShm() ? Value(StringRef(statsShm())).Move() : Value(kNullType).Move(), allocator);
+    doc.AddMember("state-file", stateFile() ? Value(StringRef(stateFile())).Move() : Value(kNullType).Move(), allocator);
+    doc.AddMember("canary-window", canaryWindow(), allocator);
+    doc.AddMember("diagnostics", isDiagnostics(), allocator);
+    doc.AddMember("derive-threads", isDeriveThreads(), allocator);
+    doc.AddMember("net-thread", isNetThread(), allocator);
 
     doc.AddMember("user-agent", userAgent() ? Value(StringRef(userAgent())).Move() : Value(kNullType).Move(), allocator);
     doc.AddMember("syslog",     isSyslog(), allocator);
@@ -208,6 +457,40 @@ xmrig::Config *xmrig::Config::load(Process *process, IConfigListener *listener)
 }
 
 
+const char *xmrig::Config::errorActionName() const
+{
+    switch (m_errorAction) {
+    case ERROR_ACTION_INTENSITY:
+        return "intensity";
+
+    case ERROR_ACTION_DISABLE:
+        return "disable";
+
+    default:
+        break;
+    }
+
+    return "none";
+}
+
+
+const char *xmrig::Config::idleWorkName() const
+{
+    switch (m_idleWork) {
+    case IDLE_WORK_CALIBRATE:
+        return "calibrate";
+
+    case IDLE_WORK_AUTOTUNE:
+        return "autotune";
+
+    default:
+        break;
+    }
+
+    return "none";
+}
+
+
 const char *xmrig::Config::vendorName(xmrig::OclVendor vendor)
 {
     if (vendor == xmrig::OCL_VENDOR_MANUAL) {
@@ -224,6 +507,18 @@ bool xmrig::Config::finalize()
         return CommonConfig::finalize();
     }
 
+    // the pools of the config are replaced by the mock pool of the test or replay, there is nothing to donate to
+    if (isMockPool()) {
+        char url[32];
+        snprintf(url, sizeof(url), "127.0.0.1:%u", static_cast<unsigned int>(StratumServer::kTestPort));
+
+        m_pools = Pools();
+        m_pools.setUrl(url);
+        m_pools.setUser(m_testSwitch ? "switch-test" : "replay");
+        m_dualPool    = Pool();
+        m_donateLevel = 0;
+    }
+
     if (!CommonConfig::finalize()) {
         return false;
     }
@@ -243,6 +538,62 @@ bool xmrig::Config::parseBoolean(int key, bool enable)
         m_cache = enable;
         break;
 
+    case OclProfilingKey: /* opencl-profiling */
+        m_profiling = enable;
+        break;
+
+    case OclSpecializeKey: /* opencl-specialize */
+        m_specialize = enable;
+        break;
+
+    case OclDeviceContextsKey: /* opencl-device-contexts */
+        m_deviceContexts = enable;
+        break;
+
+    case OclLowCpuKey: /* opencl-low-cpu */
+        m_lowCpu = enable;
+        break;
+
+    case OclAutotuneKey: /* autotune */
+        m_autotune = enable;
+        break;
+
+    case AutotunePowerKey: /* autotune-power */
+        m_autotunePower = enable;
+        break;
+
+    case OclReportDevicesKey: /* report-devices */
+        m_reportDevices = enable;
+        break;
+
+    case StressKey: /* stress */
+        m_stress = enable;
+        break;
+
+    case RecalibrateAlgoKey: /* recalibrate-algo */
+        m_recalibrate = enable;
+        break;
+
+    case OneGbPagesKey: /* 1gb-pages */
+        m_oneGbPages = enable;
+        break;
+
+    case AutoAffinityKey: /* auto-affinity */
+        m_autoAffinity = enable;
+        break;
+
+    case DiagnosticsKey: /* diagnostics */
+        m_diagnostics = enable;
+        break;
+
+    case DeriveThreadsKey: /* derive-threads */
+        m_deriveThreads = enable;
+        break;
+
+    case NetThreadKey: /* net-thread */
+        m_netThread = enable;
+        break;
+
     default:
         break;
     }
@@ -289,6 +640,93 @@ bool xmrig::Config::parseString(int key, const char *arg)
     case OclCacheKey: /* --no-cache */
         return parseBoolean(key, false);
 
+    case OclProfilingKey: /* --opencl-profiling */
+    case OclSpecializeKey: /* --opencl-specialize */
+    case OclDeviceContextsKey: /* --opencl-device-contexts */
+    case OclLowCpuKey: /* --opencl-low-cpu */
+    case OclAutotuneKey: /* --autotune */
+    case AutotunePowerKey: /* --autotune-power */
+    case StressKey: /* --stress */
+    case OclReportDevicesKey: /* --report-devices */
+    case OneGbPagesKey: /* --1gb-pages */
+    case AutoAffinityKey: /* --auto-affinity */
+    case RecalibrateAlgoKey: /* --recalibrate-algo */
+    case DiagnosticsKey: /* --diagnostics */
+    case DeriveThreadsKey: /* --derive-threads */
+    case NetThreadKey: /* --net-thread */
+        return parseBoolean(key, true);
+
+    case OclAutotuneTimeKey: /* --autotune-time */
+    case StressTimeKey: /* --stress-time */
+    case LogSummaryKey: /* --log-summary */
+    case LogRingKey: /* --log-ring */
+    case VerifyThreadsKey: /* --verify-threads */
+    case GpuPriorityKey: /* --gpu-priority */
+    case VerifyPriorityKey: /* --verify-priority */
+    case VerifySampleKey: /* --verify-sample */
+    case VerifyThresholdKey: /* --verify-error-threshold */
+    case VerifyGpuKey: /* --verify-gpu */
+    case BatchSplitKey: /* --batch-split */
+    case TdrLimitKey: /* --tdr-limit */
+    case OclTraceKey: /* --opencl-trace */
+    case FleetIntervalKey: /* --fleet-interval */
+    case ProfitIntervalKey: /* --profit-interval */
+    case PushIntervalKey: /* --push-interval */
+    case CanaryWindowKey: /* --canary-window */
+    case StaleTargetKey: /* --stale-target */
+    case MinSubmitDiffKey: /* --min-submit-diff */
+    case TempTargetKey: /* --temp-target */
+    case PowerTargetKey: /* --power-target */
+    case DesktopDutyKey: /* --desktop-duty */
+    case DesktopIdleKey: /* --desktop-idle */
+    case ParkAfterKey: /* --park-after */
+    case AlgoMinDwellKey: /* --algo-min-dwell */
+    case StratumPortKey: /* --stratum-port */
+    case CpuThreadsKey: /* --cpu-threads */
+        return parseUint64(key, strtol(arg, nullptr, 10));
+
+    case VerifyAffinityKey: /* --verify-affinity */
+    case CpuAffinityKey: /* --cpu-affinity */
+        return parseUint64(key, strtoull(arg, nullptr, 0));
+
+    case OclBenchKey: /* --bench */
+        m_bench = true;
+        setBenchAlgos(arg);
+        m_profiling = true; // kernel times are part of the report
+        break;
+
+    case TestSwitchKey: /* --test-switch */
+        m_testSwitch = true;
+        break;
+
+    case RecordSessionKey: /* --record-session */
+        m_recordSession = arg;
+        break;
+
+    case ReplaySessionKey: /* --replay-session */
+        m_replaySession = arg;
+        break;
+
+    case HandoverKey: /* --handover */
+        m_handover = strtoll(arg, nullptr, 10);
+        break;
+
+    case ReplaySpeedKey: /* --replay-speed */
+        m_replaySpeed = std::max(strtod(arg, nullptr), 0.01);
+        break;
+
+    case OclBenchFormatKey: /* --bench-format */
+        m_benchCsv = strcasecmp(arg, "csv") == 0;
+        break;
+
+    case ErrorActionKey: /* --error-action */
+        setErrorAction(arg);
+        break;
+
+    case IdleWorkKey: /* --idle-work */
+        setIdleWork(arg);
+        break;
+
     case OclPrintKey: /* --print-platforms */
         if (OclLib::init(loader())) {
             printPlatforms();
@@ -303,6 +741,46 @@ bool xmrig::Config::parseString(int key, const char *arg)
         m_loader = arg;
         break;
 
+    case OclCacheExportKey: /* --opencl-cache-export */
+        OclCache::exportBundle(arg);
+        return false;
+
+    case OclCacheMergeKey: /* --opencl-cache-merge */
+        OclCache::mergeBundle(arg);
+        return false;
+
+    case OclCacheImportKey: /* --opencl-cache-import */
+        m_cacheImport = arg;
+        break;
+
+    case OclSourceKey: /* --opencl-source */
+        m_oclSource = arg;
+        break;
+
+    case TraceFileKey: /* --trace-file */
+        m_traceFile = arg;
+        break;
+
+    case FleetUrlKey: /* --fleet-url */
+        m_fleetUrl = arg;
+        break;
+
+    case ProfitUrlKey: /* --profit-url */
+        m_profitUrl = arg;
+        break;
+
+    case PushUrlKey: /* --push-url */
+        m_pushUrl = arg;
+        break;
+
+    case StatsShmKey: /* --stats-shm */
+        m_statsShm = arg;
+        break;
+
+    case StateFileKey: /* --state-file */
+        m_stateFile = arg;
+        break;
+
     default:
         break;
     }
@@ -322,6 +800,174 @@ bool xmrig::Config::parseUint64(int key, uint64_t arg)
         setPlatformIndex(static_cast<int>(arg));
         break;
 
+    case OclAutotuneTimeKey: /* --autotune-time */
+        if (arg >= 2 && arg <= 3600) {
+            m_autotuneTime = static_cast<int>(arg);
+        }
+        break;
+
+    case StressTimeKey: /* --stress-time */
+        if (arg >= 5 && arg <= 3600) {
+            m_stressTime = static_cast<int>(arg);
+        }
+        break;
+
+    case LogSummaryKey: /* --log-summary */
+        if (arg == 0 || (arg >= 10 && arg <= 3600)) {
+            m_logSummary = static_cast<int>(arg);
+        }
+        break;
+
+    case LogRingKey: /* --log-ring */
+        if (arg <= 100000) {
+            m_logRing = static_cast<int>(arg);
+        }
+        break;
+
+    case VerifyThreadsKey: /* --verify-threads */
+        if (arg >= 1 && arg <= 64) {
+            m_verifyThreads = static_cast<int>(arg);
+        }
+        break;
+
+    case VerifyAffinityKey: /* --verify-affinity */
+        m_verifyAffinity = static_cast<int64_t>(arg);
+        break;
+
+    case VerifyGpuKey: /* --verify-gpu */
+        if (arg < 256) {
+            m_verifyGpu = static_cast<int>(arg);
+        }
+        break;
+
+    case GpuPriorityKey: /* --gpu-priority */
+        if (arg <= 5) {
+            m_gpuPriority = static_cast<int>(arg);
+        }
+        break;
+
+    case VerifyPriorityKey: /* --verify-priority */
+        if (arg <= 5) {
+            m_verifyPriority = static_cast<int>(arg);
+        }
+        break;
+
+    case CpuThreadsKey: /* --cpu-threads */
+        if (arg <= 64) {
+            m_cpuThreads = static_cast<int>(arg);
+        }
+        break;
+
+    case CpuAffinityKey: /* --cpu-affinity */
+        m_cpuAffinity = static_cast<int64_t>(arg);
+        break;
+
+    case VerifySampleKey: /* --verify-sample */
+        if (arg >= 1 && arg <= 1000) {
+            m_verifySample = static_cast<uint32_t>(arg);
+        }
+        break;
+
+    case VerifyThresholdKey: /* --verify-error-threshold */
+        if (arg >= 1 && arg <= 100) {
+            m_verifyThreshold = static_cast<uint32_t>(arg);
+        }
+        break;
+
+    case BatchSplitKey: /* --batch-split */
+        if (arg >= 1 && arg <= 64) {
+            m_batchSplit = static_cast<uint32_t>(arg);
+        }
+        break;
+
+    case TdrLimitKey: /* --tdr-limit */
+        if (arg <= 10000) {
+            m_tdrLimit = static_cast<uint32_t>(arg);
+        }
+        break;
+
+    case OclTraceKey: /* --opencl-trace */
+        if (arg <= 60000) {
+            m_oclTrace = static_cast<uint32_t>(arg);
+        }
+        break;
+
+    case FleetIntervalKey: /* --fleet-interval */
+        if (arg >= 10 && arg <= 86400) {
+            m_fleetInterval = static_cast<uint32_t>(arg);
+        }
+        break;
+
+    case ProfitIntervalKey: /* --profit-interval */
+        if (arg >= 10 && arg <= 86400) {
+            m_profitInterval = static_cast<uint32_t>(arg);
+        }
+        break;
+
+    case PushIntervalKey: /* --push-interval */
+        if (arg >= 1 && arg <= 3600) {
+            m_pushInterval = static_cast<uint32_t>(arg);
+        }
+        break;
+
+    case CanaryWindowKey: /* --canary-window */
+        if (arg >= 60 && arg <= 86400) {
+            m_canaryWindow = static_cast<uint32_t>(arg);
+        }
+        break;
+
+    case StaleTargetKey: /* --stale-target */
+        if (arg <= 50) {
+            m_staleTarget = static_cast<uint32_t>(arg);
+        }
+        break;
+
+    case MinSubmitDiffKey: /* --min-submit-diff */
+        m_minSubmitDiff = arg;
+        break;
+
+    case TempTargetKey: /* --temp-target */
+        if (arg == 0 || (arg >= 40 && arg <= 110)) {
+            m_tempTarget = static_cast<uint32_t>(arg);
+        }
+        break;
+
+    case PowerTargetKey: /* --power-target */
+        if (arg <= 1000) {
+            m_powerTarget = static_cast<uint32_t>(arg);
+        }
+        break;
+
+    case DesktopDutyKey: /* --desktop-duty */
+        if (arg == 0 || (arg >= 10 && arg <= 100)) {
+            m_desktopDuty = static_cast<uint32_t>(arg);
+        }
+        break;
+
+    case DesktopIdleKey: /* --desktop-idle */
+        if (arg >= 5 && arg <= 3600) {
+            m_desktopIdle = static_cast<uint32_t>(arg);
+        }
+        break;
+
+    case ParkAfterKey: /* --park-after */
+        if (arg <= 10080) {
+            m_parkAfter = static_cast<uint32_t>(arg);
+        }
+        break;
+
+    case AlgoMinDwellKey: /* --algo-min-dwell */
+        if (arg <= 86400) {
+            m_algoMinDwell = static_cast<uint32_t>(arg);
+        }
+        break;
+
+    case StratumPortKey: /* --stratum-port */
+        if (arg <= 65535) {
+            m_stratumPort = static_cast<uint32_t>(arg);
+        }
+        break;
+
     default:
         break;
     }
@@ -363,6 +1009,12 @@ void xmrig::Config::parseJSON(const rapidjson::Document &doc)
         }
     }
 
+    // experimental dual-algo mining, the first of "algos" of the pool is the algorithm of its threads
+    const rapidjson::Value &dual = doc["dual-pool"];
+    if (dual.IsObject()) {
+        m_dualPool = Pool(dual);
+    }
+
     const rapidjson::Value &algo_perf = doc["algo-perf"];
     if (algo_perf.IsObject()) {
         for (int a = 0; a != xmrig::PerfAlgo::PA_MAX; ++ a) {
@@ -374,35 +1026,135 @@ void xmrig::Config::parseJSON(const rapidjson::Document &doc)
                 m_algo_perf[pa] = static_cast<float>(key.GetInt());
             }
         }
+
+        for (int f = 0; f != xmrig::PerfFork::FORK_MAX; ++ f) {
+            const xmrig::PerfFork pf = static_cast<xmrig::PerfFork>(f);
+            const rapidjson::Value &key = algo_perf[xmrig::Algorithm::perfForkName(pf)];
+            const float base = m_algo_perf[xmrig::Algorithm::perfForkAlgo(pf)];
+            if (key.IsNumber() && base > 0.0f) {
+                m_perf_fork_ratio[pf] = static_cast<float>(key.GetDouble()) / base;
+            }
+        }
+    }
+
+    const rapidjson::Value &device_algo_perf = doc["algo-perf-devices"];
+    if (device_algo_perf.IsArray()) {
+        for (const rapidjson::Value &device : device_algo_perf.GetArray()) {
+            if (!device.IsObject() || !device["index"].IsUint() || !device["algo-perf"].IsObject()) {
+                continue;
+            }
+
+            const rapidjson::Value &algo_perf2 = device["algo-perf"];
+            DeviceAlgoPerf &device_perf        = m_device_algo_perf[device["index"].GetUint()];
+            device_perf.board  = device["board"].IsString() ? device["board"].GetString() : nullptr;
+            device_perf.device = device["device"].IsString() ? device["device"].GetString() : "";
+            device_perf.driver = device["driver"].IsInt() ? device["driver"].GetInt() : 0;
+            device_perf.perf.assign(xmrig::PerfAlgo::PA_MAX, 0.0f);
+
+            for (int a = 0; a != xmrig::PerfAlgo::PA_MAX; ++ a) {
+                const xmrig::PerfAlgo pa = static_cast<xmrig::PerfAlgo>(a);
+                const rapidjson::Value &key = algo_perf2[xmrig::Algorithm::perfAlgoName(pa)];
+                if (key.IsNumber()) {
+                    device_perf.perf[pa] = static_cast<float>(key.GetDouble());
+                }
+            }
+        }
     }
 }
 
 
-std::vector<xmrig::IThread *> xmrig::Config::filterThreads(const xmrig::PerfAlgo pa) const
+// stored result of this GPU exists and it was measured on the same hardware and driver
+bool xmrig::Config::isDeviceAlgoPerf(const GpuContext *ctx, const xmrig::PerfAlgo pa) const
 {
-    std::vector<IThread *> threads;
-    const size_t platform_idx                   = static_cast<size_t>(platformIndex());
-    const std::vector<cl_platform_id> platforms = OclLib::getPlatformIDs();
+    const auto it = m_device_algo_perf.find(ctx->deviceIdx);
+    if (it == m_device_algo_perf.end()) {
+        return false;
+    }
 
-    if (platforms.empty() || platforms.size() <= platform_idx) {
-        return threads;
+    const DeviceAlgoPerf &device = it->second;
+
+    return device.board == ctx->board && device.device == ctx->DeviceString && device.driver == ctx->amdDriverMajorVersion && device.perf[pa] > 0.0f;
+}
+
+
+// perf fork variants run on the threads of their perf algo with the measured hashrate ratio, the perf algo one until it is known
+float xmrig::Config::get_algorithm_perf(const xmrig::Algorithm &algorithm) const
+{
+    const xmrig::PerfAlgo pa = algorithm.perf_algo();
+    if (pa == xmrig::PA_INVALID) {
+        return 0.0f;
+    }
+
+    const xmrig::PerfFork pf = algorithm.perf_fork();
+    return pf == xmrig::FORK_INVALID || m_perf_fork_ratio[pf] <= 0.0f ? m_algo_perf[pa] : m_algo_perf[pa] * m_perf_fork_ratio[pf];
+}
+
+
+float xmrig::Config::get_device_algo_perf(size_t index, const xmrig::PerfAlgo pa) const
+{
+    const auto it = m_device_algo_perf.find(index);
+
+    return it != m_device_algo_perf.end() ? it->second.perf[pa] : 0.0f;
+}
+
+
+// results of other GPU or driver stored for the same index are dropped
+void xmrig::Config::set_device_algo_perf(const GpuContext *ctx, const xmrig::PerfAlgo pa, const float value)
+{
+    DeviceAlgoPerf &device = m_device_algo_perf[ctx->deviceIdx];
+    if (device.perf.empty() || device.board != ctx->board || device.device != ctx->DeviceString || device.driver != ctx->amdDriverMajorVersion) {
+        device.board  = ctx->board;
+        device.device = ctx->DeviceString;
+        device.driver = ctx->amdDriverMajorVersion;
+        device.perf.assign(xmrig::PerfAlgo::PA_MAX, 0.0f);
     }
 
-    cl_int ret;
-    cl_uint entries;
-    if ((ret = OclLib::getDeviceIDs(platforms[platform_idx], CL_DEVICE_TYPE_GPU, 0, nullptr, &entries)) != CL_SUCCESS) {
-        return threads;
+    device.perf[pa] = value;
+}
+
+
+// value kept by RuntimeState, its hardware replaces results of other hardware for the same index like above
+void xmrig::Config::restore_device_algo_perf(size_t index, const DeviceAlgoPerf &identity, const xmrig::PerfAlgo pa, const float value)
+{
+    DeviceAlgoPerf &device = m_device_algo_perf[index];
+    if (device.perf.empty() || device.board != identity.board || device.device != identity.device || device.driver != identity.driver) {
+        device.board  = identity.board;
+        device.device = identity.device;
+        device.driver = identity.driver;
+        device.perf.assign(xmrig::PerfAlgo::PA_MAX, 0.0f);
     }
 
+    device.perf[pa] = value;
+}
+
+
+std::vector<xmrig::IThread *> xmrig::Config::filterThreads(const xmrig::PerfAlgo pa) const
+{
+    std::vector<IThread *> threads;
+
     for (IThread *thread : m_threads[pa]) {
-        if (thread->isValid() && thread->index() < entries) {
+        OclThread *oclThread = static_cast<OclThread *>(thread);
+        const int platform   = threadPlatform(oclThread);
+
+        if (platform < 0) {
+            LOG_ERR("OpenCL platform \"%s\" of device index %zu NOT found.", oclThread->platform(), thread->index());
+            delete thread;
+
+            continue;
+        }
+
+        const size_t entries = OclGPU::getDeviceCount(static_cast<size_t>(platform), this);
+        const size_t index   = thread->index();
+        oclThread->setPlatform(OclGPU::deviceOffset(static_cast<size_t>(platform), this));
+
+        if (thread->isValid() && index < entries) {
             threads.push_back(thread);
 
             continue;
         }
 
-        if (entries <= thread->index()) {
-            LOG_ERR("Selected OpenCL device index %zu doesn't exist.", thread->index());
+        if (entries <= index) {
+            LOG_ERR("Selected OpenCL device index %zu doesn't exist.", index);
         }
 
         delete thread;
@@ -412,12 +1164,110 @@ std::vector<xmrig::IThread *> xmrig::Config::filterThreads(const xmrig::PerfAlgo
 }
 
 
+// "platform" of a thread selects other OpenCL platform than "opencl-platform", by vendor name or by index
+int xmrig::Config::threadPlatform(const OclThread *thread) const
+{
+    const char *platform = thread->platform();
+    if (platform == nullptr) {
+        return m_platformIndex;
+    }
+
+    constexpr size_t size = sizeof(vendors) / sizeof((vendors)[0]);
+
+    for (size_t i = 0; i < size; i++) {
+        if (strcasecmp(platform, vendors[i]) == 0) {
+            char name[256] = { 0 };
+
+            return OclGPU::findPlatformIdx(static_cast<OclVendor>(i), name, sizeof name);
+        }
+    }
+
+    char *end = nullptr;
+    const long index = strtol(platform, &end, 10);
+
+    return *end == '\0' && index >= 0 && index < static_cast<long>(OclLib::getNumPlatforms()) ? static_cast<int>(index) : -1;
+}
+
+
 void xmrig::Config::parseThread(const rapidjson::Value &object, const xmrig::PerfAlgo pa)
 {
     m_threads[pa].push_back(new OclThread(object));
 }
 
 
+void xmrig::Config::setBenchAlgos(const char *algos)
+{
+    m_benchAlgos.clear();
+
+    if (strcasecmp(algos, "all") == 0) {
+        for (int a = 0; a != xmrig::PerfAlgo::PA_MAX; ++ a) {
+            m_benchAlgos.push_back(static_cast<xmrig::PerfAlgo>(a));
+        }
+
+        return;
+    }
+
+    char *value = strdup(algos);
+    char *pch   = strtok(value, ",");
+
+    while (pch != nullptr) {
+        bool found = false;
+        for (int a = 0; a != xmrig::PerfAlgo::PA_MAX; ++ a) {
+            const xmrig::PerfAlgo pa = static_cast<xmrig::PerfAlgo>(a);
+            if (strcasecmp(pch, xmrig::Algorithm::perfAlgoName(pa)) == 0) {
+                m_benchAlgos.push_back(pa);
+                found = true;
+                break;
+            }
+        }
+
+        if (!found) {
+            LOG_ERR("Unknown perf algo \"%s\" for --bench.", pch);
+        }
+
+        pch = strtok(nullptr, ",");
+    }
+
+    free(value);
+}
+
+
+void xmrig::Config::setErrorAction(const char *action)
+{
+    if (action == nullptr) {
+        return;
+    }
+
+    if (strcasecmp(action, "intensity") == 0) {
+        m_errorAction = ERROR_ACTION_INTENSITY;
+    }
+    else if (strcasecmp(action, "disable") == 0) {
+        m_errorAction = ERROR_ACTION_DISABLE;
+    }
+    else if (strcasecmp(action, "none") == 0) {
+        m_errorAction = ERROR_ACTION_NONE;
+    }
+}
+
+
+void xmrig::Config::setIdleWork(const char *work)
+{
+    if (work == nullptr) {
+        return;
+    }
+
+    if (strcasecmp(work, "calibrate") == 0) {
+        m_idleWork = IDLE_WORK_CALIBRATE;
+    }
+    else if (strcasecmp(work, "autotune") == 0) {
+        m_idleWork = IDLE_WORK_AUTOTUNE;
+    }
+    else if (strcasecmp(work, "none") == 0) {
+        m_idleWork = IDLE_WORK_NONE;
+    }
+}
+
+
 void xmrig::Config::setPlatformIndex(const char *name)
 {
     constexpr size_t size = sizeof(vendors) / sizeof((vendors)[0]);
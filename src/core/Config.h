@@ -26,6 +26,8 @@
 #define XMRIG_CONFIG_H
 
 
+#include <map>
+#include <string>
 #include <stdint.h>
 #include <vector>
 
@@ -36,39 +38,150 @@
 #include "rapidjson/fwd.h"
 
 
+struct GpuContext;
+
+
 namespace xmrig {
 
 
 class ConfigLoader;
 class IThread;
 class IConfigListener;
+class OclThread;
 class Process;
 
 
 class Config : public CommonConfig
 {
 public:
+    // what happens to a GPU thread whose verified error rate passes --verify-error-threshold
+    enum ErrorAction {
+        ERROR_ACTION_NONE,
+        ERROR_ACTION_INTENSITY,
+        ERROR_ACTION_DISABLE
+    };
+
+    // what the GPUs run while no pool is reachable, see Network::idleWork
+    enum IdleWork {
+        IDLE_WORK_NONE,
+        IDLE_WORK_CALIBRATE,
+        IDLE_WORK_AUTOTUNE
+    };
+
     Config();
 
     bool isCNv2() const;
+    bool isPoolPerfAlgo(const xmrig::PerfAlgo pa) const;
     bool oclInit();
     bool reload(const char *json);
+    void oclReload(const Config *previous);
+    const char *errorActionName() const;
+    const char *idleWorkName() const;
 
     void getJSON(rapidjson::Document &doc) const override;
 
+    inline bool isAutoAffinity() const                   { return m_autoAffinity; }
+    inline bool isAutotune() const                       { return m_autotune; }
+    inline bool isAutotunePower() const                  { return m_autotunePower; }
+    inline bool isBench() const                          { return m_bench; }
+    inline bool isBenchCsv() const                       { return m_benchCsv; }
+    inline bool isDeriveThreads() const                  { return m_deriveThreads; }
+    // threads of the perf algo were derived from another perf algo at startup, its calibration refines their intensity first
+    inline bool isDerivedThreads(const xmrig::PerfAlgo pa) const { return m_derivedThreads[pa]; }
+    inline bool isDiagnostics() const                    { return m_diagnostics; }
+    inline bool isNetThread() const                      { return m_netThread; }
+    inline const std::vector<xmrig::PerfAlgo> &benchAlgos() const { return m_benchAlgos; }
+    inline int autotuneTime() const                      { return m_autotuneTime; }
     inline bool isOclCache() const                       { return m_cache; }
+    inline bool isOneGbPages() const                     { return m_oneGbPages; }
+    inline bool isOclProfiling() const                   { return m_profiling; }
+    inline bool isOclSpecialize() const                  { return m_specialize; }
+    inline bool isOclDeviceContexts() const              { return m_deviceContexts; }
+    inline bool isOclLowCpu() const                      { return m_lowCpu; }
+    inline bool isRecalibrateAlgo() const                { return m_recalibrate; }
+    inline bool isStress() const                         { return m_stress; }
+    inline int stressTime() const                        { return m_stressTime; }
+    inline int logSummary() const                        { return m_logSummary; }
+    inline int logRing() const                           { return m_logRing; }
+    inline bool isReportDevices() const                  { return m_reportDevices; }
+    inline bool isTestSwitch() const                     { return m_testSwitch; }
+    inline bool isMockPool() const                       { return m_testSwitch || !m_replaySession.isNull(); }
+    inline const char *recordSession() const             { return m_recordSession.data(); }
+    inline const char *replaySession() const             { return m_replaySession.data(); }
+    inline double replaySpeed() const                    { return m_replaySpeed; }
     inline bool isShouldSave() const                     { return m_shouldSave && isAutoSave(); }
     inline const char *loader() const                    { return m_loader.data(); }
+    inline const char *cacheImport() const               { return m_cacheImport.data(); }
+    inline const char *oclSource() const                 { return m_oclSource.data(); }
+    inline const Pool &dualPool() const                  { return m_dualPool; }
+    inline ErrorAction errorAction() const               { return m_errorAction; }
+    inline IdleWork idleWork() const                     { return m_idleWork; }
     // access to m_threads taking into accoun that it is now separated for each perf algo
     inline const std::vector<IThread *> &threads(const xmrig::PerfAlgo pa = PA_INVALID) const {
         return m_threads[pa == PA_INVALID ? m_algorithm.perf_algo() : pa];
     }
+    // threads of the current perf algo added or removed at runtime, the caller owns the removed ones
+    inline void setThreads(const std::vector<IThread *> &threads) { m_threads[m_algorithm.perf_algo()] = threads; }
     inline int platformIndex() const                     { return m_platformIndex; }
+    inline int verifyThreads() const                     { return m_verifyThreads; }
+    inline int verifyGpu() const                         { return m_verifyGpu; }
+    inline int gpuPriority() const                       { return m_gpuPriority; }
+    inline int verifyPriority() const                    { return m_verifyPriority; }
+    inline int cpuThreads() const                        { return m_cpuThreads; }
+    inline int64_t cpuAffinity() const                   { return m_cpuAffinity; }
+    inline int64_t handover() const                      { return m_handover; }
+    inline uint32_t batchSplit() const                   { return m_batchSplit; }
+    inline uint32_t tdrLimit() const                     { return m_tdrLimit; }
+    inline uint32_t oclTrace() const                     { return m_oclTrace; }
+    inline uint32_t stratumPort() const                  { return m_stratumPort; }
+    inline const char *traceFile() const                 { return m_traceFile.data(); }
+    inline const char *fleetUrl() const                  { return m_fleetUrl.data(); }
+    inline uint32_t fleetInterval() const                { return m_fleetInterval; }
+    inline const char *profitUrl() const                 { return m_profitUrl.data(); }
+    inline uint32_t profitInterval() const               { return m_profitInterval; }
+    inline const char *pushUrl() const                   { return m_pushUrl.data(); }
+    inline uint32_t pushInterval() const                 { return m_pushInterval; }
+    inline const char *statsShm() const                  { return m_statsShm.data(); }
+    inline const char *stateFile() const                 { return m_stateFile.data(); }
+    inline uint32_t canaryWindow() const                 { return m_canaryWindow; }
+    inline uint32_t staleTarget() const                  { return m_staleTarget; }
+    inline uint64_t minSubmitDiff() const                { return m_minSubmitDiff; }
+    inline uint32_t tempTarget() const                   { return m_tempTarget; }
+    inline uint32_t powerTarget() const                  { return m_powerTarget; }
+    inline uint32_t desktopDuty() const                  { return m_desktopDuty; }
+    inline uint32_t desktopIdle() const                  { return m_desktopIdle; }
+    inline uint32_t parkAfter() const                    { return m_parkAfter; }
+    inline uint32_t algoMinDwell() const                 { return m_algoMinDwell; }
+    inline int64_t verifyAffinity() const                { return m_verifyAffinity; }
+    inline uint32_t verifyErrorThreshold() const         { return m_verifyThreshold; }
+    inline uint32_t verifySample() const                 { return m_verifySample; }
     inline xmrig::OclVendor vendor() const               { return m_vendor; }
 
     // access to perf algo results
     inline float get_algo_perf(const xmrig::PerfAlgo pa) const             { return m_algo_perf[pa]; }
     inline void set_algo_perf(const xmrig::PerfAlgo pa, const float value) { m_algo_perf[pa] = value; }
+    // hashrate of a perf fork relative to its perf algo, 0 until the calibration measures it
+    inline float get_perf_fork_ratio(const xmrig::PerfFork pf) const             { return m_perf_fork_ratio[pf]; }
+    inline void set_perf_fork_ratio(const xmrig::PerfFork pf, const float value) { m_perf_fork_ratio[pf] = value; }
+    // algo-perf of the exact variant, a perf fork that is not measured yet gets the one of its perf algo
+    float get_algorithm_perf(const xmrig::Algorithm &algorithm) const;
+    // the config is saved with the threads changed at runtime, like an intensity lowered to fit in GPU memory
+    inline void setShouldSave()                                            { m_shouldSave = true; }
+    // kernel times of the benchmark tools, InitOpenCLGpu creates profiling queues then
+    inline void setOclProfiling(bool enable)                               { m_profiling = enable; }
+    // access to perf algo results of each GPU (by its index)
+    // results are valid only for the same GPU board, device string and driver version
+    struct DeviceAlgoPerf {
+        xmrig::String board;     // GPU board name to detect other GPU on the same index
+        std::string device;      // OpenCL device string as used by binary cache
+        int driver;              // AMD driver major version
+        std::vector<float> perf; // perf algo hashrate results
+    };
+    inline const std::map<size_t, DeviceAlgoPerf> &device_algo_perf() const { return m_device_algo_perf; }
+    bool isDeviceAlgoPerf(const GpuContext *ctx, const xmrig::PerfAlgo pa) const;
+    float get_device_algo_perf(size_t index, const xmrig::PerfAlgo pa) const;
+    void set_device_algo_perf(const GpuContext *ctx, const xmrig::PerfAlgo pa, const float value);
+    void restore_device_algo_perf(size_t index, const DeviceAlgoPerf &identity, const xmrig::PerfAlgo pa, const float value);
 
     static Config *load(Process *process, IConfigListener *listener);
     static const char *vendorName(xmrig::OclVendor vendor);
@@ -83,21 +196,95 @@ protected:
     void parseThreadsJSON(const rapidjson::Value &threads, xmrig::PerfAlgo);
 
 private:
+    int threadPlatform(const OclThread *thread) const;
+    static xmrig::PerfAlgo deriveSource(const xmrig::PerfAlgo pa, const bool *configured);
     std::vector<IThread *> filterThreads(const xmrig::PerfAlgo pa) const;
     void parseThread(const rapidjson::Value &object, const xmrig::PerfAlgo);
+    void setBenchAlgos(const char *algos);
+    void setErrorAction(const char *action);
+    void setIdleWork(const char *work);
     void setPlatformIndex(const char *name);
     void setPlatformIndex(int index);
 
+    bool m_autoAffinity;
     bool m_autoConf;
+    bool m_autotune;
+    bool m_autotunePower;
+    bool m_bench;
+    bool m_benchCsv;
     bool m_cache;
+    bool m_deriveThreads;
+    bool m_deviceContexts;
+    bool m_diagnostics;
+    bool m_lowCpu;
+    bool m_netThread;
+    bool m_oneGbPages;
+    bool m_profiling;
+    bool m_recalibrate;
+    bool m_reportDevices;
+    bool m_stress;
+    bool m_testSwitch;
+    double m_replaySpeed;
+    bool m_specialize;
     bool m_shouldSave;
+    int m_autotuneTime;
     int m_platformIndex;
+    int m_stressTime;
+    int m_logSummary;
+    int m_logRing;
+    int m_verifyThreads;
+    int m_verifyGpu;
+    int m_gpuPriority;
+    int m_verifyPriority;
+    int64_t m_verifyAffinity;
+    uint32_t m_verifySample;
+    uint32_t m_verifyThreshold;
+    int m_cpuThreads;
+    int64_t m_cpuAffinity;
+    int64_t m_handover;
+    uint32_t m_batchSplit;
+    uint32_t m_tdrLimit;
+    uint32_t m_canaryWindow;
+    uint32_t m_fleetInterval;
+    uint32_t m_profitInterval;
+    uint32_t m_pushInterval;
+    uint32_t m_oclTrace;
+    uint32_t m_staleTarget;
+    uint64_t m_minSubmitDiff;
+    uint32_t m_stratumPort;
+    uint32_t m_tempTarget;
+    uint32_t m_powerTarget;
+    uint32_t m_desktopDuty;
+    uint32_t m_desktopIdle;
+    uint32_t m_parkAfter;
+    uint32_t m_algoMinDwell;
+    ErrorAction m_errorAction;
+    IdleWork m_idleWork;
     OclCLI m_oclCLI;
+    // perf algos of --bench run
+    std::vector<xmrig::PerfAlgo> m_benchAlgos;
     // threads config for each perf algo
     std::vector<IThread *> m_threads[xmrig::PerfAlgo::PA_MAX];
     // perf algo hashrate results
     float m_algo_perf[xmrig::PerfAlgo::PA_MAX];
+    // hashrate ratios of perf forks to their perf algos
+    float m_perf_fork_ratio[xmrig::PerfFork::FORK_MAX];
+    // perf algos with threads derived from another perf algo
+    bool m_derivedThreads[xmrig::PerfAlgo::PA_MAX];
+    // perf algo hashrate results of each GPU
+    std::map<size_t, DeviceAlgoPerf> m_device_algo_perf;
+    Pool m_dualPool;
+    xmrig::String m_cacheImport;
+    xmrig::String m_oclSource;
+    xmrig::String m_fleetUrl;
     xmrig::String m_loader;
+    xmrig::String m_profitUrl;
+    xmrig::String m_pushUrl;
+    xmrig::String m_recordSession;
+    xmrig::String m_replaySession;
+    xmrig::String m_stateFile;
+    xmrig::String m_statsShm;
+    xmrig::String m_traceFile;
     xmrig::OclVendor m_vendor;
 };
 
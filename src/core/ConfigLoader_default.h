@@ -47,6 +47,7 @@ R"===(
     "cache": true,
     "colors": true,
     "donate-level": 5,
+    "log-async": false,
     "log-file": null,
     "opencl-platform": "AMD",
     "pools": [
@@ -58,8 +58,12 @@ static struct option const options[] = {
     { "dry-run",              0, nullptr, xmrig::IConfig::DryRunKey         },
     { "calibrate-algo",       0, nullptr, xmrig::IConfig::CalibrateAlgoKey      },
     { "calibrate-algo-time",  1, nullptr, xmrig::IConfig::CalibrateAlgoTimeKey  },
+    { "recalibrate-algo",     0, nullptr, xmrig::IConfig::RecalibrateAlgoKey    },
     { "keepalive",            0, nullptr, xmrig::IConfig::KeepAliveKey      },
     { "log-file",             1, nullptr, xmrig::IConfig::LogFileKey        },
+    { "log-async",            0, nullptr, xmrig::IConfig::LogAsyncKey       },
+    { "log-summary",          1, nullptr, xmrig::IConfig::LogSummaryKey     },
+    { "log-ring",             1, nullptr, xmrig::IConfig::LogRingKey        },
     { "nicehash",             0, nullptr, xmrig::IConfig::NicehashKey       },
     { "no-color",             0, nullptr, xmrig::IConfig::ColorKey          },
     { "no-watch",             0, nullptr, xmrig::IConfig::WatchKey          },
@@ -68,6 +72,8 @@ static struct option const options[] = {
     { "print-time",           1, nullptr, xmrig::IConfig::PrintTimeKey      },
     { "retries",              1, nullptr, xmrig::IConfig::RetriesKey        },
     { "retry-pause",          1, nullptr, xmrig::IConfig::RetryPauseKey     },
+    { "pool-standby",         1, nullptr, xmrig::IConfig::PoolStandbyKey    },
+    { "pool-strategy",        1, nullptr, xmrig::IConfig::PoolStrategyKey   },
     { "syslog",               0, nullptr, xmrig::IConfig::SyslogKey         },
     { "url",                  1, nullptr, xmrig::IConfig::UrlKey            },
     { "user",                 1, nullptr, xmrig::IConfig::UserKey           },
@@ -88,6 +94,65 @@ static struct option const options[] = {
     { "no-cache",             0, nullptr, xmrig::IConfig::OclCacheKey       },
     { "print-platforms",      0, nullptr, xmrig::IConfig::OclPrintKey       },
     { "opencl-loader",        1, nullptr, xmrig::IConfig::OclLoaderKey      },
+    { "opencl-profiling",     0, nullptr, xmrig::IConfig::OclProfilingKey   },
+    { "opencl-specialize",    0, nullptr, xmrig::IConfig::OclSpecializeKey  },
+    { "opencl-device-contexts", 0, nullptr, xmrig::IConfig::OclDeviceContextsKey },
+    { "opencl-low-cpu",       0, nullptr, xmrig::IConfig::OclLowCpuKey      },
+    { "opencl-trace",         1, nullptr, xmrig::IConfig::OclTraceKey       },
+    { "autotune",             0, nullptr, xmrig::IConfig::OclAutotuneKey    },
+    { "autotune-time",        1, nullptr, xmrig::IConfig::OclAutotuneTimeKey },
+    { "autotune-power",       0, nullptr, xmrig::IConfig::AutotunePowerKey  },
+    { "stress",               0, nullptr, xmrig::IConfig::StressKey         },
+    { "stress-time",          1, nullptr, xmrig::IConfig::StressTimeKey     },
+    { "report-devices",       0, nullptr, xmrig::IConfig::OclReportDevicesKey },
+    { "bench",                1, nullptr, xmrig::IConfig::OclBenchKey       },
+    { "test-switch",          0, nullptr, xmrig::IConfig::TestSwitchKey     },
+    { "record-session",       1, nullptr, xmrig::IConfig::RecordSessionKey  },
+    { "replay-session",       1, nullptr, xmrig::IConfig::ReplaySessionKey  },
+    { "replay-speed",         1, nullptr, xmrig::IConfig::ReplaySpeedKey    },
+    { "handover",             1, nullptr, xmrig::IConfig::HandoverKey       },
+    { "bench-format",         1, nullptr, xmrig::IConfig::OclBenchFormatKey },
+    { "opencl-cache-export",  1, nullptr, xmrig::IConfig::OclCacheExportKey },
+    { "opencl-cache-merge",   1, nullptr, xmrig::IConfig::OclCacheMergeKey  },
+    { "opencl-cache-import",  1, nullptr, xmrig::IConfig::OclCacheImportKey },
+    { "opencl-source",        1, nullptr, xmrig::IConfig::OclSourceKey      },
+    { "verify-threads",       1, nullptr, xmrig::IConfig::VerifyThreadsKey  },
+    { "verify-affinity",      1, nullptr, xmrig::IConfig::VerifyAffinityKey },
+    { "auto-affinity",        0, nullptr, xmrig::IConfig::AutoAffinityKey   },
+    { "gpu-priority",         1, nullptr, xmrig::IConfig::GpuPriorityKey    },
+    { "verify-priority",      1, nullptr, xmrig::IConfig::VerifyPriorityKey },
+    { "verify-sample",        1, nullptr, xmrig::IConfig::VerifySampleKey   },
+    { "verify-error-threshold", 1, nullptr, xmrig::IConfig::VerifyThresholdKey },
+    { "verify-gpu",           1, nullptr, xmrig::IConfig::VerifyGpuKey      },
+    { "batch-split",          1, nullptr, xmrig::IConfig::BatchSplitKey     },
+    { "tdr-limit",            1, nullptr, xmrig::IConfig::TdrLimitKey       },
+    { "stratum-port",         1, nullptr, xmrig::IConfig::StratumPortKey    },
+    { "stale-target",         1, nullptr, xmrig::IConfig::StaleTargetKey    },
+    { "min-submit-diff",      1, nullptr, xmrig::IConfig::MinSubmitDiffKey  },
+    { "temp-target",          1, nullptr, xmrig::IConfig::TempTargetKey     },
+    { "power-target",         1, nullptr, xmrig::IConfig::PowerTargetKey    },
+    { "desktop-duty",         1, nullptr, xmrig::IConfig::DesktopDutyKey    },
+    { "desktop-idle",         1, nullptr, xmrig::IConfig::DesktopIdleKey    },
+    { "park-after",           1, nullptr, xmrig::IConfig::ParkAfterKey      },
+    { "algo-min-dwell",       1, nullptr, xmrig::IConfig::AlgoMinDwellKey   },
+    { "error-action",         1, nullptr, xmrig::IConfig::ErrorActionKey    },
+    { "idle-work",            1, nullptr, xmrig::IConfig::IdleWorkKey       },
+    { "trace-file",           1, nullptr, xmrig::IConfig::TraceFileKey      },
+    { "fleet-url",            1, nullptr, xmrig::IConfig::FleetUrlKey       },
+    { "fleet-interval",       1, nullptr, xmrig::IConfig::FleetIntervalKey  },
+    { "profit-url",           1, nullptr, xmrig::IConfig::ProfitUrlKey      },
+    { "profit-interval",      1, nullptr, xmrig::IConfig::ProfitIntervalKey },
+    { "push-url",             1, nullptr, xmrig::IConfig::PushUrlKey        },
+    { "push-interval",        1, nullptr, xmrig::IConfig::PushIntervalKey   },
+    { "stats-shm",            1, nullptr, xmrig::IConfig::StatsShmKey       },
+    { "state-file",           1, nullptr, xmrig::IConfig::StateFileKey      },
+    { "canary-window",        1, nullptr, xmrig::IConfig::CanaryWindowKey   },
+    { "diagnostics",          0, nullptr, xmrig::IConfig::DiagnosticsKey    },
+    { "derive-threads",       0, nullptr, xmrig::IConfig::DeriveThreadsKey  },
+    { "net-thread",           0, nullptr, xmrig::IConfig::NetThreadKey      },
+    { "cpu-threads",          1, nullptr, xmrig::IConfig::CpuThreadsKey     },
+    { "cpu-affinity",         1, nullptr, xmrig::IConfig::CpuAffinityKey    },
+    { "1gb-pages",            0, nullptr, xmrig::IConfig::OneGbPagesKey     },
     { nullptr,                0, nullptr, 0 }
 };
 
@@ -100,16 +165,72 @@ static struct option const config_options[] = {
     { "dry-run",           0, nullptr, xmrig::IConfig::DryRunKey      },
     { "calibrate-algo",      0, nullptr, xmrig::IConfig::CalibrateAlgoKey      },
     { "calibrate-algo-time", 1, nullptr, xmrig::IConfig::CalibrateAlgoTimeKey  },
+    { "recalibrate-algo",    0, nullptr, xmrig::IConfig::RecalibrateAlgoKey    },
     { "log-file",          1, nullptr, xmrig::IConfig::LogFileKey     },
+    { "log-async",         0, nullptr, xmrig::IConfig::LogAsyncKey    },
+    { "log-summary",       1, nullptr, xmrig::IConfig::LogSummaryKey  },
+    { "log-ring",          1, nullptr, xmrig::IConfig::LogRingKey     },
     { "print-time",        1, nullptr, xmrig::IConfig::PrintTimeKey   },
     { "retries",           1, nullptr, xmrig::IConfig::RetriesKey     },
     { "retry-pause",       1, nullptr, xmrig::IConfig::RetryPauseKey  },
+    { "pool-standby",      1, nullptr, xmrig::IConfig::PoolStandbyKey },
+    { "pool-strategy",     1, nullptr, xmrig::IConfig::PoolStrategyKey },
     { "syslog",            0, nullptr, xmrig::IConfig::SyslogKey      },
     { "user-agent",        1, nullptr, xmrig::IConfig::UserAgentKey   },
     { "watch",             0, nullptr, xmrig::IConfig::WatchKey       },
     { "opencl-platform",   1, nullptr, xmrig::IConfig::OclPlatformKey },
     { "cache",             0, nullptr, xmrig::IConfig::OclCacheKey    },
     { "opencl-loader",     1, nullptr, xmrig::IConfig::OclLoaderKey   },
+    { "opencl-profiling",  0, nullptr, xmrig::IConfig::OclProfilingKey  },
+    { "opencl-specialize", 0, nullptr, xmrig::IConfig::OclSpecializeKey },
+    { "opencl-device-contexts", 0, nullptr, xmrig::IConfig::OclDeviceContextsKey },
+    { "opencl-low-cpu",    0, nullptr, xmrig::IConfig::OclLowCpuKey     },
+    { "opencl-trace",      1, nullptr, xmrig::IConfig::OclTraceKey      },
+    { "autotune",          0, nullptr, xmrig::IConfig::OclAutotuneKey   },
+    { "autotune-time",     1, nullptr, xmrig::IConfig::OclAutotuneTimeKey },
+    { "autotune-power",    0, nullptr, xmrig::IConfig::AutotunePowerKey },
+    { "stress",            0, nullptr, xmrig::IConfig::StressKey        },
+    { "stress-time",       1, nullptr, xmrig::IConfig::StressTimeKey    },
+    { "report-devices",    0, nullptr, xmrig::IConfig::OclReportDevicesKey },
+    { "opencl-cache-import", 1, nullptr, xmrig::IConfig::OclCacheImportKey },
+    { "opencl-source",     1, nullptr, xmrig::IConfig::OclSourceKey      },
+    { "verify-threads",    1, nullptr, xmrig::IConfig::VerifyThreadsKey  },
+    { "verify-affinity",   1, nullptr, xmrig::IConfig::VerifyAffinityKey },
+    { "auto-affinity",     0, nullptr, xmrig::IConfig::AutoAffinityKey   },
+    { "gpu-priority",      1, nullptr, xmrig::IConfig::GpuPriorityKey    },
+    { "verify-priority",   1, nullptr, xmrig::IConfig::VerifyPriorityKey },
+    { "verify-sample",     1, nullptr, xmrig::IConfig::VerifySampleKey   },
+    { "verify-error-threshold", 1, nullptr, xmrig::IConfig::VerifyThresholdKey },
+    { "verify-gpu",        1, nullptr, xmrig::IConfig::VerifyGpuKey      },
+    { "batch-split",       1, nullptr, xmrig::IConfig::BatchSplitKey     },
+    { "tdr-limit",         1, nullptr, xmrig::IConfig::TdrLimitKey       },
+    { "stratum-port",      1, nullptr, xmrig::IConfig::StratumPortKey    },
+    { "stale-target",      1, nullptr, xmrig::IConfig::StaleTargetKey    },
+    { "min-submit-diff",   1, nullptr, xmrig::IConfig::MinSubmitDiffKey  },
+    { "temp-target",       1, nullptr, xmrig::IConfig::TempTargetKey     },
+    { "power-target",      1, nullptr, xmrig::IConfig::PowerTargetKey    },
+    { "desktop-duty",      1, nullptr, xmrig::IConfig::DesktopDutyKey    },
+    { "desktop-idle",      1, nullptr, xmrig::IConfig::DesktopIdleKey    },
+    { "park-after",        1, nullptr, xmrig::IConfig::ParkAfterKey      },
+    { "algo-min-dwell",    1, nullptr, xmrig::IConfig::AlgoMinDwellKey   },
+    { "error-action",      1, nullptr, xmrig::IConfig::ErrorActionKey    },
+    { "idle-work",         1, nullptr, xmrig::IConfig::IdleWorkKey       },
+    { "cpu-threads",       1, nullptr, xmrig::IConfig::CpuThreadsKey     },
+    { "cpu-affinity",      1, nullptr, xmrig::IConfig::CpuAffinityKey    },
+    { "1gb-pages",         0, nullptr, xmrig::IConfig::OneGbPagesKey     },
+    { "trace-file",        1, nullptr, xmrig::IConfig::TraceFileKey      },
+    { "fleet-url",         1, nullptr, xmrig::IConfig::FleetUrlKey       },
+    { "fleet-interval",    1, nullptr, xmrig::IConfig::FleetIntervalKey  },
+    { "profit-url",        1, nullptr, xmrig::IConfig::ProfitUrlKey      },
+    { "profit-interval",   1, nullptr, xmrig::IConfig::ProfitIntervalKey },
+    { "push-url",          1, nullptr, xmrig::IConfig::PushUrlKey        },
+    { "push-interval",     1, nullptr, xmrig::IConfig::PushIntervalKey   },
+    { "stats-shm",         1, nullptr, xmrig::IConfig::StatsShmKey       },
+    { "state-file",        1, nullptr, xmrig::IConfig::StateFileKey      },
+    { "canary-window",     1, nullptr, xmrig::IConfig::CanaryWindowKey   },
+    { "diagnostics",       0, nullptr, xmrig::IConfig::DiagnosticsKey    },
+    { "derive-threads",    0, nullptr, xmrig::IConfig::DeriveThreadsKey  },
+    { "net-thread",        0, nullptr, xmrig::IConfig::NetThreadKey      },
     { "autosave",          0, nullptr, xmrig::IConfig::AutoSaveKey    },
     { nullptr,             0, nullptr, 0 }
 };
@@ -23,10 +23,18 @@
  */
 
 
+#include <algorithm>
 #include <assert.h>
+#include <stdlib.h>
+#include <string>
 
 
+#include "amd/OclCache.h"
+#include "amd/OclDiagnostics.h"
 #include "amd/OclLib.h"
+#include "amd/OclProfiles.h"
+#include "amd/OclSource.h"
+#include "base/kernel/Process.h"
 #include "common/config/ConfigLoader.h"
 #include "common/cpu/Cpu.h"
 #include "common/interfaces/IControllerListener.h"
@@ -36,7 +44,16 @@
 #include "common/Platform.h"
 #include "core/Config.h"
 #include "core/Controller.h"
+#include "core/FleetClient.h"
+#include "core/LogSummary.h"
+#include "core/ProfitFeed.h"
+#include "core/RuntimeState.h"
+#include "core/StartupProfile.h"
+#include "core/StatsSegment.h"
+#include "core/TelemetryPush.h"
+#include "core/Trace.h"
 #include "net/Network.h"
+#include "workers/Workers.h"
 
 
 #ifdef HAVE_SYSLOG_H
@@ -48,22 +65,33 @@ class xmrig::ControllerPrivate
 {
 public:
     inline ControllerPrivate(Process *process) :
+        benchmark(nullptr),
         config(nullptr),
+        fleet(nullptr),
         network(nullptr),
-        process(process)
+        profit(nullptr),
+        process(process),
+        push(nullptr)
     {}
 
 
     inline ~ControllerPrivate()
     {
+        delete fleet;
+        delete profit;
+        delete push;
         delete network;
         delete config;
     }
 
 
+    Benchmark *benchmark;
     Config *config;
+    FleetClient *fleet;
     Network *network;
+    ProfitFeed *profit;
     Process *process;
+    TelemetryPush *push;
     std::vector<IControllerListener *> listeners;
 };
 
@@ -77,11 +105,18 @@ xmrig::Controller::Controller(Process *process)
 xmrig::Controller::~Controller()
 {
     ConfigLoader::release();
+    StatsSegment::release();
 
     delete d_ptr;
 }
 
 
+Benchmark *xmrig::Controller::benchmark() const
+{
+    return d_ptr->benchmark;
+}
+
+
 bool xmrig::Controller::isReady() const
 {
     return d_ptr->config && d_ptr->network;
@@ -90,7 +125,25 @@ bool xmrig::Controller::isReady() const
 
 bool xmrig::Controller::oclInit()
 {
-    return OclLib::init(config()->loader()) && config()->oclInit();
+    {
+        StartupProfile::Scope scope("OpenCL loader");
+
+        OclLib::setTrace(config()->oclTrace());
+
+        if (!OclLib::init(config()->loader())) {
+            return false;
+        }
+    }
+
+    OclProfiles::init(d_ptr->process);
+
+    OclSource::setDirectory(config()->oclSource());
+
+    if (config()->isOclCache()) {
+        OclCache::setPrebuilt(d_ptr->process->location(Process::ExeLocation, "opencl-prebuilt.bundle").data());
+    }
+
+    return config()->oclInit();
 }
 
 
@@ -106,14 +159,30 @@ int xmrig::Controller::init()
 {
     Cpu::init();
 
+    // libuv starts 4 threadpool threads on first use, fewer when the container has fewer CPUs
+    if (!getenv("UV_THREADPOOL_SIZE") && Cpu::info()->threads() < 4) {
+        const std::string size = std::to_string(std::max(Cpu::info()->threads(), 2));
+
+#       ifdef _WIN32
+        _putenv_s("UV_THREADPOOL_SIZE", size.c_str());
+#       else
+        setenv("UV_THREADPOOL_SIZE", size.c_str(), 0);
+#       endif
+    }
+
     // init pconfig global pointer to config
-    pconfig = d_ptr->config = xmrig::Config::load(d_ptr->process, this);
+    {
+        StartupProfile::Scope scope("config");
+        pconfig = d_ptr->config = xmrig::Config::load(d_ptr->process, this);
+    }
+
     if (!d_ptr->config) {
         return 1;
     }
 
     Log::init();
     Platform::init(config()->userAgent());
+    Trace::init(config()->traceFile());
 
     if (!config()->isBackground()) {
         Log::add(new ConsoleLog(this));
@@ -129,8 +198,25 @@ int xmrig::Controller::init()
     }
 #   endif
 
+    // before the network, share and job lines of the pools go to the summary from the first one
+    LogSummary::start(config()->logSummary(), static_cast<size_t>(config()->logRing()));
+
+    StatsSegment::open(config()->statsShm());
+
+    // before the calibration decides which perf algos are missing
+    RuntimeState::load(config()->stateFile(), config());
+
     if (strstr(config()->pools().data()[0].host(), "moneroocean.stream")) config()->setDonateLevel(0);
 
+    // the first pull starts with the loop, usually before the pools of the profit strategy have logged in
+    if (config()->profitUrl()) {
+        d_ptr->profit = new ProfitFeed(this);
+    }
+
+    if (config()->pushUrl()) {
+        d_ptr->push = new TelemetryPush(this);
+    }
+
     d_ptr->network = new Network(this);
     return 0;
 }
@@ -161,6 +247,17 @@ void xmrig::Controller::save()
     }
 
     ConfigLoader::watch(d_ptr->config);
+
+    // the fleet config is applied on top of the watched file, only the url at startup is used
+    if (!d_ptr->fleet && d_ptr->config->fleetUrl()) {
+        d_ptr->fleet = new FleetClient(this);
+    }
+}
+
+
+void xmrig::Controller::setBenchmark(Benchmark *benchmark)
+{
+    d_ptr->benchmark = benchmark;
 }
 
 
@@ -169,9 +266,18 @@ void xmrig::Controller::onNewConfig(IConfig *config)
     Config *previousConfig = d_ptr->config;
     d_ptr->config = static_cast<Config*>(config);
 
+    // threads initialized from now on take the sources of the new directory
+    OclSource::setDirectory(d_ptr->config->oclSource());
+
+    // the running algorithm and GPU contexts move to the new config, only GPUs with changed threads are restarted
+    Workers::reload(previousConfig);
+
     for (xmrig::IControllerListener *listener : d_ptr->listeners) {
         listener->onConfigChanged(d_ptr->config, previousConfig);
     }
 
+    // a diagnostics run still reads the previous config
+    OclDiagnostics::release();
+
     delete previousConfig;
 }
@@ -28,6 +28,7 @@
 #include "base/kernel/interfaces/IConfigListener.h"
 
 
+class Benchmark;
 class StatsData;
 
 
@@ -47,6 +48,7 @@ public:
     Controller(Process *process);
     ~Controller() override;
 
+    Benchmark *benchmark() const;
     bool isReady() const;
     bool oclInit();
     Config *config() const;
@@ -54,6 +56,7 @@ public:
     Network *network() const;
     void addListener(IControllerListener *listener);
     void save();
+    void setBenchmark(Benchmark *benchmark);
 
 protected:
     void onNewConfig(IConfig *config) override;
@@ -0,0 +1,453 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#if _WIN32
+#   include "winsock2.h"
+#else
+#   include "unistd.h"
+#endif
+
+
+#include "amd/OclProfiles.h"
+#include "base/io/Json.h"
+#include "common/log/Log.h"
+#include "common/Platform.h"
+#include "core/Config.h"
+#include "core/Controller.h"
+#include "core/FleetClient.h"
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+#include "workers/Hashrate.h"
+#include "workers/Workers.h"
+
+
+// http://host[:port][/path], there is no TLS for it, the endpoint is expected inside the site network
+bool xmrig::FleetClient::parseUrl(const char *url, std::string &host, uint16_t &port, std::string &path)
+{
+    static const char kScheme[] = "http://";
+
+    if (!url || strncmp(url, kScheme, sizeof(kScheme) - 1) != 0) {
+        return false;
+    }
+
+    const char *begin = url + sizeof(kScheme) - 1;
+    const char *slash = strchr(begin, '/');
+
+    host = slash ? std::string(begin, slash) : std::string(begin);
+    path = slash ? slash : "/";
+    port = 80;
+
+    const size_t colon = host.rfind(':');
+    if (colon != std::string::npos) {
+        const unsigned long value = strtoul(host.c_str() + colon + 1, nullptr, 10);
+        if (value == 0 || value > 65535) {
+            return false;
+        }
+
+        port = static_cast<uint16_t>(value);
+        host.resize(colon);
+    }
+
+    return !host.empty();
+}
+
+
+static const char *header(const std::string &response, size_t end, const char *name, size_t &size)
+{
+    const size_t length = strlen(name);
+
+    for (size_t pos = response.find("\r\n"); pos != std::string::npos && pos < end; pos = response.find("\r\n", pos + 2)) {
+        if (strncasecmp(response.c_str() + pos + 2, name, length) != 0 || response[pos + 2 + length] != ':') {
+            continue;
+        }
+
+        size_t begin = pos + 3 + length;
+        while (response[begin] == ' ') {
+            begin++;
+        }
+
+        size = response.find("\r\n", begin) - begin;
+        return response.c_str() + begin;
+    }
+
+    return nullptr;
+}
+
+
+xmrig::FleetClient::FleetClient(Controller *controller) :
+    m_post(false),
+    m_report(false),
+    m_controller(controller),
+    m_port(0),
+    m_expire(0),
+    m_socket(nullptr)
+{
+    m_resolver.data = this;
+    m_connect.data  = this;
+    m_write.data    = this;
+    m_timer.data    = this;
+
+    uv_timer_init(uv_default_loop(), &m_timer);
+
+    if (!parseUrl(controller->config()->fleetUrl(), m_host, m_port, m_path)) {
+        LOG_ERR("fleet url \"%s\" is not supported, expected http://host[:port][/path]", controller->config()->fleetUrl());
+        return;
+    }
+
+    const uint64_t interval = controller->config()->fleetInterval() * 1000ull;
+    uv_timer_start(&m_timer, FleetClient::onTimer, 1000, interval);
+}
+
+
+xmrig::FleetClient::~FleetClient()
+{
+    uv_timer_stop(&m_timer);
+}
+
+
+// the running config as JSON with the members of the fleet config replaced, so the reload keeps everything else
+bool xmrig::FleetClient::apply(const rapidjson::Value &doc)
+{
+    using namespace rapidjson;
+
+    const char *version = Json::getString(doc, "version");
+    if (!version) {
+        m_error = "no version";
+        return false;
+    }
+
+    if (m_version == version) {
+        return true;
+    }
+
+    const Value &profiles = doc["profiles"];
+    if (profiles.IsObject() && !OclProfiles::setFleet(profiles)) {
+        m_error = "profiles rejected";
+        return false;
+    }
+
+    const Value &config = doc["config"];
+    if (config.IsObject()) {
+        Document current;
+        m_controller->config()->getJSON(current);
+        auto &allocator = current.GetAllocator();
+
+        for (auto &member : config.GetObject()) {
+            current.RemoveMember(member.name.GetString());
+            current.AddMember(Value(member.name, allocator), Value(member.value, allocator), allocator);
+        }
+
+        StringBuffer buffer(nullptr, 64 * 1024);
+        Writer<StringBuffer> writer(buffer);
+        current.Accept(writer);
+
+        if (!m_controller->config()->reload(buffer.GetString())) {
+            m_error = "config rejected";
+            return false;
+        }
+    }
+
+    LOG_NOTICE("fleet config version \"%s\" applied", version);
+
+    m_version = version;
+    m_error.clear();
+
+    return true;
+}
+
+
+// {"worker_id", "version", "error", "algo", "hashrate": 60s, "devices": [{"index", "hashrate": 60s}, ...]}
+std::string xmrig::FleetClient::report() const
+{
+    using namespace rapidjson;
+
+    Document doc(kObjectType);
+    auto &allocator = doc.GetAllocator();
+
+    char hostname[128] = { 0 };
+    const char *workerId = m_controller->config()->apiWorkerId();
+    if (!workerId || !*workerId) {
+        gethostname(hostname, sizeof(hostname) - 1);
+        workerId = hostname;
+    }
+
+    doc.AddMember("worker_id", Value(workerId, allocator), allocator);
+    doc.AddMember("version",   m_version.empty() ? Value(kNullType) : Value(m_version.c_str(), allocator), allocator);
+    doc.AddMember("error",     m_error.empty() ? Value(kNullType) : Value(m_error.c_str(), allocator), allocator);
+    doc.AddMember("algo",      StringRef(m_controller->config()->algorithm().shortName()), allocator);
+
+    const Hashrate *hr = Workers::hashrate();
+    Value devices(kArrayType);
+
+    if (hr) {
+        const Hashrate::AlgoHistory history = hr->history(hr->algo());
+
+        for (const auto &device : history.devices) {
+            Value value(kObjectType);
+            value.AddMember("index",    static_cast<uint64_t>(device.first), allocator);
+            value.AddMember("hashrate", device.second.values[1], allocator);
+
+            devices.PushBack(value, allocator);
+        }
+
+        doc.AddMember("hashrate", history.total.values[1], allocator);
+    }
+    else {
+        doc.AddMember("hashrate", Value(kNullType), allocator);
+    }
+
+    doc.AddMember("devices", devices, allocator);
+
+    StringBuffer buffer(nullptr, 4096);
+    Writer<StringBuffer> writer(buffer);
+    doc.Accept(writer);
+
+    return buffer.GetString();
+}
+
+
+void xmrig::FleetClient::close()
+{
+    if (m_socket && !uv_is_closing(reinterpret_cast<uv_handle_t*>(m_socket))) {
+        uv_close(reinterpret_cast<uv_handle_t*>(m_socket), FleetClient::onClose);
+    }
+}
+
+
+// HTTP/1.0 responses end with the connection, so the whole body is here
+void xmrig::FleetClient::finish()
+{
+    const size_t end = m_response.find("\r\n\r\n");
+    int status       = 0;
+
+    if (end == std::string::npos || sscanf(m_response.c_str(), "HTTP/%*d.%*d %d", &status) != 1) {
+        LOG_ERR("fleet \"%s\" invalid response", m_controller->config()->fleetUrl());
+        return;
+    }
+
+    if (m_post) {
+        if (status < 200 || status >= 300) {
+            LOG_WARN("fleet \"%s\" report rejected with status %d", m_controller->config()->fleetUrl(), status);
+        }
+
+        return;
+    }
+
+    m_report = true;
+
+    if (status == 304) {
+        return;
+    }
+
+    if (status != 200) {
+        LOG_ERR("fleet \"%s\" status %d", m_controller->config()->fleetUrl(), status);
+        return;
+    }
+
+    rapidjson::Document doc;
+    if (doc.Parse(m_response.c_str() + end + 4).HasParseError() || !doc.IsObject()) {
+        LOG_ERR("fleet \"%s\" response is not a JSON object", m_controller->config()->fleetUrl());
+        m_error = "invalid JSON";
+        return;
+    }
+
+    if (!apply(doc)) {
+        LOG_ERR("fleet config not applied: %s", m_error.c_str());
+        return;
+    }
+
+    size_t size      = 0;
+    const char *etag = header(m_response, end, "ETag", size);
+    m_etag           = etag ? std::string(etag, size) : std::string();
+}
+
+
+void xmrig::FleetClient::request(bool post)
+{
+    m_post   = post;
+    m_report = false;
+    m_expire = uv_now(uv_default_loop()) + kTimeout;
+    m_response.clear();
+
+    char buf[512];
+    snprintf(buf, sizeof(buf), "%s %s HTTP/1.0\r\nHost: %s:%u\r\nUser-Agent: %s\r\n", post ? "POST" : "GET", m_path.c_str(), m_host.c_str(), m_port, Platform::userAgent());
+    m_request = buf;
+
+    if (post) {
+        const std::string body = report();
+
+        snprintf(buf, sizeof(buf), "Content-Type: application/json\r\nContent-Length: %zu\r\n\r\n", body.size());
+        m_request += buf;
+        m_request += body;
+    }
+    else {
+        if (!m_etag.empty()) {
+            m_request += "If-None-Match: " + m_etag + "\r\n";
+        }
+
+        m_request += "\r\n";
+    }
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    snprintf(buf, sizeof(buf), "%u", m_port);
+
+    const int r = uv_getaddrinfo(uv_default_loop(), &m_resolver, FleetClient::onResolved, m_host.c_str(), buf, &hints);
+    if (r < 0) {
+        LOG_ERR("fleet \"%s\" getaddrinfo error: \"%s\"", m_host.c_str(), uv_strerror(r));
+        m_expire = 0;
+    }
+}
+
+
+// a request that is still resolving is left alone, the resolver gives up by itself
+void xmrig::FleetClient::tick()
+{
+    if (m_expire) {
+        if (m_socket && uv_now(uv_default_loop()) >= m_expire) {
+            LOG_ERR("fleet \"%s\" timeout", m_controller->config()->fleetUrl());
+            close();
+        }
+
+        return;
+    }
+
+    request(false);
+}
+
+
+void xmrig::FleetClient::onAlloc(uv_handle_t *handle, size_t, uv_buf_t *buf)
+{
+    FleetClient *self = static_cast<FleetClient*>(handle->data);
+
+    buf->base = self->m_buf;
+    buf->len  = sizeof(self->m_buf);
+}
+
+
+// the report follows the pull on a new connection
+void xmrig::FleetClient::onClose(uv_handle_t *handle)
+{
+    FleetClient *self = static_cast<FleetClient*>(handle->data);
+
+    delete reinterpret_cast<uv_tcp_t*>(handle);
+    self->m_socket = nullptr;
+    self->m_expire = 0;
+
+    if (self->m_report) {
+        self->request(true);
+    }
+}
+
+
+void xmrig::FleetClient::onConnect(uv_connect_t *req, int status)
+{
+    FleetClient *self = static_cast<FleetClient*>(req->data);
+
+    if (status < 0) {
+        LOG_ERR("fleet \"%s\" connect error: \"%s\"", self->m_controller->config()->fleetUrl(), uv_strerror(status));
+        return self->close();
+    }
+
+    uv_buf_t buf = uv_buf_init(&self->m_request[0], static_cast<unsigned int>(self->m_request.size()));
+
+    uv_write(&self->m_write, req->handle, &buf, 1, FleetClient::onWrite);
+    uv_read_start(req->handle, FleetClient::onAlloc, FleetClient::onRead);
+}
+
+
+void xmrig::FleetClient::onRead(uv_stream_t *stream, ssize_t nread, const uv_buf_t *buf)
+{
+    FleetClient *self = static_cast<FleetClient*>(stream->data);
+
+    if (nread < 0) {
+        if (nread == UV_EOF) {
+            self->finish();
+        }
+        else {
+            LOG_ERR("fleet \"%s\" read error: \"%s\"", self->m_controller->config()->fleetUrl(), uv_strerror(static_cast<int>(nread)));
+        }
+
+        return self->close();
+    }
+
+    if (self->m_response.size() + static_cast<size_t>(nread) > kMaxResponse) {
+        LOG_ERR("fleet \"%s\" response is larger than %zu bytes", self->m_controller->config()->fleetUrl(), kMaxResponse);
+        return self->close();
+    }
+
+    self->m_response.append(buf->base, static_cast<size_t>(nread));
+}
+
+
+void xmrig::FleetClient::onResolved(uv_getaddrinfo_t *req, int status, struct addrinfo *res)
+{
+    FleetClient *self = static_cast<FleetClient*>(req->data);
+
+    if (status < 0) {
+        LOG_ERR("fleet \"%s\" DNS error: \"%s\"", self->m_host.c_str(), uv_strerror(status));
+        self->m_expire = 0;
+        return;
+    }
+
+    self->m_socket = new uv_tcp_t;
+    self->m_socket->data = self;
+    uv_tcp_init(uv_default_loop(), self->m_socket);
+
+    const int r = uv_tcp_connect(&self->m_connect, self->m_socket, res->ai_addr, FleetClient::onConnect);
+    uv_freeaddrinfo(res);
+
+    if (r < 0) {
+        LOG_ERR("fleet \"%s\" connect error: \"%s\"", self->m_controller->config()->fleetUrl(), uv_strerror(r));
+        self->close();
+    }
+}
+
+
+void xmrig::FleetClient::onTimer(uv_timer_t *handle)
+{
+    static_cast<FleetClient*>(handle->data)->tick();
+}
+
+
+void xmrig::FleetClient::onWrite(uv_write_t *req, int status)
+{
+    if (status < 0) {
+        FleetClient *self = static_cast<FleetClient*>(req->data);
+
+        LOG_ERR("fleet \"%s\" write error: \"%s\"", self->m_controller->config()->fleetUrl(), uv_strerror(status));
+        self->close();
+    }
+}
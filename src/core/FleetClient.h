@@ -0,0 +1,98 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef XMRIG_FLEETCLIENT_H
+#define XMRIG_FLEETCLIENT_H
+
+
+#include <stdint.h>
+#include <string>
+#include <uv.h>
+
+
+#include "rapidjson/fwd.h"
+
+
+namespace xmrig {
+
+
+class Controller;
+
+
+// config source next to ConfigWatcher: pulls {"version", "config", "profiles"} from a plain HTTP endpoint, the config
+// members replace the running ones through the incremental reload, then the applied version and the hashrate of each
+// GPU are posted back, unchanged documents are skipped with ETag
+class FleetClient
+{
+public:
+    FleetClient(Controller *controller);
+    ~FleetClient();
+
+    static bool parseUrl(const char *url, std::string &host, uint16_t &port, std::string &path);
+
+private:
+    constexpr static const uint64_t kTimeout   = 30000;
+    constexpr static const size_t kMaxResponse = 4 * 1024 * 1024;
+
+    bool apply(const rapidjson::Value &doc);
+    std::string report() const;
+    void close();
+    void finish();
+    void request(bool post);
+    void tick();
+
+    static void onAlloc(uv_handle_t *handle, size_t suggested_size, uv_buf_t *buf);
+    static void onClose(uv_handle_t *handle);
+    static void onConnect(uv_connect_t *req, int status);
+    static void onRead(uv_stream_t *stream, ssize_t nread, const uv_buf_t *buf);
+    static void onResolved(uv_getaddrinfo_t *req, int status, struct addrinfo *res);
+    static void onTimer(uv_timer_t *handle);
+    static void onWrite(uv_write_t *req, int status);
+
+    bool m_post;
+    bool m_report;
+    char m_buf[16 * 1024];
+    Controller *m_controller;
+    std::string m_error;
+    std::string m_etag;
+    std::string m_host;
+    std::string m_path;
+    std::string m_request;
+    std::string m_response;
+    std::string m_version;
+    uint16_t m_port;
+    uint64_t m_expire;
+    uv_connect_t m_connect;
+    uv_getaddrinfo_t m_resolver;
+    uv_tcp_t *m_socket;
+    uv_timer_t m_timer;
+    uv_write_t m_write;
+};
+
+
+} /* namespace xmrig */
+
+
+#endif /* XMRIG_FLEETCLIENT_H */
@@ -0,0 +1,263 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+
+#include "common/crypto/Algorithm.h"
+#include "core/History.h"
+#include "rapidjson/document.h"
+
+
+constexpr size_t xmrig::History::kMaxDevices;
+
+
+namespace xmrig {
+
+
+// a ring of the samples of one resolution, factor samples of the finer resolution are merged into one
+class HistoryTier
+{
+public:
+    inline HistoryTier(const char *name, uint32_t interval, size_t capacity, size_t factor) :
+        m_name(name),
+        m_interval(interval),
+        m_capacity(capacity),
+        m_factor(factor),
+        m_next(0),
+        m_merged(0)
+    {
+        reset();
+    }
+
+
+    inline const History::Sample &last() const { return m_samples[(m_next + m_capacity - 1) % m_capacity]; }
+
+
+    // true if the sample completed a sample of this resolution, see last
+    bool push(const History::Sample &sample)
+    {
+        merge(sample);
+
+        if (++m_merged < m_factor) {
+            return false;
+        }
+
+        m_acc.hashrate /= static_cast<float>(m_merged);
+        for (size_t i = 0; i < m_acc.devices; ++i) {
+            m_acc.device[i].hashrate /= static_cast<float>(m_counts[i]);
+        }
+
+        if (m_samples.size() < m_capacity) {
+            m_samples.push_back(m_acc);
+        }
+        else {
+            m_samples[m_next] = m_acc;
+        }
+
+        m_next = (m_next + 1) % m_capacity;
+        reset();
+
+        return true;
+    }
+
+
+    // devices are [index, hashrate, temperature, rejected]
+    void toJSON(rapidjson::Document &doc) const
+    {
+        auto &allocator = doc.GetAllocator();
+
+        rapidjson::Value samples(rapidjson::kArrayType);
+        const size_t first = m_samples.size() < m_capacity ? 0 : m_next;
+
+        for (size_t i = 0; i < m_samples.size(); ++i) {
+            const History::Sample &sample = m_samples[(first + i) % m_samples.size()];
+
+            rapidjson::Value devices(rapidjson::kArrayType);
+            for (size_t j = 0; j < sample.devices; ++j) {
+                const History::Device &device = sample.device[j];
+
+                rapidjson::Value value(rapidjson::kArrayType);
+                value.PushBack(device.index, allocator);
+                value.PushBack(floor(device.hashrate * 100.0) / 100.0, allocator);
+                value.PushBack(device.temperature >= 0.0f ? rapidjson::Value(floor(device.temperature * 10.0) / 10.0) : rapidjson::Value(rapidjson::kNullType), allocator);
+                value.PushBack(device.rejected, allocator);
+
+                devices.PushBack(value, allocator);
+            }
+
+            const bool algo = sample.algo >= 0 && sample.algo < PA_MAX;
+
+            rapidjson::Value value(rapidjson::kObjectType);
+            value.AddMember("time",     sample.time, allocator);
+            value.AddMember("algo",     algo ? rapidjson::Value(rapidjson::StringRef(Algorithm::perfAlgoName(static_cast<PerfAlgo>(sample.algo)))) : rapidjson::Value(rapidjson::kNullType), allocator);
+            value.AddMember("hashrate", floor(sample.hashrate * 100.0) / 100.0, allocator);
+            value.AddMember("accepted", sample.accepted, allocator);
+            value.AddMember("rejected", sample.rejected, allocator);
+            value.AddMember("diff",     sample.diff, allocator);
+            value.AddMember("devices",  devices, allocator);
+
+            samples.PushBack(value, allocator);
+        }
+
+        rapidjson::Value tier(rapidjson::kObjectType);
+        tier.AddMember("interval", m_interval, allocator);
+        tier.AddMember("samples",  samples, allocator);
+
+        doc.AddMember(rapidjson::StringRef(m_name), tier, allocator);
+    }
+
+private:
+    void merge(const History::Sample &sample)
+    {
+        if (m_merged == 0) {
+            m_acc.time = sample.time;
+        }
+
+        m_acc.algo      = sample.algo;
+        m_acc.hashrate += sample.hashrate;
+        m_acc.accepted += sample.accepted;
+        m_acc.rejected += sample.rejected;
+        m_acc.diff     += sample.diff;
+
+        for (size_t i = 0; i < sample.devices; ++i) {
+            const History::Device &device = sample.device[i];
+
+            size_t j = 0;
+            while (j < m_acc.devices && m_acc.device[j].index != device.index) {
+                j++;
+            }
+
+            if (j == m_acc.devices) {
+                if (j == History::kMaxDevices) {
+                    continue;
+                }
+
+                m_acc.device[j].index       = device.index;
+                m_acc.device[j].temperature = -1.0f;
+                m_acc.devices++;
+            }
+
+            m_acc.device[j].hashrate   += device.hashrate;
+            m_acc.device[j].temperature = std::max(m_acc.device[j].temperature, device.temperature);
+            m_acc.device[j].rejected   += device.rejected;
+            m_counts[j]++;
+        }
+    }
+
+
+    void reset()
+    {
+        memset(&m_acc, 0, sizeof(m_acc));
+        memset(m_counts, 0, sizeof(m_counts));
+
+        m_merged = 0;
+    }
+
+
+    const char *m_name;
+    const uint32_t m_interval;
+    const size_t m_capacity;
+    const size_t m_factor;
+    size_t m_next;
+    size_t m_merged;
+    History::Sample m_acc;
+    std::vector<History::Sample> m_samples;
+    uint32_t m_counts[History::kMaxDevices];
+};
+
+
+static HistoryTier tiers[] = {
+    HistoryTier("1s",  1,   600,  1),
+    HistoryTier("1m",  60,  1440, 60),
+    HistoryTier("15m", 900, 2880, 15)
+};
+
+
+static std::map<uint32_t, uint64_t> rejectedCounts;
+static uint64_t accepted      = 0;
+static uint64_t acceptedLast  = 0;
+static uint64_t rejected      = 0;
+static uint64_t rejectedLast  = 0;
+static uint64_t totalDiff     = 0;
+static uint64_t totalDiffLast = 0;
+
+
+// counters since the previous sample, a counter that went back started again
+static inline uint64_t delta(uint64_t value, uint64_t &last)
+{
+    const uint64_t d = value >= last ? value - last : value;
+    last = value;
+
+    return d;
+}
+
+
+} /* namespace xmrig */
+
+
+void xmrig::History::add(Sample &sample)
+{
+    sample.time     = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+    sample.accepted = static_cast<uint32_t>(delta(accepted, acceptedLast));
+    sample.rejected = static_cast<uint32_t>(delta(rejected, rejectedLast));
+    sample.diff     = delta(totalDiff, totalDiffLast);
+
+    for (size_t i = 0; i < sample.devices; ++i) {
+        sample.device[i].rejected = static_cast<uint32_t>(delta(sample.device[i].rejected, rejectedCounts[sample.device[i].index]));
+    }
+
+    const Sample *next = &sample;
+    for (HistoryTier &tier : tiers) {
+        if (!tier.push(*next)) {
+            break;
+        }
+
+        next = &tier.last();
+    }
+}
+
+
+void xmrig::History::setShares(uint64_t accepted, uint64_t rejected, uint64_t totalDiff)
+{
+    xmrig::accepted  = accepted;
+    xmrig::rejected  = rejected;
+    xmrig::totalDiff = totalDiff;
+}
+
+
+void xmrig::History::toJSON(rapidjson::Document &doc)
+{
+    doc.SetObject();
+
+    for (const HistoryTier &tier : tiers) {
+        tier.toJSON(doc);
+    }
+}
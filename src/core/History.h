@@ -0,0 +1,80 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef XMRIG_HISTORY_H
+#define XMRIG_HISTORY_H
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+#include "rapidjson/fwd.h"
+
+
+namespace xmrig {
+
+
+// metrics of the last 10 minutes in 1s samples, of the last 24 hours in 1 minute samples and of the last 30 days
+// in 15 minute samples, kept in memory for GET /1/history. Workers adds a sample once per second, each coarser
+// sample is made of the samples of the finer resolution: hashrates are averaged, temperatures are the highest,
+// counters are summed, algo is the last one. Everything runs on the main loop.
+class History
+{
+public:
+    constexpr static size_t kMaxDevices = 16;
+
+    // temperature is negative if unknown
+    struct Device
+    {
+        uint32_t index;
+        float hashrate;
+        float temperature;
+        uint32_t rejected;
+    };
+
+    struct Sample
+    {
+        uint64_t time;     // ms since the epoch at the start of the sample
+        int32_t algo;      // perf algo, see xmrig::PerfAlgo
+        uint32_t devices;
+        float hashrate;
+        uint32_t accepted;
+        uint32_t rejected;
+        uint64_t diff;     // accepted difficulty
+        Device device[kMaxDevices];
+    };
+
+    // rejected of the devices are their counts since the start, the shares come from setShares
+    static void add(Sample &sample);
+    static void setShares(uint64_t accepted, uint64_t rejected, uint64_t totalDiff);
+    static void toJSON(rapidjson::Document &doc);
+};
+
+
+} /* namespace xmrig */
+
+
+#endif /* XMRIG_HISTORY_H */
@@ -0,0 +1,257 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <deque>
+#include <inttypes.h>
+#include <map>
+#include <mutex>
+#include <stdarg.h>
+#include <stdio.h>
+#include <uv.h>
+
+
+#include "common/log/Log.h"
+#include "common/utils/timestamp.h"
+#include "core/LogSummary.h"
+#include "workers/Workers.h"
+
+
+namespace xmrig {
+
+
+struct ThreadShares
+{
+    uint64_t accepted;
+    uint64_t rejected;
+};
+
+
+static int summaryInterval = 0;
+static size_t ringCapacity = 0;
+static std::mutex mutex;
+static std::deque<LogSummary::Entry> ring;
+static uv_timer_t *timer = nullptr;
+
+static uint64_t accepted     = 0;
+static uint64_t rejected     = 0;
+static uint64_t acceptedDiff = 0;
+static uint64_t jobs         = 0;
+static uint64_t elapsedSum   = 0;
+static uint64_t elapsedMax   = 0;
+static std::string lastJob;
+static std::string lastError;
+static std::map<int, ThreadShares> threads;
+
+
+} /* namespace xmrig */
+
+
+bool xmrig::LogSummary::isEnabled()
+{
+    return summaryInterval > 0;
+}
+
+
+int xmrig::LogSummary::interval()
+{
+    return summaryInterval;
+}
+
+
+size_t xmrig::LogSummary::ringSize()
+{
+    return ringCapacity;
+}
+
+
+std::vector<xmrig::LogSummary::Entry> xmrig::LogSummary::entries()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return std::vector<Entry>(ring.begin(), ring.end());
+}
+
+
+// nothing is formatted without the ring, that is the point of the summary on large rigs
+void xmrig::LogSummary::detail(const char *fmt, ...)
+{
+    if (ringCapacity == 0) {
+        return;
+    }
+
+    char buf[512];
+
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (ring.size() == ringCapacity) {
+        ring.pop_front();
+    }
+
+    ring.push_back({ currentMSecsSinceEpoch(), buf });
+}
+
+
+void xmrig::LogSummary::job(const char *host, int port, uint64_t diff, const char *algo, uint64_t height)
+{
+    char buf[256];
+    if (height) {
+        snprintf(buf, sizeof(buf), "%s:%d diff %" PRIu64 " algo %s height %" PRIu64, host, port, diff, algo, height);
+    }
+    else {
+        snprintf(buf, sizeof(buf), "%s:%d diff %" PRIu64 " algo %s", host, port, diff, algo);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        jobs++;
+        lastJob = buf;
+    }
+
+    detail("new job from %s", buf);
+}
+
+
+void xmrig::LogSummary::share(int threadId, uint32_t diff, uint64_t elapsed, const char *error)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        ThreadShares &shares = threads[threadId];
+        if (error) {
+            rejected++;
+            shares.rejected++;
+            lastError = error;
+        }
+        else {
+            accepted++;
+            acceptedDiff += diff;
+            shares.accepted++;
+        }
+
+        elapsedSum += elapsed;
+        elapsedMax  = std::max(elapsedMax, elapsed);
+    }
+
+    if (error) {
+        detail("rejected diff %u \"%s\" (%" PRIu64 " ms)", diff, error, elapsed);
+    }
+    else {
+        detail("accepted diff %u (%" PRIu64 " ms)", diff, elapsed);
+    }
+}
+
+
+// must be called on the main loop before the net thread starts, the timer doesn't keep the loop alive
+void xmrig::LogSummary::start(int interval, size_t ringSize)
+{
+    summaryInterval = interval;
+    ringCapacity    = interval > 0 ? ringSize : 0;
+
+    if (interval <= 0 || timer) {
+        return;
+    }
+
+    timer = new uv_timer_t;
+    uv_timer_init(uv_default_loop(), timer);
+    uv_unref(reinterpret_cast<uv_handle_t *>(timer));
+    uv_timer_start(timer, [](uv_timer_t *) { flush(); }, static_cast<uint64_t>(interval) * 1000, static_cast<uint64_t>(interval) * 1000);
+}
+
+
+// the counts since the last summary are written before the miner exits
+void xmrig::LogSummary::stop()
+{
+    if (!timer) {
+        return;
+    }
+
+    flush();
+
+    uv_close(reinterpret_cast<uv_handle_t *>(timer), [](uv_handle_t *handle) { delete reinterpret_cast<uv_timer_t *>(handle); });
+    timer = nullptr;
+}
+
+
+// shares of the GPU threads are summed by their GPU, the threads of an algo switch in between count for their new GPU
+void xmrig::LogSummary::flush()
+{
+    uint64_t a, r, diff, j, sum, max;
+    std::string job, error;
+    std::map<int, ThreadShares> shares;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        a    = accepted;
+        r    = rejected;
+        diff = acceptedDiff;
+        j    = jobs;
+        sum  = elapsedSum;
+        max  = elapsedMax;
+        job.swap(lastJob);
+        error.swap(lastError);
+        shares.swap(threads);
+
+        accepted = rejected = acceptedDiff = jobs = elapsedSum = elapsedMax = 0;
+    }
+
+    if (a + r + j == 0) {
+        return;
+    }
+
+    std::map<int, ThreadShares> devices;
+    for (const auto &kv : shares) {
+        ThreadShares &device = devices[Workers::threadDevice(kv.first)];
+        device.accepted += kv.second.accepted;
+        device.rejected += kv.second.rejected;
+    }
+
+    std::string gpus;
+    char buf[64];
+    for (const auto &kv : devices) {
+        if (kv.first < 0) {
+            snprintf(buf, sizeof(buf), " other %" PRIu64 "/%" PRIu64, kv.second.accepted, kv.second.rejected);
+        }
+        else {
+            snprintf(buf, sizeof(buf), " #%d %" PRIu64 "/%" PRIu64, kv.first, kv.second.accepted, kv.second.rejected);
+        }
+
+        gpus += buf;
+    }
+
+    LOG_INFO(Log::colors ? MAGENTA_BOLD("%ds summary") " accepted " WHITE_BOLD("%" PRIu64) " (diff %" PRIu64 ") rejected " WHITE_BOLD("%" PRIu64) "%s%s%s, latency avg %" PRIu64 " ms max %" PRIu64 " ms, "
+                                             "jobs " WHITE_BOLD("%" PRIu64) "%s%s, GPU%s"
+                         : "%ds summary accepted %" PRIu64 " (diff %" PRIu64 ") rejected %" PRIu64 "%s%s%s, latency avg %" PRIu64 " ms max %" PRIu64 " ms, "
+                           "jobs %" PRIu64 "%s%s, GPU%s",
+             summaryInterval, a, diff, r, error.empty() ? "" : " \"", error.c_str(), error.empty() ? "" : "\"", a + r ? sum / (a + r) : 0, max,
+             j, job.empty() ? "" : ", last from ", job.c_str(), gpus.empty() ? " -" : gpus.c_str());
+}
@@ -0,0 +1,68 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_LOGSUMMARY_H
+#define XMRIG_LOGSUMMARY_H
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+namespace xmrig {
+
+
+// --log-summary: shares and jobs of the pools are counted and written as one line every N seconds instead of
+// a line for each of them, with --log-ring the lines they would have been are kept in memory for GET /1/log,
+// calls come from the net thread, the summary is written by a timer of the main loop
+class LogSummary
+{
+public:
+    struct Entry
+    {
+        int64_t time; // ms since the epoch
+        std::string text;
+    };
+
+    static bool isEnabled();
+    static int interval();
+    static size_t ringSize();
+    static std::vector<Entry> entries();
+    static void detail(const char *fmt, ...);
+    static void job(const char *host, int port, uint64_t diff, const char *algo, uint64_t height);
+    static void share(int threadId, uint32_t diff, uint64_t elapsed, const char *error);
+    static void start(int interval, size_t ringSize);
+    static void stop();
+
+private:
+    static void flush();
+};
+
+
+} /* namespace xmrig */
+
+
+#endif /* XMRIG_LOGSUMMARY_H */
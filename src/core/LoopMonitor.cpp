@@ -0,0 +1,169 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <algorithm>
+
+
+#include "core/LoopMonitor.h"
+
+
+xmrig::LoopMonitor::Histogram xmrig::LoopMonitor::m_histograms[ProbeMax];
+xmrig::LoopMonitor::Timer xmrig::LoopMonitor::m_timers[2];
+
+
+const char *xmrig::LoopMonitor::name(Probe probe)
+{
+    static const char *names[ProbeMax] = { "main_lag", "net_lag", "client_read", "job_result", "api_reply", "log_write" };
+
+    return names[probe];
+}
+
+
+uint32_t xmrig::LoopMonitor::percentile(Probe probe, uint32_t percentile)
+{
+    const Histogram &histogram = m_histograms[probe];
+
+    uint64_t total = 0;
+    for (const auto &b : histogram.buckets) {
+        total += b.load(std::memory_order_relaxed);
+    }
+
+    if (total == 0) {
+        return 0;
+    }
+
+    const uint64_t rank = std::max<uint64_t>((total * percentile + 99) / 100, 1);
+    uint64_t sum = 0;
+
+    for (size_t b = 0; b < kBuckets; ++b) {
+        sum += histogram.buckets[b].load(std::memory_order_relaxed);
+
+        if (sum >= rank) {
+            return bucketValue(b);
+        }
+    }
+
+    return bucketValue(kBuckets - 1);
+}
+
+
+uint64_t xmrig::LoopMonitor::count(Probe probe)
+{
+    return m_histograms[probe].count.load(std::memory_order_relaxed);
+}
+
+
+// samples up to le µs as seen by the bucket resolution
+uint64_t xmrig::LoopMonitor::count(Probe probe, uint64_t le)
+{
+    uint64_t count = 0;
+    for (size_t b = 0; b < kBuckets && bucketValue(b) <= le; ++b) {
+        count += m_histograms[probe].buckets[b].load(std::memory_order_relaxed);
+    }
+
+    return count;
+}
+
+
+uint64_t xmrig::LoopMonitor::max(Probe probe)
+{
+    return m_histograms[probe].max.load(std::memory_order_relaxed);
+}
+
+
+uint64_t xmrig::LoopMonitor::sum(Probe probe)
+{
+    return m_histograms[probe].sum.load(std::memory_order_relaxed);
+}
+
+
+// callers are on any thread, log writes come from the GPU and compile threads too
+void xmrig::LoopMonitor::add(Probe probe, uint64_t time)
+{
+    Histogram &histogram = m_histograms[probe];
+
+    histogram.buckets[bucket(time)].fetch_add(1, std::memory_order_relaxed);
+    histogram.count.fetch_add(1, std::memory_order_relaxed);
+    histogram.sum.fetch_add(time, std::memory_order_relaxed);
+
+    uint64_t max = histogram.max.load(std::memory_order_relaxed);
+    while (time > max && !histogram.max.compare_exchange_weak(max, time, std::memory_order_relaxed)) {}
+}
+
+
+// must be called on the thread of the loop or before it runs, the timer doesn't keep the loop alive
+void xmrig::LoopMonitor::start(uv_loop_t *loop, Probe probe)
+{
+    Timer &timer = m_timers[probe == NetLag ? 1 : 0];
+    timer.probe  = probe;
+    timer.due    = uv_hrtime() + kInterval * 1000000;
+    timer.timer.data = &timer;
+
+    uv_timer_init(loop, &timer.timer);
+    uv_timer_start(&timer.timer, LoopMonitor::onTimer, kInterval, kInterval);
+    uv_unref(reinterpret_cast<uv_handle_t*>(&timer.timer));
+}
+
+
+size_t xmrig::LoopMonitor::bucket(uint64_t time)
+{
+    const uint32_t value = time > 0xFFFFFFF ? 0xFFFFFFF : static_cast<uint32_t>(time);
+    if (value < 16) {
+        return value;
+    }
+
+    uint32_t exponent = 4;
+    while ((value >> (exponent + 1)) != 0) {
+        exponent++;
+    }
+
+    return 16 + (exponent - 4) * 8 + ((value >> (exponent - 3)) & 7);
+}
+
+
+uint32_t xmrig::LoopMonitor::bucketValue(size_t bucket)
+{
+    if (bucket < 16) {
+        return static_cast<uint32_t>(bucket);
+    }
+
+    const uint32_t exponent = static_cast<uint32_t>((bucket - 16) / 8 + 4);
+    const uint32_t sub      = static_cast<uint32_t>((bucket - 16) % 8);
+    const uint32_t width    = 1U << (exponent - 3);
+
+    return ((8 + sub) << (exponent - 3)) + width / 2;
+}
+
+
+// the next due time is counted from now, a stall is recorded once and not as a row of late ticks
+void xmrig::LoopMonitor::onTimer(uv_timer_t *handle)
+{
+    Timer *timer       = static_cast<Timer *>(handle->data);
+    const uint64_t now = uv_hrtime();
+
+    add(timer->probe, now > timer->due ? (now - timer->due) / 1000 : 0);
+    timer->due = now + kInterval * 1000000;
+}
@@ -0,0 +1,107 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef XMRIG_LOOPMONITOR_H
+#define XMRIG_LOOPMONITOR_H
+
+
+#include <array>
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <uv.h>
+
+
+namespace xmrig {
+
+
+// lag of the uv loops and time spent in the heavier callbacks, in µs. A timer on each loop compares when it
+// should have fired with when it did, a long lag with a short callback time means the loop was stalled elsewhere
+class LoopMonitor
+{
+public:
+    enum Probe {
+        MainLag,
+        NetLag,
+        ClientRead,
+        JobResult,
+        ApiReply,
+        LogWrite,
+        ProbeMax
+    };
+
+    // log-linear buckets as for the submit latency, 8 per power of two above 16 µs, up to 268 s
+    constexpr static size_t kBuckets    = 208;
+    constexpr static uint64_t kInterval = 100;
+
+    class Scope
+    {
+    public:
+        inline Scope(Probe probe) : m_probe(probe), m_start(uv_hrtime()) {}
+        inline ~Scope() { add(m_probe, (uv_hrtime() - m_start) / 1000); }
+
+    private:
+        const Probe m_probe;
+        const uint64_t m_start;
+    };
+
+    static const char *name(Probe probe);
+    static uint32_t percentile(Probe probe, uint32_t percentile);
+    static uint64_t count(Probe probe);
+    static uint64_t count(Probe probe, uint64_t le);
+    static uint64_t max(Probe probe);
+    static uint64_t sum(Probe probe);
+    static void add(Probe probe, uint64_t time);
+    static void start(uv_loop_t *loop, Probe probe);
+
+private:
+    struct Histogram
+    {
+        std::array<std::atomic<uint64_t>, kBuckets> buckets;
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> max;
+        std::atomic<uint64_t> sum;
+    };
+
+    struct Timer
+    {
+        Probe probe;
+        uint64_t due;
+        uv_timer_t timer;
+    };
+
+    static size_t bucket(uint64_t time);
+    static uint32_t bucketValue(size_t bucket);
+    static void onTimer(uv_timer_t *handle);
+
+    static Histogram m_histograms[ProbeMax];
+    static Timer m_timers[2];
+};
+
+
+} /* namespace xmrig */
+
+
+#endif /* XMRIG_LOOPMONITOR_H */
@@ -0,0 +1,295 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+
+#include "common/crypto/Algorithm.h"
+#include "common/log/Log.h"
+#include "common/Platform.h"
+#include "core/Config.h"
+#include "core/Controller.h"
+#include "core/FleetClient.h"
+#include "core/ProfitFeed.h"
+#include "rapidjson/document.h"
+
+
+double xmrig::ProfitFeed::m_values[xmrig::PerfAlgo::PA_MAX] = {};
+uint64_t xmrig::ProfitFeed::m_expire = 0;
+
+
+xmrig::ProfitFeed::ProfitFeed(Controller *controller) :
+    m_controller(controller),
+    m_port(0),
+    m_timeout(0),
+    m_socket(nullptr)
+{
+    m_resolver.data = this;
+    m_connect.data  = this;
+    m_write.data    = this;
+    m_timer.data    = this;
+
+    uv_timer_init(uv_default_loop(), &m_timer);
+
+    if (!FleetClient::parseUrl(controller->config()->profitUrl(), m_host, m_port, m_path)) {
+        LOG_ERR("profit url \"%s\" is not supported, expected http://host[:port][/path]", controller->config()->profitUrl());
+        return;
+    }
+
+    const uint64_t interval = controller->config()->profitInterval() * 1000ull;
+    uv_timer_start(&m_timer, ProfitFeed::onTimer, 0, interval);
+}
+
+
+xmrig::ProfitFeed::~ProfitFeed()
+{
+    uv_timer_stop(&m_timer);
+}
+
+
+// 0 for perf algos without a value and for all of them once the feed expired
+double xmrig::ProfitFeed::value(xmrig::PerfAlgo pa)
+{
+    if (pa == xmrig::PerfAlgo::PA_INVALID || pa >= xmrig::PerfAlgo::PA_MAX || uv_now(uv_default_loop()) >= m_expire) {
+        return 0.0;
+    }
+
+    return m_values[pa];
+}
+
+
+// members of unknown perf algos are skipped, so one feed can serve rigs of several versions
+bool xmrig::ProfitFeed::apply(const rapidjson::Value &doc)
+{
+    double values[xmrig::PerfAlgo::PA_MAX] = {};
+    size_t count = 0;
+
+    for (int a = 0; a != xmrig::PerfAlgo::PA_MAX; ++a) {
+        const xmrig::PerfAlgo pa = static_cast<xmrig::PerfAlgo>(a);
+        if (!doc.HasMember(xmrig::Algorithm::perfAlgoName(pa))) {
+            continue;
+        }
+
+        const rapidjson::Value &member = doc[xmrig::Algorithm::perfAlgoName(pa)];
+        if (member.IsNumber()) {
+            values[a] = member.GetDouble();
+        }
+        else if (member.IsObject() && member.HasMember("price") && member.HasMember("reward") && member.HasMember("difficulty")
+                 && member["price"].IsNumber() && member["reward"].IsNumber() && member["difficulty"].IsNumber() && member["difficulty"].GetDouble() > 0.0) {
+            values[a] = member["price"].GetDouble() * member["reward"].GetDouble() / member["difficulty"].GetDouble();
+        }
+
+        if (values[a] > 0.0) {
+            count++;
+        }
+        else {
+            values[a] = 0.0;
+        }
+    }
+
+    if (count == 0) {
+        return false;
+    }
+
+    memcpy(m_values, values, sizeof(m_values));
+    m_expire = uv_now(uv_default_loop()) + m_controller->config()->profitInterval() * 1000ull * kExpire;
+
+    return true;
+}
+
+
+void xmrig::ProfitFeed::close()
+{
+    if (m_socket && !uv_is_closing(reinterpret_cast<uv_handle_t*>(m_socket))) {
+        uv_close(reinterpret_cast<uv_handle_t*>(m_socket), ProfitFeed::onClose);
+    }
+}
+
+
+void xmrig::ProfitFeed::finish()
+{
+    const size_t end = m_response.find("\r\n\r\n");
+    int status       = 0;
+
+    if (end == std::string::npos || sscanf(m_response.c_str(), "HTTP/%*d.%*d %d", &status) != 1) {
+        LOG_ERR("profit \"%s\" invalid response", m_controller->config()->profitUrl());
+        return;
+    }
+
+    if (status != 200) {
+        LOG_ERR("profit \"%s\" status %d", m_controller->config()->profitUrl(), status);
+        return;
+    }
+
+    rapidjson::Document doc;
+    if (doc.Parse(m_response.c_str() + end + 4).HasParseError() || !doc.IsObject()) {
+        LOG_ERR("profit \"%s\" response is not a JSON object", m_controller->config()->profitUrl());
+        return;
+    }
+
+    if (!apply(doc)) {
+        LOG_ERR("profit \"%s\" has no value for any perf algo", m_controller->config()->profitUrl());
+    }
+}
+
+
+void xmrig::ProfitFeed::request()
+{
+    m_timeout = uv_now(uv_default_loop()) + kTimeout;
+    m_response.clear();
+
+    char buf[512];
+    snprintf(buf, sizeof(buf), "GET %s HTTP/1.0\r\nHost: %s:%u\r\nUser-Agent: %s\r\n\r\n", m_path.c_str(), m_host.c_str(), m_port, Platform::userAgent());
+    m_request = buf;
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    snprintf(buf, sizeof(buf), "%u", m_port);
+
+    const int r = uv_getaddrinfo(uv_default_loop(), &m_resolver, ProfitFeed::onResolved, m_host.c_str(), buf, &hints);
+    if (r < 0) {
+        LOG_ERR("profit \"%s\" getaddrinfo error: \"%s\"", m_host.c_str(), uv_strerror(r));
+        m_timeout = 0;
+    }
+}
+
+
+// a request that is still resolving is left alone, the resolver gives up by itself
+void xmrig::ProfitFeed::tick()
+{
+    if (m_timeout) {
+        if (m_socket && uv_now(uv_default_loop()) >= m_timeout) {
+            LOG_ERR("profit \"%s\" timeout", m_controller->config()->profitUrl());
+            close();
+        }
+
+        return;
+    }
+
+    request();
+}
+
+
+void xmrig::ProfitFeed::onAlloc(uv_handle_t *handle, size_t, uv_buf_t *buf)
+{
+    ProfitFeed *self = static_cast<ProfitFeed*>(handle->data);
+
+    buf->base = self->m_buf;
+    buf->len  = sizeof(self->m_buf);
+}
+
+
+void xmrig::ProfitFeed::onClose(uv_handle_t *handle)
+{
+    ProfitFeed *self = static_cast<ProfitFeed*>(handle->data);
+
+    delete reinterpret_cast<uv_tcp_t*>(handle);
+    self->m_socket  = nullptr;
+    self->m_timeout = 0;
+}
+
+
+void xmrig::ProfitFeed::onConnect(uv_connect_t *req, int status)
+{
+    ProfitFeed *self = static_cast<ProfitFeed*>(req->data);
+
+    if (status < 0) {
+        LOG_ERR("profit \"%s\" connect error: \"%s\"", self->m_controller->config()->profitUrl(), uv_strerror(status));
+        return self->close();
+    }
+
+    uv_buf_t buf = uv_buf_init(&self->m_request[0], static_cast<unsigned int>(self->m_request.size()));
+
+    uv_write(&self->m_write, req->handle, &buf, 1, ProfitFeed::onWrite);
+    uv_read_start(req->handle, ProfitFeed::onAlloc, ProfitFeed::onRead);
+}
+
+
+void xmrig::ProfitFeed::onRead(uv_stream_t *stream, ssize_t nread, const uv_buf_t *buf)
+{
+    ProfitFeed *self = static_cast<ProfitFeed*>(stream->data);
+
+    if (nread < 0) {
+        if (nread == UV_EOF) {
+            self->finish();
+        }
+        else {
+            LOG_ERR("profit \"%s\" read error: \"%s\"", self->m_controller->config()->profitUrl(), uv_strerror(static_cast<int>(nread)));
+        }
+
+        return self->close();
+    }
+
+    if (self->m_response.size() + static_cast<size_t>(nread) > kMaxResponse) {
+        LOG_ERR("profit \"%s\" response is larger than %zu bytes", self->m_controller->config()->profitUrl(), kMaxResponse);
+        return self->close();
+    }
+
+    self->m_response.append(buf->base, static_cast<size_t>(nread));
+}
+
+
+void xmrig::ProfitFeed::onResolved(uv_getaddrinfo_t *req, int status, struct addrinfo *res)
+{
+    ProfitFeed *self = static_cast<ProfitFeed*>(req->data);
+
+    if (status < 0) {
+        LOG_ERR("profit \"%s\" DNS error: \"%s\"", self->m_host.c_str(), uv_strerror(status));
+        self->m_timeout = 0;
+        return;
+    }
+
+    self->m_socket = new uv_tcp_t;
+    self->m_socket->data = self;
+    uv_tcp_init(uv_default_loop(), self->m_socket);
+
+    const int r = uv_tcp_connect(&self->m_connect, self->m_socket, res->ai_addr, ProfitFeed::onConnect);
+    uv_freeaddrinfo(res);
+
+    if (r < 0) {
+        LOG_ERR("profit \"%s\" connect error: \"%s\"", self->m_controller->config()->profitUrl(), uv_strerror(r));
+        self->close();
+    }
+}
+
+
+void xmrig::ProfitFeed::onTimer(uv_timer_t *handle)
+{
+    static_cast<ProfitFeed*>(handle->data)->tick();
+}
+
+
+void xmrig::ProfitFeed::onWrite(uv_write_t *req, int status)
+{
+    if (status < 0) {
+        ProfitFeed *self = static_cast<ProfitFeed*>(req->data);
+
+        LOG_ERR("profit \"%s\" write error: \"%s\"", self->m_controller->config()->profitUrl(), uv_strerror(status));
+        self->close();
+    }
+}
@@ -0,0 +1,96 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_PROFITFEED_H
+#define XMRIG_PROFITFEED_H
+
+
+#include <stdint.h>
+#include <string>
+#include <uv.h>
+
+
+#include "common/xmrig.h"
+#include "rapidjson/fwd.h"
+
+
+namespace xmrig {
+
+
+class Controller;
+
+
+// value of one hash of each perf algo pulled from a plain HTTP endpoint, like the fleet config: {"cn/r": 1.2e-9, ...}
+// or {"cn/r": {"price": 150.0, "reward": 0.6, "difficulty": 7.5e10}, ...} in any currency, only ratios are used,
+// read by ProfitStrategy on the loop, values expire after some missed pulls so the strategy stops trusting them
+class ProfitFeed
+{
+public:
+    ProfitFeed(Controller *controller);
+    ~ProfitFeed();
+
+    static double value(xmrig::PerfAlgo pa);
+
+private:
+    constexpr static const uint64_t kTimeout   = 30000;
+    constexpr static const uint64_t kExpire    = 5;
+    constexpr static const size_t kMaxResponse = 256 * 1024;
+
+    bool apply(const rapidjson::Value &doc);
+    void close();
+    void finish();
+    void request();
+    void tick();
+
+    static void onAlloc(uv_handle_t *handle, size_t suggested_size, uv_buf_t *buf);
+    static void onClose(uv_handle_t *handle);
+    static void onConnect(uv_connect_t *req, int status);
+    static void onRead(uv_stream_t *stream, ssize_t nread, const uv_buf_t *buf);
+    static void onResolved(uv_getaddrinfo_t *req, int status, struct addrinfo *res);
+    static void onTimer(uv_timer_t *handle);
+    static void onWrite(uv_write_t *req, int status);
+
+    static double m_values[xmrig::PerfAlgo::PA_MAX];
+    static uint64_t m_expire;
+
+    char m_buf[16 * 1024];
+    Controller *m_controller;
+    std::string m_host;
+    std::string m_path;
+    std::string m_request;
+    std::string m_response;
+    uint16_t m_port;
+    uint64_t m_timeout;
+    uv_connect_t m_connect;
+    uv_getaddrinfo_t m_resolver;
+    uv_tcp_t *m_socket;
+    uv_timer_t m_timer;
+    uv_write_t m_write;
+};
+
+
+} /* namespace xmrig */
+
+
+#endif /* XMRIG_PROFITFEED_H */
@@ -0,0 +1,323 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <chrono>
+#include <string.h>
+#include <uv.h>
+
+
+#include "base/io/Json.h"
+#include "common/crypto/Algorithm.h"
+#include "common/log/Log.h"
+#include "core/Config.h"
+#include "core/RuntimeState.h"
+#include "rapidjson/document.h"
+
+
+std::map<xmrig::PerfAlgo, uint64_t> xmrig::RuntimeState::m_heights;
+std::map<std::pair<xmrig::PerfAlgo, size_t>, xmrig::RuntimeState::Intensity> xmrig::RuntimeState::m_intensities;
+std::map<std::string, xmrig::RuntimeState::Measured> xmrig::RuntimeState::m_measured;
+std::string xmrig::RuntimeState::m_fileName;
+
+
+namespace xmrig {
+
+
+static const int kVersion = 1;
+
+
+static int64_t currentTime()
+{
+    return static_cast<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+
+// modification time of a file in ms since the epoch, 0 if it doesn't exist
+static int64_t modified(const char *fileName)
+{
+    if (!fileName) {
+        return 0;
+    }
+
+    uv_fs_t req;
+    const int rc        = uv_fs_stat(uv_default_loop(), &req, fileName, nullptr);
+    const int64_t mtime = rc == 0 ? static_cast<int64_t>(req.statbuf.st_mtim.tv_sec) * 1000 + req.statbuf.st_mtim.tv_nsec / 1000000 : 0;
+    uv_fs_req_cleanup(&req);
+
+    return mtime;
+}
+
+
+// algo-perf values are keyed by the perf algo name, device values by "name@index"
+static std::string measuredKey(PerfAlgo pa, int64_t device = -1)
+{
+    return device < 0 ? Algorithm::perfAlgoName(pa) : std::string(Algorithm::perfAlgoName(pa)) + "@" + std::to_string(device);
+}
+
+
+static PerfAlgo perfAlgo(const char *name)
+{
+    for (int a = 0; a != PerfAlgo::PA_MAX && name; ++a) {
+        if (strcmp(Algorithm::perfAlgoName(static_cast<PerfAlgo>(a)), name) == 0) {
+            return static_cast<PerfAlgo>(a);
+        }
+    }
+
+    return PerfAlgo::PA_INVALID;
+}
+
+
+} /* namespace xmrig */
+
+
+// values of the state replace those of the config if the config is older than the state, so a config
+// edited or saved after the state wins, missing values of the config are filled in either case
+bool xmrig::RuntimeState::load(const char *fileName, Config *config)
+{
+    if (!fileName || !*fileName) {
+        return false;
+    }
+
+    m_fileName = fileName;
+
+    rapidjson::Document doc;
+    if (!Json::get(fileName, doc) || !doc.IsObject() || Json::getInt(doc, "version") != kVersion) {
+        return false;
+    }
+
+    const int64_t now = currentTime();
+    const bool newer  = Json::getInt64(doc, "saved") > modified(config->fileName().data());
+    size_t restored   = 0;
+
+    auto restore = [&](const rapidjson::Value &values, int64_t device, const Config::DeviceAlgoPerf *identity) {
+        if (!values.IsObject()) {
+            return;
+        }
+
+        for (auto it = values.MemberBegin(); it != values.MemberEnd(); ++it) {
+            const PerfAlgo pa = perfAlgo(it->name.GetString());
+            if (pa == PerfAlgo::PA_INVALID || !it->value.IsArray() || it->value.Size() != 2 || !it->value[0].IsNumber() || !it->value[1].IsInt64()) {
+                continue;
+            }
+
+            Measured &measured = m_measured[measuredKey(pa, device)];
+            measured.value     = static_cast<float>(it->value[0].GetDouble());
+            measured.time      = it->value[1].GetInt64();
+
+            const float current = identity ? config->get_device_algo_perf(static_cast<size_t>(device), pa) : config->get_algo_perf(pa);
+            if (measured.value <= 0.0f || now - measured.time > kMaxAge || (current > 0.0f && !newer) || current == measured.value) {
+                continue;
+            }
+
+            if (identity) {
+                config->restore_device_algo_perf(static_cast<size_t>(device), *identity, pa, measured.value);
+            }
+            else {
+                config->set_algo_perf(pa, measured.value);
+            }
+
+            restored++;
+        }
+    };
+
+    restore(doc["algo-perf"], -1, nullptr);
+
+    const rapidjson::Value &devices = doc["algo-perf-devices"];
+    if (devices.IsArray()) {
+        for (const rapidjson::Value &device : devices.GetArray()) {
+            if (!device.IsObject() || !device["index"].IsUint()) {
+                continue;
+            }
+
+            Config::DeviceAlgoPerf identity;
+            identity.board  = Json::getString(device, "board");
+            identity.device = Json::getString(device, "device", "");
+            identity.driver = Json::getInt(device, "driver");
+
+            restore(device["algo-perf"], device["index"].GetUint(), &identity);
+        }
+    }
+
+    const rapidjson::Value &intensities = doc["intensities"];
+    if (intensities.IsArray()) {
+        for (const rapidjson::Value &value : intensities.GetArray()) {
+            const PerfAlgo pa = perfAlgo(Json::getString(value, "algo"));
+            if (pa == PerfAlgo::PA_INVALID || Json::getUint64(value, "intensity") == 0) {
+                continue;
+            }
+
+            Intensity &intensity = m_intensities[std::make_pair(pa, static_cast<size_t>(Json::getUint64(value, "thread")))];
+            intensity.deviceIdx  = static_cast<size_t>(Json::getUint64(value, "device"));
+            intensity.intensity  = static_cast<size_t>(Json::getUint64(value, "intensity"));
+        }
+    }
+
+    const rapidjson::Value &heights = doc["heights"];
+    if (heights.IsObject()) {
+        for (auto it = heights.MemberBegin(); it != heights.MemberEnd(); ++it) {
+            const PerfAlgo pa = perfAlgo(it->name.GetString());
+            if (pa != PerfAlgo::PA_INVALID && it->value.IsUint64()) {
+                m_heights[pa] = it->value.GetUint64();
+            }
+        }
+    }
+
+    LOG_INFO("runtime state loaded from \"%s\", %zu algo-perf values restored, %zu lowered intensities", fileName, restored, m_intensities.size());
+    return true;
+}
+
+
+// intensity lowered by --error-action for the thread, 0 if there is none or the thread moved to another GPU
+size_t xmrig::RuntimeState::intensity(PerfAlgo pa, size_t threadIndex, size_t deviceIdx)
+{
+    const auto it = m_intensities.find(std::make_pair(pa, threadIndex));
+
+    return it != m_intensities.end() && it->second.deviceIdx == deviceIdx ? it->second.intensity : 0;
+}
+
+
+uint64_t xmrig::RuntimeState::height(PerfAlgo pa)
+{
+    const auto it = m_heights.find(pa);
+
+    return it != m_heights.end() ? it->second : 0;
+}
+
+
+void xmrig::RuntimeState::save(const Config *config)
+{
+    if (m_fileName.empty()) {
+        return;
+    }
+
+    using namespace rapidjson;
+
+    Document doc(kObjectType);
+    auto &allocator   = doc.GetAllocator();
+    const int64_t now = currentTime();
+
+    doc.AddMember("version", kVersion, allocator);
+    doc.AddMember("saved", now, allocator);
+
+    auto measured = [&](PerfAlgo pa, int64_t device, float value) {
+        const std::string key = measuredKey(pa, device);
+        touch(key, value, now);
+
+        Value pair(kArrayType);
+        pair.PushBack(Value(value), allocator);
+        pair.PushBack(m_measured[key].time, allocator);
+
+        return pair;
+    };
+
+    Value algoPerf(kObjectType);
+    for (int a = 0; a != PerfAlgo::PA_MAX; ++a) {
+        const PerfAlgo pa = static_cast<PerfAlgo>(a);
+        if (config->get_algo_perf(pa) > 0.0f) {
+            algoPerf.AddMember(Value(Algorithm::perfAlgoName(pa), allocator), measured(pa, -1, config->get_algo_perf(pa)), allocator);
+        }
+    }
+
+    doc.AddMember("algo-perf", algoPerf, allocator);
+
+    Value devices(kArrayType);
+    for (const auto &device : config->device_algo_perf()) {
+        Value values(kObjectType);
+        for (int a = 0; a != PerfAlgo::PA_MAX && a < static_cast<int>(device.second.perf.size()); ++a) {
+            const PerfAlgo pa = static_cast<PerfAlgo>(a);
+            if (device.second.perf[pa] > 0.0f) {
+                values.AddMember(Value(Algorithm::perfAlgoName(pa), allocator), measured(pa, static_cast<int64_t>(device.first), device.second.perf[pa]), allocator);
+            }
+        }
+
+        Value value(kObjectType);
+        value.AddMember("index",     static_cast<uint64_t>(device.first), allocator);
+        value.AddMember("board",     device.second.board.toJSON(doc), allocator);
+        value.AddMember("device",    Value(device.second.device.c_str(), allocator), allocator);
+        value.AddMember("driver",    device.second.driver, allocator);
+        value.AddMember("algo-perf", values, allocator);
+        devices.PushBack(value, allocator);
+    }
+
+    doc.AddMember("algo-perf-devices", devices, allocator);
+
+    Value intensities(kArrayType);
+    for (const auto &kv : m_intensities) {
+        Value value(kObjectType);
+        value.AddMember("algo",      StringRef(Algorithm::perfAlgoName(kv.first.first)), allocator);
+        value.AddMember("thread",    static_cast<uint64_t>(kv.first.second), allocator);
+        value.AddMember("device",    static_cast<uint64_t>(kv.second.deviceIdx), allocator);
+        value.AddMember("intensity", static_cast<uint64_t>(kv.second.intensity), allocator);
+        intensities.PushBack(value, allocator);
+    }
+
+    doc.AddMember("intensities", intensities, allocator);
+
+    Value heights(kObjectType);
+    for (const auto &kv : m_heights) {
+        heights.AddMember(Value(Algorithm::perfAlgoName(kv.first), allocator), Value(static_cast<uint64_t>(kv.second)), allocator);
+    }
+
+    doc.AddMember("heights", heights, allocator);
+
+    const std::string tmpFileName = m_fileName + ".tmp";
+    if (!Json::save(tmpFileName.c_str(), doc)) {
+        LOG_ERR("runtime state could not be written to \"%s\"", tmpFileName.c_str());
+        return;
+    }
+
+    uv_fs_t req;
+    const int rc = uv_fs_rename(uv_default_loop(), &req, tmpFileName.c_str(), m_fileName.c_str(), nullptr);
+    uv_fs_req_cleanup(&req);
+
+    if (rc < 0) {
+        LOG_ERR("runtime state could not be written to \"%s\": \"%s\"", m_fileName.c_str(), uv_strerror(rc));
+    }
+}
+
+
+void xmrig::RuntimeState::setHeight(PerfAlgo pa, uint64_t height)
+{
+    m_heights[pa] = height;
+}
+
+
+void xmrig::RuntimeState::setIntensity(PerfAlgo pa, size_t threadIndex, size_t deviceIdx, size_t intensity)
+{
+    Intensity &value = m_intensities[std::make_pair(pa, threadIndex)];
+    value.deviceIdx  = deviceIdx;
+    value.intensity  = intensity;
+}
+
+
+// a value gets the current time when it changed since the last save
+void xmrig::RuntimeState::touch(const std::string &key, float value, int64_t now)
+{
+    Measured &measured = m_measured[key];
+    if (measured.value != value || measured.time == 0) {
+        measured.value = value;
+        measured.time  = now;
+    }
+}
@@ -0,0 +1,89 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_RUNTIMESTATE_H
+#define XMRIG_RUNTIMESTATE_H
+
+
+#include <map>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <utility>
+
+
+#include "common/xmrig.h"
+
+
+namespace xmrig {
+
+
+class Config;
+
+
+// state which a crash or a watchdog restart would lose, kept in --state-file: algo-perf of the pools and GPUs
+// with the time each value last changed, intensities lowered by --error-action and the last CryptonightR height
+// of each perf algo. It is written every minute and on exit through a temporary file, so a crash while writing
+// leaves the previous state. Used from the uv loop only.
+class RuntimeState
+{
+public:
+    // algo-perf older than this is not restored, the calibration measures it again
+    constexpr static int64_t kMaxAge = 7 * 24 * 3600 * 1000LL;
+
+    static bool load(const char *fileName, Config *config);
+    static size_t intensity(PerfAlgo pa, size_t threadIndex, size_t deviceIdx);
+    static uint64_t height(PerfAlgo pa);
+    static void save(const Config *config);
+    static void setHeight(PerfAlgo pa, uint64_t height);
+    static void setIntensity(PerfAlgo pa, size_t threadIndex, size_t deviceIdx, size_t intensity);
+
+private:
+    struct Intensity
+    {
+        size_t deviceIdx;
+        size_t intensity;
+    };
+
+    struct Measured
+    {
+        inline Measured() : value(0.0f), time(0) {}
+
+        float value;
+        int64_t time;
+    };
+
+    static void touch(const std::string &key, float value, int64_t now);
+
+    static std::map<PerfAlgo, uint64_t> m_heights;
+    static std::map<std::pair<PerfAlgo, size_t>, Intensity> m_intensities;
+    static std::map<std::string, Measured> m_measured;
+    static std::string m_fileName;
+};
+
+
+} /* namespace xmrig */
+
+
+#endif /* XMRIG_RUNTIMESTATE_H */
@@ -0,0 +1,126 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <atomic>
+#include <mutex>
+#include <stdio.h>
+
+
+#include "common/log/Log.h"
+#include "common/utils/timestamp.h"
+#include "core/StartupProfile.h"
+
+
+namespace xmrig {
+
+
+static int64_t startTime = 0;
+static int64_t totalTime = -1;
+static std::atomic<bool> finished(false);
+static std::mutex mutex;
+static std::vector<StartupProfile::Phase> timeline;
+
+
+} /* namespace xmrig */
+
+
+xmrig::StartupProfile::Scope::Scope(const std::string &name, int gpu) :
+    m_gpu(gpu),
+    m_start(steadyTimestamp()),
+    m_name(name)
+{
+}
+
+
+xmrig::StartupProfile::Scope::~Scope()
+{
+    add(m_name, m_gpu, m_start, steadyTimestamp());
+}
+
+
+bool xmrig::StartupProfile::isFinished()
+{
+    return finished.load(std::memory_order_relaxed);
+}
+
+
+int64_t xmrig::StartupProfile::total()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return totalTime;
+}
+
+
+std::vector<xmrig::StartupProfile::Phase> xmrig::StartupProfile::phases()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return timeline;
+}
+
+
+void xmrig::StartupProfile::add(const std::string &name, int gpu, int64_t start, int64_t finish)
+{
+    if (isFinished()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    timeline.push_back({ name, gpu, start - startTime, finish - start });
+}
+
+
+// called on the first pool job, prints the timeline once and stops recording
+void xmrig::StartupProfile::finish(bool colors)
+{
+    if (finished.exchange(true)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    totalTime = steadyTimestamp() - startTime;
+
+    LOG_INFO(colors ? WHITE_BOLD("startup") " first job after " CYAN_BOLD("%.3fs") : "startup first job after %.3fs", totalTime / 1000.0);
+
+    for (const Phase &phase : timeline) {
+        char name[64];
+        if (phase.gpu >= 0) {
+            snprintf(name, sizeof(name), "%s GPU #%d", phase.name.c_str(), phase.gpu);
+        }
+        else {
+            snprintf(name, sizeof(name), "%s", phase.name.c_str());
+        }
+
+        LOG_INFO(colors ? WHITE_BOLD("startup") " %-24s at " WHITE_BOLD("%7.3fs") " took " CYAN_BOLD("%7.3fs") : "startup %-24s at %7.3fs took %7.3fs",
+                 name, phase.start / 1000.0, phase.duration / 1000.0);
+    }
+}
+
+
+void xmrig::StartupProfile::init()
+{
+    startTime = steadyTimestamp();
+}
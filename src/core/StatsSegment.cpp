@@ -0,0 +1,186 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <chrono>
+#include <errno.h>
+#include <string>
+#include <string.h>
+
+
+#ifdef _WIN32
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+
+#include "common/log/Log.h"
+#include "core/StatsSegment.h"
+
+
+namespace xmrig {
+
+
+constexpr size_t StatsSegment::kMaxThreads;
+constexpr size_t StatsSegment::kMaxDevices;
+StatsSegment::Header *StatsSegment::m_header = nullptr;
+uint64_t StatsSegment::m_accepted            = 0;
+uint64_t StatsSegment::m_rejected            = 0;
+uint64_t StatsSegment::m_totalDiff           = 0;
+
+
+static const size_t kSegmentSize = sizeof(StatsSegment::Header) + sizeof(StatsSegment::Data);
+
+
+#ifdef _WIN32
+static HANDLE mapping = nullptr;
+#else
+static std::string shmName;
+#endif
+
+
+static inline StatsSegment::Data *segmentData(StatsSegment::Header *header)
+{
+    return reinterpret_cast<StatsSegment::Data *>(header + 1);
+}
+
+
+} /* namespace xmrig */
+
+
+bool xmrig::StatsSegment::open(const char *name)
+{
+    if (!name || !*name || m_header) {
+        return m_header != nullptr;
+    }
+
+#   ifdef _WIN32
+    mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, static_cast<DWORD>(kSegmentSize), name);
+    void *mem = mapping ? MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, kSegmentSize) : nullptr;
+
+    if (!mem) {
+        LOG_ERR("stats segment \"%s\" unavailable, error %lu", name, GetLastError());
+
+        if (mapping) {
+            CloseHandle(mapping);
+            mapping = nullptr;
+        }
+
+        return false;
+    }
+#   else
+    // POSIX names start with a slash, "xmrig" and "/xmrig" are the same object
+    shmName = name[0] == '/' ? name : std::string("/") + name;
+
+    const int fd = shm_open(shmName.c_str(), O_CREAT | O_RDWR, 0644);
+    void *mem    = MAP_FAILED;
+
+    if (fd >= 0) {
+        if (ftruncate(fd, static_cast<off_t>(kSegmentSize)) == 0) {
+            mem = mmap(nullptr, kSegmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+
+        ::close(fd);
+    }
+
+    if (mem == MAP_FAILED) {
+        LOG_ERR("stats segment \"%s\" unavailable: \"%s\"", shmName.c_str(), strerror(errno));
+
+        if (fd >= 0) {
+            shm_unlink(shmName.c_str());
+        }
+
+        return false;
+    }
+#   endif
+
+    // the magic goes last, a reader which opens the segment meanwhile sees a wrong magic and retries
+    m_header = static_cast<Header *>(mem);
+    memset(segmentData(m_header), 0, sizeof(Data));
+    m_header->sequence.store(0, std::memory_order_relaxed);
+    m_header->size    = static_cast<uint32_t>(kSegmentSize);
+    m_header->version = kVersion;
+    std::atomic_thread_fence(std::memory_order_release);
+    m_header->magic   = kMagic;
+
+    LOG_INFO("stats segment \"%s\" ready, %zu bytes", name, kSegmentSize);
+    return true;
+}
+
+
+void xmrig::StatsSegment::publish(Data &data)
+{
+    if (!m_header) {
+        return;
+    }
+
+    data.updated   = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+    data.accepted  = m_accepted;
+    data.rejected  = m_rejected;
+    data.totalDiff = m_totalDiff;
+
+    // seqlock writer, the fences keep the copy between the two sequence stores
+    const uint32_t sequence = m_header->sequence.load(std::memory_order_relaxed);
+    m_header->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    memcpy(segmentData(m_header), &data, sizeof(Data));
+
+    std::atomic_thread_fence(std::memory_order_release);
+    m_header->sequence.store(sequence + 2, std::memory_order_relaxed);
+}
+
+
+void xmrig::StatsSegment::release()
+{
+    if (!m_header) {
+        return;
+    }
+
+    // readers still holding the mapping see a zero magic
+    m_header->magic = 0;
+
+#   ifdef _WIN32
+    UnmapViewOfFile(m_header);
+    CloseHandle(mapping);
+    mapping = nullptr;
+#   else
+    munmap(m_header, kSegmentSize);
+    shm_unlink(shmName.c_str());
+#   endif
+
+    m_header = nullptr;
+}
+
+
+void xmrig::StatsSegment::setShares(uint64_t accepted, uint64_t rejected, uint64_t totalDiff)
+{
+    m_accepted  = accepted;
+    m_rejected  = rejected;
+    m_totalDiff = totalDiff;
+}
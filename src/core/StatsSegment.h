@@ -0,0 +1,133 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_STATSSEGMENT_H
+#define XMRIG_STATSSEGMENT_H
+
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+
+namespace xmrig {
+
+
+// shared memory copy of the miner stats for local monitoring agents (--stats-shm), a POSIX shm object
+// or a named file mapping on Windows. The segment is a Header followed by Data, readers map it read only,
+// check magic and version, then copy Data while sequence is even and the same before and after the copy
+// (a seqlock), so the miner never waits for a reader. Everything is called from the uv loop, Workers publishes
+// once per second.
+class StatsSegment
+{
+public:
+    constexpr static uint32_t kMagic    = 0x5352584d; // "MXRS"
+    constexpr static uint32_t kVersion  = 2;
+    constexpr static size_t kMaxThreads = 256;
+    constexpr static size_t kMaxDevices = 128;
+
+    enum MinerState : uint32_t {
+        MinerPaused   = 1, // no job or the user paused mining
+        MinerParked   = 2, // GPUs parked by --park-after
+        MinerDisabled = 4  // workers disabled by the API or the pause key
+    };
+
+    enum ThreadState : uint32_t {
+        ThreadStopped = 1  // watchdog gave up on the thread
+    };
+
+    enum DeviceState : uint32_t {
+        DeviceDisabled  = 1, // stopped by --verify-error-action
+        DeviceThrottled = 2  // held by --temp-target or --power-target
+    };
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t size;                  // size of the whole segment
+        std::atomic<uint32_t> sequence; // odd while Data is written
+    };
+
+    // hashrates are 10s/60s/15m in H/s, 0 until the interval is covered, CPU threads have device 0xFFFFFFFF
+    struct Thread
+    {
+        uint32_t device;
+        uint32_t state;
+        uint64_t hashes;
+        double hashrate[3];
+    };
+
+    // sensors are negative if unknown, duty is in 1/1000
+    struct Device
+    {
+        uint32_t index;
+        uint32_t state;
+        double hashrate[3];
+        double temperature;
+        double power;
+        int32_t fan;
+        int32_t clock;
+        int32_t memoryClock;
+        uint32_t duty;
+        uint64_t computeErrors;
+        uint64_t rejected;
+    };
+
+    struct Data
+    {
+        uint64_t updated; // ms since the epoch
+        uint32_t state;
+        uint32_t algo;    // perf algo, see xmrig::PerfAlgo
+        uint32_t threads;
+        uint32_t devices;
+        double hashrate[3];
+        double highest;
+        uint64_t accepted;
+        uint64_t rejected;
+        uint64_t totalDiff;
+        Thread thread[kMaxThreads];
+        Device device[kMaxDevices];
+    };
+
+    static inline bool isOpen() { return m_header != nullptr; }
+
+    static bool open(const char *name);
+    // the share counters of the network are kept until the next publish, which fills them in
+    static void publish(Data &data);
+    static void release();
+    static void setShares(uint64_t accepted, uint64_t rejected, uint64_t totalDiff);
+
+private:
+    static Header *m_header;
+    static uint64_t m_accepted;
+    static uint64_t m_rejected;
+    static uint64_t m_totalDiff;
+};
+
+
+} /* namespace xmrig */
+
+
+#endif /* XMRIG_STATSSEGMENT_H */
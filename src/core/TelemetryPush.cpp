@@ -0,0 +1,389 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#if _WIN32
+#   include "winsock2.h"
+#else
+#   include "unistd.h"
+#endif
+
+
+#include "amd/GpuTelemetry.h"
+#include "common/crypto/Algorithm.h"
+#include "common/log/Log.h"
+#include "core/Config.h"
+#include "core/Controller.h"
+#include "core/TelemetryPush.h"
+#include "workers/Hashrate.h"
+#include "workers/Workers.h"
+
+
+xmrig::NetworkState xmrig::TelemetryPush::m_network;
+
+
+static inline double normalize(double d)
+{
+    if (!isnormal(d)) {
+        return 0.0;
+    }
+
+    return floor(d * 100.0) / 100.0;
+}
+
+
+// statsd has no tags, anything but a plain name part would split or break the metric name,
+// influx tag values only need the separators escaped
+static std::string escape(const char *value, bool influx)
+{
+    std::string out;
+
+    for (const char *p = value; *p; ++p) {
+        if (influx) {
+            if (*p == ',' || *p == ' ' || *p == '=') {
+                out += '\\';
+            }
+
+            out += *p;
+            continue;
+        }
+
+        const bool plain = (*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') || (*p >= '0' && *p <= '9') || *p == '-' || *p == '_';
+        out += plain ? *p : '_';
+    }
+
+    return out;
+}
+
+
+xmrig::TelemetryPush::TelemetryPush(Controller *controller) :
+    m_ready(false),
+    m_resolving(false),
+    m_controller(controller),
+    m_format(Statsd),
+    m_port(0),
+    m_pushes(0),
+    m_switches(),
+    m_accepted(0),
+    m_rejected(0)
+{
+    memset(&m_addr, 0, sizeof(m_addr));
+
+    m_resolver.data = this;
+    m_timer.data    = this;
+
+    uv_timer_init(uv_default_loop(), &m_timer);
+    uv_udp_init(uv_default_loop(), &m_udp);
+
+    if (!parseUrl(controller->config()->pushUrl())) {
+        LOG_ERR("push url \"%s\" is not supported, expected statsd://host:port or influx://host:port", controller->config()->pushUrl());
+        return;
+    }
+
+    char hostname[64] = { 0 };
+    const char *id = controller->config()->apiWorkerId();
+    if (!id || strlen(id) == 0) {
+        gethostname(hostname, sizeof(hostname) - 1);
+        id = hostname;
+    }
+
+    m_worker = escape(id, m_format == Influx);
+
+    resolve();
+
+    const uint64_t interval = controller->config()->pushInterval() * 1000ull;
+    uv_timer_start(&m_timer, TelemetryPush::onTimer, interval, interval);
+}
+
+
+xmrig::TelemetryPush::~TelemetryPush()
+{
+    uv_timer_stop(&m_timer);
+}
+
+
+// copy of the state of the main pool, posted by Network every second
+void xmrig::TelemetryPush::setNetwork(const NetworkState &state)
+{
+    m_network = state;
+}
+
+
+bool xmrig::TelemetryPush::parseUrl(const char *url)
+{
+    static const char kStatsd[] = "statsd://";
+    static const char kInflux[] = "influx://";
+
+    if (!url) {
+        return false;
+    }
+
+    const char *begin = nullptr;
+    if (strncmp(url, kStatsd, sizeof(kStatsd) - 1) == 0) {
+        begin    = url + sizeof(kStatsd) - 1;
+        m_format = Statsd;
+    }
+    else if (strncmp(url, kInflux, sizeof(kInflux) - 1) == 0) {
+        begin    = url + sizeof(kInflux) - 1;
+        m_format = Influx;
+    }
+    else {
+        return false;
+    }
+
+    m_host = begin;
+
+    const size_t colon = m_host.rfind(':');
+    if (colon == std::string::npos) {
+        return false;
+    }
+
+    const unsigned long value = strtoul(m_host.c_str() + colon + 1, nullptr, 10);
+    if (value == 0 || value > 65535) {
+        return false;
+    }
+
+    m_port = static_cast<uint16_t>(value);
+    m_host.resize(colon);
+
+    // [::1]:8125
+    if (m_host.size() > 2 && m_host.front() == '[' && m_host.back() == ']') {
+        m_host = m_host.substr(1, m_host.size() - 2);
+    }
+
+    return !m_host.empty();
+}
+
+
+// one metric line, the datagram is sent first when the line would not fit anymore
+void xmrig::TelemetryPush::add(const char *format, ...)
+{
+    char buf[512];
+
+    va_list args;
+    va_start(args, format);
+    const int size = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+
+    if (size <= 0 || static_cast<size_t>(size) >= sizeof(buf)) {
+        return;
+    }
+
+    if (!m_packet.empty() && m_packet.size() + 1 + static_cast<size_t>(size) > kMaxPacket) {
+        flush();
+    }
+
+    if (!m_packet.empty()) {
+        m_packet += '\n';
+    }
+
+    m_packet.append(buf, static_cast<size_t>(size));
+}
+
+
+// a full socket buffer drops the datagram like the network would, other errors resolve the host again
+void xmrig::TelemetryPush::flush()
+{
+    if (m_packet.empty()) {
+        return;
+    }
+
+    uv_buf_t buf = uv_buf_init(&m_packet[0], static_cast<unsigned int>(m_packet.size()));
+
+    const int r = uv_udp_try_send(&m_udp, &buf, 1, reinterpret_cast<const sockaddr*>(&m_addr));
+    if (r < 0 && r != UV_EAGAIN && m_ready) {
+        LOG_ERR("push \"%s\" send error: \"%s\"", m_controller->config()->pushUrl(), uv_strerror(r));
+        m_ready = false;
+    }
+
+    m_packet.clear();
+}
+
+
+// statsd counters are deltas since the previous push, influx fields are the running totals
+void xmrig::TelemetryPush::push()
+{
+    const char *w          = m_worker.c_str();
+    const Hashrate *hr     = Workers::hashrate();
+    const bool influx      = m_format == Influx;
+    const uint64_t submits = m_network.submits();
+
+    const double total = hr ? normalize(hr->calc(Hashrate::ShortInterval)) : 0.0;
+    if (influx) {
+        std::string latency;
+        if (submits) {
+            char buf[96];
+            snprintf(buf, sizeof(buf), ",latency_p50=%ui,latency_p90=%ui,latency_p99=%ui", m_network.latency(50, true), m_network.latency(90, true), m_network.latency(99, true));
+            latency = buf;
+        }
+
+        add("xmrig,worker=%s hashrate=%.2f,accepted=%" PRIu64 "i,rejected=%" PRIu64 "i,difficulty=%" PRIu64 "i,failures=%" PRIu64 "i%s",
+            w, total, m_network.accepted, m_network.rejected, m_network.total, m_network.failures, latency.c_str());
+    }
+    else {
+        add("xmrig.%s.hashrate:%.2f|g", w, total);
+        add("xmrig.%s.shares.accepted:%" PRIu64 "|c", w, m_network.accepted - m_accepted);
+        add("xmrig.%s.shares.rejected:%" PRIu64 "|c", w, m_network.rejected - m_rejected);
+
+        if (submits) {
+            add("xmrig.%s.latency.p50:%u|g", w, m_network.latency(50, true));
+            add("xmrig.%s.latency.p90:%u|g", w, m_network.latency(90, true));
+            add("xmrig.%s.latency.p99:%u|g", w, m_network.latency(99, true));
+        }
+    }
+
+    m_accepted = m_network.accepted;
+    m_rejected = m_network.rejected;
+
+    if (hr) {
+        const Hashrate::AlgoHistory history = hr->history(hr->algo());
+
+        for (const auto &device : history.devices) {
+            const GpuSensors sensors = GpuTelemetry::sensors(device.first);
+            const double hashrate    = normalize(device.second.values[0]);
+
+            if (influx) {
+                char fields[96] = { 0 };
+                int size = 0;
+
+                if (sensors.temperature >= 0.0) {
+                    size += snprintf(fields + size, sizeof(fields) - size, ",temperature=%.1f", sensors.temperature);
+                }
+
+                if (sensors.power >= 0.0) {
+                    snprintf(fields + size, sizeof(fields) - size, ",power=%.2f", sensors.power);
+                }
+
+                add("xmrig_gpu,worker=%s,gpu=%zu hashrate=%.2f%s", w, device.first, hashrate, fields);
+                continue;
+            }
+
+            add("xmrig.%s.gpu.%zu.hashrate:%.2f|g", w, device.first, hashrate);
+
+            if (sensors.temperature >= 0.0) {
+                add("xmrig.%s.gpu.%zu.temperature:%.1f|g", w, device.first, sensors.temperature);
+            }
+
+            if (sensors.power >= 0.0) {
+                add("xmrig.%s.gpu.%zu.power:%.2f|g", w, device.first, sensors.power);
+            }
+        }
+    }
+
+    for (int from = 0; from < xmrig::PerfAlgo::PA_MAX; ++from) {
+        for (int to = 0; to < xmrig::PerfAlgo::PA_MAX; ++to) {
+            const uint32_t count = Workers::switches(static_cast<xmrig::PerfAlgo>(from), static_cast<xmrig::PerfAlgo>(to));
+            if (count == m_switches[from][to]) {
+                continue;
+            }
+
+            const std::string a = escape(xmrig::Algorithm::perfAlgoName(static_cast<xmrig::PerfAlgo>(from)), influx);
+            const std::string b = escape(xmrig::Algorithm::perfAlgoName(static_cast<xmrig::PerfAlgo>(to)), influx);
+
+            if (influx) {
+                add("xmrig_switches,worker=%s,from=%s,to=%s count=%ui", w, a.c_str(), b.c_str(), count);
+            }
+            else {
+                add("xmrig.%s.switches.%s.%s:%u|c", w, a.c_str(), b.c_str(), count - m_switches[from][to]);
+            }
+
+            m_switches[from][to] = count;
+        }
+    }
+
+    flush();
+}
+
+
+void xmrig::TelemetryPush::resolve()
+{
+    if (m_resolving) {
+        return;
+    }
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    char port[8];
+    snprintf(port, sizeof(port), "%u", m_port);
+
+    const int r = uv_getaddrinfo(uv_default_loop(), &m_resolver, TelemetryPush::onResolved, m_host.c_str(), port, &hints);
+    if (r < 0) {
+        LOG_ERR("push \"%s\" getaddrinfo error: \"%s\"", m_host.c_str(), uv_strerror(r));
+        return;
+    }
+
+    m_resolving = true;
+}
+
+
+// the host is resolved again every kResolveEvery pushes, so a collector that moved is followed without a restart
+void xmrig::TelemetryPush::tick()
+{
+    if (!m_ready || ++m_pushes % kResolveEvery == 0) {
+        resolve();
+    }
+
+    if (m_ready) {
+        push();
+    }
+}
+
+
+void xmrig::TelemetryPush::onResolved(uv_getaddrinfo_t *req, int status, struct addrinfo *res)
+{
+    TelemetryPush *self = static_cast<TelemetryPush*>(req->data);
+    self->m_resolving   = false;
+
+    if (status < 0) {
+        LOG_ERR("push \"%s\" DNS error: \"%s\"", self->m_host.c_str(), uv_strerror(status));
+        return;
+    }
+
+    // the socket is bound by the first send, it keeps the family of the first address
+    const int family = self->m_addr.ss_family;
+
+    for (addrinfo *ai = res; ai; ai = ai->ai_next) {
+        if ((family == AF_UNSPEC || ai->ai_family == family) && ai->ai_addrlen <= sizeof(self->m_addr)) {
+            memcpy(&self->m_addr, ai->ai_addr, ai->ai_addrlen);
+            self->m_ready = true;
+            break;
+        }
+    }
+
+    uv_freeaddrinfo(res);
+}
+
+
+void xmrig::TelemetryPush::onTimer(uv_timer_t *handle)
+{
+    static_cast<TelemetryPush*>(handle->data)->tick();
+}
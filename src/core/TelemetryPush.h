@@ -0,0 +1,98 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_TELEMETRYPUSH_H
+#define XMRIG_TELEMETRYPUSH_H
+
+
+#include <stdint.h>
+#include <string>
+#include <uv.h>
+
+
+#include "api/NetworkState.h"
+#include "common/xmrig.h"
+
+
+namespace xmrig {
+
+
+class Controller;
+
+
+// aggregated metrics pushed over UDP every push-interval seconds for rigs the collector can't poll,
+// statsd://host:port sends gauges and counter deltas, influx://host:port sends the InfluxDB line protocol,
+// lines are batched into datagrams below the usual MTU, a lost datagram is only a gap in the series
+class TelemetryPush
+{
+public:
+    TelemetryPush(Controller *controller);
+    ~TelemetryPush();
+
+    static void setNetwork(const NetworkState &state);
+
+private:
+    constexpr static const size_t kMaxPacket     = 1400;
+    constexpr static const uint32_t kResolveEvery = 60;
+
+    enum Format {
+        Statsd,
+        Influx
+    };
+
+    bool parseUrl(const char *url);
+    void add(const char *format, ...);
+    void flush();
+    void push();
+    void resolve();
+    void tick();
+
+    static void onResolved(uv_getaddrinfo_t *req, int status, struct addrinfo *res);
+    static void onTimer(uv_timer_t *handle);
+
+    static NetworkState m_network;
+
+    bool m_ready;
+    bool m_resolving;
+    Controller *m_controller;
+    Format m_format;
+    sockaddr_storage m_addr;
+    std::string m_host;
+    std::string m_packet;
+    std::string m_worker;
+    uint16_t m_port;
+    uint32_t m_pushes;
+    uint32_t m_switches[xmrig::PerfAlgo::PA_MAX][xmrig::PerfAlgo::PA_MAX];
+    uint64_t m_accepted;
+    uint64_t m_rejected;
+    uv_getaddrinfo_t m_resolver;
+    uv_timer_t m_timer;
+    uv_udp_t m_udp;
+};
+
+
+} /* namespace xmrig */
+
+
+#endif /* XMRIG_TELEMETRYPUSH_H */
@@ -0,0 +1,263 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+
+#include "common/log/Log.h"
+#include "core/Trace.h"
+#include "rapidjson/filewritestream.h"
+#include "rapidjson/writer.h"
+
+
+namespace xmrig {
+
+
+struct TraceEvent
+{
+    const char *name;
+    int64_t start;
+    int64_t duration;
+    int64_t arg;
+};
+
+
+// written only by the owner thread, flush() reads the events below head
+struct TraceBuffer
+{
+    constexpr static const size_t kSize = 8192;
+
+    inline TraceBuffer(int tid) : tid(tid), head(0), owned(true) {}
+
+    const int tid;
+    std::atomic<uint64_t> head;
+    std::atomic<bool> owned;
+    std::string name;
+    TraceEvent events[kSize];
+};
+
+
+// the buffer of an exited thread is reused by the next new thread, its events are kept
+struct TraceOwner
+{
+    inline ~TraceOwner() { if (buffer) { buffer->owned.store(false, std::memory_order_release); } }
+
+    TraceBuffer *buffer = nullptr;
+};
+
+
+static std::mutex mutex;
+static std::string fileName;
+static std::vector<TraceBuffer *> buffers;
+static thread_local TraceOwner owner;
+
+
+static TraceBuffer *localBuffer()
+{
+    if (owner.buffer) {
+        return owner.buffer;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (TraceBuffer *buffer : buffers) {
+        if (!buffer->owned.load(std::memory_order_acquire)) {
+            buffer->owned.store(true, std::memory_order_relaxed);
+            owner.buffer = buffer;
+
+            return buffer;
+        }
+    }
+
+    owner.buffer = new TraceBuffer(static_cast<int>(buffers.size()) + 1);
+    buffers.push_back(owner.buffer);
+
+    return owner.buffer;
+}
+
+
+} /* namespace xmrig */
+
+
+std::atomic<bool> xmrig::Trace::m_enabled(false);
+
+
+// events overwritten while they were copied are skipped
+bool xmrig::Trace::flush()
+{
+    if (!isEnabled()) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    FILE *fp = fopen(fileName.c_str(), "wb");
+    if (!fp) {
+        LOG_ERR("unable to write trace file \"%s\"", fileName.c_str());
+        return false;
+    }
+
+    char buf[65536];
+    rapidjson::FileWriteStream os(fp, buf, sizeof(buf));
+    rapidjson::Writer<rapidjson::FileWriteStream> writer(os);
+
+    writer.StartObject();
+    writer.Key("displayTimeUnit");
+    writer.String("ms");
+    writer.Key("traceEvents");
+    writer.StartArray();
+
+    size_t count = 0;
+    std::vector<TraceEvent> events;
+
+    for (TraceBuffer *buffer : buffers) {
+        if (!buffer->name.empty()) {
+            writer.StartObject();
+            writer.Key("name");
+            writer.String("thread_name");
+            writer.Key("ph");
+            writer.String("M");
+            writer.Key("pid");
+            writer.Int(1);
+            writer.Key("tid");
+            writer.Int(buffer->tid);
+            writer.Key("args");
+            writer.StartObject();
+            writer.Key("name");
+            writer.String(buffer->name.c_str());
+            writer.EndObject();
+            writer.EndObject();
+        }
+
+        const uint64_t head  = buffer->head.load(std::memory_order_acquire);
+        const uint64_t first = head > TraceBuffer::kSize ? head - TraceBuffer::kSize : 0;
+
+        events.clear();
+        for (uint64_t i = first; i < head; ++i) {
+            events.push_back(buffer->events[i & (TraceBuffer::kSize - 1)]);
+        }
+
+        const uint64_t last  = buffer->head.load(std::memory_order_acquire);
+        const uint64_t valid = last >= TraceBuffer::kSize ? last - TraceBuffer::kSize + 1 : 0;
+
+        for (uint64_t i = first; i < head; ++i) {
+            if (i < valid) {
+                continue;
+            }
+
+            const TraceEvent &event = events[i - first];
+
+            writer.StartObject();
+            writer.Key("name");
+            writer.String(event.name);
+            writer.Key("ph");
+            writer.String("X");
+            writer.Key("pid");
+            writer.Int(1);
+            writer.Key("tid");
+            writer.Int(buffer->tid);
+            writer.Key("ts");
+            writer.Int64(event.start);
+            writer.Key("dur");
+            writer.Int64(event.duration);
+
+            if (event.arg >= 0) {
+                writer.Key("args");
+                writer.StartObject();
+                writer.Key("arg");
+                writer.Int64(event.arg);
+                writer.EndObject();
+            }
+
+            writer.EndObject();
+            count++;
+        }
+    }
+
+    writer.EndArray();
+    writer.EndObject();
+    os.Flush();
+    fclose(fp);
+
+    LOG_INFO("trace of %zu events written to \"%s\"", count, fileName.c_str());
+
+    return true;
+}
+
+
+// steady clock in microseconds
+int64_t xmrig::Trace::now()
+{
+    using namespace std::chrono;
+
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+void xmrig::Trace::add(const char *name, int64_t start, int64_t duration, int64_t arg)
+{
+    if (!isEnabled()) {
+        return;
+    }
+
+    TraceBuffer *buffer = localBuffer();
+    const uint64_t pos  = buffer->head.load(std::memory_order_relaxed);
+
+    TraceEvent &event = buffer->events[pos & (TraceBuffer::kSize - 1)];
+    event.name     = name;
+    event.start    = start;
+    event.duration = duration;
+    event.arg      = arg;
+
+    buffer->head.store(pos + 1, std::memory_order_release);
+}
+
+
+void xmrig::Trace::init(const char *file)
+{
+    if (!file || !*file) {
+        return;
+    }
+
+    fileName = file;
+    m_enabled.store(true, std::memory_order_relaxed);
+}
+
+
+void xmrig::Trace::setThreadName(const char *name)
+{
+    if (!isEnabled()) {
+        return;
+    }
+
+    TraceBuffer *buffer = localBuffer();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    buffer->name = name;
+}
@@ -0,0 +1,69 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_TRACE_H
+#define XMRIG_TRACE_H
+
+
+#include <atomic>
+#include <stdint.h>
+
+
+namespace xmrig {
+
+
+// optional span tracer written in Chrome trace JSON (chrome://tracing, ui.perfetto.dev),
+// every thread records into its own ring, so only the newest events of each thread are kept
+class Trace
+{
+public:
+    class Span
+    {
+    public:
+        inline Span(const char *name, int64_t arg = -1) : m_name(name), m_arg(arg), m_start(isEnabled() ? now() : -1) {}
+        inline ~Span() { if (m_start >= 0) { add(m_name, m_start, now() - m_start, m_arg); } }
+
+    private:
+        const char *m_name;
+        const int64_t m_arg;
+        const int64_t m_start;
+    };
+
+    static inline bool isEnabled() { return m_enabled.load(std::memory_order_relaxed); }
+
+    static bool flush();
+    static int64_t now();
+    static void add(const char *name, int64_t start, int64_t duration, int64_t arg = -1);
+    static void init(const char *fileName);
+    static void setThreadName(const char *name);
+
+private:
+    static std::atomic<bool> m_enabled;
+};
+
+
+} /* namespace xmrig */
+
+
+#endif /* XMRIG_TRACE_H */
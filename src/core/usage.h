@@ -47,7 +47,62 @@ Options:\n\
 #endif
 "\
   --calibrate-algo             run benchmarks before mining to measure hashrates of all supported algos\n\
-  --calibrate-algo-time=N      time in seconds to run each algo benchmark round (default: 60)\n\
+  --calibrate-algo-time=N      maximal time in seconds to run each algo benchmark round (default: 60)\n\
+      --recalibrate-algo       update algo-perf from the hashrate measured during mining\n\
+      --autotune               search the best threads settings of each GPU for all algos before mining\n\
+      --autotune-time=N        time in seconds to run each autotune round (default: 10)\n\
+      --autotune-power         also tune the power cap of each GPU for the most hashes per joule (Linux, needs root)\n\
+      --stress                 ramp up the intensity of each GPU with all results verified and keep the highest error-free one\n\
+      --stress-time=N          time in seconds to run each stress step (default: 30)\n\
+      --report-devices         report algo-perf of each GPU to the pool in addition to the rig one\n\
+      --bench=ALGOS            benchmark comma separated perf algos (or all) without pool, print report and exit\n\
+      --bench-format=F         report format of --bench: json (default) or csv\n\
+      --test-switch            mine scripted algo and job changes of a local mock pool, print switch latencies and exit\n\
+      --record-session=FILE    record jobs and share results of the pool session to FILE\n\
+      --replay-session=FILE    mine the jobs of a recorded session on a local mock pool, print effective hashrate and exit\n\
+      --replay-speed=N         replay N times faster than recorded (default: 1)\n\
+      --handover=PID           prepare everything but the GPUs, then stop the miner process PID and take over its GPUs\n\
+      --opencl-cache-export=F  write OpenCL cache binaries to bundle file F and exit\n\
+      --opencl-cache-merge=F   add OpenCL cache binaries to bundle file F keeping the ones of other GPUs and drivers, and exit\n\
+      --opencl-cache-import=F  import OpenCL cache binaries from bundle file F at startup\n\
+      --opencl-source=DIR      kernel sources in DIR replace the embedded ones of the same name\n\
+      --verify-threads=N       number of CPU threads to verify GPU results (default: 2)\n\
+      --verify-affinity=MASK   CPU affinity mask of verification threads\n\
+      --auto-affinity          pin GPU threads to CPUs of the NUMA node of their GPU and verification threads to the other CPUs\n\
+      --gpu-priority=N         priority of GPU host threads from 0 (idle) to 5 (highest), \"priority\" of a thread overrides it (default: 3)\n\
+      --verify-priority=N      priority of verification threads from 0 (idle) to 5 (highest) (default: 2)\n\
+      --verify-sample=N        submit GPU hashes and verify every Nth result on CPU (default: 1, verify all)\n\
+      --verify-error-threshold=N  error rate in percent to fall back to full verification (default: 5)\n\
+      --verify-gpu=N           verify cn/gpu results on GPU N, CPU verification only on disagreement or every 32nd result\n\
+      --error-action=A         none (default), intensity or disable a GPU thread whose error rate is above the threshold\n\
+      --idle-work=W            none (default), calibrate or autotune the pool perf algos while no pool is reachable, a pool job interrupts it\n\
+      --batch-split=N          split every GPU batch into N launches to pick up new jobs sooner (default: 1)\n\
+      --tdr-limit=N            run cn1 in chunks of at most N ms GPU time to stay below the driver watchdog (default: 0, off)\n\
+      --stale-target=N         shrink GPU batches to keep expected stale work below N percent (default: 0, off)\n\
+      --min-submit-diff=N      GPUs report only shares of at least difficulty N, above the pool one (default: 0, off)\n\
+      --temp-target=N          pause GPUs between batches to hold their temperature at N C (default: 0, off)\n\
+      --power-target=N         pause GPUs between batches to hold their board power at N W (default: 0, off)\n\
+      --desktop-duty=N         while the desktop is in use, give GPUs at most N%% of the time in short batches (default: 0, off)\n\
+      --desktop-idle=N         seconds without input or other GPU clients before GPUs return to full duty (default: 60)\n\
+      --park-after=N           release GPU memory after N minutes without pools, allocate it again with the next job (default: 0, off)\n\
+      --algo-min-dwell=N       seconds an algo should be mined after a switch, reported to the pool with the measured switch costs (default: 0, 20 times the highest cost)\n\
+      --stratum-port=N         serve the upstream job to other rigs of the site on local stratum port N (default: 0, off)\n\
+      --trace-file=F           record a Chrome trace of the mining pipeline, written to F on 't' key and exit\n\
+      --fleet-url=URL          pull config and GPU profiles from http://URL and report applied version and hashrate to it\n\
+      --fleet-interval=N       seconds between two fleet config pulls (default: 300)\n\
+      --profit-url=URL         pull the value of a hash of each perf algo from http://URL for --pool-strategy=profit\n\
+      --profit-interval=N      seconds between two profit pulls (default: 60)\n\
+      --push-url=URL           push metrics over UDP to statsd://HOST:PORT or influx://HOST:PORT\n\
+      --push-interval=N        seconds between two metric pushes (default: 10)\n\
+      --stats-shm=NAME         publish hashrate, shares, sensors and state once per second in shared memory NAME for local agents\n\
+      --state-file=F           keep algo-perf, GPU intensities lowered by --error-action and CryptonightR heights in F across restarts\n\
+      --canary-window=N        seconds of one A/B comparison of GPU threads labelled \"canary\" (default: 1800)\n\
+      --diagnostics            measure PCIe transfers, memory copies and a verified run of each GPU before mining\n\
+      --derive-threads         derive the missing threads of a perf algo from the configured threads of another one\n\
+      --net-thread             run the pool connections on a thread of their own, shares are submitted without waiting for the API or the console\n\
+      --cpu-threads=N          number of CPU threads mining next to the GPUs (default: 0, off)\n\
+      --cpu-affinity=MASK      CPU affinity mask of CPU mining threads\n\
+      --1gb-pages              use 1 GB huge pages for CPU scratchpads, every CPU and verification thread takes a page\n\
   -o, --url=URL                URL of mining server\n\
   -O, --userpass=U:P           username:password pair for mining server\n\
   -u, --user=USERNAME          username for mining server\n\
@@ -59,6 +114,8 @@ Options:\n\
       --tls-fingerprint=F      pool TLS certificate fingerprint, if set enable strict certificate pinning\n\
   -r, --retries=N              number of times to retry before switch to backup server (default: 5)\n\
   -R, --retry-pause=N          time to pause between retries (default: 5)\n\
+      --pool-standby=N         keep N next backup pools logged in for instant failover (default: 0)\n\
+      --pool-strategy=S        failover, latency (fastest pool of the best \"priority\" group) or weighted (GPU time split by pool \"weight\") or profit (most valuable job by algo-perf and --profit-url) (default: failover)\n\
       --opencl-devices=N       list of OpenCL devices to use.\n\
       --opencl-launch=IxW      list of launch config, intensity and worksize\n\
       --opencl-strided-index=N list of strided_index option values for each thread\n\
@@ -67,6 +124,11 @@ Options:\n\
       --opencl-affinity=N      list of affinity GPU threads to a CPU\n\
       --opencl-platform=N      OpenCL platform index\n\
       --opencl-loader=N        path to OpenCL-ICD-Loader (OpenCL.dll or libOpenCL.so)\n\
+      --opencl-profiling       measure GPU time of each kernel, available in API /1/threads\n\
+      --opencl-specialize      build OpenCL programs with only the kernels of the current algorithm\n\
+      --opencl-device-contexts one OpenCL context for each GPU instead of one for all of them\n\
+      --opencl-low-cpu         sleep while the GPU works instead of busy waiting in the driver, host CPU usage is in API /1/threads\n\
+      --opencl-trace=N         count and time OpenCL calls, log calls slower than N ms, available in API /1/opencl (default: 0, off)\n\
       --print-platforms        print available OpenCL platforms and exit\n\
       --no-cache               disable OpenCL cache\n\
       --no-color               disable colored output\n\
@@ -75,7 +137,10 @@ Options:\n\
       --user-agent             set custom user-agent string for pool\n\
   -B, --background             run the miner in the background\n\
   -c, --config=FILE            load a JSON-format configuration file\n\
-  -l, --log-file=FILE          log all output to a file\n"
+  -l, --log-file=FILE          log all output to a file\n\
+      --log-async              write log output from the main loop only, GPU threads never wait for it\n\
+      --log-summary=N          one summary line of shares and jobs every N seconds instead of a line each\n\
+      --log-ring=N             keep the last N share and job lines of --log-summary in memory for GET /1/log\n"
 # ifdef HAVE_SYSLOG_H
 "\
   -S, --syslog                 use system log for output messages\n"
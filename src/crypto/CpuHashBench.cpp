@@ -0,0 +1,373 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+
+#include "common/cpu/Cpu.h"
+#include "common/crypto/Algorithm.h"
+#include "common/log/Log.h"
+#include "common/utils/timestamp.h"
+#include "crypto/CpuHashBench.h"
+#include "crypto/CryptoNight.h"
+#include "crypto/CryptoNight_test.h"
+#include "crypto/CryptoNight_x86.h"
+#include "Mem.h"
+#include "rapidjson/document.h"
+#include "rapidjson/prettywriter.h"
+#include "rapidjson/stringbuffer.h"
+
+
+namespace {
+
+struct BenchAlgo
+{
+    xmrig::Algo algo;
+    xmrig::Variant variant;
+};
+
+
+#ifndef XMRIG_NO_ASM
+// single hash of the ivybridge, ryzen and bulldozer main loops and the sandybridge double hash
+struct BenchAsm
+{
+    xmrig::Algo algo;
+    xmrig::Variant variant;
+    CryptoNight::cn_hash_fun func[4];
+};
+#endif
+
+}
+
+
+static const BenchAlgo kAlgos[] = {
+#   ifndef XMRIG_NO_CN_GPU
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_GPU    },
+#   endif
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_WOW    },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_4      },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_DOUBLE },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_0      },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_1      },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_2      },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_XTL    },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_MSR    },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_XAO    },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_RTO    },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_HALF   },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_RWZ    },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_ZLS    },
+#   ifndef XMRIG_NO_AEON
+    { xmrig::CRYPTONIGHT_LITE,  xmrig::VARIANT_0      },
+    { xmrig::CRYPTONIGHT_LITE,  xmrig::VARIANT_1      },
+#   endif
+#   ifndef XMRIG_NO_SUMO
+    { xmrig::CRYPTONIGHT_HEAVY, xmrig::VARIANT_0      },
+    { xmrig::CRYPTONIGHT_HEAVY, xmrig::VARIANT_XHV    },
+    { xmrig::CRYPTONIGHT_HEAVY, xmrig::VARIANT_TUBE   },
+#   endif
+#   ifndef XMRIG_NO_CN_PICO
+    { xmrig::CRYPTONIGHT_PICO,  xmrig::VARIANT_TRTL   },
+#   endif
+};
+
+
+#ifndef XMRIG_NO_ASM
+#define CN_ASM(ALGO, VARIANT) \
+    { ALGO, VARIANT, { cryptonight_single_hash_asm<ALGO, VARIANT, xmrig::ASM_INTEL>, cryptonight_single_hash_asm<ALGO, VARIANT, xmrig::ASM_RYZEN>, \
+                       cryptonight_single_hash_asm<ALGO, VARIANT, xmrig::ASM_BULLDOZER>, cryptonight_double_hash_asm<ALGO, VARIANT, xmrig::ASM_INTEL> } }
+
+// cn/rwz has one main loop for all CPUs, it is measured by the fn rows
+static const BenchAsm kAsm[] = {
+    CN_ASM(xmrig::CRYPTONIGHT,      xmrig::VARIANT_WOW),
+    CN_ASM(xmrig::CRYPTONIGHT,      xmrig::VARIANT_4),
+    CN_ASM(xmrig::CRYPTONIGHT,      xmrig::VARIANT_DOUBLE),
+    CN_ASM(xmrig::CRYPTONIGHT,      xmrig::VARIANT_2),
+    CN_ASM(xmrig::CRYPTONIGHT,      xmrig::VARIANT_HALF),
+    CN_ASM(xmrig::CRYPTONIGHT,      xmrig::VARIANT_ZLS),
+#   ifndef XMRIG_NO_CN_PICO
+    CN_ASM(xmrig::CRYPTONIGHT_PICO, xmrig::VARIANT_TRTL),
+#   endif
+};
+
+#undef CN_ASM
+
+static const char *const kAsmNames[] = { "asm-ivybridge", "asm-ryzen", "asm-bulldozer", "asm-sandybridge-double" };
+static const size_t kAsmWays[]       = { 1, 1, 1, 2 };
+
+// CryptonightR code generated per measurement, the heights are past the ones of the hash rows
+static const uint64_t kJitCodes  = 256;
+static const uint64_t kJitHeight = 1807000;
+#endif
+
+
+static const char *const kWays[] = { "single", "double", "triple", "quad", "penta" };
+
+// test_input holds 5 blobs of 76 bytes, enough for the penta hash
+static const size_t kBlobSize = 76;
+
+// measurement time of one row in ms
+static const int64_t kRowTime = 2000;
+
+
+// CryptonightR rows hash at the height of the first test vector, the code is generated by the warm-up call
+static double measure(xmrig::Algo algo, CryptoNight::cn_hash_fun func, size_t ways)
+{
+    cryptonight_ctx *ctx[CryptoNight::kMaxWays] = { nullptr };
+    MemInfo info = Mem::create(ctx, algo, ways);
+
+    alignas(16) uint8_t output[32 * CryptoNight::kMaxWays];
+    const uint64_t height = cn_r_test_input[0].height;
+
+    func(test_input, kBlobSize, output, ctx, height);
+
+    const int64_t start = xmrig::steadyTimestamp();
+    int64_t elapsed     = 0;
+    uint64_t calls      = 0;
+
+    do {
+        func(test_input, kBlobSize, output, ctx, height);
+
+        calls++;
+        elapsed = xmrig::steadyTimestamp() - start;
+    } while (elapsed < kRowTime);
+
+    Mem::release(ctx, ways, info);
+
+    return static_cast<double>(calls * ways) * 1000.0 / static_cast<double>(elapsed);
+}
+
+
+#if !defined(XMRIG_NO_CN_GPU) && !defined(XMRIG_ARM)
+typedef void (*cn_gpu_inner_fun)(const uint8_t *spad, uint8_t *lpad);
+
+
+// the inner loop alone, on the scratchpad of a cn/gpu hash
+static double measureInner(cn_gpu_inner_fun func, xmrig::AlgoVerify av)
+{
+    cryptonight_ctx *ctx = nullptr;
+    MemInfo info = Mem::create(&ctx, xmrig::CRYPTONIGHT, 1);
+
+    uint8_t output[32];
+    CryptoNight::fn(xmrig::CRYPTONIGHT, av, xmrig::VARIANT_GPU)(test_input, kBlobSize, output, &ctx, 0);
+
+    const int64_t start = xmrig::steadyTimestamp();
+    int64_t elapsed     = 0;
+    uint64_t calls      = 0;
+
+    do {
+        func(ctx->state, ctx->memory);
+
+        calls++;
+        elapsed = xmrig::steadyTimestamp() - start;
+    } while (elapsed < kRowTime);
+
+    Mem::release(&ctx, 1, info);
+
+    return static_cast<double>(calls) * 1000.0 / static_cast<double>(elapsed);
+}
+#endif
+
+
+#ifndef XMRIG_NO_ASM
+// average time to generate the CryptonightR code of a new height in us
+static double measureJit(xmrig::Variant variant, CryptonightR_code_type type)
+{
+    using namespace std::chrono;
+
+    cryptonight_ctx *ctx = nullptr;
+    MemInfo info = Mem::create(&ctx, xmrig::CRYPTONIGHT, 1);
+
+    const xmrig::Assembly assembly = type == CRYPTONIGHTR_CODE_SOFT_AES ? xmrig::ASM_NONE : xmrig::ASM_AUTO;
+
+    const auto start = steady_clock::now();
+    for (uint64_t i = 0; i < kJitCodes; ++i) {
+        CryptonightR_update_code(ctx, variant, kJitHeight + i, type, assembly);
+    }
+
+    const double elapsed = static_cast<double>(duration_cast<nanoseconds>(steady_clock::now() - start).count());
+
+    Mem::release(&ctx, 1, info);
+
+    return elapsed / 1000.0 / kJitCodes;
+}
+#endif
+
+
+// algos on the command line (short names like cn/r) limit the rows to them
+static bool isSelected(int argc, char **argv, xmrig::Algo algo, xmrig::Variant variant)
+{
+    if (argc < 2) {
+        return true;
+    }
+
+    const xmrig::Algorithm algorithm(algo, variant);
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], algorithm.shortName()) == 0 || strcmp(argv[i], algorithm.name()) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+static void addRow(rapidjson::Value &rows, rapidjson::Document::AllocatorType &allocator, xmrig::Algo algo, xmrig::Variant variant, const char *impl, size_t ways, double hashrate)
+{
+    using namespace rapidjson;
+
+    const xmrig::Algorithm algorithm(algo, variant);
+    LOG_INFO("%-16s %-24s %10.2f H/s", algorithm.shortName(), impl, hashrate);
+
+    Value row(kObjectType);
+    row.AddMember("algo",     StringRef(algorithm.shortName()), allocator);
+    row.AddMember("impl",     StringRef(impl), allocator);
+    row.AddMember("ways",     static_cast<uint64_t>(ways), allocator);
+    row.AddMember("hashrate", hashrate, allocator);
+
+    rows.PushBack(row, allocator);
+}
+
+
+int xmrig::CpuHashBench::exec(int argc, char **argv)
+{
+    using namespace rapidjson;
+
+    // patches the asm main loops and picks the soft AES path, the self-tests it starts are finished first
+    CryptoNight::init(CRYPTONIGHT);
+    CryptoNight::release();
+
+    const bool hwAes     = Cpu::info()->hasAES();
+    const bool bitsliced = soft_aes_bitsliced;
+
+    Document doc(kObjectType);
+    auto &allocator = doc.GetAllocator();
+
+    Value rows(kArrayType);
+
+    for (const BenchAlgo &bench : kAlgos) {
+        if (!isSelected(argc, argv, bench.algo, bench.variant)) {
+            continue;
+        }
+
+        if (hwAes) {
+            addRow(rows, allocator, bench.algo, bench.variant, kWays[0], 1, measure(bench.algo, CryptoNight::fn(bench.algo, VERIFY_HW_AES, bench.variant), 1));
+
+            for (size_t ways = 2; ways <= CryptoNight::kMaxWays; ++ways) {
+                CryptoNight::cn_hash_fun func = CryptoNight::fnMulti(bench.algo, bench.variant, ways);
+                if (func) {
+                    addRow(rows, allocator, bench.algo, bench.variant, kWays[ways - 1], ways, measure(bench.algo, func, ways));
+                }
+            }
+        }
+
+        CryptoNight::cn_hash_fun soft = CryptoNight::fn(bench.algo, VERIFY_SOFT_AES, bench.variant);
+        if (soft) {
+            soft_aes_bitsliced = false;
+            addRow(rows, allocator, bench.algo, bench.variant, "soft-table", 1, measure(bench.algo, soft, 1));
+
+            soft_aes_bitsliced = true;
+            addRow(rows, allocator, bench.algo, bench.variant, "soft-bitsliced", 1, measure(bench.algo, soft, 1));
+
+            soft_aes_bitsliced = bitsliced;
+        }
+    }
+
+#   ifndef XMRIG_NO_ASM
+    if (hwAes) {
+        for (const BenchAsm &bench : kAsm) {
+            if (!isSelected(argc, argv, bench.algo, bench.variant)) {
+                continue;
+            }
+
+            for (size_t i = 0; i < sizeof(kAsmNames) / sizeof(kAsmNames[0]); ++i) {
+                addRow(rows, allocator, bench.algo, bench.variant, kAsmNames[i], kAsmWays[i], measure(bench.algo, bench.func[i], kAsmWays[i]));
+            }
+        }
+    }
+#   endif
+
+#   if !defined(XMRIG_NO_CN_GPU) && !defined(XMRIG_ARM)
+    if (isSelected(argc, argv, CRYPTONIGHT, VARIANT_GPU)) {
+        const AlgoVerify av = hwAes ? VERIFY_HW_AES : VERIFY_SOFT_AES;
+
+        addRow(rows, allocator, CRYPTONIGHT, VARIANT_GPU, "inner-ssse3", 1, measureInner(cn_gpu_inner_ssse3<CRYPTONIGHT_GPU_ITER, CRYPTONIGHT_GPU_MASK>, av));
+
+        if (Cpu::info()->hasAVX2()) {
+            addRow(rows, allocator, CRYPTONIGHT, VARIANT_GPU, "inner-avx2", 1, measureInner(cn_gpu_inner_avx<CRYPTONIGHT_GPU_ITER, CRYPTONIGHT_GPU_MASK>, av));
+        }
+
+        if (Cpu::info()->hasAVX512()) {
+            addRow(rows, allocator, CRYPTONIGHT, VARIANT_GPU, "inner-avx512", 1, measureInner(cn_gpu_inner_avx512<CRYPTONIGHT_GPU_ITER, CRYPTONIGHT_GPU_MASK>, av));
+        }
+    }
+#   endif
+
+    doc.AddMember("hashes", rows, allocator);
+
+#   ifndef XMRIG_NO_ASM
+    Value jit(kArrayType);
+    const Variant jitVariants[] = { VARIANT_WOW, VARIANT_4 };
+
+    for (const Variant variant : jitVariants) {
+        if (!isSelected(argc, argv, CRYPTONIGHT, variant)) {
+            continue;
+        }
+
+        const CryptonightR_code_type types[] = { CRYPTONIGHTR_CODE_SINGLE, CRYPTONIGHTR_CODE_DOUBLE, CRYPTONIGHTR_CODE_SOFT_AES };
+        const char *const names[]            = { "single", "double", "soft" };
+
+        for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); ++i) {
+            if (!hwAes && types[i] != CRYPTONIGHTR_CODE_SOFT_AES) {
+                continue;
+            }
+
+            const double time = measureJit(variant, types[i]);
+            LOG_INFO("%-16s jit-%-20s %10.2f us", Algorithm(CRYPTONIGHT, variant).shortName(), names[i], time);
+
+            Value row(kObjectType);
+            row.AddMember("algo",    StringRef(Algorithm(CRYPTONIGHT, variant).shortName()), allocator);
+            row.AddMember("code",    StringRef(names[i]), allocator);
+            row.AddMember("time_us", time, allocator);
+
+            jit.PushBack(row, allocator);
+        }
+    }
+
+    doc.AddMember("jit", jit, allocator);
+#   endif
+
+    StringBuffer buffer(nullptr, 4096);
+    PrettyWriter<StringBuffer> writer(buffer);
+    doc.Accept(writer);
+
+    printf("%s\n", buffer.GetString());
+    fflush(stdout);
+
+    return 0;
+}
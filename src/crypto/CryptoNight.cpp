@@ -25,13 +25,20 @@
  */
 
 
+#include <algorithm>
 #include <assert.h>
+#include <atomic>
+#include <mutex>
 #include <sstream>
+#include <thread>
+#include <vector>
 
 
 #include "common/cpu/Cpu.h"
 #include "common/log/Log.h"
 #include "common/net/Job.h"
+#include "common/utils/timestamp.h"
+#include "core/StartupProfile.h"
 #include "Mem.h"
 #include "crypto/CryptoNight.h"
 #include "crypto/CryptoNight_test.h"
@@ -39,9 +46,62 @@
 #include "net/JobResult.h"
 
 
-alignas(16) cryptonight_ctx *CryptoNight::m_ctx = nullptr;
 xmrig::Algo CryptoNight::m_algorithm = xmrig::CRYPTONIGHT;
 xmrig::AlgoVerify CryptoNight::m_av  = xmrig::VERIFY_HW_AES;
+bool soft_aes_bitsliced              = false;
+
+
+namespace {
+
+struct SelfTestVector
+{
+    xmrig::Algo algo;
+    xmrig::Variant variant;
+    const uint8_t *reference;
+    bool heights;
+};
+
+}
+
+
+// the slowest variants come first, so they are not the last ones left running in the background
+static const SelfTestVector kSelfTests[] = {
+#   ifndef XMRIG_NO_CN_GPU
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_GPU,    test_output_gpu,        false },
+#   endif
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_WOW,    test_output_wow,        true  },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_4,      test_output_r,          true  },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_DOUBLE, test_output_double,     false },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_0,      test_output_v0,         false },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_1,      test_output_v1,         false },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_2,      test_output_v2,         false },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_XTL,    test_output_xtl,        false },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_MSR,    test_output_msr,        false },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_XAO,    test_output_xao,        false },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_RTO,    test_output_rto,        false },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_HALF,   test_output_half,       false },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_RWZ,    test_output_rwz,        false },
+    { xmrig::CRYPTONIGHT,       xmrig::VARIANT_ZLS,    test_output_zls,        false },
+#   ifndef XMRIG_NO_AEON
+    { xmrig::CRYPTONIGHT_LITE,  xmrig::VARIANT_0,      test_output_v0_lite,    false },
+    { xmrig::CRYPTONIGHT_LITE,  xmrig::VARIANT_1,      test_output_v1_lite,    false },
+#   endif
+#   ifndef XMRIG_NO_SUMO
+    { xmrig::CRYPTONIGHT_HEAVY, xmrig::VARIANT_0,      test_output_v0_heavy,   false },
+    { xmrig::CRYPTONIGHT_HEAVY, xmrig::VARIANT_XHV,    test_output_xhv_heavy,  false },
+    { xmrig::CRYPTONIGHT_HEAVY, xmrig::VARIANT_TUBE,   test_output_tube_heavy, false },
+#   endif
+#   ifndef XMRIG_NO_CN_PICO
+    { xmrig::CRYPTONIGHT_PICO,  xmrig::VARIANT_TRTL,   test_output_pico_trtl,  false },
+#   endif
+};
+
+
+static bool selfTestResult[xmrig::ALGO_MAX][xmrig::VARIANT_MAX] = {};
+static std::atomic<size_t> selfTestNext(0);
+static std::once_flag selfTestOnce[xmrig::ALGO_MAX][xmrig::VARIANT_MAX];
+static std::vector<const SelfTestVector *> selfTestQueue;
+static std::vector<std::thread> selfTestThreads;
 
 
 bool CryptoNight::hash(const xmrig::Job &job, xmrig::JobResult &result, cryptonight_ctx *ctx)
@@ -52,6 +112,78 @@ bool CryptoNight::hash(const xmrig::Job &job, xmrig::JobResult &result, cryptoni
 }
 
 
+// job is shared with other threads, the nonce is applied to a copy of the blob
+bool CryptoNight::hash(const xmrig::Job &job, uint32_t nonce, uint8_t *output, cryptonight_ctx *ctx)
+{
+    alignas(16) uint8_t blob[xmrig::Job::kMaxBlobSize];
+    memcpy(blob, job.blob(), job.size());
+    *xmrig::Job::nonce(blob) = nonce;
+
+    fn(job.algorithm().algo(), job.algorithm().variant())(blob, job.size(), output, &ctx, job.height());
+
+    return *reinterpret_cast<uint64_t*>(output + 24) < job.target();
+}
+
+
+// hashes count nonces of jobs which are isSameHash at once, output gets 32 bytes per nonce,
+// ctx must have count contexts, without a multi-hash function they are hashed one by one
+void CryptoNight::hash(const xmrig::Job *const *jobs, const uint32_t *nonces, size_t count, uint8_t *output, cryptonight_ctx **ctx)
+{
+    assert(count > 0 && count <= kMaxWays);
+
+    const xmrig::Job &job = *jobs[0];
+    const cn_hash_fun func = count > 1 && m_av == xmrig::VERIFY_HW_AES ? fnMulti(job.algorithm().algo(), job.algorithm().variant(), count) : nullptr;
+
+    if (!func) {
+        for (size_t i = 0; i < count; ++i) {
+            hash(*jobs[i], nonces[i], output + 32 * i, ctx[i]);
+        }
+
+        return;
+    }
+
+    const size_t size = job.size();
+    alignas(16) uint8_t blobs[xmrig::Job::kMaxBlobSize * kMaxWays];
+
+    for (size_t i = 0; i < count; ++i) {
+        memcpy(blobs + size * i, jobs[i]->blob(), size);
+        *xmrig::Job::nonce(blobs + size * i) = nonces[i];
+    }
+
+    func(blobs, size, output, ctx, job.height());
+}
+
+
+// CryptonightR code of the job height and the next one is compiled on job arrival, so verification
+// of the first results at a height doesn't wait for it, like the GPU programs are precompiled
+void CryptoNight::prepare(const xmrig::Job &job)
+{
+#   ifndef XMRIG_NO_ASM
+    using namespace xmrig;
+
+    const Variant variant = job.algorithm().variant();
+    if (job.algorithm().algo() != CRYPTONIGHT || (variant != VARIANT_WOW && variant != VARIANT_4) || job.height() == 0) {
+        return;
+    }
+
+    const bool soft                   = m_av == VERIFY_SOFT_AES;
+    const CryptonightR_code_type type = soft ? CRYPTONIGHTR_CODE_SOFT_AES : CRYPTONIGHTR_CODE_SINGLE;
+    const Assembly assembly           = soft ? ASM_NONE : ASM_AUTO;
+
+    CryptonightR_prepare_code(variant, job.height(), type, assembly);
+    CryptonightR_prepare_code(variant, job.height() + 1, type, assembly);
+#   endif
+}
+
+
+// jobs of the same algorithm, blob size and height can be hashed together
+bool CryptoNight::isSameHash(const xmrig::Job &a, const xmrig::Job &b)
+{
+    return a.algorithm().algo() == b.algorithm().algo() && a.algorithm().variant() == b.algorithm().variant() &&
+           a.size() == b.size() && a.height() == b.height();
+}
+
+
 #ifndef XMRIG_NO_ASM
 xmrig::CpuThread::cn_mainloop_fun        cn_half_mainloop_ivybridge_asm             = nullptr;
 xmrig::CpuThread::cn_mainloop_fun        cn_half_mainloop_ryzen_asm                 = nullptr;
@@ -159,7 +291,41 @@ static void patchAsmVariants()
 }
 #endif
 
-bool CryptoNight::init(xmrig::Algo algorithm)
+// self-tests of the algorithm variants run on their own threads while OpenCL initializes and compiles,
+// hashing only waits for the variant of its job
+// Both soft AES paths give the same result, the bitsliced one wins where table lookups are slow,
+// time a few scratchpad chunks with each and keep the faster one for this host.
+static void selectSoftAes()
+{
+    using namespace std::chrono;
+
+    alignas(16) __m128i seed[2] = {};
+    alignas(16) __m128i x[8]    = {};
+    cn_aes_keys keys;
+
+    soft_aes_bitsliced = true;
+    cn_aes_keys_init<true>(seed, keys);
+
+    int64_t best[2] = { INT64_MAX, INT64_MAX };
+
+    for (int pass = 0; pass < 6; ++pass) {
+        soft_aes_bitsliced = pass & 1;
+
+        const auto start = steady_clock::now();
+        for (size_t i = 0; i < 1024; ++i) {
+            aes_rounds<true>(keys, &x[0], &x[1], &x[2], &x[3], &x[4], &x[5], &x[6], &x[7]);
+        }
+
+        best[pass & 1] = std::min<int64_t>(best[pass & 1], duration_cast<microseconds>(steady_clock::now() - start).count());
+    }
+
+    soft_aes_bitsliced = best[1] < best[0];
+
+    LOG_DEBUG("soft AES: table %" PRId64 " us, bitsliced %" PRId64 " us, using %s", best[0], best[1], soft_aes_bitsliced ? "bitsliced" : "table");
+}
+
+
+void CryptoNight::init(xmrig::Algo algorithm)
 {
 #ifndef XMRIG_NO_ASM
     patchAsmVariants();
@@ -168,7 +334,25 @@ bool CryptoNight::init(xmrig::Algo algorithm)
     m_algorithm = algorithm;
     m_av        = xmrig::Cpu::info()->hasAES() ? xmrig::VERIFY_HW_AES : xmrig::VERIFY_SOFT_AES;
 
-    return selfTest();
+    if (m_av == xmrig::VERIFY_SOFT_AES) {
+        selectSoftAes();
+    }
+
+    for (const SelfTestVector &test : kSelfTests) {
+        if (test.algo == algorithm) {
+            selfTestQueue.push_back(&test);
+        }
+    }
+
+    const size_t count = std::min<size_t>(static_cast<size_t>(xmrig::Cpu::info()->threads()), selfTestQueue.size());
+
+    for (size_t i = 0; i < count; ++i) {
+        selfTestThreads.emplace_back([]() {
+            for (size_t next = selfTestNext++; next < selfTestQueue.size(); next = selfTestNext++) {
+                selfTest(selfTestQueue[next]->algo, selfTestQueue[next]->variant);
+            }
+        });
+    }
 }
 
 
@@ -370,90 +554,192 @@ CryptoNight::cn_hash_fun CryptoNight::fn(xmrig::Algo algorithm, xmrig::AlgoVerif
 }
 
 
-bool CryptoNight::selfTest() {
+// hardware AES double, triple, quad and penta hash of the algorithm, nullptr for variants without them
+CryptoNight::cn_hash_fun CryptoNight::fnMulti(xmrig::Algo algorithm, xmrig::Variant variant, size_t ways)
+{
     using namespace xmrig;
 
-    Mem::create(&m_ctx, m_algorithm, 1);
-
-    if (m_algorithm == xmrig::CRYPTONIGHT) {
-        const bool rc = verify(VARIANT_0,      test_output_v0)   &&
-                        verify(VARIANT_1,      test_output_v1)   &&
-                        verify(VARIANT_2,      test_output_v2)   &&
-                        verify(VARIANT_XTL,    test_output_xtl)  &&
-                        verify(VARIANT_MSR,    test_output_msr)  &&
-                        verify(VARIANT_XAO,    test_output_xao)  &&
-                        verify(VARIANT_RTO,    test_output_rto)  &&
-                        verify(VARIANT_HALF,   test_output_half) &&
-                        verify2(VARIANT_WOW,   test_output_wow)  &&
-                        verify2(VARIANT_4,     test_output_r)    &&
-                        verify(VARIANT_RWZ,    test_output_rwz)  &&
-                        verify(VARIANT_ZLS,    test_output_zls)  &&
-                        verify(VARIANT_DOUBLE, test_output_double);
+    assert(variant >= VARIANT_0 && variant < VARIANT_MAX);
 
-#       ifndef XMRIG_NO_CN_GPU
-        if (!rc) {
-            return rc;
-        }
+    if (ways < 2 || ways > kMaxWays) {
+        return nullptr;
+    }
 
-        return verify(VARIANT_GPU, test_output_gpu);
+#   define CN_MULTI(ALGO, VARIANT) \
+        { cryptonight_double_hash<ALGO, false, VARIANT>, cryptonight_triple_hash<ALGO, false, VARIANT>, \
+          cryptonight_quad_hash<ALGO, false, VARIANT>, cryptonight_penta_hash<ALGO, false, VARIANT> }
+#   define CN_NONE { nullptr, nullptr, nullptr, nullptr }
+
+    static const cn_hash_fun func_table[][kMaxWays - 1] = {
+        CN_MULTI(CRYPTONIGHT, VARIANT_0),
+        CN_MULTI(CRYPTONIGHT, VARIANT_1),
+        CN_NONE, // VARIANT_TUBE
+        CN_MULTI(CRYPTONIGHT, VARIANT_XTL),
+        CN_MULTI(CRYPTONIGHT, VARIANT_MSR),
+        CN_NONE, // VARIANT_XHV
+        CN_MULTI(CRYPTONIGHT, VARIANT_XAO),
+        CN_MULTI(CRYPTONIGHT, VARIANT_RTO),
+        CN_MULTI(CRYPTONIGHT, VARIANT_2),
+        CN_MULTI(CRYPTONIGHT, VARIANT_HALF),
+        CN_NONE, // VARIANT_TRTL
+        CN_NONE, // VARIANT_GPU
+        CN_MULTI(CRYPTONIGHT, VARIANT_WOW),
+        CN_MULTI(CRYPTONIGHT, VARIANT_4),
+        CN_MULTI(CRYPTONIGHT, VARIANT_RWZ),
+        CN_MULTI(CRYPTONIGHT, VARIANT_ZLS),
+        CN_MULTI(CRYPTONIGHT, VARIANT_DOUBLE),
+
+#       ifndef XMRIG_NO_AEON
+        CN_MULTI(CRYPTONIGHT_LITE, VARIANT_0),
+        CN_MULTI(CRYPTONIGHT_LITE, VARIANT_1),
+        CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE,
+        CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE,
 #       else
-        return rc;
+        CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE,
+        CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE,
 #       endif
-    }
 
-#   ifndef XMRIG_NO_AEON
-    if (m_algorithm == xmrig::CRYPTONIGHT_LITE) {
-        return verify(VARIANT_0, test_output_v0_lite) &&
-               verify(VARIANT_1, test_output_v1_lite);
+#       ifndef XMRIG_NO_SUMO
+        CN_MULTI(CRYPTONIGHT_HEAVY, VARIANT_0),
+        CN_NONE, // VARIANT_1
+        CN_MULTI(CRYPTONIGHT_HEAVY, VARIANT_TUBE),
+        CN_NONE, CN_NONE, // VARIANT_XTL, VARIANT_MSR
+        CN_MULTI(CRYPTONIGHT_HEAVY, VARIANT_XHV),
+        CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE,
+        CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE,
+#       else
+        CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE,
+        CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE,
+#       endif
+
+#       ifndef XMRIG_NO_CN_PICO
+        CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE,
+        CN_MULTI(CRYPTONIGHT_PICO, VARIANT_TRTL),
+        CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE,
+#       else
+        CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE,
+        CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE, CN_NONE,
+#       endif
+    };
+
+#   undef CN_MULTI
+#   undef CN_NONE
+
+    static_assert(ALGO_MAX * VARIANT_MAX == sizeof(func_table) / sizeof(func_table[0]), "func_table size mismatch");
+
+    return func_table[VARIANT_MAX * algorithm + variant][ways - 2];
+}
+
+
+// waits for the self-tests of all variants of the algorithm, the ones running in the background included
+bool CryptoNight::selfTest(xmrig::Algo algorithm)
+{
+    bool rc = false;
+
+    for (const SelfTestVector &test : kSelfTests) {
+        if (test.algo != algorithm) {
+            continue;
+        }
+
+        if (!selfTest(test.algo, test.variant)) {
+            return false;
+        }
+
+        rc = true;
     }
-#   endif
 
-#   ifndef XMRIG_NO_SUMO
-    if (m_algorithm == xmrig::CRYPTONIGHT_HEAVY) {
-        return verify(VARIANT_0,    test_output_v0_heavy)  &&
-               verify(VARIANT_XHV,  test_output_xhv_heavy) &&
-               verify(VARIANT_TUBE, test_output_tube_heavy);
+    return rc;
+}
+
+
+// a variant is verified the first time it is needed, concurrent callers wait for the same run
+bool CryptoNight::selfTest(xmrig::Algo algorithm, xmrig::Variant variant)
+{
+    using namespace xmrig;
+
+    if (algorithm < 0 || algorithm >= ALGO_MAX || variant < 0 || variant >= VARIANT_MAX) {
+        return false;
     }
-#   endif
 
-#   ifndef XMRIG_NO_CN_PICO
-    if (m_algorithm == xmrig::CRYPTONIGHT_PICO) {
-        return verify(VARIANT_TRTL, test_output_pico_trtl);
+    std::call_once(selfTestOnce[algorithm][variant], [algorithm, variant]() {
+        const SelfTestVector *vector = nullptr;
+        for (const SelfTestVector &test : kSelfTests) {
+            if (test.algo == algorithm && test.variant == variant) {
+                vector = &test;
+                break;
+            }
+        }
+
+        // there is nothing to compare with, the hash function only has to exist
+        if (!vector) {
+            selfTestResult[algorithm][variant] = fn(algorithm, variant) != nullptr;
+            return;
+        }
+
+        const int64_t start = steadyTimestamp();
+
+        cryptonight_ctx *ctx = nullptr;
+        MemInfo info         = Mem::create(&ctx, algorithm, 1);
+
+        const bool rc = vector->heights ? verify2(ctx, algorithm, variant, vector->reference)
+                                        : verify(ctx, algorithm, variant, vector->reference);
+
+        Mem::release(&ctx, 1, info);
+
+        StartupProfile::add("self-test", -1, start, steadyTimestamp());
+        selfTestResult[algorithm][variant] = rc;
+
+        if (!rc) {
+            LOG_ERR("\"%s\" hash self-test failed.", Algorithm(algorithm, variant).name());
+        }
+    });
+
+    return selfTestResult[algorithm][variant];
+}
+
+
+void CryptoNight::release()
+{
+    for (std::thread &thread : selfTestThreads) {
+        thread.join();
     }
-#   endif
 
-    return false;
+    selfTestThreads.clear();
 }
 
 
-bool CryptoNight::verify(xmrig::Variant variant, const uint8_t *referenceValue)
+bool CryptoNight::verify(cryptonight_ctx *ctx, xmrig::Algo algorithm, xmrig::Variant variant, const uint8_t *referenceValue)
 {
-    if (!m_ctx) {
+    if (!ctx) {
         return false;
     }
 
     uint8_t output[32];
 
-    cn_hash_fun func = fn(variant);
+    cn_hash_fun func = fn(algorithm, variant);
     if (!func) {
         return false;
     }
 
-    func(test_input, 76, output, &m_ctx, 0);
+    func(test_input, 76, output, &ctx, 0);
 
     return memcmp(output, referenceValue, 32) == 0;
 }
 
-bool CryptoNight::verify2(xmrig::Variant variant, const uint8_t *referenceValue)
+bool CryptoNight::verify2(cryptonight_ctx *ctx, xmrig::Algo algorithm, xmrig::Variant variant, const uint8_t *referenceValue)
 {
-    cn_hash_fun func = fn(variant);
+    if (!ctx) {
+        return false;
+    }
+
+    cn_hash_fun func = fn(algorithm, variant);
     if (!func) {
         return false;
     }
 
     for (size_t i = 0; i < (sizeof(cn_r_test_input) / sizeof(cn_r_test_input[0])); ++i) {
         uint8_t hash[32];
-        func(cn_r_test_input[i].data, cn_r_test_input[i].size, hash, &m_ctx, cn_r_test_input[i].height);
+        func(cn_r_test_input[i].data, cn_r_test_input[i].size, hash, &ctx, cn_r_test_input[i].height);
 
         if (memcmp(hash, referenceValue + i * 32, sizeof hash) != 0) {
             return false;
@@ -71,6 +71,9 @@ struct cryptonight_ctx {
     cn_mainloop_fun_ms_abi generated_code_double;
     cryptonight_r_data generated_code_data;
     cryptonight_r_data generated_code_double_data;
+
+    // own code page of the context, single and double hash code in its halves
+    uint8_t *generated_code_page;
 };
 
 
@@ -79,19 +82,28 @@ class CryptoNight
 public:
     typedef void (*cn_hash_fun)(const uint8_t *input, size_t size, uint8_t *output, cryptonight_ctx **ctx, uint64_t height);
 
+    // the most hashes computed at once by the multi-hash functions
+    static constexpr const size_t kMaxWays = 5;
+
     static inline cn_hash_fun fn(xmrig::Variant variant) { return fn(m_algorithm, m_av, variant); }
     static inline cn_hash_fun fn(xmrig::Algo algo, xmrig::Variant variant) { return fn(algo, m_av, variant); }
 
     static bool hash(const xmrig::Job &job, xmrig::JobResult &result, cryptonight_ctx *ctx);
-    static bool init(xmrig::Algo algorithm);
+    static bool hash(const xmrig::Job &job, uint32_t nonce, uint8_t *output, cryptonight_ctx *ctx);
+    static bool isSameHash(const xmrig::Job &a, const xmrig::Job &b);
+    static bool selfTest(xmrig::Algo algorithm);
+    static bool selfTest(xmrig::Algo algorithm, xmrig::Variant variant);
+    static void init(xmrig::Algo algorithm);
+    static void prepare(const xmrig::Job &job);
+    static void release();
     static cn_hash_fun fn(xmrig::Algo algorithm, xmrig::AlgoVerify av, xmrig::Variant variant);
+    static cn_hash_fun fnMulti(xmrig::Algo algorithm, xmrig::Variant variant, size_t ways);
+    static void hash(const xmrig::Job *const *jobs, const uint32_t *nonces, size_t count, uint8_t *output, cryptonight_ctx **ctx);
 
 private:
-    static bool selfTest();
-    static bool verify(xmrig::Variant variant, const uint8_t *referenceValue);
-    static bool verify2(xmrig::Variant variant, const uint8_t *test_data);
+    static bool verify(cryptonight_ctx *ctx, xmrig::Algo algorithm, xmrig::Variant variant, const uint8_t *referenceValue);
+    static bool verify2(cryptonight_ctx *ctx, xmrig::Algo algorithm, xmrig::Variant variant, const uint8_t *referenceValue);
 
-    alignas(16) static cryptonight_ctx *m_ctx;
     static xmrig::Algo m_algorithm;
     static xmrig::AlgoVerify m_av;
 };
@@ -125,120 +125,83 @@ inline uint32_t cn_select_mask(Algo algorithm)
 }
 
 
-template<Algo ALGO, Variant variant> inline constexpr uint32_t cn_select_iter()        { return 0; }
-template<> inline constexpr uint32_t cn_select_iter<CRYPTONIGHT, VARIANT_0>()          { return CRYPTONIGHT_ITER; }
-template<> inline constexpr uint32_t cn_select_iter<CRYPTONIGHT, VARIANT_1>()          { return CRYPTONIGHT_ITER; }
-template<> inline constexpr uint32_t cn_select_iter<CRYPTONIGHT, VARIANT_2>()          { return CRYPTONIGHT_ITER; }
-template<> inline constexpr uint32_t cn_select_iter<CRYPTONIGHT, VARIANT_WOW>()        { return CRYPTONIGHT_ITER; }
-template<> inline constexpr uint32_t cn_select_iter<CRYPTONIGHT, VARIANT_4>()          { return CRYPTONIGHT_ITER; }
-template<> inline constexpr uint32_t cn_select_iter<CRYPTONIGHT, VARIANT_XTL>()        { return CRYPTONIGHT_ITER; }
-template<> inline constexpr uint32_t cn_select_iter<CRYPTONIGHT, VARIANT_HALF>()       { return CRYPTONIGHT_HALF_ITER; }
-template<> inline constexpr uint32_t cn_select_iter<CRYPTONIGHT, VARIANT_MSR>()        { return CRYPTONIGHT_HALF_ITER; }
-template<> inline constexpr uint32_t cn_select_iter<CRYPTONIGHT, VARIANT_XAO>()        { return CRYPTONIGHT_XAO_ITER; }
-template<> inline constexpr uint32_t cn_select_iter<CRYPTONIGHT, VARIANT_RTO>()        { return CRYPTONIGHT_ITER; }
-template<> inline constexpr uint32_t cn_select_iter<CRYPTONIGHT, VARIANT_GPU>()        { return CRYPTONIGHT_GPU_ITER; }
-template<> inline constexpr uint32_t cn_select_iter<CRYPTONIGHT, VARIANT_RWZ>()        { return CRYPTONIGHT_WALTZ_ITER; }
-template<> inline constexpr uint32_t cn_select_iter<CRYPTONIGHT, VARIANT_ZLS>()        { return CRYPTONIGHT_ZLS_ITER; }
-template<> inline constexpr uint32_t cn_select_iter<CRYPTONIGHT, VARIANT_DOUBLE>()     { return CRYPTONIGHT_DOUBLE_ITER; }
-template<> inline constexpr uint32_t cn_select_iter<CRYPTONIGHT_LITE, VARIANT_0>()     { return CRYPTONIGHT_LITE_ITER; }
-template<> inline constexpr uint32_t cn_select_iter<CRYPTONIGHT_LITE, VARIANT_1>()     { return CRYPTONIGHT_LITE_ITER; }
-template<> inline constexpr uint32_t cn_select_iter<CRYPTONIGHT_HEAVY, VARIANT_0>()    { return CRYPTONIGHT_HEAVY_ITER; }
-template<> inline constexpr uint32_t cn_select_iter<CRYPTONIGHT_HEAVY, VARIANT_XHV>()  { return CRYPTONIGHT_HEAVY_ITER; }
-template<> inline constexpr uint32_t cn_select_iter<CRYPTONIGHT_HEAVY, VARIANT_TUBE>() { return CRYPTONIGHT_HEAVY_ITER; }
-template<> inline constexpr uint32_t cn_select_iter<CRYPTONIGHT_PICO, VARIANT_TRTL>()  { return CRYPTONIGHT_TRTL_ITER; }
-
-
-inline uint32_t cn_select_iter(Algo algorithm, Variant variant)
+// what sets a variant apart from the base CryptoNight of its algorithm, indexed by Variant. Iterations of 0 are
+// the ones of the algorithm, memory and mask come with the algorithm. The CPU templates and the GPU kernel of the
+// variant 2 forks (cn1_v2_ext, see cn1KernelOffset in OclGPU.cpp) take the parameters from here, so a fork of
+// variant 2 which only changes them needs its Variant and an entry, not a kernel of its own.
+struct CnVariantDesc
 {
-    switch (variant) {
-    case VARIANT_MSR:
-    case VARIANT_HALF:
-        return CRYPTONIGHT_HALF_ITER;
+    Variant variant;
+    Variant base;        // VARIANT_0 no tweak, VARIANT_1 the v1 tweak, VARIANT_2 shuffle and division/sqrt, VARIANT_GPU cn/gpu
+    uint32_t iterations; // even, the GPU kernel keeps the shuffle order in the low bit
+    bool reverse;        // shuffle of variant 2 with the chunks reversed
+};
+
+
+constexpr const CnVariantDesc cn_variants[VARIANT_MAX] = {
+    { VARIANT_0,      VARIANT_0,   0,                       false },
+    { VARIANT_1,      VARIANT_1,   0,                       false },
+    { VARIANT_TUBE,   VARIANT_1,   0,                       false },
+    { VARIANT_XTL,    VARIANT_1,   0,                       false },
+    { VARIANT_MSR,    VARIANT_1,   CRYPTONIGHT_HALF_ITER,   false },
+    { VARIANT_XHV,    VARIANT_0,   0,                       false },
+    { VARIANT_XAO,    VARIANT_0,   CRYPTONIGHT_XAO_ITER,    false },
+    { VARIANT_RTO,    VARIANT_1,   0,                       false },
+    { VARIANT_2,      VARIANT_2,   0,                       false },
+    { VARIANT_HALF,   VARIANT_2,   CRYPTONIGHT_HALF_ITER,   false },
+    { VARIANT_TRTL,   VARIANT_2,   CRYPTONIGHT_TRTL_ITER,   false },
+    { VARIANT_GPU,    VARIANT_GPU, CRYPTONIGHT_GPU_ITER,    false },
+    { VARIANT_WOW,    VARIANT_2,   0,                       false },
+    { VARIANT_4,      VARIANT_2,   0,                       false },
+    { VARIANT_RWZ,    VARIANT_2,   CRYPTONIGHT_WALTZ_ITER,  true  },
+    { VARIANT_ZLS,    VARIANT_2,   CRYPTONIGHT_ZLS_ITER,    false },
+    { VARIANT_DOUBLE, VARIANT_2,   CRYPTONIGHT_DOUBLE_ITER, false },
+};
+
+
+inline constexpr bool cn_variants_ordered(int index = 0)
+{
+    return index == VARIANT_MAX || (cn_variants[index].variant == index && cn_variants[index].iterations % 2 == 0 && cn_variants_ordered(index + 1));
+}
 
-    case VARIANT_GPU:
-        return CRYPTONIGHT_GPU_ITER;
+static_assert(cn_variants_ordered(), "cn_variants must list every Variant in order with even iterations");
 
-    case VARIANT_RTO:
-    case VARIANT_DOUBLE:
-        return CRYPTONIGHT_XAO_ITER;
 
-    case VARIANT_TRTL:
-        return CRYPTONIGHT_TRTL_ITER;
+inline constexpr bool cn_is_known(Variant variant)
+{
+    return variant > VARIANT_AUTO && variant < VARIANT_MAX;
+}
 
-    case VARIANT_RWZ:
-    case VARIANT_ZLS:
-        return CRYPTONIGHT_WALTZ_ITER;
 
-    default:
-        break;
-    }
+inline constexpr uint32_t cn_algo_iter(Algo algorithm)
+{
+    return algorithm == CRYPTONIGHT       ? CRYPTONIGHT_ITER :
+           algorithm == CRYPTONIGHT_LITE  ? CRYPTONIGHT_LITE_ITER :
+           algorithm == CRYPTONIGHT_HEAVY ? CRYPTONIGHT_HEAVY_ITER :
+           algorithm == CRYPTONIGHT_PICO  ? CRYPTONIGHT_TRTL_ITER : 0;
+}
 
-    switch(algorithm)
-    {
-    case CRYPTONIGHT:
-        return CRYPTONIGHT_ITER;
 
-    case CRYPTONIGHT_LITE:
-        return CRYPTONIGHT_LITE_ITER;
+inline constexpr uint32_t cn_select_iter(Algo algorithm, Variant variant)
+{
+    return cn_is_known(variant) && cn_variants[variant].iterations ? cn_variants[variant].iterations : cn_algo_iter(algorithm);
+}
 
-    case CRYPTONIGHT_HEAVY:
-        return CRYPTONIGHT_HEAVY_ITER;
 
-    case CRYPTONIGHT_PICO:
-        return CRYPTONIGHT_TRTL_ITER;
+template<Algo ALGO, Variant variant> inline constexpr uint32_t cn_select_iter() { return cn_select_iter(ALGO, variant); }
 
-    default:
-        break;
-    }
 
-    return 0;
+// an unknown variant is treated as variant 2
+inline constexpr Variant cn_base_variant(Variant variant)
+{
+    return cn_is_known(variant) ? cn_variants[variant].base : VARIANT_2;
 }
 
 
-template<Variant variant> inline constexpr Variant cn_base_variant()  { return VARIANT_0; }
-template<> inline constexpr Variant cn_base_variant<VARIANT_0>()      { return VARIANT_0; }
-template<> inline constexpr Variant cn_base_variant<VARIANT_1>()      { return VARIANT_1; }
-template<> inline constexpr Variant cn_base_variant<VARIANT_TUBE>()   { return VARIANT_1; }
-template<> inline constexpr Variant cn_base_variant<VARIANT_XTL>()    { return VARIANT_1; }
-template<> inline constexpr Variant cn_base_variant<VARIANT_MSR>()    { return VARIANT_1; }
-template<> inline constexpr Variant cn_base_variant<VARIANT_XHV>()    { return VARIANT_0; }
-template<> inline constexpr Variant cn_base_variant<VARIANT_XAO>()    { return VARIANT_0; }
-template<> inline constexpr Variant cn_base_variant<VARIANT_RTO>()    { return VARIANT_1; }
-template<> inline constexpr Variant cn_base_variant<VARIANT_2>()      { return VARIANT_2; }
-template<> inline constexpr Variant cn_base_variant<VARIANT_HALF>()   { return VARIANT_2; }
-template<> inline constexpr Variant cn_base_variant<VARIANT_TRTL>()   { return VARIANT_2; }
-template<> inline constexpr Variant cn_base_variant<VARIANT_GPU>()    { return VARIANT_GPU; }
-template<> inline constexpr Variant cn_base_variant<VARIANT_WOW>()    { return VARIANT_2; }
-template<> inline constexpr Variant cn_base_variant<VARIANT_4>()      { return VARIANT_2; }
-template<> inline constexpr Variant cn_base_variant<VARIANT_RWZ>()    { return VARIANT_2; }
-template<> inline constexpr Variant cn_base_variant<VARIANT_ZLS>()    { return VARIANT_2; }
-template<> inline constexpr Variant cn_base_variant<VARIANT_DOUBLE>() { return VARIANT_2; }
-
-
-inline Variant cn_base_variant(Variant variant)
-{
-    switch (variant) {
-    case VARIANT_0:
-    case VARIANT_XHV:
-    case VARIANT_XAO:
-        return VARIANT_0;
-
-    case VARIANT_1:
-    case VARIANT_TUBE:
-    case VARIANT_XTL:
-    case VARIANT_MSR:
-    case VARIANT_RTO:
-        return VARIANT_1;
-
-    case VARIANT_GPU:
-        return VARIANT_GPU;
+template<Variant variant> inline constexpr Variant cn_base_variant() { return cn_base_variant(variant); }
 
-    default:
-        break;
-    }
 
-    return VARIANT_2;
-}
+template<Variant variant> inline constexpr bool cn_is_reversed_shuffle() { return cn_variants[variant].reverse; }
 
 
 template<Variant variant> inline constexpr bool cn_is_cryptonight_r() { return false; }
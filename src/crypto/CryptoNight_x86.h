@@ -40,6 +40,7 @@
 #include "crypto/CryptoNight.h"
 #include "crypto/CryptoNight_constants.h"
 #include "crypto/CryptoNight_monero.h"
+#include "crypto/CryptonightR_gen.h"
 #include "crypto/soft_aes.h"
 
 
@@ -58,6 +59,11 @@ static inline void do_blake_hash(const uint8_t *input, size_t len, uint8_t *outp
 
 
 static inline void do_groestl_hash(const uint8_t *input, size_t len, uint8_t *output) {
+    if (xmrig::Cpu::info()->hasAES()) {
+        groestl_aesni(input, len * 8, output);
+        return;
+    }
+
     groestl(input, len * 8, output);
 }
 
@@ -264,7 +270,7 @@ template<bool SOFT_AES>
 void aes_round(__m128i key, __m128i* x0, __m128i* x1, __m128i* x2, __m128i* x3, __m128i* x4, __m128i* x5, __m128i* x6, __m128i* x7);
 
 template<>
-NOINLINE void aes_round<true>(__m128i key, __m128i* x0, __m128i* x1, __m128i* x2, __m128i* x3, __m128i* x4, __m128i* x5, __m128i* x6, __m128i* x7)
+inline NOINLINE void aes_round<true>(__m128i key, __m128i* x0, __m128i* x1, __m128i* x2, __m128i* x3, __m128i* x4, __m128i* x5, __m128i* x6, __m128i* x7)
 {
     *x0 = soft_aesenc((uint32_t*)x0, key, (const uint32_t*)saes_table);
     *x1 = soft_aesenc((uint32_t*)x1, key, (const uint32_t*)saes_table);
@@ -289,6 +295,78 @@ FORCEINLINE void aes_round<false>(__m128i key, __m128i* x0, __m128i* x1, __m128i
     *x7 = _mm_aesenc_si128(*x7, key);
 }
 
+
+// round keys of the 10-round scratchpad loops, the soft AES path can also keep them bitsliced
+struct cn_aes_keys
+{
+    __m128i k[10];
+    __m128i bs[80];
+};
+
+
+template<bool SOFT_AES>
+static inline void cn_aes_keys_init(const __m128i *memory, cn_aes_keys &keys)
+{
+    __m128i *k = keys.k;
+    aes_genkey<SOFT_AES>(memory, k, k + 1, k + 2, k + 3, k + 4, k + 5, k + 6, k + 7, k + 8, k + 9);
+
+    if (SOFT_AES && soft_aes_bitsliced) {
+        for (size_t i = 0; i < 10; i++) {
+            soft_aes_expand_key_x8(keys.k[i], keys.bs + i * 8);
+        }
+    }
+}
+
+
+template<bool SOFT_AES>
+void aes_rounds(const cn_aes_keys &keys, __m128i* x0, __m128i* x1, __m128i* x2, __m128i* x3, __m128i* x4, __m128i* x5, __m128i* x6, __m128i* x7);
+
+template<>
+inline NOINLINE void aes_rounds<true>(const cn_aes_keys &keys, __m128i* x0, __m128i* x1, __m128i* x2, __m128i* x3, __m128i* x4, __m128i* x5, __m128i* x6, __m128i* x7)
+{
+    if (!soft_aes_bitsliced) {
+        for (size_t i = 0; i < 10; i++) {
+            aes_round<true>(keys.k[i], x0, x1, x2, x3, x4, x5, x6, x7);
+        }
+
+        return;
+    }
+
+    __m128i q[8] = { *x0, *x1, *x2, *x3, *x4, *x5, *x6, *x7 };
+
+    soft_aes_ortho(q);
+
+    for (size_t i = 0; i < 10; i++) {
+        soft_aesenc_x8(q, keys.bs + i * 8);
+    }
+
+    soft_aes_ortho(q);
+
+    *x0 = q[0];
+    *x1 = q[1];
+    *x2 = q[2];
+    *x3 = q[3];
+    *x4 = q[4];
+    *x5 = q[5];
+    *x6 = q[6];
+    *x7 = q[7];
+}
+
+template<>
+FORCEINLINE void aes_rounds<false>(const cn_aes_keys &keys, __m128i* x0, __m128i* x1, __m128i* x2, __m128i* x3, __m128i* x4, __m128i* x5, __m128i* x6, __m128i* x7)
+{
+    aes_round<false>(keys.k[0], x0, x1, x2, x3, x4, x5, x6, x7);
+    aes_round<false>(keys.k[1], x0, x1, x2, x3, x4, x5, x6, x7);
+    aes_round<false>(keys.k[2], x0, x1, x2, x3, x4, x5, x6, x7);
+    aes_round<false>(keys.k[3], x0, x1, x2, x3, x4, x5, x6, x7);
+    aes_round<false>(keys.k[4], x0, x1, x2, x3, x4, x5, x6, x7);
+    aes_round<false>(keys.k[5], x0, x1, x2, x3, x4, x5, x6, x7);
+    aes_round<false>(keys.k[6], x0, x1, x2, x3, x4, x5, x6, x7);
+    aes_round<false>(keys.k[7], x0, x1, x2, x3, x4, x5, x6, x7);
+    aes_round<false>(keys.k[8], x0, x1, x2, x3, x4, x5, x6, x7);
+    aes_round<false>(keys.k[9], x0, x1, x2, x3, x4, x5, x6, x7);
+}
+
 inline void mix_and_propagate(__m128i& x0, __m128i& x1, __m128i& x2, __m128i& x3, __m128i& x4, __m128i& x5, __m128i& x6, __m128i& x7)
 {
     __m128i tmp0 = x0;
@@ -307,9 +385,9 @@ template<xmrig::Algo ALGO, size_t MEM, bool SOFT_AES>
 static inline void cn_explode_scratchpad(const __m128i *input, __m128i *output)
 {
     __m128i xin0, xin1, xin2, xin3, xin4, xin5, xin6, xin7;
-    __m128i k0, k1, k2, k3, k4, k5, k6, k7, k8, k9;
+    cn_aes_keys keys;
 
-    aes_genkey<SOFT_AES>(input, &k0, &k1, &k2, &k3, &k4, &k5, &k6, &k7, &k8, &k9);
+    cn_aes_keys_init<SOFT_AES>(input, keys);
 
     xin0 = _mm_load_si128(input + 4);
     xin1 = _mm_load_si128(input + 5);
@@ -322,32 +400,14 @@ static inline void cn_explode_scratchpad(const __m128i *input, __m128i *output)
 
     if (ALGO == xmrig::CRYPTONIGHT_HEAVY) {
         for (size_t i = 0; i < 16; i++) {
-            aes_round<SOFT_AES>(k0, &xin0, &xin1, &xin2, &xin3, &xin4, &xin5, &xin6, &xin7);
-            aes_round<SOFT_AES>(k1, &xin0, &xin1, &xin2, &xin3, &xin4, &xin5, &xin6, &xin7);
-            aes_round<SOFT_AES>(k2, &xin0, &xin1, &xin2, &xin3, &xin4, &xin5, &xin6, &xin7);
-            aes_round<SOFT_AES>(k3, &xin0, &xin1, &xin2, &xin3, &xin4, &xin5, &xin6, &xin7);
-            aes_round<SOFT_AES>(k4, &xin0, &xin1, &xin2, &xin3, &xin4, &xin5, &xin6, &xin7);
-            aes_round<SOFT_AES>(k5, &xin0, &xin1, &xin2, &xin3, &xin4, &xin5, &xin6, &xin7);
-            aes_round<SOFT_AES>(k6, &xin0, &xin1, &xin2, &xin3, &xin4, &xin5, &xin6, &xin7);
-            aes_round<SOFT_AES>(k7, &xin0, &xin1, &xin2, &xin3, &xin4, &xin5, &xin6, &xin7);
-            aes_round<SOFT_AES>(k8, &xin0, &xin1, &xin2, &xin3, &xin4, &xin5, &xin6, &xin7);
-            aes_round<SOFT_AES>(k9, &xin0, &xin1, &xin2, &xin3, &xin4, &xin5, &xin6, &xin7);
+            aes_rounds<SOFT_AES>(keys, &xin0, &xin1, &xin2, &xin3, &xin4, &xin5, &xin6, &xin7);
 
             mix_and_propagate(xin0, xin1, xin2, xin3, xin4, xin5, xin6, xin7);
         }
     }
 
     for (size_t i = 0; i < MEM / sizeof(__m128i); i += 8) {
-        aes_round<SOFT_AES>(k0, &xin0, &xin1, &xin2, &xin3, &xin4, &xin5, &xin6, &xin7);
-        aes_round<SOFT_AES>(k1, &xin0, &xin1, &xin2, &xin3, &xin4, &xin5, &xin6, &xin7);
-        aes_round<SOFT_AES>(k2, &xin0, &xin1, &xin2, &xin3, &xin4, &xin5, &xin6, &xin7);
-        aes_round<SOFT_AES>(k3, &xin0, &xin1, &xin2, &xin3, &xin4, &xin5, &xin6, &xin7);
-        aes_round<SOFT_AES>(k4, &xin0, &xin1, &xin2, &xin3, &xin4, &xin5, &xin6, &xin7);
-        aes_round<SOFT_AES>(k5, &xin0, &xin1, &xin2, &xin3, &xin4, &xin5, &xin6, &xin7);
-        aes_round<SOFT_AES>(k6, &xin0, &xin1, &xin2, &xin3, &xin4, &xin5, &xin6, &xin7);
-        aes_round<SOFT_AES>(k7, &xin0, &xin1, &xin2, &xin3, &xin4, &xin5, &xin6, &xin7);
-        aes_round<SOFT_AES>(k8, &xin0, &xin1, &xin2, &xin3, &xin4, &xin5, &xin6, &xin7);
-        aes_round<SOFT_AES>(k9, &xin0, &xin1, &xin2, &xin3, &xin4, &xin5, &xin6, &xin7);
+        aes_rounds<SOFT_AES>(keys, &xin0, &xin1, &xin2, &xin3, &xin4, &xin5, &xin6, &xin7);
 
         _mm_store_si128(output + i + 0, xin0);
         _mm_store_si128(output + i + 1, xin1);
@@ -393,9 +453,9 @@ template<xmrig::Algo ALGO, size_t MEM, bool SOFT_AES>
 static inline void cn_implode_scratchpad(const __m128i *input, __m128i *output)
 {
     __m128i xout0, xout1, xout2, xout3, xout4, xout5, xout6, xout7;
-    __m128i k0, k1, k2, k3, k4, k5, k6, k7, k8, k9;
+    cn_aes_keys keys;
 
-    aes_genkey<SOFT_AES>(output + 2, &k0, &k1, &k2, &k3, &k4, &k5, &k6, &k7, &k8, &k9);
+    cn_aes_keys_init<SOFT_AES>(output + 2, keys);
 
     xout0 = _mm_load_si128(output + 4);
     xout1 = _mm_load_si128(output + 5);
@@ -417,16 +477,7 @@ static inline void cn_implode_scratchpad(const __m128i *input, __m128i *output)
         xout6 = _mm_xor_si128(_mm_load_si128(input + i + 6), xout6);
         xout7 = _mm_xor_si128(_mm_load_si128(input + i + 7), xout7);
 
-        aes_round<SOFT_AES>(k0, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
-        aes_round<SOFT_AES>(k1, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
-        aes_round<SOFT_AES>(k2, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
-        aes_round<SOFT_AES>(k3, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
-        aes_round<SOFT_AES>(k4, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
-        aes_round<SOFT_AES>(k5, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
-        aes_round<SOFT_AES>(k6, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
-        aes_round<SOFT_AES>(k7, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
-        aes_round<SOFT_AES>(k8, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
-        aes_round<SOFT_AES>(k9, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
+        aes_rounds<SOFT_AES>(keys, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
 
         if (ALGO == xmrig::CRYPTONIGHT_HEAVY) {
             mix_and_propagate(xout0, xout1, xout2, xout3, xout4, xout5, xout6, xout7);
@@ -444,31 +495,13 @@ static inline void cn_implode_scratchpad(const __m128i *input, __m128i *output)
             xout6 = _mm_xor_si128(_mm_load_si128(input + i + 6), xout6);
             xout7 = _mm_xor_si128(_mm_load_si128(input + i + 7), xout7);
 
-            aes_round<SOFT_AES>(k0, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
-            aes_round<SOFT_AES>(k1, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
-            aes_round<SOFT_AES>(k2, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
-            aes_round<SOFT_AES>(k3, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
-            aes_round<SOFT_AES>(k4, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
-            aes_round<SOFT_AES>(k5, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
-            aes_round<SOFT_AES>(k6, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
-            aes_round<SOFT_AES>(k7, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
-            aes_round<SOFT_AES>(k8, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
-            aes_round<SOFT_AES>(k9, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
+            aes_rounds<SOFT_AES>(keys, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
 
             mix_and_propagate(xout0, xout1, xout2, xout3, xout4, xout5, xout6, xout7);
         }
 
         for (size_t i = 0; i < 16; i++) {
-            aes_round<SOFT_AES>(k0, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
-            aes_round<SOFT_AES>(k1, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
-            aes_round<SOFT_AES>(k2, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
-            aes_round<SOFT_AES>(k3, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
-            aes_round<SOFT_AES>(k4, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
-            aes_round<SOFT_AES>(k5, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
-            aes_round<SOFT_AES>(k6, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
-            aes_round<SOFT_AES>(k7, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
-            aes_round<SOFT_AES>(k8, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
-            aes_round<SOFT_AES>(k9, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
+            aes_rounds<SOFT_AES>(keys, &xout0, &xout1, &xout2, &xout3, &xout4, &xout5, &xout6, &xout7);
 
             mix_and_propagate(xout0, xout1, xout2, xout3, xout4, xout5, xout6, xout7);
         }
@@ -531,7 +564,7 @@ template<xmrig::Variant VARIANT, xmrig::Variant BASE>
 static inline void cryptonight_monero_tweak(uint64_t* mem_out, const uint8_t* l, uint64_t idx, __m128i ax0, __m128i bx0, __m128i bx1, __m128i& cx)
 {
     if (BASE == xmrig::VARIANT_2) {
-        VARIANT2_SHUFFLE(l, idx, ax0, bx0, bx1, cx, (VARIANT == xmrig::VARIANT_RWZ ? 1 : 0));
+        VARIANT2_SHUFFLE(l, idx, ax0, bx0, bx1, cx, (xmrig::cn_is_reversed_shuffle<VARIANT>() ? 1 : 0));
         _mm_store_si128((__m128i *)mem_out, _mm_xor_si128(bx0, cx));
     } else {
         __m128i tmp = _mm_xor_si128(bx0, cx);
@@ -549,9 +582,6 @@ static inline void cryptonight_monero_tweak(uint64_t* mem_out, const uint8_t* l,
     }
 }
 
-void wow_soft_aes_compile_code(const V4_Instruction* code, int code_size, void* machine_code, xmrig::Assembly ASM);
-void v4_soft_aes_compile_code(const V4_Instruction* code, int code_size, void* machine_code, xmrig::Assembly ASM);
-
 template<xmrig::Algo ALGO, bool SOFT_AES, xmrig::Variant VARIANT>
 inline void cryptonight_single_hash(const uint8_t *__restrict__ input, size_t size, uint8_t *__restrict__ output, cryptonight_ctx **__restrict__ ctx, uint64_t height)
 {
@@ -577,16 +607,7 @@ inline void cryptonight_single_hash(const uint8_t *__restrict__ input, size_t si
     if (SOFT_AES && xmrig::cn_is_cryptonight_r<VARIANT>())
     {
         if (!ctx[0]->generated_code_data.match(VARIANT, height)) {
-            V4_Instruction code[256];
-            const int code_size = v4_random_math_init<VARIANT>(code, height);
-
-            if (VARIANT == xmrig::VARIANT_WOW)
-                wow_soft_aes_compile_code(code, code_size, reinterpret_cast<void*>(ctx[0]->generated_code), xmrig::ASM_NONE);
-            else if (VARIANT == xmrig::VARIANT_4)
-                v4_soft_aes_compile_code(code, code_size, reinterpret_cast<void*>(ctx[0]->generated_code), xmrig::ASM_NONE);
-
-            ctx[0]->generated_code_data.variant = VARIANT;
-            ctx[0]->generated_code_data.height = height;
+            CryptonightR_update_code(ctx[0], VARIANT, height, CRYPTONIGHTR_CODE_SOFT_AES, xmrig::ASM_NONE);
         }
 
         ctx[0]->saes_table = (const uint32_t*)saes_table;
@@ -655,7 +676,7 @@ inline void cryptonight_single_hash(const uint8_t *__restrict__ input, size_t si
             if (VARIANT == xmrig::VARIANT_4) {
                 VARIANT2_SHUFFLE(l0, idx0 & MASK, ax0, bx0, bx1, cx, 0);
             } else {
-                VARIANT2_SHUFFLE2(l0, idx0 & MASK, ax0, bx0, bx1, hi, lo, (VARIANT == xmrig::VARIANT_RWZ ? 1 : 0));
+                VARIANT2_SHUFFLE2(l0, idx0 & MASK, ax0, bx0, bx1, hi, lo, (xmrig::cn_is_reversed_shuffle<VARIANT>() ? 1 : 0));
             }
         }
 
@@ -709,6 +730,10 @@ inline void cryptonight_single_hash(const uint8_t *__restrict__ input, size_t si
 
 
 #ifndef XMRIG_NO_CN_GPU
+template<size_t ITER, uint32_t MASK>
+void cn_gpu_inner_avx512(const uint8_t *spad, uint8_t *lpad);
+
+
 template<size_t ITER, uint32_t MASK>
 void cn_gpu_inner_avx(const uint8_t *spad, uint8_t *lpad);
 
@@ -735,7 +760,9 @@ inline void cryptonight_single_hash_gpu(const uint8_t *__restrict__ input, size_
     fesetround(FE_TONEAREST);
 #   endif
 
-    if (xmrig::Cpu::info()->hasAVX2()) {
+    if (xmrig::Cpu::info()->hasAVX512()) {
+        cn_gpu_inner_avx512<ITERATIONS, MASK>(ctx[0]->state, ctx[0]->memory);
+    } else if (xmrig::Cpu::info()->hasAVX2()) {
         cn_gpu_inner_avx<ITERATIONS, MASK>(ctx[0]->state, ctx[0]->memory);
     } else {
         cn_gpu_inner_ssse3<ITERATIONS, MASK>(ctx[0]->state, ctx[0]->memory);
@@ -777,46 +804,13 @@ extern xmrig::CpuThread::cn_mainloop_fun        cn_double_mainloop_ryzen_asm;
 extern xmrig::CpuThread::cn_mainloop_fun        cn_double_mainloop_bulldozer_asm;
 extern xmrig::CpuThread::cn_mainloop_fun        cn_double_double_mainloop_sandybridge_asm;
 
-void wow_compile_code(const V4_Instruction* code, int code_size, void* machine_code, xmrig::Assembly ASM);
-void v4_compile_code(const V4_Instruction* code, int code_size, void* machine_code, xmrig::Assembly ASM);
-void wow_compile_code_double(const V4_Instruction* code, int code_size, void* machine_code, xmrig::Assembly ASM);
-void v4_compile_code_double(const V4_Instruction* code, int code_size, void* machine_code, xmrig::Assembly ASM);
-
-template<xmrig::Variant VARIANT>
-void cn_r_compile_code(const V4_Instruction* code, int code_size, void* machine_code, xmrig::Assembly ASM)
-{
-    v4_compile_code(code, code_size, machine_code, ASM);
-}
-
-template<xmrig::Variant VARIANT>
-void cn_r_compile_code_double(const V4_Instruction* code, int code_size, void* machine_code, xmrig::Assembly ASM)
-{
-    v4_compile_code_double(code, code_size, machine_code, ASM);
-}
-
-template<>
-void cn_r_compile_code<xmrig::VARIANT_WOW>(const V4_Instruction* code, int code_size, void* machine_code, xmrig::Assembly ASM)
-{
-    wow_compile_code(code, code_size, machine_code, ASM);
-}
-
-template<>
-void cn_r_compile_code_double<xmrig::VARIANT_WOW>(const V4_Instruction* code, int code_size, void* machine_code, xmrig::Assembly ASM)
-{
-    wow_compile_code_double(code, code_size, machine_code, ASM);
-}
-
 template<xmrig::Algo ALGO, xmrig::Variant VARIANT, xmrig::Assembly ASM>
 inline void cryptonight_single_hash_asm(const uint8_t *__restrict__ input, size_t size, uint8_t *__restrict__ output, cryptonight_ctx **__restrict__ ctx, uint64_t height)
 {
     constexpr size_t MEM = xmrig::cn_select_memory<ALGO>();
 
     if (xmrig::cn_is_cryptonight_r<VARIANT>() && !ctx[0]->generated_code_data.match(VARIANT, height)) {
-        V4_Instruction code[256];
-        const int code_size = v4_random_math_init<VARIANT>(code, height);
-        cn_r_compile_code<VARIANT>(code, code_size, reinterpret_cast<void*>(ctx[0]->generated_code), ASM);
-        ctx[0]->generated_code_data.variant = VARIANT;
-        ctx[0]->generated_code_data.height = height;
+        CryptonightR_update_code(ctx[0], VARIANT, height, CRYPTONIGHTR_CODE_SINGLE, ASM);
     }
 
     xmrig::keccak(input, size, ctx[0]->state);
@@ -896,11 +890,7 @@ inline void cryptonight_double_hash_asm(const uint8_t *__restrict__ input, size_
     constexpr size_t MEM = xmrig::cn_select_memory<ALGO>();
 
     if (xmrig::cn_is_cryptonight_r<VARIANT>() && !ctx[0]->generated_code_double_data.match(VARIANT, height)) {
-        V4_Instruction code[256];
-        const int code_size = v4_random_math_init<VARIANT>(code, height);
-        cn_r_compile_code_double<VARIANT>(code, code_size, reinterpret_cast<void*>(ctx[0]->generated_code_double), ASM);
-        ctx[0]->generated_code_double_data.variant = VARIANT;
-        ctx[0]->generated_code_double_data.height = height;
+        CryptonightR_update_code(ctx[0], VARIANT, height, CRYPTONIGHTR_CODE_DOUBLE, ASM);
     }
 
     xmrig::keccak(input,        size, ctx[0]->state);
@@ -1043,7 +1033,7 @@ inline void cryptonight_double_hash(const uint8_t *__restrict__ input, size_t si
             if (VARIANT == xmrig::VARIANT_4) {
                 VARIANT2_SHUFFLE(l0, idx0 & MASK, ax0, bx00, bx01, cx0, 0);
             } else {
-                VARIANT2_SHUFFLE2(l0, idx0 & MASK, ax0, bx00, bx01, hi, lo, (VARIANT == xmrig::VARIANT_RWZ ? 1 : 0));
+                VARIANT2_SHUFFLE2(l0, idx0 & MASK, ax0, bx00, bx01, hi, lo, (xmrig::cn_is_reversed_shuffle<VARIANT>() ? 1 : 0));
             }
         }
 
@@ -1099,7 +1089,7 @@ inline void cryptonight_double_hash(const uint8_t *__restrict__ input, size_t si
             if (VARIANT == xmrig::VARIANT_4) {
                 VARIANT2_SHUFFLE(l1, idx1 & MASK, ax1, bx10, bx11, cx1, 0);
             } else {
-                VARIANT2_SHUFFLE2(l1, idx1 & MASK, ax1, bx10, bx11, hi, lo, (VARIANT == xmrig::VARIANT_RWZ ? 1 : 0));
+                VARIANT2_SHUFFLE2(l1, idx1 & MASK, ax1, bx10, bx11, hi, lo, (xmrig::cn_is_reversed_shuffle<VARIANT>() ? 1 : 0));
             }
         }
 
@@ -1203,7 +1193,7 @@ inline void cryptonight_double_hash(const uint8_t *__restrict__ input, size_t si
         if (VARIANT == xmrig::VARIANT_4) { \
             VARIANT2_SHUFFLE(l, idx & MASK, a, b0, b1, c, 0); \
         } else {                                        \
-            VARIANT2_SHUFFLE2(l, idx & MASK, a, b0, b1, hi, lo, (VARIANT == xmrig::VARIANT_RWZ ? 1 : 0)); \
+            VARIANT2_SHUFFLE2(l, idx & MASK, a, b0, b1, hi, lo, (xmrig::cn_is_reversed_shuffle<VARIANT>() ? 1 : 0)); \
         } \
     }                                                   \
     if (VARIANT == xmrig::VARIANT_4) { \
@@ -1274,8 +1264,16 @@ inline void cryptonight_triple_hash(const uint8_t *__restrict__ input, size_t si
         return;
     }
 
+    uint8_t *states[3];
+    uint64_t *words[3];
+    for (size_t i = 0; i < 3; i++) {
+        states[i] = ctx[i]->state;
+        words[i]  = reinterpret_cast<uint64_t*>(ctx[i]->state);
+    }
+
+    xmrig::keccak(input, size, states, 3);
+
     for (size_t i = 0; i < 3; i++) {
-        xmrig::keccak(input + size * i, size, ctx[i]->state);
         cn_explode_scratchpad<ALGO, MEM, SOFT_AES>(reinterpret_cast<__m128i*>(ctx[i]->state), reinterpret_cast<__m128i*>(ctx[i]->memory));
     }
 
@@ -1319,7 +1317,11 @@ inline void cryptonight_triple_hash(const uint8_t *__restrict__ input, size_t si
 
     for (size_t i = 0; i < 3; i++) {
         cn_implode_scratchpad<ALGO, MEM, SOFT_AES>(reinterpret_cast<__m128i*>(ctx[i]->memory), reinterpret_cast<__m128i*>(ctx[i]->state));
-        xmrig::keccakf(reinterpret_cast<uint64_t*>(ctx[i]->state), 24);
+    }
+
+    xmrig::keccakf(words, 3, 24);
+
+    for (size_t i = 0; i < 3; i++) {
         extra_hashes[ctx[i]->state[0] & 3](ctx[i]->state, 200, output + 32 * i);
     }
 }
@@ -1338,8 +1340,16 @@ inline void cryptonight_quad_hash(const uint8_t *__restrict__ input, size_t size
         return;
     }
 
+    uint8_t *states[4];
+    uint64_t *words[4];
+    for (size_t i = 0; i < 4; i++) {
+        states[i] = ctx[i]->state;
+        words[i]  = reinterpret_cast<uint64_t*>(ctx[i]->state);
+    }
+
+    xmrig::keccak(input, size, states, 4);
+
     for (size_t i = 0; i < 4; i++) {
-        xmrig::keccak(input + size * i, size, ctx[i]->state);
         cn_explode_scratchpad<ALGO, MEM, SOFT_AES>(reinterpret_cast<__m128i*>(ctx[i]->state), reinterpret_cast<__m128i*>(ctx[i]->memory));
     }
 
@@ -1392,7 +1402,11 @@ inline void cryptonight_quad_hash(const uint8_t *__restrict__ input, size_t size
 
     for (size_t i = 0; i < 4; i++) {
         cn_implode_scratchpad<ALGO, MEM, SOFT_AES>(reinterpret_cast<__m128i*>(ctx[i]->memory), reinterpret_cast<__m128i*>(ctx[i]->state));
-        xmrig::keccakf(reinterpret_cast<uint64_t*>(ctx[i]->state), 24);
+    }
+
+    xmrig::keccakf(words, 4, 24);
+
+    for (size_t i = 0; i < 4; i++) {
         extra_hashes[ctx[i]->state[0] & 3](ctx[i]->state, 200, output + 32 * i);
     }
 }
@@ -1411,8 +1425,16 @@ inline void cryptonight_penta_hash(const uint8_t *__restrict__ input, size_t siz
         return;
     }
 
+    uint8_t *states[5];
+    uint64_t *words[5];
+    for (size_t i = 0; i < 5; i++) {
+        states[i] = ctx[i]->state;
+        words[i]  = reinterpret_cast<uint64_t*>(ctx[i]->state);
+    }
+
+    xmrig::keccak(input, size, states, 5);
+
     for (size_t i = 0; i < 5; i++) {
-        xmrig::keccak(input + size * i, size, ctx[i]->state);
         cn_explode_scratchpad<ALGO, MEM, SOFT_AES>(reinterpret_cast<__m128i*>(ctx[i]->state), reinterpret_cast<__m128i*>(ctx[i]->memory));
     }
 
@@ -1473,7 +1495,11 @@ inline void cryptonight_penta_hash(const uint8_t *__restrict__ input, size_t siz
 
     for (size_t i = 0; i < 5; i++) {
         cn_implode_scratchpad<ALGO, MEM, SOFT_AES>(reinterpret_cast<__m128i*>(ctx[i]->memory), reinterpret_cast<__m128i*>(ctx[i]->state));
-        xmrig::keccakf(reinterpret_cast<uint64_t*>(ctx[i]->state), 24);
+    }
+
+    xmrig::keccakf(words, 5, 24);
+
+    for (size_t i = 0; i < 5; i++) {
         extra_hashes[ctx[i]->state[0] & 3](ctx[i]->state, 200, output + 32 * i);
     }
 }
@@ -24,7 +24,10 @@
  */
 
 #include <cstring>
+#include <mutex>
+#include "crypto/CryptoNight.h"
 #include "crypto/CryptoNight_monero.h"
+#include "crypto/CryptonightR_gen.h"
 
 typedef void(*void_func)();
 
@@ -185,3 +188,142 @@ void v4_soft_aes_compile_code(const V4_Instruction* code, int code_size, void* m
 
     Mem::flushInstructionCache(machine_code, p - p0);
 }
+
+namespace {
+
+// shared generated code of one variant, height and type, refs are the contexts pointing to it
+struct CodeSlot
+{
+    xmrig::Variant variant;
+    uint64_t height;
+    CryptonightR_code_type type;
+    xmrig::Assembly ASM;
+    uint8_t* code;
+    uint64_t used;
+    int refs;
+};
+
+}
+
+static std::mutex code_mutex;
+static CodeSlot code_slots[CRYPTONIGHTR_CODE_SLOTS];
+static uint8_t* code_memory = nullptr;
+static uint64_t code_clock = 0;
+
+static void compile_code(xmrig::Variant variant, uint64_t height, CryptonightR_code_type type, xmrig::Assembly ASM, void* machine_code)
+{
+    V4_Instruction code[256];
+    const bool wow = (variant == xmrig::VARIANT_WOW);
+    const int code_size = wow ? v4_random_math_init<xmrig::VARIANT_WOW>(code, height) : v4_random_math_init<xmrig::VARIANT_4>(code, height);
+
+    // the code is never executed while it is compiled, so its pages are writable or executable, never both
+    Mem::unprotectExecutableMemory(machine_code, CRYPTONIGHTR_CODE_SIZE);
+
+    switch (type) {
+    case CRYPTONIGHTR_CODE_SINGLE:
+        (wow ? wow_compile_code : v4_compile_code)(code, code_size, machine_code, ASM);
+        break;
+
+    case CRYPTONIGHTR_CODE_DOUBLE:
+        (wow ? wow_compile_code_double : v4_compile_code_double)(code, code_size, machine_code, ASM);
+        break;
+
+    default:
+        (wow ? wow_soft_aes_compile_code : v4_soft_aes_compile_code)(code, code_size, machine_code, ASM);
+        break;
+    }
+
+    Mem::protectExecutableMemory(machine_code, CRYPTONIGHTR_CODE_SIZE);
+}
+
+static inline bool is_slot_code(const void* p)
+{
+    const uint8_t* code = reinterpret_cast<const uint8_t*>(p);
+    return code_memory && (code >= code_memory) && (code < code_memory + CRYPTONIGHTR_CODE_SLOTS * CRYPTONIGHTR_CODE_SIZE);
+}
+
+static void release_slot(const void* p)
+{
+    if (is_slot_code(p)) {
+        code_slots[(reinterpret_cast<const uint8_t*>(p) - code_memory) / CRYPTONIGHTR_CODE_SIZE].refs--;
+    }
+}
+
+// the matching slot or the least recently used one nobody points to, compiled for the key, code_mutex must be locked
+static CodeSlot* find_slot(xmrig::Variant variant, uint64_t height, CryptonightR_code_type type, xmrig::Assembly ASM)
+{
+    if (!code_memory) {
+        code_memory = reinterpret_cast<uint8_t*>(Mem::allocateExecutableMemory(CRYPTONIGHTR_CODE_SLOTS * CRYPTONIGHTR_CODE_SIZE));
+
+        for (size_t i = 0; i < CRYPTONIGHTR_CODE_SLOTS; ++i) {
+            code_slots[i] = { xmrig::VARIANT_MAX, 0, type, ASM, code_memory + i * CRYPTONIGHTR_CODE_SIZE, 0, 0 };
+        }
+    }
+
+    CodeSlot* unused = nullptr;
+    for (CodeSlot& slot : code_slots) {
+        if ((slot.variant == variant) && (slot.height == height) && (slot.type == type) && (slot.ASM == ASM)) {
+            slot.used = ++code_clock;
+            return &slot;
+        }
+
+        if ((slot.refs == 0) && (!unused || (slot.used < unused->used))) {
+            unused = &slot;
+        }
+    }
+
+    if (unused) {
+        compile_code(variant, height, type, ASM, unused->code);
+
+        unused->variant = variant;
+        unused->height  = height;
+        unused->type    = type;
+        unused->ASM     = ASM;
+        unused->used    = ++code_clock;
+    }
+
+    return unused;
+}
+
+void CryptonightR_update_code(cryptonight_ctx* ctx, xmrig::Variant variant, uint64_t height, CryptonightR_code_type type, xmrig::Assembly ASM)
+{
+    const bool is_double = (type == CRYPTONIGHTR_CODE_DOUBLE);
+    cn_mainloop_fun_ms_abi& fn = is_double ? ctx->generated_code_double : ctx->generated_code;
+    cryptonight_r_data& data = is_double ? ctx->generated_code_double_data : ctx->generated_code_data;
+    void* machine_code = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(code_mutex);
+
+        release_slot(reinterpret_cast<const void*>(fn));
+
+        CodeSlot* slot = find_slot(variant, height, type, ASM);
+        if (slot) {
+            slot->refs++;
+            machine_code = slot->code;
+        }
+    }
+
+    if (!machine_code) {
+        machine_code = ctx->generated_code_page + (is_double ? CRYPTONIGHTR_CODE_SIZE : 0);
+        compile_code(variant, height, type, ASM, machine_code);
+    }
+
+    fn = reinterpret_cast<cn_mainloop_fun_ms_abi>(machine_code);
+    data.variant = variant;
+    data.height = height;
+}
+
+void CryptonightR_prepare_code(xmrig::Variant variant, uint64_t height, CryptonightR_code_type type, xmrig::Assembly ASM)
+{
+    std::lock_guard<std::mutex> lock(code_mutex);
+    find_slot(variant, height, type, ASM);
+}
+
+void CryptonightR_release_code(cryptonight_ctx* ctx)
+{
+    std::lock_guard<std::mutex> lock(code_mutex);
+
+    release_slot(reinterpret_cast<const void*>(ctx->generated_code));
+    release_slot(reinterpret_cast<const void*>(ctx->generated_code_double));
+}
@@ -0,0 +1,72 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_CRYPTONIGHTR_GEN_H
+#define XMRIG_CRYPTONIGHTR_GEN_H
+
+
+#include <stdint.h>
+
+
+#include "common/xmrig.h"
+
+
+struct cryptonight_ctx;
+struct V4_Instruction;
+
+
+enum CryptonightR_code_type
+{
+    CRYPTONIGHTR_CODE_SINGLE,
+    CRYPTONIGHTR_CODE_DOUBLE,
+    CRYPTONIGHTR_CODE_SOFT_AES,
+    CRYPTONIGHTR_CODE_MAX
+};
+
+
+enum
+{
+    CRYPTONIGHTR_CODE_SLOTS = 16,
+    CRYPTONIGHTR_CODE_SIZE  = 0x2000,
+};
+
+
+// points the generated code of ctx to the shared code of the variant and height, compiled once per process,
+// the context's own page is used only when all cache slots are held by other contexts
+void CryptonightR_update_code(cryptonight_ctx* ctx, xmrig::Variant variant, uint64_t height, CryptonightR_code_type type, xmrig::Assembly ASM);
+
+// compiles the code of the variant and height ahead of time, so the first hash at that height has nothing to compile
+void CryptonightR_prepare_code(xmrig::Variant variant, uint64_t height, CryptonightR_code_type type, xmrig::Assembly ASM);
+
+// releases the cache slots held by ctx, called before it is freed
+void CryptonightR_release_code(cryptonight_ctx* ctx);
+
+void wow_compile_code(const V4_Instruction* code, int code_size, void* machine_code, xmrig::Assembly ASM);
+void v4_compile_code(const V4_Instruction* code, int code_size, void* machine_code, xmrig::Assembly ASM);
+void wow_compile_code_double(const V4_Instruction* code, int code_size, void* machine_code, xmrig::Assembly ASM);
+void v4_compile_code_double(const V4_Instruction* code, int code_size, void* machine_code, xmrig::Assembly ASM);
+void wow_soft_aes_compile_code(const V4_Instruction* code, int code_size, void* machine_code, xmrig::Assembly ASM);
+void v4_soft_aes_compile_code(const V4_Instruction* code, int code_size, void* machine_code, xmrig::Assembly ASM);
+
+#endif /* XMRIG_CRYPTONIGHTR_GEN_H */
@@ -13,6 +13,10 @@
 #include <stdint.h>
 #include "c_blake256.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#   include <emmintrin.h>
+#endif
+
 #define U8TO32(p) \
     (((uint32_t)((p)[0]) << 24) | ((uint32_t)((p)[1]) << 16) |    \
      ((uint32_t)((p)[2]) <<  8) | ((uint32_t)((p)[3])      ))
@@ -50,6 +54,56 @@ static const uint8_t padding[] = {
 };
 
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+/* SSE2 version, the 4 G functions of a column or diagonal step run in the lanes of the rows */
+#define ROT_SSE2(x,n) _mm_or_si128(_mm_slli_epi32((x), 32 - (n)), _mm_srli_epi32((x), (n)))
+#define MC_SSE2(e0,e1,e2,e3,k0,k1) _mm_set_epi32(                                               \
+    (int)(m[sigma[i][e3+k0]] ^ cst[sigma[i][e3+k1]]), (int)(m[sigma[i][e2+k0]] ^ cst[sigma[i][e2+k1]]), \
+    (int)(m[sigma[i][e1+k0]] ^ cst[sigma[i][e1+k1]]), (int)(m[sigma[i][e0+k0]] ^ cst[sigma[i][e0+k1]]))
+#define G_SSE2(e0,e1,e2,e3)                                      \
+    r0 = _mm_add_epi32(_mm_add_epi32(r0, MC_SSE2(e0,e1,e2,e3,0,1)), r1); \
+    r3 = ROT_SSE2(_mm_xor_si128(r3, r0), 16);                    \
+    r2 = _mm_add_epi32(r2, r3);                                  \
+    r1 = ROT_SSE2(_mm_xor_si128(r1, r2), 12);                    \
+    r0 = _mm_add_epi32(_mm_add_epi32(r0, MC_SSE2(e0,e1,e2,e3,1,0)), r1); \
+    r3 = ROT_SSE2(_mm_xor_si128(r3, r0), 8);                     \
+    r2 = _mm_add_epi32(r2, r3);                                  \
+    r1 = ROT_SSE2(_mm_xor_si128(r1, r2), 7);
+
+void blake256_compress(state *S, const uint8_t *block) {
+    uint32_t m[16], i;
+    __m128i r0, r1, r2, r3;
+    const __m128i s = _mm_loadu_si128((const __m128i *) S->s);
+
+    for (i = 0; i < 16; ++i) m[i] = U8TO32(block + i * 4);
+
+    r0 = _mm_loadu_si128((const __m128i *) S->h);
+    r1 = _mm_loadu_si128((const __m128i *) (S->h + 4));
+    r2 = _mm_xor_si128(s, _mm_loadu_si128((const __m128i *) cst));
+    r3 = _mm_loadu_si128((const __m128i *) (cst + 4));
+
+    if (S->nullt == 0) {
+        r3 = _mm_xor_si128(r3, _mm_set_epi32((int) S->t[1], (int) S->t[1], (int) S->t[0], (int) S->t[0]));
+    }
+
+    for (i = 0; i < 14; ++i) {
+        G_SSE2(0, 2, 4, 6);
+
+        r1 = _mm_shuffle_epi32(r1, _MM_SHUFFLE(0, 3, 2, 1));
+        r2 = _mm_shuffle_epi32(r2, _MM_SHUFFLE(1, 0, 3, 2));
+        r3 = _mm_shuffle_epi32(r3, _MM_SHUFFLE(2, 1, 0, 3));
+
+        G_SSE2(8, 10, 12, 14);
+
+        r1 = _mm_shuffle_epi32(r1, _MM_SHUFFLE(2, 1, 0, 3));
+        r2 = _mm_shuffle_epi32(r2, _MM_SHUFFLE(1, 0, 3, 2));
+        r3 = _mm_shuffle_epi32(r3, _MM_SHUFFLE(0, 3, 2, 1));
+    }
+
+    _mm_storeu_si128((__m128i *) S->h,       _mm_xor_si128(_mm_loadu_si128((const __m128i *) S->h),       _mm_xor_si128(_mm_xor_si128(r0, r2), s)));
+    _mm_storeu_si128((__m128i *) (S->h + 4), _mm_xor_si128(_mm_loadu_si128((const __m128i *) (S->h + 4)), _mm_xor_si128(_mm_xor_si128(r1, r3), s)));
+}
+#else
 void blake256_compress(state *S, const uint8_t *block) {
     uint32_t v[16], m[16], i;
 
@@ -96,6 +150,7 @@ void blake256_compress(state *S, const uint8_t *block) {
     for (i = 0; i < 16; ++i) S->h[i % 8] ^= v[i];
     for (i = 0; i < 8;  ++i) S->h[i] ^= S->s[i % 4];
 }
+#endif
 
 void blake256_init(state *S) {
     S->h[0] = 0x6A09E667;
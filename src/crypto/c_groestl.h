@@ -51,6 +51,9 @@ void Final(hashState*, BitSequence*); */
 void groestl(const BitSequence*, DataLength, BitSequence*);
 /* NIST API end   */
 
+/* same digest with AES-NI and SSSE3, whole bytes only, c_groestl_aesni.c */
+void groestl_aesni(const BitSequence*, DataLength, BitSequence*);
+
 /*
 int crypto_hash(unsigned char *out,
 		const unsigned char *in,
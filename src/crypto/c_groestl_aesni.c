@@ -0,0 +1,167 @@
+/* Groestl-256 with AES-NI and SSSE3
+ *
+ * Each register holds one row of the P state in its low 8 bytes and the same row of the Q state in its
+ * high 8 bytes. SubBytes of both permutations is AESENCLAST with a zero key, ShiftBytes together with
+ * the undo of the AES ShiftRows is one PSHUFB per row and MixBytes works on whole rows.
+ * The digest is the one of groestl() in c_groestl.c, for messages of whole bytes.
+ */
+
+#include <string.h>
+
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+
+#include "c_groestl.h"
+
+
+#define XTIME(x) _mm_xor_si128(_mm_add_epi8((x), (x)), _mm_and_si128(_mm_cmplt_epi8((x), zero), poly))
+
+
+/* undo of the AES ShiftRows of AESENCLAST and Groestl ShiftBytes of P (low half) and Q (high half) */
+static const int8_t shift_masks[8][16] = {
+    { 0, 13, 10,  7,  4,  1, 14, 11,  5,  2, 15, 12,  9,  6,  3,  8 },
+    {13, 10,  7,  4,  1, 14, 11,  0, 15, 12,  9,  6,  3,  8,  5,  2 },
+    {10,  7,  4,  1, 14, 11,  0, 13,  9,  6,  3,  8,  5,  2, 15, 12 },
+    { 7,  4,  1, 14, 11,  0, 13, 10,  3,  8,  5,  2, 15, 12,  9,  6 },
+    { 4,  1, 14, 11,  0, 13, 10,  7,  8,  5,  2, 15, 12,  9,  6,  3 },
+    { 1, 14, 11,  0, 13, 10,  7,  4,  2, 15, 12,  9,  6,  3,  8,  5 },
+    {14, 11,  0, 13, 10,  7,  4,  1, 12,  9,  6,  3,  8,  5,  2, 15 },
+    {11,  0, 13, 10,  7,  4,  1, 14,  6,  3,  8,  5,  2, 15, 12,  9 }
+};
+
+
+/* 10 rounds of P and Q at once */
+static void permutation(__m128i x[8])
+{
+    const __m128i zero   = _mm_setzero_si128();
+    const __m128i poly   = _mm_set1_epi8(0x1b);
+    const __m128i cols   = _mm_set_epi64x((long long) 0x8f9fafbfcfdfefffULL, 0x7060504030201000LL);
+    const __m128i invert = _mm_set_epi64x(-1LL, 0);
+    __m128i a[8];
+    int r, i;
+
+    for (r = 0; r < 10; r++) {
+        const __m128i c = _mm_xor_si128(cols, _mm_set1_epi8((char) r));
+
+        /* AddRoundConstant, P: row 0 gets (j << 4) ^ r, Q: every byte is inverted, row 7 gets ~(j << 4) ^ r */
+        x[0] = _mm_xor_si128(x[0], _mm_xor_si128(_mm_unpacklo_epi64(c, zero), invert));
+        for (i = 1; i < 7; i++) {
+            x[i] = _mm_xor_si128(x[i], invert);
+        }
+        x[7] = _mm_xor_si128(x[7], _mm_unpackhi_epi64(zero, c));
+
+        /* SubBytes and ShiftBytes */
+        for (i = 0; i < 8; i++) {
+            a[i] = _mm_shuffle_epi8(_mm_aesenclast_si128(x[i], zero), _mm_loadu_si128((const __m128i *) shift_masks[i]));
+        }
+
+        /* MixBytes, row i is the sum of c[k] * row (i + k) with c = (2, 2, 3, 4, 5, 3, 5, 7) */
+        for (i = 0; i < 8; i++) {
+            const __m128i s1 = _mm_xor_si128(_mm_xor_si128(a[(i + 2) & 7], a[(i + 4) & 7]), _mm_xor_si128(_mm_xor_si128(a[(i + 5) & 7], a[(i + 6) & 7]), a[(i + 7) & 7]));
+            const __m128i s2 = _mm_xor_si128(_mm_xor_si128(a[i], a[(i + 1) & 7]), _mm_xor_si128(_mm_xor_si128(a[(i + 2) & 7], a[(i + 5) & 7]), a[(i + 7) & 7]));
+            const __m128i s4 = _mm_xor_si128(_mm_xor_si128(a[(i + 3) & 7], a[(i + 4) & 7]), _mm_xor_si128(a[(i + 6) & 7], a[(i + 7) & 7]));
+
+            x[i] = _mm_xor_si128(s1, XTIME(_mm_xor_si128(s2, XTIME(s4))));
+        }
+    }
+}
+
+
+/* the state is column major, byte 8 * j + i is in row i */
+static void load_rows(const uint8_t *block, uint64_t rows[8])
+{
+    int i, j;
+    uint8_t *r = (uint8_t *) rows;
+
+    for (i = 0; i < 8; i++) {
+        for (j = 0; j < 8; j++) {
+            r[8 * i + j] = block[8 * j + i];
+        }
+    }
+}
+
+
+/* h <- P(h ^ m) ^ Q(m) ^ h */
+static void compress(__m128i h[8], const uint8_t *block)
+{
+    uint64_t m[8];
+    __m128i x[8];
+    int i;
+
+    load_rows(block, m);
+
+    for (i = 0; i < 8; i++) {
+        const __m128i mi = _mm_set1_epi64x((long long) m[i]);
+
+        x[i] = _mm_xor_si128(mi, _mm_unpacklo_epi64(h[i], _mm_setzero_si128()));
+    }
+
+    permutation(x);
+
+    for (i = 0; i < 8; i++) {
+        h[i] = _mm_xor_si128(h[i], _mm_xor_si128(x[i], _mm_unpackhi_epi64(x[i], x[i])));
+    }
+}
+
+
+void groestl_aesni(const BitSequence *data, DataLength databitlen, BitSequence *hashval)
+{
+    __m128i h[8], x[8];
+    uint8_t block[SIZE512];
+    uint8_t rows[SIZE512];
+    uint64_t blocks;
+    size_t len = (size_t) (databitlen / 8);
+    size_t rem;
+    int i, j;
+
+    for (i = 0; i < 8; i++) {
+        h[i] = _mm_setzero_si128();
+    }
+
+    /* initial value 256 in the last 4 bytes big endian, byte 62 is row 6 of column 7 */
+    h[6] = _mm_set_epi64x(0, 0x0100000000000000LL);
+
+    for (blocks = 0; len >= SIZE512; len -= SIZE512, data += SIZE512, blocks++) {
+        compress(h, data);
+    }
+
+    /* padding, a 1 bit, zeros and the number of blocks as 64-bit big endian */
+    memcpy(block, data, len);
+    block[len] = 0x80;
+    rem = len + 1;
+
+    if (rem > SIZE512 - LENGTHFIELDLEN) {
+        memset(block + rem, 0, SIZE512 - rem);
+        compress(h, block);
+        blocks++;
+        rem = 0;
+    }
+
+    memset(block + rem, 0, SIZE512 - LENGTHFIELDLEN - rem);
+    blocks++;
+
+    for (i = 0; i < LENGTHFIELDLEN; i++) {
+        block[SIZE512 - 1 - i] = (uint8_t) (blocks >> (8 * i));
+    }
+
+    compress(h, block);
+
+    /* output transformation h <- P(h) ^ h, the Q half of the rows is ignored */
+    for (i = 0; i < 8; i++) {
+        x[i] = h[i];
+    }
+
+    permutation(x);
+
+    for (i = 0; i < 8; i++) {
+        _mm_storel_epi64((__m128i *) (rows + 8 * i), _mm_xor_si128(h[i], x[i]));
+    }
+
+    /* the digest is columns 4 to 7 */
+    for (j = 4; j < 8; j++) {
+        for (i = 0; i < 8; i++) {
+            hashval[8 * (j - 4) + i] = rows[8 * i + j];
+        }
+    }
+}
@@ -18,6 +18,10 @@
 #include <stdint.h>
 #include <string.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#   include <emmintrin.h>
+#endif
+
 /*typedef unsigned long long uint64;*/
 typedef uint64_t uint64;
 
@@ -149,6 +153,79 @@ HashReturn jh_hash(int hashbitlen, const BitSequence *data,DataLength databitlen
       m2 ^= temp0;                  \
       m6 ^= temp1;
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+/*SSE2 version of E8, the two 64-bit halves of each row of the state share one register*/
+#define SWAP1_SSE2(x)   (x) = _mm_or_si128(_mm_slli_epi64(_mm_and_si128((x), _mm_set1_epi64x(0x5555555555555555LL)), 1), _mm_srli_epi64(_mm_and_si128((x), _mm_set1_epi64x(0xaaaaaaaaaaaaaaaaULL)), 1));
+#define SWAP2_SSE2(x)   (x) = _mm_or_si128(_mm_slli_epi64(_mm_and_si128((x), _mm_set1_epi64x(0x3333333333333333LL)), 2), _mm_srli_epi64(_mm_and_si128((x), _mm_set1_epi64x(0xccccccccccccccccULL)), 2));
+#define SWAP4_SSE2(x)   (x) = _mm_or_si128(_mm_slli_epi64(_mm_and_si128((x), _mm_set1_epi64x(0x0f0f0f0f0f0f0f0fLL)), 4), _mm_srli_epi64(_mm_and_si128((x), _mm_set1_epi64x(0xf0f0f0f0f0f0f0f0ULL)), 4));
+#define SWAP8_SSE2(x)   (x) = _mm_or_si128(_mm_slli_epi16((x), 8), _mm_srli_epi16((x), 8));
+#define SWAP16_SSE2(x)  (x) = _mm_shufflehi_epi16(_mm_shufflelo_epi16((x), 0xb1), 0xb1);
+#define SWAP32_SSE2(x)  (x) = _mm_shuffle_epi32((x), 0xb1);
+#define SWAP64_SSE2(x)  (x) = _mm_shuffle_epi32((x), 0x4e);
+
+#define L_SSE2(m0,m1,m2,m3,m4,m5,m6,m7)      \
+      (m4) = _mm_xor_si128((m4), (m1));      \
+      (m5) = _mm_xor_si128((m5), (m2));      \
+      (m6) = _mm_xor_si128(_mm_xor_si128((m6), (m0)), (m3)); \
+      (m7) = _mm_xor_si128((m7), (m0));      \
+      (m0) = _mm_xor_si128((m0), (m5));      \
+      (m1) = _mm_xor_si128((m1), (m6));      \
+      (m2) = _mm_xor_si128(_mm_xor_si128((m2), (m4)), (m7)); \
+      (m3) = _mm_xor_si128((m3), (m4));
+
+/*_mm_andnot_si128(a, b) is (~a) & b*/
+#define SS_SSE2(m0,m1,m2,m3,m4,m5,m6,m7,cc0,cc1)                   \
+      m3  = _mm_xor_si128((m3), ones);                             \
+      m7  = _mm_xor_si128((m7), ones);                             \
+      m0  = _mm_xor_si128((m0), _mm_andnot_si128((m2), (cc0)));    \
+      m4  = _mm_xor_si128((m4), _mm_andnot_si128((m6), (cc1)));    \
+      temp0 = _mm_xor_si128((cc0), _mm_and_si128((m0), (m1)));     \
+      temp1 = _mm_xor_si128((cc1), _mm_and_si128((m4), (m5)));     \
+      m0  = _mm_xor_si128((m0), _mm_and_si128((m2), (m3)));        \
+      m4  = _mm_xor_si128((m4), _mm_and_si128((m6), (m7)));        \
+      m3  = _mm_xor_si128((m3), _mm_andnot_si128((m1), (m2)));     \
+      m7  = _mm_xor_si128((m7), _mm_andnot_si128((m5), (m6)));     \
+      m1  = _mm_xor_si128((m1), _mm_and_si128((m0), (m2)));        \
+      m5  = _mm_xor_si128((m5), _mm_and_si128((m4), (m6)));        \
+      m2  = _mm_xor_si128((m2), _mm_andnot_si128((m3), (m0)));     \
+      m6  = _mm_xor_si128((m6), _mm_andnot_si128((m7), (m4)));     \
+      m0  = _mm_xor_si128((m0), _mm_or_si128((m1), (m3)));         \
+      m4  = _mm_xor_si128((m4), _mm_or_si128((m5), (m7)));         \
+      m3  = _mm_xor_si128((m3), _mm_and_si128((m1), (m2)));        \
+      m7  = _mm_xor_si128((m7), _mm_and_si128((m5), (m6)));        \
+      m1  = _mm_xor_si128((m1), _mm_and_si128(temp0, (m0)));       \
+      m5  = _mm_xor_si128((m5), _mm_and_si128(temp1, (m4)));       \
+      m2  = _mm_xor_si128((m2), temp0);                            \
+      m6  = _mm_xor_si128((m6), temp1);
+
+#define ROUND_SSE2(r, swap)                                                                              \
+      cc0 = _mm_loadu_si128((const __m128i*)E8_bitslice_roundconstant[r]);                               \
+      cc1 = _mm_loadu_si128((const __m128i*)(E8_bitslice_roundconstant[r] + 16));                        \
+      SS_SSE2(x[0],x[2],x[4],x[6],x[1],x[3],x[5],x[7],cc0,cc1);                                          \
+      L_SSE2(x[0],x[2],x[4],x[6],x[1],x[3],x[5],x[7]);                                                   \
+      swap(x[1]); swap(x[3]); swap(x[5]); swap(x[7]);
+
+static void E8(hashState *state)
+{
+      int i, roundnumber;
+      __m128i x[8], cc0, cc1, temp0, temp1;
+      const __m128i ones = _mm_set1_epi32(-1);
+
+      for (i = 0; i < 8; i++) x[i] = _mm_load_si128((const __m128i*)state->x[i]);
+
+      for (roundnumber = 0; roundnumber < 42; roundnumber = roundnumber+7) {
+            ROUND_SSE2(roundnumber+0, SWAP1_SSE2);
+            ROUND_SSE2(roundnumber+1, SWAP2_SSE2);
+            ROUND_SSE2(roundnumber+2, SWAP4_SSE2);
+            ROUND_SSE2(roundnumber+3, SWAP8_SSE2);
+            ROUND_SSE2(roundnumber+4, SWAP16_SSE2);
+            ROUND_SSE2(roundnumber+5, SWAP32_SSE2);
+            ROUND_SSE2(roundnumber+6, SWAP64_SSE2);
+      }
+
+      for (i = 0; i < 8; i++) _mm_store_si128((__m128i*)state->x[i], x[i]);
+}
+#else
 /*The bijective function E8, in bitslice form*/
 static void E8(hashState *state)
 {
@@ -209,6 +286,7 @@ static void E8(hashState *state)
       }
 
 }
+#endif
 
 /*The compression function F8 */
 static void F8(hashState *state)
@@ -0,0 +1,218 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2019 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "crypto/CryptoNight_constants.h"
+
+#ifdef __GNUC__
+#   include <x86intrin.h>
+#else
+#   include <intrin.h>
+#   define __restrict__ __restrict
+#endif
+
+
+// two double_compute of the AVX2 version share a register, the low half is the first of them,
+// the arithmetic is the same as in cn_gpu_avx.cpp, this file must be compiled without FMA contraction
+static inline __m512 and_ps(const __m512 &x, uint32_t mask) { return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(x), _mm512_set1_epi32(static_cast<int>(mask)))); }
+static inline __m512 or_ps(const __m512 &x, uint32_t bits)  { return _mm512_castsi512_ps(_mm512_or_si512(_mm512_castps_si512(x), _mm512_set1_epi32(static_cast<int>(bits)))); }
+
+
+// the maskz forms with all lanes set are the same instructions, the plain intrinsics of GCC pass an
+// undefined register through and warn once inlined, a cast would also leave the upper half undefined
+static const __mmask8  kAll8  = 0xFF;
+static const __mmask16 kAll16 = 0xFFFF;
+
+
+static inline __m512 join(const __m256 &lo, const __m256 &hi)
+{
+    const __m512d x = _mm512_maskz_insertf64x4(kAll8, _mm512_setzero_pd(), _mm256_castps_pd(lo), 0);
+
+    return _mm512_castpd_ps(_mm512_maskz_insertf64x4(kAll8, x, _mm256_castps_pd(hi), 1));
+}
+
+
+static inline __m256 low(const __m512 &x)  { return _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(kAll8, _mm512_castps_pd(x), 0)); }
+static inline __m256 high(const __m512 &x) { return _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(kAll8, _mm512_castps_pd(x), 1)); }
+
+
+static inline __m512 fma_break(const __m512 &x)
+{
+    // Break the dependency chain by setitng the exp to ?????01
+    return or_ps(and_ps(x, 0xFEFFFFFF), 0x00800000);
+}
+
+
+static inline void sub_round(const __m512 &n0, const __m512 &n1, const __m512 &n2, const __m512 &n3, const __m512 &rnd_c, __m512 &n, __m512 &d, __m512 &c)
+{
+    __m512 nn = _mm512_mul_ps(n0, c);
+    nn = _mm512_mul_ps(_mm512_add_ps(n1, c), _mm512_mul_ps(nn, nn));
+    nn = fma_break(nn);
+    n = _mm512_add_ps(n, nn);
+
+    __m512 dd = _mm512_mul_ps(n2, c);
+    dd = _mm512_mul_ps(_mm512_sub_ps(n3, c), _mm512_mul_ps(dd, dd));
+    dd = fma_break(dd);
+    d = _mm512_add_ps(d, dd);
+
+    //Constant feedback
+    c = _mm512_add_ps(c, rnd_c);
+    c = _mm512_add_ps(c, _mm512_set1_ps(0.734375f));
+    __m512 r = _mm512_add_ps(nn, dd);
+    r = or_ps(and_ps(r, 0x807FFFFF), 0x40000000);
+    c = _mm512_add_ps(c, r);
+}
+
+
+static inline void round_compute(const __m512 &n0, const __m512 &n1, const __m512 &n2, const __m512 &n3, const __m512 &rnd_c, __m512 &c, __m512 &r)
+{
+    __m512 n = _mm512_setzero_ps(), d = _mm512_setzero_ps();
+
+    sub_round(n0, n1, n2, n3, rnd_c, n, d, c);
+    sub_round(n1, n2, n3, n0, rnd_c, n, d, c);
+    sub_round(n2, n3, n0, n1, rnd_c, n, d, c);
+    sub_round(n3, n0, n1, n2, rnd_c, n, d, c);
+    sub_round(n3, n2, n1, n0, rnd_c, n, d, c);
+    sub_round(n2, n1, n0, n3, rnd_c, n, d, c);
+    sub_round(n1, n0, n3, n2, rnd_c, n, d, c);
+    sub_round(n0, n3, n2, n1, rnd_c, n, d, c);
+
+    // Make sure abs(d) > 2.0 - this prevents division by zero and accidental overflows by division by < 1.0
+    d = or_ps(and_ps(d, 0xFF7FFFFF), 0x40000000);
+    r = _mm512_add_ps(r, _mm512_div_ps(n, d));
+}
+
+
+template<size_t rot>
+static inline __m256i rotate(const __m256i &r)
+{
+    return rot == 0 ? r : _mm256_or_si256(_mm256_bslli_epi128(r, 16 - rot), _mm256_bsrli_epi128(r, rot));
+}
+
+
+// double_compute_wrap<rot> and <rot + 1> of the AVX2 version, the sum is r of the first plus r of the second
+template<size_t rot>
+static inline void double_compute_pair(const __m512 &n0, const __m512 &n1, const __m512 &n2, const __m512 &n3, const __m512 &cnt, const __m512 &rnd_c, __m256 &sum, __m256i &out)
+{
+    __m512 c = cnt;
+    __m512 r = _mm512_setzero_ps();
+
+    round_compute(n0, n1, n2, n3, rnd_c, c, r);
+    round_compute(n0, n1, n2, n3, rnd_c, c, r);
+    round_compute(n0, n1, n2, n3, rnd_c, c, r);
+    round_compute(n0, n1, n2, n3, rnd_c, c, r);
+
+    // do a quick fmod by setting exp to 2
+    r = or_ps(and_ps(r, 0x807FFFFF), 0x40000000);
+
+    sum = _mm256_add_ps(low(r), high(r));
+
+    const __m512i v = _mm512_maskz_cvttps_epi32(kAll16, _mm512_mul_ps(r, _mm512_set1_ps(536870880.0f)));
+
+    out = _mm256_xor_si256(out, rotate<rot>(_mm512_maskz_extracti64x4_epi64(kAll8, v, 0)));
+    out = _mm256_xor_si256(out, rotate<rot + 1>(_mm512_maskz_extracti64x4_epi64(kAll8, v, 1)));
+}
+
+
+static inline __m256 cnt(float l, float h) { return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(l)), _mm_set1_ps(h), 1); }
+
+
+template<uint32_t MASK>
+static inline __m256i *scratchpad_ptr(uint8_t *lpad, uint32_t idx, size_t n) { return reinterpret_cast<__m256i*>(lpad + (idx & MASK) + n * 16); }
+
+
+template<size_t ITER, uint32_t MASK>
+void cn_gpu_inner_avx512(const uint8_t *spad, uint8_t *lpad)
+{
+    uint32_t s = reinterpret_cast<const uint32_t*>(spad)[0] >> 8;
+    __m256i *idx0 = scratchpad_ptr<MASK>(lpad, s, 0);
+    __m256i *idx2 = scratchpad_ptr<MASK>(lpad, s, 2);
+    __m256 sum0 = _mm256_setzero_ps();
+
+    const __m512 cnt0 = join(cnt(1.3437500f, 1.4296875f), cnt(1.2812500f, 1.3984375f));
+    const __m512 cnt1 = join(cnt(1.3593750f, 1.3828125f), cnt(1.3671875f, 1.3046875f));
+    const __m512 cnt2 = join(cnt(1.4140625f, 1.3203125f), cnt(1.2734375f, 1.3515625f));
+    const __m512 cnt3 = join(cnt(1.2578125f, 1.3359375f), cnt(1.2890625f, 1.4609375f));
+
+    for (size_t i = 0; i < ITER; i++) {
+        const __m512 rc = join(sum0, sum0);
+
+        const __m256i v01 = _mm256_load_si256(idx0);
+        const __m256i v23 = _mm256_load_si256(idx2);
+        const __m256 n01  = _mm256_cvtepi32_ps(v01);
+        const __m256 n23  = _mm256_cvtepi32_ps(v23);
+
+        const __m256 n10 = _mm256_permute2f128_ps(n01, n01, 0x01);
+        const __m256 n22 = _mm256_permute2f128_ps(n23, n23, 0x00);
+        const __m256 n33 = _mm256_permute2f128_ps(n23, n23, 0x11);
+        const __m256 n11 = _mm256_permute2f128_ps(n01, n01, 0x11);
+        const __m256 n02 = _mm256_permute2f128_ps(n01, n23, 0x20);
+        const __m256 n30 = _mm256_permute2f128_ps(n01, n23, 0x03);
+
+        const __m512 a01 = join(n01, n01);
+        const __m512 a23 = join(n23, n23);
+
+        __m256 suma, sumb, sum1;
+        __m256i out  = _mm256_setzero_si256();
+        __m256i out2 = _mm256_setzero_si256();
+
+        double_compute_pair<0>(a01, join(n10, n22), join(n22, n33), join(n33, n10), cnt0, rc, suma, out);
+        double_compute_pair<2>(a01, join(n33, n33), join(n10, n22), join(n22, n10), cnt1, rc, sumb, out);
+        _mm256_store_si256(idx0, _mm256_xor_si256(v01, out));
+        sum0 = _mm256_add_ps(suma, sumb);
+
+        double_compute_pair<0>(a23, join(n11, n02), join(n02, n30), join(n30, n11), cnt2, rc, suma, out2);
+        double_compute_pair<2>(a23, join(n30, n30), join(n11, n02), join(n02, n11), cnt3, rc, sumb, out2);
+        _mm256_store_si256(idx2, _mm256_xor_si256(v23, out2));
+        sum1 = _mm256_add_ps(suma, sumb);
+
+        out2 = _mm256_xor_si256(out2, out);
+        out2 = _mm256_xor_si256(_mm256_permute2x128_si256(out2, out2, 0x41), out2);
+        suma = _mm256_permute2f128_ps(sum0, sum1, 0x30);
+        sumb = _mm256_permute2f128_ps(sum0, sum1, 0x21);
+        sum0 = _mm256_add_ps(suma, sumb);
+        sum0 = _mm256_add_ps(sum0, _mm256_permute2f128_ps(sum0, sum0, 0x41));
+
+        // Clear the high 128 bits
+        __m128 sum = _mm256_castps256_ps128(sum0);
+
+        sum = _mm_and_ps(_mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)), sum); // take abs(va) by masking the float sign bit
+        // vs range 0 - 64
+        __m128i v0 = _mm_cvttps_epi32(_mm_mul_ps(sum, _mm_set1_ps(16777216.0f)));
+        v0 = _mm_xor_si128(v0, _mm256_castsi256_si128(out2));
+        __m128i v1 = _mm_shuffle_epi32(v0, _MM_SHUFFLE(0, 1, 2, 3));
+        v0 = _mm_xor_si128(v0, v1);
+        v1 = _mm_shuffle_epi32(v0, _MM_SHUFFLE(0, 1, 0, 1));
+        v0 = _mm_xor_si128(v0, v1);
+
+        // vs is now between 0 and 1
+        sum = _mm_div_ps(sum, _mm_set1_ps(64.0f));
+        sum0 = _mm256_insertf128_ps(_mm256_castps128_ps256(sum), sum, 1);
+        uint32_t n = _mm_cvtsi128_si32(v0);
+        idx0 = scratchpad_ptr<MASK>(lpad, n, 0);
+        idx2 = scratchpad_ptr<MASK>(lpad, n, 2);
+    }
+}
+
+template void cn_gpu_inner_avx512<xmrig::CRYPTONIGHT_GPU_ITER, xmrig::CRYPTONIGHT_GPU_MASK>(const uint8_t *spad, uint8_t *lpad);
@@ -144,3 +144,272 @@ static inline __m128i soft_aeskeygenassist(__m128i key)
     const uint32_t X3 = sub_word(_mm_cvtsi128_si32(_mm_shuffle_epi32(key, 0xFF)));
     return _mm_set_epi32(_rotr(X3, 8) ^ rcon, X3, _rotr(X1, 8) ^ rcon, X1);
 }
+
+
+/*
+ * Bitsliced AES round for 8 blocks at once, no table lookups and constant time.
+ * After soft_aes_ortho() q[j] holds bit j of every state byte, bit k of each byte comes from block k,
+ * byte positions are unchanged, so ShiftRows and MixColumns stay byte moves inside each plane.
+ */
+template<int n, char m>
+static inline void soft_aes_swapmove(__m128i &a, __m128i &b)
+{
+    const __m128i t = _mm_and_si128(_mm_xor_si128(_mm_srli_epi64(a, n), b), _mm_set1_epi8(m));
+    b = _mm_xor_si128(b, t);
+    a = _mm_xor_si128(a, _mm_slli_epi64(t, n));
+}
+
+
+// 8x8 bit transpose of every byte position, its own inverse
+static inline void soft_aes_ortho(__m128i *q)
+{
+    soft_aes_swapmove<1, 0x55>(q[0], q[1]);
+    soft_aes_swapmove<1, 0x55>(q[2], q[3]);
+    soft_aes_swapmove<1, 0x55>(q[4], q[5]);
+    soft_aes_swapmove<1, 0x55>(q[6], q[7]);
+
+    soft_aes_swapmove<2, 0x33>(q[0], q[2]);
+    soft_aes_swapmove<2, 0x33>(q[1], q[3]);
+    soft_aes_swapmove<2, 0x33>(q[4], q[6]);
+    soft_aes_swapmove<2, 0x33>(q[5], q[7]);
+
+    soft_aes_swapmove<4, 0x0f>(q[0], q[4]);
+    soft_aes_swapmove<4, 0x0f>(q[1], q[5]);
+    soft_aes_swapmove<4, 0x0f>(q[2], q[6]);
+    soft_aes_swapmove<4, 0x0f>(q[3], q[7]);
+}
+
+
+// Boyar-Peralta S-box circuit, q[0] is the lowest bit, 113 gates
+static inline void soft_aes_sbox(__m128i *q)
+{
+#   define XOR(a, b)  _mm_xor_si128(a, b)
+#   define AND(a, b)  _mm_and_si128(a, b)
+#   define XNOR(a, b) _mm_xor_si128(_mm_xor_si128(a, b), _mm_set1_epi32(-1))
+
+    const __m128i x0 = q[7];
+    const __m128i x1 = q[6];
+    const __m128i x2 = q[5];
+    const __m128i x3 = q[4];
+    const __m128i x4 = q[3];
+    const __m128i x5 = q[2];
+    const __m128i x6 = q[1];
+    const __m128i x7 = q[0];
+
+    // top linear transformation
+    const __m128i y14 = XOR(x3, x5);
+    const __m128i y13 = XOR(x0, x6);
+    const __m128i y9  = XOR(x0, x3);
+    const __m128i y8  = XOR(x0, x5);
+    const __m128i t0  = XOR(x1, x2);
+    const __m128i y1  = XOR(t0, x7);
+    const __m128i y4  = XOR(y1, x3);
+    const __m128i y12 = XOR(y13, y14);
+    const __m128i y2  = XOR(y1, x0);
+    const __m128i y5  = XOR(y1, x6);
+    const __m128i y3  = XOR(y5, y8);
+    const __m128i t1  = XOR(x4, y12);
+    const __m128i y15 = XOR(t1, x5);
+    const __m128i y20 = XOR(t1, x1);
+    const __m128i y6  = XOR(y15, x7);
+    const __m128i y10 = XOR(y15, t0);
+    const __m128i y11 = XOR(y20, y9);
+    const __m128i y7  = XOR(x7, y11);
+    const __m128i y17 = XOR(y10, y11);
+    const __m128i y19 = XOR(y10, y8);
+    const __m128i y16 = XOR(t0, y11);
+    const __m128i y21 = XOR(y13, y16);
+    const __m128i y18 = XOR(x0, y16);
+
+    // non-linear section
+    const __m128i t2  = AND(y12, y15);
+    const __m128i t3  = AND(y3, y6);
+    const __m128i t4  = XOR(t3, t2);
+    const __m128i t5  = AND(y4, x7);
+    const __m128i t6  = XOR(t5, t2);
+    const __m128i t7  = AND(y13, y16);
+    const __m128i t8  = AND(y5, y1);
+    const __m128i t9  = XOR(t8, t7);
+    const __m128i t10 = AND(y2, y7);
+    const __m128i t11 = XOR(t10, t7);
+    const __m128i t12 = AND(y9, y11);
+    const __m128i t13 = AND(y14, y17);
+    const __m128i t14 = XOR(t13, t12);
+    const __m128i t15 = AND(y8, y10);
+    const __m128i t16 = XOR(t15, t12);
+    const __m128i t17 = XOR(t4, t14);
+    const __m128i t18 = XOR(t6, t16);
+    const __m128i t19 = XOR(t9, t14);
+    const __m128i t20 = XOR(t11, t16);
+    const __m128i t21 = XOR(t17, y20);
+    const __m128i t22 = XOR(t18, y19);
+    const __m128i t23 = XOR(t19, y21);
+    const __m128i t24 = XOR(t20, y18);
+
+    const __m128i t25 = XOR(t21, t22);
+    const __m128i t26 = AND(t21, t23);
+    const __m128i t27 = XOR(t24, t26);
+    const __m128i t28 = AND(t25, t27);
+    const __m128i t29 = XOR(t28, t22);
+    const __m128i t30 = XOR(t23, t24);
+    const __m128i t31 = XOR(t22, t26);
+    const __m128i t32 = AND(t31, t30);
+    const __m128i t33 = XOR(t32, t24);
+    const __m128i t34 = XOR(t23, t33);
+    const __m128i t35 = XOR(t27, t33);
+    const __m128i t36 = AND(t24, t35);
+    const __m128i t37 = XOR(t36, t34);
+    const __m128i t38 = XOR(t27, t36);
+    const __m128i t39 = AND(t29, t38);
+    const __m128i t40 = XOR(t25, t39);
+
+    const __m128i t41 = XOR(t40, t37);
+    const __m128i t42 = XOR(t29, t33);
+    const __m128i t43 = XOR(t29, t40);
+    const __m128i t44 = XOR(t33, t37);
+    const __m128i t45 = XOR(t42, t41);
+    const __m128i z0  = AND(t44, y15);
+    const __m128i z1  = AND(t37, y6);
+    const __m128i z2  = AND(t33, x7);
+    const __m128i z3  = AND(t43, y16);
+    const __m128i z4  = AND(t40, y1);
+    const __m128i z5  = AND(t29, y7);
+    const __m128i z6  = AND(t42, y11);
+    const __m128i z7  = AND(t45, y17);
+    const __m128i z8  = AND(t41, y10);
+    const __m128i z9  = AND(t44, y12);
+    const __m128i z10 = AND(t37, y3);
+    const __m128i z11 = AND(t33, y4);
+    const __m128i z12 = AND(t43, y13);
+    const __m128i z13 = AND(t40, y5);
+    const __m128i z14 = AND(t29, y2);
+    const __m128i z15 = AND(t42, y9);
+    const __m128i z16 = AND(t45, y14);
+    const __m128i z17 = AND(t41, y8);
+
+    // bottom linear transformation
+    const __m128i t46 = XOR(z15, z16);
+    const __m128i t47 = XOR(z10, z11);
+    const __m128i t48 = XOR(z5, z13);
+    const __m128i t49 = XOR(z9, z10);
+    const __m128i t50 = XOR(z2, z12);
+    const __m128i t51 = XOR(z2, z5);
+    const __m128i t52 = XOR(z7, z8);
+    const __m128i t53 = XOR(z0, z3);
+    const __m128i t54 = XOR(z6, z7);
+    const __m128i t55 = XOR(z16, z17);
+    const __m128i t56 = XOR(z12, t48);
+    const __m128i t57 = XOR(t50, t53);
+    const __m128i t58 = XOR(z4, t46);
+    const __m128i t59 = XOR(z3, t54);
+    const __m128i t60 = XOR(t46, t57);
+    const __m128i t61 = XOR(z14, t57);
+    const __m128i t62 = XOR(t52, t58);
+    const __m128i t63 = XOR(t49, t58);
+    const __m128i t64 = XOR(z4, t59);
+    const __m128i t65 = XOR(t61, t62);
+    const __m128i t66 = XOR(z1, t63);
+    const __m128i s0  = XOR(t59, t63);
+    const __m128i s6  = XNOR(t56, t62);
+    const __m128i s7  = XNOR(t48, t60);
+    const __m128i t67 = XOR(t64, t65);
+    const __m128i s3  = XOR(t53, t66);
+    const __m128i s4  = XOR(t51, t66);
+    const __m128i s5  = XOR(t47, t65);
+    const __m128i s1  = XNOR(t64, s3);
+    const __m128i s2  = XNOR(t55, t67);
+
+    q[7] = s0;
+    q[6] = s1;
+    q[5] = s2;
+    q[4] = s3;
+    q[3] = s4;
+    q[2] = s5;
+    q[1] = s6;
+    q[0] = s7;
+
+#   undef XOR
+#   undef AND
+#   undef XNOR
+}
+
+
+static inline void soft_aes_shift_rows(__m128i *q)
+{
+#   ifdef __SSSE3__
+    const __m128i m = _mm_setr_epi8(0, 5, 10, 15, 4, 9, 14, 3, 8, 13, 2, 7, 12, 1, 6, 11);
+
+    for (size_t i = 0; i < 8; i++) {
+        q[i] = _mm_shuffle_epi8(q[i], m);
+    }
+#   else
+    // row r of every column comes from column c + r
+    for (size_t i = 0; i < 8; i++) {
+        const __m128i x = q[i];
+
+        q[i] = _mm_or_si128(_mm_or_si128(_mm_and_si128(x, _mm_set1_epi32(0x000000FF)),
+                                         _mm_and_si128(_mm_shuffle_epi32(x, _MM_SHUFFLE(0, 3, 2, 1)), _mm_set1_epi32(0x0000FF00))),
+                            _mm_or_si128(_mm_and_si128(_mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2)), _mm_set1_epi32(0x00FF0000)),
+                                         _mm_and_si128(_mm_shuffle_epi32(x, _MM_SHUFFLE(2, 1, 0, 3)), _mm_set1_epi32(0xFF000000))));
+    }
+#   endif
+}
+
+
+#ifdef __SSSE3__
+static inline __m128i soft_aes_rotr8(const __m128i &x)  { return _mm_shuffle_epi8(x, _mm_setr_epi8(1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12)); }
+#else
+static inline __m128i soft_aes_rotr8(const __m128i &x)  { return _mm_or_si128(_mm_srli_epi32(x, 8), _mm_slli_epi32(x, 24)); }
+#endif
+static inline __m128i soft_aes_rotr16(const __m128i &x) { return _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xB1), 0xB1); }
+
+
+// out = 2 * (a0 ^ a1) ^ a1 ^ a2 ^ a3 for every column, rotations by 8 bits move to the next row
+static inline void soft_aes_mix_columns(__m128i *q)
+{
+    __m128i r[8], t[8];
+
+    for (size_t i = 0; i < 8; i++) {
+        r[i] = soft_aes_rotr8(q[i]);
+        t[i] = _mm_xor_si128(q[i], r[i]);
+        q[i] = _mm_xor_si128(r[i], soft_aes_rotr16(t[i]));
+    }
+
+    // q ^= 2 * t
+    q[0] = _mm_xor_si128(q[0], t[7]);
+    q[1] = _mm_xor_si128(q[1], _mm_xor_si128(t[0], t[7]));
+    q[2] = _mm_xor_si128(q[2], t[1]);
+    q[3] = _mm_xor_si128(q[3], _mm_xor_si128(t[2], t[7]));
+    q[4] = _mm_xor_si128(q[4], _mm_xor_si128(t[3], t[7]));
+    q[5] = _mm_xor_si128(q[5], t[4]);
+    q[6] = _mm_xor_si128(q[6], t[5]);
+    q[7] = _mm_xor_si128(q[7], t[6]);
+}
+
+
+// same as aesenc on each of the 8 blocks, key comes from soft_aes_expand_key_x8()
+static inline void soft_aesenc_x8(__m128i *q, const __m128i *key)
+{
+    soft_aes_shift_rows(q);
+    soft_aes_sbox(q);
+    soft_aes_mix_columns(q);
+
+    for (size_t i = 0; i < 8; i++) {
+        q[i] = _mm_xor_si128(q[i], key[i]);
+    }
+}
+
+
+// the same round key bitsliced for all 8 blocks
+static inline void soft_aes_expand_key_x8(__m128i key, __m128i *out)
+{
+    for (size_t i = 0; i < 8; i++) {
+        out[i] = key;
+    }
+
+    soft_aes_ortho(out);
+}
+
+
+// selected once by CryptoNight::init(), the T-table rounds are still faster on cores with wide L1 load ports
+extern bool soft_aes_bitsliced;
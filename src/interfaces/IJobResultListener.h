@@ -38,6 +38,8 @@ class IJobResultListener
 public:
     virtual ~IJobResultListener() = default;
 
+    // results of a thread safe listener skip the main loop, they come right from the verification threads
+    virtual inline bool isThreadSafe() const { return false; }
     virtual void onJobResult(const JobResult &result) = 0;
 };
 
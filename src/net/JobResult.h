@@ -40,12 +40,14 @@ namespace xmrig {
 class JobResult
 {
 public:
-    inline JobResult() : poolId(0), diff(0), nonce(0) {}
-    inline JobResult(int poolId, const Id &jobId, const Id &clientId, uint32_t nonce, const uint8_t *result, uint32_t diff, const Algorithm &algorithm) :
+    inline JobResult() : poolId(0), threadId(-1), extraNonceSize(0), diff(0), nonce(0) {}
+    inline JobResult(int poolId, const Id &jobId, const Id &clientId, uint32_t nonce, const uint8_t *result, uint32_t diff, const Algorithm &algorithm, int threadId = -1) :
         algorithm(algorithm),
         clientId(clientId),
         jobId(jobId),
         poolId(poolId),
+        threadId(threadId),
+        extraNonceSize(0),
         diff(diff),
         nonce(nonce)
     {
@@ -53,7 +55,7 @@ public:
     }
 
 
-    inline JobResult(const Job &job) : poolId(0), diff(0), nonce(0)
+    inline JobResult(const Job &job) : poolId(0), threadId(-1), extraNonceSize(0), diff(0), nonce(0)
     {
         jobId     = job.id();
         clientId  = job.clientId();
@@ -61,6 +63,16 @@ public:
         diff      = job.diff();
         nonce     = *job.nonce();
         algorithm = job.algorithm();
+
+        setExtraNonce(job);
+    }
+
+
+    // bytes of the extranonce region of a rolled job, the pool rebuilds the blob of the share from them
+    inline void setExtraNonce(const Job &job)
+    {
+        extraNonceSize = job.extraNonceSize();
+        memcpy(extraNonce, job.extraNonceBytes(), extraNonceSize);
     }
 
 
@@ -74,8 +86,11 @@ public:
     Id clientId;
     Id jobId;
     int poolId;
+    int threadId; // GPU thread of the share, negative for CPU threads and shares of the stratum server
+    size_t extraNonceSize;
     uint32_t diff;
     uint32_t nonce;
+    uint8_t extraNonce[Job::kMaxExtraNonceSize];
     uint8_t result[32];
 };
 
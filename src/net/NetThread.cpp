@@ -0,0 +1,190 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <inttypes.h>
+
+
+#include "common/log/Log.h"
+#include "core/LoopMonitor.h"
+#include "core/Trace.h"
+#include "interfaces/IJobResultListener.h"
+#include "net/NetThread.h"
+
+
+static thread_local bool netThread = false;
+
+
+std::atomic<bool> xmrig::NetThread::m_running(false);
+std::atomic<bool> xmrig::NetThread::m_stopping(false);
+std::atomic<uint64_t> xmrig::NetThread::m_dropped(0);
+xmrig::IJobResultListener *xmrig::NetThread::m_listener = nullptr;
+ResultRing<xmrig::JobResult, xmrig::NetThread::kResults> xmrig::NetThread::m_results;
+std::vector<xmrig::NetThread::Task> xmrig::NetThread::m_mainTasks;
+std::vector<xmrig::NetThread::Task> xmrig::NetThread::m_tasks;
+uv_async_t xmrig::NetThread::m_async;
+uv_async_t xmrig::NetThread::m_mainAsync;
+uv_loop_t xmrig::NetThread::m_loop;
+uv_mutex_t xmrig::NetThread::m_mutex;
+uv_thread_t xmrig::NetThread::m_thread;
+
+
+bool xmrig::NetThread::isCurrent()
+{
+    return netThread;
+}
+
+
+uv_loop_t *xmrig::NetThread::loop()
+{
+    return netThread ? &m_loop : uv_default_loop();
+}
+
+
+// false if there is no network thread or the caller runs on it, the result is then submitted by the caller
+bool xmrig::NetThread::submit(const JobResult &result)
+{
+    if (!m_running || netThread) {
+        return false;
+    }
+
+    JobResult copy(result);
+    if (!m_results.push(std::move(copy))) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uv_async_send(&m_async);
+    return true;
+}
+
+
+// runs the task on the network loop, at once without network thread or on it
+void xmrig::NetThread::post(Task &&task)
+{
+    if (!m_running || netThread) {
+        return task();
+    }
+
+    uv_mutex_lock(&m_mutex);
+    m_tasks.push_back(std::move(task));
+    uv_mutex_unlock(&m_mutex);
+
+    uv_async_send(&m_async);
+}
+
+
+// runs the task on the main loop, at once without network thread or off it
+void xmrig::NetThread::postMain(Task &&task)
+{
+    if (!m_running || !netThread) {
+        return task();
+    }
+
+    uv_mutex_lock(&m_mutex);
+    m_mainTasks.push_back(std::move(task));
+    uv_mutex_unlock(&m_mutex);
+
+    uv_async_send(&m_mainAsync);
+}
+
+
+// objects created on the network loop before the thread starts must not start I/O yet, the loop is not running
+void xmrig::NetThread::start(IJobResultListener *listener)
+{
+    m_listener = listener;
+
+    uv_mutex_init(&m_mutex);
+    uv_loop_init(&m_loop);
+    uv_async_init(&m_loop, &m_async, NetThread::onAsync);
+    LoopMonitor::start(&m_loop, LoopMonitor::NetLag);
+
+    // the main loop ends with uv_stop, this handle must not keep it alive in the modes which end on their own
+    uv_async_init(uv_default_loop(), &m_mainAsync, NetThread::onMainAsync);
+    uv_unref(reinterpret_cast<uv_handle_t*>(&m_mainAsync));
+
+    m_running = true;
+    uv_thread_create(&m_thread, NetThread::onThread, nullptr);
+}
+
+
+// the loop is left as it is, like the main loop, handles of the network objects are released with them.
+// Tasks and results sent later are dropped
+void xmrig::NetThread::stop()
+{
+    if (!m_running || m_stopping) {
+        return;
+    }
+
+    m_stopping = true;
+    uv_async_send(&m_async);
+    uv_thread_join(&m_thread);
+}
+
+
+void xmrig::NetThread::drain(std::vector<Task> &tasks)
+{
+    uv_mutex_lock(&m_mutex);
+    std::vector<Task> pending;
+    pending.swap(tasks);
+    uv_mutex_unlock(&m_mutex);
+
+    for (Task &task : pending) {
+        task();
+    }
+}
+
+
+void xmrig::NetThread::onAsync(uv_async_t *)
+{
+    drain(m_tasks);
+
+    JobResult result;
+    while (m_results.pop(result)) {
+        m_listener->onJobResult(result);
+    }
+
+    const uint64_t dropped = m_dropped.exchange(0, std::memory_order_relaxed);
+    if (dropped) {
+        LOG_ERR("%" PRIu64 " share(s) dropped, the network thread is behind", dropped);
+    }
+
+    if (m_stopping) {
+        uv_stop(&m_loop);
+    }
+}
+
+
+void xmrig::NetThread::onMainAsync(uv_async_t *)
+{
+    drain(m_mainTasks);
+}
+
+
+void xmrig::NetThread::onThread(void *)
+{
+    netThread = true;
+    Trace::setThreadName("network");
+
+    uv_run(&m_loop, UV_RUN_DEFAULT);
+}
@@ -0,0 +1,91 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef XMRIG_NETTHREAD_H
+#define XMRIG_NETTHREAD_H
+
+
+#include <atomic>
+#include <functional>
+#include <vector>
+#include <uv.h>
+
+
+#include "net/JobResult.h"
+#include "workers/ResultRing.h"
+
+
+namespace xmrig {
+
+
+class IJobResultListener;
+
+
+// --net-thread: the pool connections, strategies and the local stratum server run on a uv loop of their own.
+// Shares of the workers reach it through a lock-free ring, so a slow API request or console output doesn't
+// hold them back. Everything else crosses between the loops as tasks, jobs go to the workers that way.
+class NetThread
+{
+public:
+    using Task = std::function<void()>;
+
+    static inline bool isRunning() { return m_running; }
+
+    static bool isCurrent();
+    // the loop of the calling thread, handles are made on the loop which runs their callbacks
+    static uv_loop_t *loop();
+    static bool submit(const JobResult &result);
+    static void post(Task &&task);
+    static void postMain(Task &&task);
+    static void start(IJobResultListener *listener);
+    static void stop();
+
+private:
+    constexpr static size_t kResults = 1024;
+
+    static void drain(std::vector<Task> &tasks);
+    static void onAsync(uv_async_t *handle);
+    static void onMainAsync(uv_async_t *handle);
+    static void onThread(void *arg);
+
+    static std::atomic<bool> m_running;
+    static std::atomic<bool> m_stopping;
+    static std::atomic<uint64_t> m_dropped;
+    static IJobResultListener *m_listener;
+    static ResultRing<JobResult, kResults> m_results;
+    static std::vector<Task> m_mainTasks;
+    static std::vector<Task> m_tasks;
+    static uv_async_t m_async;
+    static uv_async_t m_mainAsync;
+    static uv_loop_t m_loop;
+    static uv_mutex_t m_mutex;
+    static uv_thread_t m_thread;
+};
+
+
+} /* namespace xmrig */
+
+
+#endif /* XMRIG_NETTHREAD_H */
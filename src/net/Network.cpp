@@ -28,64 +28,161 @@
 
 #include <inttypes.h>
 #include <memory>
+#include <string>
 #include <time.h>
 
 
 #include "api/Api.h"
+#include "api/EventStream.h"
 #include "common/log/Log.h"
 #include "common/net/Client.h"
 #include "common/net/SubmitResult.h"
 #include "core/Config.h"
 #include "core/Controller.h"
+#include "core/History.h"
+#include "core/LogSummary.h"
+#include "core/StartupProfile.h"
+#include "core/StatsSegment.h"
+#include "core/TelemetryPush.h"
+#include "net/NetThread.h"
 #include "net/Network.h"
+#include "net/PerfSnapshot.h"
+#include "net/SessionRecorder.h"
+#include "net/StratumServer.h"
 #include "net/strategies/DonateStrategy.h"
+#include "workers/Benchmark.h"
+#include "workers/DualMiner.h"
 #include "workers/Workers.h"
 
 
 xmrig::Network::Network(Controller *controller) :
-    m_donate(nullptr)
+    m_controller(controller),
+    m_donate(nullptr),
+    m_retired(nullptr),
+    m_recorder(nullptr),
+    m_stratum(nullptr),
+    m_hold(false),
+    m_heldDonate(false),
+    m_idleDone(false),
+    m_idleSince(0)
 {
+    const Config *config = controller->config();
+
+    if (config->isNetThread()) {
+        NetThread::start(this);
+    }
+
     Workers::setListener(this);
     controller->addListener(this);
 
-    const Pools &pools = controller->config()->pools();
-    m_strategy = pools.createStrategy(this);
+    // the strategies take the loop they are made on, with --net-thread they are made on the network thread,
+    // later calls of the main loop are queued behind this
+    const Pools pools         = config->pools();
+    const int donateLevel     = config->donateLevel();
+    const Algo algo           = config->algorithm().algo();
+    const int stratumPort     = config->stratumPort();
+    const std::string session = config->recordSession() ? config->recordSession() : "";
 
-    if (controller->config()->donateLevel() > 0) {
-        m_donate = new DonateStrategy(controller->config()->donateLevel(), pools.data().front().user(), controller->config()->algorithm().algo(), this);
-    }
+    NetThread::post([this, pools, donateLevel, algo, stratumPort, session]() {
+        m_strategy = pools.createStrategy(this);
+
+        if (donateLevel > 0) {
+            m_donate = new DonateStrategy(donateLevel, pools.data().front().user(), algo, this);
+        }
 
-    m_timer.data = this;
-    uv_timer_init(uv_default_loop(), &m_timer);
+        if (stratumPort > 0) {
+            m_stratum = new StratumServer("0.0.0.0", static_cast<uint16_t>(stratumPort), this);
 
-    uv_timer_start(&m_timer, Network::onTick, kTickInterval, kTickInterval);
+            if (!m_stratum->start()) {
+                delete m_stratum;
+                m_stratum = nullptr;
+            }
+        }
+
+        if (!session.empty()) {
+            m_recorder = new SessionRecorder(session.c_str());
+        }
+
+        m_timer.data = this;
+        uv_timer_init(NetThread::loop(), &m_timer);
+
+        uv_timer_start(&m_timer, Network::onTick, kTickInterval, kTickInterval);
+    });
 }
 
 
 xmrig::Network::~Network()
 {
+    delete m_recorder;
+    delete m_stratum;
+    delete m_retired;
     delete m_strategy;
 }
 
 
+// the dual pool stays on the main loop with the dual miner
 void xmrig::Network::connect()
 {
-    m_strategy->connect();
+    // the logins send algo-perf, the copy goes ahead of them
+    PerfSnapshot::publish(m_controller->config());
+
+    NetThread::post([this]() { m_strategy->connect(); });
+
+    if (Workers::dual()) {
+        Workers::dual()->connect();
+    }
 }
 
 
-void xmrig::Network::stop()
+// while held the workers run jobs of someone else (remote benchmark), pool jobs are only kept and the last one is applied on release
+void xmrig::Network::hold(bool enable)
 {
-    if (m_donate) {
-        m_donate->stop();
+    m_hold = enable;
+
+    if (enable) {
+        return;
     }
 
-    m_strategy->stop();
+    NetThread::post([this]() {
+        if (!m_hold && m_held.isValid()) {
+            apply(m_held, m_heldDonate);
+            m_held = Job();
+        }
+    });
+}
+
+
+// the network thread ends with the strategies, the miner exits after this
+void xmrig::Network::stop()
+{
+    NetThread::post([this]() {
+        if (m_donate) {
+            m_donate->stop();
+        }
+
+        if (m_retired) {
+            m_retired->stop();
+        }
+
+        m_strategy->stop();
+    });
+
+    NetThread::stop();
+}
+
+
+bool xmrig::Network::isThreadSafe() const
+{
+    return NetThread::isRunning();
 }
 
 
 void xmrig::Network::onActive(IStrategy *strategy, Client *client)
 {
+    if (m_retired == strategy) {
+        return;
+    }
+
     if (m_donate && m_donate == strategy) {
         LOG_NOTICE("dev donate started");
         return;
@@ -111,39 +208,94 @@ void xmrig::Network::onConfigChanged(Config *config, Config *previousConfig)
         return;
     }
 
-    m_strategy->stop();
-
     config->pools().print();
 
-    delete m_strategy;
-    m_strategy = config->pools().createStrategy(this);
+    // the previous config is deleted before the network thread gets to this
+    const Pools pools = config->pools();
+
+    NetThread::post([this, pools]() {
+        // the previous pools keep the workers busy until the new strategy sends a job, then they are closed
+        if (m_retired) {
+            m_retired->stop();
+            delete m_retired;
+            m_retired = nullptr;
+        }
+
+        if (m_strategy->isActive()) {
+            m_retired = m_strategy;
+        }
+        else {
+            m_strategy->stop();
+            delete m_strategy;
+        }
+
+        m_strategy = pools.createStrategy(this);
+    });
+
     connect();
 }
 
 
 void xmrig::Network::onJob(IStrategy *strategy, Client *client, const Job &job)
 {
+    if (m_retired && m_retired != strategy && m_donate != strategy) {
+        m_retired->stop();
+        delete m_retired;
+        m_retired = nullptr;
+    }
+
+    // rigs behind the local stratum server stay on the user pool while this miner donates
+    if (m_stratum && m_donate != strategy) {
+        m_stratum->setJob(job);
+    }
+
+    if (m_recorder && m_donate != strategy) {
+        m_recorder->addJob(job);
+    }
+
     if (m_donate && m_donate->isActive() && m_donate != strategy) {
         return;
     }
 
     setJob(client, job, m_donate == strategy);
+
+    if (m_donate != strategy) {
+        replay(job);
+    }
 }
 
 
 void xmrig::Network::onJobResult(const JobResult &result)
 {
+    if (NetThread::submit(result)) {
+        return;
+    }
+
     if (result.poolId == -1 && m_donate) {
         m_donate->submit(result);
         return;
     }
 
-    m_strategy->submit(result);
+    // until the new pools send a job all shares are found for the previous ones
+    IStrategy *strategy = m_retired ? m_retired : m_strategy;
+
+    // no connection to the pool right now or the share is from the previous login
+    if (strategy->submit(result) < 0 && result.poolId >= 0) {
+        if (m_pending.size() >= kPendingShares) {
+            m_pending.pop_front();
+        }
+
+        m_pending.push_back(PendingShare(result, uv_now(NetThread::loop()) + kPendingTimeout));
+    }
 }
 
 
 void xmrig::Network::onPause(IStrategy *strategy)
 {
+    if (m_retired == strategy && m_strategy->isActive()) {
+        return;
+    }
+
     if (m_donate && m_donate == strategy) {
         LOG_NOTICE("dev donate finished");
         m_strategy->resume();
@@ -152,16 +304,37 @@ void xmrig::Network::onPause(IStrategy *strategy)
     if (!m_strategy->isActive()) {
         LOG_ERR("no active pools, stop mining");
         m_state.stop();
-        return Workers::pause();
+
+        if (m_hold) {
+            m_held = Job();
+            return;
+        }
+
+        NetThread::postMain([]() { Workers::pause(); });
     }
 }
 
 
-void xmrig::Network::onResultAccepted(IStrategy *, Client *, const SubmitResult &result, const char *error)
+void xmrig::Network::onResultAccepted(IStrategy *strategy, Client *, const SubmitResult &result, const char *error)
 {
     m_state.add(result, error);
 
-    if (error) {
+    const uint64_t accepted = m_state.accepted;
+    const uint64_t rejected = m_state.rejected;
+    const uint64_t total    = m_state.total;
+    NetThread::postMain([accepted, rejected, total]() {
+        StatsSegment::setShares(accepted, rejected, total);
+        History::setShares(accepted, rejected, total);
+    });
+
+    if (m_recorder && m_donate != strategy) {
+        m_recorder->addResult(result, error);
+    }
+
+    if (LogSummary::isEnabled()) {
+        LogSummary::share(result.threadId, result.diff, result.elapsed, error);
+    }
+    else if (error) {
         LOG_INFO(isColors() ? "\x1B[1;31mrejected\x1B[0m (%" PRId64 "/%" PRId64 ") diff \x1B[1;37m%u\x1B[0m \x1B[31m\"%s\"\x1B[0m \x1B[1;30m(%" PRIu64 " ms)"
                             : "rejected (%" PRId64 "/%" PRId64 ") diff %u \"%s\" (%" PRIu64 " ms)",
                  m_state.accepted, m_state.rejected, result.diff, error, result.elapsed);
@@ -171,6 +344,32 @@ void xmrig::Network::onResultAccepted(IStrategy *, Client *, const SubmitResult
                             : "accepted (%" PRId64 "/%" PRId64 ") diff %u (%" PRIu64 " ms)",
                  m_state.accepted, m_state.rejected, result.diff, result.elapsed);
     }
+
+    if (error) {
+        const int threadId = result.threadId;
+        const uint32_t diff = result.diff;
+        const std::string reason(error);
+        NetThread::postMain([threadId, diff, reason]() {
+            Workers::addReject(threadId, reason.c_str());
+            Workers::addShare(threadId, diff, false);
+        });
+    }
+    else {
+        const int threadId = result.threadId;
+        const uint32_t diff = result.diff;
+        NetThread::postMain([threadId, diff]() { Workers::addShare(threadId, diff, true); });
+    }
+
+#   ifndef XMRIG_NO_API
+    if (EventStream::isActive()) {
+        const bool failed = error != nullptr;
+        const std::string reason(failed ? error : "");
+
+        NetThread::postMain([result, failed, reason, accepted, rejected]() {
+            EventStream::share(result, failed ? reason.c_str() : nullptr, accepted, rejected);
+        });
+    }
+#   endif
 }
 
 
@@ -180,9 +379,37 @@ bool xmrig::Network::isColors() const
 }
 
 
+// shares for a job which the pool sends again after reconnect are submitted with the new login
+void xmrig::Network::replay(const Job &job)
+{
+    size_t count = 0;
+
+    for (auto it = m_pending.begin(); it != m_pending.end();) {
+        if (it->result.poolId != job.poolId() || it->result.jobId != job.id()) {
+            ++it;
+            continue;
+        }
+
+        it->result.clientId = job.clientId();
+        if (m_strategy->submit(it->result) >= 0) {
+            count++;
+        }
+
+        it = m_pending.erase(it);
+    }
+
+    if (count) {
+        LOG_INFO("%zu shares found during reconnect resubmitted", count);
+    }
+}
+
+
 void xmrig::Network::setJob(Client *client, const Job &job, bool donate)
 {
-    if (job.height()) {
+    if (LogSummary::isEnabled()) {
+        LogSummary::job(client->host(), client->port(), job.diff(), job.algorithm().shortName(), job.height());
+    }
+    else if (job.height()) {
         LOG_INFO(isColors() ? MAGENTA_BOLD("new job") " from " WHITE_BOLD("%s:%d") " diff " WHITE_BOLD("%d") " algo " WHITE_BOLD("%s") " height " WHITE_BOLD("%" PRIu64)
                             : "new job from %s:%d diff %d algo %s height %" PRIu64,
                  client->host(), client->port(), job.diff(), job.algorithm().shortName(), job.height());
@@ -198,23 +425,145 @@ void xmrig::Network::setJob(Client *client, const Job &job, bool donate)
     }
 
     m_state.diff = job.diff();
+
+#   ifndef XMRIG_NO_API
+    if (EventStream::isActive()) {
+        const std::string host(client->host());
+        const int port = client->port();
+
+        NetThread::postMain([host, port, job, donate]() { EventStream::job(host.c_str(), port, job, donate); });
+    }
+#   endif
+
+    if (m_hold) {
+        m_held       = job;
+        m_heldDonate = donate;
+
+        // the idle run only fills the time without pool, it ends at once and the job is applied by hold(false)
+        NetThread::postMain([this]() {
+            Benchmark *benchmark = m_controller->benchmark();
+            if (benchmark && benchmark->is_idle()) {
+                benchmark->preempt();
+            }
+        });
+
+        return;
+    }
+
+    // a job kept while held is older, hold(false) may still be queued on the network thread
+    m_held = Job();
+
+    apply(job, donate);
+}
+
+
+// the workers are driven from the main loop, jobs of the network thread are queued there
+void xmrig::Network::apply(const Job &job, bool donate)
+{
+    if (NetThread::isCurrent()) {
+        return NetThread::postMain([this, job, donate]() { apply(job, donate); });
+    }
+
+    if (!StartupProfile::isFinished()) {
+        StartupProfile::finish(isColors());
+    }
+
+    // retarget workers for possible new Algo profile (same algo profile is not reapplied),
+    // done only for the job which is mined, standby pool connections receive jobs too
+    Workers::switch_algo(job.algorithm());
+
+    // with local stratum rigs the GPUs of this miner keep nonces with top byte 0
+    if (m_stratum && !donate && !job.isNicehash()) {
+        Job local(job);
+        reinterpret_cast<uint8_t *>(local.nonce())[3] = 0;
+        local.setNicehash(true);
+
+        return Workers::setJob(local, donate);
+    }
+
     Workers::setJob(job, donate);
 }
 
 
+// GPUs without pool for kIdleWorkDelay calibrate or autotune the perf algos of the pools, once for each outage,
+// on the main loop like the benchmark
+void xmrig::Network::idleWork(uint64_t now, bool active)
+{
+    if (NetThread::isCurrent()) {
+        return NetThread::postMain([this, now, active]() { idleWork(now, active); });
+    }
+
+    const Config *config = m_controller->config();
+
+    if (active) {
+        m_idleSince = 0;
+        m_idleDone  = false;
+        return;
+    }
+
+    Benchmark *benchmark = m_controller->benchmark();
+    if (config->idleWork() == Config::IDLE_WORK_NONE || !benchmark || benchmark->is_running() || m_idleDone || m_hold || !Workers::isEnabled()) {
+        return;
+    }
+
+    if (m_idleSince == 0) {
+        m_idleSince = now;
+    }
+
+    if (now - m_idleSince < kIdleWorkDelay) {
+        return;
+    }
+
+    std::vector<xmrig::PerfAlgo> algos;
+    for (int a = 0; a != xmrig::PerfAlgo::PA_MAX; ++a) {
+        const xmrig::PerfAlgo pa = static_cast<xmrig::PerfAlgo>(a);
+        if (config->isPoolPerfAlgo(pa)) {
+            algos.push_back(pa);
+        }
+    }
+
+    m_idleDone = true;
+
+    if (!algos.empty()) {
+        LOG_NOTICE("no pool for %" PRIu64 " s, %s GPUs until the next job", (now - m_idleSince) / 1000, config->idleWorkName());
+        benchmark->start_idle(algos, config->idleWork() == Config::IDLE_WORK_AUTOTUNE);
+    }
+}
+
+
 void xmrig::Network::tick()
 {
-    const uint64_t now = uv_now(uv_default_loop());
+    const uint64_t now = uv_now(NetThread::loop());
 
     m_strategy->tick(now);
 
+    if (m_retired) {
+        m_retired->tick(now);
+    }
+
+    size_t expired = 0;
+    while (!m_pending.empty() && m_pending.front().expire <= now) {
+        m_pending.pop_front();
+        expired++;
+    }
+
+    if (expired) {
+        LOG_WARN("%zu shares found during reconnect expired, the pool didn't return to their jobs", expired);
+    }
+
     if (m_donate) {
         m_donate->tick(now);
     }
 
-#   ifndef XMRIG_NO_API
-    Api::tick(m_state);
-#   endif
+    idleWork(now, m_strategy->isActive());
+
+    const NetworkState state(m_state);
+    NetThread::postMain([state]() {
+#       ifndef XMRIG_NO_API
+        Api::tick(state);
+#       endif
+        TelemetryPush::setNetwork(state);
+    });
 }
 
 
@@ -26,14 +26,18 @@
 #define XMRIG_NETWORK_H
 
 
+#include <atomic>
+#include <deque>
 #include <vector>
 #include <uv.h>
 
 
 #include "api/NetworkState.h"
+#include "common/net/Job.h"
 #include "common/interfaces/IControllerListener.h"
 #include "common/interfaces/IStrategyListener.h"
 #include "interfaces/IJobResultListener.h"
+#include "net/JobResult.h"
 
 
 namespace xmrig {
@@ -41,6 +45,8 @@ namespace xmrig {
 
 class Controller;
 class IStrategy;
+class SessionRecorder;
+class StratumServer;
 
 
 class Network : public IJobResultListener, public IStrategyListener, public IControllerListener
@@ -50,9 +56,11 @@ public:
     ~Network() override;
 
     void connect();
+    void hold(bool enable);
     void stop();
 
 protected:
+    bool isThreadSafe() const override;
     void onActive(IStrategy *strategy, Client *client) override;
     void onConfigChanged(Config *config, Config *previousConfig) override;
     void onJob(IStrategy *strategy, Client *client, const Job &job) override;
@@ -61,18 +69,43 @@ protected:
     void onResultAccepted(IStrategy *strategy, Client *client, const SubmitResult &result, const char *error) override;
 
 private:
-    constexpr static int kTickInterval = 1 * 1000;
+    constexpr static int kTickInterval        = 1 * 1000;
+    constexpr static size_t kPendingShares    = 256;
+    constexpr static uint64_t kPendingTimeout = 60 * 1000;
+    constexpr static uint64_t kIdleWorkDelay  = 60 * 1000;
+
+    // share which could not be submitted, kept until the pool sends its job again or it expires
+    struct PendingShare
+    {
+        inline PendingShare(const JobResult &result, uint64_t expire) : result(result), expire(expire) {}
+
+        JobResult result;
+        uint64_t expire;
+    };
 
     bool isColors() const;
+    void apply(const Job &job, bool donate);
+    void idleWork(uint64_t now, bool active);
+    void replay(const Job &job);
     void setJob(Client *client, const Job &job, bool donate);
     void tick();
 
     static void onTick(uv_timer_t *handle);
 
+    Controller *m_controller;
     IStrategy *m_donate;
+    IStrategy *m_retired;
     IStrategy *m_strategy;
     NetworkState m_state;
+    SessionRecorder *m_recorder;
+    StratumServer *m_stratum;
+    std::deque<PendingShare> m_pending;
     uv_timer_t m_timer;
+    Job m_held;
+    std::atomic<bool> m_hold;
+    bool m_heldDonate;
+    bool m_idleDone;
+    uint64_t m_idleSince;
 };
 
 
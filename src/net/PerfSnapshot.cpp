@@ -0,0 +1,105 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <string.h>
+
+
+#include "common/crypto/Algorithm.h"
+#include "core/Config.h"
+#include "net/NetThread.h"
+#include "net/PerfSnapshot.h"
+#include "workers/Hashrate.h"
+#include "workers/Workers.h"
+
+
+xmrig::PerfSnapshot::Data xmrig::PerfSnapshot::m_data;
+
+
+xmrig::PerfSnapshot::Data::Data() :
+    reportDevices(false),
+    hashrate(0.0),
+    hashrateAlgo(PA_INVALID),
+    minDwell(0)
+{
+    memset(algoPerf, 0, sizeof(algoPerf));
+    memset(forkRatio, 0, sizeof(forkRatio));
+    memset(switchCost, 0, sizeof(switchCost));
+}
+
+
+// same as Config::get_algorithm_perf
+float xmrig::PerfSnapshot::Data::algorithmPerf(const Algorithm &algorithm) const
+{
+    const PerfAlgo pa = algorithm.perf_algo();
+    if (pa == PA_INVALID) {
+        return 0.0f;
+    }
+
+    const PerfFork pf = algorithm.perf_fork();
+    return pf == FORK_INVALID || forkRatio[pf] <= 0.0f ? algoPerf[pa] : algoPerf[pa] * forkRatio[pf];
+}
+
+
+const xmrig::PerfSnapshot::Data &xmrig::PerfSnapshot::get()
+{
+    return m_data;
+}
+
+
+// called on the main loop when the pools connect and then with the hashrate ticks of Workers, without
+// network thread the copy is applied at once
+void xmrig::PerfSnapshot::publish(const Config *config)
+{
+    Data data;
+
+    for (int a = 0; a != PA_MAX; ++a) {
+        data.algoPerf[a] = config->get_algo_perf(static_cast<PerfAlgo>(a));
+
+        for (int b = 0; b != PA_MAX; ++b) {
+            data.switchCost[a][b] = Workers::switchCost(static_cast<PerfAlgo>(a), static_cast<PerfAlgo>(b));
+        }
+    }
+
+    for (int f = 0; f != FORK_MAX; ++f) {
+        data.forkRatio[f] = config->get_perf_fork_ratio(static_cast<PerfFork>(f));
+    }
+
+    data.minDwell      = Workers::minDwell();
+    data.reportDevices = config->isReportDevices();
+    data.hashrateAlgo  = config->algorithm().perf_algo();
+
+    if (Workers::hashrate()) {
+        data.hashrate = Workers::hashrate()->calc(Hashrate::MediumInterval);
+    }
+
+    if (data.reportDevices) {
+        for (const auto &device : config->device_algo_perf()) {
+            data.devices.push_back({ device.first, device.second.board, device.second.perf });
+        }
+    }
+
+    NetThread::post([data]() { m_data = data; });
+}
@@ -0,0 +1,87 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef XMRIG_PERFSNAPSHOT_H
+#define XMRIG_PERFSNAPSHOT_H
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+
+#include "base/tools/String.h"
+#include "common/xmrig.h"
+
+
+namespace xmrig {
+
+
+class Algorithm;
+class Config;
+
+
+// what the pool connections report and weigh of the miner: algo-perf, the switch costs and the measured hashrate.
+// The config tables and the hashrate change on the main loop while the logins run on the network loop with
+// --net-thread, so the main loop copies them here and the copy is handed to the network loop as a task,
+// get() must only be called there
+class PerfSnapshot
+{
+public:
+    struct Device
+    {
+        size_t index;
+        String board;
+        std::vector<float> perf;
+    };
+
+    struct Data
+    {
+        Data();
+
+        float algorithmPerf(const Algorithm &algorithm) const;
+
+        bool reportDevices;
+        double hashrate;                    // medium hashrate of the mined perf algo, 0 if not measured yet
+        float algoPerf[PA_MAX];
+        float forkRatio[FORK_MAX];
+        PerfAlgo hashrateAlgo;
+        std::vector<Device> devices;
+        uint32_t minDwell;
+        uint32_t switchCost[PA_MAX][PA_MAX];
+    };
+
+    static const Data &get();
+    static void publish(const Config *config);
+
+private:
+    static Data m_data;
+};
+
+
+} /* namespace xmrig */
+
+
+#endif /* XMRIG_PERFSNAPSHOT_H */
@@ -0,0 +1,95 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <inttypes.h>
+#include <uv.h>
+
+
+#include "common/log/Log.h"
+#include "common/net/Job.h"
+#include "common/net/SubmitResult.h"
+#include "net/NetThread.h"
+#include "net/SessionRecorder.h"
+
+
+xmrig::SessionRecorder::SessionRecorder(const char *fileName) :
+    m_start(0)
+{
+    m_file = fopen(fileName, "w");
+
+    if (!m_file) {
+        LOG_ERR("failed to open session record \"%s\"", fileName);
+    }
+}
+
+
+xmrig::SessionRecorder::~SessionRecorder()
+{
+    if (m_file) {
+        fclose(m_file);
+    }
+}
+
+
+void xmrig::SessionRecorder::addJob(const Job &job)
+{
+    if (!m_file) {
+        return;
+    }
+
+    char blob[Job::kMaxBlobSize * 2 + 1];
+    Job::toHex(job.blob(), static_cast<unsigned int>(job.size()), blob);
+    blob[job.size() * 2] = '\0';
+
+    const uint64_t target = job.target();
+    char targetHex[17];
+    Job::toHex(reinterpret_cast<const unsigned char*>(&target), 8, targetHex);
+    targetHex[16] = '\0';
+
+    fprintf(m_file, "J %" PRIu64 " %s %s %" PRIu64 " %s %s\n", time(), job.id().data(), job.algorithm().shortName(), job.height(), targetHex, blob);
+    fflush(m_file);
+}
+
+
+void xmrig::SessionRecorder::addResult(const SubmitResult &result, const char *error)
+{
+    if (!m_file) {
+        return;
+    }
+
+    fprintf(m_file, "R %" PRIu64 " %u %" PRIu64 " %s\n", time(), result.diff, result.elapsed, error ? error : "OK");
+    fflush(m_file);
+}
+
+
+uint64_t xmrig::SessionRecorder::time()
+{
+    const uint64_t now = uv_now(NetThread::loop());
+    if (m_start == 0) {
+        m_start = now;
+    }
+
+    return now - m_start;
+}
@@ -0,0 +1,257 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+
+#include "common/log/Log.h"
+#include "core/Config.h"
+#include "core/Controller.h"
+#include "net/JobResult.h"
+#include "net/Network.h"
+#include "net/SessionReplay.h"
+#include "net/StratumServer.h"
+#include "rapidjson/document.h"
+#include "rapidjson/prettywriter.h"
+#include "rapidjson/stringbuffer.h"
+#include "workers/Workers.h"
+
+
+// poll interval of the replay clock in ms
+static const uint64_t kPollTime = 10;
+
+
+xmrig::SessionReplay::SessionReplay() :
+    m_controller(nullptr),
+    m_speed(1.0),
+    m_next(0),
+    m_server(nullptr),
+    m_accepted(0),
+    m_acceptedDiff(0),
+    m_end(0),
+    m_recordedAccepted(0),
+    m_recordedLatency(0),
+    m_recordedRejected(0),
+    m_stale(0),
+    m_start(0)
+{
+    m_timer.data = this;
+}
+
+
+// the first job waits for the login of the miner, the replay clock starts with it
+bool xmrig::SessionReplay::start(Controller *controller)
+{
+    m_controller = controller;
+    m_speed      = controller->config()->replaySpeed();
+
+    if (!load(controller->config()->replaySession())) {
+        return false;
+    }
+
+    m_server = new StratumServer("127.0.0.1", StratumServer::kTestPort, this);
+    m_server->setJob(m_jobs[m_next++].job);
+
+    if (!m_server->start()) {
+        return false;
+    }
+
+    LOG_INFO("replay of %zu jobs, %.1f s at speed %.2f", m_jobs.size(), static_cast<double>(m_end - m_jobs.front().time) / 1000.0 / m_speed, m_speed);
+
+    uv_timer_init(uv_default_loop(), &m_timer);
+    uv_timer_start(&m_timer, SessionReplay::onTimer, kPollTime, kPollTime);
+
+    return true;
+}
+
+
+// the mock pool keeps the previous job, its shares count if it has the height of the current one
+void xmrig::SessionReplay::onJobResult(const JobResult &result)
+{
+    const Job &current = m_jobs[m_next - 1].job;
+    const bool valid   = result.jobId == current.id() ||
+                         (m_next > 1 && result.jobId == m_jobs[m_next - 2].job.id() && m_jobs[m_next - 2].job.height() == current.height());
+
+    if (!valid) {
+        m_stale++;
+        return;
+    }
+
+    m_accepted++;
+    m_acceptedDiff += result.diff;
+}
+
+
+bool xmrig::SessionReplay::load(const char *fileName)
+{
+    FILE *fp = fopen(fileName, "r");
+    if (!fp) {
+        LOG_ERR("failed to open session record \"%s\"", fileName);
+        return false;
+    }
+
+    char line[1024];
+    while (fgets(line, sizeof(line), fp)) {
+        uint64_t time = 0;
+
+        if (line[0] == 'J') {
+            char id[64];
+            char algo[32];
+            char target[17];
+            char blob[Job::kMaxBlobSize * 2 + 1];
+            uint64_t height = 0;
+
+            if (sscanf(line, "J %" SCNu64 " %63s %31s %" SCNu64 " %16s %256s", &time, id, algo, &height, target, blob) != 6) {
+                continue;
+            }
+
+            Record record;
+            record.time = time;
+
+            if (!record.job.setId(id) || !record.job.setBlob(blob) || !record.job.setTarget(target)) {
+                continue;
+            }
+
+            record.job.setAlgorithm(algo);
+            record.job.setHeight(height);
+
+            m_jobs.push_back(std::move(record));
+        }
+        else if (line[0] == 'R') {
+            unsigned int diff = 0;
+            uint64_t latency  = 0;
+            char status[8]    = { 0 };
+
+            if (sscanf(line, "R %" SCNu64 " %u %" SCNu64 " %7s", &time, &diff, &latency, status) != 4) {
+                continue;
+            }
+
+            if (strcmp(status, "OK") == 0) {
+                m_recordedAccepted++;
+                m_recordedLatency += latency;
+            }
+            else {
+                m_recordedRejected++;
+            }
+        }
+        else {
+            continue;
+        }
+
+        m_end = std::max(m_end, time);
+    }
+
+    fclose(fp);
+
+    if (m_jobs.empty()) {
+        LOG_ERR("no jobs in session record \"%s\"", fileName);
+        return false;
+    }
+
+    return true;
+}
+
+
+void xmrig::SessionReplay::print() const
+{
+    using namespace rapidjson;
+
+    const double elapsed = static_cast<double>(uv_now(uv_default_loop()) - m_start) / 1000.0;
+
+    Document doc(kObjectType);
+    auto &allocator = doc.GetAllocator();
+
+    Value recorded(kObjectType);
+    recorded.AddMember("accepted",   m_recordedAccepted, allocator);
+    recorded.AddMember("rejected",   m_recordedRejected, allocator);
+    recorded.AddMember("latency_ms", m_recordedAccepted ? static_cast<double>(m_recordedLatency) / m_recordedAccepted : 0.0, allocator);
+
+    doc.AddMember("session",            StringRef(m_controller->config()->replaySession()), allocator);
+    doc.AddMember("speed",              m_speed, allocator);
+    doc.AddMember("jobs",               static_cast<uint64_t>(m_next), allocator);
+    doc.AddMember("elapsed",            elapsed, allocator);
+    doc.AddMember("shares",             m_accepted, allocator);
+    doc.AddMember("stale_shares",       m_stale + m_server->rejected(), allocator);
+    doc.AddMember("accepted_diff",      m_acceptedDiff, allocator);
+    doc.AddMember("effective_hashrate", elapsed > 0.0 ? static_cast<double>(m_acceptedDiff) / elapsed : 0.0, allocator);
+    doc.AddMember("recorded",           recorded, allocator);
+
+    StringBuffer buffer(nullptr, 4096);
+    PrettyWriter<StringBuffer> writer(buffer);
+    doc.Accept(writer);
+
+    printf("%s\n", buffer.GetString());
+    fflush(stdout);
+}
+
+
+void xmrig::SessionReplay::stop()
+{
+    uv_timer_stop(&m_timer);
+    uv_close(reinterpret_cast<uv_handle_t*>(&m_timer), nullptr);
+
+    print();
+
+    m_controller->network()->stop();
+    Workers::stop();
+
+    delete m_server;
+    m_server = nullptr;
+
+    uv_stop(uv_default_loop());
+}
+
+
+void xmrig::SessionReplay::tick()
+{
+    const uint64_t now = uv_now(uv_default_loop());
+
+    if (m_start == 0) {
+        if (m_server->miners() == 0) {
+            return;
+        }
+
+        m_start = now;
+    }
+
+    const uint64_t elapsed = m_jobs.front().time + static_cast<uint64_t>(static_cast<double>(now - m_start) * m_speed);
+
+    while (m_next < m_jobs.size() && m_jobs[m_next].time <= elapsed) {
+        m_server->setJob(m_jobs[m_next++].job);
+    }
+
+    if (elapsed >= m_end) {
+        stop();
+    }
+}
+
+
+void xmrig::SessionReplay::onTimer(uv_timer_t *handle)
+{
+    static_cast<SessionReplay*>(handle->data)->tick();
+}
@@ -0,0 +1,91 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_SESSIONREPLAY_H
+#define XMRIG_SESSIONREPLAY_H
+
+
+#include <uv.h>
+#include <vector>
+
+
+#include "common/net/Job.h"
+#include "interfaces/IJobResultListener.h"
+
+
+namespace xmrig {
+
+
+class Controller;
+class StratumServer;
+
+
+// --replay-session, the jobs of a session recorded by SessionRecorder are sent again by a mock pool at their recorded
+// times divided by --replay-speed, shares of an earlier height are stale like on the real pool, the effective hashrate
+// is the accepted difficulty per second of the replay, the report is printed as JSON and the miner exits
+class SessionReplay : public IJobResultListener
+{
+public:
+    SessionReplay();
+
+    bool start(Controller *controller);
+
+protected:
+    void onJobResult(const JobResult &result) override;
+
+private:
+    struct Record
+    {
+        uint64_t time;
+        Job job;
+    };
+
+    bool load(const char *fileName);
+    void print() const;
+    void stop();
+    void tick();
+
+    static void onTimer(uv_timer_t *handle);
+
+    Controller *m_controller;
+    double m_speed;
+    size_t m_next;
+    std::vector<Record> m_jobs;
+    StratumServer *m_server;
+    uint64_t m_accepted;
+    uint64_t m_acceptedDiff;
+    uint64_t m_end;
+    uint64_t m_recordedAccepted;
+    uint64_t m_recordedLatency;
+    uint64_t m_recordedRejected;
+    uint64_t m_stale;
+    uint64_t m_start;
+    uv_timer_t m_timer;
+};
+
+
+} /* namespace xmrig */
+
+
+#endif /* XMRIG_SESSIONREPLAY_H */
@@ -0,0 +1,484 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#include "common/log/Log.h"
+#include "common/net/BinaryFrame.h"
+#include "interfaces/IJobResultListener.h"
+#include "net/JobResult.h"
+#include "net/NetThread.h"
+#include "net/StratumServer.h"
+#include "rapidjson/document.h"
+
+
+xmrig::StratumServer::StratumServer(const char *host, uint16_t port, IJobResultListener *listener) :
+    m_host(host),
+    m_port(port),
+    m_listener(listener),
+    m_count(0),
+    m_miners(kMaxMiners + 1, nullptr),
+    m_accepted(0),
+    m_rejected(0),
+    m_server(nullptr)
+{
+}
+
+
+xmrig::StratumServer::~StratumServer()
+{
+    for (Miner *miner : m_miners) {
+        if (miner) {
+            close(miner);
+        }
+    }
+
+    if (m_server) {
+        uv_close(reinterpret_cast<uv_handle_t*>(m_server), [](uv_handle_t *handle) { delete reinterpret_cast<uv_tcp_t*>(handle); });
+    }
+}
+
+
+bool xmrig::StratumServer::start()
+{
+    m_server = new uv_tcp_t;
+    m_server->data = this;
+    uv_tcp_init(NetThread::loop(), m_server);
+
+    sockaddr_in addr;
+    uv_ip4_addr(m_host, m_port, &addr);
+
+    int rc = uv_tcp_bind(m_server, reinterpret_cast<const sockaddr*>(&addr), 0);
+    if (rc == 0) {
+        rc = uv_listen(reinterpret_cast<uv_stream_t*>(m_server), 64, StratumServer::onConnection);
+    }
+
+    if (rc < 0) {
+        LOG_ERR("stratum server failed to listen on %s:%u: \"%s\"", m_host, m_port, uv_strerror(rc));
+        return false;
+    }
+
+    LOG_INFO("stratum server listening on %s:%u", m_host, m_port);
+    return true;
+}
+
+
+// the job of the previous block is kept, rigs which have not seen the new one yet still submit for it
+void xmrig::StratumServer::setJob(const Job &job)
+{
+    if (job.isNicehash()) {
+        if (m_job.isValid()) {
+            LOG_WARN("stratum server paused, the upstream pool uses nicehash mode and its nonce space can't be split further");
+        }
+
+        m_previous.reset();
+        m_job.reset();
+        return;
+    }
+
+    if (job.id() == m_job.id() && job.clientId() == m_job.clientId()) {
+        return;
+    }
+
+    m_previous = m_job;
+    m_job      = job;
+
+    for (Miner *miner : m_miners) {
+        if (miner && miner->logged) {
+            sendJob(miner, -1, miner->binary);
+        }
+    }
+}
+
+
+bool xmrig::StratumServer::submit(Miner *miner, const char *jobId, uint32_t nonce, const uint8_t *hash, const char **error)
+{
+    const Job *job = nullptr;
+
+    if (m_job.isValid() && strcmp(m_job.id().data(), jobId) == 0) {
+        job = &m_job;
+    }
+    else if (m_previous.isValid() && strcmp(m_previous.id().data(), jobId) == 0) {
+        job = &m_previous;
+    }
+
+    if (!job) {
+        *error = "Invalid job id";
+        return false;
+    }
+
+    if ((nonce >> 24) != miner->slot) {
+        *error = "Nonce out of range";
+        return false;
+    }
+
+    JobResult result(job->poolId(), job->id(), job->clientId(), nonce, hash, job->diff(), job->algorithm());
+    if (result.actualDiff() < job->diff()) {
+        *error = "Low difficulty share";
+        return false;
+    }
+
+    m_listener->onJobResult(result);
+    return true;
+}
+
+
+bool xmrig::StratumServer::submit(Miner *miner, const rapidjson::Value &params, const char **error)
+{
+    if (!params.IsObject() || !params.HasMember("job_id") || !params.HasMember("nonce") || !params.HasMember("result")
+        || !params["job_id"].IsString() || !params["nonce"].IsString() || !params["result"].IsString()) {
+        *error = "Invalid params";
+        return false;
+    }
+
+    uint32_t nonce = 0;
+    uint8_t hash[32];
+
+    if (params["nonce"].GetStringLength() != 8 || params["result"].GetStringLength() != 64
+        || !Job::fromHex(params["nonce"].GetString(), 8, reinterpret_cast<unsigned char*>(&nonce))
+        || !Job::fromHex(params["result"].GetString(), 64, hash)) {
+        *error = "Malformed share";
+        return false;
+    }
+
+    return submit(miner, params["job_id"].GetString(), nonce, hash, error);
+}
+
+
+void xmrig::StratumServer::close(Miner *miner)
+{
+    if (m_miners[miner->slot] == miner) {
+        m_miners[miner->slot] = nullptr;
+        m_count--;
+    }
+
+    if (uv_is_closing(reinterpret_cast<uv_handle_t*>(&miner->socket)) == 0) {
+        uv_close(reinterpret_cast<uv_handle_t*>(&miner->socket), StratumServer::onClose);
+    }
+}
+
+
+void xmrig::StratumServer::login(Miner *miner, int64_t id, const rapidjson::Value &params)
+{
+    if (!m_job.isValid()) {
+        return reply(miner, id, nullptr, "No job available");
+    }
+
+    const bool binary = params.IsObject() && params.HasMember("binary") && params["binary"].IsInt() && params["binary"].GetInt() >= BinaryFrame::kVersion;
+
+    if (!miner->logged) {
+        miner->logged = true;
+        snprintf(miner->rpcId, sizeof(miner->rpcId), "%02x%08x", miner->slot, static_cast<unsigned int>(rand()));
+
+        LOG_INFO("stratum miner #%u logged in, %zu connected", static_cast<unsigned int>(miner->slot), m_count);
+    }
+
+    sendJob(miner, id, binary);
+    miner->binary = binary;
+}
+
+
+void xmrig::StratumServer::parse(Miner *miner, char *line, size_t len)
+{
+    rapidjson::Document doc;
+    if (len == 0 || doc.ParseInsitu(line).HasParseError() || !doc.IsObject()) {
+        return close(miner);
+    }
+
+    const rapidjson::Value &method = doc["method"];
+    const rapidjson::Value &id     = doc["id"];
+    const int64_t requestId        = id.IsInt64() ? id.GetInt64() : 0;
+
+    if (!method.IsString()) {
+        return reply(miner, requestId, nullptr, "Invalid request");
+    }
+
+    if (strcmp(method.GetString(), "login") == 0) {
+        return login(miner, requestId, doc["params"]);
+    }
+
+    if (!miner->logged) {
+        return reply(miner, requestId, nullptr, "Unauthenticated");
+    }
+
+    if (strcmp(method.GetString(), "submit") == 0) {
+        const char *error = nullptr;
+
+        if (!submit(miner, doc["params"], &error)) {
+            m_rejected++;
+            LOG_DEBUG_ERR("stratum miner #%u share rejected: \"%s\"", static_cast<unsigned int>(miner->slot), error);
+
+            return reply(miner, requestId, nullptr, error);
+        }
+
+        m_accepted++;
+        return reply(miner, requestId, "{\"status\":\"OK\"}", nullptr);
+    }
+
+    if (strcmp(method.GetString(), "keepalived") == 0) {
+        return reply(miner, requestId, "{\"status\":\"KEEPALIVED\"}", nullptr);
+    }
+
+    reply(miner, requestId, nullptr, "Unsupported method");
+}
+
+
+void xmrig::StratumServer::parseFrame(Miner *miner, const char *frame, size_t size)
+{
+    BinaryFrame::Reader reader(frame, size);
+    uint32_t id = 0;
+
+    if (!reader.u32(id)) {
+        return close(miner);
+    }
+
+    if (BinaryFrame::type(frame) == BinaryFrame::KeepAlive) {
+        return reply(miner, id, nullptr, nullptr);
+    }
+
+    if (BinaryFrame::type(frame) != BinaryFrame::Submit) {
+        return reply(miner, id, nullptr, "Unsupported method");
+    }
+
+    char jobId[256];
+    char algo[256];
+    uint32_t nonce = 0;
+    uint8_t hash[32];
+    const char *error = nullptr;
+
+    if (!reader.string(jobId) || !reader.u32(nonce) || !reader.bytes(hash, sizeof(hash)) || !reader.string(algo)) {
+        error = "Malformed share";
+    }
+
+    if (error || !submit(miner, jobId, nonce, hash, &error)) {
+        m_rejected++;
+        LOG_DEBUG_ERR("stratum miner #%u share rejected: \"%s\"", static_cast<unsigned int>(miner->slot), error);
+
+        return reply(miner, id, nullptr, error);
+    }
+
+    m_accepted++;
+    reply(miner, id, nullptr, nullptr);
+}
+
+
+// binary miners get a Reply frame, its empty error means accepted
+void xmrig::StratumServer::reply(Miner *miner, int64_t id, const char *result, const char *error)
+{
+    char buf[256];
+
+    if (miner->binary) {
+        BinaryFrame::Writer frame(buf, sizeof(buf), BinaryFrame::Reply);
+        frame.u32(static_cast<uint32_t>(id));
+        frame.string(error);
+
+        return send(miner, std::string(buf, frame.finish()));
+    }
+
+    if (error) {
+        snprintf(buf, sizeof(buf), "{\"id\":%" PRId64 ",\"jsonrpc\":\"2.0\",\"error\":{\"code\":-1,\"message\":\"%s\"}}\n", id, error);
+    }
+    else {
+        snprintf(buf, sizeof(buf), "{\"id\":%" PRId64 ",\"jsonrpc\":\"2.0\",\"error\":null,\"result\":%s}\n", id, result);
+    }
+
+    send(miner, buf);
+}
+
+
+void xmrig::StratumServer::send(Miner *miner, const std::string &data)
+{
+    WriteReq *req = new WriteReq();
+    req->data     = data;
+    req->req.data = req;
+
+    uv_buf_t buf = uv_buf_init(&req->data[0], static_cast<unsigned int>(req->data.size()));
+
+    if (uv_write(&req->req, reinterpret_cast<uv_stream_t*>(&miner->socket), &buf, 1, StratumServer::onWrite) < 0) {
+        delete req;
+        close(miner);
+    }
+}
+
+
+// rigs work in nicehash mode and keep the top nonce byte, so writing the slot there hands out a range
+void xmrig::StratumServer::sendJob(Miner *miner, int64_t id, bool binary)
+{
+    uint8_t blob[Job::kMaxBlobSize];
+    memcpy(blob, m_job.blob(), m_job.size());
+    blob[42] = miner->slot;
+
+    if (miner->binary) {
+        char buf[BinaryFrame::kHeaderSize + BinaryFrame::kMaxPayload];
+        BinaryFrame::Writer frame(buf, sizeof(buf), BinaryFrame::Job);
+        frame.string(m_job.id().data());
+        frame.string(m_job.algorithm().shortName());
+        frame.u64(m_job.target());
+        frame.u64(m_job.height());
+        frame.bytes(blob, m_job.size());
+
+        return send(miner, std::string(buf, frame.finish()));
+    }
+
+    char blobHex[Job::kMaxBlobSize * 2 + 1];
+    Job::toHex(blob, static_cast<unsigned int>(m_job.size()), blobHex);
+    blobHex[m_job.size() * 2] = '\0';
+
+    const uint64_t target = m_job.target();
+    char targetHex[17];
+    Job::toHex(reinterpret_cast<const unsigned char*>(&target), 8, targetHex);
+    targetHex[16] = '\0';
+
+    char job[Job::kMaxBlobSize * 2 + 256];
+    snprintf(job, sizeof(job), "{\"blob\":\"%s\",\"job_id\":\"%s\",\"target\":\"%s\",\"algo\":\"%s\",\"height\":%" PRIu64 ",\"id\":\"%s\"}",
+             blobHex, m_job.id().data(), targetHex, m_job.algorithm().shortName(), m_job.height(), miner->rpcId);
+
+    std::string data;
+    if (id >= 0) {
+        data = "{\"id\":" + std::to_string(id) + ",\"jsonrpc\":\"2.0\",\"error\":null,\"result\":{\"id\":\"" + miner->rpcId + "\",\"job\":" + job
+             + (binary ? ",\"extensions\":[\"algo\",\"nicehash\",\"binary\"]" : ",\"extensions\":[\"algo\",\"nicehash\"]") + ",\"status\":\"OK\"}}\n";
+    }
+    else {
+        data = std::string("{\"jsonrpc\":\"2.0\",\"method\":\"job\",\"params\":") + job + "}\n";
+    }
+
+    send(miner, data);
+}
+
+
+void xmrig::StratumServer::onAllocBuffer(uv_handle_t *handle, size_t, uv_buf_t *buf)
+{
+    Miner *miner = static_cast<Miner*>(handle->data);
+
+    buf->base = &miner->buf[miner->pos];
+    buf->len  = kBufferSize - miner->pos - 1;
+}
+
+
+void xmrig::StratumServer::onClose(uv_handle_t *handle)
+{
+    delete static_cast<Miner*>(handle->data);
+}
+
+
+void xmrig::StratumServer::onConnection(uv_stream_t *server, int status)
+{
+    StratumServer *self = static_cast<StratumServer*>(server->data);
+    if (status < 0) {
+        return;
+    }
+
+    Miner *miner  = new Miner();
+    miner->server = self;
+    miner->socket.data = miner;
+
+    uv_tcp_init(NetThread::loop(), &miner->socket);
+
+    if (uv_accept(server, reinterpret_cast<uv_stream_t*>(&miner->socket)) != 0) {
+        uv_close(reinterpret_cast<uv_handle_t*>(&miner->socket), StratumServer::onClose);
+        return;
+    }
+
+    for (size_t slot = 1; slot <= kMaxMiners; ++slot) {
+        if (!self->m_miners[slot]) {
+            miner->slot = static_cast<uint8_t>(slot);
+            self->m_miners[slot] = miner;
+            self->m_count++;
+            break;
+        }
+    }
+
+    if (miner->slot == 0) {
+        LOG_WARN("stratum server is full, %zu miners connected", kMaxMiners);
+        uv_close(reinterpret_cast<uv_handle_t*>(&miner->socket), StratumServer::onClose);
+        return;
+    }
+
+    uv_tcp_nodelay(&miner->socket, 1);
+    uv_read_start(reinterpret_cast<uv_stream_t*>(&miner->socket), StratumServer::onAllocBuffer, StratumServer::onRead);
+}
+
+
+void xmrig::StratumServer::onRead(uv_stream_t *stream, ssize_t nread, const uv_buf_t *)
+{
+    Miner *miner = static_cast<Miner*>(stream->data);
+
+    if (nread < 0) {
+        return miner->server->close(miner);
+    }
+
+    miner->pos += static_cast<size_t>(nread);
+    miner->buf[miner->pos] = '\0';
+
+    char *start = miner->buf;
+    char *end;
+
+    // the login is always JSON, a binary miner switches to frames right after it
+    while (start < miner->buf + miner->pos) {
+        const size_t available = miner->pos - static_cast<size_t>(start - miner->buf);
+
+        if (miner->binary) {
+            const size_t size = BinaryFrame::size(start, available);
+            if (size == 0 || size > available) {
+                break;
+            }
+
+            miner->server->parseFrame(miner, start, size);
+            end = start + size - 1;
+        }
+        else {
+            if ((end = static_cast<char*>(memchr(start, '\n', available))) == nullptr) {
+                break;
+            }
+
+            *end = '\0';
+            miner->server->parse(miner, start, static_cast<size_t>(end - start));
+        }
+
+        if (uv_is_closing(reinterpret_cast<uv_handle_t*>(&miner->socket))) {
+            return;
+        }
+
+        start = end + 1;
+    }
+
+    const size_t remaining = miner->pos - static_cast<size_t>(start - miner->buf);
+    if (remaining >= kBufferSize - 1) {
+        return miner->server->close(miner);
+    }
+
+    memmove(miner->buf, start, remaining);
+    miner->pos = remaining;
+}
+
+
+void xmrig::StratumServer::onWrite(uv_write_t *req, int)
+{
+    delete static_cast<WriteReq*>(req->data);
+}
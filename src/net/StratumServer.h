@@ -0,0 +1,114 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_STRATUMSERVER_H
+#define XMRIG_STRATUMSERVER_H
+
+
+#include <string>
+#include <uv.h>
+#include <vector>
+
+
+#include "common/net/Job.h"
+#include "rapidjson/fwd.h"
+
+
+namespace xmrig {
+
+
+class IJobResultListener;
+
+
+// local stratum endpoint for other rigs of a site, they mine the upstream job of this miner,
+// each rig gets its own top nonce byte like on a nicehash pool, byte 0 is left for the local GPUs
+class StratumServer
+{
+public:
+    constexpr static size_t kMaxMiners  = 255;
+    constexpr static uint16_t kTestPort = 3333; // mock pool of --test-switch and --replay-session on 127.0.0.1
+
+    StratumServer(const char *host, uint16_t port, IJobResultListener *listener);
+    ~StratumServer();
+
+    bool start();
+    void setJob(const Job &job);
+
+    inline size_t miners() const     { return m_count; }
+    inline uint64_t rejected() const { return m_rejected; }
+
+private:
+    constexpr static size_t kBufferSize = 4096;
+
+    struct Miner
+    {
+        bool binary;    // frames of common/net/BinaryFrame.h after the login reply
+        bool logged;
+        char buf[kBufferSize];
+        char rpcId[16];
+        size_t pos;
+        StratumServer *server;
+        uint8_t slot;
+        uv_tcp_t socket;
+    };
+
+    struct WriteReq
+    {
+        std::string data;
+        uv_write_t req;
+    };
+
+    bool submit(Miner *miner, const char *jobId, uint32_t nonce, const uint8_t *hash, const char **error);
+    bool submit(Miner *miner, const rapidjson::Value &params, const char **error);
+    void close(Miner *miner);
+    void login(Miner *miner, int64_t id, const rapidjson::Value &params);
+    void parse(Miner *miner, char *line, size_t len);
+    void parseFrame(Miner *miner, const char *frame, size_t size);
+    void reply(Miner *miner, int64_t id, const char *result, const char *error);
+    void send(Miner *miner, const std::string &data);
+    void sendJob(Miner *miner, int64_t id, bool binary);
+
+    static void onAllocBuffer(uv_handle_t *handle, size_t suggested_size, uv_buf_t *buf);
+    static void onClose(uv_handle_t *handle);
+    static void onConnection(uv_stream_t *server, int status);
+    static void onRead(uv_stream_t *stream, ssize_t nread, const uv_buf_t *buf);
+    static void onWrite(uv_write_t *req, int status);
+
+    const char *m_host;
+    const uint16_t m_port;
+    IJobResultListener *m_listener;
+    Job m_job;
+    Job m_previous;
+    size_t m_count;
+    std::vector<Miner *> m_miners;
+    uint64_t m_accepted;
+    uint64_t m_rejected;
+    uv_tcp_t *m_server;
+};
+
+
+} /* namespace xmrig */
+
+
+#endif /* XMRIG_STRATUMSERVER_H */
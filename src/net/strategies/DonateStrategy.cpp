@@ -31,7 +31,9 @@
 #include "common/net/strategies/SinglePoolStrategy.h"
 #include "common/Platform.h"
 #include "common/xmrig.h"
+#include "net/NetThread.h"
 #include "net/strategies/DonateStrategy.h"
+#include "workers/Workers.h"
 
 
 static inline float randomf(float min, float max) {
@@ -41,10 +43,14 @@ static inline float randomf(float min, float max) {
 
 xmrig::DonateStrategy::DonateStrategy(int level, const char *user, Algo algo, IStrategyListener *listener) :
     m_active(false),
+    m_force(false),
+    m_pending(false),
+    m_algorithm(algo, VARIANT_AUTO),
     m_donateTime(level * 60 * 1000),
     m_idleTime((100 - level) * 60 * 1000),
     m_strategy(nullptr),
     m_listener(listener),
+    m_deferred(0),
     m_now(0),
     m_stop(0)
 {
@@ -60,15 +66,10 @@ xmrig::DonateStrategy::DonateStrategy(int level, const char *user, Algo algo, IS
         pool.adjust(Algorithm(algo, VARIANT_AUTO));
     }
 
-    if (m_pools.size() > 1) {
-        m_strategy = new FailoverStrategy(m_pools, 1, 2, this, true);
-    }
-    else {
-        m_strategy = new SinglePoolStrategy(m_pools.front(), 1, 2, this, true);
-    }
+    m_strategy = createStrategy();
 
     m_timer.data = this;
-    uv_timer_init(uv_default_loop(), &m_timer);
+    uv_timer_init(NetThread::loop(), &m_timer);
 
     idle(m_idleTime * randomf(0.5, 1.5));
 }
@@ -86,15 +87,44 @@ int64_t xmrig::DonateStrategy::submit(const JobResult &result)
 }
 
 
+// the donate pool is offered only the algorithms of the mined and the standby perf algo, so the donation doesn't
+// need a cold algo switch, a donation deferred for a whole idle period takes any algorithm
 void xmrig::DonateStrategy::connect()
 {
+    m_force = m_pending && uv_now(NetThread::loop()) >= m_deferred + m_idleTime;
+
+    Algorithms algorithms;
+    for (const Algorithm &algorithm : Pool::supportedAlgorithms()) {
+        if (m_force || isWarm(algorithm)) {
+            algorithms.push_back(algorithm);
+        }
+    }
+
+    for (Pool &pool : m_pools) {
+        pool.setAlgorithms(algorithms);
+    }
+
+    m_strategy->stop();
+    delete m_strategy;
+
+    m_stop     = 0;
+    m_strategy = createStrategy();
     m_strategy->connect();
 }
 
 
+// a deferred donation starts together with the algo switch of the user pool, the switch is done anyway
 void xmrig::DonateStrategy::setAlgo(const xmrig::Algorithm &algo)
 {
+    const bool switched = algo.perf_algo() != m_algorithm.perf_algo();
+
+    m_algorithm = algo;
     m_strategy->setAlgo(algo);
+
+    if (switched && m_pending && !isActive()) {
+        uv_timer_stop(&m_timer);
+        connect();
+    }
 }
 
 
@@ -118,22 +148,34 @@ void xmrig::DonateStrategy::tick(uint64_t now)
 }
 
 
+// the donation starts with the first job, its algorithm decides if the workers can mine it now
 void xmrig::DonateStrategy::onActive(IStrategy *strategy, Client *client)
 {
-    if (!isActive()) {
-        uv_timer_start(&m_timer, DonateStrategy::onTimer, m_donateTime, 0);
+    if (isActive()) {
+        m_listener->onActive(this, client);
     }
-
-    m_active = true;
-    m_listener->onActive(this, client);
 }
 
 
 void xmrig::DonateStrategy::onJob(IStrategy *strategy, Client *client, const Job &job)
 {
-    if (isActive()) {
-        m_listener->onJob(this, client, job);
+    if (!isActive()) {
+        if (m_stop) {
+            return;
+        }
+
+        if (!m_force && !isWarm(job.algorithm())) {
+            return defer();
+        }
+
+        uv_timer_start(&m_timer, DonateStrategy::onTimer, m_donateTime, 0);
+
+        m_active  = true;
+        m_pending = false;
+        m_listener->onActive(this, client);
     }
+
+    m_listener->onJob(this, client, job);
 }
 
 
@@ -148,6 +190,39 @@ void xmrig::DonateStrategy::onResultAccepted(IStrategy *strategy, Client *client
 }
 
 
+bool xmrig::DonateStrategy::isWarm(const Algorithm &algorithm) const
+{
+    return algorithm.perf_algo() == m_algorithm.perf_algo() || algorithm.perf_algo() == Workers::standby();
+}
+
+
+xmrig::IStrategy *xmrig::DonateStrategy::createStrategy()
+{
+    if (m_pools.size() > 1) {
+        return new FailoverStrategy(m_pools, 1, 2, this, true);
+    }
+
+    return new SinglePoolStrategy(m_pools.front(), 1, 2, this, true);
+}
+
+
+// the donate pool sent a job of an algorithm without programs on the GPUs, the donation waits for the next
+// algo switch of the user pool, but no longer than one idle period
+void xmrig::DonateStrategy::defer()
+{
+    const uint64_t now = uv_now(NetThread::loop());
+
+    if (!m_pending) {
+        m_pending  = true;
+        m_deferred = now;
+    }
+
+    m_stop = now + 1;
+
+    idle(m_deferred + m_idleTime > now ? m_deferred + m_idleTime - now : 0);
+}
+
+
 void xmrig::DonateStrategy::idle(uint64_t timeout)
 {
     uv_timer_start(&m_timer, DonateStrategy::onTimer, timeout, 0);
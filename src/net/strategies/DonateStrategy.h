@@ -66,17 +66,24 @@ protected:
     void onResultAccepted(IStrategy *strategy, Client *client, const SubmitResult &result, const char *error) override;
 
 private:
+    bool isWarm(const Algorithm &algorithm) const;
+    IStrategy *createStrategy();
+    void defer();
     void idle(uint64_t timeout);
     void suspend();
 
     static void onTimer(uv_timer_t *handle);
 
     bool m_active;
+    bool m_force;
+    bool m_pending;
+    Algorithm m_algorithm;
     const uint64_t m_donateTime;
     const uint64_t m_idleTime;
     IStrategy *m_strategy;
     IStrategyListener *m_listener;
     std::vector<Pool> m_pools;
+    uint64_t m_deferred;
     uint64_t m_now;
     uint64_t m_stop;
     uv_timer_t m_timer;
@@ -22,21 +22,103 @@
  *   along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "api/EventStream.h"
 #include "workers/Benchmark.h"
 #include "workers/Workers.h"
+#include "workers/OclThread.h"
+#include "amd/GpuContext.h"
+#include "amd/GpuTelemetry.h"
+#include "amd/OclCache.h"
+#include "amd/OclGPU.h"
+#include "amd/OclKernelBench.h"
+#include "amd/OclProfiles.h"
 #include "core/Config.h"
+#include "crypto/CryptoNight_constants.h"
 #include "net/Network.h"
 #include "common/log/Log.h"
+#include "rapidjson/document.h"
+#include "rapidjson/prettywriter.h"
+#include "rapidjson/stringbuffer.h"
+#include <algorithm>
 #include <chrono>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <uv.h>
+
+static const char* const tune_param_names[] = { "threads", "intensity", "worksize", "strided_index", "mem_chunk", "unroll", "build_flags", "power_cap", "stress" };
+static const char* const kernels[GpuContext::ProfileMax] = { "cn0", "cn00", "cn1", "cn2", "final" };
+
+static const uint64_t warm_up_time     = 3000; // time to skip after job start before measurements (in ms)
+static const uint64_t sample_time      = 2000; // time of each calibration hashrate sample (in ms)
+static const size_t   min_samples      = 5;    // minimal number of samples before calibration can stop
+static const double   max_ci_deviation = 0.01; // calibration stops when 95% confidence interval is within +-1% of mean
+static const uint64_t r_base_height    = 1806260; // first cn/r block of Monero, cn/r calibration samples go through heights from it
+static const size_t   r_min_heights    = 8;    // minimal number of heights (one per sample) before cn/r calibration can stop
 
 // start performance measurements for specified perf algo
 void Benchmark::start_perf_bench(const xmrig::PerfAlgo pa) {
+    join_prebuild(); // the programs of the new algo are in the cache now
     Workers::switch_algo(xmrig::Algorithm(pa)); // switch workers to new algo (Algo part)
+    m_pa = pa; // current perf algo
+    m_pf = xmrig::FORK_INVALID;
+    const xmrig::Variant variant = xmrig::Algorithm(pa).variant();
+    m_height = variant == xmrig::VARIANT_4 || variant == xmrig::VARIANT_WOW ? r_base_height : 0; // random math programs change with the height
+    init_devices();
+    const bool autotune = m_remote ? m_autotune : m_controller->config()->isAutotune();
+    const bool derived  = !m_remote && m_controller->config()->isDerivedThreads(pa); // other settings come from the source perf algo
+    if (!m_remote) m_stress = m_controller->config()->isStress();
+    if (autotune || derived || m_stress) { // tune rounds first, calibration round is started after them
+        m_tune_param = autotune ? TUNE_THREADS : derived ? TUNE_INTENSITY : TUNE_STRESS;
+        m_tune_last  = !autotune ? TUNE_INTENSITY : m_controller->config()->isAutotunePower() ? TUNE_POWER_CAP : TUNE_BUILD_FLAGS;
+        start_tune_param();
+    } else {
+        m_tune_param = TUNE_MAX;
+        start_calibration();
+    }
+}
+
+void Benchmark::start_calibration() {
+    start_job(xmrig::Algorithm::perfAlgoName(m_pa));
+    const xmrig::PerfAlgo next_pa = next_perf_algo();
+    if (next_pa == xmrig::PerfAlgo::PA_MAX || m_bench_mode) return; // compile time is a part of --bench report
+    // GPU settings of next perf algo are known (unless it is tuned), so its compilation can overlap with this round
+    std::vector<GpuContext*> running, next;
+    for (const xmrig::IThread* thread : m_controller->config()->threads()) running.push_back(static_cast<const xmrig::OclThread*>(thread)->ctx());
+    for (const xmrig::IThread* thread : m_controller->config()->threads(next_pa)) next.push_back(static_cast<const xmrig::OclThread*>(thread)->ctx());
+    m_prebuild = PrebuildOpenCL(running, next, xmrig::Algorithm(next_pa), m_controller->config());
+}
+
+xmrig::PerfAlgo Benchmark::next_perf_algo() const {
+    const auto it = std::find(m_algos.begin(), m_algos.end(), m_pa);
+    return it == m_algos.end() || it + 1 == m_algos.end() ? xmrig::PerfAlgo::PA_MAX : *(it + 1);
+}
 
+xmrig::PerfFork Benchmark::next_perf_fork() const {
+    if (!m_gpus.empty() || m_bench_mode) return xmrig::FORK_INVALID; // ratios are of the whole rig and not in --bench report
+    for (int f = m_pf + 1; f < xmrig::PerfFork::FORK_MAX; ++ f) {
+        const xmrig::PerfFork pf = static_cast<xmrig::PerfFork>(f);
+        if (xmrig::Algorithm::perfForkAlgo(pf) == m_pa) return pf;
+    }
+    return xmrig::FORK_INVALID;
+}
+
+// the perf fork variant comes with the job, its cn1 kernel is already in the programs of the current perf algo
+void Benchmark::start_perf_fork(const xmrig::PerfFork pf) {
+    m_pf = pf;
+    start_job(xmrig::Algorithm::perfForkName(pf));
+}
+
+void Benchmark::join_prebuild() {
+    if (m_prebuild.joinable()) m_prebuild.join();
+}
+
+void Benchmark::start_job(const char* id, const bool warm_up) {
     // prepare test job for benchmark runs
     xmrig::Job job;
     job.setPoolId(-100); // to make sure we can detect benchmark jobs
-    job.setId(xmrig::Algorithm::perfAlgoName(pa)); // need to set different id so that workers will see job change
+    snprintf(m_job_id, sizeof(m_job_id), "%s", id);
+    job.setId(m_job_id); // need to set different id so that workers will see job change
     const static uint8_t test_input[76] = {
         0x99, // 0x99 here to trigger all future algo versions for auto veriant detection based on block version
         0x05, 0xA0, 0xDB, 0xD6, 0xBF, 0x05, 0xCF, 0x16, 0xE5, 0x03, 0xF3, 0xA6, 0x6F, 0x78, 0x00,
@@ -47,46 +129,742 @@ void Benchmark::start_perf_bench(const xmrig::PerfAlgo pa) {
     };
     job.setRawBlob(test_input, 76);
     job.setTarget("FFFFFFFFFFFFFF00"); // set difficulty to 256 cause onJobResult after every 256-th computed hash
-    job.setAlgorithm(xmrig::Algorithm(pa)); // set job algo (for Variant part)
-    m_pa = pa; // current perf algo
-    m_hash_count = 0; // number of hashes calculated for current perf algo
-    m_time_start = 0; // init time of measurements start (in ms) during the first onJobResult
+    job.setAlgorithm(m_pf != xmrig::FORK_INVALID ? xmrig::Algorithm(m_pf) : xmrig::Algorithm(m_pa)); // set job algo (for Variant part)
+    job.setHeight(m_height);
+    if (warm_up) {
+        m_time_job   = get_now();
+        m_time_start = 0; // init time of measurements start (in ms) during the first onJobResult after warm-up
+    }
     Workers::setJob(job, false); // set job for workers to compute
 }
 
+// the workers swap the program in XMRSetJob like on a new block, the next program was precompiled in background,
+// so the swap is a part of the next sample as it is a part of real mining
+void Benchmark::next_height() {
+    char id[64];
+    snprintf(id, sizeof(id), "%s@%" PRIu64, xmrig::Algorithm::perfAlgoName(m_pa), ++ m_height);
+    ++ m_heights;
+    start_job(id, false);
+}
+
+void Benchmark::init_devices() {
+    const std::vector<xmrig::IThread*>& threads = m_controller->config()->threads();
+    m_devices.clear();
+    for (size_t i = 0; i != threads.size(); ++i) {
+        const xmrig::OclThread* const thread = static_cast<const xmrig::OclThread*>(threads[i]);
+        if (!m_gpus.empty() && std::find(m_gpus.begin(), m_gpus.end(), thread->index()) == m_gpus.end()) continue; // not selected for API run
+        size_t d = 0;
+        while (d != m_devices.size() && m_devices[d].index != thread->index()) ++ d;
+        if (d == m_devices.size()) { // first thread of GPU defines its start values
+            BenchDevice device;
+            device.index = thread->index();
+            device.best[TUNE_THREADS]       = 0; // counted below
+            device.best[TUNE_INTENSITY]     = thread->intensity();
+            device.best[TUNE_WORKSIZE]      = thread->worksize();
+            device.best[TUNE_STRIDED_INDEX] = static_cast<size_t>(thread->stridedIndex());
+            device.best[TUNE_MEM_CHUNK]     = static_cast<size_t>(thread->memChunk());
+            device.best[TUNE_UNROLL]        = static_cast<size_t>(thread->unrollFactor());
+            device.best[TUNE_BUILD_FLAGS]   = static_cast<size_t>(thread->buildFlags());
+            device.best[TUNE_POWER_CAP]     = static_cast<size_t>(thread->powerCap());
+            device.best[TUNE_STRESS]        = 0; // nothing verified yet
+            device.best_hashrate   = 0.0;
+            device.best_efficiency = 0.0;
+            device.best_cpu        = 0;
+            device.footprint       = 0; // set below once all threads are counted
+            device.hash_count    = 0;
+            device.checked       = 0;
+            device.invalid       = 0;
+            device.swap_count    = 0;
+            device.swap_time     = 0;
+            device.gfx_busy      = 0.0;
+            device.memory_busy   = 0.0;
+            device.busy_samples  = 0;
+            device.failed        = false;
+            device.stress_down   = false;
+            m_devices.push_back(device);
+        }
+        m_devices[d].threads.push_back(i);
+        m_devices[d].pool.push_back(static_cast<xmrig::OclThread*>(threads[i]));
+        ++ m_devices[d].best[TUNE_THREADS];
+    }
+    for (BenchDevice& device : m_devices) device.footprint = device.best[TUNE_INTENSITY] * device.best[TUNE_THREADS];
+}
+
+uint64_t Benchmark::device_hash_count(const BenchDevice& device) const {
+    uint64_t hash_count = 0;
+    for (const size_t thread : device.threads) hash_count += Workers::hashCount(thread);
+    return hash_count;
+}
+
+void Benchmark::device_swaps(const BenchDevice& device, uint64_t& count, uint64_t& time) const {
+    const std::vector<xmrig::IThread*>& threads = m_controller->config()->threads();
+    count = time = 0;
+    for (const size_t i : device.threads) {
+        const GpuContext* const ctx = static_cast<const xmrig::OclThread*>(threads[i])->ctx();
+        count += ctx->swapCount;
+        time  += ctx->swapTime;
+    }
+}
+
+uint64_t Benchmark::hash_count() const {
+    uint64_t hash_count = Workers::cpuHashCount(); // CPU threads count in the rig hashrate only
+    for (const BenchDevice& device : m_devices) hash_count += device_hash_count(device);
+    return hash_count;
+}
+
+bool Benchmark::is_converged(double& mean, double& stddev) const {
+    mean = stddev = 0.0;
+    if (m_samples.empty()) return false;
+    for (const double sample : m_samples) mean += sample;
+    mean /= m_samples.size();
+    if (m_samples.size() < 2) return false;
+    for (const double sample : m_samples) stddev += (sample - mean) * (sample - mean);
+    stddev = sqrt(stddev / (m_samples.size() - 1));
+    const size_t min = m_height && m_pf == xmrig::FORK_INVALID ? r_min_heights : min_samples; // the mean of cn/r is over programs of several heights
+    return m_samples.size() >= min && 1.96 * stddev / sqrt(m_samples.size()) <= max_ci_deviation * mean;
+}
+
+void Benchmark::start_tune_param() {
+    const xmrig::Algorithm algorithm(m_pa);
+    const size_t memory = xmrig::cn_select_memory(algorithm.algo());
+    const std::vector<xmrig::IThread*>& threads = m_controller->config()->threads();
+    for (; m_tune_param != TUNE_MAX; m_tune_param = next_tune_param(m_tune_param)) {
+        m_tune_rounds = 0;
+        for (BenchDevice& device : m_devices) {
+            const size_t best = device.best[m_tune_param];
+            const GpuContext* const ctx = static_cast<const xmrig::OclThread*>(threads[device.threads.front()])->ctx();
+            std::vector<size_t> candidates;
+            switch (m_tune_param) {
+                case TUNE_THREADS: // the scratchpads of the GPU split between 1 to 3 host threads
+                    for (const size_t count : { 1, 2, 3 }) {
+                        const size_t intensity = split_intensity(device, count);
+                        if (intensity == 0 || intensity * memory > ctx->freeMem) continue; // the same buffer limit as for intensity
+                        candidates.push_back(count);
+                    }
+                    break;
+                case TUNE_INTENSITY: {
+                    static const size_t percents[] = { 75, 88, 112 };
+                    for (const size_t percent : percents) {
+                        const size_t intensity = best * percent / 100 / 32 * 32; // multiple of all worksize candidates
+                        // the same memory limits as OclCLI uses for the default intensity
+                        if (intensity == 0 || intensity * memory > ctx->freeMem ||
+                            intensity * memory * device.threads.size() + 128 * 1024 * 1024 > ctx->globalMem) continue;
+                        candidates.push_back(intensity);
+                    }
+                    break;
+                }
+                case TUNE_WORKSIZE:      candidates = std::vector<size_t>({ 8, 16, 32 }); break;
+                case TUNE_STRIDED_INDEX:
+                    candidates = std::vector<size_t>({ 2, 1, 0 });
+                    if (ctx->vendor == xmrig::OCL_VENDOR_AMD) candidates.push_back(3); // NVIDIA kernels always use 0
+                    break;
+                case TUNE_MEM_CHUNK: // only used by strided_index 2 and 3, 3 also tries the 256 byte HBM2 channel interleave
+                    if (device.best[TUNE_STRIDED_INDEX] == 2) candidates = std::vector<size_t>({ 2, 1, 3 });
+                    if (device.best[TUNE_STRIDED_INDEX] == 3) candidates = std::vector<size_t>({ 2, 1, 3, 4 });
+                    break;
+                case TUNE_UNROLL:        candidates = std::vector<size_t>({ 8, 4, 2, 1 }); break;
+                case TUNE_BUILD_FLAGS: { // vendor flags only where the driver knows them, relaxed math where the kernels are exact without it
+                    const bool vendor = ctx->vendor == xmrig::OCL_VENDOR_AMD || ctx->vendor == xmrig::OCL_VENDOR_NVIDIA;
+                    for (const size_t flags : { 0, 1, 3, 4, 5, 7 }) {
+                        if ((flags & OclCache::BUILD_VENDOR_OPT) && !vendor) continue;
+                        if ((flags & OclCache::BUILD_RELAXED_MATH) && !OclCache::isRelaxedMath(algorithm.variant())) continue;
+                        candidates.push_back(flags);
+                    }
+                    break;
+                }
+                case TUNE_POWER_CAP: { // below the board limit only, 0 is the limit of the driver
+                    const size_t limit = static_cast<size_t>(GpuTelemetry::defaultPowerCap(device.index));
+                    for (const size_t percent : { 90, 80, 70 }) {
+                        if (limit * percent / 100 > 0) candidates.push_back(limit * percent / 100);
+                    }
+                    break;
+                }
+                case TUNE_STRESS: // steps up from the tuned intensity, the memory limits of the intensity param still hold
+                    for (const size_t percent : { 112, 125, 150, 175, 200 }) {
+                        const size_t intensity = device.best[TUNE_INTENSITY] * percent / 100 / 32 * 32;
+                        if (intensity * memory > ctx->freeMem || intensity * memory * device.threads.size() + 128 * 1024 * 1024 > ctx->globalMem) break;
+                        candidates.push_back(intensity);
+                    }
+                    break;
+                default:                 break;
+            }
+            // work group limit of the kernels loaded for the current values (cn/gpu ignores worksize)
+            const size_t max_worksize = ctx->kernels.workGroupSize && algorithm.variant() != xmrig::VARIANT_GPU ? ctx->kernels.workGroupSize : SIZE_MAX;
+            device.values = std::vector<size_t>(1, m_tune_param == TUNE_STRESS ? device.best[TUNE_INTENSITY] : best); // stress checks the tuned intensity first
+            device.stress_down = false;
+            for (const size_t value : candidates) {
+                if (m_tune_param == TUNE_STRIDED_INDEX && value == 1 && algorithm.variant() >= xmrig::VARIANT_2) continue; // not compatible
+                if (m_tune_param == TUNE_WORKSIZE && device.best[TUNE_INTENSITY] % value != 0) continue;
+                if (m_tune_param == TUNE_WORKSIZE && value > max_worksize) continue; // rejected by the loaded kernels
+                bool is_new = true;
+                for (const size_t v : device.values) if (v == value) is_new = false;
+                if (is_new) device.values.push_back(value);
+            }
+            m_tune_rounds = std::max(m_tune_rounds, device.values.size());
+        }
+        if (m_tune_rounds > 1 || (m_tune_param == TUNE_STRESS && m_tune_rounds > 0)) break; // something to check for this param, stress always verifies the tuned values
+    }
+    m_tune_round = 0;
+    if (m_tune_param != TUNE_MAX) {
+        start_tune_round();
+        return;
+    }
+    // all params are tuned: report them and run calibration round with best values
+    for (const BenchDevice& device : m_devices) {
+        Log::i()->text(m_controller->config()->isColors()
+            ? GREEN_BOLD(" ===> ") CYAN_BOLD("%s") WHITE_BOLD(" GPU #%zu tuned: ") CYAN_BOLD("threads %zu, intensity %zu, worksize %zu, strided_index %zu, mem_chunk %zu, unroll %zu, build_flags %zu")
+            : " ===> %s GPU #%zu tuned: threads %zu, intensity %zu, worksize %zu, strided_index %zu, mem_chunk %zu, unroll %zu, build_flags %zu",
+            xmrig::Algorithm::perfAlgoName(m_pa), device.index,
+            device.best[TUNE_THREADS], device.best[TUNE_INTENSITY], device.best[TUNE_WORKSIZE], device.best[TUNE_STRIDED_INDEX], device.best[TUNE_MEM_CHUNK], device.best[TUNE_UNROLL],
+            device.best[TUNE_BUILD_FLAGS]
+        );
+        if (device.best[TUNE_POWER_CAP]) {
+            Log::i()->text(m_controller->config()->isColors()
+                ? GREEN_BOLD(" ===> ") CYAN_BOLD("%s") WHITE_BOLD(" GPU #%zu power cap: ") CYAN_BOLD("%zu W")
+                : " ===> %s GPU #%zu power cap: %zu W",
+                xmrig::Algorithm::perfAlgoName(m_pa), device.index, device.best[TUNE_POWER_CAP]
+            );
+        }
+        if (!m_stress) continue;
+        if (device.best[TUNE_STRESS]) {
+            Log::i()->text(m_controller->config()->isColors()
+                ? GREEN_BOLD(" ===> ") CYAN_BOLD("%s") WHITE_BOLD(" GPU #%zu highest error-free intensity: ") CYAN_BOLD("%zu")
+                : " ===> %s GPU #%zu highest error-free intensity: %zu",
+                xmrig::Algorithm::perfAlgoName(m_pa), device.index, device.best[TUNE_STRESS]
+            );
+        } else {
+            Log::i()->text(m_controller->config()->isColors()
+                ? GREEN_BOLD(" ===> ") CYAN_BOLD("%s") WHITE_BOLD(" GPU #%zu: ") RED_BOLD("no error-free intensity, check clocks and voltages")
+                : " ===> %s GPU #%zu: no error-free intensity, check clocks and voltages",
+                xmrig::Algorithm::perfAlgoName(m_pa), device.index
+            );
+        }
+    }
+    reconfigure();
+    for (const BenchDevice& device : m_devices) { // tuned threads are the profile of this GPU model for next autoconf
+        std::vector<const xmrig::OclThread*> tuned;
+        for (const size_t i : device.threads) tuned.push_back(static_cast<const xmrig::OclThread*>(threads[i]));
+        OclProfiles::update(*tuned.front()->ctx(), m_pa, tuned);
+    }
+    start_calibration();
+}
+
+void Benchmark::start_tune_round() {
+    reconfigure();
+    // other compiler options may change the results, the new programs are checked against the test vectors before the job
+    const std::vector<xmrig::IThread*>& threads = m_controller->config()->threads();
+    for (BenchDevice& device : m_devices) {
+        device.failed = m_tune_param == TUNE_BUILD_FLAGS && m_tune_round < device.values.size() &&
+                        !xmrig::OclKernelBench::verify(static_cast<const xmrig::OclThread*>(threads[device.threads.front()])->ctx(), xmrig::Algorithm(m_pa));
+    }
+    char id[64];
+    snprintf(id, sizeof(id), "%s/%u", xmrig::Algorithm::perfAlgoName(m_pa), ++ m_job_seq);
+    start_job(id);
+}
+
+void Benchmark::finish_tune_round(const uint64_t now) {
+    if (m_tune_param == TUNE_STRESS) {
+        finish_stress_round();
+        return;
+    }
+    for (BenchDevice& device : m_devices) {
+        if (m_tune_round >= device.values.size()) continue; // nothing was checked on this GPU
+        if (device.failed) { // never the best, a failed current value falls back to the default options
+            Log::i()->text(m_controller->config()->isColors()
+                ? GREEN_BOLD(" ===> ") CYAN_BOLD("%s") WHITE_BOLD(" GPU #%zu %s %zu: ") RED_BOLD("wrong hashes")
+                : " ===> %s GPU #%zu %s %zu: wrong hashes",
+                xmrig::Algorithm::perfAlgoName(m_pa), device.index, tune_param_names[m_tune_param], device.values[m_tune_round]
+            );
+            if (m_tune_round == 0) {
+                device.best_hashrate = 0.0;
+                device.best[m_tune_param] = 0;
+            }
+            continue;
+        }
+        const double hashrate = static_cast<double>(device_hash_count(device) - device.hash_count) / (now - m_time_start) * 1000.0;
+        if (m_tune_param == TUNE_POWER_CAP) { // the power sensor is read every 2 seconds, at the end of the round it runs at the cap
+            const double efficiency = GpuTelemetry::sensors(device.index).hashesPerJoule(hashrate);
+            Log::i()->text(m_controller->config()->isColors()
+                ? GREEN_BOLD(" ===> ") CYAN_BOLD("%s") WHITE_BOLD(" GPU #%zu %s %zu: ") CYAN_BOLD("%.1f") WHITE_BOLD(" (%.2f H/J)")
+                : " ===> %s GPU #%zu %s %zu: %.1f (%.2f H/J)",
+                xmrig::Algorithm::perfAlgoName(m_pa), device.index, tune_param_names[m_tune_param], device.values[m_tune_round], hashrate, efficiency
+            );
+            if (m_tune_round == 0 || efficiency > device.best_efficiency) {
+                device.best_hashrate   = hashrate;
+                device.best_efficiency = efficiency;
+                device.best[m_tune_param] = device.values[m_tune_round];
+            }
+            continue;
+        }
+        uint32_t cpu = 0;
+        for (const size_t i : device.threads) cpu += Workers::hostCpu(i);
+        Log::i()->text(m_controller->config()->isColors()
+            ? GREEN_BOLD(" ===> ") CYAN_BOLD("%s") WHITE_BOLD(" GPU #%zu %s %zu: ") CYAN_BOLD("%.1f") WHITE_BOLD(" (host CPU %.1f%%)")
+            : " ===> %s GPU #%zu %s %zu: %.1f (host CPU %.1f%%)",
+            xmrig::Algorithm::perfAlgoName(m_pa), device.index, tune_param_names[m_tune_param], device.values[m_tune_round], hashrate, cpu / 10.0
+        );
+        // another thread count has to be 1% faster for more host CPU and may be 1% slower for less
+        bool better = hashrate > device.best_hashrate;
+        if (m_tune_param == TUNE_THREADS && cpu != device.best_cpu) better = hashrate > device.best_hashrate * (cpu > device.best_cpu ? 1.01 : 0.99);
+        // the first round checks the current best value again to compare others under the same conditions
+        if (m_tune_round == 0 || better) {
+            if (m_tune_param == TUNE_THREADS) device.best[TUNE_INTENSITY] = split_intensity(device, device.values[m_tune_round]);
+            device.best_hashrate = hashrate;
+            device.best_cpu      = cpu;
+            device.best[m_tune_param] = device.values[m_tune_round];
+        }
+    }
+    if (++ m_tune_round < m_tune_rounds) {
+        start_tune_round();
+    } else {
+        m_tune_param = next_tune_param(m_tune_param);
+        start_tune_param();
+    }
+}
+
+// a step is clean when the CPU verified every result of the GPU as valid, the steps of a GPU go up from the tuned
+// intensity until the first one with errors, if the tuned intensity has errors they go down to the first clean one
+void Benchmark::finish_stress_round() {
+    m_tune_rounds = 0;
+    for (BenchDevice& device : m_devices) {
+        if (m_tune_round < device.values.size()) {
+            const Workers::BenchResults results = Workers::benchResults(device.index);
+            const size_t intensity = device.values[m_tune_round];
+            const uint64_t checked = results.checked - device.checked;
+            const uint64_t invalid = results.invalid - device.invalid;
+            const bool clean       = checked > 0 && invalid == 0; // a step without results verified nothing
+            m_stress_steps.push_back({ m_pa, device.index, intensity, checked, invalid });
+            Log::i()->text(m_controller->config()->isColors()
+                ? (clean ? GREEN_BOLD(" ===> ") CYAN_BOLD("%s") WHITE_BOLD(" GPU #%zu stress intensity %zu: ") GREEN_BOLD("%" PRIu64 " of %" PRIu64 " results invalid")
+                         : GREEN_BOLD(" ===> ") CYAN_BOLD("%s") WHITE_BOLD(" GPU #%zu stress intensity %zu: ") RED_BOLD("%" PRIu64 " of %" PRIu64 " results invalid"))
+                : " ===> %s GPU #%zu stress intensity %zu: %" PRIu64 " of %" PRIu64 " results invalid",
+                xmrig::Algorithm::perfAlgoName(m_pa), device.index, intensity, invalid, checked
+            );
+            if (clean) {
+                device.best[TUNE_STRESS] = std::max(device.best[TUNE_STRESS], intensity);
+                if (device.stress_down) { // the tuned intensity goes down to it for mining and the profile
+                    device.best[TUNE_INTENSITY] = intensity;
+                    device.values.resize(m_tune_round + 1);
+                }
+            } else if (device.best[TUNE_STRESS]) {
+                device.values.resize(m_tune_round + 1); // one step above the highest clean one
+            } else if (!device.stress_down) {
+                device.stress_down = true;
+                device.values.resize(m_tune_round + 1);
+                for (const size_t percent : { 88, 75, 50 }) {
+                    const size_t lower = intensity * percent / 100 / 32 * 32;
+                    if (lower >= std::max<size_t>(32, device.best[TUNE_WORKSIZE])) device.values.push_back(lower);
+                }
+            }
+        }
+        m_tune_rounds = std::max(m_tune_rounds, device.values.size());
+    }
+    if (++ m_tune_round < m_tune_rounds) {
+        start_tune_round();
+    } else {
+        m_tune_param = next_tune_param(m_tune_param);
+        start_tune_param();
+    }
+}
+
+Benchmark::TuneParam Benchmark::next_tune_param(const TuneParam param) const {
+    if (param < m_tune_last) return static_cast<TuneParam>(param + 1);
+    if (m_stress && param < TUNE_STRESS) return TUNE_STRESS;
+    return TUNE_MAX;
+}
+
+size_t Benchmark::tune_value(const BenchDevice& device, const TuneParam param) const {
+    if (param == m_tune_param && m_tune_round < device.values.size()) return device.values[m_tune_round];
+    if (param == TUNE_INTENSITY && m_tune_param == TUNE_THREADS && m_tune_round < device.values.size()) return split_intensity(device, device.values[m_tune_round]);
+    if (param == TUNE_INTENSITY && m_tune_param == TUNE_STRESS && m_tune_round < device.values.size()) return device.values[m_tune_round];
+    return device.best[param];
+}
+
+size_t Benchmark::split_intensity(const BenchDevice& device, const size_t threads) const {
+    if (threads == device.best[TUNE_THREADS]) return device.best[TUNE_INTENSITY];
+    const size_t step = std::max<size_t>(32, device.best[TUNE_WORKSIZE]); // multiple of all worksize candidates
+    return device.footprint / threads / step * step;
+}
+
+// another thread count is a restart of the OpenCL contexts of all GPUs, threads out of the running are only deleted
+// once the threads param is done, the restart released their GPU resources
+void Benchmark::reconfigure() {
+    Workers::reconfigure(apply_tune, this);
+    if (m_tune_param == TUNE_THREADS) return;
+    for (BenchDevice& device : m_devices) {
+        for (size_t t = device.threads.size(); t < device.pool.size(); ++ t) delete device.pool[t];
+        device.pool.resize(device.threads.size());
+    }
+}
+
+void Benchmark::apply_tune(void* arg) {
+    Benchmark* const self = static_cast<Benchmark*>(arg);
+    xmrig::Config* const config = self->m_controller->config();
+    // threads of a GPU are the first ones of its pool at the place of its first thread, threads of other GPUs are kept
+    std::vector<xmrig::IThread*> threads;
+    std::vector<bool> placed(self->m_devices.size(), false);
+    for (xmrig::IThread* const thread : config->threads()) {
+        size_t d = 0;
+        while (d != self->m_devices.size() && self->m_devices[d].index != thread->index()) ++ d;
+        if (d == self->m_devices.size()) {
+            threads.push_back(thread);
+            continue;
+        }
+        if (placed[d]) continue;
+        placed[d] = true;
+        BenchDevice& device = self->m_devices[d];
+        const size_t count  = self->tune_value(device, TUNE_THREADS);
+        while (device.pool.size() < count) device.pool.push_back(device.pool.front()->clone());
+        device.threads.clear();
+        for (size_t t = 0; t != count; ++ t) {
+            device.threads.push_back(threads.size());
+            threads.push_back(device.pool[t]);
+        }
+    }
+    config->setThreads(threads);
+    for (const BenchDevice& device : self->m_devices) {
+        for (const size_t i : device.threads) {
+            xmrig::OclThread* const thread = static_cast<xmrig::OclThread*>(threads[i]);
+            thread->setIntensity(self->tune_value(device, TUNE_INTENSITY));
+            thread->setWorksize(self->tune_value(device, TUNE_WORKSIZE));
+            thread->setStridedIndex(static_cast<int>(self->tune_value(device, TUNE_STRIDED_INDEX)));
+            thread->setMemChunk(static_cast<int>(self->tune_value(device, TUNE_MEM_CHUNK)));
+            thread->setUnrollFactor(static_cast<int>(self->tune_value(device, TUNE_UNROLL)));
+            thread->setBuildFlags(static_cast<int>(self->tune_value(device, TUNE_BUILD_FLAGS)));
+            thread->setPowerCap(static_cast<int>(self->tune_value(device, TUNE_POWER_CAP)));
+        }
+    }
+}
+
+void Benchmark::finish_calibration(const uint64_t now) {
+    double mean, stddev;
+    is_converged(mean, stddev);
+    const float hashrate = static_cast<float>(hash_count() - m_hash_count) / (now - m_time_start) * 1000.0f;
+    if (m_pf != xmrig::FORK_INVALID) {
+        finish_perf_fork(hashrate, mean > 0.0 ? stddev / mean * 100.0 : 0.0);
+        return;
+    }
+    if (m_gpus.empty()) m_controller->config()->set_algo_perf(m_pa, hashrate); // store hashrate result (of the whole rig only)
+    Log::i()->text(m_controller->config()->isColors()
+        ? GREEN_BOLD(" ===> ") CYAN_BOLD("%s") WHITE_BOLD(" hashrate: ") CYAN_BOLD("%f") WHITE_BOLD(" (stddev %.1f%%, %zu samples in %.1f s)")
+        : " ===> %s hasrate: %f (stddev %.1f%%, %zu samples in %.1f s)",
+        xmrig::Algorithm::perfAlgoName(m_pa),
+        hashrate,
+        mean > 0.0 ? stddev / mean * 100.0 : 0.0, m_samples.size(), (now - m_time_start) / 1000.0
+    );
+    if (m_height && m_pf == xmrig::FORK_INVALID && !m_samples.empty()) { // the stddev above is the spread between the programs of the heights
+        const auto range = std::minmax_element(m_samples.begin(), m_samples.end());
+        uint64_t swaps = 0, swap_time = 0;
+        for (const BenchDevice& device : m_devices) {
+            uint64_t count, time;
+            device_swaps(device, count, time);
+            swaps     += count - device.swap_count;
+            swap_time += time - device.swap_time;
+        }
+        Log::i()->text(m_controller->config()->isColors()
+            ? GREEN_BOLD(" ===> ") CYAN_BOLD("%s") WHITE_BOLD(" over %zu heights: ") CYAN_BOLD("%f - %f") WHITE_BOLD(" (program swap %.2f ms)")
+            : " ===> %s over %zu heights: %f - %f (program swap %.2f ms)",
+            xmrig::Algorithm::perfAlgoName(m_pa), m_heights, *range.first, *range.second, swaps ? swap_time / 1e6 / swaps : 0.0
+        );
+    }
+    for (const BenchDevice& device : m_devices) { // store hashrate result of each GPU
+        const float device_hashrate = static_cast<float>(device_hash_count(device) - device.hash_count) / (now - m_time_start) * 1000.0f;
+        const GpuContext* const ctx = static_cast<const xmrig::OclThread*>(m_controller->config()->threads()[device.threads.front()])->ctx();
+        m_controller->config()->set_device_algo_perf(ctx, m_pa, device_hashrate);
+        Log::i()->text(m_controller->config()->isColors()
+            ? GREEN_BOLD(" ===> ") CYAN_BOLD("%s") WHITE_BOLD(" GPU #%zu hashrate: ") CYAN_BOLD("%f")
+            : " ===> %s GPU #%zu hashrate: %f",
+            xmrig::Algorithm::perfAlgoName(m_pa), device.index,
+            device_hashrate
+        );
+        if (m_bench_mode || m_remote) add_report(device, device_hashrate, mean > 0.0 ? stddev / mean * 100.0 : 0.0);
+#       ifndef XMRIG_NO_API
+        if (m_remote && EventStream::isActive()) EventStream::benchmark(m_pa, device.index, device_hashrate);
+#       endif
+    }
+    m_pa_hashrate = hashrate;
+    const xmrig::PerfFork next_pf = next_perf_fork(); // variants of this perf algo with their own kernel go first
+    if (next_pf != xmrig::FORK_INVALID && hashrate > 0.0f) {
+        start_perf_fork(next_pf);
+        return;
+    }
+    finish_perf_algo();
+}
+
+// stores the ratio of the perf fork to the hashrate of its perf algo measured just before
+void Benchmark::finish_perf_fork(const float hashrate, const double stddev) {
+    m_controller->config()->set_perf_fork_ratio(m_pf, hashrate / m_pa_hashrate);
+    Log::i()->text(m_controller->config()->isColors()
+        ? GREEN_BOLD(" ===> ") CYAN_BOLD("%s") WHITE_BOLD(" hashrate: ") CYAN_BOLD("%f") WHITE_BOLD(" (%.3f of %s, stddev %.1f%%)")
+        : " ===> %s hashrate: %f (%.3f of %s, stddev %.1f%%)",
+        xmrig::Algorithm::perfForkName(m_pf),
+        hashrate, hashrate / m_pa_hashrate, xmrig::Algorithm::perfAlgoName(m_pa), stddev
+    );
+    const xmrig::PerfFork next_pf = next_perf_fork();
+    if (next_pf != xmrig::FORK_INVALID) {
+        start_perf_fork(next_pf);
+        return;
+    }
+    m_pf = xmrig::FORK_INVALID;
+    finish_perf_algo();
+}
+
+void Benchmark::finish_perf_algo() {
+    const xmrig::PerfAlgo next_pa = next_perf_algo(); // compute next perf algo to benchmark
+    if (next_pa != xmrig::PerfAlgo::PA_MAX) {
+        start_perf_bench(next_pa);
+    } else if (m_bench_mode) { // end of --bench run
+        m_pa = xmrig::PA_INVALID;
+        print_report();
+        Workers::stop();
+        uv_stop(uv_default_loop());
+    } else if (m_remote) {
+        finish_remote();
+    } else { // end of benchmarks and switching to jobs from the pool (network)
+        m_pa = xmrig::PA_INVALID;
+        if (m_shouldSaveConfig) m_controller->config()->save(); // save config with measured algo-perf
+        join_prebuild();
+        Workers::pause(); // do not compute anything before job from the pool
+        Workers::switch_algo(m_algorithm_orig); // switch workers to the original algorithm
+        m_controller->network()->connect();
+    }
+}
+
 void Benchmark::onJobResult(const xmrig::JobResult& result) {
     if (result.poolId != -100) { // switch to network pool jobs
-        Workers::setListener(m_controller->network());
+        if (!m_remote) Workers::setListener(m_controller->network()); // results of pool jobs before API run are only forwarded
         static_cast<xmrig::IJobResultListener*>(m_controller->network())->onJobResult(result);
         return;
     }
-    // ignore benchmark results for other perf algo
-    if (m_pa == xmrig::PA_INVALID || result.jobId != xmrig::Id(xmrig::Algorithm::perfAlgoName(m_pa))) return;
-    ++ m_hash_count;
+    // ignore benchmark results for other perf algo or tune round
+    if (m_pa == xmrig::PA_INVALID || result.jobId != xmrig::Id(m_job_id)) return;
     const uint64_t now = get_now();
-    if (!m_time_start) m_time_start = now; // time of measurements start (in ms)
-    else if (now - m_time_start > static_cast<unsigned>(m_controller->config()->calibrateAlgoTime())*1000) { // end of benchmark round for m_pa
-        const float hashrate = static_cast<float>(m_hash_count) * result.diff / (now - m_time_start) * 1000.0f;
-        m_controller->config()->set_algo_perf(m_pa, hashrate); // store hashrate result
-        Log::i()->text(m_controller->config()->isColors()
-            ? GREEN_BOLD(" ===> ") CYAN_BOLD("%s") WHITE_BOLD(" hashrate: ") CYAN_BOLD("%f")
-            : " ===> %s hasrate: %f",
-            xmrig::Algorithm::perfAlgoName(m_pa),
-            hashrate
-        );
-        const xmrig::PerfAlgo next_pa = static_cast<xmrig::PerfAlgo>(m_pa + 1); // compute next perf algo to benchmark
-        if (next_pa != xmrig::PerfAlgo::PA_MAX) {
-            start_perf_bench(next_pa);
-        } else { // end of benchmarks and switching to jobs from the pool (network)
-            m_pa = xmrig::PA_INVALID;
-            if (m_shouldSaveConfig) m_controller->config()->save(); // save config with measured algo-perf
-            Workers::pause(); // do not compute anything before job from the pool
-            Workers::switch_algo(m_algorithm_orig); // switch workers to the original algorithm
-            m_controller->network()->connect();
+    // hashes are taken from worker counters, so results only give points in time to check them
+    if (!m_time_start) {
+        if (now - m_time_job < warm_up_time) return; // skip warm-up of GPUs after job start
+        m_time_start = m_time_sample = now; // time of measurements start (in ms)
+        for (BenchDevice& device : m_devices) {
+            const Workers::BenchResults results = Workers::benchResults(device.index);
+            device.hash_count = device_hash_count(device);
+            device.checked    = results.checked;
+            device.invalid    = results.invalid;
+            device_swaps(device, device.swap_count, device.swap_time);
+            device.gfx_busy     = 0.0;
+            device.memory_busy  = 0.0;
+            device.busy_samples = 0;
+        }
+        m_hash_count = m_hash_count_sample = hash_count();
+        m_heights    = 1;
+        m_samples.clear();
+    } else if (m_tune_param != TUNE_MAX) {
+        const int round_time = m_tune_param == TUNE_STRESS ? m_controller->config()->stressTime() : m_controller->config()->autotuneTime();
+        if (now - m_time_start > static_cast<unsigned>(round_time)*1000) finish_tune_round(now);
+    } else {
+        if (now - m_time_sample >= sample_time) { // next hashrate sample is ready
+            const uint64_t hashes = hash_count();
+            m_samples.push_back(static_cast<double>(hashes - m_hash_count_sample) / (now - m_time_sample) * 1000.0);
+            m_time_sample       = now;
+            m_hash_count_sample = hashes;
+            for (BenchDevice& device : m_devices) { // busy counters of the driver tell if the algo is bound by memory bandwidth on the GPU
+                const GpuSensors sensors = GpuTelemetry::sensors(device.index);
+                if (sensors.gfxBusy < 0.0 || sensors.memoryBusy < 0.0) continue;
+                device.gfx_busy    += sensors.gfxBusy;
+                device.memory_busy += sensors.memoryBusy;
+                ++ device.busy_samples;
+            }
+            if (m_height && m_pf == xmrig::FORK_INVALID) next_height(); // each cn/r sample runs the program of another height
+        }
+        double mean, stddev;
+        // end of benchmark round for m_pa when hashrate is stable or calibrate-algo-time is over
+        if (is_converged(mean, stddev) || now - m_time_start > static_cast<unsigned>(m_controller->config()->calibrateAlgoTime())*1000) {
+            finish_calibration(now);
         }
     }
 }
 
+void Benchmark::add_report(const BenchDevice& device, const double hashrate, const double stddev) {
+    const std::vector<xmrig::IThread*>& threads = m_controller->config()->threads();
+    BenchReport report;
+    report.pa         = m_pa;
+    report.index      = device.index;
+    report.hashrate   = hashrate;
+    report.stddev     = stddev;
+    report.samples    = m_samples.size();
+    report.batch_time = 0;
+    report.build_time = 0;
+    report.cache_hit  = true;
+    report.heights    = m_height ? m_heights : 0;
+    report.swap_time  = 0;
+    report.gfx_busy    = device.busy_samples ? device.gfx_busy / device.busy_samples : -1.0;
+    report.memory_busy = device.busy_samples ? device.memory_busy / device.busy_samples : -1.0;
+    for (size_t k = 0; k != GpuContext::ProfileMax; ++k) report.kernel_time[k] = 0;
+    // GPU values are averages of its threads except program load that is reported for the slowest one
+    for (const size_t i : device.threads) {
+        const GpuContext* const ctx = static_cast<const xmrig::OclThread*>(threads[i])->ctx();
+        report.board       = ctx->board;
+        report.batch_time += Workers::batchTime(i) / device.threads.size();
+        report.build_time  = std::max(report.build_time, ctx->buildTime);
+        report.cache_hit   = report.cache_hit && ctx->cacheHit;
+        for (size_t k = 0; k != GpuContext::ProfileMax; ++k) report.kernel_time[k] += Workers::kernelTime(i, k) / device.threads.size();
+    }
+    uint64_t swaps, swap_time;
+    device_swaps(device, swaps, swap_time);
+    if (swaps > device.swap_count) report.swap_time = (swap_time - device.swap_time) / (swaps - device.swap_count);
+    m_reports.push_back(report);
+}
+
+void Benchmark::print_report() const {
+    if (m_controller->config()->isBenchCsv()) {
+        printf("algo,gpu,board,hashrate,stddev,samples");
+        for (const char* kernel : kernels) printf(",%s_ms", kernel);
+        printf(",batch_ms,overhead_ms,build_ms,cache,heights,swap_ms,gfx_busy,memory_busy\n");
+        for (const BenchReport& report : m_reports) {
+            uint64_t gpu_time = 0;
+            printf("%s,%zu,\"%s\",%.2f,%.2f,%zu", xmrig::Algorithm::perfAlgoName(report.pa), report.index, report.board.isNull() ? "" : report.board.data(),
+                   report.hashrate, report.stddev, report.samples);
+            for (const uint64_t time : report.kernel_time) { printf(",%.3f", time / 1e6); gpu_time += time; }
+            printf(",%.3f,%.3f,%" PRId64 ",%s,%zu,%.3f", report.batch_time / 1e6, report.batch_time > gpu_time ? (report.batch_time - gpu_time) / 1e6 : 0.0,
+                   report.build_time, report.cache_hit ? "hit" : "miss", report.heights, report.swap_time / 1e6);
+            if (report.gfx_busy >= 0.0) printf(",%.3f,%.3f\n", report.gfx_busy, report.memory_busy);
+            else printf(",,\n");
+        }
+        fflush(stdout);
+        return;
+    }
+
+    rapidjson::Document doc(rapidjson::kArrayType);
+    report_json(doc, doc);
+    rapidjson::StringBuffer buffer(nullptr, 4096);
+    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+    doc.Accept(writer);
+    printf("%s\n", buffer.GetString());
+    fflush(stdout);
+}
+
+void Benchmark::report_json(rapidjson::Value& rows, rapidjson::Document& doc) const {
+    using namespace rapidjson;
+    auto& allocator = doc.GetAllocator();
+    for (const BenchReport& report : m_reports) {
+        Value row(kObjectType);
+        Value kernel_time(kObjectType);
+        uint64_t gpu_time = 0;
+        for (size_t k = 0; k != GpuContext::ProfileMax; ++k) {
+            kernel_time.AddMember(StringRef(kernels[k]), report.kernel_time[k] / 1e6, allocator);
+            gpu_time += report.kernel_time[k];
+        }
+        row.AddMember("algo", StringRef(xmrig::Algorithm::perfAlgoName(report.pa)), allocator);
+        row.AddMember("gpu", static_cast<uint64_t>(report.index), allocator);
+        row.AddMember("board", report.board.toJSON(doc), allocator);
+        row.AddMember("hashrate", report.hashrate, allocator);
+        row.AddMember("stddev", report.stddev, allocator);
+        row.AddMember("samples", static_cast<uint64_t>(report.samples), allocator);
+        row.AddMember("kernels_ms", kernel_time, allocator);
+        row.AddMember("batch_ms", report.batch_time / 1e6, allocator);
+        row.AddMember("overhead_ms", report.batch_time > gpu_time ? (report.batch_time - gpu_time) / 1e6 : 0.0, allocator);
+        row.AddMember("build_ms", report.build_time, allocator);
+        row.AddMember("cache", StringRef(report.cache_hit ? "hit" : "miss"), allocator);
+        if (report.gfx_busy >= 0.0) {
+            row.AddMember("gfx_busy", report.gfx_busy, allocator);
+            row.AddMember("memory_busy", report.memory_busy, allocator);
+        }
+        if (report.heights) { // random math programs of several heights
+            row.AddMember("heights", static_cast<uint64_t>(report.heights), allocator);
+            row.AddMember("swap_ms", report.swap_time / 1e6, allocator);
+        }
+        rows.PushBack(row, allocator);
+    }
+}
+
+bool Benchmark::start_remote(const std::vector<xmrig::PerfAlgo>& algos, const std::vector<size_t>& gpus, const bool autotune, const bool stress) {
+    if (is_running() || algos.empty()) return false;
+    join_prebuild();
+    m_remote    = true;
+    m_autotune  = autotune;
+    m_stress    = stress;
+    m_algos     = algos;
+    m_gpus      = gpus;
+    m_reports.clear();
+    m_stress_steps.clear();
+    m_algorithm_orig = m_controller->config()->algorithm();
+    m_controller->network()->hold(true); // pool stays connected, its jobs are applied after the run
+    Workers::setListener(this);
+    Log::i()->text(m_controller->config()->isColors()
+        ? GREEN_BOLD(" >>>>> ") WHITE_BOLD("STARTING %s %s (with %i seconds round)")
+        : " >>>>> STARTING %s %s (with %i seconds round)",
+        autotune ? "AUTOTUNE" : stress ? "STRESS TEST" : "ALGO PERFORMANCE CALIBRATION", m_idle ? "ON IDLE GPUS" : "REQUESTED BY API", m_controller->config()->calibrateAlgoTime()
+    );
+    start_perf_bench(first_perf_algo());
+    return true;
+}
+
+bool Benchmark::start_idle(const std::vector<xmrig::PerfAlgo>& algos, const bool autotune) {
+    if (is_running()) return false;
+    m_idle = true;
+    if (!start_remote(algos, std::vector<size_t>(), autotune)) m_idle = false;
+    return m_idle;
+}
+
+void Benchmark::preempt() {
+    if (!m_idle || !is_running()) return;
+    if (m_tune_param != TUNE_MAX) { // threads get the best values found so far instead of ones of the interrupted round
+        m_tune_param = TUNE_MAX;
+        reconfigure();
+    }
+    Log::i()->text(m_controller->config()->isColors()
+        ? GREEN_BOLD(" >>>>> ") WHITE_BOLD("IDLE RUN INTERRUPTED BY POOL JOB (at %s)")
+        : " >>>>> IDLE RUN INTERRUPTED BY POOL JOB (at %s)",
+        xmrig::Algorithm::perfAlgoName(m_pa)
+    );
+    finish_remote();
+}
+
+void Benchmark::finish_remote() {
+    m_pa     = xmrig::PA_INVALID;
+    m_pf     = xmrig::FORK_INVALID;
+    m_remote = false;
+    m_idle   = false;
+    if (m_controller->config()->isAutoSave()) m_controller->config()->save(); // measured algo-perf and tuned "threads"
+    join_prebuild();
+    Workers::pause();
+    Workers::switch_algo(m_algorithm_orig);
+    Workers::setListener(m_controller->network());
+    m_controller->network()->hold(false);
+}
+
+void Benchmark::get_status(rapidjson::Document& doc) const {
+    using namespace rapidjson;
+    auto& allocator = doc.GetAllocator();
+    doc.SetObject();
+    doc.AddMember("running", is_running(), allocator);
+    doc.AddMember("remote", m_remote, allocator);
+    doc.AddMember("idle", m_idle, allocator);
+    Value algos(kArrayType);
+    for (const xmrig::PerfAlgo pa : m_algos) algos.PushBack(StringRef(xmrig::Algorithm::perfAlgoName(pa)), allocator);
+    doc.AddMember("algos", algos, allocator);
+    if (is_running()) {
+        doc.AddMember("algo", StringRef(m_pf != xmrig::FORK_INVALID ? xmrig::Algorithm::perfForkName(m_pf) : xmrig::Algorithm::perfAlgoName(m_pa)), allocator);
+        doc.AddMember("stage", StringRef(m_tune_param == TUNE_MAX ? "calibration" : tune_param_names[m_tune_param]), allocator);
+        doc.AddMember("round", static_cast<uint64_t>(m_tune_param == TUNE_MAX ? m_samples.size() : m_tune_round), allocator);
+        doc.AddMember("rounds", static_cast<uint64_t>(m_tune_param == TUNE_MAX ? 0 : m_tune_rounds), allocator);
+        if (m_height) doc.AddMember("height", m_height, allocator);
+    }
+    Value rows(kArrayType);
+    report_json(rows, doc);
+    doc.AddMember("results", rows, allocator);
+    Value steps(kArrayType);
+    for (const StressStep& step : m_stress_steps) {
+        Value row(kObjectType);
+        row.AddMember("algo", StringRef(xmrig::Algorithm::perfAlgoName(step.pa)), allocator);
+        row.AddMember("gpu", static_cast<uint64_t>(step.index), allocator);
+        row.AddMember("intensity", static_cast<uint64_t>(step.intensity), allocator);
+        row.AddMember("checked", step.checked, allocator);
+        row.AddMember("invalid", step.invalid, allocator);
+        row.AddMember("clean", step.checked > 0 && step.invalid == 0, allocator);
+        steps.PushBack(row, allocator);
+    }
+    doc.AddMember("stress", steps, allocator);
+}
+
 uint64_t Benchmark::get_now() const { // get current time in ms
     using namespace std::chrono;
     return time_point_cast<milliseconds>(high_resolution_clock::now()).time_since_epoch().count();
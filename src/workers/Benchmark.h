@@ -24,31 +24,154 @@
 
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
+#include <thread>
+#include <vector>
 
 #include "common/xmrig.h"
 #include "interfaces/IJobResultListener.h"
 #include "core/Controller.h"
 #include "common/crypto/Algorithm.h"
+#include "amd/GpuContext.h"
+#include "workers/OclThread.h"
+#include "rapidjson/fwd.h"
 
 class Benchmark : public xmrig::IJobResultListener {
+    enum TuneParam { TUNE_THREADS, TUNE_INTENSITY, TUNE_WORKSIZE, TUNE_STRIDED_INDEX, TUNE_MEM_CHUNK, TUNE_UNROLL, TUNE_BUILD_FLAGS, TUNE_POWER_CAP, TUNE_STRESS, TUNE_MAX };
+
+    struct BenchDevice {
+        size_t index;                // GPU index
+        std::vector<size_t> threads; // indexes of GPU threads in current algo threads
+        std::vector<xmrig::OclThread*> pool; // GPU threads get the first ones of them, clones are added for more threads
+        std::vector<size_t> values;  // values of current tune param to check (one per round, current best is the first)
+        size_t best[TUNE_MAX];       // best values of all tune params found so far (highest error-free intensity for stress)
+        double best_hashrate;        // GPU hashrate with best values
+        double best_efficiency;      // GPU hashes per joule with best values (power cap rounds)
+        uint32_t best_cpu;           // host CPU of GPU threads with best values (in 1/1000 of a core)
+        size_t footprint;            // intensity of all GPU threads at start that thread count candidates split
+        uint64_t hash_count;         // hash count of GPU threads at round start
+        uint64_t checked;            // verified results of GPU at round start
+        uint64_t invalid;            // invalid results of GPU at round start
+        uint64_t swap_count;         // CryptonightR program swaps of GPU threads at measurements start
+        uint64_t swap_time;          // total time of these swaps (in ns)
+        double gfx_busy;             // sum of graphics engine busy readings of calibration samples
+        double memory_busy;          // sum of memory controller busy readings of calibration samples
+        size_t busy_samples;         // calibration samples with busy readings
+        bool failed;                 // kernels of current round gave wrong hashes for the test vectors
+        bool stress_down;            // tuned intensity had errors, stress steps go down from it
+    };
+
+    // result of one stress step of one GPU
+    struct StressStep {
+        xmrig::PerfAlgo pa;
+        size_t index;
+        size_t intensity;
+        uint64_t checked; // CPU verified results
+        uint64_t invalid;
+    };
+
+    // --bench report of one GPU for one perf algo
+    struct BenchReport {
+        xmrig::PerfAlgo pa;
+        size_t index;
+        xmrig::String board;
+        double hashrate;
+        double stddev;                              // relative stddev of rig hashrate samples (in %)
+        size_t samples;
+        uint64_t kernel_time[GpuContext::ProfileMax]; // average kernel times (in ns)
+        uint64_t batch_time;                        // average host time of one batch (in ns)
+        int64_t build_time;                         // program load time (in ms)
+        bool cache_hit;                             // program was loaded from binary cache
+        size_t heights;                             // block heights the hashrate was measured over (0 if the program doesn't change with them)
+        uint64_t swap_time;                         // average program swap to the next height (in ns)
+        double gfx_busy;                            // average share of the time the graphics engine was busy (-1 if unknown)
+        double memory_busy;                         // average share of the time the memory controller was busy (-1 if unknown)
+    };
+
     bool m_shouldSaveConfig; // should save config after all benchmark rounds
+    bool m_bench_mode;       // standalone --bench run that exits after the report
+    bool m_remote;           // run started over the API, pool jobs are held until it ends
+    bool m_autotune;         // tune rounds of the run started over the API
+    bool m_idle;             // remote run started by the miner itself while no pool is reachable
+    bool m_stress;           // intensity stress steps after the tune rounds of the current run
+    std::vector<size_t> m_gpus;           // GPU indexes to tune and measure (all if empty)
+    std::vector<xmrig::PerfAlgo> m_algos; // perf algos to benchmark in order
+    std::vector<BenchReport> m_reports;   // --bench report rows
+    std::vector<StressStep> m_stress_steps; // stress steps of the run
+    std::vector<BenchDevice> m_devices; // GPUs of current perf algo threads
+    TuneParam m_tune_param; // current tune param (TUNE_MAX for final calibration round)
+    TuneParam m_tune_last;  // last tune param of the run before stress (only intensity for derived threads, power cap with --autotune-power)
+    size_t m_tune_round;    // current tune round for m_tune_param
+    size_t m_tune_rounds;   // number of tune rounds for m_tune_param
+    unsigned m_job_seq;     // sequence number to make unique job ids
+    uint64_t m_height;      // block height of benchmark jobs (0 unless the programs of the perf algo change with it)
+    size_t m_heights;       // heights the current calibration round went through
+    char m_job_id[64];      // id of current benchmark job
     xmrig::PerfAlgo m_pa;  // current perf algo we benchmark
-    uint64_t m_hash_count; // number of hashes calculated for current perf algo
+    xmrig::PerfFork m_pf;  // current perf fork of m_pa (FORK_INVALID for the calibration of m_pa itself)
+    float m_pa_hashrate;   // rig hashrate of m_pa that perf fork ratios are relative to
+    uint64_t m_hash_count; // hash count of all threads at measurements start
+    uint64_t m_time_job;   // time of benchmark job start (in ms) to skip warm-up after it
     uint64_t m_time_start; // time of measurements start for current perf algo (in ms)
+    uint64_t m_time_sample;       // time of current hashrate sample start (in ms)
+    uint64_t m_hash_count_sample; // hash count of all threads at current hashrate sample start
+    std::vector<double> m_samples; // hashrate samples of current calibration round
+    std::thread m_prebuild; // builds OpenCL programs of next perf algo during calibration round
     xmrig::Controller* m_controller; // to get access to config and network
     xmrig::Algorithm m_algorithm_orig; // previous algorithm to restore after benchmarking
 
     uint64_t get_now() const; // get current time in ms
+    void start_job(const char* id, bool warm_up = true); // set benchmark job with specified id for workers to compute
+    void next_height(); // continue calibration round on the next block height without warm-up
+    void start_calibration(); // start calibration round of current perf algo and prebuild of the next one
+    xmrig::PerfAlgo next_perf_algo() const; // perf algo to benchmark after current one (PA_MAX if none)
+    xmrig::PerfFork next_perf_fork() const; // perf fork of current perf algo to measure after current one (FORK_INVALID if none)
+    void start_perf_fork(xmrig::PerfFork); // start calibration round of perf fork variant on current perf algo threads
+    void finish_perf_fork(float hashrate, double stddev); // store measured perf fork ratio and go to next perf fork or algo
+    void finish_perf_algo(); // go to next perf algo or end the run
+    void add_report(const BenchDevice&, double hashrate, double stddev); // collect --bench report row
+    void print_report() const; // print --bench report to stdout
+    void report_json(rapidjson::Value& rows, rapidjson::Document& doc) const; // --bench report rows as JSON
+    void finish_remote(); // restore the pool algorithm and jobs after the run started over the API
+    void join_prebuild(); // wait for prebuild of next perf algo programs
+    void init_devices(); // group current perf algo threads by their GPUs
+    uint64_t device_hash_count(const BenchDevice&) const; // hash count of all GPU threads
+    uint64_t hash_count() const; // hash count of all threads
+    void device_swaps(const BenchDevice&, uint64_t& count, uint64_t& time) const; // CryptonightR program swaps of all GPU threads
+    bool is_converged(double& mean, double& stddev) const; // statistics of hashrate samples and if they are stable enough
+    void finish_calibration(uint64_t now); // store measured hashrates and go to next perf algo
+    void start_tune_param(); // start tune rounds for next tune param that has something to check
+    void start_tune_round(); // apply tune settings of current round and measure them
+    void finish_tune_round(uint64_t now); // update best tune values with measured GPU hashrates
+    void finish_stress_round(); // go up or down the intensity steps by the verified results of each GPU
+    TuneParam next_tune_param(TuneParam) const; // tune param after the one (TUNE_MAX if none)
+    size_t tune_value(const BenchDevice&, TuneParam) const; // value of tune param for current round
+    size_t split_intensity(const BenchDevice&, size_t threads) const; // intensity of each of threads keeping the GPU footprint
+    void reconfigure(); // restart workers with tune values of current round and delete GPU threads that are out of the running
+    static void apply_tune(void* arg); // set tune values of current round to GPU threads (called by Workers::reconfigure)
 
     void onJobResult(const xmrig::JobResult&) override; // onJobResult is called after each computed benchmark hash
 
     public:
-        Benchmark() : m_shouldSaveConfig(false) {}
-        virtual ~Benchmark() {}
+        Benchmark() : m_shouldSaveConfig(false), m_bench_mode(false), m_remote(false), m_autotune(false), m_idle(false), m_stress(false), m_tune_param(TUNE_MAX), m_tune_last(TUNE_BUILD_FLAGS), m_tune_round(0), m_tune_rounds(0), m_job_seq(0), m_height(0), m_heights(0),
+            m_pa(xmrig::PA_INVALID), m_pf(xmrig::FORK_INVALID), m_pa_hashrate(0.0f), m_hash_count(0), m_time_job(0), m_time_start(0), m_time_sample(0), m_hash_count_sample(0) {
+            m_job_id[0] = 0;
+            for (int a = 0; a != xmrig::PerfAlgo::PA_MAX; ++ a) m_algos.push_back(static_cast<xmrig::PerfAlgo>(a));
+        }
+        virtual ~Benchmark() { join_prebuild(); }
 
         void set_controller(xmrig::Controller* controller) { m_controller = controller; }
         void set_original_algorithm(const xmrig::Algorithm& algorithm) { m_algorithm_orig = algorithm; }
         void should_save_config() { m_shouldSaveConfig = true; }
+        void set_algos(const std::vector<xmrig::PerfAlgo>& algos) { m_algos = algos; }
+        void set_bench_mode(const std::vector<xmrig::PerfAlgo>& algos) { m_bench_mode = true; m_algos = algos; }
+        xmrig::PerfAlgo first_perf_algo() const { return m_algos.empty() ? xmrig::PerfAlgo::PA_MAX : m_algos.front(); }
         void start_perf_bench(const xmrig::PerfAlgo); // start benchmark for specified perf algo
+        bool is_running() const { return m_pa != xmrig::PA_INVALID; }
+        bool start_remote(const std::vector<xmrig::PerfAlgo>& algos, const std::vector<size_t>& gpus, bool autotune, bool stress = false); // API run while the pool stays connected
+        bool start_idle(const std::vector<xmrig::PerfAlgo>& algos, bool autotune); // remote run on GPUs without pool jobs
+        bool is_idle() const { return m_idle; }
+        void preempt(); // stop the idle run now, the held pool job is applied then
+        void get_status(rapidjson::Document& doc) const; // progress and results of the last API run
 };
@@ -0,0 +1,244 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018      SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2018 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ * Copyright 2018 MoneroOcean      <https://github.com/MoneroOcean>, <support@moneroocean.stream>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <cmath>
+
+
+#include "common/crypto/Algorithm.h"
+#include "common/log/Log.h"
+#include "rapidjson/document.h"
+#include "workers/Canary.h"
+
+
+bool xmrig::Canary::m_hasReport = false;
+xmrig::Canary::Group xmrig::Canary::m_a;
+xmrig::Canary::Group xmrig::Canary::m_b;
+int64_t xmrig::Canary::m_started = 0;
+xmrig::PerfAlgo xmrig::Canary::m_algo = xmrig::PA_INVALID;
+xmrig::Canary::Report xmrig::Canary::m_report;
+uint32_t xmrig::Canary::m_window = 0;
+
+
+static int64_t now()
+{
+    return static_cast<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+
+void xmrig::Canary::add(char group, size_t device, double hashrate, double efficiency, uint64_t checked, uint64_t errors)
+{
+    if (group != 'a' && group != 'b') {
+        return;
+    }
+
+    Group &value = group == 'a' ? m_a : m_b;
+    value.hashrate.push_back(hashrate);
+
+    if (efficiency > 0.0) {
+        value.efficiency.push_back(efficiency);
+    }
+
+    // counts of the window are the difference to the first sample of the GPU
+    const auto it = value.start.insert(std::make_pair(device, std::make_pair(checked, errors))).first;
+    value.checked += checked - it->second.first;
+    value.errors  += errors - it->second.second;
+    it->second     = std::make_pair(checked, errors);
+}
+
+
+// the window ends once both groups have samples of at least two GPU minutes
+void xmrig::Canary::tick(PerfAlgo algo, uint32_t window, bool colors)
+{
+    m_window = window;
+
+    if (algo != m_algo) {
+        return reset(algo);
+    }
+
+    if (now() - m_started < static_cast<int64_t>(m_window) * 1000 || m_a.hashrate.size() < 2 || m_b.hashrate.size() < 2) {
+        return;
+    }
+
+    m_report    = compare(m_a, m_b);
+    m_hasReport = true;
+
+    const Report &r = m_report;
+    if (r.significant) {
+        LOG_INFO(colors ? "\x1B[01;35mcanary\x1B[0m %s: group \x1B[01;37m%c\x1B[0m wins, b %+.2f%% (t %.2f, df %.0f), a %.1f H/s %.2f H/J %" PRIu64 "/%" PRIu64 " errors, b %.1f H/s %.2f H/J %" PRIu64 "/%" PRIu64 " errors"
+                        : "canary %s: group %c wins, b %+.2f%% (t %.2f, df %.0f), a %.1f H/s %.2f H/J %" PRIu64 "/%" PRIu64 " errors, b %.1f H/s %.2f H/J %" PRIu64 "/%" PRIu64 " errors",
+                 Algorithm::perfAlgoName(r.algo), r.winner, r.difference, r.t, r.df,
+                 r.a.hashrate, r.a.efficiency, r.a.errors, r.a.checked, r.b.hashrate, r.b.efficiency, r.b.errors, r.b.checked);
+    }
+    else {
+        LOG_INFO(colors ? "\x1B[01;35mcanary\x1B[0m %s: no significant difference, b %+.2f%% (t %.2f, df %.0f), a %" PRIu64 "/%" PRIu64 " errors, b %" PRIu64 "/%" PRIu64 " errors"
+                        : "canary %s: no significant difference, b %+.2f%% (t %.2f, df %.0f), a %" PRIu64 "/%" PRIu64 " errors, b %" PRIu64 "/%" PRIu64 " errors",
+                 Algorithm::perfAlgoName(r.algo), r.difference, r.t, r.df, r.a.errors, r.a.checked, r.b.errors, r.b.checked);
+    }
+
+    reset(algo);
+}
+
+
+#ifndef XMRIG_NO_API
+void xmrig::Canary::toJSON(rapidjson::Document &doc)
+{
+    using namespace rapidjson;
+
+    doc.SetObject();
+    auto &allocator = doc.GetAllocator();
+
+    auto group = [&](const Summary &summary) {
+        Value value(kObjectType);
+        value.AddMember("gpus",       static_cast<uint64_t>(summary.gpus), allocator);
+        value.AddMember("samples",    static_cast<uint64_t>(summary.samples), allocator);
+        value.AddMember("hashrate",   summary.hashrate, allocator);
+        value.AddMember("stddev",     summary.stddev, allocator);
+        value.AddMember("efficiency", summary.efficiency, allocator);
+        value.AddMember("checked",    summary.checked, allocator);
+        value.AddMember("errors",     summary.errors, allocator);
+
+        return value;
+    };
+
+    Value current(kObjectType);
+    current.AddMember("algo",    m_algo != PA_INVALID ? Value(StringRef(Algorithm::perfAlgoName(m_algo))) : Value(kNullType), allocator);
+    current.AddMember("elapsed", (now() - m_started) / 1000, allocator);
+    current.AddMember("a",       group(summary(m_a)), allocator);
+    current.AddMember("b",       group(summary(m_b)), allocator);
+
+    doc.AddMember("window",  m_window, allocator);
+    doc.AddMember("current", current, allocator);
+
+    if (!m_hasReport) {
+        doc.AddMember("last", Value(kNullType), allocator);
+        return;
+    }
+
+    Value last(kObjectType);
+    last.AddMember("algo",        StringRef(Algorithm::perfAlgoName(m_report.algo)), allocator);
+    last.AddMember("finished",    m_report.finished, allocator);
+    last.AddMember("winner",      m_report.winner != '-' ? Value(m_report.winner == 'a' ? "a" : "b") : Value(kNullType), allocator);
+    last.AddMember("significant", m_report.significant, allocator);
+    last.AddMember("difference",  m_report.difference, allocator);
+    last.AddMember("t",           m_report.t, allocator);
+    last.AddMember("df",          m_report.df, allocator);
+    last.AddMember("a",           group(m_report.a), allocator);
+    last.AddMember("b",           group(m_report.b), allocator);
+
+    doc.AddMember("last", last, allocator);
+}
+#endif
+
+
+// two-sided 95% critical value of Student's t
+double xmrig::Canary::critical(double df)
+{
+    static const double table[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+
+    if (df < 1.0) {
+        return table[0];
+    }
+
+    if (df <= 30.0) {
+        return table[static_cast<size_t>(df) - 1];
+    }
+
+    return df <= 60.0 ? 2.021 : (df <= 120.0 ? 2.000 : 1.960);
+}
+
+
+xmrig::Canary::Report xmrig::Canary::compare(const Group &a, const Group &b)
+{
+    Report report;
+    report.algo     = m_algo;
+    report.finished = now();
+    report.a        = summary(a);
+    report.b        = summary(b);
+
+    const double va = report.a.stddev * report.a.stddev / report.a.samples;
+    const double vb = report.b.stddev * report.b.stddev / report.b.samples;
+
+    report.difference = report.a.hashrate > 0.0 ? (report.b.hashrate / report.a.hashrate - 1.0) * 100.0 : 0.0;
+
+    // Welch's t-test, the groups may differ in size and variance
+    if (va + vb > 0.0) {
+        report.t  = (report.b.hashrate - report.a.hashrate) / std::sqrt(va + vb);
+        report.df = (va + vb) * (va + vb) / (va * va / (report.a.samples - 1) + vb * vb / (report.b.samples - 1));
+    }
+
+    report.significant = va + vb > 0.0 && std::fabs(report.t) > critical(report.df);
+    report.winner      = report.significant ? (report.t > 0.0 ? 'b' : 'a') : '-';
+
+    return report;
+}
+
+
+xmrig::Canary::Summary xmrig::Canary::summary(const Group &group)
+{
+    Summary summary;
+    summary.gpus    = group.start.size();
+    summary.samples = group.hashrate.size();
+    summary.checked = group.checked;
+    summary.errors  = group.errors;
+
+    if (summary.samples == 0) {
+        return summary;
+    }
+
+    for (double value : group.hashrate) {
+        summary.hashrate += value;
+    }
+
+    summary.hashrate /= summary.samples;
+
+    // sample standard deviation
+    if (summary.samples > 1) {
+        for (double value : group.hashrate) {
+            summary.stddev += (value - summary.hashrate) * (value - summary.hashrate);
+        }
+
+        summary.stddev = std::sqrt(summary.stddev / (summary.samples - 1));
+    }
+
+    for (double value : group.efficiency) {
+        summary.efficiency += value / group.efficiency.size();
+    }
+
+    return summary;
+}
+
+
+void xmrig::Canary::reset(PerfAlgo algo)
+{
+    m_a       = Group();
+    m_b       = Group();
+    m_algo    = algo;
+    m_started = now();
+}
@@ -0,0 +1,115 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018      SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2018 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ * Copyright 2018 MoneroOcean      <https://github.com/MoneroOcean>, <support@moneroocean.stream>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef XMRIG_CANARY_H
+#define XMRIG_CANARY_H
+
+
+#include <map>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+
+#include "common/xmrig.h"
+#include "rapidjson/fwd.h"
+
+
+namespace xmrig {
+
+
+// A/B test of thread settings on identical GPUs: threads of the config carry "canary": "a" or "b" and every minute
+// each labelled GPU adds its 60s hashrate, H/J and CPU verification counts to its group. At the end of --canary-window
+// the groups are compared with Welch's t-test on the per minute hashrates of their GPUs, the result is logged and kept
+// for /1/canary, and the next window starts. An algo switch drops the window. Used from the uv loop only.
+class Canary
+{
+public:
+    // per minute samples of one group
+    struct Group
+    {
+        inline Group() : checked(0), errors(0) {}
+
+        std::map<size_t, std::pair<uint64_t, uint64_t> > start; // verification counts of each GPU at its first sample
+        std::vector<double> efficiency;
+        std::vector<double> hashrate;
+        uint64_t checked;
+        uint64_t errors;
+    };
+
+    struct Summary
+    {
+        inline Summary() : gpus(0), samples(0), checked(0), errors(0), efficiency(0.0), hashrate(0.0), stddev(0.0) {}
+
+        size_t gpus;
+        size_t samples;
+        uint64_t checked;
+        uint64_t errors;
+        double efficiency; // mean H/J, 0 without power readings
+        double hashrate;   // mean hashrate of a GPU
+        double stddev;
+    };
+
+    struct Report
+    {
+        inline Report() : algo(PA_INVALID), finished(0), df(0.0), difference(0.0), t(0.0), significant(false), winner('-') {}
+
+        PerfAlgo algo;
+        int64_t finished;  // ms since the epoch
+        double df;
+        double difference; // hashrate of b relative to a in %
+        double t;
+        bool significant;  // 95% two-sided
+        char winner;       // 'a', 'b' or '-' if the difference is not significant
+        Summary a;
+        Summary b;
+    };
+
+    static void add(char group, size_t device, double hashrate, double efficiency, uint64_t checked, uint64_t errors);
+    static void tick(PerfAlgo algo, uint32_t window, bool colors);
+
+#   ifndef XMRIG_NO_API
+    static void toJSON(rapidjson::Document &doc);
+#   endif
+
+private:
+    static double critical(double df);
+    static Report compare(const Group &a, const Group &b);
+    static Summary summary(const Group &group);
+    static void reset(PerfAlgo algo);
+
+    static bool m_hasReport;
+    static Group m_a;
+    static Group m_b;
+    static int64_t m_started;
+    static PerfAlgo m_algo;
+    static Report m_report;
+    static uint32_t m_window;
+};
+
+
+} /* namespace xmrig */
+
+
+#endif /* XMRIG_CANARY_H */
@@ -0,0 +1,175 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <thread>
+
+
+#include "common/Platform.h"
+#include "common/utils/timestamp.h"
+#include "core/Trace.h"
+#include "crypto/CryptoNight.h"
+#include "workers/CpuWorker.h"
+#include "Mem.h"
+
+
+// CPU threads take small chunks, a chunk of 256 hashes lasts well under a second
+static const uint32_t kChunkSize = 256;
+
+
+CpuWorker::CpuWorker(size_t id, int64_t cpu) :
+    m_cpu(cpu),
+    m_id(id),
+    m_stop(false),
+    m_hashCount(0),
+    m_timestamp(0),
+    m_chunk(0),
+    m_nonce(0),
+    m_sequence(0),
+    m_job(std::make_shared<const Workers::PublishedJob>())
+{
+}
+
+
+void CpuWorker::start()
+{
+    if (m_cpu >= 0) {
+        Platform::setThreadAffinity(static_cast<uint64_t>(m_cpu));
+    }
+
+    if (xmrig::Trace::isEnabled()) {
+        char name[32];
+        snprintf(name, sizeof(name), "CPU thread #%zu", m_id);
+        xmrig::Trace::setThreadName(name);
+    }
+
+    // the largest scratchpad fits every algorithm a pool can switch to
+    cryptonight_ctx *ctx;
+    MemInfo info = Mem::create(&ctx, xmrig::CRYPTONIGHT_HEAVY, 1);
+    Workers::addMemory("cpu", m_id, info);
+
+    uint8_t hash[32];
+    uint64_t count = 0;
+
+    while (!m_stop) {
+        if (Workers::isPaused()) {
+            Workers::waitResume();
+            continue;
+        }
+
+        if (Workers::isOutdated(m_sequence)) {
+            consumeJob();
+        }
+
+        if (!m_job->isValid() || !CryptoNight::selfTest(m_job->algorithm().algo(), m_job->algorithm().variant())) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            continue;
+        }
+
+        if (m_chunk == 0 && !nextChunk()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+
+        m_chunk--;
+
+        if (CryptoNight::hash(*m_job, m_nonce, hash, ctx)) {
+            Workers::submitCpu(m_job, m_nonce, hash);
+        }
+
+        m_nonce++;
+        m_hashCount.store(++count, std::memory_order_relaxed);
+        m_timestamp.store(static_cast<uint64_t>(xmrig::currentMSecsSinceEpoch()), std::memory_order_relaxed);
+    }
+
+    Mem::release(&ctx, 1, info);
+}
+
+
+bool CpuWorker::nextChunk()
+{
+    uint64_t extraNonce = 0;
+    if (!m_job->nonces || !m_job->nonces->take(kChunkSize, &m_nonce, &m_chunk, &extraNonce)) {
+        return false;
+    }
+
+    m_job = Workers::roll(m_job, extraNonce);
+    return true;
+}
+
+
+void CpuWorker::consumeJob()
+{
+    Workers::JobSnapshot job = Workers::job();
+    m_sequence = Workers::sequence();
+    if (m_job->id() == job->id() && m_job->clientId() == job->clientId()) {
+        return;
+    }
+
+    save(job);
+
+    if (resume(job)) {
+        return;
+    }
+
+    m_job   = std::move(job);
+    m_chunk = 0;
+}
+
+
+// like GPU threads, the taken nonces of a pool job are hashed when the pool comes back with the same job
+bool CpuWorker::resume(const Workers::JobSnapshot &job)
+{
+    if (job->poolId() < 0 || job->poolId() == m_job->poolId()) {
+        return false;
+    }
+
+    auto it = m_paused.find(job->poolId());
+    if (it == m_paused.end()) {
+        return false;
+    }
+
+    const bool same = it->second.job->id() == job->id();
+    if (same) {
+        m_job   = Workers::roll(job, it->second.job->extraNonce());
+        m_nonce = it->second.nonce;
+        m_chunk = it->second.chunk;
+    }
+
+    m_paused.erase(it);
+
+    return same;
+}
+
+
+void CpuWorker::save(const Workers::JobSnapshot &job)
+{
+    if (m_job->poolId() >= 0 && job->poolId() != m_job->poolId() && m_chunk > 0) {
+        PausedJob &paused = m_paused[m_job->poolId()];
+        paused.job   = m_job;
+        paused.nonce = m_nonce;
+        paused.chunk = m_chunk;
+    }
+}
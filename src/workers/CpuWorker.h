@@ -0,0 +1,80 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_CPUWORKER_H
+#define XMRIG_CPUWORKER_H
+
+
+#include <atomic>
+#include <map>
+
+
+#include "interfaces/IWorker.h"
+#include "workers/Workers.h"
+
+
+// hashes nonces of the current job on a spare CPU core, the job algorithm is used as is, so CPU threads
+// are not restarted by algo switches of the GPU threads
+class CpuWorker : public IWorker
+{
+public:
+    CpuWorker(size_t id, int64_t cpu);
+
+    inline void stop() { m_stop = true; }
+
+    inline uint64_t hashCount() const override { return m_hashCount.load(std::memory_order_relaxed); }
+    inline uint64_t timestamp() const override { return m_timestamp.load(std::memory_order_relaxed); }
+    inline bool selfTest() override            { return true; }
+    inline size_t id() const override          { return m_id; }
+
+    void start() override;
+
+private:
+    // rest of the chunk of a pool job which was interrupted by a job of another pool
+    struct PausedJob
+    {
+        Workers::JobSnapshot job;
+        uint32_t nonce;
+        uint32_t chunk;
+    };
+
+    bool nextChunk();
+    bool resume(const Workers::JobSnapshot &job);
+    void consumeJob();
+    void save(const Workers::JobSnapshot &job);
+
+    const int64_t m_cpu;
+    const size_t m_id;
+    std::atomic<bool> m_stop;
+    std::atomic<uint64_t> m_hashCount;
+    std::atomic<uint64_t> m_timestamp;
+    std::map<int, PausedJob> m_paused;
+    uint32_t m_chunk;
+    uint32_t m_nonce;
+    uint64_t m_sequence;
+    Workers::JobSnapshot m_job;
+};
+
+
+#endif /* XMRIG_CPUWORKER_H */
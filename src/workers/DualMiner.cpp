@@ -0,0 +1,395 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <chrono>
+#include <inttypes.h>
+#include <string.h>
+
+
+#include "amd/GpuContext.h"
+#include "amd/OclError.h"
+#include "amd/OclGPU.h"
+#include "amd/OclKernelBench.h"
+#include "amd/OclLib.h"
+#include "common/log/Log.h"
+#include "common/net/Client.h"
+#include "common/net/strategies/SinglePoolStrategy.h"
+#include "common/net/SubmitResult.h"
+#include "common/utils/timestamp.h"
+#include "core/Config.h"
+#include "core/Controller.h"
+#include "workers/DualMiner.h"
+#include "workers/Hashrate.h"
+#include "workers/OclThread.h"
+
+
+xmrig::DualMiner::DualMiner(Controller *controller) :
+    m_algorithm(controller->config()->dualPool().algorithms().front()),
+    m_connected(false),
+    m_controller(controller),
+    m_hashrate(nullptr),
+    m_strategy(nullptr),
+    m_enabled(true),
+    m_paused(true),
+    m_stop(false),
+    m_sequence(0),
+    m_accepted(0),
+    m_rejected(0),
+    m_ticks(0),
+    m_job(std::make_shared<const Workers::PublishedJob>())
+{
+    m_async.data = this;
+    uv_mutex_init(&m_mutex);
+}
+
+
+xmrig::DualMiner::~DualMiner()
+{
+    stop();
+
+    for (Thread *thread : m_threads) {
+        delete thread->ctx;
+        delete thread;
+    }
+
+    delete m_hashrate;
+    delete m_strategy;
+
+    uv_mutex_destroy(&m_mutex);
+}
+
+
+// the threads of the algorithm give the GPUs and their settings, pipelined batches and persistent kernels are not used
+// because a job change would leave a batch of the previous job in flight
+bool xmrig::DualMiner::start()
+{
+    Config *config   = m_controller->config();
+    const Pool &pool = config->dualPool();
+
+    if (pool.algorithms() == Pool::supportedAlgorithms() || m_algorithm.perf_algo() == PA_INVALID) {
+        LOG_ERR("\"dual-pool\" needs \"algos\" with the algorithm of the dual threads");
+        return false;
+    }
+
+    const std::vector<IThread *> &threads = config->threads(m_algorithm.perf_algo());
+    if (threads.empty()) {
+        LOG_ERR("no \"threads\" of %s for \"dual-pool\"", Algorithm::perfAlgoName(m_algorithm.perf_algo()));
+        return false;
+    }
+
+    std::vector<GpuContext *> contexts;
+    std::vector<size_t> devices;
+
+    for (const IThread *thread : threads) {
+        GpuContext *ctx = new GpuContext();
+        OclKernelBench::baseContext(static_cast<const OclThread *>(thread)->ctx(), ctx);
+        ctx->pipeline   = false;
+        ctx->persistent = false;
+
+        contexts.push_back(ctx);
+        devices.push_back(ctx->deviceIdx);
+        m_threads.push_back(new Thread(m_threads.size(), ctx));
+    }
+
+    // programs and buffers are made for the algorithm of the config, the mining threads are not running yet
+    const Algorithm algorithm = config->algorithm();
+    config->set_algorithm(m_algorithm);
+    const size_t ret = InitOpenCL(contexts, config, &m_contexts);
+    config->set_algorithm(algorithm);
+
+    if (ret != OCL_ERR_SUCCESS) {
+        LOG_ERR("dual threads of %s failed to start", m_algorithm.name());
+        return false;
+    }
+
+    Pool dual(pool);
+    dual.setAlgo(m_algorithm);
+
+    m_strategy = new SinglePoolStrategy(dual, config->pools().retryPause(), config->pools().retries(), this);
+    m_hashrate = new Hashrate(devices, m_algorithm.perf_algo(), m_controller, "dual speed");
+
+    uv_async_init(uv_default_loop(), &m_async, DualMiner::onResult);
+
+    for (Thread *thread : m_threads) {
+        thread->thread = std::thread(&DualMiner::run, this, thread);
+    }
+
+    LOG_INFO(config->isColors() ? WHITE_BOLD("dual mining ") CYAN_BOLD("%s") " on " WHITE_BOLD("%zu") " threads, experimental"
+                                : "dual mining %s on %zu threads, experimental",
+             m_algorithm.name(), m_threads.size());
+
+    return true;
+}
+
+
+void xmrig::DualMiner::connect()
+{
+    if (m_connected || !m_strategy) {
+        return;
+    }
+
+    m_connected = true;
+    m_strategy->connect();
+}
+
+
+void xmrig::DualMiner::print(bool detail) const
+{
+    if (!m_hashrate) {
+        return;
+    }
+
+    if (detail) {
+        char num1[8] = { 0 };
+        char num2[8] = { 0 };
+        char num3[8] = { 0 };
+
+        for (const Thread *thread : m_threads) {
+            Log::i()->text("| dual%2zu | %3zu | %7s | %7s | %7s |",
+                           thread->id, thread->ctx->deviceIdx,
+                           Hashrate::format(m_hashrate->calc(thread->id, Hashrate::ShortInterval), num1, sizeof num1),
+                           Hashrate::format(m_hashrate->calc(thread->id, Hashrate::MediumInterval), num2, sizeof num2),
+                           Hashrate::format(m_hashrate->calc(thread->id, Hashrate::LargeInterval), num3, sizeof num3)
+                           );
+        }
+    }
+
+    m_hashrate->print();
+}
+
+
+void xmrig::DualMiner::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+}
+
+
+void xmrig::DualMiner::stop()
+{
+    if (m_stop.exchange(true)) {
+        return;
+    }
+
+    if (m_strategy) {
+        m_strategy->stop();
+    }
+
+    for (Thread *thread : m_threads) {
+        if (thread->thread.joinable()) {
+            thread->thread.join();
+        }
+
+        ReleaseOpenCl(thread->ctx);
+    }
+
+    ReleaseOpenClContexts(m_contexts);
+
+    if (m_hashrate) {
+        m_hashrate->stop();
+        uv_close(reinterpret_cast<uv_handle_t*>(&m_async), nullptr);
+    }
+}
+
+
+void xmrig::DualMiner::tick()
+{
+    if (!m_hashrate) {
+        return;
+    }
+
+    for (const Thread *thread : m_threads) {
+        m_hashrate->add(thread->id, thread->hashCount.load(std::memory_order_relaxed), thread->timestamp.load(std::memory_order_relaxed));
+    }
+
+    if ((m_ticks++ & 0xF) == 0) {
+        m_hashrate->updateHighest();
+    }
+
+    if (m_strategy) {
+        m_strategy->tick(uv_now(uv_default_loop()));
+    }
+}
+
+
+void xmrig::DualMiner::onActive(IStrategy *, Client *client)
+{
+    LOG_INFO(m_controller->config()->isColors() ? WHITE_BOLD("use dual pool ") CYAN_BOLD("%s:%d ") "\x1B[1;30m%s"
+                                                : "use dual pool %s:%d %s",
+             client->host(), client->port(), client->ip());
+}
+
+
+// jobs of another algorithm would need other programs and buffers, the dual threads wait for a job they can mine
+void xmrig::DualMiner::onJob(IStrategy *, Client *client, const Job &job)
+{
+    if (job.algorithm().perf_algo() != m_algorithm.perf_algo()) {
+        LOG_WARN("dual pool %s:%d sent a %s job, the dual threads mine %s only", client->host(), client->port(), job.algorithm().shortName(), m_algorithm.shortName());
+
+        m_paused = true;
+        m_sequence++;
+        return;
+    }
+
+    LOG_INFO(m_controller->config()->isColors() ? MAGENTA_BOLD("new dual job") " from " WHITE_BOLD("%s:%d") " diff " WHITE_BOLD("%d") " algo " WHITE_BOLD("%s")
+                                                : "new dual job from %s:%d diff %d algo %s",
+             client->host(), client->port(), job.diff(), job.algorithm().shortName());
+
+    const uint64_t now = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    std::shared_ptr<Workers::PublishedJob> snapshot = std::make_shared<Workers::PublishedJob>(job, now);
+
+    const Workers::JobSnapshot previous = std::atomic_load(&m_job);
+    snapshot->nonces = previous->nonces && previous->nonces->isJob(job) ? previous->nonces : std::make_shared<NonceSpace>(job);
+
+    std::atomic_store(&m_job, Workers::JobSnapshot(std::move(snapshot)));
+
+    m_paused = false;
+    m_sequence++;
+}
+
+
+void xmrig::DualMiner::onPause(IStrategy *)
+{
+    LOG_ERR("no active dual pool, stop dual mining");
+
+    m_paused = true;
+    m_sequence++;
+}
+
+
+void xmrig::DualMiner::onResultAccepted(IStrategy *, Client *, const SubmitResult &result, const char *error)
+{
+    const bool isColors = m_controller->config()->isColors();
+
+    if (error) {
+        m_rejected++;
+
+        LOG_INFO(isColors ? "\x1B[1;31mdual rejected\x1B[0m (%" PRIu64 "/%" PRIu64 ") diff \x1B[1;37m%u\x1B[0m \x1B[31m\"%s\"\x1B[0m \x1B[1;30m(%" PRIu64 " ms)"
+                          : "dual rejected (%" PRIu64 "/%" PRIu64 ") diff %u \"%s\" (%" PRIu64 " ms)",
+                 m_accepted, m_rejected, result.diff, error, result.elapsed);
+        return;
+    }
+
+    m_accepted++;
+
+    LOG_INFO(isColors ? "\x1B[1;32mdual accepted\x1B[0m (%" PRIu64 "/%" PRIu64 ") diff \x1B[1;37m%u\x1B[0m \x1B[1;30m(%" PRIu64 " ms)"
+                      : "dual accepted (%" PRIu64 "/%" PRIu64 ") diff %u (%" PRIu64 " ms)",
+             m_accepted, m_rejected, result.diff, result.elapsed);
+}
+
+
+void xmrig::DualMiner::run(Thread *thread)
+{
+    GpuContext *ctx = thread->ctx;
+    cl_uint results[OCL_RESULT_SIZE];
+    uint8_t blob[Job::kMaxBlobSize];
+    uint64_t sequence = 0;
+    size_t errors     = 0;
+    Workers::JobSnapshot job = std::atomic_load(&m_job);
+
+    if (OclLib::isTrace()) {
+        char name[32];
+        snprintf(name, sizeof(name), "dual thread #%zu", thread->id);
+        OclLib::setThreadName(name);
+    }
+
+    while (!m_stop.load(std::memory_order_relaxed)) {
+        const uint64_t current = m_sequence.load(std::memory_order_acquire);
+        if (current != sequence) {
+            sequence = current;
+            job      = std::atomic_load(&m_job);
+
+            if (job->isValid()) {
+                uint64_t target = job->target();
+                if (Workers::minSubmitDiff() > 0) {
+                    target = std::min<uint64_t>(target, 0xFFFFFFFFFFFFFFFFULL / Workers::minSubmitDiff());
+                }
+
+                memcpy(blob, job->blob(), sizeof(blob));
+                XMRSetJob(ctx, blob, job->size(), target, job->algorithm().variant(), job->height());
+            }
+        }
+
+        uint32_t nonce = 0;
+        uint32_t taken = 0;
+
+        if (m_paused || !m_enabled || !job->isValid() || !job->nonces->take(static_cast<uint32_t>(ctx->rawIntensity), &nonce, &taken)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+
+        ctx->Nonce = nonce;
+
+        if (XMRRunJob(ctx, results, job->algorithm().variant(), taken) != OCL_ERR_SUCCESS) {
+            if (++errors >= kMaxErrors) {
+                LOG_ERR("dual thread #%zu stopped after %zu failed batches", thread->id, errors);
+                break;
+            }
+
+            continue;
+        }
+
+        errors = 0;
+
+        if (ctx->lostResults) {
+            LOG_WARN("dual thread #%zu lost %" PRIu64 " results past the output buffer, use --min-submit-diff", thread->id, ctx->lostResults);
+            ctx->lostResults = 0;
+        }
+
+        for (size_t i = 0; i < results[OCL_RESULT_SLOTS]; ++i) {
+            const uint8_t *hash = reinterpret_cast<const uint8_t *>(results + OCL_RESULT_HASHES + i * 8);
+
+            uint64_t value;
+            memcpy(&value, hash + 24, sizeof(value));
+            if (value >= job->target()) {
+                continue;
+            }
+
+            uv_mutex_lock(&m_mutex);
+            m_results.emplace_back(job->poolId(), job->id(), job->clientId(), results[i], hash, job->diff(), job->algorithm());
+            uv_mutex_unlock(&m_mutex);
+
+            uv_async_send(&m_async);
+        }
+
+        thread->hashCount.fetch_add(taken, std::memory_order_relaxed);
+        thread->timestamp.store(static_cast<uint64_t>(currentMSecsSinceEpoch()), std::memory_order_relaxed);
+    }
+}
+
+
+void xmrig::DualMiner::onResult(uv_async_t *handle)
+{
+    DualMiner *self = static_cast<DualMiner*>(handle->data);
+    std::vector<JobResult> results;
+
+    uv_mutex_lock(&self->m_mutex);
+    results.swap(self->m_results);
+    uv_mutex_unlock(&self->m_mutex);
+
+    for (const JobResult &result : results) {
+        self->m_strategy->submit(result);
+    }
+}
@@ -0,0 +1,128 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef XMRIG_DUALMINER_H
+#define XMRIG_DUALMINER_H
+
+
+#include <atomic>
+#include <thread>
+#include <uv.h>
+#include <vector>
+
+
+#if defined(__APPLE__)
+#   include <OpenCL/cl.h>
+#else
+#   include "3rdparty/CL/cl.h"
+#endif
+
+
+#include "common/crypto/Algorithm.h"
+#include "common/interfaces/IStrategyListener.h"
+#include "net/JobResult.h"
+#include "workers/Workers.h"
+
+
+class Hashrate;
+struct GpuContext;
+
+
+namespace xmrig {
+
+
+class Controller;
+class IStrategy;
+
+
+// experimental dual-algo mining of "dual-pool": its algorithm runs on the GPUs of the "threads" of that algorithm next
+// to the mining threads, each thread with its own OpenCL context, command queue and buffers, so the driver co-schedules
+// the batches of both algorithms on the device; jobs come from a pool strategy of their own, results are checked
+// against the target on the host only and hashrate is counted separately
+class DualMiner : public IStrategyListener
+{
+public:
+    DualMiner(Controller *controller);
+    ~DualMiner() override;
+
+    bool start();
+    void connect();
+    void print(bool detail) const;
+    void setEnabled(bool enabled);
+    void stop();
+    void tick();
+
+    inline const Algorithm &algorithm() const { return m_algorithm; }
+    inline Hashrate *hashrate() const         { return m_hashrate; }
+
+protected:
+    void onActive(IStrategy *strategy, Client *client) override;
+    void onJob(IStrategy *strategy, Client *client, const Job &job) override;
+    void onPause(IStrategy *strategy) override;
+    void onResultAccepted(IStrategy *strategy, Client *client, const SubmitResult &result, const char *error) override;
+
+private:
+    constexpr static const size_t kMaxErrors = 3;
+
+    struct Thread
+    {
+        inline Thread(size_t id, GpuContext *ctx) : ctx(ctx), id(id), hashCount(0), timestamp(0) {}
+
+        GpuContext *ctx;
+        size_t id;
+        std::atomic<uint64_t> hashCount;
+        std::atomic<uint64_t> timestamp;
+        std::thread thread;
+    };
+
+    void run(Thread *thread);
+
+    static void onResult(uv_async_t *handle);
+
+    Algorithm m_algorithm;
+    bool m_connected;
+    Controller *m_controller;
+    Hashrate *m_hashrate;
+    IStrategy *m_strategy;
+    std::atomic<bool> m_enabled;
+    std::atomic<bool> m_paused;
+    std::atomic<bool> m_stop;
+    std::atomic<uint64_t> m_sequence;
+    std::vector<cl_context> m_contexts;
+    std::vector<JobResult> m_results;
+    std::vector<Thread *> m_threads;
+    uint64_t m_accepted;
+    uint64_t m_rejected;
+    uint64_t m_ticks;
+    uv_async_t m_async;
+    uv_mutex_t m_mutex;
+    Workers::JobSnapshot m_job;
+};
+
+
+} /* namespace xmrig */
+
+
+#endif /* XMRIG_DUALMINER_H */
@@ -0,0 +1,171 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <chrono>
+#include <cmath>
+#include <inttypes.h>
+
+
+#include "common/log/Log.h"
+#include "workers/EffectiveRate.h"
+#include "workers/Hashrate.h"
+
+
+constexpr const size_t xmrig::EffectiveRate::kSlots;
+std::map<size_t, xmrig::EffectiveRate::Device> xmrig::EffectiveRate::m_devices;
+std::map<size_t, uint64_t> xmrig::EffectiveRate::m_counts;
+uint64_t xmrig::EffectiveRate::m_updated = 0;
+
+
+// shares in the window before a GPU can be flagged, fewer give bounds too wide to tell anything
+static const uint64_t kMinShares = 20;
+
+
+static inline uint64_t now()
+{
+    using namespace std::chrono;
+
+    return static_cast<uint64_t>(duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+
+xmrig::EffectiveRate::Estimate xmrig::EffectiveRate::estimate(size_t device)
+{
+    Estimate estimate;
+
+    const auto it = m_devices.find(device);
+    if (it == m_devices.end()) {
+        return estimate;
+    }
+
+    uint64_t hashes = 0;
+    double squares  = 0.0;
+
+    for (const Slot &slot : it->second.slots) {
+        if (!slot.mined) {
+            continue;
+        }
+
+        hashes                += slot.hashes;
+        squares               += slot.squares;
+        estimate.shares       += slot.shares;
+        estimate.rejected     += slot.rejected;
+        estimate.accepted     += slot.accepted;
+        estimate.rejectedDiff += slot.rejectedDiff;
+        estimate.window       += slot.duration;
+    }
+
+    if (estimate.window == 0) {
+        return estimate;
+    }
+
+    const double seconds = estimate.window / 1000.0;
+    const double margin  = 1.96 * sqrt(squares) / seconds;
+
+    estimate.reported  = hashes / seconds;
+    estimate.effective = estimate.accepted / seconds;
+    estimate.lower     = std::max(estimate.effective - margin, 0.0);
+    estimate.upper     = estimate.effective + margin;
+    estimate.low       = estimate.shares >= kMinShares && estimate.reported > estimate.upper;
+
+    return estimate;
+}
+
+
+std::vector<size_t> xmrig::EffectiveRate::devices()
+{
+    std::vector<size_t> devices;
+    devices.reserve(m_devices.size());
+
+    for (const auto &kv : m_devices) {
+        devices.push_back(kv.first);
+    }
+
+    return devices;
+}
+
+
+// count is the running hash count of the thread, a new worker after an algo switch starts again from 0
+void xmrig::EffectiveRate::addHashes(size_t threadId, size_t device, uint64_t count)
+{
+    auto it = m_counts.find(threadId);
+    if (it == m_counts.end()) {
+        m_counts[threadId] = count;
+        m_devices[device];
+        return;
+    }
+
+    if (count > it->second) {
+        m_devices[device].current.hashes += count - it->second;
+    }
+
+    it->second = count;
+}
+
+
+void xmrig::EffectiveRate::addShare(size_t device, uint32_t diff, bool accepted)
+{
+    Slot &slot = m_devices[device].current;
+
+    if (accepted) {
+        slot.shares++;
+        slot.accepted += diff;
+        slot.squares  += static_cast<double>(diff) * diff;
+    }
+    else {
+        slot.rejected++;
+        slot.rejectedDiff += diff;
+    }
+}
+
+
+void xmrig::EffectiveRate::update(bool mined, bool colors)
+{
+    const uint64_t time     = now();
+    const uint64_t duration = m_updated ? time - m_updated : 0;
+    m_updated = time;
+
+    for (auto &kv : m_devices) {
+        Device &device = kv.second;
+
+        device.current.duration = duration;
+        device.current.mined    = mined && duration > 0;
+        device.slots[device.top] = device.current;
+        device.top     = (device.top + 1) % kSlots;
+        device.current = Slot();
+
+        const Estimate e = estimate(kv.first);
+        if (e.low && !device.alerted) {
+            char num[3][8] = {};
+
+            LOG_WARN(colors ? "\x1B[1;33mGPU #%zu effective hashrate %s H/s is below the reported %s H/s\x1B[0m (95%% bound %s H/s, %" PRIu64 " shares, %" PRIu64 " rejected), check it for compute errors and stale shares"
+                            : "GPU #%zu effective hashrate %s H/s is below the reported %s H/s (95%% bound %s H/s, %" PRIu64 " shares, %" PRIu64 " rejected), check it for compute errors and stale shares",
+                     kv.first, Hashrate::format(e.effective, num[0], sizeof num[0]), Hashrate::format(e.reported, num[1], sizeof num[1]),
+                     Hashrate::format(e.upper, num[2], sizeof num[2]), e.shares, e.rejected);
+        }
+
+        device.alerted = e.low;
+    }
+}
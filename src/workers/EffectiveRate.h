@@ -0,0 +1,104 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_EFFECTIVERATE_H
+#define XMRIG_EFFECTIVERATE_H
+
+
+#include <map>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+
+namespace xmrig {
+
+
+// effective hashrate of each GPU from the difficulty the pools accepted for its shares, next to the hashrate its
+// threads report from their work counts. Workers closes a slot of the hashes and shares every 10 s, slots while no
+// pool job was mined are left out of both. Over the last hour the accepted difficulty is a compound Poisson sum, so
+// its standard deviation is the square root of the sum of the squared share difficulties, and a GPU whose reported
+// hashrate is above the 95% upper bound of its effective one is flagged. Used from the uv loop only.
+class EffectiveRate
+{
+public:
+    struct Estimate
+    {
+        inline Estimate() : shares(0), rejected(0), accepted(0), rejectedDiff(0), window(0), effective(0.0), lower(0.0), upper(0.0), reported(0.0), low(false) {}
+
+        uint64_t shares;       // accepted shares in the window
+        uint64_t rejected;     // rejected shares in the window
+        uint64_t accepted;     // accepted difficulty in the window
+        uint64_t rejectedDiff; // rejected difficulty in the window
+        uint64_t window;       // mined time in the window in ms
+        double effective;      // H/s
+        double lower;          // 95% bounds of effective
+        double upper;
+        double reported;       // H/s from the work counts of the threads
+        bool low;              // reported is significantly above effective
+    };
+
+    static Estimate estimate(size_t device);
+    static std::vector<size_t> devices();
+    static void addHashes(size_t threadId, size_t device, uint64_t count);
+    static void addShare(size_t device, uint32_t diff, bool accepted);
+    static void update(bool mined, bool colors);
+
+private:
+    static constexpr const size_t kSlots = 360;
+
+    struct Slot
+    {
+        inline Slot() : hashes(0), accepted(0), rejectedDiff(0), shares(0), rejected(0), duration(0), squares(0.0), mined(false) {}
+
+        uint64_t hashes;
+        uint64_t accepted;
+        uint64_t rejectedDiff;
+        uint64_t shares;
+        uint64_t rejected;
+        uint64_t duration; // ms
+        double squares;    // sum of the squared accepted difficulties
+        bool mined;
+    };
+
+    struct Device
+    {
+        inline Device() : top(0), alerted(false) {}
+
+        Slot current;
+        Slot slots[kSlots];
+        size_t top;
+        bool alerted;
+    };
+
+    static std::map<size_t, Device> m_devices;
+    static std::map<size_t, uint64_t> m_counts;
+    static uint64_t m_updated;
+};
+
+
+} /* namespace xmrig */
+
+
+#endif /* XMRIG_EFFECTIVERATE_H */
@@ -28,7 +28,12 @@
 
 Handle::Handle(size_t threadId, xmrig::IThread *config, GpuContext *ctx, uint32_t offset, size_t totalWays) :
     m_ctx(ctx),
+    m_previous(nullptr),
     m_worker(nullptr),
+    m_priority(-1),
+    m_affinity(-1),
+    m_pending(false),
+    m_stop(false),
     m_threadId(threadId),
     m_totalWays(totalWays),
     m_offset(offset),
@@ -36,7 +41,7 @@ Handle::Handle(size_t threadId, xmrig::IThread *config, GpuContext *ctx, uint32_
 {
 }
 
-Handle::~Handle() { if (m_worker) delete m_worker; }
+Handle::~Handle() { delete m_previous; delete m_worker; }
 
 void Handle::join()
 {
@@ -44,6 +49,20 @@ void Handle::join()
 }
 
 
+// the stopped worker stays readable by the hashrate timer until the next reset, the new one continues its job and counters
+void Handle::reset(xmrig::IThread *config, GpuContext *ctx)
+{
+    if (m_worker && m_stop) {
+        delete m_previous;
+        m_previous = m_worker;
+    }
+
+    m_config = config;
+    m_ctx    = ctx;
+    m_stop   = false;
+}
+
+
 void Handle::start(void (*callback) (void *))
 {
     uv_thread_create(&m_thread, callback, this);
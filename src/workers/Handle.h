@@ -26,6 +26,7 @@
 
 
 #include <assert.h>
+#include <atomic>
 #include <stdint.h>
 #include <uv.h>
 
@@ -45,17 +46,33 @@ public:
     void join();
     void start(void (*callback) (void *));
 
+    inline bool isPending() const          { return m_pending.load(std::memory_order_acquire); }
+    inline bool isStopping() const         { return m_stop.load(std::memory_order_relaxed); }
+    inline int64_t affinity() const        { return m_config->affinity() >= 0 ? m_config->affinity() : m_affinity; }
+    inline int priority() const            { return m_config->priority() >= 0 ? m_config->priority() : m_priority; }
     inline GpuContext *ctx() const         { return m_ctx; }
+    inline IWorker *previous() const       { return m_previous; }
     inline IWorker *worker() const         { return m_worker; }
     inline size_t threadId() const         { return m_threadId; }
     inline size_t totalWays() const        { return m_totalWays; }
     inline uint32_t offset() const         { return m_offset; }
+    inline void setAffinity(int64_t cpu)   { m_affinity = cpu; }
+    inline void setPending(bool pending)   { m_pending.store(pending, std::memory_order_release); }
+    inline void setPriority(int priority)  { m_priority = priority; }
     inline void setWorker(IWorker *worker) { assert(worker != nullptr); m_worker = worker; }
     inline xmrig::IThread *config() const  { return m_config; }
+    inline void stop()                     { m_stop = true; }
+
+    void reset(xmrig::IThread *config, GpuContext *ctx);
 
 private:
     GpuContext *m_ctx;
+    IWorker *m_previous;
     IWorker *m_worker;
+    int m_priority;           // --gpu-priority, "priority" of the thread config takes precedence
+    int64_t m_affinity;       // CPU chosen by --auto-affinity, "affine_to_cpu" of the thread config takes precedence
+    std::atomic<bool> m_pending; // the thread initializes its GPU context before the worker is created
+    std::atomic<bool> m_stop;
     size_t m_threadId;
     size_t m_totalWays;
     uint32_t m_offset;
@@ -22,8 +22,8 @@
  */
 
 
+#include <algorithm>
 #include <assert.h>
-#include <chrono>
 #include <math.h>
 #include <memory.h>
 #include <stdio.h>
@@ -35,6 +35,16 @@
 #include "workers/Hashrate.h"
 
 
+constexpr size_t Hashrate::kCpuDevice;
+constexpr size_t Hashrate::kStabilitySamples;
+
+// samples before the variation is reported, about 30 s of the 8 s updates
+static const size_t kStabilityMin = 4;
+
+
+static const uint64_t kIntervalTimes[] = { Hashrate::ShortInterval, Hashrate::MediumInterval, Hashrate::LargeInterval };
+
+
 inline static const char *format(double h, char *buf, size_t size)
 {
     if (isnormal(h)) {
@@ -46,12 +56,14 @@ inline static const char *format(double h, char *buf, size_t size)
 }
 
 
-Hashrate::Hashrate(size_t threads, xmrig::Controller *controller) :
+Hashrate::Hashrate(const std::vector<size_t> &devices, xmrig::PerfAlgo algo, xmrig::Controller *controller, const char *name) :
+    m_name(name),
     m_highest(0.0),
     m_threads(0),
+    m_algo(xmrig::PA_INVALID),
     m_controller(controller)
 {
-    set_threads(threads);
+    set_threads(devices, algo);
 
     const int printTime = controller->config()->printTime();
 
@@ -63,29 +75,46 @@ Hashrate::Hashrate(size_t threads, xmrig::Controller *controller) :
     }
 }
 
-void Hashrate::set_threads(const size_t threads)
+void Hashrate::set_threads(const std::vector<size_t> &devices, xmrig::PerfAlgo algo)
 {
-    if (m_threads) {
-        for (size_t i = 0; i < m_threads; i++) {
-            delete [] m_counts[i];
-            delete [] m_timestamps[i];
+    // intervals without a value yet keep the previous ones, a short visit doesn't wipe the history
+    if (m_algo != xmrig::PA_INVALID && m_threads) {
+        const AlgoHistory last = current();
+        AlgoHistory &history   = m_history[m_algo];
+
+        for (size_t i = 0; i < kIntervals; ++i) {
+            if (isnormal(last.total.values[i])) {
+                history.total.values[i] = last.total.values[i];
+            }
+
+            for (const auto &device : last.devices) {
+                if (isnormal(device.second.values[i])) {
+                    history.devices[device.first].values[i] = device.second.values[i];
+                }
+            }
         }
-        delete [] m_counts;
-        delete [] m_timestamps;
-        delete [] m_top;
+
+        history.updated = last.updated;
     }
 
+    const size_t threads = devices.size();
     m_threads = threads;
+    m_devices = devices;
+    m_algo    = algo;
 
-    m_counts     = new uint64_t*[threads];
-    m_timestamps = new uint64_t*[threads];
-    m_top        = new uint32_t[threads];
-
-    for (size_t i = 0; i < threads; i++) {
-        m_counts[i]     = new uint64_t[kBucketSize]();
-        m_timestamps[i] = new uint64_t[kBucketSize]();
-        m_top[i]        = 0;
+    m_deviceThreads.clear();
+    for (size_t i = 0; i < threads; ++i) {
+        if (devices[i] != kCpuDevice) {
+            m_deviceThreads[devices[i]].push_back(i);
+        }
     }
+
+    // one contiguous ring of samples for all threads
+    m_samples.assign(threads * kBucketSize, Sample());
+    m_windows.reset(new Window[threads]());
+
+    m_stability.assign(threads, Stability());
+    m_deviceStability.clear();
 }
 
 double Hashrate::calc(size_t ms) const
@@ -104,67 +133,143 @@ double Hashrate::calc(size_t ms) const
 }
 
 
-double Hashrate::calc(size_t threadId, size_t ms) const
+double Hashrate::calcDevice(size_t device, size_t ms) const
 {
-    assert(threadId < m_threads);
-    if (threadId >= m_threads) {
-        return nan("");
+    const auto it = m_deviceThreads.find(device);
+    if (it == m_deviceThreads.end()) {
+        return 0.0;
     }
 
-    using namespace std::chrono;
-    const uint64_t now = time_point_cast<milliseconds>(high_resolution_clock::now()).time_since_epoch().count();
+    double result = 0.0;
+    double data;
+
+    for (size_t i : it->second) {
+        data = calc(i, ms);
+        if (isnormal(data)) {
+            result += data;
+        }
+    }
 
-    uint64_t earliestHashCount = 0;
-    uint64_t earliestStamp     = 0;
-    uint64_t lastestStamp      = 0;
-    uint64_t lastestHashCnt    = 0;
-    bool haveFullSet           = false;
+    return result;
+}
 
-    for (size_t i = 1; i < kBucketSize; i++) {
-        const size_t idx = (m_top[threadId] - i) & kBucketMask;
 
-        if (m_timestamps[threadId][idx] == 0) {
-            break;
-        }
+double Hashrate::stability(size_t threadId) const
+{
+    return threadId < m_stability.size() ? m_stability[threadId].cv() : nan("");
+}
 
-        if (lastestStamp == 0) {
-            lastestStamp = m_timestamps[threadId][idx];
-            lastestHashCnt = m_counts[threadId][idx];
-        }
 
-        if (now - m_timestamps[threadId][idx] > ms) {
-            haveFullSet = true;
-            break;
-        }
+double Hashrate::stabilityDevice(size_t device) const
+{
+    const auto it = m_deviceStability.find(device);
+
+    return it != m_deviceStability.end() ? it->second.cv() : nan("");
+}
+
+
+Hashrate::AlgoHistory Hashrate::history(xmrig::PerfAlgo algo) const
+{
+    if (algo == m_algo) {
+        return current();
+    }
 
-        earliestStamp = m_timestamps[threadId][idx];
-        earliestHashCount = m_counts[threadId][idx];
+    const auto it = m_history.find(algo);
+
+    return it != m_history.end() ? it->second : AlgoHistory();
+}
+
+
+std::vector<size_t> Hashrate::devices() const
+{
+    std::vector<size_t> devices;
+    devices.reserve(m_deviceThreads.size());
+
+    for (const auto &device : m_deviceThreads) {
+        devices.push_back(device.first);
     }
 
-    if (!haveFullSet || earliestStamp == 0 || lastestStamp == 0) {
+    return devices;
+}
+
+
+double Hashrate::calc(size_t threadId, size_t ms) const
+{
+    assert(threadId < m_threads);
+    const int index = interval(ms);
+    if (threadId >= m_threads || index < 0) {
         return nan("");
     }
 
-    if (lastestStamp - earliestStamp == 0) {
+    const Window &window = m_windows[threadId];
+    uint64_t latestCount, latestStamp, earliestCount, earliestStamp;
+    uint32_t sequence;
+
+    do {
+        sequence      = window.sequence.load(std::memory_order_acquire);
+        latestCount   = window.latestCount.load(std::memory_order_relaxed);
+        latestStamp   = window.latestStamp.load(std::memory_order_relaxed);
+        earliestCount = window.earliestCount[index].load(std::memory_order_relaxed);
+        earliestStamp = window.earliestStamp[index].load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((sequence & 1) || sequence != window.sequence.load(std::memory_order_relaxed));
+
+    if (earliestStamp == 0 || latestStamp == 0 || latestStamp == earliestStamp) {
         return nan("");
     }
 
     double hashes, time;
-    hashes = (double) lastestHashCnt - earliestHashCount;
-    time   = (double) lastestStamp - earliestStamp;
+    hashes = (double) latestCount - earliestCount;
+    time   = (double) latestStamp - earliestStamp;
     time  /= 1000.0;
 
     return hashes / time;
 }
 
 
+// the earliest sample of every interval only moves forward, so keeping the windows up to date
+// costs O(1) amortized per sample
 void Hashrate::add(size_t threadId, uint64_t count, uint64_t timestamp)
 {
-    const size_t top = m_top[threadId];
-    m_counts[threadId][top]     = count;
-    m_timestamps[threadId][top] = timestamp;
+    // the worker has not finished a batch yet
+    if (timestamp == 0) {
+        return;
+    }
+
+    Window &window = m_windows[threadId];
+    Sample *ring   = samples(threadId);
+
+    const uint32_t latest = window.top;
+    ring[latest].count     = count;
+    ring[latest].timestamp = timestamp;
+    window.top = (latest + 1) & kBucketMask;
+
+    const uint32_t sequence = window.sequence.load(std::memory_order_relaxed);
+    window.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    window.latestCount.store(count, std::memory_order_relaxed);
+    window.latestStamp.store(timestamp, std::memory_order_relaxed);
+
+    for (size_t i = 0; i < kIntervals; ++i) {
+        uint32_t &tail = window.tail[i];
 
-    m_top[threadId] = (top + 1) & kBucketMask;
+        // the ring wrapped around to the tail, it can only happen if samples come faster than expected
+        if (tail == latest && window.full[i]) {
+            tail = (tail + 1) & kBucketMask;
+        }
+
+        while (tail != latest && ring[tail].timestamp + kIntervalTimes[i] < timestamp) {
+            tail = (tail + 1) & kBucketMask;
+            window.full[i] = true;
+        }
+
+        window.earliestCount[i].store(window.full[i] ? ring[tail].count : 0, std::memory_order_relaxed);
+        window.earliestStamp[i].store(window.full[i] ? ring[tail].timestamp : 0, std::memory_order_relaxed);
+    }
+
+    window.sequence.store(sequence + 2, std::memory_order_release);
 }
 
 
@@ -175,8 +280,9 @@ void Hashrate::print() const
     char num3[8] = { 0 };
     char num4[8] = { 0 };
 
-    LOG_INFO(m_controller->config()->isColors() ? WHITE_BOLD("speed") " 10s/60s/15m " CYAN_BOLD("%s") CYAN(" %s %s ") CYAN_BOLD("H/s") " max " CYAN_BOLD("%s H/s")
-                                                : "speed 10s/60s/15m %s %s %s H/s max %s H/s",
+    LOG_INFO(m_controller->config()->isColors() ? WHITE_BOLD("%s") " 10s/60s/15m " CYAN_BOLD("%s") CYAN(" %s %s ") CYAN_BOLD("H/s") " max " CYAN_BOLD("%s H/s")
+                                                : "%s 10s/60s/15m %s %s %s H/s max %s H/s",
+             m_name,
              format(calc(ShortInterval),  num1, sizeof(num1)),
              format(calc(MediumInterval), num2, sizeof(num2)),
              format(calc(LargeInterval),  num3, sizeof(num3)),
@@ -200,6 +306,101 @@ void Hashrate::updateHighest()
 }
 
 
+// a stalled thread has a 10s hashrate of 0 and is sampled, only threads without a full window yet are skipped
+void Hashrate::updateStability()
+{
+    for (size_t i = 0; i < m_stability.size(); ++i) {
+        const double rate = calc(i, ShortInterval);
+        if (!isnan(rate)) {
+            m_stability[i].add(rate);
+        }
+    }
+
+    for (const auto &device : m_deviceThreads) {
+        double rate = 0.0;
+        bool valid  = false;
+
+        for (size_t i : device.second) {
+            const double data = calc(i, ShortInterval);
+            if (!isnan(data)) {
+                rate += data;
+                valid = true;
+            }
+        }
+
+        if (valid) {
+            m_deviceStability[device.first].add(rate);
+        }
+    }
+}
+
+
+Hashrate::AlgoHistory Hashrate::current() const
+{
+    AlgoHistory history;
+
+    for (size_t i = 0; i < kIntervals; ++i) {
+        history.total.values[i] = calc(kIntervalTimes[i]);
+
+        for (const auto &device : m_deviceThreads) {
+            history.devices[device.first].values[i] = calcDevice(device.first, kIntervalTimes[i]);
+        }
+    }
+
+    for (size_t i = 0; i < m_threads; ++i) {
+        const uint64_t stamp = m_windows[i].latestStamp.load(std::memory_order_relaxed);
+        history.updated = stamp > history.updated ? stamp : history.updated;
+    }
+
+    return history;
+}
+
+
+int Hashrate::interval(size_t ms)
+{
+    for (size_t i = 0; i < kIntervals; ++i) {
+        if (kIntervalTimes[i] == ms) {
+            return static_cast<int>(i);
+        }
+    }
+
+    return -1;
+}
+
+
+double Hashrate::Stability::cv() const
+{
+    const size_t size = std::min(count, kStabilitySamples);
+    if (size < kStabilityMin) {
+        return nan("");
+    }
+
+    double mean = 0.0;
+    for (size_t i = 0; i < size; ++i) {
+        mean += samples[i];
+    }
+
+    mean /= size;
+    if (mean <= 0.0) {
+        return nan("");
+    }
+
+    double variance = 0.0;
+    for (size_t i = 0; i < size; ++i) {
+        variance += (samples[i] - mean) * (samples[i] - mean);
+    }
+
+    return sqrt(variance / size) / mean;
+}
+
+
+void Hashrate::Stability::add(double rate)
+{
+    samples[count % kStabilitySamples] = rate;
+    count++;
+}
+
+
 const char *Hashrate::format(double h, char *buf, size_t size)
 {
     return ::format(h, buf, size);
@@ -25,8 +25,16 @@
 #define __HASHRATE_H__
 
 
+#include <atomic>
+#include <limits>
+#include <map>
+#include <memory>
 #include <stdint.h>
 #include <uv.h>
+#include <vector>
+
+
+#include "common/xmrig.h"
 
 
 namespace xmrig {
@@ -43,17 +51,52 @@ public:
         LargeInterval  = 900000
     };
 
-    Hashrate(size_t threads, xmrig::Controller *controller);
-    void set_threads(size_t threads);
+    // 10s/60s/15m hashrate
+    struct Rates
+    {
+        inline Rates() : values() {}
+
+        double values[3];
+    };
+
+    // hashrate of an algo in total and per GPU index
+    struct AlgoHistory
+    {
+        inline AlgoHistory() : updated(0) {}
+
+        Rates total;
+        std::map<size_t, Rates> devices;
+        uint64_t updated;
+    };
+
+    // device of CPU threads, counted in the total only
+    constexpr static size_t kCpuDevice = std::numeric_limits<size_t>::max();
+
+    // devices[i] is the GPU index of host thread i, name starts the periodic report line
+    Hashrate(const std::vector<size_t> &devices, xmrig::PerfAlgo algo, xmrig::Controller *controller, const char *name = "speed");
+    // the hashrate of the previous algo is kept in its history
+    void set_threads(const std::vector<size_t> &devices, xmrig::PerfAlgo algo);
+    // ms must be one of Intervals, every query is O(1)
     double calc(size_t ms) const;
     double calc(size_t threadId, size_t ms) const;
+    double calcDevice(size_t device, size_t ms) const;
+    // coefficient of variation of the 10s hashrate over the last samples of updateStability, NaN until there are enough
+    double stability(size_t threadId) const;
+    double stabilityDevice(size_t device) const;
+    // live values for the current algo, values as of the last switch for other algos
+    AlgoHistory history(xmrig::PerfAlgo algo) const;
+    std::vector<size_t> devices() const;
     void add(size_t threadId, uint64_t count, uint64_t timestamp);
     void print() const;
     void stop();
     void updateHighest();
+    void updateStability();
 
-    inline double highest() const { return m_highest; }
-    inline size_t threads() const { return m_threads; }
+    inline double highest() const              { return m_highest; }
+    inline size_t device(size_t threadId) const { return threadId < m_threads ? m_devices[threadId] : kCpuDevice; }
+    inline size_t threads() const              { return m_threads; }
+    inline xmrig::PerfAlgo algo() const        { return m_algo; }
+    inline const std::map<xmrig::PerfAlgo, AlgoHistory> &algos() const { return m_history; }
 
     static const char *format(double h, char *buf, size_t size);
 
@@ -62,12 +105,60 @@ private:
 
     constexpr static size_t kBucketSize = 2 << 11;
     constexpr static size_t kBucketMask = kBucketSize - 1;
+    constexpr static size_t kIntervals  = 3;
+    constexpr static size_t kStabilitySamples = 16;
+
+    struct Sample
+    {
+        uint64_t count;
+        uint64_t timestamp;
+    };
+
+    // hashes and time of the latest sample and of the earliest sample inside each interval, earliest
+    // stamp is 0 until the history covers the interval, readers use sequence as a seqlock, the
+    // ring positions are used by add() only
+    struct Window
+    {
+        std::atomic<uint32_t> sequence;
+        std::atomic<uint64_t> latestCount;
+        std::atomic<uint64_t> latestStamp;
+        std::atomic<uint64_t> earliestCount[kIntervals];
+        std::atomic<uint64_t> earliestStamp[kIntervals];
+        uint32_t top;
+        uint32_t tail[kIntervals];
+        bool full[kIntervals];
+    };
+
+    // ring of the last 10s hashrates, used by the uv loop only
+    struct Stability
+    {
+        inline Stability() : samples(), count(0) {}
+
+        double cv() const;
+        void add(double rate);
+
+        double samples[kStabilitySamples];
+        size_t count;
+    };
+
+    static int interval(size_t ms);
+
+    inline Sample *samples(size_t threadId) { return m_samples.data() + threadId * kBucketSize; }
+
+    AlgoHistory current() const;
 
+    const char *m_name;
     double m_highest;
     size_t m_threads;
-    uint32_t* m_top;
-    uint64_t** m_counts;
-    uint64_t** m_timestamps;
+    std::map<xmrig::PerfAlgo, AlgoHistory> m_history;
+    // threads of each GPU, so per GPU queries don't scan all threads
+    std::map<size_t, std::vector<size_t> > m_deviceThreads;
+    std::map<size_t, Stability> m_deviceStability;
+    std::vector<size_t> m_devices;
+    xmrig::PerfAlgo m_algo;
+    std::unique_ptr<Window[]> m_windows;
+    std::vector<Sample> m_samples;
+    std::vector<Stability> m_stability;
     uv_timer_t m_timer;
     xmrig::Controller *m_controller;
 };
@@ -0,0 +1,105 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2016-2018 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_NONCESPACE_H
+#define XMRIG_NONCESPACE_H
+
+
+#include <atomic>
+#include <stdint.h>
+
+
+#include "common/net/Job.h"
+
+
+// Nonces of one job, threads take chunks of it on demand, so a faster device simply takes more of them
+// and no range is ever hashed twice. A nicehash job has only the 24 low bits of the nonce. A job with an
+// extranonce region has the nonces of each of its extranonce values one after the other, a chunk ends
+// with the nonces of its extranonce and its rest is skipped.
+class NonceSpace
+{
+public:
+    // the space stays below 2^56 nonces, far more than a rig hashes before the next block
+    constexpr static uint64_t kMaxRolls = 1ULL << 24;
+
+    inline NonceSpace(const xmrig::Job &job) :
+        m_id(job.id()),
+        m_rolls(rolls(job)),
+        m_size(job.isNicehash() ? 0x1000000ULL : 0x100000000ULL),
+        m_start(job.isNicehash() ? (*job.nonce() & 0xff000000U) : 0),
+        m_exhausted(false),
+        m_offset(0)
+    {}
+
+
+    inline bool isJob(const xmrig::Job &job) const { return m_id == job.id() && m_start == (job.isNicehash() ? (*job.nonce() & 0xff000000U) : 0); }
+    inline bool isExhausted() const                { return m_offset.load(std::memory_order_relaxed) >= m_size * m_rolls; }
+
+
+    // returns false once the whole space is taken, the last chunk of an extranonce may be shorter than requested,
+    // without extraNonce only the nonces of the job as sent by the pool are taken
+    inline bool take(uint32_t size, uint32_t *nonce, uint32_t *taken, uint64_t *extraNonce = nullptr)
+    {
+        const uint64_t offset = m_offset.fetch_add(size, std::memory_order_relaxed);
+        if (offset >= m_size * (extraNonce ? m_rolls : 1)) {
+            return false;
+        }
+
+        const uint64_t start = offset % m_size;
+
+        *nonce = m_start + static_cast<uint32_t>(start);
+        *taken = static_cast<uint32_t>(start + size > m_size ? m_size - start : size);
+
+        if (extraNonce) {
+            *extraNonce = offset / m_size;
+        }
+
+        return true;
+    }
+
+
+    // true for the first caller only, so the exhaustion is reported once per job
+    inline bool report() { return !m_exhausted.exchange(true, std::memory_order_relaxed); }
+
+
+private:
+    static inline uint64_t rolls(const xmrig::Job &job)
+    {
+        if (!job.hasExtraNonce()) {
+            return 1;
+        }
+
+        return job.extraNonceSize() >= 3 ? kMaxRolls : (1ULL << (job.extraNonceSize() * 8));
+    }
+
+
+    const xmrig::Id m_id;
+    const uint64_t m_rolls;
+    const uint64_t m_size;
+    const uint32_t m_start;
+    std::atomic<bool> m_exhausted;
+    std::atomic<uint64_t> m_offset;
+};
+
+
+#endif /* XMRIG_NONCESPACE_H */
@@ -25,10 +25,12 @@
 
 #include <inttypes.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 
 #include "amd/GpuContext.h"
+#include "amd/OclCache.h"
 #include "base/io/Json.h"
 #include "common/log/Log.h"
 #include "rapidjson/document.h"
@@ -38,10 +40,20 @@
 namespace xmrig {
 
 static const char *kAffineToCpu  = "affine_to_cpu";
+static const char *kBuildFlags   = "build_flags";
+static const char *kCanary       = "canary";
 static const char *kCompMode     = "comp_mode";
+static const char *kCoreClock    = "core_clock";
+static const char *kHashes       = "hashes_per_item";
 static const char *kIndex        = "index";
 static const char *kIntensity    = "intensity";
 static const char *kMemChunk     = "mem_chunk";
+static const char *kMemoryClock  = "memory_clock";
+static const char *kPersistent   = "persistent";
+static const char *kPipeline     = "pipeline";
+static const char *kPlatform     = "platform";
+static const char *kPowerCap     = "power_cap";
+static const char *kPriority     = "priority";
 static const char *kStridedIndex = "strided_index";
 static const char *kUnroll       = "unroll";
 static const char *kWorksize     = "worksize";
@@ -50,14 +62,26 @@ static const char *kWorksize     = "worksize";
 
 
 xmrig::OclThread::OclThread() :
-    m_affinity(-1)
+    m_canary(0),
+    m_coreClock(0),
+    m_memoryClock(0),
+    m_powerCap(0),
+    m_priority(-1),
+    m_affinity(-1),
+    m_deviceOffset(0)
 {
     m_ctx = new GpuContext();
 }
 
 
 xmrig::OclThread::OclThread(const rapidjson::Value &object) :
-    m_affinity(-1)
+    m_canary(0),
+    m_coreClock(0),
+    m_memoryClock(0),
+    m_powerCap(0),
+    m_priority(-1),
+    m_affinity(-1),
+    m_deviceOffset(0)
 {
     m_ctx = new GpuContext();
 
@@ -65,9 +89,17 @@ xmrig::OclThread::OclThread(const rapidjson::Value &object) :
     setIntensity(Json::getUint(object, kIntensity));
     setWorksize(Json::getUint(object, kWorksize));
     setAffinity(Json::getInt64(object, kAffineToCpu, -1));
+    setPriority(Json::getInt(object, kPriority, -1));
     setMemChunk(Json::getInt(object, kMemChunk, m_ctx->memChunk));
     setUnrollFactor(Json::getInt(object, kUnroll, m_ctx->unrollFactor));
     setCompMode(Json::getBool(object, kCompMode, true));
+    setPipeline(Json::getBool(object, kPipeline, false));
+    setPersistent(Json::getBool(object, kPersistent, false));
+    setHashesPerItem(Json::getInt(object, kHashes, m_ctx->hashesPerItem));
+    setBuildFlags(Json::getInt(object, kBuildFlags, 0));
+    setPowerCap(Json::getInt(object, kPowerCap, 0));
+    setCoreClock(Json::getInt(object, kCoreClock, 0));
+    setMemoryClock(Json::getInt(object, kMemoryClock, 0));
 
     const rapidjson::Value &stridedIndex = object[kStridedIndex];
     if (stridedIndex.IsBool()) {
@@ -76,11 +108,34 @@ xmrig::OclThread::OclThread(const rapidjson::Value &object) :
     else if (stridedIndex.IsUint()) {
         setStridedIndex(stridedIndex.GetInt());
     }
+
+    // vendor name or index of the OpenCL platform, index is the device index of that platform
+    const rapidjson::Value &platform = object[kPlatform];
+    if (platform.IsString()) {
+        m_platform = platform.GetString();
+    }
+    else if (platform.IsUint()) {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u", platform.GetUint());
+        m_platform = static_cast<const char *>(buf);
+    }
+
+    // group of the A/B comparison of thread settings, see Canary
+    const rapidjson::Value &canary = object[kCanary];
+    if (canary.IsString() && (strcmp(canary.GetString(), "a") == 0 || strcmp(canary.GetString(), "b") == 0)) {
+        m_canary = canary.GetString()[0];
+    }
 }
 
 
 xmrig::OclThread::OclThread(size_t index, size_t intensity, size_t worksize, int64_t affinity) :
-    m_affinity(affinity)
+    m_canary(0),
+    m_coreClock(0),
+    m_memoryClock(0),
+    m_powerCap(0),
+    m_priority(-1),
+    m_affinity(affinity),
+    m_deviceOffset(0)
 {
     m_ctx = new GpuContext();
 
@@ -96,6 +151,19 @@ xmrig::OclThread::~OclThread()
 }
 
 
+// another thread of the same GPU with the same settings, its CPU is left to the auto affinity
+xmrig::OclThread *xmrig::OclThread::clone() const
+{
+    rapidjson::Document doc;
+
+    OclThread *thread = new OclThread(toConfig(doc));
+    thread->setPlatform(m_deviceOffset);
+    thread->setAffinity(-1);
+
+    return thread;
+}
+
+
 size_t xmrig::OclThread::index() const
 {
     return m_ctx->deviceIdx;
@@ -108,6 +176,30 @@ bool xmrig::OclThread::isCompMode() const
 }
 
 
+bool xmrig::OclThread::isPersistent() const
+{
+    return m_ctx->persistent;
+}
+
+
+bool xmrig::OclThread::isPipeline() const
+{
+    return m_ctx->pipeline;
+}
+
+
+int xmrig::OclThread::buildFlags() const
+{
+    return m_ctx->buildFlags;
+}
+
+
+int xmrig::OclThread::hashesPerItem() const
+{
+    return m_ctx->hashesPerItem;
+}
+
+
 int xmrig::OclThread::memChunk() const
 {
     return m_ctx->memChunk;
@@ -138,12 +230,125 @@ size_t xmrig::OclThread::worksize() const
 }
 
 
+// changes only the tuning keys present in object, nothing is changed if any of them is unknown or out of range
+bool xmrig::OclThread::update(const rapidjson::Value &object, bool dryRun)
+{
+    if (!object.IsObject()) {
+        return false;
+    }
+
+    size_t intensity = this->intensity();
+    size_t worksize  = this->worksize();
+    int stridedIndex = this->stridedIndex();
+    int memChunk     = this->memChunk();
+    int unrollFactor = this->unrollFactor();
+    int hashes       = hashesPerItem();
+    int buildFlags   = this->buildFlags();
+    bool compMode    = isCompMode();
+    bool pipeline    = isPipeline();
+    bool persistent  = isPersistent();
+    int powerCap     = this->powerCap();
+    int coreClock    = this->coreClock();
+    int memoryClock  = this->memoryClock();
+
+    for (auto i = object.MemberBegin(); i != object.MemberEnd(); ++i) {
+        const char *key               = i->name.GetString();
+        const rapidjson::Value &value = i->value;
+
+        if (strcmp(key, kIntensity) == 0 && value.IsUint()) {
+            intensity = value.GetUint();
+        }
+        else if (strcmp(key, kWorksize) == 0 && value.IsUint()) {
+            worksize = value.GetUint();
+        }
+        else if (strcmp(key, kStridedIndex) == 0 && (value.IsUint() || value.IsBool())) {
+            stridedIndex = value.IsBool() ? (value.IsTrue() ? 1 : 0) : value.GetInt();
+        }
+        else if (strcmp(key, kMemChunk) == 0 && value.IsInt()) {
+            memChunk = value.GetInt();
+        }
+        else if (strcmp(key, kUnroll) == 0 && value.IsInt()) {
+            unrollFactor = value.GetInt();
+        }
+        else if (strcmp(key, kHashes) == 0 && value.IsInt()) {
+            hashes = value.GetInt();
+        }
+        else if (strcmp(key, kBuildFlags) == 0 && value.IsInt()) {
+            buildFlags = value.GetInt();
+        }
+        else if (strcmp(key, kCompMode) == 0 && value.IsBool()) {
+            compMode = value.GetBool();
+        }
+        else if (strcmp(key, kPipeline) == 0 && value.IsBool()) {
+            pipeline = value.GetBool();
+        }
+        else if (strcmp(key, kPersistent) == 0 && value.IsBool()) {
+            persistent = value.GetBool();
+        }
+        else if (strcmp(key, kPowerCap) == 0 && value.IsUint()) {
+            powerCap = value.GetInt();
+        }
+        else if (strcmp(key, kCoreClock) == 0 && value.IsUint()) {
+            coreClock = value.GetInt();
+        }
+        else if (strcmp(key, kMemoryClock) == 0 && value.IsUint()) {
+            memoryClock = value.GetInt();
+        }
+        else {
+            return false;
+        }
+    }
+
+    if (intensity == 0 || worksize == 0 || worksize > intensity || stridedIndex < 0 || stridedIndex > 3 ||
+        memChunk < 0 || memChunk > 18 || unrollFactor < 1 || unrollFactor > 128 || (hashes != 1 && hashes != 2 && hashes != 4) ||
+        buildFlags < 0 || buildFlags > OclCache::BUILD_FLAGS_MASK || powerCap > 1000 || coreClock > 5000 || memoryClock > 5000) {
+        return false;
+    }
+
+    if (dryRun) {
+        return true;
+    }
+
+    setIntensity(intensity);
+    setWorksize(worksize);
+    setStridedIndex(stridedIndex);
+    setMemChunk(memChunk);
+    setUnrollFactor(unrollFactor);
+    setHashesPerItem(hashes);
+    setBuildFlags(buildFlags);
+    setCompMode(compMode);
+    setPipeline(pipeline);
+    setPersistent(persistent);
+    setPowerCap(powerCap);
+    setCoreClock(coreClock);
+    setMemoryClock(memoryClock);
+
+    return true;
+}
+
+
+void xmrig::OclThread::setBuildFlags(int buildFlags)
+{
+    if (buildFlags >= 0 && buildFlags <= OclCache::BUILD_FLAGS_MASK) {
+        m_ctx->buildFlags = buildFlags;
+    }
+}
+
+
 void xmrig::OclThread::setCompMode(bool enable)
 {
     m_ctx->compMode = enable ? 1 : 0;
 }
 
 
+void xmrig::OclThread::setHashesPerItem(int hashesPerItem)
+{
+    if (hashesPerItem == 1 || hashesPerItem == 2 || hashesPerItem == 4) {
+        m_ctx->hashesPerItem = hashesPerItem;
+    }
+}
+
+
 void xmrig::OclThread::setIndex(size_t index)
 {
     m_ctx->deviceIdx = index;
@@ -164,9 +369,31 @@ void xmrig::OclThread::setMemChunk(int memChunk)
 }
 
 
+// experimental, batches of a replaced job are left by the cn1 and cn2 kernels on the device and more of them are in flight,
+// see GpuContext::depth
+void xmrig::OclThread::setPersistent(bool enable)
+{
+    m_ctx->persistent = enable;
+}
+
+
+void xmrig::OclThread::setPipeline(bool enable)
+{
+    m_ctx->pipeline = enable;
+}
+
+
+// moves the device index after the devices of the platforms before the platform of the thread, see OclGPU::deviceOffset
+void xmrig::OclThread::setPlatform(size_t offset)
+{
+    m_ctx->deviceIdx = m_ctx->deviceIdx - m_deviceOffset + offset;
+    m_deviceOffset   = offset;
+}
+
+
 void xmrig::OclThread::setStridedIndex(int stridedIndex)
 {
-    if (stridedIndex >= 0 && stridedIndex <= 2) {
+    if (stridedIndex >= 0 && stridedIndex <= 3) {
         m_ctx->stridedIndex = stridedIndex;
     }
 }
@@ -199,8 +426,9 @@ void xmrig::OclThread::setWorksize(size_t worksize)
 void xmrig::OclThread::print() const
 {
     LOG_DEBUG(GREEN_BOLD("OpenCL thread:") " index " WHITE_BOLD("%zu") ", intensity " WHITE_BOLD("%zu") ", worksize " WHITE_BOLD("%zu") ",", index(), intensity(), worksize());
-    LOG_DEBUG("               strided_index %d, mem_chunk %d, unroll_factor %d, comp_mode %d,", stridedIndex(), memChunk(), unrollFactor(), isCompMode());
+    LOG_DEBUG("               strided_index %d, mem_chunk %d, unroll_factor %d, hashes_per_item %d, comp_mode %d, pipeline %d, persistent %d,", stridedIndex(), memChunk(), unrollFactor(), hashesPerItem(), isCompMode(), isPipeline(), isPersistent());
     LOG_DEBUG("               affine_to_cpu: %" PRId64, affinity());
+    LOG_DEBUG("               priority:      %d", priority());
 }
 #endif
 
@@ -208,7 +436,10 @@ void xmrig::OclThread::print() const
 #ifndef XMRIG_NO_API
 rapidjson::Value xmrig::OclThread::toAPI(rapidjson::Document &doc) const
 {
-    return toConfig(doc);
+    rapidjson::Value obj = toConfig(doc);
+    obj[kIndex] = static_cast<uint64_t>(index());
+
+    return obj;
 }
 #endif
 
@@ -220,13 +451,24 @@ rapidjson::Value xmrig::OclThread::toConfig(rapidjson::Document &doc) const
     Value obj(kObjectType);
     auto &allocator = doc.GetAllocator();
 
-    obj.AddMember(StringRef(kIndex),        static_cast<uint64_t>(index()),     allocator);
+    obj.AddMember(StringRef(kIndex),        static_cast<uint64_t>(index() - m_deviceOffset), allocator);
     obj.AddMember(StringRef(kIntensity),    static_cast<uint64_t>(intensity()), allocator);
     obj.AddMember(StringRef(kWorksize),     static_cast<uint64_t>(worksize()),  allocator);
     obj.AddMember(StringRef(kStridedIndex), stridedIndex(),                     allocator);
     obj.AddMember(StringRef(kMemChunk),     memChunk(),                         allocator);
     obj.AddMember(StringRef(kUnroll),       unrollFactor(),                     allocator);
+    obj.AddMember(StringRef(kHashes),       hashesPerItem(),                    allocator);
     obj.AddMember(StringRef(kCompMode),     isCompMode(),                       allocator);
+    obj.AddMember(StringRef(kPipeline),     isPipeline(),                       allocator);
+
+    if (isPersistent()) {
+        obj.AddMember(StringRef(kPersistent), true, allocator);
+    }
+
+    // without own value the program gets the default compiler options
+    if (buildFlags() != 0) {
+        obj.AddMember(StringRef(kBuildFlags), buildFlags(), allocator);
+    }
 
     if (affinity() >= 0) {
         obj.AddMember(StringRef(kAffineToCpu), affinity(), allocator);
@@ -235,5 +477,39 @@ rapidjson::Value xmrig::OclThread::toConfig(rapidjson::Document &doc) const
         obj.AddMember(StringRef(kAffineToCpu), false, allocator);
     }
 
+    // without own value the thread takes --gpu-priority
+    if (priority() >= 0) {
+        obj.AddMember(StringRef(kPriority), priority(), allocator);
+    }
+
+    if (!m_platform.isNull()) {
+        char *end = nullptr;
+        const unsigned long platform = strtoul(m_platform.data(), &end, 10);
+
+        if (*end == '\0') {
+            obj.AddMember(StringRef(kPlatform), static_cast<uint64_t>(platform), allocator);
+        }
+        else {
+            obj.AddMember(StringRef(kPlatform), StringRef(m_platform.data()), allocator);
+        }
+    }
+
+    // clock profile of the GPU for this perf algo, applied by Workers when the algo starts
+    if (powerCap() > 0) {
+        obj.AddMember(StringRef(kPowerCap), powerCap(), allocator);
+    }
+
+    if (coreClock() > 0) {
+        obj.AddMember(StringRef(kCoreClock), coreClock(), allocator);
+    }
+
+    if (memoryClock() > 0) {
+        obj.AddMember(StringRef(kMemoryClock), memoryClock(), allocator);
+    }
+
+    if (m_canary) {
+        obj.AddMember(StringRef(kCanary), StringRef(m_canary == 'a' ? "a" : "b"), allocator);
+    }
+
     return obj;
 }
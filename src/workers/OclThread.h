@@ -26,6 +26,10 @@
 #define XMRIG_OCLTHREAD_H
 
 
+#include <utility>
+
+
+#include "base/tools/String.h"
 #include "common/xmrig.h"
 #include "interfaces/IThread.h"
 
@@ -44,11 +48,21 @@ public:
     OclThread(size_t index, size_t intensity, size_t worksize, int64_t affinity = -1);
     ~OclThread() override;
 
+    inline char canary() const                    { return m_canary; }
+    inline int coreClock() const                  { return m_coreClock; }
+    inline int memoryClock() const                { return m_memoryClock; }
+    inline int powerCap() const                   { return m_powerCap; }
+    inline const char *platform() const           { return m_platform.data(); }
     inline GpuContext *ctx() const                { return m_ctx; }
+    inline void swapContext(OclThread *other)     { std::swap(m_ctx, other->m_ctx); }
     inline void setAffinity(int64_t affinity)     { m_affinity = affinity; }
+    inline void setCoreClock(int clock)           { m_coreClock = clock > 0 && clock <= 5000 ? clock : 0; }
+    inline void setMemoryClock(int clock)         { m_memoryClock = clock > 0 && clock <= 5000 ? clock : 0; }
+    inline void setPowerCap(int watts)            { m_powerCap = watts > 0 && watts <= 1000 ? watts : 0; }
+    inline void setPriority(int priority)         { m_priority = priority >= 0 && priority <= 5 ? priority : -1; }
 
     inline Algo algorithm() const override        { return m_algorithm; }
-    inline int priority() const override          { return -1; }
+    inline int priority() const override          { return m_priority; }
     inline int64_t affinity() const override      { return m_affinity; }
     inline Multiway multiway() const override     { return SingleWay; }
     inline Type type() const override             { return OpenCL; }
@@ -56,16 +70,27 @@ public:
 
     size_t index() const override;
 
+    OclThread *clone() const;
     bool isCompMode() const;
+    bool isPersistent() const;
+    bool isPipeline() const;
+    int buildFlags() const;
+    int hashesPerItem() const;
     int memChunk() const;
     int stridedIndex() const;
     int unrollFactor() const;
     size_t intensity() const;
     size_t worksize() const;
+    bool update(const rapidjson::Value &object, bool dryRun = false);
+    void setBuildFlags(int buildFlags);
     void setCompMode(bool enable);
+    void setHashesPerItem(int hashesPerItem);
     void setIndex(size_t index);
     void setIntensity(size_t intensity);
     void setMemChunk(int memChunk);
+    void setPersistent(bool enable);
+    void setPipeline(bool enable);
+    void setPlatform(size_t offset);
     void setStridedIndex(int stridedIndex);
     void setThreadsCountByGPU(size_t threads);
     void setUnrollFactor(int unrollFactor);
@@ -83,8 +108,15 @@ protected:
     rapidjson::Value toConfig(rapidjson::Document &doc) const override;
 
 private:
+    char m_canary;
     GpuContext *m_ctx;
+    int m_coreClock;   // MHz, 0 is the driver default
+    int m_memoryClock; // MHz, 0 is the driver default
+    int m_powerCap;    // W, 0 is the driver default
+    int m_priority;
     int64_t m_affinity;
+    size_t m_deviceOffset;
+    String m_platform;
     xmrig::Algo m_algorithm;
 };
 
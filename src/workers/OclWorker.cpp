@@ -24,16 +24,20 @@
  */
 
 
+#include <algorithm>
+#include <chrono>
 #include <inttypes.h>
-#include <mutex>
 #include <thread>
 
 
+#include "amd/OclError.h"
 #include "amd/OclGPU.h"
+#include "amd/OclLib.h"
 #include "common/log/Log.h"
 #include "common/Platform.h"
 #include "common/utils/timestamp.h"
 #include "core/Config.h"
+#include "core/Trace.h"
 #include "crypto/CryptoNight.h"
 #include "workers/Handle.h"
 #include "workers/OclThread.h"
@@ -41,231 +45,477 @@
 #include "workers/Workers.h"
 
 
-#define MAX_DEVICE_COUNT 32
+// m_hashTime is the GPU time of one hash in 1/256 ns
+static const uint64_t kHashTimeScale = 256;
 
+// a nonce chunk lasts about this long in ns, so each device takes nonces at its own speed
+static const uint64_t kChunkTime = 1000000000;
 
-static struct SGPUThreadInterleaveData
-{
-    std::mutex m;
+// a batch holds the GPU for about one frame at most in ns while the desktop is in use, see --desktop-duty
+static const uint64_t kDesktopBatch = 15000000;
+
+// upper bounds of the batch time buckets in ms, the last bucket has no bound
+static const uint64_t kBatchBounds[OclWorker::kBatchBuckets - 1] = { 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000 };
+
+// a batch taking this many times the moving average time per hash is counted as a stall
+static const uint64_t kStallFactor = 4;
+
+// upper bounds of the job latency buckets in ms, the last bucket has no bound
+static const uint64_t kLatencyBounds[OclWorker::kLatencyBuckets - 1] = { 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000 };
 
-    double adjustThreshold   = 0.95;
-    double averageRunTime    = 0;
-    int64_t lastRunTimeStamp = 0;
-    int resumeCounter        = 0;
-} GPUThreadInterleaveData[MAX_DEVICE_COUNT];
+
+static inline uint64_t steadyTime()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
 
 
 OclWorker::OclWorker(Handle *handle) :
+    m_handle(handle),
     m_id(handle->threadId()),
-    m_threads(handle->totalWays()),
     m_ctx(handle->ctx()),
+    m_desktop(false),
+    m_done(false),
+    m_failed(false),
+    m_duty(kFullDuty),
+    m_batchSum(0),
+    m_batchTime(0),
+    m_firstBatch(0),
     m_hashCount(0),
+    m_lostResults(0),
+    m_stalls(0),
+    m_staleHashes(0),
+    m_startedJob(0),
     m_timestamp(0),
+    m_hostCpu(0),
+    m_chunk(0),
     m_count(0),
+    m_hashTime(0),
     m_sequence(0),
-    m_blob()
+    m_blob(),
+    m_job(std::make_shared<const Workers::PublishedJob>())
 {
-    const int64_t affinity = handle->config()->affinity();
+    for (size_t i = 0; i < GpuContext::ProfileMax; ++i) {
+        m_kernelTime[i] = 0;
+    }
+
+    for (size_t i = 0; i < kBatchBuckets; ++i) {
+        m_batches[i] = 0;
+    }
+
+    for (size_t i = 0; i < kLatencyBuckets; ++i) {
+        m_latency[i] = 0;
+    }
+
+    // the thread was restarted by config reload, counters go on and the job is continued from its nonce
+    const OclWorker *previous = static_cast<const OclWorker *>(handle->previous());
+    if (previous) {
+        m_hashCount   = previous->hashCount();
+        m_lostResults = previous->lostResults();
+        m_staleHashes = previous->staleHashes();
+        m_stalls      = previous->stalls();
+        m_batchSum    = previous->batchSum();
+        m_paused      = previous->m_paused;
+
+        for (size_t i = 0; i < kBatchBuckets; ++i) {
+            m_batches[i] = previous->batchCount(i);
+        }
+
+        if (previous->m_job->poolId() >= 0) {
+            PausedJob &paused = m_paused[previous->m_job->poolId()];
+            paused.job   = previous->m_job;
+            paused.nonce = previous->m_ctx->Nonce;
+            paused.chunk = previous->m_chunk;
+        }
+    }
+
+    const int64_t affinity = handle->affinity();
 
     if (affinity >= 0) {
         Platform::setThreadAffinity(static_cast<uint64_t>(affinity));
     }
+
+    // a descheduled host thread leaves its GPU idle between batches
+    Platform::setThreadPriority(handle->priority());
 }
 
 
 void OclWorker::start()
 {
-    SGPUThreadInterleaveData& interleaveData = GPUThreadInterleaveData[m_ctx->deviceIdx % MAX_DEVICE_COUNT];
-    cl_uint results[0x100];
+    cl_uint results[OCL_RESULT_SIZE];
+
+    if (xmrig::Trace::isEnabled()) {
+        char name[32];
+        snprintf(name, sizeof(name), "GPU thread #%zu", m_id);
+        xmrig::Trace::setThreadName(name);
+    }
+
+    if (OclLib::isTrace()) {
+        char name[32];
+        snprintf(name, sizeof(name), "GPU thread #%zu", m_id);
+        OclLib::setThreadName(name);
+    }
+
+    size_t intensity = 0;
+    size_t errors    = 0;
 
     while (Workers::sequence() > 0) {
-        while (!Workers::isOutdated(m_sequence)) {
-            memset(results, 0, sizeof(cl_uint) * (0x100));
+        while (!Workers::isOutdated(m_sequence) && !m_handle->isStopping()) {
+            const auto batchStart   = std::chrono::steady_clock::now();
+            const uint64_t cpuStart = Platform::threadCpuTime();
+            memset(results, 0, sizeof(cl_uint) * OCL_RESULT_HASHES);
 
-            const int64_t delay = interleaveAdjustDelay();
-            if (delay > 0) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+            intensity = batchIntensity();
 
-#               ifdef APP_INTERLEAVE_DEBUG
-                LOG_WARN("Thread #%zu was paused for %" PRId64 " ms to adjust interleaving", m_id, delay);
-#               endif
+            if (!nextNonce(intensity)) {
+                intensity = 0;
+                waitJob();
+                continue;
             }
 
-            const int64_t t = xmrig::steadyTimestamp();
-
-            XMRRunJob(m_ctx, results, m_job.algorithm().variant());
+            // a lost device fails every call, the thread leaves and the watchdog of Workers restarts it
+            if (XMRRunJob(m_ctx, results, m_job->algorithm().variant(), intensity) != OCL_ERR_SUCCESS) {
+                if (++errors >= kMaxErrors) {
+                    m_failed = true;
+                    break;
+                }
 
-            for (size_t i = 0; i < results[0xFF]; i++) {
-                *m_job.nonce() = results[i];
-                Workers::submit(m_job);
+                continue;
             }
 
-            storeStats(t);
+            errors = 0;
+            submit(results);
+
+            const uint64_t batchTime = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - batchStart).count());
+            storeStats(batchTime, Platform::threadCpuTime() - cpuStart, intensity);
+
+            // end of the first batch of the job, published stamps the job, see --test-switch
+            if (m_startedJob.load(std::memory_order_relaxed) != m_job->published) {
+                m_firstBatch.store(steadyTime(), std::memory_order_relaxed);
+                m_startedJob.store(m_job->published, std::memory_order_release);
+            }
+            throttle(batchTime);
             std::this_thread::yield();
         }
 
-        if (Workers::isPaused()) {
-            {
-                std::lock_guard<std::mutex> g(interleaveData.m);
-                interleaveData.resumeCounter = 0;
-            }
+        if (m_failed) {
+            break;
+        }
 
-            do {
-                std::this_thread::sleep_for(std::chrono::milliseconds(50));
-            } while (Workers::isPaused());
+        if (intensity && !Workers::isPaused() && !m_handle->isStopping()) {
+            storeStale(intensity);
+        }
 
-            if (Workers::sequence() == 0) {
-                break;
-            }
+        // in pipelined mode the last batches of the job are still in flight
+        if (m_ctx->pipeline) {
+            XMRDrainJob(m_ctx, results);
+            submit(results);
+        }
+
+        if (m_handle->isStopping()) {
+            break;
+        }
 
-            const int64_t delay = resumeDelay();
-            if (delay > 0) {
-#               ifdef APP_INTERLEAVE_DEBUG
-                LOG_WARN("Thread #%zu will be paused for %" PRId64 " ms to before resuming", m_id, delay);
-#               endif
+        if (Workers::isPaused()) {
+            Workers::waitResume();
 
-                std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+            if (Workers::sequence() == 0) {
+                break;
             }
         }
 
         consumeJob();
     }
+
+    m_done.store(true, std::memory_order_release);
+}
+
+
+// duty cycle set by the thermal control of Workers in 1/1000, the GPU idles (1000 - duty) / duty of a batch time
+// after the batch, in short slices so a new job or a stop is not held up by the whole pause
+void OclWorker::throttle(uint64_t batchTime)
+{
+    const uint32_t duty = m_duty.load(std::memory_order_relaxed);
+    if (duty == 0 || duty >= kFullDuty) {
+        return;
+    }
+
+    const std::chrono::nanoseconds slice = std::chrono::milliseconds(5);
+    std::chrono::nanoseconds remaining(batchTime * (kFullDuty - duty) / duty);
+
+    while (remaining.count() > 0 && !Workers::isOutdated(m_sequence) && !m_handle->isStopping()) {
+        const std::chrono::nanoseconds step = std::min(remaining, slice);
+        std::this_thread::sleep_for(step);
+        remaining -= step;
+    }
 }
 
 
-bool OclWorker::resume(const xmrig::Job &job)
+// the job may come from a new login, its snapshot replaces the paused one so results use the current client id
+bool OclWorker::resume(const Workers::JobSnapshot &job)
 {
-    if (m_job.poolId() == -1 && job.poolId() >= 0 && job.id() == m_pausedJob.id()) {
-        m_job        = m_pausedJob;
-        m_ctx->Nonce = m_pausedNonce;
+    if (job->poolId() < 0 || job->poolId() == m_job->poolId()) {
+        return false;
+    }
 
-        return true;
+    auto it = m_paused.find(job->poolId());
+    if (it == m_paused.end()) {
+        return false;
     }
 
-    return false;
+    // a newer job of the pool makes the paused one stale, its snapshot is released with the entry
+    const bool same = it->second.job->id() == job->id();
+    if (same) {
+        m_job        = Workers::roll(job, it->second.job->extraNonce());
+        m_ctx->Nonce = it->second.nonce;
+        m_chunk      = it->second.chunk;
+    }
+
+    m_paused.erase(it);
+
+    return same;
 }
 
 
-int64_t OclWorker::interleaveAdjustDelay() const
+// with --batch-split a batch is launched in parts, the job is checked for changes after each one
+size_t OclWorker::batchIntensity() const
 {
-    SGPUThreadInterleaveData &data = GPUThreadInterleaveData[m_ctx->deviceIdx % MAX_DEVICE_COUNT];
+    const size_t workSize = m_ctx->workSize;
+    const size_t split    = Workers::batchSplit();
+    size_t intensity      = m_ctx->rawIntensity;
 
-    const int64_t t0 = xmrig::steadyTimestamp();
-    int64_t delay    = 0;
+    if (split > 1) {
+        intensity = intensity / split / workSize * workSize;
+    }
 
-    {
-        std::lock_guard<std::mutex> g(data.m);
+    // a job arrives during a batch of T ns with probability T / interval and wastes T / 2 on average,
+    // so expected stale work stays below the target while T <= 2 * target * interval
+    const uint64_t interval = Workers::jobInterval();
+    if (Workers::staleTarget() && interval && m_hashTime) {
+        const uint64_t maxTime = interval * Workers::staleTarget() * 2 / 100;
+        const size_t adaptive  = static_cast<size_t>(maxTime * kHashTimeScale / m_hashTime) / workSize * workSize;
 
-        const int64_t dt = t0 - data.lastRunTimeStamp;
-        data.lastRunTimeStamp = t0;
+        // smaller launches don't fill the GPU anymore
+        const size_t minimum = m_ctx->rawIntensity / 8 / workSize * workSize;
 
-        // The perfect interleaving is when N threads on the same GPU start with T/N interval between each other
-        // If a thread starts earlier than 0.75*T/N ms after the previous thread, delay it to restore perfect interleaving
-        if ((m_ctx->threads > 1) && (dt > 0) && (dt < data.adjustThreshold * (data.averageRunTime / m_ctx->threads))) {
-            delay = static_cast<int64_t>(data.averageRunTime / m_ctx->threads - dt);
-            data.adjustThreshold = 0.75;
-        }
+        intensity = std::min(intensity, std::max(adaptive, minimum));
     }
 
-    if (delay >= 400) {
-        delay = 200;
+    // the compositor waits for the whole batch, so short batches keep the desktop responsive
+    if (m_desktop.load(std::memory_order_relaxed) && m_hashTime) {
+        const size_t frame = static_cast<size_t>(kDesktopBatch * kHashTimeScale / m_hashTime) / workSize * workSize;
+
+        intensity = std::min(intensity, std::max(frame, workSize));
     }
 
-    return delay;
+    return intensity > 0 ? intensity : m_ctx->rawIntensity;
 }
 
 
-int64_t OclWorker::resumeDelay() const
+// chunks are whole batches of the raw intensity, the last batch of a chunk is shortened to its rest
+bool OclWorker::nextNonce(size_t &intensity)
 {
-    SGPUThreadInterleaveData &data = GPUThreadInterleaveData[m_ctx->deviceIdx % MAX_DEVICE_COUNT];
-
-    int64_t delay = 0;
+    if (m_chunk == 0) {
+        const uint64_t raw = m_ctx->rawIntensity;
+        uint64_t size      = m_hashTime ? kChunkTime * kHashTimeScale / m_hashTime / raw * raw : raw;
+        size               = std::min<uint64_t>(std::max(size, raw), 0x1000000);
+
+        uint32_t nonce      = 0;
+        uint64_t extraNonce = 0;
+        if (!m_job->nonces || !m_job->nonces->take(static_cast<uint32_t>(size), &nonce, &m_chunk, &extraNonce)) {
+            return false;
+        }
 
-    {
-        constexpr const double firstThreadSpeedupCoeff = 1.25;
+        if (extraNonce != m_job->extraNonce()) {
+            roll(extraNonce);
+        }
 
-        std::lock_guard<std::mutex> g(data.m);
-        delay = static_cast<int64_t>(data.resumeCounter * data.averageRunTime / m_ctx->threads / firstThreadSpeedupCoeff);
-        ++data.resumeCounter;
+        m_ctx->Nonce = nonce;
     }
 
-    if (delay > 1000) {
-        delay = 1000;
+    intensity = std::min<size_t>(intensity, m_chunk);
+    m_chunk  -= static_cast<uint32_t>(intensity);
+
+    return true;
+}
+
+
+// all nonces of the job are taken, the thread idles until the pool sends a new job, at the latest with the next block
+void OclWorker::waitJob()
+{
+    if (m_job->nonces && m_job->nonces->report()) {
+        LOG_WARN("nonce space of job %s exhausted, waiting for a new job", m_job->id().data());
     }
 
-    return delay;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
 }
 
 
 void OclWorker::consumeJob()
 {
-    xmrig::Job job = Workers::job();
+    xmrig::Trace::Span span("consumeJob", static_cast<int64_t>(m_id));
+
+    Workers::JobSnapshot job = Workers::job();
     m_sequence = Workers::sequence();
-    if (m_job.id() == job.id() && m_job.clientId() == job.clientId()) {
+    if (m_job->id() == job->id() && m_job->clientId() == job->clientId()) {
         return;
     }
 
     save(job);
 
     if (resume(job)) {
+        storeLatency();
         setJob();
         return;
     }
 
-    m_job = std::move(job);
-    m_job.setThreadId(m_id);
+    m_job   = std::move(job);
+    m_chunk = 0;
+    storeLatency();
 
-    if (m_job.isNicehash()) {
-        m_ctx->Nonce = (*m_job.nonce() & 0xff000000U) + (0xffffffU / m_threads * m_id);
-    }
-    else {
-        m_ctx->Nonce = 0xffffffffU / m_threads * m_id;
+    setJob();
+}
+
+
+// the chunk is from the next extranonce of the job, the batches in flight still hash the blob before
+void OclWorker::roll(uint64_t extraNonce)
+{
+    if (m_ctx->pipeline) {
+        cl_uint results[OCL_RESULT_SIZE];
+        XMRDrainJob(m_ctx, results);
+        submit(results);
     }
 
+    m_job = Workers::roll(m_job, extraNonce);
     setJob();
 }
 
 
-void OclWorker::save(const xmrig::Job &job)
+// donate and weighted pool switches interrupt a job which is continued later, so no nonce is hashed twice
+void OclWorker::save(const Workers::JobSnapshot &job)
 {
-    if (job.poolId() == -1 && m_job.poolId() >= 0) {
-        m_pausedJob   = m_job;
-        m_pausedNonce = m_ctx->Nonce;
+    if (m_job->poolId() >= 0 && job->poolId() != m_job->poolId()) {
+        PausedJob &paused = m_paused[m_job->poolId()];
+        paused.job   = m_job;
+        paused.nonce = m_ctx->Nonce;
+        paused.chunk = m_chunk;
     }
 }
 
 
+// with --min-submit-diff the GPU target is the harder of the job and that difficulty, so low pool or benchmark
+// difficulties don't flood the result buffer and the CPU verification
 void OclWorker::setJob()
 {
-    memcpy(m_blob, m_job.blob(), sizeof(m_blob));
+    memcpy(m_blob, m_job->blob(), sizeof(m_blob));
+
+    uint64_t target = m_job->target();
+    if (Workers::minSubmitDiff() > 0) {
+        target = std::min<uint64_t>(target, 0xFFFFFFFFFFFFFFFFULL / Workers::minSubmitDiff());
+    }
+
+    XMRSetJob(m_ctx, m_blob, m_job->size(), target, m_job->algorithm().variant(), m_job->height());
+}
+
+
+void OclWorker::submit(const cl_uint *results)
+{
+    if (m_ctx->lostResults) {
+        LOG_WARN("GPU thread #%zu found %" PRIu64 " results more than the %zu slots of its output buffer, use --min-submit-diff", m_id, m_ctx->lostResults, OCL_RESULT_SLOTS);
+
+        m_lostResults.fetch_add(m_ctx->lostResults, std::memory_order_relaxed);
+        m_ctx->lostResults = 0;
+    }
+
+    for (size_t i = 0; i < results[OCL_RESULT_SLOTS]; i++) {
+        Workers::submit(m_job, m_id, results[i], reinterpret_cast<const uint8_t *>(results + OCL_RESULT_HASHES + i * 8));
+    }
+}
+
+
+uint64_t OclWorker::batchBound(size_t bucket)
+{
+    return kBatchBounds[bucket];
+}
+
+
+uint64_t OclWorker::latencyBound(size_t bucket)
+{
+    return kLatencyBounds[bucket];
+}
+
+
+// time from publication of the current job to this thread starting it
+void OclWorker::storeLatency()
+{
+    const uint64_t latency = (steadyTime() - Workers::job()->published) / 1000000;
+
+    size_t bucket = 0;
+    while (bucket < kLatencyBuckets - 1 && latency >= kLatencyBounds[bucket]) {
+        bucket++;
+    }
+
+    m_latency[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+
+// the job changed during the last batch, hashes done since its publication were wasted, in pipelined
+// mode that includes the batches still in flight
+void OclWorker::storeStale(size_t intensity)
+{
+    if (!m_hashTime) {
+        return;
+    }
 
-    XMRSetJob(m_ctx, m_blob, m_job.size(), m_job.target(), m_job.algorithm().variant(), m_job.height());
+    const uint64_t elapsed = steadyTime() - Workers::job()->published;
+    const uint64_t limit   = intensity * m_ctx->depth();
+    const uint64_t hashes  = elapsed * kHashTimeScale / m_hashTime;
+
+    m_staleHashes.fetch_add(hashes < limit ? hashes : limit, std::memory_order_relaxed);
 }
 
 
-void OclWorker::storeStats(int64_t t)
+// batchTime is the host time of the last batch in ns, kept as moving average like the kernel times,
+// cpuTime the CPU time the thread used for it, every batch also goes into the batch time histogram
+void OclWorker::storeStats(uint64_t batchTime, uint64_t cpuTime, size_t intensity)
 {
     if (Workers::isPaused()) {
         return;
     }
 
-    SGPUThreadInterleaveData &data = GPUThreadInterleaveData[m_ctx->deviceIdx % MAX_DEVICE_COUNT];
+    const uint64_t ms = batchTime / 1000000;
+    size_t bucket     = 0;
+    while (bucket < kBatchBuckets - 1 && ms >= kBatchBounds[bucket]) {
+        bucket++;
+    }
 
-    m_count += m_ctx->rawIntensity;
+    m_batches[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_batchSum.fetch_add(batchTime, std::memory_order_relaxed);
 
-    // averagingBias = 1.0 - only the last delta time is taken into account
-    // averagingBias = 0.5 - the last delta time has the same weight as all the previous ones combined
-    // averagingBias = 0.1 - the last delta time has 10% weight of all the previous ones combined
-    const double averagingBias = 0.1;
+    const uint64_t average = m_batchTime.load(std::memory_order_relaxed);
+    m_batchTime.store(average ? (average * 7 + batchTime) / 8 : batchTime, std::memory_order_relaxed);
 
-    {
-        int64_t t2 = xmrig::steadyTimestamp();
+    const uint32_t hostCpu = static_cast<uint32_t>(std::min<uint64_t>(cpuTime * 1000 / std::max<uint64_t>(batchTime, 1), 1000));
+    const uint32_t usage   = m_hostCpu.load(std::memory_order_relaxed);
+    m_hostCpu.store(usage ? (usage * 7 + hostCpu) / 8 : hostCpu, std::memory_order_relaxed);
 
-        std::lock_guard<std::mutex> g(data.m);
-        data.averageRunTime = data.averageRunTime * (1.0 - averagingBias) + (t2 - t) * averagingBias;
+    // per hash, so intensity changes of the duty cycle or a tune don't count
+    const uint64_t hashTime = batchTime * kHashTimeScale / intensity;
+    if (m_hashTime && hashTime > m_hashTime * kStallFactor) {
+        m_stalls.fetch_add(1, std::memory_order_relaxed);
     }
 
+    m_hashTime = m_hashTime ? (m_hashTime * 7 + hashTime) / 8 : hashTime;
+
+    m_count += intensity;
+
     const uint64_t timestamp = static_cast<uint64_t>(xmrig::currentMSecsSinceEpoch());
     m_hashCount.store(m_count, std::memory_order_relaxed);
     m_timestamp.store(timestamp, std::memory_order_relaxed);
+
+    if (m_ctx->profiling) {
+        for (size_t i = 0; i < GpuContext::ProfileMax; ++i) {
+            m_kernelTime[i].store(m_ctx->ProfileTimes[i], std::memory_order_relaxed);
+        }
+    }
 }
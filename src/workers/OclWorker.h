@@ -28,6 +28,7 @@
 
 
 #include <atomic>
+#include <map>
 
 
 #include "amd/GpuContext.h"
@@ -35,6 +36,7 @@
 #include "common/xmrig.h"
 #include "interfaces/IWorker.h"
 #include "net/JobResult.h"
+#include "workers/Workers.h"
 
 
 class Handle;
@@ -43,8 +45,33 @@ class Handle;
 class OclWorker : public IWorker
 {
 public:
+    static constexpr const size_t kBatchBuckets   = 12;
+    static constexpr const size_t kLatencyBuckets = 12;
+    static constexpr const uint32_t kFullDuty     = 1000;
+    static constexpr const size_t kMaxErrors      = 3;
+
     OclWorker(Handle *handle);
 
+    static uint64_t batchBound(size_t bucket);
+    static uint64_t latencyBound(size_t bucket);
+
+    inline uint64_t batchCount(size_t bucket) const   { return m_batches[bucket].load(std::memory_order_relaxed); }
+    inline uint64_t batchSum() const                  { return m_batchSum.load(std::memory_order_relaxed); }
+    inline uint64_t batchTime() const                 { return m_batchTime.load(std::memory_order_relaxed); }
+    inline uint64_t firstBatch(uint64_t published) const { return m_startedJob.load(std::memory_order_acquire) == published ? m_firstBatch.load(std::memory_order_relaxed) : 0; }
+    inline bool isDesktop() const                     { return m_desktop.load(std::memory_order_relaxed); }
+    inline bool isDone() const                        { return m_done.load(std::memory_order_acquire); }
+    inline bool isFailed() const                      { return m_failed.load(std::memory_order_relaxed); }
+    inline uint32_t duty() const                      { return m_duty.load(std::memory_order_relaxed); }
+    inline uint32_t hostCpu() const                   { return m_hostCpu.load(std::memory_order_relaxed); }
+    inline void setDesktop(bool desktop)              { m_desktop.store(desktop, std::memory_order_relaxed); }
+    inline void setDuty(uint32_t duty)                { m_duty.store(duty, std::memory_order_relaxed); }
+    inline uint64_t kernelTime(size_t kernel) const   { return m_kernelTime[kernel].load(std::memory_order_relaxed); }
+    inline uint64_t latencyCount(size_t bucket) const { return m_latency[bucket].load(std::memory_order_relaxed); }
+    inline uint64_t lostResults() const               { return m_lostResults.load(std::memory_order_relaxed); }
+    inline uint64_t stalls() const                    { return m_stalls.load(std::memory_order_relaxed); }
+    inline uint64_t staleHashes() const               { return m_staleHashes.load(std::memory_order_relaxed); }
+
 protected:
     inline uint64_t hashCount() const override { return m_hashCount.load(std::memory_order_relaxed); }
     inline uint64_t timestamp() const override { return m_timestamp.load(std::memory_order_relaxed); }
@@ -54,25 +81,55 @@ protected:
     void start() override;
 
 private:
-    bool resume(const xmrig::Job &job);
-    int64_t interleaveAdjustDelay() const;
-    int64_t resumeDelay() const;
+    // job of a pool which was interrupted by a job of another pool and the nonce to continue from
+    struct PausedJob
+    {
+        Workers::JobSnapshot job;
+        uint32_t nonce;
+        uint32_t chunk;
+    };
+
+    bool nextNonce(size_t &intensity);
+    bool resume(const Workers::JobSnapshot &job);
+    size_t batchIntensity() const;
     void consumeJob();
-    void save(const xmrig::Job &job);
+    void roll(uint64_t extraNonce);
+    void save(const Workers::JobSnapshot &job);
     void setJob();
-    void storeStats(int64_t t);
+    void submit(const cl_uint *results);
+    void storeLatency();
+    void storeStale(size_t intensity);
+    void storeStats(uint64_t batchTime, uint64_t cpuTime, size_t intensity);
+    void throttle(uint64_t batchTime);
+    void waitJob();
 
+    const Handle *m_handle;
     const size_t m_id;
-    const size_t m_threads;
     GpuContext *m_ctx;
+    std::atomic<bool> m_desktop;
+    std::atomic<bool> m_done;
+    std::atomic<bool> m_failed;
+    std::atomic<uint32_t> m_duty;
+    std::atomic<uint64_t> m_batches[kBatchBuckets];
+    std::atomic<uint64_t> m_batchSum;
+    std::atomic<uint64_t> m_batchTime;
+    std::atomic<uint64_t> m_firstBatch;
     std::atomic<uint64_t> m_hashCount;
+    std::atomic<uint64_t> m_kernelTime[GpuContext::ProfileMax];
+    std::atomic<uint64_t> m_latency[kLatencyBuckets];
+    std::atomic<uint64_t> m_lostResults;
+    std::atomic<uint64_t> m_stalls;
+    std::atomic<uint64_t> m_staleHashes;
+    std::atomic<uint64_t> m_startedJob;
     std::atomic<uint64_t> m_timestamp;
-    uint32_t m_pausedNonce;
+    std::atomic<uint32_t> m_hostCpu;
+    std::map<int, PausedJob> m_paused;
+    uint32_t m_chunk;
     uint64_t m_count;
+    uint64_t m_hashTime;
     uint64_t m_sequence;
     uint8_t m_blob[xmrig::Job::kMaxBlobSize];
-    xmrig::Job m_job;
-    xmrig::Job m_pausedJob;
+    Workers::JobSnapshot m_job;
 };
 
 
@@ -0,0 +1,110 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2016-2018 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef XMRIG_RESULTRING_H
+#define XMRIG_RESULTRING_H
+
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+
+
+// Bounded multi producer single consumer ring, each cell carries a sequence number which tells
+// producers when the cell is free and the consumer when it is filled, so no lock is ever taken.
+// Size must be a power of 2.
+template<typename T, size_t Size>
+class ResultRing
+{
+public:
+    inline ResultRing() : m_head(0), m_tail(0)
+    {
+        static_assert(Size >= 2 && (Size & (Size - 1)) == 0, "ResultRing size must be a power of 2");
+
+        for (size_t i = 0; i < Size; ++i) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+
+    // returns false if the ring is full
+    inline bool push(T &&value)
+    {
+        size_t pos = m_head.load(std::memory_order_relaxed);
+        Cell *cell;
+
+        for (;;) {
+            cell = &m_cells[pos & (Size - 1)];
+            const intptr_t diff = static_cast<intptr_t>(cell->sequence.load(std::memory_order_acquire)) - static_cast<intptr_t>(pos);
+
+            if (diff == 0) {
+                if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                pos = m_head.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+
+        return true;
+    }
+
+
+    // must be called from a single thread only
+    inline bool pop(T &value)
+    {
+        Cell &cell = m_cells[m_tail & (Size - 1)];
+        if (cell.sequence.load(std::memory_order_acquire) != m_tail + 1) {
+            return false;
+        }
+
+        value = std::move(cell.value);
+        cell.sequence.store(m_tail + Size, std::memory_order_release);
+        m_tail++;
+
+        return true;
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    alignas(64) std::atomic<size_t> m_head;
+    alignas(64) size_t m_tail;
+    Cell m_cells[Size];
+};
+
+
+#endif /* XMRIG_RESULTRING_H */
@@ -0,0 +1,306 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <chrono>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+
+#include "common/log/Log.h"
+#include "core/Config.h"
+#include "core/Controller.h"
+#include "net/JobResult.h"
+#include "net/Network.h"
+#include "net/StratumServer.h"
+#include "rapidjson/document.h"
+#include "rapidjson/prettywriter.h"
+#include "rapidjson/stringbuffer.h"
+#include "workers/Hashrate.h"
+#include "workers/SwitchTest.h"
+#include "workers/Workers.h"
+
+
+// time between two scripted changes in ms, a thread that didn't start the job by then counts as failed
+static const uint64_t kEventTime = 10000;
+
+// poll interval of the worker state in ms
+static const uint64_t kPollTime = 10;
+
+// the second pass switches to algos seen before, it measures the switch without program builds
+static const size_t kPasses = 2;
+
+// difficulty 4096, a rig submits a few shares per second
+static const char *kTarget = "ffff0f00";
+
+static const uint8_t kBlob[76] = {
+    0x99, 0x05, 0xA0, 0xDB, 0xD6, 0xBF, 0x05, 0xCF, 0x16, 0xE5, 0x03, 0xF3, 0xA6, 0x6F, 0x78, 0x00,
+    0x7C, 0xBF, 0x34, 0x14, 0x43, 0x32, 0xEC, 0xBF, 0xC2, 0x2E, 0xD9, 0x5C, 0x87, 0x00, 0x38, 0x3B,
+    0x30, 0x9A, 0xCE, 0x19, 0x23, 0xA0, 0x96, 0x4B, 0x00, 0x00, 0x00, 0x08, 0xBA, 0x93, 0x9A, 0x62,
+    0x72, 0x4C, 0x0D, 0x75, 0x81, 0xFC, 0xE5, 0x76, 0x1E, 0x9D, 0x8A, 0x0E, 0x6A, 0x1C, 0x3F, 0x92,
+    0x4F, 0xDD, 0x84, 0x93, 0xD1, 0x11, 0x56, 0x49, 0xC0, 0x5E, 0xB6, 0x01
+};
+
+
+static inline uint64_t steadyTime()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+
+xmrig::SwitchTest::SwitchTest() :
+    m_controller(nullptr),
+    m_current(0),
+    m_server(nullptr),
+    m_height(1),
+    m_rejected(0)
+{
+    m_timer.data = this;
+}
+
+
+// the first job waits for the login of the miner, every pool perf algo is switched to, then a new job of it follows
+bool xmrig::SwitchTest::start(Controller *controller)
+{
+    m_controller = controller;
+
+    for (size_t pass = 0; pass < kPasses; ++pass) {
+        for (int a = 0; a != PerfAlgo::PA_MAX; ++a) {
+            const PerfAlgo pa = static_cast<PerfAlgo>(a);
+            if (!controller->config()->isPoolPerfAlgo(pa)) {
+                continue;
+            }
+
+            m_events.push_back(Event(m_events.empty() ? CHANGE_START : CHANGE_ALGO, pa));
+            m_events.push_back(Event(CHANGE_JOB, pa));
+        }
+    }
+
+    if (m_events.empty()) {
+        LOG_ERR("No perf algos to test.");
+        return false;
+    }
+
+    m_server = new StratumServer("127.0.0.1", StratumServer::kTestPort, this);
+    send(m_events.front());
+
+    if (!m_server->start()) {
+        return false;
+    }
+
+    uv_timer_init(uv_default_loop(), &m_timer);
+    uv_timer_start(&m_timer, SwitchTest::onTimer, kPollTime, kPollTime);
+
+    return true;
+}
+
+
+void xmrig::SwitchTest::onJobResult(const JobResult &result)
+{
+    Event &event = m_events[m_current];
+
+    if (result.jobId == Id(event.id)) {
+        event.shares++;
+    }
+    else {
+        event.stale++;
+    }
+}
+
+
+// a thread idles or hashes an outdated job from the change until its first batch of the job started
+void xmrig::SwitchTest::finish(Event &event)
+{
+    const uint64_t rejected = m_server->rejected();
+    event.stale += rejected - m_rejected;
+    m_rejected   = rejected;
+
+    for (size_t i = 0; i < event.latency.size(); ++i) {
+        const uint64_t batch = Workers::batchTime(i);
+        const uint64_t idle  = event.latency[i] ? (event.latency[i] > batch ? event.latency[i] - batch : 0) : kEventTime * 1000000;
+
+        event.lost += event.rates[i] * static_cast<double>(idle) / 1e9;
+    }
+
+    size_t started = 0;
+    uint64_t max   = 0;
+    uint64_t sum   = 0;
+
+    for (const uint64_t latency : event.latency) {
+        if (latency) {
+            started++;
+            sum += latency;
+            max  = std::max(max, latency);
+        }
+    }
+
+    LOG_INFO("switch test %s %s: first batch after %.1f ms avg, %.1f ms max, %zu/%zu threads, %.0f hashes lost, %" PRIu64 " stale shares",
+             event.change == CHANGE_START ? "start" : (event.change == CHANGE_ALGO ? "algo" : "job"),
+             Algorithm::perfAlgoName(event.pa),
+             started ? static_cast<double>(sum) / started / 1e6 : 0.0,
+             static_cast<double>(max) / 1e6,
+             started,
+             event.latency.size(),
+             event.lost,
+             event.stale);
+}
+
+
+void xmrig::SwitchTest::print() const
+{
+    using namespace rapidjson;
+
+    Document doc(kArrayType);
+    auto &allocator = doc.GetAllocator();
+
+    for (const Event &event : m_events) {
+        Value latency(kArrayType);
+        for (const uint64_t value : event.latency) {
+            if (value) {
+                latency.PushBack(static_cast<double>(value) / 1e6, allocator);
+            }
+            else {
+                latency.PushBack(Value(kNullType), allocator);
+            }
+        }
+
+        Value row(kObjectType);
+        row.AddMember("change",       StringRef(event.change == CHANGE_START ? "start" : (event.change == CHANGE_ALGO ? "algo" : "job")), allocator);
+        row.AddMember("algo",         StringRef(Algorithm::perfAlgoName(event.pa)), allocator);
+        row.AddMember("latency_ms",   latency, allocator);
+        row.AddMember("lost_hashes",  event.lost, allocator);
+        row.AddMember("shares",       event.shares, allocator);
+        row.AddMember("stale_shares", event.stale, allocator);
+
+        doc.PushBack(row, allocator);
+    }
+
+    StringBuffer buffer(nullptr, 4096);
+    PrettyWriter<StringBuffer> writer(buffer);
+    doc.Accept(writer);
+
+    printf("%s\n", buffer.GetString());
+    fflush(stdout);
+}
+
+
+void xmrig::SwitchTest::send(Event &event)
+{
+    snprintf(event.id, sizeof(event.id), "%08x", static_cast<unsigned int>(m_height));
+
+    Job job(0, false, Algorithm(event.pa), Id());
+    job.setRawBlob(kBlob, sizeof(kBlob));
+    job.setTarget(kTarget);
+    job.setHeight(m_height++);
+    job.setId(event.id);
+
+    const Hashrate *hashrate = Workers::hashrate();
+    for (size_t i = 0; i < Workers::threads(); ++i) {
+        const double rate = hashrate ? hashrate->calc(i, Hashrate::ShortInterval) : 0.0;
+
+        event.rates.push_back(isnormal(rate) ? rate : 0.0);
+        event.latency.push_back(0);
+    }
+
+    // the first job is sent on login
+    if (event.change != CHANGE_START) {
+        event.sent = steadyTime();
+    }
+
+    m_server->setJob(job);
+}
+
+
+void xmrig::SwitchTest::stop()
+{
+    uv_timer_stop(&m_timer);
+    uv_close(reinterpret_cast<uv_handle_t*>(&m_timer), nullptr);
+
+    print();
+
+    m_controller->network()->stop();
+    Workers::stop();
+
+    delete m_server;
+    m_server = nullptr;
+
+    uv_stop(uv_default_loop());
+}
+
+
+void xmrig::SwitchTest::tick()
+{
+    Event &event = m_events[m_current];
+
+    if (event.sent == 0) {
+        if (m_server->miners() == 0) {
+            return;
+        }
+
+        event.sent = steadyTime();
+    }
+
+    update(event);
+
+    if (steadyTime() - event.sent < kEventTime * 1000000) {
+        return;
+    }
+
+    finish(event);
+
+    if (++m_current == m_events.size()) {
+        return stop();
+    }
+
+    send(m_events[m_current]);
+}
+
+
+void xmrig::SwitchTest::update(Event &event)
+{
+    const Workers::JobSnapshot job = Workers::job();
+    if (strcmp(job->id().data(), event.id) != 0) {
+        return;
+    }
+
+    for (size_t i = 0; i < event.latency.size(); ++i) {
+        if (event.latency[i]) {
+            continue;
+        }
+
+        const uint64_t first = Workers::firstBatch(i, job->published);
+        if (first) {
+            event.latency[i] = first > event.sent ? first - event.sent : 1;
+        }
+    }
+}
+
+
+void xmrig::SwitchTest::onTimer(uv_timer_t *handle)
+{
+    static_cast<SwitchTest*>(handle->data)->tick();
+}
@@ -0,0 +1,103 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_SWITCHTEST_H
+#define XMRIG_SWITCHTEST_H
+
+
+#include <uv.h>
+#include <vector>
+
+
+#include "common/xmrig.h"
+#include "interfaces/IJobResultListener.h"
+
+
+namespace xmrig {
+
+
+class Controller;
+class StratumServer;
+
+
+// --test-switch, a mock pool on the loop sends scripted algo and job changes to this miner, they go the way of pool
+// jobs through Client, Network and Workers, for each change the time from sending the job to the first finished
+// batch of every GPU thread is measured, the report is printed as JSON and the miner exits
+class SwitchTest : public IJobResultListener
+{
+public:
+    SwitchTest();
+
+    bool start(Controller *controller);
+
+protected:
+    void onJobResult(const JobResult &result) override;
+
+private:
+    enum Change {
+        CHANGE_START,
+        CHANGE_ALGO,
+        CHANGE_JOB
+    };
+
+    // latency of a GPU thread is 0 until it finished a batch of the job, lost hashes are estimated from the
+    // hashrate of the thread before the change, stale shares are shares of earlier jobs submitted after it
+    struct Event
+    {
+        inline Event(Change change, PerfAlgo pa) : change(change), pa(pa), id(), sent(0), lost(0.0), shares(0), stale(0) {}
+
+        Change change;
+        PerfAlgo pa;
+        char id[16];
+        uint64_t sent;
+        double lost;
+        uint64_t shares;
+        uint64_t stale;
+        std::vector<double> rates;
+        std::vector<uint64_t> latency;
+    };
+
+    void finish(Event &event);
+    void print() const;
+    void send(Event &event);
+    void stop();
+    void tick();
+    void update(Event &event);
+
+    static void onTimer(uv_timer_t *handle);
+
+    Controller *m_controller;
+    size_t m_current;
+    std::vector<Event> m_events;
+    StratumServer *m_server;
+    uint64_t m_height;
+    uint64_t m_rejected;
+    uv_timer_t m_timer;
+};
+
+
+} /* namespace xmrig */
+
+
+#endif /* XMRIG_SWITCHTEST_H */
@@ -23,19 +23,45 @@
  *   along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <inttypes.h>
+#include <map>
+#include <set>
+#include <string>
 #include <thread>
 
 
+#include "amd/GpuTelemetry.h"
+#include "amd/OclCache.h"
+#include "amd/OclCryptonightR_gen.h"
+#include "amd/OclError.h"
 #include "amd/OclGPU.h"
+#include "amd/OclKernelBench.h"
 #include "api/Api.h"
+#include "api/EventStream.h"
+#include "common/cpu/Cgroup.h"
+#include "common/cpu/Cpu.h"
 #include "common/log/Log.h"
+#include "common/Platform.h"
+#include "common/utils/timestamp.h"
 #include "core/Config.h"
 #include "core/Controller.h"
+#include "core/History.h"
+#include "core/LoopMonitor.h"
+#include "core/RuntimeState.h"
+#include "core/StatsSegment.h"
+#include "core/Trace.h"
 #include "crypto/CryptoNight.h"
 #include "interfaces/IJobResultListener.h"
 #include "interfaces/IThread.h"
+#include "net/PerfSnapshot.h"
 #include "rapidjson/document.h"
+#include "workers/Canary.h"
+#include "workers/CpuWorker.h"
+#include "workers/DualMiner.h"
+#include "workers/EffectiveRate.h"
 #include "workers/Handle.h"
 #include "workers/Hashrate.h"
 #include "workers/OclThread.h"
@@ -46,63 +72,300 @@
 
 bool Workers::m_active = false;
 bool Workers::m_enabled = true;
-cl_context Workers::m_opencl_ctx;
+bool Workers::m_parked = false;
+bool Workers::m_prewarmPending = false;
+std::vector<cl_context> Workers::m_opencl_contexts;
 Hashrate *Workers::m_hashrate = nullptr;
 size_t Workers::m_threadsCount = 0;
+std::atomic<bool> Workers::m_prewarmStop;
 std::atomic<int> Workers::m_paused;
+std::atomic<size_t> Workers::m_starting(0);
+std::atomic<size_t> Workers::m_waiting(0);
 std::atomic<uint64_t> Workers::m_sequence;
-std::list<xmrig::Job> Workers::m_queue;
+std::atomic<uint64_t> Workers::m_dropped(0);
+std::atomic<uint64_t> Workers::m_jobInterval(0);
+std::atomic<bool> Workers::m_lowered(false);
+GpuContext *Workers::m_verifyGpu = nullptr;
+std::list<Workers::VerifiedResult> Workers::m_gpuQueue;
+std::list<Workers::VerifiedResult> Workers::m_queue;
+std::list<Workers::VerifiedResult> Workers::m_verified;
+std::map<int, Workers::JobArrival> Workers::m_arrivals;
+std::map<size_t, Workers::ThermalControl> Workers::m_thermal;
+std::map<size_t, Workers::BenchResults> Workers::m_benchResults;
+std::map<size_t, Workers::DeviceErrors> Workers::m_deviceErrors;
+std::map<size_t, Workers::Watchdog> Workers::m_watchdog;
+std::map<size_t, std::unique_ptr<std::mutex> > Workers::m_deviceInit;
+std::map<int, Workers::VerifyStats> Workers::m_verifyStats;
+std::vector<Workers::MemoryPool> Workers::m_memory;
+std::vector<cl_context> Workers::m_verifyGpuContexts;
+std::vector<std::thread> Workers::m_verifyThreads;
+bool Workers::m_verifyStop = false;
+uv_cond_t Workers::m_verifyCond;
+uv_cond_t Workers::m_verifyGpuCond;
+ResultRing<Workers::ShareRecord, 4096> Workers::m_results;
+std::thread Workers::m_prewarm;
+std::thread Workers::m_verifyGpuThread;
+std::vector<CpuWorker*> Workers::m_cpuWorkers;
+std::vector<std::thread> Workers::m_cpuThreads;
 std::vector<Handle*> Workers::m_workers;
+xmrig::PerfAlgo Workers::m_jobAlgo = xmrig::PerfAlgo::PA_INVALID;
+xmrig::PerfAlgo Workers::m_standby = xmrig::PerfAlgo::PA_INVALID;
+int64_t Workers::m_unparkTime = -1;
+uint64_t Workers::m_minSubmitDiff = 0;
+uint64_t Workers::m_pausedSince = 0;
 uint64_t Workers::m_ticks = 0;
+uint32_t Workers::m_batchSplit = 1;
+uint32_t Workers::m_parkAfter = 0;
+uint32_t Workers::m_switches[xmrig::PerfAlgo::PA_MAX][xmrig::PerfAlgo::PA_MAX] = {};
+uint32_t Workers::m_switchCost[xmrig::PerfAlgo::PA_MAX][xmrig::PerfAlgo::PA_MAX] = {};
+Workers::PendingSwitch Workers::m_pendingSwitch;
+uint32_t Workers::m_staleTarget = 0;
+uint32_t Workers::m_verifySample = 1;
+uint32_t Workers::m_verifyThreshold = 5;
 uv_async_t Workers::m_async;
+uv_cond_t Workers::m_pauseCond;
 uv_mutex_t Workers::m_mutex;
-uv_rwlock_t Workers::m_rwlock;
+uv_mutex_t Workers::m_pauseMutex;
 uv_timer_t Workers::m_timer;
 xmrig::Controller *Workers::m_controller = nullptr;
+xmrig::DualMiner *Workers::m_dual = nullptr;
+std::atomic<xmrig::IJobResultListener *> Workers::m_direct(nullptr);
 xmrig::IJobResultListener *Workers::m_listener = nullptr;
-xmrig::Job Workers::m_job;
+Workers::JobSnapshot Workers::m_job = std::make_shared<const Workers::PublishedJob>();
+std::map<int, std::shared_ptr<NonceSpace> > Workers::m_nonces;
 
 
-struct JobBaton
+// hashrate rows of CPU threads follow the GPU threads
+static std::vector<size_t> threadDevices(const std::vector<xmrig::IThread *> &threads, size_t cpuThreads)
 {
-    uv_work_t request;
-    std::vector<xmrig::Job> jobs;
-    std::vector<xmrig::JobResult> results;
-    int errors = 0;
+    std::vector<size_t> devices;
+    for (const xmrig::IThread *thread : threads) {
+        devices.push_back(thread->index());
+    }
+
+    devices.insert(devices.end(), cpuThreads, Hashrate::kCpuDevice);
+
+    return devices;
+}
+
+
+// value of a sensor for the hashrate printout, n/a if the GPU doesn't report it
+static const char *sensorValue(double value, const char *format, char *buf, size_t size)
+{
+    if (value < 0.0) {
+        return "n/a";
+    }
+
+    snprintf(buf, size, format, value);
+    return buf;
+}
+
 
-    JobBaton() {
-        request.data = this;
+// the lowest CPU of the affinity mask is taken out of it, -1 without affinity
+static int64_t nextCpu(int64_t &affinity)
+{
+    if (affinity <= 0) {
+        return -1;
     }
-};
+
+    int64_t cpu = 0;
+    for (; (affinity & (1LL << cpu)) == 0; ++cpu) {}
+    affinity &= ~(1LL << cpu);
+
+    return cpu;
+}
 
 
-static size_t threadsCountByGPU(size_t index, const std::vector<xmrig::IThread *> &threads)
+// GPU threads without "affine_to_cpu" take the lowest free CPU of the NUMA node of their GPU (all CPUs if the node is unknown),
+// verification threads without --verify-affinity take the CPUs no GPU thread took, all CPUs are the cpuset of the process
+static std::vector<int64_t> autoAffinity(const std::vector<xmrig::IThread *> &threads, const std::vector<GpuContext *> &contexts, int64_t &verifyAffinity)
 {
-    size_t count = 0;
+    const int cpus     = std::min(xmrig::Cpu::info()->threads(), 64);
+    const uint64_t all = xmrig::Cgroup::cpuMask() ? xmrig::Cgroup::cpuMask() : (cpus >= 64 ? ~0ULL : (1ULL << cpus) - 1);
+    uint64_t used      = 0;
 
     for (const xmrig::IThread *thread : threads) {
-        if (thread->index() == index) {
-            count++;
+        if (thread->affinity() >= 0 && thread->affinity() < 64) {
+            used |= 1ULL << thread->affinity();
         }
     }
 
-    return count;
+    std::vector<int64_t> result(threads.size(), -1);
+
+    for (size_t i = 0; i < threads.size(); ++i) {
+        if (threads[i]->affinity() >= 0) {
+            result[i] = threads[i]->affinity();
+            continue;
+        }
+
+        const GpuContext *ctx = contexts[i];
+        uint64_t local        = GpuTelemetry::localCpus(ctx) & all;
+        if (local == 0) {
+            local = all;
+        }
+
+        // more GPU threads than CPUs on the node share them
+        int64_t free = static_cast<int64_t>((local & ~used) ? local & ~used : local);
+        result[i]    = nextCpu(free);
+        used        |= 1ULL << result[i];
+
+        LOG_INFO("THREAD #%zu GPU #%zu (%02x:%02x.%x): host thread on CPU %" PRId64 " of node CPUs 0x%" PRIx64,
+                 i, ctx->deviceIdx, ctx->caps.pciBus, ctx->caps.pciDevice, ctx->caps.pciFunction, result[i], local);
+    }
+
+    if (verifyAffinity == 0 && (all & ~used) != 0) {
+        verifyAffinity = static_cast<int64_t>(all & ~used);
+
+        LOG_INFO("verification threads on CPUs 0x%" PRIx64, static_cast<uint64_t>(verifyAffinity));
+    }
+
+    return result;
+}
+
+
+// threads of each GPU index, counted in one pass so startup stays linear in the number of threads
+static std::map<size_t, size_t> threadsCountByGPU(const std::vector<xmrig::IThread *> &threads)
+{
+    std::map<size_t, size_t> counts;
+
+    for (const xmrig::IThread *thread : threads) {
+        counts[thread->index()]++;
+    }
+
+    return counts;
+}
+
+
+// clock profile of each GPU is the one of its first thread that has one, GPUs without one get the driver defaults back
+static void applyClocks(const std::vector<xmrig::IThread *> &threads)
+{
+    std::map<size_t, GpuClocks> clocks;
+
+    for (const xmrig::IThread *thread : threads) {
+        const xmrig::OclThread *ocl = static_cast<const xmrig::OclThread *>(thread);
+        GpuClocks &device           = clocks[thread->index()];
+
+        if (device.isDefault()) {
+            device = GpuClocks(ocl->powerCap(), ocl->coreClock(), ocl->memoryClock());
+        }
+    }
+
+    for (const auto &kv : clocks) {
+        GpuTelemetry::setClocks(kv.first, kv.second);
+    }
+}
+
+
+// intensity and comp_mode are compared as OpenCL init adjusts them, running threads have adjusted values
+static bool isSameThread(const xmrig::OclThread *a, const xmrig::OclThread *b)
+{
+    auto intensity = [](const xmrig::OclThread *thread) {
+        return thread->stridedIndex() == 2 ? thread->intensity() / thread->worksize() * thread->worksize() : thread->intensity();
+    };
+
+    auto compMode = [&intensity](const xmrig::OclThread *thread) {
+        return thread->isCompMode() && intensity(thread) % thread->worksize() != 0;
+    };
+
+    return a->index() == b->index() && a->worksize() == b->worksize() && intensity(a) == intensity(b) && compMode(a) == compMode(b) &&
+           a->affinity() == b->affinity() && a->priority() == b->priority() && a->stridedIndex() == b->stridedIndex() && a->memChunk() == b->memChunk() &&
+           a->unrollFactor() == b->unrollFactor() && a->hashesPerItem() == b->hashesPerItem() && a->isPipeline() == b->isPipeline() && a->isPersistent() == b->isPersistent() &&
+           a->buildFlags() == b->buildFlags();
+}
+
+
+Workers::JobSnapshot Workers::job()
+{
+    return std::atomic_load(&m_job);
+}
+
+
+// a copy of the job with another value in its extranonce region, it shares the nonces and the publication time
+Workers::JobSnapshot Workers::roll(const JobSnapshot &job, uint64_t extraNonce)
+{
+    if (job->extraNonce() == extraNonce) {
+        return job;
+    }
+
+    std::shared_ptr<PublishedJob> rolled = std::make_shared<PublishedJob>(*job);
+    rolled->rollExtraNonce(extraNonce);
+
+    return JobSnapshot(std::move(rolled));
+}
+
+
+// called by threads which hash on CPU once their scratchpads are allocated
+void Workers::addMemory(const char *type, size_t index, const MemInfo &info)
+{
+    uv_mutex_lock(&m_mutex);
+    m_memory.push_back({ type, index, info.node, info.hugePages, info.pages, info.size });
+    uv_mutex_unlock(&m_mutex);
+}
+
+
+// called from the main loop for a share of a GPU thread rejected by the pool, "Low difficulty share" points to a result
+// the GPU got wrong, "Invalid job id" is a stale job rather than a bad result
+void Workers::addReject(int threadId, const char *error)
+{
+    if (threadId < 0 || static_cast<size_t>(threadId) >= m_workers.size() || !error) {
+        return;
+    }
+
+    std::string reason(error);
+    std::transform(reason.begin(), reason.end(), reason.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+
+    DeviceErrors &device = m_deviceErrors[m_workers[threadId]->ctx()->deviceIdx];
+    if (reason.find("low diff") != std::string::npos) {
+        device.lowDifficulty++;
+    }
+    else if (reason.find("invalid") != std::string::npos && reason.find("job") == std::string::npos) {
+        device.invalid++;
+    }
+    else {
+        device.rejected++;
+    }
 }
 
 
-xmrig::Job Workers::job()
+// difficulty of a pool answer goes to the GPU of the thread that found the share, see EffectiveRate
+void Workers::addShare(int threadId, uint32_t diff, bool accepted)
 {
-    uv_rwlock_rdlock(&m_rwlock);
-    xmrig::Job job = m_job;
-    uv_rwlock_rdunlock(&m_rwlock);
+    if (threadId < 0 || static_cast<size_t>(threadId) >= m_workers.size()) {
+        return;
+    }
+
+    xmrig::EffectiveRate::addShare(m_workers[threadId]->ctx()->deviceIdx, diff, accepted);
+}
+
+
+// GPU index of a GPU thread of the current algo, -1 for CPU threads and unknown ids
+int Workers::threadDevice(int threadId)
+{
+    if (threadId < 0 || static_cast<size_t>(threadId) >= m_workers.size()) {
+        return -1;
+    }
 
-    return job;
+    return static_cast<int>(m_workers[threadId]->ctx()->deviceIdx);
+}
+
+
+size_t Workers::cpuThreads()
+{
+    return m_cpuWorkers.size();
 }
 
 
 size_t Workers::hugePages()
 {
-    return 0;
+    size_t pages = 0;
+
+    uv_mutex_lock(&m_mutex);
+    for (const MemoryPool &pool : m_memory) {
+        pages += pool.hugePages;
+    }
+    uv_mutex_unlock(&m_mutex);
+
+    return pages;
 }
 
 
@@ -138,9 +401,187 @@ void Workers::printHashrate(bool detail)
 
              i++;
         }
+
+        for (size_t j = 0; j < m_cpuWorkers.size(); ++j, ++i) {
+             Log::i()->text("| %6zu | cpu | %7s | %7s | %7s |",
+                            i,
+                            Hashrate::format(m_hashrate->calc(i, Hashrate::ShortInterval), num1, sizeof num1),
+                            Hashrate::format(m_hashrate->calc(i, Hashrate::MediumInterval), num2, sizeof num2),
+                            Hashrate::format(m_hashrate->calc(i, Hashrate::LargeInterval), num3, sizeof num3)
+                            );
+        }
+
+        printSensors(isColors);
     }
 
     m_hashrate->print();
+
+    if (m_dual) {
+        m_dual->print(detail);
+    }
+}
+
+
+// GPUs with telemetry, H/J is the 60s hashrate of the GPU divided by its power, DUTY is set by the thermal control
+void Workers::printSensors(bool isColors)
+{
+    char num[7][16] = { { 0 } };
+    bool header     = false;
+
+    for (size_t device : m_hashrate->devices()) {
+        const GpuSensors sensors = GpuTelemetry::sensors(device);
+        if (!sensors.isValid()) {
+            continue;
+        }
+
+        if (!header) {
+            Log::i()->text("%s|  GPU |  TEMP |   FAN |  SCLK |  MCLK |  POWER |    H/J |  DUTY |", isColors ? "\x1B[1;37m" : "");
+            header = true;
+        }
+
+        const double efficiency = sensors.hashesPerJoule(m_hashrate->calcDevice(device, Hashrate::MediumInterval));
+        const auto control      = m_thermal.find(device);
+        const double duty       = control != m_thermal.end() ? control->second.duty / 10.0 : 100.0;
+
+        Log::i()->text("| %4zu | %5s | %5s | %5s | %5s | %6s | %6s | %5s |",
+                       device,
+                       sensorValue(sensors.temperature, "%.0fC", num[0], sizeof num[0]),
+                       sensorValue(sensors.fan, "%.0f", num[1], sizeof num[1]),
+                       sensorValue(sensors.clock, "%.0f", num[2], sizeof num[2]),
+                       sensorValue(sensors.memoryClock, "%.0f", num[3], sizeof num[3]),
+                       sensorValue(sensors.power, "%.1fW", num[4], sizeof num[4]),
+                       sensorValue(efficiency > 0.0 ? efficiency : -1.0, "%.2f", num[5], sizeof num[5]),
+                       sensorValue(duty, "%.0f%%", num[6], sizeof num[6])
+                       );
+    }
+}
+
+
+// batches of the worker of the thread that took less than OclWorker::batchBound(bucket) ms, the last bucket has no bound
+uint64_t Workers::batchCount(size_t threadId, size_t bucket)
+{
+    if (threadId >= m_workers.size() || !m_workers[threadId]->worker()) {
+        return 0;
+    }
+
+    return static_cast<const OclWorker *>(m_workers[threadId]->worker())->batchCount(bucket);
+}
+
+
+// host time of all batches of the worker of the thread in ns
+uint64_t Workers::batchSum(size_t threadId)
+{
+    if (threadId >= m_workers.size() || !m_workers[threadId]->worker()) {
+        return 0;
+    }
+
+    return static_cast<const OclWorker *>(m_workers[threadId]->worker())->batchSum();
+}
+
+
+// benchmark results are always verified on CPU, see --stress
+Workers::BenchResults Workers::benchResults(size_t device)
+{
+    const auto it = m_benchResults.find(device);
+
+    return it != m_benchResults.end() ? it->second : BenchResults();
+}
+
+
+// average host time of one batch of the worker of the thread in ns
+uint64_t Workers::batchTime(size_t threadId)
+{
+    if (threadId >= m_workers.size() || !m_workers[threadId]->worker()) {
+        return 0;
+    }
+
+    return static_cast<const OclWorker *>(m_workers[threadId]->worker())->batchTime();
+}
+
+
+// number of hashes computed by all CPU threads since their start
+uint64_t Workers::cpuHashCount()
+{
+    uint64_t count = 0;
+    for (const CpuWorker *worker : m_cpuWorkers) {
+        count += worker->hashCount();
+    }
+
+    return count;
+}
+
+
+// steady time in ns the worker of the thread finished its first batch of the job published at published, 0 before
+uint64_t Workers::firstBatch(size_t threadId, uint64_t published)
+{
+    if (threadId >= m_workers.size() || !m_workers[threadId]->worker()) {
+        return 0;
+    }
+
+    return static_cast<const OclWorker *>(m_workers[threadId]->worker())->firstBatch(published);
+}
+
+
+// number of hashes computed by the worker of the thread since its start
+uint64_t Workers::hashCount(size_t threadId)
+{
+    if (threadId >= m_workers.size() || !m_workers[threadId]->worker()) {
+        return 0;
+    }
+
+    return m_workers[threadId]->worker()->hashCount();
+}
+
+
+// seconds an algo should be mined after a switch to it, reported to pools next to the switch costs, by default
+// the highest measured cost is 5% of it
+uint32_t Workers::minDwell()
+{
+    if (m_controller->config()->algoMinDwell() > 0) {
+        return m_controller->config()->algoMinDwell();
+    }
+
+    uint32_t cost = 0;
+    for (int from = 0; from < xmrig::PerfAlgo::PA_MAX; ++from) {
+        for (int to = 0; to < xmrig::PerfAlgo::PA_MAX; ++to) {
+            cost = std::max(cost, m_switchCost[from][to]);
+        }
+    }
+
+    return (cost * 20 + 999) / 1000;
+}
+
+
+// CPU used by the host thread of the worker of the thread while hashing in 1/1000 of a core, see --opencl-low-cpu
+uint32_t Workers::hostCpu(size_t threadId)
+{
+    if (threadId >= m_workers.size() || !m_workers[threadId]->worker()) {
+        return 0;
+    }
+
+    return static_cast<const OclWorker *>(m_workers[threadId]->worker())->hostCpu();
+}
+
+
+// average GPU time of the kernel of the worker of the thread in ns, available only with profiling
+uint64_t Workers::kernelTime(size_t threadId, size_t kernel)
+{
+    if (threadId >= m_workers.size() || !m_workers[threadId]->ctx()->profiling || !m_workers[threadId]->worker()) {
+        return 0;
+    }
+
+    return static_cast<const OclWorker *>(m_workers[threadId]->worker())->kernelTime(kernel);
+}
+
+
+// batches of the worker of the thread that took several times its average time per hash
+uint64_t Workers::stalls(size_t threadId)
+{
+    if (threadId >= m_workers.size() || !m_workers[threadId]->worker()) {
+        return 0;
+    }
+
+    return static_cast<const OclWorker *>(m_workers[threadId]->worker())->stalls();
 }
 
 
@@ -151,32 +592,118 @@ void Workers::setEnabled(bool enabled)
     }
 
     m_enabled = enabled;
+
+    if (m_dual) {
+        m_dual->setEnabled(enabled);
+    }
+
     if (!m_active) {
         return;
     }
 
     m_paused = enabled ? 0 : 1;
     m_sequence++;
+
+    wakeup();
 }
 
 
 void Workers::setJob(const xmrig::Job &job, bool donate)
 {
-    uv_rwlock_wrlock(&m_rwlock);
-    m_job = job;
+    const uint64_t now = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    std::shared_ptr<PublishedJob> snapshot = std::make_shared<PublishedJob>(job, now);
 
     if (donate) {
-        m_job.setPoolId(-1);
+        snapshot->setPoolId(-1);
+    }
+
+    // a pool sends its job again after a donation or a switch of the weighted strategy, the job goes on with its nonces
+    std::shared_ptr<NonceSpace> &nonces = m_nonces[snapshot->poolId()];
+    if (!nonces || !nonces->isJob(job)) {
+        nonces = std::make_shared<NonceSpace>(job);
+    }
+
+    snapshot->nonces = nonces;
+
+    // readers keep the previous snapshot alive as long as they use it
+    std::atomic_store(&m_job, JobSnapshot(std::move(snapshot)));
+
+    CryptoNight::prepare(job);
+
+    if (job.height() > 0 && (job.algorithm().variant() == xmrig::VARIANT_4 || job.algorithm().variant() == xmrig::VARIANT_WOW)) {
+        xmrig::RuntimeState::setHeight(job.algorithm().perf_algo(), job.height());
+    }
+
+    // the cost of a switch is measured up to the first batches of the pool job it was made for
+    if (m_pendingSwitch.start && !m_pendingSwitch.published) {
+        if (donate || job.poolId() >= 0) {
+            m_pendingSwitch.published = now;
+        }
+        else {
+            m_pendingSwitch = PendingSwitch();
+        }
+    }
+
+    if (job.poolId() != -100) {
+        updateJobInterval(donate ? -1 : job.poolId(), now);
+    }
+
+    // switches requested by pools, benchmark jobs are not counted
+    if (donate || job.poolId() >= 0) {
+        const xmrig::PerfAlgo pa = job.algorithm().perf_algo();
+        if (m_jobAlgo != xmrig::PerfAlgo::PA_INVALID && pa != xmrig::PerfAlgo::PA_INVALID && pa != m_jobAlgo) {
+            m_switches[m_jobAlgo][pa]++;
+        }
+
+        m_jobAlgo = pa;
     }
-    uv_rwlock_wrunlock(&m_rwlock);
 
     m_active = true;
     if (!m_enabled) {
         return;
     }
 
+    unpark();
+
+    // the blob goes to the spare input buffer of each GPU thread while its batch runs, see XMRStageJob
+    for (Handle *handle : m_workers) {
+        if (handle->ctx() && handle->worker() && !handle->isPending()) {
+            XMRStageJob(handle->ctx(), job.blob(), job.size());
+        }
+    }
+
     m_sequence++;
     m_paused = 0;
+
+    wakeup();
+
+    // benchmark jobs switch algorithms all the time, prewarm waits for a real job
+    if (m_prewarmPending && (donate || job.poolId() >= 0)) {
+        m_prewarmPending = false;
+        startPrewarm();
+    }
+}
+
+
+// a thread safe listener (the network with --net-thread) takes verified shares on the verification threads
+void Workers::setListener(xmrig::IJobResultListener *listener)
+{
+    m_listener = listener;
+    m_direct   = listener->isThreadSafe() ? listener : nullptr;
+}
+
+
+// --handover: the programs start would build, in contexts of their own while the previous process still mines
+void Workers::prepare(xmrig::Controller *controller)
+{
+    const xmrig::Algorithm &algorithm = controller->config()->algorithm();
+
+    std::vector<GpuContext *> contexts;
+    for (xmrig::IThread *thread : controller->config()->threads()) {
+        contexts.push_back(static_cast<xmrig::OclThread *>(thread)->ctx());
+    }
+
+    PrepareOpenCL(contexts, algorithm, xmrig::RuntimeState::height(algorithm.perf_algo()), controller->config());
 }
 
 
@@ -192,26 +719,38 @@ bool Workers::start(xmrig::Controller *controller)
 
     m_controller = controller;
     const std::vector<xmrig::IThread *> &threads = controller->config()->threads();
-    size_t ways = 0;
+    const size_t cpuThreads                      = static_cast<size_t>(controller->config()->cpuThreads());
+    size_t ways = cpuThreads;
 
     for (const xmrig::IThread *thread : threads) {
        ways += thread->multiway();
     }
 
     m_threadsCount = threads.size();
-    m_hashrate = new Hashrate(m_threadsCount, controller);
+    m_hashrate = new Hashrate(threadDevices(threads, cpuThreads), controller->config()->algorithm().perf_algo(), controller);
 
     uv_mutex_init(&m_mutex);
-    uv_rwlock_init(&m_rwlock);
+    uv_cond_init(&m_verifyCond);
+    uv_cond_init(&m_verifyGpuCond);
+    uv_mutex_init(&m_pauseMutex);
+    uv_cond_init(&m_pauseCond);
 
     m_sequence = 1;
     m_paused   = 1;
 
     uv_async_init(uv_default_loop(), &m_async, Workers::onResult);
 
+    m_batchSplit      = controller->config()->batchSplit();
+    m_staleTarget     = controller->config()->staleTarget();
+    m_minSubmitDiff   = controller->config()->minSubmitDiff();
+    m_parkAfter       = controller->config()->parkAfter();
+    m_verifySample    = controller->config()->verifySample();
+    m_verifyThreshold = controller->config()->verifyErrorThreshold();
+
     std::vector<GpuContext *> contexts(m_threadsCount);
 
-    const bool isCNv2 = controller->config()->isCNv2();
+    const bool isCNv2                         = controller->config()->isCNv2();
+    const std::map<size_t, size_t> countByGPU = threadsCountByGPU(threads);
 
     for (size_t i = 0; i < m_threadsCount; ++i) {
         xmrig::OclThread *thread = static_cast<xmrig::OclThread *>(threads[i]);
@@ -220,15 +759,82 @@ bool Workers::start(xmrig::Controller *controller)
                      controller->config()->isColors() ? "\x1B[1;33m" : "", i);
         }
 
-        thread->setThreadsCountByGPU(threadsCountByGPU(thread->index(), threads));
+        thread->setThreadsCountByGPU(countByGPU.at(thread->index()));
 
         contexts[i] = thread->ctx();
     }
 
-    if (InitOpenCL(contexts, controller->config(), &m_opencl_ctx) != 0) {
+    // intensities lowered by --error-action before a restart, buffers are sized for them right away
+    for (int a = 0; a != xmrig::PerfAlgo::PA_MAX; ++a) {
+        const xmrig::PerfAlgo pa = static_cast<xmrig::PerfAlgo>(a);
+        const std::vector<xmrig::IThread *> &algoThreads = controller->config()->threads(pa);
+
+        for (size_t i = 0; i < algoThreads.size(); ++i) {
+            GpuContext *ctx        = static_cast<xmrig::OclThread *>(algoThreads[i])->ctx();
+            const size_t intensity = xmrig::RuntimeState::intensity(pa, i, algoThreads[i]->index());
+
+            if (intensity > 0 && intensity < ctx->rawIntensity) {
+                LOG_INFO("THREAD #%zu: GPU #%zu %s intensity %zu restored from the runtime state", i, algoThreads[i]->index(), xmrig::Algorithm::perfAlgoName(pa), intensity);
+                ctx->rawIntensity = intensity;
+            }
+        }
+    }
+
+    // only the OpenCL contexts are made here, each GPU thread builds its program and buffers and starts hashing on its own
+    if (InitOpenCL(contexts, controller->config(), &m_opencl_contexts, false) != 0) {
         return false;
     }
 
+    // programs of the CryptonightR heights around the one mined before a restart, compiled while the pool connects
+    const xmrig::Algorithm &algorithm = controller->config()->algorithm();
+    const uint64_t height             = xmrig::RuntimeState::height(algorithm.perf_algo());
+
+    if (height > 0 && (algorithm.variant() == xmrig::VARIANT_4 || algorithm.variant() == xmrig::VARIANT_WOW)) {
+        for (GpuContext *ctx : contexts) {
+            for (uint64_t i = 0; i <= PRECOMPILATION_DEPTH; ++i) {
+                CryptonightR_get_program(ctx, algorithm.variant(), height + i, true);
+            }
+        }
+    }
+
+    for (const GpuContext *ctx : contexts) {
+        GpuTelemetry::add(ctx);
+    }
+
+    applyClocks(threads);
+
+    // the PCI bus IDs of the GPUs are known once the contexts are initialized
+    int64_t affinity = controller->config()->verifyAffinity();
+    std::vector<int64_t> cpus(m_threadsCount, -1);
+    if (controller->config()->isAutoAffinity()) {
+        cpus = autoAffinity(threads, contexts, affinity);
+    }
+
+    // CPU verification of GPU results has its own threads, libuv threadpool is left to DNS and file I/O,
+    // more threads than the CPU quota of a container only take turns
+    const int verifyThreads = std::min(controller->config()->verifyThreads(), xmrig::Cpu::info()->threads());
+    if (verifyThreads < controller->config()->verifyThreads()) {
+        LOG_INFO("verification threads limited to %d by the available CPUs", verifyThreads);
+    }
+
+    for (int i = 0; i < verifyThreads; ++i) {
+        m_verifyThreads.emplace_back(Workers::verifyThread, static_cast<size_t>(i), nextCpu(affinity), controller->config()->verifyPriority());
+    }
+
+    if (controller->config()->verifyGpu() >= 0 && startVerifyGpu(controller->config())) {
+        m_verifyGpuThread = std::thread(Workers::verifyGpuThread, controller->config()->verifyPriority());
+    }
+
+    // experimental, the dual threads start with the others and get jobs once Network connects
+    if (controller->config()->dualPool().isValid()) {
+        m_dual = new xmrig::DualMiner(controller);
+
+        if (!m_dual->start()) {
+            delete m_dual;
+            m_dual = nullptr;
+        }
+    }
+
     uv_timer_init(uv_default_loop(), &m_timer);
     uv_timer_start(&m_timer, Workers::onTick, 500, 500);
 
@@ -237,31 +843,74 @@ bool Workers::start(xmrig::Controller *controller)
     size_t i = 0;
     for (xmrig::IThread *thread : threads) {
         Handle *handle = new Handle(i, thread, contexts[i], offset, ways);
+        handle->setAffinity(cpus[i]);
+        handle->setPriority(controller->config()->gpuPriority());
         offset += thread->multiway();
         i++;
 
         m_workers.push_back(handle);
-        handle->start(Workers::onReady);
     }
 
-    controller->save();
+    launch(true);
 
-    return true;
-}
+    // CPU threads hash the jobs with their own algorithm, they keep running through GPU restarts and algo switches
+    affinity = controller->config()->cpuAffinity();
+    for (size_t j = 0; j < cpuThreads; ++j) {
+        m_cpuWorkers.push_back(new CpuWorker(j, nextCpu(affinity)));
+    }
+
+    for (CpuWorker *worker : m_cpuWorkers) {
+        m_cpuThreads.emplace_back(&CpuWorker::start, worker);
+    }
+
+    controller->save();
+    m_prewarmPending = true;
+
+    return true;
+}
+
+// pending threads initialize their GPU context first, threads of the same GPU one after another
+void Workers::launch(bool pending)
+{
+    m_deviceInit.clear();
+
+    for (Handle *handle : m_workers) {
+        std::unique_ptr<std::mutex> &device = m_deviceInit[handle->ctx()->deviceIdx];
+        if (!device) {
+            device.reset(new std::mutex());
+        }
+
+        handle->setPending(pending);
+    }
+
+    m_starting = pending ? m_workers.size() : 0;
 
-void Workers::soft_stop() // stop current workers leaving uv stuff intact (used in switch_algo)
+    for (Handle *handle : m_workers) {
+        handle->start(Workers::onReady);
+    }
+}
+
+
+// until each pending thread has finished its first initialization, GPUs which failed it are tried again in the background
+void Workers::waitReady()
+{
+    while (m_starting.load() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+
+void Workers::soft_stop() // stop current workers leaving uv and OpenCL stuff intact (used in switch_algo)
 {
     m_sequence = 0;
     m_paused   = 0;
+    wakeup();
 
     for (Handle *handle : m_workers) {
         handle->join();
-        ReleaseOpenCl(handle->ctx());
         delete handle;
     }
 
-    ReleaseOpenClContext(m_opencl_ctx);
-
     m_workers.clear();
 }
 
@@ -270,12 +919,33 @@ bool Workers::switch_algo(const xmrig::Algorithm& algorithm)
 {
     if (m_controller->config()->algorithm().perf_algo() == algorithm.perf_algo()) return true;
 
+    xmrig::Trace::Span span("switch_algo", algorithm.perf_algo());
+
+    m_pendingSwitch.from      = m_controller->config()->algorithm().perf_algo();
+    m_pendingSwitch.to        = algorithm.perf_algo();
+    m_pendingSwitch.start     = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    m_pendingSwitch.published = 0;
+
+    stopPrewarm();
+    unpark();
+
+    // OpenCL context, command queues and buffers are kept for the new algorithm if possible
+    std::vector<GpuContext *> previous;
+    for (Handle *handle : m_workers) {
+        previous.push_back(handle->ctx());
+    }
+
     soft_stop();
 
     m_sequence = 1;
     m_paused   = 1;
 
-    const std::vector<xmrig::IThread *> &threads = m_controller->config()->threads(algorithm.perf_algo());
+    // there is only one standby slot, programs of the previous algorithm take it for a switch back
+    const xmrig::PerfAlgo standby = m_controller->config()->algorithm().perf_algo();
+    if (m_standby != algorithm.perf_algo()) {
+        releaseStandby();
+    }
+
     m_controller->config()->set_algorithm(algorithm);
 
     Log::i()->text(m_controller->config()->isColors()
@@ -284,17 +954,187 @@ bool Workers::switch_algo(const xmrig::Algorithm& algorithm)
         algorithm.name()
     );
 
-    size_t ways = 0;
+#   ifndef XMRIG_NO_API
+    if (EventStream::isActive()) {
+        EventStream::algo(algorithm);
+    }
+#   endif
+
+    return relaunch(previous, standby);
+}
+
+// restarts workers of the current algorithm, configure is called when they are stopped to change threads settings
+bool Workers::reconfigure(void (*configure)(void *arg), void *arg)
+{
+    stopPrewarm();
+    unpark();
+
+    std::vector<GpuContext *> previous;
+    for (Handle *handle : m_workers) {
+        previous.push_back(handle->ctx());
+    }
+
+    soft_stop();
+
+    m_sequence = 1;
+    m_paused   = 1;
+
+    configure(arg);
+
+    return relaunch(previous, xmrig::PerfAlgo::PA_INVALID);
+}
+
+// applies "threads" of a reloaded config, GPUs with unchanged settings keep hashing with their contexts moved to the new
+// threads and only threads of changed GPUs are stopped, get new programs and buffers and continue the job from their nonces
+void Workers::reload(xmrig::Config *previous)
+{
+    xmrig::Config *config = m_controller->config();
+    config->set_algorithm(previous->algorithm());
+    config->oclReload(previous);
+
+    if (m_workers.empty()) {
+        return;
+    }
+
+    // clocks don't need a restart of the threads
+    applyClocks(config->threads());
+
+    const xmrig::PerfAlgo pa                    = config->algorithm().perf_algo();
+    const std::vector<xmrig::IThread *> &before = previous->threads(pa);
+    const std::vector<xmrig::IThread *> &after  = config->threads(pa);
+
+    bool sameDevices = before.size() == after.size() && after.size() == m_workers.size();
+    for (size_t i = 0; sameDevices && i < after.size(); ++i) {
+        sameDevices = before[i]->index() == after[i]->index();
+    }
+
+    bool pending = false;
+    for (const Handle *handle : m_workers) {
+        pending = pending || handle->isPending();
+    }
+
+    // threads were added, removed or moved to other GPUs, so nonce offsets and hashrate slots change too,
+    // threads still initializing their GPU are restarted with all others
+    if (!sameDevices || pending || isPaused()) {
+        if (reconfigure([](void *) {}, nullptr) && m_active && m_enabled) {
+            m_sequence++;
+            m_paused = 0;
+            wakeup();
+        }
+
+        return;
+    }
+
+    std::set<size_t> changed;
+    for (size_t i = 0; i < after.size(); ++i) {
+        if (!isSameThread(static_cast<const xmrig::OclThread *>(before[i]), static_cast<const xmrig::OclThread *>(after[i]))) {
+            changed.insert(after[i]->index());
+        }
+    }
+
+    std::vector<size_t> restart;
+    for (size_t i = 0; i < after.size(); ++i) {
+        xmrig::OclThread *thread = static_cast<xmrig::OclThread *>(after[i]);
+
+        if (changed.count(thread->index())) {
+            restart.push_back(i);
+            continue;
+        }
+
+        thread->swapContext(static_cast<xmrig::OclThread *>(before[i]));
+        m_workers[i]->reset(thread, thread->ctx());
+    }
+
+    if (restart.empty()) {
+        return;
+    }
+
+    stopPrewarm();
+
+    for (size_t i : restart) {
+        m_workers[i]->stop();
+    }
+
+    std::vector<GpuContext *> previousContexts;
+    std::vector<GpuContext *> contexts;
+    const std::map<size_t, size_t> countByGPU = threadsCountByGPU(after);
+
+    for (size_t i : restart) {
+        m_workers[i]->join();
+
+        xmrig::OclThread *thread = static_cast<xmrig::OclThread *>(after[i]);
+        thread->setThreadsCountByGPU(countByGPU.at(thread->index()));
+
+        previousContexts.push_back(m_workers[i]->ctx());
+        contexts.push_back(thread->ctx());
+    }
+
+    LOG_INFO("%zu of %zu GPU threads restarted with new settings", restart.size(), m_workers.size());
+
+    if (SwitchOpenCL(previousContexts, contexts, config, false) != 0) {
+        LOG_ERR("GPU threads reload failed, restarting all of them");
+
+        std::vector<GpuContext *> all;
+        for (Handle *handle : m_workers) {
+            all.push_back(handle->ctx());
+        }
+
+        m_sequence = 0;
+        m_paused   = 0;
+        wakeup();
+
+        for (size_t i = 0; i < m_workers.size(); ++i) {
+            if (std::find(restart.begin(), restart.end(), i) == restart.end()) {
+                m_workers[i]->join();
+            }
+
+            delete m_workers[i];
+        }
+
+        m_workers.clear();
+        m_sequence = 1;
+        m_paused   = 1;
+
+        if (relaunch(all, xmrig::PerfAlgo::PA_INVALID) && m_active && m_enabled) {
+            m_sequence++;
+            m_paused = 0;
+            wakeup();
+        }
+
+        return;
+    }
+
+    for (size_t k = 0; k < restart.size(); ++k) {
+        Handle *handle = m_workers[restart[k]];
+
+        handle->reset(after[restart[k]], contexts[k]);
+        handle->start(Workers::onReady);
+    }
+
+    m_prewarmPending = true;
+}
+
+
+// the programs of the previous threads are kept if standby is their perf algo
+bool Workers::relaunch(const std::vector<GpuContext *> &previous, xmrig::PerfAlgo standby)
+{
+    const xmrig::Algorithm &algorithm            = m_controller->config()->algorithm();
+    const std::vector<xmrig::IThread *> &threads = m_controller->config()->threads();
+
+    size_t ways = m_cpuWorkers.size();
     for (const xmrig::IThread *thread : threads) {
        ways += thread->multiway();
     }
 
     m_threadsCount = threads.size();
-    m_hashrate->set_threads(m_threadsCount);
+    m_hashrate->set_threads(threadDevices(threads, m_cpuWorkers.size()), algorithm.perf_algo());
+    m_watchdog.clear();
 
     std::vector<GpuContext *> contexts(m_threadsCount);
 
-    const bool isCNv2 = algorithm.algo() == xmrig::CRYPTONIGHT && algorithm.variant() == xmrig::VARIANT_2;
+    const bool isCNv2                         = algorithm.algo() == xmrig::CRYPTONIGHT && algorithm.variant() == xmrig::VARIANT_2;
+    const std::map<size_t, size_t> countByGPU = threadsCountByGPU(threads);
+
     for (size_t i = 0; i < m_threadsCount; ++i) {
         xmrig::OclThread* const thread = static_cast<xmrig::OclThread *>(threads[i]);
         if (isCNv2 && thread->stridedIndex() == 1) {
@@ -302,13 +1142,59 @@ bool Workers::switch_algo(const xmrig::Algorithm& algorithm)
                      m_controller->config()->isColors() ? "\x1B[1;33m" : "", i);
         }
 
-        thread->setThreadsCountByGPU(threadsCountByGPU(thread->index(), threads));
+        thread->setThreadsCountByGPU(countByGPU.at(thread->index()));
 
         contexts[i] = thread->ctx();
     }
 
-    if (InitOpenCL(contexts, m_controller->config(), &m_opencl_ctx) != 0) {
-        return false;
+    size_t intensity = 0;
+    for (const GpuContext *ctx : contexts) {
+        intensity += ctx->rawIntensity;
+    }
+
+    bool pending = false;
+    if (SwitchOpenCL(previous, contexts, m_controller->config(), standby != xmrig::PerfAlgo::PA_INVALID) == 0) {
+        if (standby != xmrig::PerfAlgo::PA_INVALID) {
+            m_standby = standby;
+        }
+    }
+    else {
+        // other devices or failed hot switch, start from scratch
+        for (GpuContext *ctx : previous) {
+            ReleaseOpenCl(ctx);
+        }
+
+        for (GpuContext *ctx : contexts) {
+            ReleaseOpenCl(ctx);
+        }
+
+        releaseStandby();
+        ReleaseOpenClContexts(m_opencl_contexts);
+        GpuTelemetry::clear();
+        m_thermal.clear();
+        m_deviceErrors.clear();
+
+        if (InitOpenCL(contexts, m_controller->config(), &m_opencl_contexts, false) != 0) {
+            return false;
+        }
+
+        pending = true;
+    }
+
+    for (const GpuContext *ctx : contexts) {
+        GpuTelemetry::add(ctx);
+    }
+
+    // the clock profile of the new perf algo, tune rounds and patched threads of the current one come here too
+    applyClocks(threads);
+
+    // InitOpenCLGpu lowered an intensity to fit in memory, the config keeps it for this perf algo
+    for (const GpuContext *ctx : contexts) {
+        intensity -= ctx->rawIntensity;
+    }
+
+    if (intensity > 0 && m_controller->config()->isShouldSave()) {
+        m_controller->config()->save();
     }
 
     uint32_t offset = 0;
@@ -320,140 +1206,1598 @@ bool Workers::switch_algo(const xmrig::Algorithm& algorithm)
         i++;
 
         m_workers.push_back(handle);
-        handle->start(Workers::onReady);
     }
 
+    // the job of the switch is given to the threads which are ready, like the hot switch
+    launch(pending);
+    waitReady();
+
+    m_prewarmPending = true;
+
     return true;
 }
 
+// compiles cache binaries of other perf algos in background, so a later algo switch does not compile with GPUs idle
+void Workers::startPrewarm()
+{
+    const xmrig::Config *config = m_controller->config();
+    if (!config->isOclCache() || config->isBench()) {
+        return;
+    }
+
+    std::vector<GpuContext *> running;
+    for (Handle *handle : m_workers) {
+        running.push_back(handle->ctx());
+    }
+
+    // programs of the standby algorithm are kept, a standby which is already built is skipped
+    xmrig::PerfAlgo standby = standbyAlgo(config->algorithm().perf_algo());
+    const bool built        = standby == m_standby;
+    if (built) {
+        standby = xmrig::PerfAlgo::PA_INVALID;
+    }
+    else if (standby != xmrig::PerfAlgo::PA_INVALID) {
+        releaseStandby();
+        m_standby = standby;
+    }
+
+    std::vector<std::pair<xmrig::Algorithm, std::vector<GpuContext *> > > algorithms;
+    for (int i = 0; i < xmrig::PerfAlgo::PA_MAX; ++i) {
+        const xmrig::PerfAlgo pa = static_cast<xmrig::PerfAlgo>(i);
+        if (pa == config->algorithm().perf_algo() || (built && pa == m_standby) || config->threads(pa).empty() || !config->isPoolPerfAlgo(pa)) {
+            continue;
+        }
+
+        std::vector<GpuContext *> contexts;
+        for (const xmrig::IThread *thread : config->threads(pa)) {
+            contexts.push_back(static_cast<const xmrig::OclThread *>(thread)->ctx());
+        }
+
+        algorithms.emplace_back(xmrig::Algorithm(pa), contexts);
+    }
+
+    m_prewarmStop = false;
+    m_prewarm     = PrewarmOpenCL(running, algorithms, standby, m_controller->config(), m_prewarmStop);
+}
+
+// the most likely next perf algo: the most frequent pool switch from the current one,
+// without any history the algorithm left last or the first other algorithm of pools
+xmrig::PerfAlgo Workers::standbyAlgo(xmrig::PerfAlgo current)
+{
+    const xmrig::Config *config = m_controller->config();
+    xmrig::PerfAlgo standby     = xmrig::PerfAlgo::PA_INVALID;
+    uint32_t switches           = 0;
+
+    for (int i = 0; i < xmrig::PerfAlgo::PA_MAX; ++i) {
+        const xmrig::PerfAlgo pa = static_cast<xmrig::PerfAlgo>(i);
+        if (pa == current || config->threads(pa).empty() || !config->isPoolPerfAlgo(pa)) {
+            continue;
+        }
+
+        if (switches == 0 && (standby == xmrig::PerfAlgo::PA_INVALID || pa == m_standby)) {
+            standby = pa;
+        }
+
+        if (m_switches[current][pa] > switches) {
+            switches = m_switches[current][pa];
+            standby  = pa;
+        }
+    }
+
+    return standby;
+}
+
+// standby programs belong to the OpenCL context, they are released before it
+void Workers::releaseStandby()
+{
+    if (m_standby == xmrig::PerfAlgo::PA_INVALID) {
+        return;
+    }
+
+    for (const xmrig::IThread *thread : m_controller->config()->threads(m_standby)) {
+        ReleaseOpenClKernels(static_cast<const xmrig::OclThread *>(thread)->ctx());
+    }
+
+    m_standby = xmrig::PerfAlgo::PA_INVALID;
+}
+
+// prewarm uses the running OpenCL context, it must be finished before the context can be released
+void Workers::stopPrewarm()
+{
+    m_prewarmPending = false;
+    m_prewarmStop    = true;
+
+    if (m_prewarm.joinable()) {
+        m_prewarm.join();
+    }
+}
+
 void Workers::stop()
 {
+    xmrig::RuntimeState::save(m_controller->config());
+
+    stopPrewarm();
     uv_timer_stop(&m_timer);
     m_hashrate->stop();
 
+    if (m_dual) {
+        m_dual->stop();
+    }
+
+    uv_mutex_lock(&m_mutex);
+    m_verifyStop = true;
+    uv_cond_broadcast(&m_verifyCond);
+    uv_mutex_unlock(&m_mutex);
+
+    for (std::thread &thread : m_verifyThreads) {
+        thread.join();
+    }
+
+    m_verifyThreads.clear();
+
+    if (m_verifyGpuThread.joinable()) {
+        m_verifyGpuThread.join();
+    }
+
     uv_close(reinterpret_cast<uv_handle_t*>(&m_async), nullptr);
+
+    for (CpuWorker *worker : m_cpuWorkers) {
+        worker->stop();
+    }
+
     m_paused   = 0;
     m_sequence = 0;
+    wakeup();
 
     for (size_t i = 0; i < m_workers.size(); ++i) {
         m_workers[i]->join();
         ReleaseOpenCl(m_workers[i]->ctx());
     }
 
-    ReleaseOpenClContext(m_opencl_ctx);
-}
+    for (std::thread &thread : m_cpuThreads) {
+        thread.join();
+    }
 
+    for (CpuWorker *worker : m_cpuWorkers) {
+        delete worker;
+    }
 
-void Workers::submit(const xmrig::Job &result)
-{
-    uv_mutex_lock(&m_mutex);
-    m_queue.push_back(result);
-    uv_mutex_unlock(&m_mutex);
+    m_cpuThreads.clear();
+    m_cpuWorkers.clear();
+    m_memory.clear();
 
-    uv_async_send(&m_async);
+    releaseStandby();
+
+    // cache files still being written hold programs of these contexts
+    OclCache::flush();
+    ReleaseOpenClContexts(m_opencl_contexts);
+
+    if (m_verifyGpu) {
+        ReleaseOpenCl(m_verifyGpu);
+        ReleaseOpenClContexts(m_verifyGpuContexts);
+        delete m_verifyGpu;
+        m_verifyGpu = nullptr;
+    }
+    GpuTelemetry::clear();
+    m_thermal.clear();
+    m_deviceErrors.clear();
+    m_watchdog.clear();
 }
 
 
-#ifndef XMRIG_NO_API
-void Workers::threadsSummary(rapidjson::Document &doc)
+// blocks a GPU thread while workers are paused, the thread is woken up by wakeup() as soon as
+// setJob, setEnabled or stop change the state
+void Workers::waitResume()
 {
-//    uv_mutex_lock(&m_mutex);
-//    const uint64_t pages[2] = { m_status.hugePages, m_status.pages };
-//    const uint64_t memory   = m_status.ways * xmrig::cn_select_memory(m_status.algo);
-//    uv_mutex_unlock(&m_mutex);
+    uv_mutex_lock(&m_pauseMutex);
+    m_waiting++;
 
-//    auto &allocator = doc.GetAllocator();
-
-//    rapidjson::Value hugepages(rapidjson::kArrayType);
-//    hugepages.PushBack(pages[0], allocator);
-//    hugepages.PushBack(pages[1], allocator);
+    while (isPaused()) {
+        uv_cond_wait(&m_pauseCond, &m_pauseMutex);
+    }
 
-//    doc.AddMember("hugepages", hugepages, allocator);
-//    doc.AddMember("memory", memory, allocator);
+    m_waiting--;
+    uv_mutex_unlock(&m_pauseMutex);
 }
-#endif
 
 
-void Workers::onReady(void *arg)
+// called by GPU threads for every found nonce, the result goes through a lock-free ring to onResult
+void Workers::submit(const JobSnapshot &job, size_t threadId, uint32_t nonce, const uint8_t *hash)
 {
-    auto handle = static_cast<Handle*>(arg);
-
-    IWorker *worker = new OclWorker(handle);
-    handle->setWorker(worker);
+    ShareRecord share;
+    share.job      = job;
+    share.nonce    = nonce;
+    share.threadId = static_cast<int>(threadId);
+    memcpy(share.hash, hash, sizeof(share.hash));
+
+    if (!m_results.push(std::move(share))) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
 
-    start(worker);
+    uv_async_send(&m_async);
 }
 
 
-void Workers::onResult(uv_async_t *handle)
+// called by CPU threads, the hash is computed on CPU already and skips verification
+void Workers::submitCpu(const JobSnapshot &job, uint32_t nonce, const uint8_t *hash)
 {
-    JobBaton *baton = new JobBaton();
+    ShareRecord share;
+    share.job      = job;
+    share.nonce    = nonce;
+    share.threadId = -1;
+    memcpy(share.hash, hash, sizeof(share.hash));
+
+    xmrig::IJobResultListener *direct = m_direct;
+    if (direct) {
+        return direct->onJobResult(jobResult(share));
+    }
 
-    uv_mutex_lock(&m_mutex);
-    while (!m_queue.empty()) {
-        baton->jobs.push_back(std::move(m_queue.front()));
-        m_queue.pop_front();
+    if (!m_results.push(std::move(share))) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
     }
-    uv_mutex_unlock(&m_mutex);
 
-    uv_queue_work(uv_default_loop(), &baton->request,
-        [](uv_work_t* req) {
-            JobBaton *baton = static_cast<JobBaton*>(req->data);
-            if (baton->jobs.empty()) {
-                return;
-            }
+    uv_async_send(&m_async);
+}
 
-            xmrig::Algo algo;
-            cryptonight_ctx *ctx;
-            MemInfo info = Mem::create(&ctx, algo = baton->jobs[0].algorithm().algo(), 1);
 
-            for (const xmrig::Job &job : baton->jobs) {
-                xmrig::JobResult result(job);
+#ifndef XMRIG_NO_API
+void Workers::threadProfile(size_t index, rapidjson::Value &thread, rapidjson::Document &doc)
+{
+    static const char *kernels[GpuContext::ProfileMax] = { "cn0", "cn00", "cn1", "cn2", "final" };
 
-                if (job.algorithm().algo() != algo) {
-                    Mem::release(&ctx, 1, info);
-                    info = Mem::create(&ctx, algo = job.algorithm().algo(), 1);
-                }
+    if (index >= m_workers.size() || !m_workers[index]->ctx()->profiling || !m_workers[index]->worker()) {
+        return;
+    }
 
-                if (job.poolId() == -100 || CryptoNight::hash(job, result, ctx)) {
-                    baton->results.push_back(result);
-                }
-                else {
-                    baton->errors++;
-                }
-            }
+    auto &allocator = doc.GetAllocator();
+    auto worker     = static_cast<const OclWorker *>(m_workers[index]->worker());
 
-            Mem::release(&ctx, 1, info);
-        },
-        [](uv_work_t* req, int status) {
-            JobBaton *baton = static_cast<JobBaton*>(req->data);
+    // average GPU time of each kernel in milliseconds, 0 for kernels the algorithm doesn't use
+    rapidjson::Value profile(rapidjson::kObjectType);
+    for (size_t i = 0; i < GpuContext::ProfileMax; ++i) {
+        profile.AddMember(rapidjson::StringRef(kernels[i]), static_cast<double>(worker->kernelTime(i)) / 1e6, allocator);
+    }
 
-            for (const xmrig::JobResult &result : baton->results) {
-                m_listener->onJobResult(result);
-            }
+    thread.AddMember("profile", profile, allocator);
+}
 
-            if (baton->errors > 0 && !baton->jobs.empty()) {
-                LOG_ERR("THREAD #%d COMPUTE ERROR(s): %i", baton->jobs[0].threadId(), baton->errors);
-            }
 
-            delete baton;
-        }
-    );
+// {"checked": N, "compute": N, "invalid": N, "low_difficulty": N, "rejected": N}, results verified on CPU and the failed
+// ones, pool rejects by reason and whether --error-action disabled a thread of the GPU
+void Workers::deviceErrors(size_t device, rapidjson::Value &value, rapidjson::Document &doc)
+{
+    auto &allocator            = doc.GetAllocator();
+    const DeviceErrors &errors = m_deviceErrors[device];
+
+    rapidjson::Value value_(rapidjson::kObjectType);
+    value_.AddMember("checked",        errors.checked, allocator);
+    value_.AddMember("compute",        errors.compute, allocator);
+    value_.AddMember("invalid",        errors.invalid, allocator);
+    value_.AddMember("low_difficulty", errors.lowDifficulty, allocator);
+    value_.AddMember("rejected",       errors.rejected, allocator);
+    value_.AddMember("disabled",       errors.disabled, allocator);
+
+    value.AddMember("errors", value_, allocator);
 }
 
 
-void Workers::onTick(uv_timer_t *handle)
+// variation of the 10s hashrate of the GPU, its batch stalls and watchdog restarts summed over its threads,
+// a GPU with a rising cv or stalls at a steady average is usually an unstable overclock, riser or driver
+void Workers::deviceStability(size_t device, rapidjson::Value &value, rapidjson::Document &doc)
 {
-    for (Handle *handle : m_workers) {
-        if (!handle->worker()) {
-            return;
+    auto &allocator = doc.GetAllocator();
+    uint64_t stalls   = 0;
+    uint64_t restarts = 0;
+
+    for (size_t i = 0; i < m_workers.size(); ++i) {
+        if (m_workers[i]->ctx()->deviceIdx != device) {
+            continue;
         }
 
-        m_hashrate->add(handle->threadId(), handle->worker()->hashCount(), handle->worker()->timestamp());
+        stalls   += Workers::stalls(i);
+        const auto it = m_watchdog.find(i);
+        restarts += it != m_watchdog.end() ? it->second.restarts : 0;
     }
 
-    if ((m_ticks++ & 0xF) == 0)  {
-        m_hashrate->updateHighest();
+    const double cv = m_hashrate ? m_hashrate->stabilityDevice(device) : nan("");
+
+    rapidjson::Value stability(rapidjson::kObjectType);
+    stability.AddMember("cv",       std::isnan(cv) ? rapidjson::Value(rapidjson::kNullType) : rapidjson::Value(floor(cv * 10000.0) / 10000.0), allocator);
+    stability.AddMember("stalls",   stalls, allocator);
+    stability.AddMember("restarts", restarts, allocator);
+
+    value.AddMember("stability", stability, allocator);
+}
+
+
+// duty cycle of the thermal control and the best efficiency seen with the duty it was seen at, see updateThermal
+void Workers::deviceThermal(size_t device, rapidjson::Value &value, rapidjson::Document &doc)
+{
+    const auto it = m_thermal.find(device);
+    if (it == m_thermal.end()) {
+        return;
+    }
+
+    auto &allocator = doc.GetAllocator();
+
+    value.AddMember("duty",                  it->second.duty / 10.0, allocator);
+    value.AddMember("throttled",             it->second.throttled, allocator);
+    value.AddMember("desktop",               it->second.desktop, allocator);
+    value.AddMember("best_hashes_per_joule", floor(it->second.bestEfficiency * 100.0) / 100.0, allocator);
+    value.AddMember("best_duty",             it->second.bestDuty / 10.0, allocator);
+}
+
+
+// resources of the loaded kernels as reported by the driver, see GpuKernelUsage
+void Workers::threadKernels(size_t index, rapidjson::Value &thread, rapidjson::Document &doc)
+{
+    if (index >= m_workers.size() || m_workers[index]->ctx()->kernels.workGroupSize == 0) {
+        return;
+    }
+
+    auto &allocator             = doc.GetAllocator();
+    const GpuKernelUsage &usage = m_workers[index]->ctx()->kernels;
+
+    rapidjson::Value kernels(rapidjson::kObjectType);
+    kernels.AddMember("work_group_size",     static_cast<uint64_t>(usage.workGroupSize), allocator);
+    kernels.AddMember("work_group_multiple", static_cast<uint64_t>(usage.workGroupMultiple), allocator);
+    kernels.AddMember("local_mem",           usage.localMem, allocator);
+    kernels.AddMember("private_mem",         usage.privateMem, allocator);
+
+    thread.AddMember("kernels", kernels, allocator);
+}
+
+
+// histogram of the host time of the batches, counts[i] are batches that took less than le_ms[i] (the last bucket
+// has no bound), the stalls, watchdog restarts and the variation of the 10s hashrate of the thread
+void Workers::threadStability(size_t index, rapidjson::Value &thread, rapidjson::Document &doc)
+{
+    if (index >= m_workers.size() || !m_workers[index]->worker()) {
+        return;
+    }
+
+    auto &allocator = doc.GetAllocator();
+    auto worker     = static_cast<const OclWorker *>(m_workers[index]->worker());
+
+    rapidjson::Value bounds(rapidjson::kArrayType);
+    rapidjson::Value counts(rapidjson::kArrayType);
+    for (size_t i = 0; i < OclWorker::kBatchBuckets; ++i) {
+        if (i + 1 < OclWorker::kBatchBuckets) {
+            bounds.PushBack(OclWorker::batchBound(i), allocator);
+        }
+
+        counts.PushBack(worker->batchCount(i), allocator);
+    }
+
+    rapidjson::Value batches(rapidjson::kObjectType);
+    batches.AddMember("le_ms", bounds, allocator);
+    batches.AddMember("counts", counts, allocator);
+    batches.AddMember("sum_ms", worker->batchSum() / 1000000, allocator);
+
+    const double cv = m_hashrate ? m_hashrate->stability(index) : nan("");
+    const auto it   = m_watchdog.find(index);
+
+    thread.AddMember("batch_time", batches, allocator);
+    thread.AddMember("stalls", worker->stalls(), allocator);
+    thread.AddMember("restarts", it != m_watchdog.end() ? it->second.restarts : 0, allocator);
+    thread.AddMember("cv", std::isnan(cv) ? rapidjson::Value(rapidjson::kNullType) : rapidjson::Value(floor(cv * 10000.0) / 10000.0), allocator);
+}
+
+
+// histogram of the time from setJob to the GPU thread running the job, counts[i] are jobs
+// that took less than le_ms[i] (the last bucket has no bound) and the hashes done on outdated jobs
+void Workers::threadLatency(size_t index, rapidjson::Value &thread, rapidjson::Document &doc)
+{
+    if (index >= m_workers.size() || !m_workers[index]->worker()) {
+        return;
+    }
+
+    auto &allocator = doc.GetAllocator();
+    auto worker     = static_cast<const OclWorker *>(m_workers[index]->worker());
+
+    rapidjson::Value bounds(rapidjson::kArrayType);
+    rapidjson::Value counts(rapidjson::kArrayType);
+    for (size_t i = 0; i < OclWorker::kLatencyBuckets; ++i) {
+        if (i + 1 < OclWorker::kLatencyBuckets) {
+            bounds.PushBack(OclWorker::latencyBound(i), allocator);
+        }
+
+        counts.PushBack(worker->latencyCount(i), allocator);
+    }
+
+    rapidjson::Value latency(rapidjson::kObjectType);
+    latency.AddMember("le_ms", bounds, allocator);
+    latency.AddMember("counts", counts, allocator);
+
+    thread.AddMember("job_latency", latency, allocator);
+    thread.AddMember("stale_hashes", worker->staleHashes(), allocator);
+    thread.AddMember("lost_results", worker->lostResults(), allocator);
+}
+
+
+// huge pages and size of the scratchpads of all CPU hashing threads in total and per thread with its NUMA node
+void Workers::threadsSummary(rapidjson::Document &doc)
+{
+    using namespace rapidjson;
+    auto &allocator = doc.GetAllocator();
+
+    uint64_t pages[2] = { 0, 0 };
+    uint64_t memory   = 0;
+    Value pools(kArrayType);
+
+    uv_mutex_lock(&m_mutex);
+    for (const MemoryPool &pool : m_memory) {
+        Value hugepages(kArrayType);
+        hugepages.PushBack(static_cast<uint64_t>(pool.hugePages), allocator);
+        hugepages.PushBack(static_cast<uint64_t>(pool.pages), allocator);
+
+        Value value(kObjectType);
+        value.AddMember("type", StringRef(pool.type), allocator);
+        value.AddMember("index", static_cast<uint64_t>(pool.index), allocator);
+        value.AddMember("node", pool.node, allocator);
+        value.AddMember("hugepages", hugepages, allocator);
+        value.AddMember("memory", static_cast<uint64_t>(pool.size), allocator);
+        pools.PushBack(value, allocator);
+
+        pages[0] += pool.hugePages;
+        pages[1] += pool.pages;
+        memory   += pool.size;
+    }
+    uv_mutex_unlock(&m_mutex);
+
+    Value hugepages(kArrayType);
+    hugepages.PushBack(pages[0], allocator);
+    hugepages.PushBack(pages[1], allocator);
+
+    doc.AddMember("hugepages", hugepages, allocator);
+    doc.AddMember("memory", memory, allocator);
+    doc.AddMember("memory_pools", pools, allocator);
+    doc.AddMember("parked", m_parked, allocator);
+    doc.AddMember("unpark_ms", m_unparkTime, allocator);
+}
+#endif
+
+
+void Workers::onReady(void *arg)
+{
+    auto handle = static_cast<Handle*>(arg);
+
+    if (handle->isPending() && !initThread(handle)) {
+        return;
+    }
+
+    IWorker *worker = new OclWorker(handle);
+    handle->setWorker(worker);
+
+    start(worker);
+}
+
+
+void Workers::onResult(uv_async_t *handle)
+{
+    xmrig::Trace::Span span("onResult");
+    xmrig::LoopMonitor::Scope scope(xmrig::LoopMonitor::JobResult);
+
+    ShareRecord share;
+    while (m_results.pop(share)) {
+        verify(std::move(share));
+    }
+
+    const uint64_t dropped = m_dropped.exchange(0, std::memory_order_relaxed);
+    if (dropped) {
+        LOG_ERR("%" PRIu64 " GPU result(s) dropped", dropped);
+    }
+
+    std::list<VerifiedResult> verified;
+
+    uv_mutex_lock(&m_mutex);
+    verified.swap(m_verified);
+    uv_mutex_unlock(&m_mutex);
+
+    std::map<int, int> errors;
+    for (const VerifiedResult &result : verified) {
+        // deferred results were already submitted with the GPU hash, they only feed the error rate
+        if (result.valid && !result.deferred && !result.submitted) {
+            m_listener->onJobResult(jobResult(result.share));
+        }
+        else if (!result.valid) {
+            errors[result.share.threadId]++;
+        }
+
+        if (result.share.job->poolId() != -100 && static_cast<size_t>(result.share.threadId) < m_workers.size()) {
+            DeviceErrors &device = m_deviceErrors[m_workers[result.share.threadId]->ctx()->deviceIdx];
+            device.checked++;
+            device.compute += result.valid ? 0 : 1;
+        }
+        else if (static_cast<size_t>(result.share.threadId) < m_workers.size()) {
+            BenchResults &bench = m_benchResults[m_workers[result.share.threadId]->ctx()->deviceIdx];
+            bench.checked++;
+            bench.invalid += result.valid ? 0 : 1;
+        }
+
+        if ((result.deferred || m_verifySample == 1) && result.share.job->poolId() != -100) {
+            updateErrorRate(result.share.threadId, result.valid);
+        }
+    }
+
+    for (const auto &error : errors) {
+        LOG_ERR("THREAD #%d COMPUTE ERROR(s): %i", error.first, error.second);
+    }
+}
+
+
+// the thread builds the program and buffers of its GPU and starts hashing as soon as they are ready, a GPU which fails
+// is tried again with growing pauses while the other GPUs mine, false if the thread was stopped before
+bool Workers::initThread(Handle *handle)
+{
+    static const uint64_t kRetryPause    = 30 * 1000;
+    static const uint64_t kMaxRetryPause = 10 * 60 * 1000;
+
+    GpuContext *ctx        = handle->ctx();
+    xmrig::Config *config  = m_controller->config();
+    const int index        = static_cast<int>(handle->threadId());
+    const size_t intensity = ctx->rawIntensity;
+
+    // the slot of the thread in the arena of its GPU
+    size_t slot = 0;
+    for (size_t i = 0; i < handle->threadId(); ++i) {
+        if (m_workers[i]->ctx()->deviceIdx == ctx->deviceIdx) {
+            slot++;
+        }
+    }
+
+    std::mutex &device = *m_deviceInit.at(ctx->deviceIdx);
+    size_t result      = OCL_ERR_SUCCESS;
+
+    {
+        std::lock_guard<std::mutex> lock(device);
+        result = InitOpenCLThread(ctx, index, slot, config);
+    }
+
+    m_starting--;
+
+    uint64_t pause    = kRetryPause;
+    uint32_t attempts = 1;
+
+    while (result != OCL_ERR_SUCCESS) {
+        LOG_ERR("Thread #%d: initialization of GPU #%zu failed, next attempt in %" PRIu64 " s", index, ctx->deviceIdx, pause / 1000);
+
+        for (uint64_t waited = 0; waited < pause; waited += 100) {
+            if (handle->isStopping() || sequence() == 0) {
+                return false;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+
+        std::lock_guard<std::mutex> lock(device);
+        result = RestartOpenCL(ctx, index, slot, config);
+        pause  = std::min(pause * 2, kMaxRetryPause);
+        attempts++;
+    }
+
+    if (ctx->rawIntensity < intensity) {
+        LOG_WARN("Thread #%d: intensity %zu of GPU #%zu doesn't fit in memory, %zu is used for %s from now on",
+                 index, intensity, ctx->deviceIdx, ctx->rawIntensity, xmrig::Algorithm::perfAlgoName(config->algorithm().perf_algo()));
+        m_lowered = true;
+    }
+
+    if (attempts > 1) {
+        LOG_INFO("Thread #%d: GPU #%zu initialized at attempt %u", index, ctx->deviceIdx, attempts);
+    }
+
+    handle->setPending(false);
+    return true;
+}
+
+
+xmrig::JobResult Workers::jobResult(const ShareRecord &share)
+{
+    const xmrig::Job &job = *share.job;
+
+    xmrig::JobResult result(job.poolId(), job.id(), job.clientId(), share.nonce, share.hash, job.diff(), job.algorithm(), share.threadId);
+    if (job.hasExtraNonce()) {
+        result.setExtraNonce(job);
+    }
+
+    return result;
+}
+
+
+// called by the verification threads, sampled shares still go through onResult, the error rates are kept there
+void Workers::submitDirect(std::list<VerifiedResult> &batch)
+{
+    xmrig::IJobResultListener *direct = m_direct;
+    if (!direct) {
+        return;
+    }
+
+    for (VerifiedResult &verified : batch) {
+        if (verified.valid && !verified.deferred) {
+            direct->onJobResult(jobResult(verified.share));
+            verified.submitted = true;
+        }
+    }
+}
+
+
+// in sample mode the GPU hash is submitted as is and only every m_verifySample
+// result of a thread is verified on CPU after the fact
+void Workers::verify(ShareRecord &&share)
+{
+    if (share.threadId < 0) {
+        m_listener->onJobResult(jobResult(share));
+        return;
+    }
+
+    VerifyStats &stats = m_verifyStats[share.threadId];
+    const bool sampled = m_verifySample > 1 && !stats.full && share.job->poolId() != -100;
+
+    if (sampled) {
+        m_listener->onJobResult(jobResult(share));
+
+        if (stats.submitted++ % m_verifySample != 0) {
+            return;
+        }
+    }
+
+    const xmrig::Job &job = *share.job;
+    const bool gpu        = m_verifyGpu && job.poolId() != -100 && job.algorithm().variant() == xmrig::VARIANT_GPU;
+
+    uv_mutex_lock(&m_mutex);
+
+    if (gpu) {
+        m_gpuQueue.emplace_back(std::move(share), sampled);
+        uv_cond_signal(&m_verifyGpuCond);
+    }
+    else {
+        m_queue.emplace_back(std::move(share), sampled);
+        uv_cond_signal(&m_verifyCond);
+    }
+
+    uv_mutex_unlock(&m_mutex);
+}
+
+
+void Workers::updateErrorRate(int threadId, bool valid)
+{
+    static const uint32_t kWindow = 16;
+
+    VerifyStats &stats = m_verifyStats[threadId];
+    stats.checked++;
+    stats.errors += valid ? 0 : 1;
+
+    if (stats.checked < kWindow) {
+        return;
+    }
+
+    const uint32_t rate     = stats.errors * 100 / stats.checked;
+    const bool fallback     = rate >= m_verifyThreshold && m_verifySample > 1 && !stats.full;
+    stats.full             |= fallback;
+    stats.checked           = 0;
+    stats.errors            = 0;
+
+    if (rate >= m_verifyThreshold) {
+        LOG_WARN("THREAD #%d GPU ERROR RATE %u%% IS ABOVE %u%%%s", threadId, rate, m_verifyThreshold, fallback ? ", SWITCHING TO FULL CPU VERIFICATION" : "");
+        applyErrorAction(threadId, rate);
+    }
+}
+
+
+// verification context is kept for the thread life, it is sized for the largest algorithm so any job fits
+void Workers::verifyThread(size_t index, int64_t cpu, int priority)
+{
+    if (cpu >= 0) {
+        Platform::setThreadAffinity(static_cast<uint64_t>(cpu));
+    }
+
+    Platform::setThreadPriority(priority);
+
+    cryptonight_ctx *ctx[CryptoNight::kMaxWays];
+    MemInfo info = Mem::create(ctx, xmrig::CRYPTONIGHT_HEAVY, CryptoNight::kMaxWays);
+    addMemory("verify", index, info);
+
+    xmrig::Trace::setThreadName("verify");
+
+    uv_mutex_lock(&m_mutex);
+
+    for (;;) {
+        while (m_queue.empty() && !m_verifyStop) {
+            uv_cond_wait(&m_verifyCond, &m_mutex);
+        }
+
+        if (m_verifyStop) {
+            break;
+        }
+
+        // a burst of results of the same algorithm and height is verified with one multi-hash call
+        std::list<VerifiedResult> batch;
+        batch.splice(batch.end(), m_queue, m_queue.begin());
+
+        const xmrig::Job &first = *batch.front().share.job;
+        if (first.poolId() != -100) {
+            for (auto it = m_queue.begin(); it != m_queue.end() && batch.size() < CryptoNight::kMaxWays;) {
+                const xmrig::Job &job = *it->share.job;
+
+                if (job.poolId() != -100 && CryptoNight::isSameHash(first, job)) {
+                    batch.splice(batch.end(), m_queue, it++);
+                }
+                else {
+                    ++it;
+                }
+            }
+        }
+
+        uv_mutex_unlock(&m_mutex);
+
+        // results of a variant failing its CPU self-test can't be checked, they keep the GPU hash
+        if (first.poolId() == -100 || !CryptoNight::selfTest(first.algorithm().algo(), first.algorithm().variant())) {
+            for (VerifiedResult &verified : batch) {
+                verified.valid = true;
+            }
+        }
+        else {
+            const xmrig::Job *jobs[CryptoNight::kMaxWays];
+            uint32_t nonces[CryptoNight::kMaxWays];
+            uint8_t hashes[32 * CryptoNight::kMaxWays];
+            size_t count = 0;
+
+            for (const VerifiedResult &verified : batch) {
+                jobs[count]   = verified.share.job.get();
+                nonces[count] = verified.share.nonce;
+                count++;
+            }
+
+            xmrig::Trace::Span span("verify", static_cast<int64_t>(count));
+            CryptoNight::hash(jobs, nonces, count, hashes, ctx);
+
+            const uint8_t *hash = hashes;
+            for (VerifiedResult &verified : batch) {
+                ShareRecord &share = verified.share;
+                verified.valid     = *reinterpret_cast<const uint64_t*>(hash + 24) < share.job->target();
+
+                // a deferred result is accepted by the pool only if the GPU got the same hash
+                if (verified.deferred) {
+                    verified.valid = verified.valid && memcmp(hash, share.hash, sizeof(share.hash)) == 0;
+                }
+                else {
+                    memcpy(share.hash, hash, sizeof(share.hash));
+                }
+
+                hash += 32;
+            }
+        }
+
+        submitDirect(batch);
+
+        uv_mutex_lock(&m_mutex);
+        m_verified.splice(m_verified.end(), batch);
+        uv_async_send(&m_async);
+    }
+
+    uv_mutex_unlock(&m_mutex);
+
+    Mem::release(ctx, CryptoNight::kMaxWays, info);
+}
+
+
+// --verify-gpu: a cn/gpu context of its own on the GPU, with the settings of the first cn/gpu thread there and the
+// smallest batch, made before the mining threads start like the dual threads
+bool Workers::startVerifyGpu(xmrig::Config *config)
+{
+    const size_t index = static_cast<size_t>(config->verifyGpu());
+    const xmrig::OclThread *src = nullptr;
+
+    for (const xmrig::IThread *thread : config->threads(xmrig::PA_CN_GPU)) {
+        if (thread->index() == index) {
+            src = static_cast<const xmrig::OclThread *>(thread);
+            break;
+        }
+    }
+
+    if (!src) {
+        LOG_ERR("--verify-gpu: no cn/gpu thread on GPU #%zu, results are verified on CPU", index);
+        return false;
+    }
+
+    // one work group per batch, the checks come one share at a time next to the mining threads
+    GpuContext *ctx = new GpuContext();
+    xmrig::OclKernelBench::baseContext(src->ctx(), ctx);
+    ctx->rawIntensity = ctx->workSize;
+    ctx->pipeline     = false;
+    ctx->persistent   = false;
+
+    const xmrig::Algorithm algorithm = config->algorithm();
+    config->set_algorithm(xmrig::Algorithm(xmrig::CRYPTONIGHT, xmrig::VARIANT_GPU));
+    const size_t ret = InitOpenCL(std::vector<GpuContext *>(1, ctx), config, &m_verifyGpuContexts);
+    config->set_algorithm(algorithm);
+
+    if (ret != OCL_ERR_SUCCESS) {
+        LOG_ERR("--verify-gpu: GPU #%zu failed to start, results are verified on CPU", index);
+        ReleaseOpenCl(ctx);
+        ReleaseOpenClContexts(m_verifyGpuContexts);
+        delete ctx;
+        return false;
+    }
+
+    m_verifyGpu = ctx;
+    LOG_INFO("cn/gpu results are verified on GPU #%zu", index);
+
+    return true;
+}
+
+
+// the kernels put the nonce of the work item at offset 39, so the first item of a batch started at the nonce of the
+// result computes its hash, the target is the top of the GPU hash so the nonce comes back if the hash is not higher
+static bool verifyGpuHash(GpuContext *ctx, const xmrig::Job &job, uint32_t nonce, const uint8_t *hash)
+{
+    uint8_t blob[xmrig::Job::kMaxBlobSize];
+    memcpy(blob, job.blob(), sizeof(blob));
+
+    uint64_t target = 0;
+    memcpy(&target, hash + 24, sizeof(target));
+
+    if (XMRSetJob(ctx, blob, job.size(), target, job.algorithm().variant(), job.height()) != OCL_ERR_SUCCESS) {
+        return false;
+    }
+
+    cl_uint results[OCL_RESULT_SIZE];
+    ctx->Nonce = nonce;
+
+    if (XMRRunJob(ctx, results, job.algorithm().variant(), ctx->rawIntensity) != OCL_ERR_SUCCESS) {
+        return false;
+    }
+
+    for (size_t i = 0; i < results[OCL_RESULT_SLOTS]; ++i) {
+        if (results[i] == nonce) {
+            return memcmp(results + OCL_RESULT_HASHES + i * 8, hash, 32) == 0;
+        }
+    }
+
+    return false;
+}
+
+
+// a result whose hash the verification GPU repeats is settled, the CPU gets the ones it doesn't and every
+// kCpuSample-th of the others, so a faulty verification GPU shows up in the error rates as well
+void Workers::verifyGpuThread(int priority)
+{
+    static const uint64_t kCpuSample = 32;
+
+    Platform::setThreadPriority(priority);
+    xmrig::Trace::setThreadName("verify gpu");
+
+    uint64_t agreed = 0;
+
+    uv_mutex_lock(&m_mutex);
+
+    for (;;) {
+        while (m_gpuQueue.empty() && !m_verifyStop) {
+            uv_cond_wait(&m_verifyGpuCond, &m_mutex);
+        }
+
+        if (m_verifyStop) {
+            break;
+        }
+
+        std::list<VerifiedResult> batch;
+        batch.splice(batch.end(), m_gpuQueue, m_gpuQueue.begin());
+
+        uv_mutex_unlock(&m_mutex);
+
+        VerifiedResult &verified = batch.front();
+        const ShareRecord &share = verified.share;
+        bool same                = false;
+
+        {
+            xmrig::Trace::Span span("verify gpu", static_cast<int64_t>(m_verifyGpu->deviceIdx));
+            same = verifyGpuHash(m_verifyGpu, *share.job, share.nonce, share.hash);
+        }
+
+        same = same && ++agreed % kCpuSample != 0;
+        if (same) {
+            verified.valid = *reinterpret_cast<const uint64_t*>(share.hash + 24) < share.job->target();
+        }
+
+        if (same) {
+            submitDirect(batch);
+        }
+
+        uv_mutex_lock(&m_mutex);
+
+        if (same) {
+            m_verified.splice(m_verified.end(), batch);
+            uv_async_send(&m_async);
+        }
+        else {
+            m_queue.splice(m_queue.end(), batch);
+            uv_cond_signal(&m_verifyCond);
+        }
+    }
+
+    uv_mutex_unlock(&m_mutex);
+}
+
+
+// average time between jobs of the pool that sent the current job, used by --stale-target,
+// gaps of more than 10 minutes are reconnects and are not counted
+void Workers::updateJobInterval(int poolId, uint64_t now)
+{
+    static const uint64_t kMaxInterval = 600ULL * 1000 * 1000 * 1000;
+
+    JobArrival &arrival = m_arrivals[poolId];
+
+    if (arrival.last && now - arrival.last < kMaxInterval) {
+        const uint64_t interval = now - arrival.last;
+        arrival.interval = arrival.interval ? (arrival.interval * 3 + interval) / 4 : interval;
+    }
+
+    arrival.last = now;
+    m_jobInterval.store(arrival.interval, std::memory_order_relaxed);
+}
+
+
+// --park-after: minutes after the pools were lost, once all GPU threads wait in waitResume, their buffers are released,
+// a pause of the user (setEnabled) keeps them as the pools are still there
+void Workers::updatePark()
+{
+    if (m_parkAfter == 0 || m_active || !isPaused()) {
+        m_pausedSince = 0;
+        return;
+    }
+
+    const uint64_t now = uv_now(uv_default_loop());
+    if (m_pausedSince == 0) {
+        m_pausedSince = now;
+    }
+
+    if (!m_parked && now - m_pausedSince >= m_parkAfter * 60000ULL && m_waiting.load() == m_workers.size()) {
+        park();
+    }
+}
+
+
+void Workers::park()
+{
+    std::vector<GpuContext *> contexts;
+    for (Handle *handle : m_workers) {
+        contexts.push_back(handle->ctx());
+    }
+
+    const int64_t start = xmrig::steadyTimestamp();
+    ParkOpenCL(contexts);
+    m_parked = true;
+
+    LOG_INFO("GPUs parked after %u minutes without pools, memory released in %" PRId64 " ms", m_parkAfter, xmrig::steadyTimestamp() - start);
+}
+
+
+// called on the loop before the GPU threads are woken up or restarted, the time to the first batch of the next job
+// is this plus a normal job switch, so it is the price of a park against the idle power of allocated memory
+void Workers::unpark()
+{
+    if (!m_parked) {
+        return;
+    }
+
+    std::vector<GpuContext *> contexts;
+    for (Handle *handle : m_workers) {
+        contexts.push_back(handle->ctx());
+    }
+
+    const int64_t start = xmrig::steadyTimestamp();
+    m_parked = false;
+
+    // the threads fail their batches and the watchdog restarts them
+    if (UnparkOpenCL(contexts, m_controller->config()) != OCL_ERR_SUCCESS) {
+        LOG_ERR("GPUs unpark failed");
+        return;
+    }
+
+    m_unparkTime = xmrig::steadyTimestamp() - start;
+
+    LOG_INFO("GPUs unparked, memory allocated again in %" PRId64 " ms", m_unparkTime);
+}
+
+
+// idle GPU time of a pool driven algo switch: from its start until the last GPU thread finished a batch of the job,
+// averaged over the switches of each algo pair, a job that replaces that job first or a stuck thread drops the sample
+void Workers::updateSwitchCost()
+{
+    static const uint64_t kTimeout = 60ULL * 1000 * 1000 * 1000;
+
+    if (!m_pendingSwitch.published) {
+        return;
+    }
+
+    const uint64_t now = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    if (job()->published != m_pendingSwitch.published || now - m_pendingSwitch.start > kTimeout) {
+        m_pendingSwitch = PendingSwitch();
+        return;
+    }
+
+    uint64_t last = 0;
+    for (size_t i = 0; i < m_workers.size(); ++i) {
+        const uint64_t first = firstBatch(i, m_pendingSwitch.published);
+        if (first == 0) {
+            return;
+        }
+
+        last = std::max(last, first);
+    }
+
+    const uint32_t cost = static_cast<uint32_t>((last - m_pendingSwitch.start) / 1000000);
+    uint32_t &average   = m_switchCost[m_pendingSwitch.from][m_pendingSwitch.to];
+    average             = average ? (average * 3 + cost) / 4 : cost;
+
+    m_pendingSwitch = PendingSwitch();
+}
+
+
+// m_paused is changed before the mutex is taken, so a thread that has just seen the old state
+// is already waiting on the condition and gets the broadcast
+void Workers::wakeup()
+{
+    uv_mutex_lock(&m_pauseMutex);
+    uv_cond_broadcast(&m_pauseCond);
+    uv_mutex_unlock(&m_pauseMutex);
+}
+
+
+void Workers::onTick(uv_timer_t *handle)
+{
+    for (Handle *handle : m_workers) {
+        // the thread still initializes its GPU
+        if (!handle->worker()) {
+            continue;
+        }
+
+        m_hashrate->add(handle->threadId(), handle->worker()->hashCount(), handle->worker()->timestamp());
+    }
+
+    for (size_t j = 0; j < m_cpuWorkers.size(); ++j) {
+        m_hashrate->add(m_threadsCount + j, m_cpuWorkers[j]->hashCount(), m_cpuWorkers[j]->timestamp());
+    }
+
+    if ((m_ticks++ & 0xF) == 0)  {
+        m_hashrate->updateHighest();
+        m_hashrate->updateStability();
+    }
+
+    if (m_dual) {
+        m_dual->tick();
+    }
+
+    updateSwitchCost();
+
+    // a thread lowered its intensity to fit in memory, the config keeps it for this perf algo
+    if (m_lowered.exchange(false)) {
+        m_controller->config()->setShouldSave();
+
+        if (m_controller->config()->isShouldSave()) {
+            m_controller->config()->save();
+        }
+    }
+
+    // sensors every 2 seconds, reading power from the driver is not free
+    if ((m_ticks & 3) == 0) {
+        GpuTelemetry::update(m_controller->config()->desktopDuty() > 0);
+        updateThermal();
+        updateDuty();
+        watchdog();
+        updatePark();
+    }
+
+    if ((m_ticks & 1) == 0 && xmrig::StatsSegment::isOpen()) {
+        publishStats();
+    }
+
+    if ((m_ticks & 1) == 0) {
+        sampleHistory();
+
+        // for the logins and the profit switch of the pool connections
+        xmrig::PerfSnapshot::publish(m_controller->config());
+    }
+
+    if (m_ticks % 20 == 0) {
+        updateEffective();
+    }
+
+#   ifndef XMRIG_NO_API
+    // once per second for the subscribers of /1/events
+    if ((m_ticks & 1) == 0 && EventStream::isActive()) {
+        EventStream::hashrate(m_hashrate);
+    }
+#   endif
+
+    // once per minute of 500 ms ticks
+    if (m_ticks % 120 == 0) {
+        if (m_controller->config()->isRecalibrateAlgo()) {
+            updateAlgoPerf();
+        }
+
+        xmrig::RuntimeState::save(m_controller->config());
+
+        if (!isPaused()) {
+            sampleCanary();
+        }
+    }
+}
+
+
+// hashes of the GPU threads for the effective hashrate every 10 s, the time on benchmark jobs or paused is left out
+void Workers::updateEffective()
+{
+    for (Handle *handle : m_workers) {
+        if (handle->worker()) {
+            xmrig::EffectiveRate::addHashes(handle->threadId(), handle->ctx()->deviceIdx, handle->worker()->hashCount());
+        }
+    }
+
+    xmrig::EffectiveRate::update(!isPaused() && job()->poolId() != -100, m_controller->config()->isColors());
+}
+
+
+// one sample per minute of each GPU whose threads all carry the same "canary" group
+void Workers::sampleCanary()
+{
+    std::map<size_t, char> groups;
+    for (const xmrig::IThread *thread : m_controller->config()->threads()) {
+        const char canary = static_cast<const xmrig::OclThread *>(thread)->canary();
+        const auto it     = groups.insert(std::make_pair(thread->index(), canary)).first;
+
+        if (it->second != canary) {
+            it->second = 0;
+        }
+    }
+
+    bool labelled = false;
+    for (const auto &kv : groups) {
+        labelled |= kv.second != 0;
+    }
+
+    if (!labelled) {
+        return;
+    }
+
+    xmrig::Canary::tick(m_hashrate->algo(), m_controller->config()->canaryWindow(), m_controller->config()->isColors());
+
+    for (const auto &kv : groups) {
+        const double hashrate = m_hashrate->calcDevice(kv.first, Hashrate::MediumInterval);
+        if (!kv.second || !std::isnormal(hashrate)) {
+            continue;
+        }
+
+        const auto errors = m_deviceErrors.find(kv.first);
+        const bool found  = errors != m_deviceErrors.end();
+
+        xmrig::Canary::add(kv.second, kv.first, hashrate, GpuTelemetry::sensors(kv.first).hashesPerJoule(hashrate),
+                           found ? errors->second.checked : 0, found ? errors->second.compute : 0);
+    }
+}
+
+
+// one sample per second for /1/history with the 10s hashrates, devices past the table of a sample are left out
+void Workers::sampleHistory()
+{
+    using xmrig::History;
+
+    static History::Sample sample;
+    memset(&sample, 0, sizeof(sample));
+
+    const std::vector<size_t> devices = m_hashrate->devices();
+
+    sample.algo     = static_cast<int32_t>(m_hashrate->algo());
+    sample.devices  = static_cast<uint32_t>(std::min(devices.size(), History::kMaxDevices));
+    sample.hashrate = static_cast<float>(m_hashrate->calc(Hashrate::ShortInterval));
+
+    for (size_t i = 0; i < sample.devices; ++i) {
+        History::Device &device  = sample.device[i];
+        const GpuSensors sensors = GpuTelemetry::sensors(devices[i]);
+        const double hashrate    = m_hashrate->calcDevice(devices[i], Hashrate::ShortInterval);
+
+        device.index       = static_cast<uint32_t>(devices[i]);
+        device.hashrate    = std::isnormal(hashrate) ? static_cast<float>(hashrate) : 0.0f;
+        device.temperature = static_cast<float>(sensors.temperature);
+
+        const auto errors = m_deviceErrors.find(devices[i]);
+        if (errors != m_deviceErrors.end()) {
+            device.rejected = static_cast<uint32_t>(errors->second.rejected);
+        }
+    }
+
+    if (!std::isnormal(sample.hashrate)) {
+        sample.hashrate = 0.0f;
+    }
+
+    History::add(sample);
+}
+
+
+// snapshot of --stats-shm, threads and devices past the fixed tables of the segment are left out
+void Workers::publishStats()
+{
+    using xmrig::StatsSegment;
+
+    static StatsSegment::Data data;
+    memset(&data, 0, sizeof(data));
+
+    const size_t intervals[3] = { Hashrate::ShortInterval, Hashrate::MediumInterval, Hashrate::LargeInterval };
+    const std::vector<size_t> devices = m_hashrate->devices();
+
+    data.state   = (isPaused() ? StatsSegment::MinerPaused : 0) | (m_parked ? StatsSegment::MinerParked : 0) | (m_enabled ? 0 : StatsSegment::MinerDisabled);
+    data.algo    = static_cast<uint32_t>(m_hashrate->algo());
+    data.threads = static_cast<uint32_t>(std::min(m_hashrate->threads(), StatsSegment::kMaxThreads));
+    data.devices = static_cast<uint32_t>(std::min(devices.size(), StatsSegment::kMaxDevices));
+    data.highest = m_hashrate->highest();
+
+    for (size_t i = 0; i < 3; ++i) {
+        data.hashrate[i] = m_hashrate->calc(intervals[i]);
+    }
+
+    for (size_t threadId = 0; threadId < data.threads; ++threadId) {
+        StatsSegment::Thread &thread = data.thread[threadId];
+        const bool gpu               = threadId < m_workers.size();
+
+        thread.device = gpu ? static_cast<uint32_t>(m_workers[threadId]->ctx()->deviceIdx) : 0xFFFFFFFF;
+        thread.hashes = gpu ? hashCount(threadId) : 0;
+
+        if (!gpu && threadId - m_workers.size() < m_cpuWorkers.size()) {
+            thread.hashes = m_cpuWorkers[threadId - m_workers.size()]->hashCount();
+        }
+
+        const auto watchdog = m_watchdog.find(threadId);
+        if (watchdog != m_watchdog.end() && watchdog->second.stopped) {
+            thread.state |= StatsSegment::ThreadStopped;
+        }
+
+        for (size_t i = 0; i < 3; ++i) {
+            thread.hashrate[i] = m_hashrate->calc(threadId, intervals[i]);
+        }
+    }
+
+    for (size_t i = 0; i < data.devices; ++i) {
+        StatsSegment::Device &device = data.device[i];
+        const GpuSensors sensors     = GpuTelemetry::sensors(devices[i]);
+
+        device.index       = static_cast<uint32_t>(devices[i]);
+        device.temperature = sensors.temperature;
+        device.power       = sensors.power;
+        device.fan         = sensors.fan;
+        device.clock       = sensors.clock;
+        device.memoryClock = sensors.memoryClock;
+        device.duty        = 1000;
+
+        for (size_t j = 0; j < 3; ++j) {
+            device.hashrate[j] = m_hashrate->calcDevice(devices[i], intervals[j]);
+        }
+
+        const auto thermal = m_thermal.find(devices[i]);
+        if (thermal != m_thermal.end()) {
+            device.duty   = thermal->second.duty;
+            device.state |= thermal->second.throttled ? StatsSegment::DeviceThrottled : 0;
+        }
+
+        const auto errors = m_deviceErrors.find(devices[i]);
+        if (errors != m_deviceErrors.end()) {
+            device.computeErrors = errors->second.compute;
+            device.rejected      = errors->second.rejected;
+            device.state        |= errors->second.disabled ? StatsSegment::DeviceDisabled : 0;
+        }
+    }
+
+    StatsSegment::publish(data);
+}
+
+
+// one step of the duty cycle of each GPU with sensors every 2 seconds: the error is the distance above the
+// target in units of 2 C or 5% of the power target, the duty drops by up to 10% per step above the target
+// and recovers by up to 5% well below it, so the slow thermal response settles instead of oscillating
+void Workers::updateThermal()
+{
+    const uint32_t tempTarget  = m_controller->config()->tempTarget();
+    const uint32_t powerTarget = m_controller->config()->powerTarget();
+    const bool isColors        = m_controller->config()->isColors();
+
+    for (size_t device : m_hashrate->devices()) {
+        const GpuSensors sensors = GpuTelemetry::sensors(device);
+        if (!sensors.isValid()) {
+            continue;
+        }
+
+        ThermalControl &control = m_thermal[device];
+
+        // a shader clock far below the highest one seen at full duty means the driver is holding the GPU back
+        if (sensors.clock > 0 && !isPaused()) {
+            control.maxClock     = std::max(control.maxClock, sensors.clock);
+            const bool throttled = control.duty == 1000 && sensors.clock * 10 < control.maxClock * 8;
+
+            if (throttled && !control.throttled) {
+                LOG_WARN("%sGPU #%zu: shader clock is down to %d MHz from %d MHz at %.0f C, the driver is throttling, consider --temp-target or --power-target",
+                         isColors ? "\x1B[1;33m" : "", device, sensors.clock, control.maxClock, sensors.temperature);
+            }
+
+            control.throttled = throttled;
+        }
+
+        double error = 0.0;
+        bool active  = false;
+
+        if (tempTarget && sensors.temperature >= 0.0) {
+            error  = (sensors.temperature - tempTarget) / 2.0;
+            active = true;
+        }
+
+        if (powerTarget && sensors.power > 0.0) {
+            const double powerError = (sensors.power - powerTarget) / (powerTarget * 0.05);
+            error  = active ? std::max(error, powerError) : powerError;
+            active = true;
+        }
+
+        int step = 0;
+        if (active && error > 0.5) {
+            step = -std::min(100, static_cast<int>(error * 20.0));
+        }
+        else if (active && error < -1.0) {
+            step = std::min(50, static_cast<int>(-error * 10.0));
+        }
+        else if (!active) {
+            step = 1000;
+        }
+
+        const uint32_t duty = static_cast<uint32_t>(std::max(250, std::min(1000, static_cast<int>(control.duty) + step)));
+        if (duty != control.duty) {
+            LOG_DEBUG("GPU #%zu: duty %.1f%% at %.0f C %.1f W", device, duty / 10.0, sensors.temperature, sensors.power);
+            control.duty = duty;
+        }
+
+        // the 10s hashrate follows duty changes within a few steps
+        const double efficiency = sensors.hashesPerJoule(m_hashrate->calcDevice(device, Hashrate::ShortInterval));
+        if (efficiency > control.bestEfficiency) {
+            control.bestEfficiency = efficiency;
+            control.bestDuty       = control.duty;
+        }
+    }
+}
+
+
+// the desktop is in use while there was input within --desktop-idle seconds or other processes keep the graphics
+// engine of the GPU busy for more than 3% of the time, meanwhile the GPU gets at most --desktop-duty of the time
+// in short batches, the workers run at the lower one of that and the duty of the thermal control
+void Workers::updateDuty()
+{
+    const uint32_t desktopDuty = m_controller->config()->desktopDuty() * 10;
+    const uint64_t idle        = m_controller->config()->desktopIdle() * 1000ULL;
+    const uint64_t now         = static_cast<uint64_t>(xmrig::currentMSecsSinceEpoch());
+    const int64_t input        = desktopDuty ? Platform::inputIdleTime() : -1;
+
+    for (size_t device : m_hashrate->devices()) {
+        if (!desktopDuty && m_thermal.find(device) == m_thermal.end()) {
+            continue;
+        }
+
+        ThermalControl &control = m_thermal[device];
+
+        if (desktopDuty) {
+            if (input >= 0 && static_cast<uint64_t>(input) < now) {
+                control.desktopSeen = std::max(control.desktopSeen, now - static_cast<uint64_t>(input));
+            }
+
+            if (GpuTelemetry::sensors(device).clients > 0.03) {
+                control.desktopSeen = now;
+            }
+        }
+
+        const bool desktop = desktopDuty && control.desktopSeen && now - control.desktopSeen < idle;
+        if (desktop != control.desktop) {
+            if (desktop) {
+                LOG_INFO("GPU #%zu: desktop in use, duty limited to %u%%", device, desktopDuty / 10);
+            }
+            else {
+                LOG_INFO("GPU #%zu: desktop idle for %u s, back to full duty", device, m_controller->config()->desktopIdle());
+            }
+
+            control.desktop = desktop;
+        }
+
+        const uint32_t duty = desktop ? std::min(control.duty, desktopDuty) : control.duty;
+
+        for (Handle *handle : m_workers) {
+            if (handle->ctx()->deviceIdx == device && handle->worker()) {
+                OclWorker *worker = static_cast<OclWorker *>(handle->worker());
+                worker->setDuty(duty);
+                worker->setDesktop(desktop);
+            }
+        }
+    }
+}
+
+
+// a GPU thread is stalled when its hash count didn't change for 20 batch times (30 s at least) while mining,
+// it is asked to stop and restarted once it returns from the driver, a thread left with failed OpenCL calls
+// is restarted at once, a thread that never comes back can't be recovered without a restart of the miner
+void Workers::watchdog()
+{
+    const uint64_t now = static_cast<uint64_t>(xmrig::currentMSecsSinceEpoch());
+
+    for (size_t i = 0; i < m_workers.size(); ++i) {
+        Handle *handle          = m_workers[i];
+        const OclWorker *worker = static_cast<const OclWorker *>(handle->worker());
+        Watchdog &state         = m_watchdog[i];
+
+        // the restarted thread didn't create its worker yet or the recovery failed
+        if (!worker || worker == state.retired) {
+            continue;
+        }
+
+        if (worker != state.worker) {
+            state.worker  = worker;
+            state.stopped = false;
+            state.changed = 0;
+        }
+
+        if (worker->isDone() && (worker->isFailed() || state.stopped)) {
+            recover(i, now);
+            continue;
+        }
+
+        if (isPaused() || handle->worker()->hashCount() != state.count || state.changed == 0) {
+            state.count   = handle->worker()->hashCount();
+            state.changed = now;
+            continue;
+        }
+
+        const uint64_t limit = std::max<uint64_t>(30000, worker->batchTime() / 1000000 * 20);
+        if (!state.stopped && !handle->isStopping() && now - state.changed > limit) {
+            LOG_ERR("%sTHREAD #%zu: GPU #%zu stalled for %" PRIu64 " s, stopping the thread", m_controller->config()->isColors() ? "\x1B[1;31m" : "",
+                    i, handle->ctx()->deviceIdx, (now - state.changed) / 1000);
+
+            state.stopped = true;
+            handle->stop();
+        }
+    }
+}
+
+
+// the queue, buffers and kernels of the thread are created again on the shared OpenCL context while the other
+// threads keep hashing, another failure within 10 minutes lowers the intensity of the thread by a quarter
+void Workers::recover(size_t index, uint64_t now)
+{
+    const GpuContext *ctx = m_workers[index]->ctx();
+    Watchdog &state       = m_watchdog[index];
+    size_t intensity      = ctx->rawIntensity;
+
+    if (state.restarts && now - state.restarted < 10 * 60 * 1000) {
+        const size_t lower = ctx->rawIntensity * 3 / 4 / ctx->workSize * ctx->workSize;
+        if (lower >= ctx->workSize) {
+            LOG_WARN("THREAD #%zu: GPU #%zu failed again, intensity lowered from %zu to %zu", index, ctx->deviceIdx, ctx->rawIntensity, lower);
+            intensity = lower;
+        }
+    }
+
+    state.restarted = now;
+    state.restarts++;
+
+    if (restart(index, intensity)) {
+        LOG_INFO("THREAD #%zu: GPU #%zu restarted", index, ctx->deviceIdx);
+    }
+}
+
+
+// the thread is stopped and its queue, buffers and kernels are created again on the shared OpenCL context with
+// the intensity while the other threads keep hashing, the thread must not wait in waitResume
+bool Workers::restart(size_t index, size_t intensity)
+{
+    Handle *handle  = m_workers[index];
+    GpuContext *ctx = handle->ctx();
+
+    handle->stop();
+    handle->join();
+
+    m_watchdog[index].retired = handle->worker();
+    ctx->rawIntensity         = intensity;
+
+    // the slot of the thread in the arena of its GPU
+    size_t slot = 0;
+    for (size_t i = 0; i < index; ++i) {
+        if (m_workers[i]->ctx()->deviceIdx == ctx->deviceIdx) {
+            slot++;
+        }
+    }
+
+    if (RestartOpenCL(ctx, static_cast<int>(index), slot, m_controller->config()) != OCL_ERR_SUCCESS) {
+        LOG_ERR("THREAD #%zu: GPU #%zu could not be initialized again, the thread stays stopped", index, ctx->deviceIdx);
+        return false;
+    }
+
+    handle->reset(handle->config(), ctx);
+    handle->start(Workers::onReady);
+
+    return true;
+}
+
+
+// --error-action for a thread whose error rate passed the threshold, lowering the intensity by a quarter
+// below one work group disables the thread
+void Workers::applyErrorAction(int threadId, uint32_t rate)
+{
+    const xmrig::Config::ErrorAction action = m_controller->config()->errorAction();
+    if (action == xmrig::Config::ERROR_ACTION_NONE || threadId < 0 || static_cast<size_t>(threadId) >= m_workers.size() || isPaused()) {
+        return;
+    }
+
+    const size_t index = static_cast<size_t>(threadId);
+    Handle *handle     = m_workers[index];
+    GpuContext *ctx    = handle->ctx();
+
+    if (!handle->worker() || handle->worker() == m_watchdog[index].retired) {
+        return;
+    }
+
+    const size_t intensity = ctx->rawIntensity * 3 / 4 / ctx->workSize * ctx->workSize;
+    if (action == xmrig::Config::ERROR_ACTION_INTENSITY && intensity >= ctx->workSize) {
+        LOG_WARN("THREAD #%zu: GPU #%zu error rate %u%%, intensity lowered from %zu to %zu", index, ctx->deviceIdx, rate, ctx->rawIntensity, intensity);
+        m_verifyStats.erase(threadId);
+        xmrig::RuntimeState::setIntensity(m_controller->config()->algorithm().perf_algo(), index, ctx->deviceIdx, intensity);
+        restart(index, intensity);
+        return;
+    }
+
+    LOG_ERR("%sTHREAD #%zu: GPU #%zu error rate %u%%, the thread is disabled", m_controller->config()->isColors() ? "\x1B[1;31m" : "", index, ctx->deviceIdx, rate);
+
+    handle->stop();
+    handle->join();
+    m_watchdog[index].retired = handle->worker();
+    m_deviceErrors[ctx->deviceIdx].disabled = true;
+}
+
+
+// blends the hashrate measured on pool jobs into algo-perf of the current algo, so the next login reports actual values
+void Workers::updateAlgoPerf()
+{
+    if (isPaused() || job()->poolId() < 0) {
+        return;
+    }
+
+    const std::vector<xmrig::IThread *> &threads = m_controller->config()->threads();
+    if (threads.size() != m_hashrate->threads()) {
+        return;
+    }
+
+    for (size_t i = 0; i < threads.size(); ++i) {
+        if (!std::isnormal(m_hashrate->calc(i, Hashrate::MediumInterval))) {
+            return; // not a full minute of the current algo yet
+        }
+    }
+
+    std::map<size_t, double> devices;
+    for (size_t device : m_hashrate->devices()) {
+        devices[device] = m_hashrate->calcDevice(device, Hashrate::MediumInterval);
+    }
+
+    const double total = m_hashrate->calc(Hashrate::MediumInterval);
+
+    xmrig::Config *config     = m_controller->config();
+    const xmrig::PerfAlgo pa  = config->algorithm().perf_algo();
+    const float previous      = config->get_algo_perf(pa);
+    config->set_algo_perf(pa, previous > 0.0f ? previous * 0.9f + static_cast<float>(total) * 0.1f : static_cast<float>(total));
+
+    // the first thread of each GPU stands for its hardware
+    std::map<size_t, const GpuContext *> contexts;
+    for (const xmrig::IThread *thread : threads) {
+        contexts.insert(std::make_pair(thread->index(), static_cast<const xmrig::OclThread *>(thread)->ctx()));
+    }
+
+    for (const auto &device : devices) {
+        const auto it = contexts.find(device.first);
+        if (it == contexts.end()) {
+            continue;
+        }
+
+        // stale results of other hardware are not blended
+        const GpuContext *ctx       = it->second;
+        const float previous_device = config->isDeviceAlgoPerf(ctx, pa) ? config->get_device_algo_perf(device.first, pa) : 0.0f;
+        config->set_device_algo_perf(ctx, pa, previous_device > 0.0f ? previous_device * 0.9f + static_cast<float>(device.second) * 0.1f : static_cast<float>(device.second));
     }
 }
 
@@ -29,6 +29,10 @@
 
 #include <atomic>
 #include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <uv.h>
 #include <vector>
 
@@ -41,15 +45,24 @@
 #include "common/net/Job.h"
 #include "net/JobResult.h"
 #include "rapidjson/fwd.h"
+#include "workers/NonceSpace.h"
+#include "workers/ResultRing.h"
 
 
+struct MemInfo;
+
+
+class CpuWorker;
 class Handle;
 class Hashrate;
 class IWorker;
+struct GpuContext;
 
 
 namespace xmrig {
+    class Config;
     class Controller;
+    class DualMiner;
     class IJobResultListener;
 }
 
@@ -57,54 +70,304 @@ namespace xmrig {
 class Workers
 {
 public:
-    static xmrig::Job job();
+    // job as published by setJob, published is the steady clock time in ns, nonces are shared
+    // by all snapshots of the same job of a pool
+    class PublishedJob : public xmrig::Job
+    {
+    public:
+        inline PublishedJob() : published(0) {}
+        inline PublishedJob(const xmrig::Job &job, uint64_t published) : xmrig::Job(job), published(published) {}
+
+        std::shared_ptr<NonceSpace> nonces;
+        uint64_t published;
+    };
+
+    // jobs are published once by setJob and shared read only by workers and their results,
+    // the current one is swapped atomically so job() never waits for setJob
+    typedef std::shared_ptr<const PublishedJob> JobSnapshot;
+
+    // CPU verified results of benchmark jobs of a GPU, kept through restarts of the OpenCL contexts
+    struct BenchResults
+    {
+        inline BenchResults() : checked(0), invalid(0) {}
+
+        uint64_t checked;
+        uint64_t invalid;
+    };
+
+    static JobSnapshot job();
+    static JobSnapshot roll(const JobSnapshot &job, uint64_t extraNonce);
+    static void addMemory(const char *type, size_t index, const MemInfo &info);
+    static void addReject(int threadId, const char *error);
+    static void addShare(int threadId, uint32_t diff, bool accepted);
+    static BenchResults benchResults(size_t device);
+    static size_t cpuThreads();
     static size_t hugePages();
+    static uint64_t batchCount(size_t threadId, size_t bucket);
+    static uint64_t batchSum(size_t threadId);
+    static uint64_t batchTime(size_t threadId);
+    static uint64_t cpuHashCount();
+    static uint64_t firstBatch(size_t threadId, uint64_t published);
+    static uint64_t hashCount(size_t threadId);
+    static uint32_t hostCpu(size_t threadId);
+    static int threadDevice(int threadId);
+    static uint64_t kernelTime(size_t threadId, size_t kernel);
+    static uint64_t stalls(size_t threadId);
     static size_t threads();
+    static void prepare(xmrig::Controller *controller);
     static void printHashrate(bool detail);
     static void setEnabled(bool enabled);
     static void setJob(const xmrig::Job &job, bool donate);
     static bool start(xmrig::Controller *controller);
     // setups workers based on specified algorithm (or its basic perf algo more specifically)
     static bool switch_algo(const xmrig::Algorithm&);
+    static bool reconfigure(void (*configure)(void *arg), void *arg);
+    static void reload(xmrig::Config *previous);
     static void stop();
-    static void submit(const xmrig::Job &result);
+    static void submit(const JobSnapshot &job, size_t threadId, uint32_t nonce, const uint8_t *hash);
+    static void submitCpu(const JobSnapshot &job, uint32_t nonce, const uint8_t *hash);
+    static void waitReady();
+    static void waitResume();
 
     static inline bool isEnabled()                                      { return m_enabled; }
+    static inline uint32_t switches(xmrig::PerfAlgo from, xmrig::PerfAlgo to) { return m_switches[from][to]; }
+    static inline uint32_t switchCost(xmrig::PerfAlgo from, xmrig::PerfAlgo to) { return m_switchCost[from][to]; }
+    static uint32_t minDwell();
+    static inline uint32_t batchSplit()                                 { return m_batchSplit; }
+    static inline uint32_t staleTarget()                                { return m_staleTarget; }
+    static inline uint64_t minSubmitDiff()                              { return m_minSubmitDiff; }
+    static inline uint64_t jobInterval()                                { return m_jobInterval.load(std::memory_order_relaxed); }
     static inline bool isOutdated(uint64_t sequence)                    { return m_sequence.load(std::memory_order_relaxed) != sequence; }
     static inline bool isPaused()                                       { return m_paused.load(std::memory_order_relaxed) == 1; }
     static inline Hashrate *hashrate()                                  { return m_hashrate; }
+    static inline xmrig::DualMiner *dual()                              { return m_dual; }
+    static inline xmrig::PerfAlgo standby()                             { return m_standby; }
     static inline uint64_t sequence()                                   { return m_sequence.load(std::memory_order_relaxed); }
     static inline void pause()                                          { m_active = false; m_paused = 1; m_sequence++; }
-    static inline void setListener(xmrig::IJobResultListener *listener) { m_listener = listener; }
-    static cl_context m_opencl_ctx;
+    static void setListener(xmrig::IJobResultListener *listener);
+    static std::vector<cl_context> m_opencl_contexts;
 
 #   ifndef XMRIG_NO_API
+    static void threadKernels(size_t index, rapidjson::Value &thread, rapidjson::Document &doc);
+    static void threadLatency(size_t index, rapidjson::Value &thread, rapidjson::Document &doc);
+    static void threadProfile(size_t index, rapidjson::Value &thread, rapidjson::Document &doc);
+    static void threadStability(size_t index, rapidjson::Value &thread, rapidjson::Document &doc);
+    static void deviceErrors(size_t device, rapidjson::Value &value, rapidjson::Document &doc);
+    static void deviceStability(size_t device, rapidjson::Value &value, rapidjson::Document &doc);
+    static void deviceThermal(size_t device, rapidjson::Value &value, rapidjson::Document &doc);
     static void threadsSummary(rapidjson::Document &doc);
 #   endif
 
 private:
+    // compact record of a GPU result, hash is the GPU hash until CPU verification replaces it,
+    // results of CPU threads have a negative threadId and are not verified
+    struct ShareRecord
+    {
+        JobSnapshot job;
+        uint32_t nonce;
+        int threadId;
+        uint8_t hash[32];
+    };
+
+    struct VerifiedResult
+    {
+        inline VerifiedResult(ShareRecord &&share, bool deferred) : share(std::move(share)), deferred(deferred), submitted(false), valid(false) {}
+
+        ShareRecord share;
+        bool deferred;
+        bool submitted; // already given to a thread safe listener by the verification thread
+        bool valid;
+    };
+
+    // results verified on CPU in the current window of a thread, full is set once the error rate was above threshold,
+    // used from the event loop only
+    struct VerifyStats
+    {
+        inline VerifyStats() : submitted(0), checked(0), errors(0), full(false) {}
+
+        uint64_t submitted;
+        uint32_t checked;
+        uint32_t errors;
+        bool full;
+    };
+
+    // scratchpad memory of a verification or CPU mining thread
+    struct MemoryPool
+    {
+        const char *type;
+        size_t index;
+        int node;
+        size_t hugePages;
+        size_t pages;
+        size_t size;
+    };
+
+    // duty cycle of a GPU held by --temp-target and --power-target in 1/1000, bestEfficiency is the highest H/J
+    // seen and bestDuty the duty it was seen at, maxClock is the highest shader clock seen in MHz, desktop is set
+    // while --desktop-duty limits the GPU and desktopSeen is the last time the desktop was seen in use in ms
+    struct ThermalControl
+    {
+        inline ThermalControl() : desktop(false), throttled(false), maxClock(0), bestDuty(1000), duty(1000), desktopSeen(0), bestEfficiency(0.0) {}
+
+        bool desktop;
+        bool throttled;
+        int maxClock;
+        uint32_t bestDuty;
+        uint32_t duty;
+        uint64_t desktopSeen;
+        double bestEfficiency;
+    };
+
+    // results of the threads of a GPU, compute errors are results failing CPU verification out of checked ones,
+    // the others are pool rejects by reason, a reject for low difficulty is a bad share the sampled verification missed
+    struct DeviceErrors
+    {
+        inline DeviceErrors() : checked(0), compute(0), invalid(0), lowDifficulty(0), rejected(0), disabled(false) {}
+
+        uint64_t checked;
+        uint64_t compute;
+        uint64_t invalid;
+        uint64_t lowDifficulty;
+        uint64_t rejected;
+        bool disabled;
+    };
+
+    // progress of a GPU thread seen by the watchdog, changed is the time in ms hashCount last changed while mining,
+    // restarted the time of the last recovery, retired the worker replaced by it (or left by a failed recovery)
+    struct Watchdog
+    {
+        inline Watchdog() : retired(nullptr), worker(nullptr), stopped(false), restarts(0), changed(0), count(0), restarted(0) {}
+
+        const IWorker *retired;
+        const IWorker *worker;
+        bool stopped;
+        uint32_t restarts;
+        uint64_t changed;
+        uint64_t count;
+        uint64_t restarted;
+    };
+
+    // arrival time of the last job and average time between jobs of a pool in ns
+    struct JobArrival
+    {
+        inline JobArrival() : last(0), interval(0) {}
+
+        uint64_t last;
+        uint64_t interval;
+    };
+
+    // algo switch requested by a pool job, from its start until every GPU thread finished a batch of the
+    // job published after it, times are steady clock ns
+    struct PendingSwitch
+    {
+        inline PendingSwitch() : from(xmrig::PerfAlgo::PA_INVALID), to(xmrig::PerfAlgo::PA_INVALID), start(0), published(0) {}
+
+        xmrig::PerfAlgo from;
+        xmrig::PerfAlgo to;
+        uint64_t start;
+        uint64_t published;
+    };
+
+    static bool initThread(Handle *handle);
+    static bool relaunch(const std::vector<GpuContext *> &previous, xmrig::PerfAlgo standby);
+    static xmrig::JobResult jobResult(const ShareRecord &share);
     static void onReady(void *arg);
     static void onResult(uv_async_t *handle);
     static void onTick(uv_timer_t *handle);
+    static void printSensors(bool isColors);
+    static void publishStats();
+    static void sampleCanary();
+    static void sampleHistory();
+    static void releaseStandby();
+    static void submitDirect(std::list<VerifiedResult> &batch);
+    static void verify(ShareRecord &&share);
+    static void updateAlgoPerf();
+    static void updateEffective();
+    static void updateErrorRate(int threadId, bool valid);
+    static void verifyThread(size_t index, int64_t cpu, int priority);
+    static bool startVerifyGpu(xmrig::Config *config);
+    static void verifyGpuThread(int priority);
     static void start(IWorker *worker);
-    static void soft_stop(); // stop current workers leaving uv stuff intact (used in switch_algo)
+    static void launch(bool pending);
+    static void soft_stop(); // stop current workers leaving uv and OpenCL stuff intact (used in switch_algo)
+    static void startPrewarm();
+    static xmrig::PerfAlgo standbyAlgo(xmrig::PerfAlgo current);
+    static void updateJobInterval(int poolId, uint64_t now);
+    static void updateDuty();
+    static void updateThermal();
+    static bool restart(size_t index, size_t intensity);
+    static void applyErrorAction(int threadId, uint32_t rate);
+    static void recover(size_t index, uint64_t now);
+    static void watchdog();
+    static void park();
+    static void stopPrewarm();
+    static void unpark();
+    static void updatePark();
+    static void updateSwitchCost();
+    static void wakeup();
 
     static bool m_active;
     static bool m_enabled;
+    static bool m_parked;
+    static bool m_prewarmPending;
+    static bool m_verifyStop;
     static Hashrate *m_hashrate;
     static size_t m_threadsCount;
+    static std::atomic<bool> m_prewarmStop;
     static std::atomic<int> m_paused;
+    static std::atomic<size_t> m_starting;
+    static std::atomic<size_t> m_waiting;
     static std::atomic<uint64_t> m_sequence;
-    static std::list<xmrig::Job> m_queue;
+    static std::atomic<uint64_t> m_dropped;
+    static std::atomic<uint64_t> m_jobInterval;
+    static std::atomic<bool> m_lowered;
+    static GpuContext *m_verifyGpu;
+    static std::list<VerifiedResult> m_gpuQueue;
+    static std::list<VerifiedResult> m_queue;
+    static std::list<VerifiedResult> m_verified;
+    static std::map<int, JobArrival> m_arrivals;
+    static std::map<size_t, ThermalControl> m_thermal;
+    static std::map<size_t, BenchResults> m_benchResults;
+    static std::map<size_t, DeviceErrors> m_deviceErrors;
+    static std::map<size_t, Watchdog> m_watchdog;
+    static std::map<size_t, std::unique_ptr<std::mutex> > m_deviceInit;
+    static std::map<int, VerifyStats> m_verifyStats;
+    static ResultRing<ShareRecord, 4096> m_results;
+    static std::thread m_prewarm;
+    static std::thread m_verifyGpuThread;
+    static std::vector<CpuWorker*> m_cpuWorkers;
+    static std::vector<std::thread> m_cpuThreads;
+    static std::vector<MemoryPool> m_memory;
+    static std::vector<cl_context> m_verifyGpuContexts;
+    static std::vector<std::thread> m_verifyThreads;
     static std::vector<Handle*> m_workers;
+    static int64_t m_unparkTime;
+    static uint64_t m_minSubmitDiff;
+    static uint64_t m_pausedSince;
     static uint64_t m_ticks;
+    static uint32_t m_batchSplit;
+    static uint32_t m_parkAfter;
+    static uint32_t m_switches[xmrig::PerfAlgo::PA_MAX][xmrig::PerfAlgo::PA_MAX];
+    static uint32_t m_switchCost[xmrig::PerfAlgo::PA_MAX][xmrig::PerfAlgo::PA_MAX];
+    static PendingSwitch m_pendingSwitch;
+    static uint32_t m_staleTarget;
+    static uint32_t m_verifySample;
+    static uint32_t m_verifyThreshold;
     static uv_async_t m_async;
+    static uv_cond_t m_verifyCond;
+    static uv_cond_t m_verifyGpuCond;
+    static uv_cond_t m_pauseCond;
     static uv_mutex_t m_mutex;
-    static uv_rwlock_t m_rwlock;
+    static uv_mutex_t m_pauseMutex;
     static uv_timer_t m_timer;
     static xmrig::Controller *m_controller;
+    static xmrig::DualMiner *m_dual;
+    static xmrig::PerfAlgo m_jobAlgo;
+    static xmrig::PerfAlgo m_standby;
+    static std::atomic<xmrig::IJobResultListener *> m_direct;
     static xmrig::IJobResultListener *m_listener;
-    static xmrig::Job m_job;
+    static JobSnapshot m_job;
+    static std::map<int, std::shared_ptr<NonceSpace> > m_nonces;
 };
 
 